@@ -34,6 +34,7 @@
 #include "cpl_hash_set.h"
 #include "cpl_string.h"
 #include "cpl_sha256.h"
+#include "cpl_multiproc.h"
 
 namespace tut
 {
@@ -833,4 +834,272 @@ namespace tut
         ensure( VSIGetDiskFreeSpace(".") == -1 || VSIGetDiskFreeSpace(".") >= 0 );
     }
 
+    // Test VSIFPReadL()
+    struct TestPReadStruct
+    {
+        VSILFILE* fp;
+        int       nIter;
+        bool      bOK;
+    };
+
+    static void TestPReadThread(void* pData)
+    {
+        TestPReadStruct* psData = static_cast<TestPReadStruct*>(pData);
+        for( int i = 0; i < 1000 && psData->bOK; i++ )
+        {
+            const int nOffset = (i * 37 + psData->nIter * 101) % 900;
+            GByte abyBuffer[100];
+            if( VSIFPReadL(abyBuffer, 100, nOffset, psData->fp) != 100 )
+            {
+                psData->bOK = false;
+                break;
+            }
+            for( int j = 0; j < 100; j++ )
+            {
+                if( abyBuffer[j] != static_cast<GByte>((nOffset + j) % 251) )
+                {
+                    psData->bOK = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    template<>
+    template<>
+    void object::test<14>()
+    {
+        GByte abyData[1000];
+        for( int i = 0; i < 1000; i++ )
+            abyData[i] = static_cast<GByte>(i % 251);
+
+        const char* apszFilenames[] = { "/vsimem/test_cpl_pread.bin",
+                                        "tmp/test_cpl_pread.bin" };
+        for( size_t iFile = 0; iFile < CPL_ARRAYSIZE(apszFilenames); iFile++ )
+        {
+            VSILFILE* fp = VSIFOpenL(apszFilenames[iFile], "wb");
+            if( fp == NULL )
+                continue;
+            ensure_equals( VSIFWriteL(abyData, 1, 1000, fp), 1000U );
+            VSIFCloseL(fp);
+
+            const CPLString osSubFile(
+                CPLSPrintf("/vsisubfile/100_800,%s", apszFilenames[iFile]));
+            const char* apszToOpen[] = { apszFilenames[iFile], osSubFile.c_str() };
+            for( size_t iOpen = 0; iOpen < CPL_ARRAYSIZE(apszToOpen); iOpen++ )
+            {
+                const int nBase = (iOpen == 0) ? 0 : 100;
+                fp = VSIFOpenL(apszToOpen[iOpen], "rb");
+                ensure( fp != NULL );
+                ensure_equals( VSIFSeekL(fp, 10, SEEK_SET), 0 );
+
+                GByte abyBuffer[20];
+                ensure_equals( VSIFPReadL(abyBuffer, 20, 500, fp), 20U );
+                ensure_equals( static_cast<int>(abyBuffer[0]), (nBase + 500) % 251 );
+                ensure_equals( static_cast<int>(abyBuffer[19]), (nBase + 519) % 251 );
+                // Reads beyond the end of file are truncated
+                const size_t nSize = (iOpen == 0) ? 1000 : 800;
+                ensure_equals( VSIFPReadL(abyBuffer, 20, nSize - 5, fp), 5U );
+                ensure_equals( VSIFPReadL(abyBuffer, 20, nSize + 5, fp), 0U );
+                // The file position is not modified
+                ensure_equals( VSIFTellL(fp), static_cast<vsi_l_offset>(10) );
+                ensure_equals( VSIFReadL(abyBuffer, 1, 1, fp), 1U );
+                ensure_equals( static_cast<int>(abyBuffer[0]), (nBase + 10) % 251 );
+
+                ensure_equals( VSIFCloseL(fp), 0 );
+            }
+
+            // Concurrent reads on the same handle
+            fp = VSIFOpenL(apszFilenames[iFile], "rb");
+            ensure( fp != NULL );
+            TestPReadStruct asData[4];
+            CPLJoinableThread* ahThreads[4];
+            for( int i = 0; i < 4; i++ )
+            {
+                asData[i].fp = fp;
+                asData[i].nIter = i;
+                asData[i].bOK = true;
+                ahThreads[i] = CPLCreateJoinableThread(TestPReadThread, &asData[i]);
+            }
+            for( int i = 0; i < 4; i++ )
+            {
+                if( ahThreads[i] )
+                    CPLJoinThread(ahThreads[i]);
+                else
+                    TestPReadThread(&asData[i]);
+                ensure( asData[i].bOK );
+            }
+            ensure_equals( VSIFCloseL(fp), 0 );
+
+            VSIUnlink(apszFilenames[iFile]);
+        }
+    }
+
+    // Test VSIFReadMultiRangeAsyncL()
+    template<>
+    template<>
+    void object::test<15>()
+    {
+        GByte abyData[10000];
+        for( int i = 0; i < 10000; i++ )
+            abyData[i] = static_cast<GByte>(i % 251);
+
+        const char* apszFilenames[] = { "/vsimem/test_cpl_async.bin",
+                                        "tmp/test_cpl_async.bin" };
+        const char* apszThreads[] = { "1", "4" };
+        for( size_t iFile = 0; iFile < CPL_ARRAYSIZE(apszFilenames); iFile++ )
+        {
+            VSILFILE* fp = VSIFOpenL(apszFilenames[iFile], "wb");
+            if( fp == NULL )
+                continue;
+            ensure_equals( VSIFWriteL(abyData, 1, 10000, fp), 10000U );
+            VSIFCloseL(fp);
+
+            for( size_t iThreads = 0; iThreads < CPL_ARRAYSIZE(apszThreads);
+                 iThreads++ )
+            {
+                CPLSetConfigOption("GDAL_NUM_THREADS", apszThreads[iThreads]);
+
+                fp = VSIFOpenL(apszFilenames[iFile], "rb");
+                ensure( fp != NULL );
+
+                GByte abyBuffer[10][100];
+                void* apData[10];
+                vsi_l_offset anOffsets[10];
+                size_t anSizes[10];
+                for( int i = 0; i < 10; i++ )
+                {
+                    memset(abyBuffer[i], 0, 100);
+                    apData[i] = abyBuffer[i];
+                    anOffsets[i] = 9000 - 1000 * i;
+                    anSizes[i] = 10 * (i + 1);
+                }
+
+                VSIAsyncReadRequestH hRequest =
+                    VSIFReadMultiRangeAsyncL(10, apData, anOffsets, anSizes, fp);
+                ensure( hRequest != NULL );
+                ensure_equals( VSIAsyncReadRequestWait(hRequest), 0 );
+                ensure( VSIAsyncReadRequestIsComplete(hRequest) );
+                VSIAsyncReadRequestDestroy(hRequest);
+                for( int i = 0; i < 10; i++ )
+                {
+                    ensure_equals( memcmp(abyBuffer[i], abyData + anOffsets[i],
+                                          anSizes[i]), 0 );
+                }
+
+                // The same through VSIFReadMultiRangeL()
+                for( int i = 0; i < 10; i++ )
+                    memset(abyBuffer[i], 0, 100);
+                ensure_equals(
+                    VSIFReadMultiRangeL(10, apData, anOffsets, anSizes, fp), 0 );
+                for( int i = 0; i < 10; i++ )
+                {
+                    ensure_equals( memcmp(abyBuffer[i], abyData + anOffsets[i],
+                                          anSizes[i]), 0 );
+                }
+
+                // Reads beyond the end of file are reported as errors
+                anOffsets[0] = 9990;
+                anSizes[0] = 20;
+                hRequest =
+                    VSIFReadMultiRangeAsyncL(10, apData, anOffsets, anSizes, fp);
+                ensure_equals( VSIAsyncReadRequestWait(hRequest), -1 );
+                VSIAsyncReadRequestDestroy(hRequest);
+
+                ensure_equals( VSIFCloseL(fp), 0 );
+            }
+            CPLSetConfigOption("GDAL_NUM_THREADS", NULL);
+
+            VSIUnlink(apszFilenames[iFile]);
+        }
+    }
+
+    // Test concurrent access to /vsizip/ with an archive cache that can
+    // only hold one archive at a time
+    struct TestArchiveCacheStruct
+    {
+        int       nIter;
+        bool      bOK;
+    };
+
+    static void TestArchiveCacheThread(void* pData)
+    {
+        TestArchiveCacheStruct* psData =
+            static_cast<TestArchiveCacheStruct*>(pData);
+        for( int i = 0; i < 200 && psData->bOK; i++ )
+        {
+            const int iArchive = (i + psData->nIter) % 3;
+            const CPLString osDir(
+                CPLSPrintf("/vsizip//vsimem/test_cpl_archive_%d.zip",
+                           iArchive));
+            const CPLString osMember(osDir + "/subdir/member.txt");
+
+            VSIStatBufL sStat;
+            if( VSIStatL(osMember, &sStat) != 0 || sStat.st_size != 2 )
+            {
+                psData->bOK = false;
+                break;
+            }
+
+            char** papszList = VSIReadDir((osDir + "/subdir").c_str());
+            if( CSLCount(papszList) != 1 ||
+                !EQUAL(papszList[0], "member.txt") )
+                psData->bOK = false;
+            CSLDestroy(papszList);
+
+            VSILFILE* fp = VSIFOpenL(osMember, "rb");
+            char szBuffer[3] = { 0, 0, 0 };
+            if( fp == NULL )
+            {
+                psData->bOK = false;
+                break;
+            }
+            if( VSIFReadL(szBuffer, 1, 2, fp) != 2 ||
+                szBuffer[0] != 'A' + iArchive || szBuffer[1] != '\n' )
+                psData->bOK = false;
+            VSIFCloseL(fp);
+        }
+    }
+
+    template<>
+    template<>
+    void object::test<16>()
+    {
+        for( int i = 0; i < 3; i++ )
+        {
+            VSILFILE* fp = VSIFOpenL(
+                CPLSPrintf("/vsizip//vsimem/test_cpl_archive_%d.zip/subdir/member.txt", i),
+                "wb");
+            ensure( fp != NULL );
+            const char achData[2] = { static_cast<char>('A' + i), '\n' };
+            ensure_equals( VSIFWriteL(achData, 1, 2, fp), 2U );
+            VSIFCloseL(fp);
+        }
+
+        CPLSetConfigOption("CPL_VSIL_ARCHIVE_CACHE_SIZE", "1");
+
+        TestArchiveCacheStruct asData[4];
+        CPLJoinableThread* ahThreads[4];
+        for( int i = 0; i < 4; i++ )
+        {
+            asData[i].nIter = i;
+            asData[i].bOK = true;
+            ahThreads[i] = CPLCreateJoinableThread(TestArchiveCacheThread,
+                                                   &asData[i]);
+        }
+        for( int i = 0; i < 4; i++ )
+        {
+            if( ahThreads[i] )
+                CPLJoinThread(ahThreads[i]);
+            else
+                TestArchiveCacheThread(&asData[i]);
+            ensure( asData[i].bOK );
+        }
+
+        CPLSetConfigOption("CPL_VSIL_ARCHIVE_CACHE_SIZE", NULL);
+
+        for( int i = 0; i < 3; i++ )
+            VSIUnlink(CPLSPrintf("/vsimem/test_cpl_archive_%d.zip", i));
+    }
+
 } // namespace tut
@@ -30,6 +30,9 @@
 #include <tut.h>
 #include <gdal_alg.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace tut
 {
     // Common fixture with test data
@@ -165,4 +168,124 @@ namespace tut
             }
         }
     }
+
+    // Delaunay property and topology on pseudo-random points, with duplicates
+    template<>
+    template<>
+    void object::test<4>()
+    {
+        const int nPoints = 500;
+        double adfX[nPoints], adfY[nPoints];
+        unsigned int nSeed = 1;
+        for(int i=0;i<nPoints;i++)
+        {
+            nSeed = nSeed * 1103515245U + 12345U;
+            adfX[i] = 1000 + (nSeed >> 16) % 1000;
+            nSeed = nSeed * 1103515245U + 12345U;
+            adfY[i] = 2000 + (nSeed >> 16) % 500;
+        }
+        adfX[nPoints-1] = adfX[0];
+        adfY[nPoints-1] = adfY[0];
+
+        psDT = GDALTriangulationCreateDelaunay(nPoints, adfX, adfY);
+        ensure(psDT != NULL);
+        for(int i=0;i<psDT->nFacets;i++)
+        {
+            const GDALTriFacet* psFacet = &(psDT->pasFacets[i]);
+            for(int j=0;j<3;j++)
+            {
+                // The neighbor opposite to vertex j shares the two other ones
+                int nNeighbor = psFacet->anNeighborIdx[j];
+                ensure(nNeighbor >= -1 && nNeighbor < psDT->nFacets);
+                if( nNeighbor < 0 )
+                    continue;
+                int nShared = 0;
+                int bBackLink = FALSE;
+                for(int k=0;k<3;k++)
+                {
+                    int nVertex = psDT->pasFacets[nNeighbor].anVertexIdx[k];
+                    if( nVertex == psFacet->anVertexIdx[(j+1)%3] ||
+                        nVertex == psFacet->anVertexIdx[(j+2)%3] )
+                        nShared ++;
+                    if( psDT->pasFacets[nNeighbor].anNeighborIdx[k] == i )
+                        bBackLink = TRUE;
+                }
+                ensure_equals(nShared, 2);
+                ensure(bBackLink);
+            }
+
+            // No point strictly inside the circumcircle
+            double ax = adfX[psFacet->anVertexIdx[0]];
+            double ay = adfY[psFacet->anVertexIdx[0]];
+            double bx = adfX[psFacet->anVertexIdx[1]] - ax;
+            double by = adfY[psFacet->anVertexIdx[1]] - ay;
+            double cx = adfX[psFacet->anVertexIdx[2]] - ax;
+            double cy = adfY[psFacet->anVertexIdx[2]] - ay;
+            double d = 2 * (bx * cy - by * cx);
+            ensure(d != 0);
+            double ux = (cy * (bx * bx + by * by) - by * (cx * cx + cy * cy)) / d;
+            double uy = (bx * (cx * cx + cy * cy) - cx * (bx * bx + by * by)) / d;
+            double r2 = ux * ux + uy * uy;
+            for(int k=0;k<nPoints;k++)
+            {
+                double dx = adfX[k] - ax - ux;
+                double dy = adfY[k] - ay - uy;
+                ensure(dx * dx + dy * dy >= r2 * (1 - 1e-10));
+            }
+        }
+
+        // Walking from any triangle finds the one found by brute force
+        ensure_equals(GDALTriangulationComputeBarycentricCoefficients(psDT, adfX, adfY) , TRUE);
+        for(int i=0;i<psDT->nFacets;i+=17)
+        {
+            double x = 1500.123;
+            double y = 2250.377;
+            int face, new_face;
+            ensure_equals(GDALTriangulationFindFacetBruteForce(psDT, x, y, &face), TRUE);
+            ensure_equals(GDALTriangulationFindFacetDirected(psDT, i, x, y, &new_face), TRUE);
+            ensure_equals(face, new_face);
+        }
+    }
+
+    // Regular grid far from the origin: all the points are cocircular with
+    // their neighbours, and many are collinear
+    template<>
+    template<>
+    void object::test<5>()
+    {
+        const int nSize = 100;
+        const int nPoints = nSize * nSize;
+        std::vector<double> adfX(nPoints), adfY(nPoints);
+        for(int i=0;i<nPoints;i++)
+        {
+            adfX[i] = 1e6 + 0.1 * (i % nSize);
+            adfY[i] = 5e6 + 0.1 * (i / nSize);
+        }
+
+        psDT = GDALTriangulationCreateDelaunay(nPoints, &adfX[0], &adfY[0]);
+        ensure(psDT != NULL);
+        ensure_equals(psDT->nFacets, 2 * (nSize - 1) * (nSize - 1));
+
+        // Each facet is half of a grid cell
+        std::vector<int> anUsed(nPoints);
+        for(int i=0;i<psDT->nFacets;i++)
+        {
+            int anCol[3], anRow[3];
+            for(int j=0;j<3;j++)
+            {
+                int nVertex = psDT->pasFacets[i].anVertexIdx[j];
+                anCol[j] = nVertex % nSize;
+                anRow[j] = nVertex / nSize;
+                anUsed[nVertex] = TRUE;
+            }
+            int nMinCol = std::min(anCol[0], std::min(anCol[1], anCol[2]));
+            int nMaxCol = std::max(anCol[0], std::max(anCol[1], anCol[2]));
+            int nMinRow = std::min(anRow[0], std::min(anRow[1], anRow[2]));
+            int nMaxRow = std::max(anRow[0], std::max(anRow[1], anRow[2]));
+            ensure_equals(nMaxCol - nMinCol, 1);
+            ensure_equals(nMaxRow - nMinRow, 1);
+        }
+        for(int i=0;i<nPoints;i++)
+            ensure(anUsed[i]);
+    }
 } // namespace tut
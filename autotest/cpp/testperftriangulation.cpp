@@ -0,0 +1,120 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL Algorithms
+ * Purpose:  Compare performance of the native and QHull Delaunay
+ *           triangulations, and of linear gridding on top of them.
+ *
+ ******************************************************************************
+ * Copyright (c) 2016, The GDAL project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "cpl_conv.h"
+#include "gdal.h"
+#include "gdal_alg.h"
+
+static void Usage()
+{
+    printf("Usage: testperftriangulation [-points n] [-grid size]\n");
+    exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+    int nPoints = 1000000;
+    int nGridSize = 1000;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( strcmp(argv[i], "-points") == 0 && i + 1 < argc )
+            nPoints = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-grid") == 0 && i + 1 < argc )
+            nGridSize = atoi(argv[++i]);
+        else
+            Usage();
+    }
+    if( nPoints < 3 || nGridSize < 1 )
+        Usage();
+
+    // Pseudo-random survey points, in projected coordinates
+    std::vector<double> adfX(nPoints), adfY(nPoints), adfZ(nPoints);
+    unsigned int nSeed = 1;
+    for( int i = 0; i < nPoints; i++ )
+    {
+        nSeed = nSeed * 1103515245U + 12345U;
+        adfX[i] = 500000.0 + (nSeed >> 8) * (10000.0 / (1 << 24));
+        nSeed = nSeed * 1103515245U + 12345U;
+        adfY[i] = 4000000.0 + (nSeed >> 8) * (10000.0 / (1 << 24));
+        adfZ[i] = (adfX[i] - 500000.0) * 0.01 + (adfY[i] - 4000000.0) * 0.02;
+    }
+
+    // Only measure single-threaded processing
+    CPLSetConfigOption("GDAL_NUM_THREADS", "1");
+
+    const char* const apszMethods[] = { "NATIVE", "QHULL" };
+    for( int iMethod = 0; iMethod < 2; iMethod++ )
+    {
+        CPLSetConfigOption("GDAL_TRIANGULATION_METHOD", apszMethods[iMethod]);
+
+        clock_t start = clock();
+        GDALTriangulation* psDT =
+            GDALTriangulationCreateDelaunay(nPoints, &adfX[0], &adfY[0]);
+        clock_t end = clock();
+        if( psDT == NULL )
+        {
+            printf("%s : triangulation failed\n", apszMethods[iMethod]);
+            continue;
+        }
+        printf("%s : triangulation of %d points (%d triangles) : %.2f s\n",
+               apszMethods[iMethod], nPoints, psDT->nFacets,
+               (end - start) * 1.0 / CLOCKS_PER_SEC);
+        GDALTriangulationFree(psDT);
+
+        GDALGridLinearOptions sOptions;
+        memset(&sOptions, 0, sizeof(sOptions));
+        sOptions.dfRadius = -1;
+        std::vector<float> afData(static_cast<size_t>(nGridSize) * nGridSize);
+        start = clock();
+        CPLErr eErr = GDALGridCreate(GGA_Linear, &sOptions, nPoints,
+                                     &adfX[0], &adfY[0], &adfZ[0],
+                                     500000.0, 510000.0,
+                                     4000000.0, 4010000.0,
+                                     nGridSize, nGridSize, GDT_Float32,
+                                     &afData[0], NULL, NULL);
+        end = clock();
+        printf("%s : linear gridding on %dx%d nodes : %.2f s%s\n",
+               apszMethods[iMethod], nGridSize, nGridSize,
+               (end - start) * 1.0 / CLOCKS_PER_SEC,
+               eErr == CE_None ? "" : " (failed)");
+    }
+
+    CPLSetConfigOption("GDAL_TRIANGULATION_METHOD", NULL);
+    CPLSetConfigOption("GDAL_NUM_THREADS", NULL);
+    GDALDestroyDriverManager();
+
+    return 0;
+}
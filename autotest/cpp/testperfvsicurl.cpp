@@ -0,0 +1,188 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  CPL - Common Portability Library
+ * Purpose:  Test performance of the /vsicurl/ region cache with concurrent
+ *           readers, as the number of cached regions grows.
+ *
+ ******************************************************************************
+ * Copyright (c) 2016, The GDAL project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+// The files are fetched from a HTTP server that honours Range requests, for
+// example the /test_ranges/ resource of autotest/pymod/webserver.py :
+//   testperfvsicurl http://localhost:8080/test_ranges/
+// They are entirely cached in RAM first, by chunks of 1 KB, so that the
+// timed reads only measure the cost of the region cache lookups.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "cpl_conv.h"
+#include "cpl_multiproc.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+typedef struct
+{
+    std::vector<CPLString>* paosFiles;
+    int                     nReads;
+    unsigned int            nSeed;
+    int                     nErrors;
+} ReaderStruct;
+
+static void Usage()
+{
+    printf("Usage: testperfvsicurl [-threads n] [-reads n] [-max_files n] url_prefix\n");
+    exit(1);
+}
+
+static void ReaderThread(void* pData)
+{
+    ReaderStruct* psData = static_cast<ReaderStruct*>(pData);
+    std::vector<CPLString>& aosFiles = *(psData->paosFiles);
+
+    std::vector<VSILFILE*> apoFiles;
+    for( size_t i = 0; i < aosFiles.size(); i++ )
+        apoFiles.push_back(VSIFOpenL(aosFiles[i], "rb"));
+
+    GByte abyBuffer[100];
+    for( int i = 0; i < psData->nReads; i++ )
+    {
+        psData->nSeed = psData->nSeed * 1103515245U + 12345U;
+        const size_t iFile = (psData->nSeed >> 8) % apoFiles.size();
+        psData->nSeed = psData->nSeed * 1103515245U + 12345U;
+        const vsi_l_offset nOffset = (psData->nSeed >> 8) % 900000;
+        if( apoFiles[iFile] == NULL ||
+            VSIFSeekL(apoFiles[iFile], nOffset, SEEK_SET) != 0 ||
+            VSIFReadL(abyBuffer, 1, sizeof(abyBuffer), apoFiles[iFile]) !=
+                                                        sizeof(abyBuffer) )
+        {
+            psData->nErrors++;
+        }
+    }
+
+    for( size_t i = 0; i < apoFiles.size(); i++ )
+    {
+        if( apoFiles[i] != NULL )
+            VSIFCloseL(apoFiles[i]);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int nThreads = 4;
+    int nReads = 100000;
+    int nMaxFiles = 32;
+    const char* pszURLPrefix = NULL;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( strcmp(argv[i], "-threads") == 0 && i + 1 < argc )
+            nThreads = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-reads") == 0 && i + 1 < argc )
+            nReads = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-max_files") == 0 && i + 1 < argc )
+            nMaxFiles = atoi(argv[++i]);
+        else if( argv[i][0] != '-' && pszURLPrefix == NULL )
+            pszURLPrefix = argv[i];
+        else
+            Usage();
+    }
+    if( pszURLPrefix == NULL || nThreads < 1 || nReads < 1 || nMaxFiles < 1 )
+        Usage();
+
+    // Small chunks and a cache large enough to hold all the files
+    CPLSetConfigOption("CPL_VSIL_CURL_CHUNK_SIZE", "1024");
+    CPLSetConfigOption("CPL_VSIL_CURL_CACHE_SIZE", "2000000000");
+    // Download through the cache rather than directly in the user buffer
+    CPLSetConfigOption("GDAL_HTTP_MULTIRANGE", "SINGLE_GET");
+
+    std::vector<CPLString> aosFiles;
+    for( int nFiles = 1; nFiles <= nMaxFiles; nFiles *= 2 )
+    {
+        // Cache the new files entirely
+        for( int i = 0; i < nFiles; i++ )
+        {
+            if( i < static_cast<int>(aosFiles.size()) )
+                continue;
+            aosFiles.push_back(CPLSPrintf("/vsicurl/%sperf_%d.bin",
+                                          pszURLPrefix, i));
+            VSILFILE* fp = VSIFOpenL(aosFiles.back(), "rb");
+            if( fp == NULL )
+            {
+                fprintf(stderr, "Cannot open %s\n", aosFiles.back().c_str());
+                exit(1);
+            }
+            VSIFSeekL(fp, 0, SEEK_END);
+            const vsi_l_offset nSize = VSIFTellL(fp);
+            std::vector<GByte> abyData(static_cast<size_t>(nSize));
+            VSIFSeekL(fp, 0, SEEK_SET);
+            if( nSize < 1000000 ||
+                VSIFReadL(&abyData[0], 1, abyData.size(), fp) != abyData.size() )
+            {
+                fprintf(stderr, "Cannot read 1 MB from %s\n",
+                        aosFiles.back().c_str());
+                exit(1);
+            }
+            VSIFCloseL(fp);
+        }
+
+        std::vector<ReaderStruct> asData(nThreads);
+        std::vector<CPLJoinableThread*> ahThreads(nThreads);
+        clock_t start = clock();
+        for( int i = 0; i < nThreads; i++ )
+        {
+            asData[i].paosFiles = &aosFiles;
+            asData[i].nReads = nReads;
+            asData[i].nSeed = i + 1;
+            asData[i].nErrors = 0;
+            ahThreads[i] = CPLCreateJoinableThread(ReaderThread, &asData[i]);
+        }
+        int nErrors = 0;
+        for( int i = 0; i < nThreads; i++ )
+        {
+            if( ahThreads[i] )
+                CPLJoinThread(ahThreads[i]);
+            else
+                ReaderThread(&asData[i]);
+            nErrors += asData[i].nErrors;
+        }
+        clock_t end = clock();
+
+        printf("%d files, ~%d cached regions : %d threads x %d reads : "
+               "%.3f us of CPU time per read%s\n",
+               nFiles, nFiles * 1000000 / 1024, nThreads,
+               nReads,
+               (end - start) * 1e6 / CLOCKS_PER_SEC / nThreads / nReads,
+               nErrors ? " (some reads failed)" : "");
+    }
+
+    CPLSetConfigOption("GDAL_HTTP_MULTIRANGE", NULL);
+    CPLSetConfigOption("CPL_VSIL_CURL_CACHE_SIZE", NULL);
+    CPLSetConfigOption("CPL_VSIL_CURL_CHUNK_SIZE", NULL);
+    VSICleanupFileManager();
+
+    return 0;
+}
@@ -1370,7 +1370,7 @@ def tiff_direct_and_virtual_mem_io():
          options = [('GTIFF_DIRECT_IO', '/vsimem'), ('GTIFF_VIRTUAL_MEM_IO', '/vsimem')]
      else:
          nitermax = 8
-         options = [('GTIFF_DIRECT_IO', '/vsimem'), ('GTIFF_VIRTUAL_MEM_IO', '/vsimem'), ('GTIFF_VIRTUAL_MEM_IO', 'tmp')]
+         options = [('GTIFF_DIRECT_IO', '/vsimem'), ('GTIFF_DIRECT_IO', 'tmp'), ('GTIFF_VIRTUAL_MEM_IO', '/vsimem'), ('GTIFF_VIRTUAL_MEM_IO', 'tmp')]
      for (option, prefix) in options:
       if dt == gdal.GDT_CInt16:
           niter = 3
@@ -2436,6 +2436,93 @@ def tiff_read_wrong_number_extrasamples():
 
     return 'success'
 
+###############################################################################
+# Test multi-threaded decompression of read requests (NUM_THREADS open option)
+
+def tiff_read_multi_threaded():
+
+    src_ds = gdal.Open('data/stefan_full_rgba.tif')
+    for options in [ ['COMPRESS=DEFLATE', 'TILED=YES', 'BLOCKXSIZE=16', 'BLOCKYSIZE=16'],
+                     ['COMPRESS=LZW', 'PREDICTOR=2', 'BLOCKYSIZE=3'],
+                     ['COMPRESS=PACKBITS', 'INTERLEAVE=BAND', 'TILED=YES', 'BLOCKXSIZE=32', 'BLOCKYSIZE=32'] ]:
+        gdal.GetDriverByName('GTiff').CreateCopy('/vsimem/tiff_read_multi_threaded.tif', src_ds, options = options)
+
+        ds = gdal.Open('/vsimem/tiff_read_multi_threaded.tif')
+        ref_data = ds.ReadRaster(0, 0, ds.RasterXSize, ds.RasterYSize)
+        ref_subsampled_data = ds.ReadRaster(1, 2, 100, 50, 30, 20)
+        ref_cs = [ ds.GetRasterBand(i+1).Checksum() for i in range(ds.RasterCount) ]
+        ds = None
+
+        old_cache_max = gdal.GetCacheMax()
+        for cache_max in [ old_cache_max, 10000 ]:
+            # A small cache forces the request to be split in several chunks
+            gdal.SetCacheMax(cache_max)
+            ds = gdal.OpenEx('/vsimem/tiff_read_multi_threaded.tif', open_options = ['NUM_THREADS=4'])
+            data = ds.ReadRaster(0, 0, ds.RasterXSize, ds.RasterYSize)
+            subsampled_data = ds.ReadRaster(1, 2, 100, 50, 30, 20)
+            cs = [ ds.GetRasterBand(i+1).Checksum() for i in range(ds.RasterCount) ]
+            ds = None
+            gdal.SetCacheMax(old_cache_max)
+            if data != ref_data or subsampled_data != ref_subsampled_data or cs != ref_cs:
+                gdaltest.post_reason('fail')
+                print(options)
+                print(cache_max)
+                print(cs)
+                print(ref_cs)
+                return 'fail'
+
+    gdal.Unlink('/vsimem/tiff_read_multi_threaded.tif')
+
+    return 'success'
+
+###############################################################################
+# Test on-demand loading of strip/tile offsets and byte counts
+
+def tiff_read_lazy_strile_loading():
+
+    src_ds = gdal.GetDriverByName('MEM').Create('', 2000, 1000)
+    src_ds.GetRasterBand(1).Fill(1)
+    src_ds.GetRasterBand(1).WriteRaster(1000, 500, 1000, 500, 'x' * (1000 * 500))
+
+    for options in [ ['TILED=YES', 'BLOCKXSIZE=16', 'BLOCKYSIZE=16', 'SPARSE_OK=YES'],
+                     ['TILED=YES', 'BLOCKXSIZE=16', 'BLOCKYSIZE=16', 'ENDIANNESS=BIG', 'BIGTIFF=YES', 'COMPRESS=DEFLATE'],
+                     ['BLOCKYSIZE=1', 'ENDIANNESS=BIG'],
+                     ['BLOCKYSIZE=1', 'BIGTIFF=YES'] ]:
+        gdal.GetDriverByName('GTiff').CreateCopy('/vsimem/tiff_read_lazy_strile_loading.tif', src_ds, options = options)
+
+        # In update mode, the arrays are loaded as a whole
+        ds = gdal.Open('/vsimem/tiff_read_lazy_strile_loading.tif', gdal.GA_Update)
+        band = ds.GetRasterBand(1)
+        (blockxsize, blockysize) = band.GetBlockSize()
+        nblocksx = int((ds.RasterXSize + blockxsize - 1) / blockxsize)
+        nblocksy = int((ds.RasterYSize + blockysize - 1) / blockysize)
+        blocks = [ (0, 0), (nblocksx - 1, nblocksy - 1), (nblocksx - 1, 0),
+                   (0, nblocksy - 1), (int(nblocksx / 2), int(nblocksy / 2)) ]
+        blocks += [ (i % nblocksx, int(i / nblocksx)) for i in range(500, 3000, 101) ]
+        ref_md = [ (band.GetMetadataItem('BLOCK_OFFSET_%d_%d' % xy, 'TIFF'),
+                    band.GetMetadataItem('BLOCK_SIZE_%d_%d' % xy, 'TIFF')) for xy in blocks ]
+        ds = None
+
+        ds = gdal.Open('/vsimem/tiff_read_lazy_strile_loading.tif')
+        band = ds.GetRasterBand(1)
+        md = [ (band.GetMetadataItem('BLOCK_OFFSET_%d_%d' % xy, 'TIFF'),
+                band.GetMetadataItem('BLOCK_SIZE_%d_%d' % xy, 'TIFF')) for xy in reversed(blocks) ]
+        md.reverse()
+        cs = band.Checksum()
+        ds = None
+
+        if md != ref_md or cs != src_ds.GetRasterBand(1).Checksum():
+            gdaltest.post_reason('fail')
+            print(options)
+            print(md)
+            print(ref_md)
+            print(cs)
+            return 'fail'
+
+    gdal.Unlink('/vsimem/tiff_read_lazy_strile_loading.tif')
+
+    return 'success'
+
 ###############################################################################
 
 for item in init_list:
@@ -2497,6 +2584,8 @@ gdaltest_list.append( (tiff_read_colortable_as_rgba) )
 gdaltest_list.append( (tiff_read_logl_as_rgba) )
 gdaltest_list.append( (tiff_read_scanline_more_than_2GB) )
 gdaltest_list.append( (tiff_read_wrong_number_extrasamples) )
+gdaltest_list.append( (tiff_read_multi_threaded) )
+gdaltest_list.append( (tiff_read_lazy_strile_loading) )
 
 gdaltest_list.append( (tiff_read_online_1) )
 gdaltest_list.append( (tiff_read_online_2) )
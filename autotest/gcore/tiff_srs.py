@@ -390,6 +390,81 @@ def tiff_srs_epsg_2853_with_us_feet():
 
     return 'success'
 
+###############################################################################
+# Test the process-wide cache of the SRS built from the GeoTIFF keys
+
+def tiff_srs_cache():
+
+    old_val = gdal.GetConfigOption('GTIFF_SRS_CACHE_SIZE')
+    gdal.SetConfigOption('GTIFF_SRS_CACHE_SIZE', '0')
+    ds = gdal.Open('data/byte_point.tif')
+    expected_wkt = ds.GetProjectionRef()
+    ds = None
+    gdal.SetConfigOption('GTIFF_SRS_CACHE_SIZE', old_val)
+
+    # The second opening uses the cached SRS
+    for i in range(2):
+        ds = gdal.Open('data/byte_point.tif')
+        wkt = ds.GetProjectionRef()
+        area_or_point = ds.GetMetadataItem('AREA_OR_POINT')
+        ds = None
+        if wkt != expected_wkt or area_or_point != 'Point':
+            gdaltest.post_reason('fail')
+            print(i)
+            print(wkt)
+            print(area_or_point)
+            return 'fail'
+
+    # Results with warnings are not cached
+    for i in range(2):
+        ds = gdal.Open('data/weird_mercator_2sp.tif')
+        gdal.ErrorReset()
+        gdal.PushErrorHandler()
+        wkt = ds.GetProjectionRef()
+        gdal.PopErrorHandler()
+        ds = None
+        if gdal.GetLastErrorMsg() == '':
+            gdaltest.post_reason('warning expected')
+            print(i)
+            return 'fail'
+
+    # Even when the previous warning is still the last error (Open() resets
+    # it, so open all the datasets first)
+    warnings = []
+    def error_handler(eErrClass, err_no, msg):
+        if eErrClass == gdal.CE_Warning:
+            warnings.append(msg)
+    datasets = [ gdal.Open('data/weird_mercator_2sp.tif') for i in range(3) ]
+    for i in range(3):
+        del warnings[:]
+        gdal.PushErrorHandler(error_handler)
+        wkt = datasets[i].GetProjectionRef()
+        gdal.PopErrorHandler()
+        if len(warnings) == 0:
+            gdaltest.post_reason('warning expected')
+            print(i)
+            return 'fail'
+    datasets = None
+
+    # Config options that alter the SRS are taken into account
+    ds = gdal.GetDriverByName('GTiff').Create('/vsimem/tiff_srs_cache.tif',1,1)
+    ds.SetProjection("""COMPD_CS["WGS 84 + EGM96 geoid height",GEOGCS["WGS 84",DATUM["WGS_1984",SPHEROID["WGS 84",6378137,298.257223563,AUTHORITY["EPSG","7030"]],AUTHORITY["EPSG","6326"]],PRIMEM["Greenwich",0,AUTHORITY["EPSG","8901"]],UNIT["degree",0.0174532925199433,AUTHORITY["EPSG","9122"]],AUTHORITY["EPSG","4326"]],VERT_CS["EGM96 geoid height",VERT_DATUM["EGM96 geoid",2005,AUTHORITY["EPSG","5171"]],UNIT["metre",1,AUTHORITY["EPSG","9001"]],AXIS["Up",UP],AUTHORITY["EPSG","5773"]]]""")
+    ds = None
+    for report_compd_cs in [ 'NO', 'YES', 'NO' ]:
+        gdal.SetConfigOption('GTIFF_REPORT_COMPD_CS', report_compd_cs)
+        ds = gdal.Open('/vsimem/tiff_srs_cache.tif')
+        wkt = ds.GetProjectionRef()
+        ds = None
+        gdal.SetConfigOption('GTIFF_REPORT_COMPD_CS', None)
+        if (wkt.find('COMPD_CS') == 0) != (report_compd_cs == 'YES'):
+            gdaltest.post_reason('fail')
+            print(report_compd_cs)
+            print(wkt)
+            return 'fail'
+    gdal.Unlink('/vsimem/tiff_srs_cache.tif')
+
+    return 'success'
+
 gdaltest_list = []
 
 tiff_srs_list = [ 2758, #tmerc
@@ -461,6 +536,7 @@ gdaltest_list.append( tiff_srs_WGS_1984_Web_Mercator_Auxiliary_Sphere )
 gdaltest_list.append( tiff_srs_angular_units )
 gdaltest_list.append( tiff_custom_datum_known_ellipsoid )
 gdaltest_list.append( tiff_srs_epsg_2853_with_us_feet )
+gdaltest_list.append( tiff_srs_cache )
 
 if __name__ == '__main__':
 
@@ -4279,7 +4279,7 @@ Band 1}""".encode('ascii'))
     src_ds = gdal.Open('tmp/tiff_write_101.bin')
     expected_cs = src_ds.GetRasterBand(1).Checksum()
 
-    for compression_method in ['DEFLATE', 'LZW', 'JPEG', 'PACKBITS', 'LZMA' ]:
+    for compression_method in ['DEFLATE', 'LZW', 'JPEG', 'PACKBITS', 'LZMA', 'ZSTD' ]:
         if md['DMD_CREATIONOPTIONLIST'].find(compression_method) == -1:
             continue
 
@@ -6441,6 +6441,505 @@ def tiff_write_144():
 
     return 'success'
 
+###############################################################################
+# Test CLOUD_OPTIMIZED=YES creation option and the layout validator
+
+def tiff_write_145():
+
+    sys.path.append('../../gdal/swig/python/samples')
+    try:
+        import validate_cloud_optimized_geotiff
+    except:
+        return 'skip'
+
+    src_ds = gdaltest.tiff_drv.Create('/vsimem/tiff_write_145_src.tif', 1024, 1024, 2)
+    src_ds.GetRasterBand(1).Fill(10)
+    src_ds.GetRasterBand(2).Fill(20)
+    src_ds.GetRasterBand(1).WriteRaster(0, 0, 300, 300, 'x' * (300 * 300))
+    gdal.SetConfigOption('GDAL_TIFF_INTERNAL_MASK', 'YES')
+    src_ds.CreateMaskBand(gdal.GMF_PER_DATASET)
+    gdal.SetConfigOption('GDAL_TIFF_INTERNAL_MASK', None)
+    src_ds.GetRasterBand(1).GetMaskBand().Fill(255)
+    src_ds.GetRasterBand(1).GetMaskBand().WriteRaster(500, 500, 100, 100, '\0' * (100 * 100))
+    src_ds.BuildOverviews('NEAR', [2, 4, 8])
+    src_ds.FlushCache()
+
+    for options in [ [], ['COMPRESS=DEFLATE', 'ENDIANNESS=BIG'],
+                     ['BIGTIFF=YES', 'BLOCKXSIZE=128', 'BLOCKYSIZE=64'] ]:
+        ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_145.tif', src_ds,
+                                          options = ['CLOUD_OPTIMIZED=YES'] + options)
+        if ds is None:
+            gdaltest.post_reason('fail')
+            print(options)
+            return 'fail'
+        for i in range(2):
+            src_band = src_ds.GetRasterBand(i + 1)
+            band = ds.GetRasterBand(i + 1)
+            if band.Checksum() != src_band.Checksum() or \
+               band.GetOverviewCount() != 3 or \
+               band.GetOverview(2).Checksum() != src_band.GetOverview(2).Checksum():
+                gdaltest.post_reason('fail')
+                print(options)
+                return 'fail'
+        mask_band = ds.GetRasterBand(1).GetMaskBand()
+        src_mask_band = src_ds.GetRasterBand(1).GetMaskBand()
+        if ds.GetRasterBand(1).GetMaskFlags() != gdal.GMF_PER_DATASET or \
+           mask_band.Checksum() != src_mask_band.Checksum() or \
+           mask_band.GetOverview(0).Checksum() != src_mask_band.GetOverview(0).Checksum():
+            gdaltest.post_reason('fail')
+            print(options)
+            return 'fail'
+        ds = None
+
+        (errors, warnings) = validate_cloud_optimized_geotiff.validate('/vsimem/tiff_write_145.tif')
+        if len(errors) != 0 or len(warnings) != 0:
+            gdaltest.post_reason('fail')
+            print(options)
+            print(errors)
+            print(warnings)
+            return 'fail'
+
+        if gdal.VSIStatL('/vsimem/tiff_write_145.tif.msk') is not None or \
+           gdal.VSIStatL('/vsimem/tiff_write_145.tif.cog_tmp.tif') is not None:
+            gdaltest.post_reason('fail')
+            print(gdal.ReadDir('/vsimem'))
+            return 'fail'
+
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_145.tif')
+
+    # Not compatible with stripped files
+    with gdaltest.error_handler():
+        ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_145.tif', src_ds,
+                                          options = ['CLOUD_OPTIMIZED=YES', 'TILED=NO'])
+    if ds is not None:
+        gdaltest.post_reason('fail')
+        return 'fail'
+
+    # Regular file with overviews added afterwards
+    ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_145.tif', src_ds)
+    ds.BuildOverviews('NEAR', [2])
+    ds = None
+    (errors, warnings) = validate_cloud_optimized_geotiff.validate('/vsimem/tiff_write_145.tif')
+    if len(errors) == 0:
+        gdaltest.post_reason('fail')
+        return 'fail'
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_145.tif')
+
+    src_band = None
+    src_mask_band = None
+    src_ds = None
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_145_src.tif')
+
+    return 'success'
+
+###############################################################################
+# Test ZSTD compression
+
+def tiff_write_146():
+
+    md = gdaltest.tiff_drv.GetMetadata()
+    if md['DMD_CREATIONOPTIONLIST'].find('ZSTD') == -1:
+        return 'skip'
+
+    ut = gdaltest.GDALTest( 'GTiff', 'byte.tif', 1, 4672,
+                            options = [ 'COMPRESS=ZSTD', 'ZSTD_LEVEL=1' ] )
+    ret = ut.testCreateCopy()
+    if ret != 'success':
+        return ret
+
+    src_ds = gdal.Open('data/utmsmall.tif')
+    expected_cs = src_ds.GetRasterBand(1).Checksum()
+    for options in [ [], ['PREDICTOR=2'], ['ZSTD_LEVEL=22'],
+                     ['NUM_THREADS=ALL_CPUS', 'BLOCKYSIZE=16'] ]:
+        ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_146.tif', src_ds,
+                                          options = ['COMPRESS=ZSTD'] + options)
+        ds = None
+        ds = gdal.Open('/vsimem/tiff_write_146.tif')
+        if ds.GetMetadataItem('COMPRESSION', 'IMAGE_STRUCTURE') != 'ZSTD':
+            gdaltest.post_reason('fail')
+            print(options)
+            return 'fail'
+        cs = ds.GetRasterBand(1).Checksum()
+        ds = None
+        if cs != expected_cs:
+            gdaltest.post_reason('fail')
+            print(options)
+            print(cs)
+            return 'fail'
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_146.tif')
+
+    return 'success'
+
+###############################################################################
+# Test PREDICTOR=2 and PREDICTOR=3 with various data types, numbers of
+# pixel-interleaved bands and widths, so that both the vectorized and the
+# scalar tails of the predictor code are exercised.
+
+def tiff_write_147():
+
+    for (dt, predictor) in [ (gdal.GDT_Byte, 2), (gdal.GDT_UInt16, 2),
+                             (gdal.GDT_UInt32, 2), (gdal.GDT_Float32, 3),
+                             (gdal.GDT_Float64, 3) ]:
+        for nbands in [ 1, 2, 3, 4, 5 ]:
+            for xsize in [ 1, 7, 33, 101 ]:
+                src_ds = gdal.GetDriverByName('MEM').Create('', xsize, 3,
+                                                            nbands, dt)
+                for i in range(nbands):
+                    data = ''.join([ chr((j * 37 + i * 11) % 251) \
+                                     for j in range(xsize * 3) ])
+                    src_ds.GetRasterBand(i+1).WriteRaster(0, 0, xsize, 3,
+                                        data, buf_type = gdal.GDT_Byte)
+                expected_cs = [ src_ds.GetRasterBand(i+1).Checksum() \
+                                for i in range(nbands) ]
+                for tiled in [ 'NO', 'YES' ]:
+                    ds = gdaltest.tiff_drv.CreateCopy(
+                        '/vsimem/tiff_write_147.tif', src_ds,
+                        options = [ 'COMPRESS=DEFLATE',
+                                    'PREDICTOR=%d' % predictor,
+                                    'INTERLEAVE=PIXEL', 'TILED=' + tiled,
+                                    'BLOCKXSIZE=16', 'BLOCKYSIZE=16' ])
+                    ds = None
+                    ds = gdal.Open('/vsimem/tiff_write_147.tif')
+                    cs = [ ds.GetRasterBand(i+1).Checksum() \
+                           for i in range(nbands) ]
+                    ds = None
+                    if cs != expected_cs:
+                        gdaltest.post_reason('fail')
+                        print(dt, predictor, nbands, xsize, tiled)
+                        print(cs)
+                        print(expected_cs)
+                        return 'fail'
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_147.tif')
+
+    return 'success'
+
+###############################################################################
+# Test LERC compression
+
+def tiff_write_148():
+
+    import struct
+
+    md = gdaltest.tiff_drv.GetMetadata()
+    if md['DMD_CREATIONOPTIONLIST'].find('LERC') == -1:
+        return 'skip'
+
+    ut = gdaltest.GDALTest( 'GTiff', 'byte.tif', 1, 4672,
+                            options = [ 'COMPRESS=LERC' ] )
+    ret = ut.testCreateCopy()
+    if ret != 'success':
+        return ret
+
+    src_ds = gdal.Open('data/float32.tif')
+    expected_cs = src_ds.GetRasterBand(1).Checksum()
+    for (compress, options) in [ ('LERC', []),
+                                 ('LERC', ['TILED=YES', 'BLOCKXSIZE=16', 'BLOCKYSIZE=16']),
+                                 ('LERC_DEFLATE', ['ZLEVEL=1']),
+                                 ('LERC_ZSTD', ['ZSTD_LEVEL=1']),
+                                 ('LERC_ZSTD', ['NUM_THREADS=ALL_CPUS', 'BLOCKYSIZE=4']) ]:
+        if compress == 'LERC_DEFLATE' and md['DMD_CREATIONOPTIONLIST'].find('LERC_DEFLATE') == -1:
+            continue
+        if compress == 'LERC_ZSTD' and md['DMD_CREATIONOPTIONLIST'].find('LERC_ZSTD') == -1:
+            continue
+        ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_148.tif', src_ds,
+                                          options = ['COMPRESS=' + compress] + options)
+        ds = None
+        ds = gdal.Open('/vsimem/tiff_write_148.tif')
+        if ds.GetMetadataItem('COMPRESSION', 'IMAGE_STRUCTURE') != compress:
+            gdaltest.post_reason('fail')
+            print(compress, options)
+            return 'fail'
+        cs = ds.GetRasterBand(1).Checksum()
+        ds = None
+        if cs != expected_cs:
+            gdaltest.post_reason('fail')
+            print(compress, options)
+            print(cs)
+            return 'fail'
+
+    # The additional compression is carried over to the overviews, internal
+    # or external
+    ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_148_ref.tif', src_ds)
+    ds.BuildOverviews('NEAR', [2])
+    ds = None
+    ds = gdal.Open('/vsimem/tiff_write_148_ref.tif')
+    expected_ovr_cs = ds.GetRasterBand(1).GetOverview(0).Checksum()
+    ds = None
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_148_ref.tif')
+    for compress in [ 'LERC_DEFLATE', 'LERC_ZSTD' ]:
+        if md['DMD_CREATIONOPTIONLIST'].find(compress) == -1:
+            continue
+        for external in [ False, True ]:
+            if external:
+                ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_148.tif', src_ds)
+                ds = None
+                ds = gdal.Open('/vsimem/tiff_write_148.tif')
+                gdal.SetConfigOption('COMPRESS_OVERVIEW', compress)
+                ds.BuildOverviews('NEAR', [2])
+                gdal.SetConfigOption('COMPRESS_OVERVIEW', None)
+                ovr_filename = '/vsimem/tiff_write_148.tif.ovr'
+            else:
+                ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_148.tif', src_ds,
+                                                  options = ['COMPRESS=' + compress])
+                ds.BuildOverviews('NEAR', [2])
+                ovr_filename = 'GTIFF_DIR:2:/vsimem/tiff_write_148.tif'
+            ds = None
+            ds = gdal.Open(ovr_filename)
+            got_compress = ds.GetMetadataItem('COMPRESSION', 'IMAGE_STRUCTURE')
+            cs = ds.GetRasterBand(1).Checksum()
+            ds = None
+            gdaltest.tiff_drv.Delete('/vsimem/tiff_write_148.tif')
+            if got_compress != compress or cs != expected_ovr_cs:
+                gdaltest.post_reason('fail')
+                print(compress, external, got_compress, cs)
+                return 'fail'
+
+    # Limited error
+    ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_148.tif', src_ds,
+                                      options = ['COMPRESS=LERC', 'MAX_Z_ERROR=1'])
+    ds = None
+    ds = gdal.Open('/vsimem/tiff_write_148.tif')
+    data = struct.unpack('f' * 400, ds.GetRasterBand(1).ReadRaster())
+    ds = None
+    ref_data = struct.unpack('f' * 400, src_ds.GetRasterBand(1).ReadRaster())
+    for i in range(400):
+        if abs(data[i] - ref_data[i]) > 1:
+            gdaltest.post_reason('fail')
+            print(i, data[i], ref_data[i])
+            return 'fail'
+
+    # Several bands cannot be pixel interleaved
+    with gdaltest.error_handler():
+        ds = gdaltest.tiff_drv.Create('/vsimem/tiff_write_148.tif', 5, 7, 2,
+                                      gdal.GDT_Float32,
+                                      options = ['COMPRESS=LERC',
+                                                 'INTERLEAVE=PIXEL'])
+    if ds is not None:
+        gdaltest.post_reason('fail')
+        return 'fail'
+
+    # NaN values, and multi-band data, band interleaved by default, written
+    # by worker threads
+    ds = gdaltest.tiff_drv.Create('/vsimem/tiff_write_148.tif', 5, 7, 2,
+                                  gdal.GDT_Float32,
+                                  options = ['COMPRESS=LERC', 'BLOCKYSIZE=2',
+                                             'NUM_THREADS=4'])
+    ref_data = [ float(i) for i in range(35) ]
+    ref_data[3] = float('nan')
+    for i in range(2):
+        ds.GetRasterBand(i+1).WriteRaster(0, 0, 5, 7,
+                                          struct.pack('f' * 35, *ref_data))
+    ds = None
+    ds = gdal.Open('/vsimem/tiff_write_148.tif')
+    if ds.GetMetadataItem('INTERLEAVE', 'IMAGE_STRUCTURE') != 'BAND':
+        gdaltest.post_reason('fail')
+        return 'fail'
+    for i in range(2):
+        data = struct.unpack('f' * 35, ds.GetRasterBand(i+1).ReadRaster())
+        if not (data[3] != data[3]) or \
+           data[0:3] + data[4:] != tuple(ref_data[0:3] + ref_data[4:]):
+            gdaltest.post_reason('fail')
+            print(data)
+            return 'fail'
+    ds = None
+
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_148.tif')
+
+    return 'success'
+
+###############################################################################
+# Test that CreateCopy() from a GeoTIFF with the same layout and compression
+# copies the compressed tiles, including the ones of the overviews, as they are
+
+def tiff_write_149():
+
+    src_ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_149_src.tif',
+                                          gdal.Open('data/rgbsmall.tif'),
+                                          options = [ 'TILED=YES',
+                                                      'BLOCKXSIZE=16',
+                                                      'BLOCKYSIZE=16',
+                                                      'COMPRESS=DEFLATE',
+                                                      'ZLEVEL=1' ] )
+    src_ds.BuildOverviews('NEAR', [ 2 ])
+    src_ds = None
+    src_ds = gdal.Open('/vsimem/tiff_write_149_src.tif')
+    expected_cs = [ src_ds.GetRasterBand(i+1).Checksum() for i in range(3) ]
+    expected_ovr_cs = src_ds.GetRasterBand(1).GetOverview(0).Checksum()
+
+    # The compression level of the source cannot be known, so tiles
+    # are recompressed when it is asked.
+    for (options, raw_copy) in [ ( [], True ),
+                                 ( [ 'ZLEVEL=9' ], False ),
+                                 ( [ 'INTERLEAVE=BAND' ], False ) ]:
+        ds = gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_149.tif', src_ds,
+                                          options = [ 'TILED=YES',
+                                                      'BLOCKXSIZE=16',
+                                                      'BLOCKYSIZE=16',
+                                                      'COMPRESS=DEFLATE',
+                                                      'COPY_SRC_OVERVIEWS=YES' ] + options )
+        ds = None
+        ds = gdal.Open('/vsimem/tiff_write_149.tif')
+        cs = [ ds.GetRasterBand(i+1).Checksum() for i in range(3) ]
+        ovr_cs = ds.GetRasterBand(1).GetOverview(0).Checksum()
+        if cs != expected_cs or ovr_cs != expected_ovr_cs:
+            gdaltest.post_reason('fail')
+            print(options)
+            print(cs)
+            print(ovr_cs)
+            return 'fail'
+        same_sizes = \
+            ds.GetRasterBand(1).GetMetadataItem('BLOCK_SIZE_1_1', 'TIFF') == \
+            src_ds.GetRasterBand(1).GetMetadataItem('BLOCK_SIZE_1_1', 'TIFF') and \
+            ds.GetRasterBand(1).GetOverview(0).GetMetadataItem('BLOCK_SIZE_0_0', 'TIFF') == \
+            src_ds.GetRasterBand(1).GetOverview(0).GetMetadataItem('BLOCK_SIZE_0_0', 'TIFF')
+        ds = None
+        if same_sizes != raw_copy:
+            gdaltest.post_reason('fail')
+            print(options)
+            return 'fail'
+
+    src_ds = None
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_149.tif')
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_149_src.tif')
+
+    return 'success'
+
+###############################################################################
+# Test multi-threaded JPEG compression and decompression
+
+def tiff_write_150():
+    md = gdaltest.tiff_drv.GetMetadata()
+    if md['DMD_CREATIONOPTIONLIST'].find('JPEG') == -1:
+        return 'skip'
+
+    src_ds = gdal.Open('data/rgbsmall.tif')
+    for options in [ [ 'TILED=YES', 'BLOCKXSIZE=16', 'BLOCKYSIZE=16' ],
+                     [ 'TILED=YES', 'BLOCKXSIZE=16', 'BLOCKYSIZE=16',
+                       'PHOTOMETRIC=YCBCR' ],
+                     [ 'BLOCKYSIZE=16', 'PHOTOMETRIC=YCBCR',
+                       'JPEGTABLESMODE=3' ],
+                     [ 'TILED=YES', 'BLOCKXSIZE=16', 'BLOCKYSIZE=16',
+                       'INTERLEAVE=BAND' ] ]:
+        gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_150_ref.tif', src_ds,
+                                     options = [ 'COMPRESS=JPEG' ] + options)
+        gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_150.tif', src_ds,
+                                     options = [ 'COMPRESS=JPEG',
+                                                 'NUM_THREADS=4' ] + options)
+        ref_ds = gdal.Open('/vsimem/tiff_write_150_ref.tif')
+        expected_cs = [ ref_ds.GetRasterBand(i+1).Checksum() for i in range(3) ]
+        ref_ds = None
+
+        # The tiles may be written in a different order, but must decode
+        # with the JPEG tables of the file to the same values
+        ds = gdal.Open('/vsimem/tiff_write_150.tif')
+        cs = [ ds.GetRasterBand(i+1).Checksum() for i in range(3) ]
+        ds = None
+        ds = gdal.OpenEx('/vsimem/tiff_write_150.tif',
+                         open_options = [ 'NUM_THREADS=4' ])
+        cs_mt = [ ds.GetRasterBand(i+1).Checksum() for i in range(3) ]
+        ds = None
+        if cs != expected_cs or cs_mt != expected_cs:
+            gdaltest.post_reason('fail')
+            print(options)
+            print(expected_cs)
+            print(cs)
+            print(cs_mt)
+            return 'fail'
+
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_150.tif')
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_150_ref.tif')
+
+    return 'success'
+
+###############################################################################
+# Test that SPARSE_OK=YES does not write blocks that only contain nodata,
+# and that windows overlapping missing blocks are correctly read
+
+def tiff_write_151():
+
+    import struct
+
+    ds = gdaltest.tiff_drv.Create('/vsimem/tiff_write_151_src.tif', 64, 64,
+                                  options = [ 'TILED=YES', 'BLOCKXSIZE=16',
+                                              'BLOCKYSIZE=16', 'SPARSE_OK=YES' ])
+    ds.SetGeoTransform([0, 1, 0, 64, 0, -1])
+    ds.GetRasterBand(1).SetNoDataValue(255)
+    # Block (0,0) only contains nodata: must not be written
+    ds.GetRasterBand(1).WriteRaster(0, 0, 16, 16, struct.pack('B', 255) * 256)
+    ds.GetRasterBand(1).WriteRaster(16, 16, 16, 16, struct.pack('B', 10) * 256)
+    ds = None
+
+    ds = gdal.Open('/vsimem/tiff_write_151_src.tif')
+    if ds.GetRasterBand(1).GetMetadataItem('BLOCK_OFFSET_0_0', 'TIFF') is not None or \
+       ds.GetRasterBand(1).GetMetadataItem('BLOCK_OFFSET_1_1', 'TIFF') is None:
+        gdaltest.post_reason('fail')
+        return 'fail'
+    data = struct.unpack('B' * (40 * 40),
+                         ds.GetRasterBand(1).ReadRaster(4, 4, 40, 40))
+    for j in range(40):
+        for i in range(40):
+            if 12 <= i < 28 and 12 <= j < 28:
+                expected = 10
+            else:
+                expected = 255
+            if data[j * 40 + i] != expected:
+                gdaltest.post_reason('fail')
+                print(i, j, data[j * 40 + i])
+                return 'fail'
+    data = ds.ReadRaster(0, 0, 16, 16)
+    if data != struct.pack('B', 255) * 256:
+        gdaltest.post_reason('fail')
+        return 'fail'
+    expected_cs = ds.GetRasterBand(1).Checksum()
+    ds = None
+
+    # The missing blocks of the source are not written in the copy
+    src_ds = gdal.Open('/vsimem/tiff_write_151_src.tif')
+    gdaltest.tiff_drv.CreateCopy('/vsimem/tiff_write_151.tif', src_ds,
+                                 options = [ 'TILED=YES', 'BLOCKXSIZE=16',
+                                             'BLOCKYSIZE=16', 'SPARSE_OK=YES' ])
+    ds = gdal.Open('/vsimem/tiff_write_151.tif')
+    for y in range(4):
+        for x in range(4):
+            has_block = ds.GetRasterBand(1).GetMetadataItem(
+                'BLOCK_OFFSET_%d_%d' % (x, y), 'TIFF') is not None
+            if has_block != (x == 1 and y == 1):
+                gdaltest.post_reason('fail')
+                print(x, y)
+                return 'fail'
+    if ds.GetRasterBand(1).Checksum() != expected_cs:
+        gdaltest.post_reason('fail')
+        return 'fail'
+    ds = None
+
+    # Same with the nodata areas of a warped output
+    gdal.Warp('/vsimem/tiff_write_151.tif', src_ds,
+              outputBounds = [0, 0, 128, 64],
+              creationOptions = [ 'TILED=YES', 'BLOCKXSIZE=16',
+                                  'BLOCKYSIZE=16', 'SPARSE_OK=YES' ])
+    ds = gdal.Open('/vsimem/tiff_write_151.tif')
+    if ds.GetRasterBand(1).GetMetadataItem('BLOCK_OFFSET_1_1', 'TIFF') is None:
+        gdaltest.post_reason('fail')
+        return 'fail'
+    for y in range(4):
+        for x in range(4, 8):
+            if ds.GetRasterBand(1).GetMetadataItem(
+                    'BLOCK_OFFSET_%d_%d' % (x, y), 'TIFF') is not None:
+                gdaltest.post_reason('fail')
+                print(x, y)
+                return 'fail'
+    if ds.GetRasterBand(1).Checksum() == 0 or \
+       ds.ReadRaster(64, 0, 64, 64) != struct.pack('B', 255) * (64 * 64):
+        gdaltest.post_reason('fail')
+        return 'fail'
+    ds = None
+    src_ds = None
+
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_151_src.tif')
+    gdaltest.tiff_drv.Delete('/vsimem/tiff_write_151.tif')
+
+    return 'success'
+
 ###############################################################################
 # Ask to run again tests with GDAL_API_PROXY=YES
 
@@ -6615,6 +7114,13 @@ gdaltest_list = [
     tiff_write_142,
     tiff_write_143,
     tiff_write_144,
+    tiff_write_145,
+    tiff_write_146,
+    tiff_write_147,
+    tiff_write_148,
+    tiff_write_149,
+    tiff_write_150,
+    tiff_write_151,
     #tiff_write_api_proxy,
     tiff_write_cleanup ]
 
@@ -341,6 +341,377 @@ def vsicurl_test_redirect():
 
     return 'success'
 
+###############################################################################
+# Test reads with a RAM cache smaller than the file, so that the least
+# recently used regions get evicted and downloaded again
+
+def vsicurl_test_cache_eviction():
+
+    if gdaltest.webserver_port == 0:
+        return 'skip'
+
+    # Exactly 4 chunks of 16 KB: the cache also accounts for its own
+    # structures, so large reads must be split in less than 4 chunks
+    gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_SIZE', '%d' % (4 * 16384))
+
+    ret = 'success'
+    # Also test without parallel downloads, so that large reads go through
+    # the cache
+    for multirange in [ None, 'SINGLE_GET' ]:
+        gdal.SetConfigOption('GDAL_HTTP_MULTIRANGE', multirange)
+        filename = '/vsicurl/http://localhost:%d/test_ranges/test_cache_eviction_%s.bin' % (gdaltest.webserver_port, str(multirange))
+        f = gdal.VSIFOpenL(filename, 'rb')
+        if f is None:
+            gdaltest.post_reason('fail')
+            ret = 'fail'
+            break
+
+        for (offset, size) in [ (0, 100), (500000, 20000), (16380, 10),
+                                (100000, 200000), (0, 100), (999990, 10),
+                                (500000, 20000) ]:
+            gdal.VSIFSeekL(f, offset, 0)
+            data = gdal.VSIFReadL(1, size, f)
+            if data != webserver.test_ranges_content(offset, offset + size - 1):
+                gdaltest.post_reason('fail')
+                print(multirange, offset, size, len(data))
+                ret = 'fail'
+                break
+
+        gdal.VSIFCloseL(f)
+        if ret != 'success':
+            break
+
+    gdal.SetConfigOption('GDAL_HTTP_MULTIRANGE', None)
+    gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_SIZE', None)
+
+    return ret
+
+###############################################################################
+# Test large reads, which are split in ranges downloaded in parallel
+
+def vsicurl_test_parallel_read():
+
+    if gdaltest.webserver_port == 0:
+        return 'skip'
+
+    filename = '/vsicurl/http://localhost:%d/test_ranges/test_parallel_read.bin' % gdaltest.webserver_port
+    gdal.SetConfigOption('CPL_VSIL_CURL_MAX_CONNECTIONS', '3')
+    f = gdal.VSIFOpenL(filename, 'rb')
+    if f is None:
+        gdal.SetConfigOption('CPL_VSIL_CURL_MAX_CONNECTIONS', None)
+        gdaltest.post_reason('fail')
+        return 'fail'
+
+    ret = 'success'
+    for (offset, size, expected_size) in [ (100000, 600000, 600000),
+                                           (0, 1000000, 1000000),
+                                           (900000, 600000, 100000) ]:
+        gdal.VSIFSeekL(f, offset, 0)
+        data = gdal.VSIFReadL(1, size, f)
+        if data != webserver.test_ranges_content(offset, offset + expected_size - 1):
+            gdaltest.post_reason('fail')
+            print(offset, size, len(data))
+            ret = 'fail'
+            break
+
+    gdal.VSIFCloseL(f)
+    gdal.SetConfigOption('CPL_VSIL_CURL_MAX_CONNECTIONS', None)
+
+    return ret
+
+###############################################################################
+# Test sequential reads served by the background read-ahead, interleaved
+# with a random read
+
+def vsicurl_test_read_ahead():
+
+    if gdaltest.webserver_port == 0:
+        return 'skip'
+
+    filename = '/vsicurl/http://localhost:%d/test_ranges/test_read_ahead.bin' % gdaltest.webserver_port
+    f = gdal.VSIFOpenL(filename, 'rb')
+    if f is None:
+        gdaltest.post_reason('fail')
+        return 'fail'
+
+    offset = 0
+    while offset < 1000000:
+        if offset == 300000:
+            gdal.VSIFSeekL(f, 900000, 0)
+            data = gdal.VSIFReadL(1, 100, f)
+            if data != webserver.test_ranges_content(900000, 900099):
+                gdaltest.post_reason('fail')
+                gdal.VSIFCloseL(f)
+                return 'fail'
+            gdal.VSIFSeekL(f, offset, 0)
+        data = gdal.VSIFReadL(1, 10000, f)
+        if data != webserver.test_ranges_content(offset, offset + 9999):
+            gdaltest.post_reason('fail')
+            print(offset, len(data))
+            gdal.VSIFCloseL(f)
+            return 'fail'
+        offset += 10000
+
+    if len(gdal.VSIFReadL(1, 1, f)) != 0:
+        gdaltest.post_reason('fail')
+        gdal.VSIFCloseL(f)
+        return 'fail'
+
+    gdal.VSIFCloseL(f)
+
+    return 'success'
+
+###############################################################################
+# Test the persistent on-disk cache of chunks
+
+def vsicurl_test_disk_cache():
+
+    if gdaltest.webserver_port == 0:
+        return 'skip'
+
+    import os
+    import shutil
+
+    cache_dir = 'tmp/vsicurl_disk_cache'
+    try:
+        shutil.rmtree(cache_dir)
+    except:
+        pass
+
+    def cache_files():
+        files = []
+        for subdir in os.listdir(cache_dir):
+            if len(subdir) == 2:
+                files += [ os.path.join(cache_dir, subdir, f) for f in os.listdir(os.path.join(cache_dir, subdir)) ]
+        return files
+
+    filename = '/vsicurl/http://localhost:%d/test_ranges/test_disk_cache.bin' % gdaltest.webserver_port
+    gdal.SetConfigOption('CPL_VSIL_CURL_USE_CACHE', 'YES')
+    gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_DIR', cache_dir)
+    # RAM cache of 2 chunks of 16 KB, so that the chunks are read back from disk
+    gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_SIZE', '%d' % (2 * 16384 + 1000))
+
+    ret = 'success'
+    f = gdal.VSIFOpenL(filename, 'rb')
+    if f is None:
+        gdaltest.post_reason('fail')
+        ret = 'fail'
+    else:
+        for (offset, size) in [ (0, 100), (500000, 100), (200000, 100),
+                                (0, 100), (500000, 100), (999990, 10) ]:
+            gdal.VSIFSeekL(f, offset, 0)
+            data = gdal.VSIFReadL(1, size, f)
+            if data != webserver.test_ranges_content(offset, offset + size - 1):
+                gdaltest.post_reason('fail')
+                print(offset, size, len(data))
+                ret = 'fail'
+                break
+        gdal.VSIFCloseL(f)
+
+    if ret == 'success' and len(cache_files()) != 4:
+        gdaltest.post_reason('fail')
+        print(cache_files())
+        ret = 'fail'
+
+    # Shrink the on-disk cache so that the least recently used files are removed
+    if ret == 'success':
+        gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_DIR_SIZE', '%d' % (3 * 16500))
+        f = gdal.VSIFOpenL(filename, 'rb')
+        for offset in [ 300000, 400000, 600000 ]:
+            gdal.VSIFSeekL(f, offset, 0)
+            gdal.VSIFReadL(1, 100, f)
+        gdal.VSIFCloseL(f)
+        total_size = sum([ os.stat(x).st_size for x in cache_files() ])
+        if total_size > 3 * 16500:
+            gdaltest.post_reason('fail')
+            print(total_size)
+            ret = 'fail'
+
+    gdal.SetConfigOption('CPL_VSIL_CURL_USE_CACHE', None)
+    gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_DIR', None)
+    gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_SIZE', None)
+    gdal.SetConfigOption('CPL_VSIL_CURL_CACHE_DIR_SIZE', None)
+    try:
+        shutil.rmtree(cache_dir)
+    except:
+        pass
+
+    return ret
+
+###############################################################################
+# Test that the default directory of the on-disk cache is a per-user one in
+# the directory of the temporary files
+
+def vsicurl_test_disk_cache_default_dir():
+
+    if gdaltest.webserver_port == 0:
+        return 'skip'
+
+    import os
+    import shutil
+
+    if not hasattr(os, 'getuid'):
+        return 'skip'
+
+    tmp_dir = 'tmp/vsicurl_tmpdir'
+    try:
+        shutil.rmtree(tmp_dir)
+    except:
+        pass
+    os.mkdir(tmp_dir)
+
+    filename = '/vsicurl/http://localhost:%d/test_ranges/test_disk_cache_default_dir.bin' % gdaltest.webserver_port
+    gdal.SetConfigOption('CPL_VSIL_CURL_USE_CACHE', 'YES')
+    gdal.SetConfigOption('CPL_TMPDIR', tmp_dir)
+
+    ret = 'success'
+    f = gdal.VSIFOpenL(filename, 'rb')
+    if f is None:
+        gdaltest.post_reason('fail')
+        ret = 'fail'
+    else:
+        data = gdal.VSIFReadL(1, 100, f)
+        gdal.VSIFCloseL(f)
+        if data != webserver.test_ranges_content(0, 99):
+            gdaltest.post_reason('fail')
+            ret = 'fail'
+
+    cache_dir = os.path.join(tmp_dir, 'gdal_vsicurl_cache_%d' % os.getuid())
+    if ret == 'success' and not os.path.isdir(cache_dir):
+        gdaltest.post_reason('fail')
+        print(os.listdir(tmp_dir))
+        ret = 'fail'
+
+    gdal.SetConfigOption('CPL_VSIL_CURL_USE_CACHE', None)
+    gdal.SetConfigOption('CPL_TMPDIR', None)
+    try:
+        shutil.rmtree(tmp_dir)
+    except:
+        pass
+
+    return ret
+
+###############################################################################
+# Test VSIFPReadL(), which is not bound to SWIG, through ctypes
+
+def vsicurl_test_pread():
+
+    if gdaltest.webserver_port == 0:
+        return 'skip'
+
+    try:
+        import ctypes
+        import threading
+        name = gdaltest.find_lib('gdal')
+        if name is None:
+            return 'skip'
+        gdal_handle = ctypes.cdll.LoadLibrary(name)
+    except:
+        return 'skip'
+
+    gdal_handle.VSIFOpenL.argtypes = [ ctypes.c_char_p, ctypes.c_char_p ]
+    gdal_handle.VSIFOpenL.restype = ctypes.c_void_p
+    gdal_handle.VSIFCloseL.argtypes = [ ctypes.c_void_p ]
+    gdal_handle.VSIFCloseL.restype = ctypes.c_int
+    gdal_handle.VSIFSeekL.argtypes = [ ctypes.c_void_p, ctypes.c_uint64, ctypes.c_int ]
+    gdal_handle.VSIFSeekL.restype = ctypes.c_int
+    gdal_handle.VSIFReadL.argtypes = [ ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t, ctypes.c_void_p ]
+    gdal_handle.VSIFReadL.restype = ctypes.c_size_t
+    gdal_handle.VSIFPReadL.argtypes = [ ctypes.c_void_p, ctypes.c_size_t, ctypes.c_uint64, ctypes.c_void_p ]
+    gdal_handle.VSIFPReadL.restype = ctypes.c_size_t
+
+    def pread(f, offset, size):
+        buf = ctypes.create_string_buffer(size)
+        nread = gdal_handle.VSIFPReadL(buf, size, offset, f)
+        return buf.raw[0:nread]
+
+    filename = '/vsicurl/http://localhost:%d/test_ranges/test_pread.bin' % gdaltest.webserver_port
+    f = gdal_handle.VSIFOpenL(filename.encode('ascii'), 'rb'.encode('ascii'))
+    if f is None:
+        gdaltest.post_reason('fail')
+        return 'fail'
+
+    # Range already in the region cache
+    buf = ctypes.create_string_buffer(1000)
+    gdal_handle.VSIFSeekL(f, 200000, 0)
+    if gdal_handle.VSIFReadL(buf, 1, 1000, f) != 1000:
+        gdaltest.post_reason('fail')
+        gdal_handle.VSIFCloseL(f)
+        return 'fail'
+    # Ranges partially cached, not cached, crossing and beyond the end of file
+    for (offset, size, expected_size) in [ (200100, 500, 500),
+                                           (199000, 3000, 3000),
+                                           (500000, 100000, 100000),
+                                           (999000, 2000, 1000),
+                                           (1000000, 10, 0),
+                                           (2000000, 10, 0) ]:
+        data = pread(f, offset, size)
+        if data != webserver.test_ranges_content(offset, offset + expected_size - 1):
+            gdaltest.post_reason('fail')
+            print(offset, size, len(data))
+            gdal_handle.VSIFCloseL(f)
+            return 'fail'
+
+    # The file position is not affected
+    gdal_handle.VSIFReadL(buf, 1, 10, f)
+    if buf.raw[0:10] != webserver.test_ranges_content(201000, 201009):
+        gdaltest.post_reason('fail')
+        gdal_handle.VSIFCloseL(f)
+        return 'fail'
+
+    # Several threads issuing requests on the same handle at the same time
+    errors = []
+    def reader(thread_id):
+        for i in range(20):
+            offset = (thread_id * 7919 + i * 48611) % 990000
+            size = 1000 + (i * 3001) % 9000
+            if pread(f, offset, size) != webserver.test_ranges_content(offset, offset + size - 1):
+                errors.append((thread_id, offset, size))
+
+    threads = [ threading.Thread(target = reader, args = (i,)) for i in range(4) ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    gdal_handle.VSIFCloseL(f)
+
+    if len(errors) != 0:
+        gdaltest.post_reason('fail')
+        print(errors)
+        return 'fail'
+
+    # Sequential reads, which start a read-ahead in the background,
+    # immediately followed by concurrent PRead() calls
+    filename = '/vsicurl/http://localhost:%d/test_ranges/test_pread_after_read.bin' % gdaltest.webserver_port
+    f = gdal_handle.VSIFOpenL(filename.encode('ascii'), 'rb'.encode('ascii'))
+    if f is None:
+        gdaltest.post_reason('fail')
+        return 'fail'
+    buf = ctypes.create_string_buffer(10000)
+    for i in range(20):
+        if gdal_handle.VSIFReadL(buf, 1, 10000, f) != 10000 or \
+           buf.raw != webserver.test_ranges_content(i * 10000, i * 10000 + 9999):
+            gdaltest.post_reason('fail')
+            print(i)
+            gdal_handle.VSIFCloseL(f)
+            return 'fail'
+
+    threads = [ threading.Thread(target = reader, args = (i,)) for i in range(4) ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    gdal_handle.VSIFCloseL(f)
+
+    if len(errors) != 0:
+        gdaltest.post_reason('fail')
+        print(errors)
+        return 'fail'
+
+    return 'success'
+
 ###############################################################################
 def vsicurl_stop_webserver():
 
@@ -364,6 +735,12 @@ gdaltest_list = [ vsicurl_1,
                   vsicurl_11,
                   vsicurl_start_webserver,
                   vsicurl_test_redirect,
+                  vsicurl_test_cache_eviction,
+                  vsicurl_test_parallel_read,
+                  vsicurl_test_read_ahead,
+                  vsicurl_test_disk_cache,
+                  vsicurl_test_disk_cache_default_dir,
+                  vsicurl_test_pread,
                   vsicurl_stop_webserver ]
 
 if __name__ == '__main__':
@@ -531,6 +531,97 @@ abc***NEWFILE***:""")
 
     return 'success'
 
+###############################################################################
+# Test the persistent seek index of /vsigzip/
+
+def vsifile_11():
+
+    gdal.Unlink('tmp/vsifile_11.txt.gz.idx')
+
+    lines = [ '%d,%d,%s\n' % (i, (i * 7919) % 1000003, 'x' * (i % 37)) for i in range(100000) ]
+    data = ''.join(lines)
+    f = gdal.VSIFOpenL('/vsigzip/tmp/vsifile_11.txt.gz', 'wb')
+    gdal.VSIFWriteL(data, 1, len(data), f)
+    gdal.VSIFCloseL(f)
+
+    offsets = [ (i * 104729) % (len(data) - 100) for i in range(50) ]
+
+    gdal.SetConfigOption('CPL_VSIL_GZIP_INDEX_MIN_SIZE', '0')
+    gdal.SetConfigOption('CPL_VSIL_GZIP_INDEX_SPAN', '65536')
+    ret = 'success'
+    for iter in range(3):
+        f = gdal.VSIFOpenL('/vsigzip/tmp/vsifile_11.txt.gz', 'rb')
+        for offset in offsets:
+            gdal.VSIFSeekL(f, offset, 0)
+            got = gdal.VSIFReadL(1, 100, f).decode('ascii')
+            if got != data[offset:offset+100]:
+                gdaltest.post_reason('fail')
+                print(iter, offset)
+                ret = 'fail'
+                break
+        gdal.VSIFCloseL(f)
+
+        # Open another .gz file so that the cached handle on
+        # vsifile_11.txt.gz is released, and the index saved
+        f = gdal.VSIFOpenL('/vsigzip/data/byte.tif.gz', 'rb')
+        gdal.VSIFCloseL(f)
+
+        if ret == 'success' and gdal.VSIStatL('tmp/vsifile_11.txt.gz.idx') is None:
+            gdaltest.post_reason('fail')
+            ret = 'fail'
+        if ret != 'success':
+            break
+
+        if iter == 1:
+            # Corrupt the index: it must be ignored
+            f = gdal.VSIFOpenL('tmp/vsifile_11.txt.gz.idx', 'rb+')
+            gdal.VSIFWriteL('XXXX', 1, 4, f)
+            gdal.VSIFCloseL(f)
+
+    gdal.SetConfigOption('CPL_VSIL_GZIP_INDEX_MIN_SIZE', None)
+    gdal.SetConfigOption('CPL_VSIL_GZIP_INDEX_SPAN', None)
+
+    gdal.Unlink('tmp/vsifile_11.txt.gz')
+    gdal.Unlink('tmp/vsifile_11.txt.gz.idx')
+
+    return ret
+
+###############################################################################
+# Test the multi-threaded deflate writer of /vsigzip/ and /vsizip/
+
+def vsifile_12():
+
+    lines = [ '%d,%d,%s\n' % (i, (i * 7919) % 1000003, 'x' * (i % 37)) for i in range(30000) ]
+    data = ''.join(lines)
+
+    gdal.SetConfigOption('GDAL_NUM_THREADS', '4')
+    gdal.SetConfigOption('CPL_VSIL_DEFLATE_CHUNK_SIZE', '65536')
+    for filename in [ '/vsigzip//vsimem/vsifile_12.gz',
+                      '/vsizip//vsimem/vsifile_12.zip/test.txt' ]:
+        f = gdal.VSIFOpenL(filename, 'wb')
+        # Write by pieces not aligned on the chunk size
+        for i in range(0, len(data), 10000):
+            gdal.VSIFWriteL(data[i:i+10000], 1, len(data[i:i+10000]), f)
+        gdal.VSIFCloseL(f)
+    gdal.SetConfigOption('GDAL_NUM_THREADS', None)
+    gdal.SetConfigOption('CPL_VSIL_DEFLATE_CHUNK_SIZE', None)
+
+    ret = 'success'
+    for filename in [ '/vsigzip//vsimem/vsifile_12.gz',
+                      '/vsizip//vsimem/vsifile_12.zip/test.txt' ]:
+        f = gdal.VSIFOpenL(filename, 'rb')
+        got = gdal.VSIFReadL(1, len(data) + 1, f).decode('ascii')
+        gdal.VSIFCloseL(f)
+        if got != data:
+            gdaltest.post_reason('fail')
+            print(filename)
+            ret = 'fail'
+
+    gdal.Unlink('/vsimem/vsifile_12.gz')
+    gdal.Unlink('/vsimem/vsifile_12.zip')
+
+    return ret
+
 gdaltest_list = [ vsifile_1,
                   vsifile_2,
                   vsifile_3,
@@ -540,7 +631,9 @@ gdaltest_list = [ vsifile_1,
                   vsifile_7,
                   vsifile_8,
                   vsifile_9,
-                  vsifile_10 ]
+                  vsifile_10,
+                  vsifile_11,
+                  vsifile_12 ]
 
 if __name__ == '__main__':
 
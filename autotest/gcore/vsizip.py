@@ -515,6 +515,100 @@ def vsizip_13():
     return 'success'
 
 
+###############################################################################
+# Test reading many members, including stored ones, from the same archive
+
+def vsizip_14():
+
+    try:
+        import zipfile
+        import io
+    except:
+        return 'skip'
+
+    bio = io.BytesIO()
+    zf = zipfile.ZipFile(bio, 'w')
+    for i in range(200):
+        data = ('%05d' % i) * (100 + i)
+        if i % 2 == 0:
+            zf.writestr(zipfile.ZipInfo('subdir/stored_%d.bin' % i), data)
+        else:
+            info = zipfile.ZipInfo('subdir/deflated_%d.bin' % i)
+            info.compress_type = zipfile.ZIP_DEFLATED
+            zf.writestr(info, data)
+    zf.close()
+    gdal.FileFromMemBuffer('/vsimem/vsizip_14.zip', bio.getvalue())
+
+    if len(gdal.ReadDir('/vsizip/vsimem/vsizip_14.zip/subdir')) != 200:
+        gdaltest.post_reason('fail')
+        print(gdal.ReadDir('/vsizip/vsimem/vsizip_14.zip/subdir'))
+        return 'fail'
+
+    # Open twice each member so that the cached entry location is used
+    for iter in range(2):
+        for i in [ 198, 3, 0, 57, 100, 199 ]:
+            if i % 2 == 0:
+                filename = '/vsizip/vsimem/vsizip_14.zip/subdir/stored_%d.bin' % i
+            else:
+                filename = '/vsizip/vsimem/vsizip_14.zip/subdir/deflated_%d.bin' % i
+            expected = ('%05d' % i) * (100 + i)
+            if gdal.VSIStatL(filename).size != len(expected):
+                gdaltest.post_reason('fail')
+                return 'fail'
+            f = gdal.VSIFOpenL(filename, 'rb')
+            if f is None:
+                gdaltest.post_reason('fail')
+                return 'fail'
+            # Random access
+            for off in [ 5 * (50 + i), 0, len(expected) - 5 ]:
+                gdal.VSIFSeekL(f, off, 0)
+                data = gdal.VSIFReadL(1, 5, f).decode('ascii')
+                if data != expected[off:off+5]:
+                    gdaltest.post_reason('fail')
+                    print(i, off, data)
+                    gdal.VSIFCloseL(f)
+                    return 'fail'
+            # Reading past the end of the member must not leak the next one
+            gdal.VSIFSeekL(f, len(expected) - 3, 0)
+            data = gdal.VSIFReadL(1, 10, f).decode('ascii')
+            if data != expected[-3:]:
+                gdaltest.post_reason('fail')
+                print(i, data)
+                gdal.VSIFCloseL(f)
+                return 'fail'
+            gdal.VSIFSeekL(f, 0, 2)
+            if gdal.VSIFTellL(f) != len(expected):
+                gdaltest.post_reason('fail')
+                gdal.VSIFCloseL(f)
+                return 'fail'
+            gdal.VSIFCloseL(f)
+
+    # Check that a tiny cache does not prevent from reading
+    gdal.FileFromMemBuffer('/vsimem/vsizip_14_bis.zip', bio.getvalue())
+    gdal.SetConfigOption('CPL_VSIL_ARCHIVE_CACHE_SIZE', '1')
+    for filename in [ '/vsizip/vsimem/vsizip_14_bis.zip/subdir/stored_2.bin',
+                      '/vsizip/vsimem/vsizip_14.zip/subdir/stored_4.bin',
+                      '/vsizip/vsimem/vsizip_14_bis.zip/subdir/deflated_5.bin' ]:
+        f = gdal.VSIFOpenL(filename, 'rb')
+        if f is None:
+            gdaltest.post_reason('fail')
+            gdal.SetConfigOption('CPL_VSIL_ARCHIVE_CACHE_SIZE', None)
+            return 'fail'
+        data = gdal.VSIFReadL(1, 5, f).decode('ascii')
+        gdal.VSIFCloseL(f)
+        if data != '0000' + filename[-5]:
+            gdaltest.post_reason('fail')
+            print(filename, data)
+            gdal.SetConfigOption('CPL_VSIL_ARCHIVE_CACHE_SIZE', None)
+            return 'fail'
+    gdal.SetConfigOption('CPL_VSIL_ARCHIVE_CACHE_SIZE', None)
+
+    gdal.Unlink('/vsimem/vsizip_14.zip')
+    gdal.Unlink('/vsimem/vsizip_14_bis.zip')
+
+    return 'success'
+
+
 gdaltest_list = [ vsizip_1,
                   vsizip_2,
                   vsizip_3,
@@ -528,6 +622,7 @@ gdaltest_list = [ vsizip_1,
                   vsizip_11,
                   vsizip_12,
                   vsizip_13,
+                  vsizip_14,
                   ]
 
 
@@ -44,17 +44,57 @@ do_log = False
 
 TIME_SKEW = 30 * 60
 
+TEST_RANGES_FILE_SIZE = 1000000
+
+# Content of the /test_ranges/ files: byte i is i % 251
+def test_ranges_content(start, end):
+    return bytearray([i % 251 for i in range(start, end + 1)])
+
 class GDAL_Handler(BaseHTTPRequestHandler):
 
     def log_request(self, code='-', size='-'):
         return
 
+    # Serve a file of TEST_RANGES_FILE_SIZE bytes, honouring Range requests
+    def send_test_ranges_file(self, send_body = True):
+        self.protocol_version = 'HTTP/1.1'
+        start = 0
+        end = TEST_RANGES_FILE_SIZE - 1
+        if 'Range' in self.headers:
+            rng = self.headers['Range'][len('bytes='):].split('-')
+            start = int(rng[0])
+            if rng[1] != '':
+                end = min(int(rng[1]), end)
+            if start > end:
+                self.send_response(416)
+                self.send_header('Content-Length', 0)
+                self.send_header('Connection', 'close')
+                self.end_headers()
+                return
+            self.send_response(206)
+            self.send_header('Content-Range', 'bytes %d-%d/%d' % (start, end, TEST_RANGES_FILE_SIZE))
+        else:
+            self.send_response(200)
+        self.send_header('Content-type', 'application/octet-stream')
+        self.send_header('Content-Length', end - start + 1)
+        self.send_header('ETag', '"test_ranges_%d"' % TEST_RANGES_FILE_SIZE)
+        # The server closes the connection after each request: say it, so
+        # that clients do not try to reuse it
+        self.send_header('Connection', 'close')
+        self.end_headers()
+        if send_body:
+            self.wfile.write(test_ranges_content(start, end))
+
     def do_HEAD(self):
         if do_log:
             f = open('/tmp/log.txt', 'a')
             f.write('HEAD %s\n' % self.path)
             f.close()
 
+        if self.path.startswith('/test_ranges/'):
+            self.send_test_ranges_file(send_body = False)
+            return
+
         if self.path == '/s3_fake_bucket/resource2.bin':
             self.send_response(200)
             self.send_header('Content-type', 'text/plain')
@@ -321,6 +361,10 @@ class GDAL_Handler(BaseHTTPRequestHandler):
                 self.server.stop_requested = True
                 return
 
+            if self.path.startswith('/test_ranges/'):
+                self.send_test_ranges_file()
+                return
+
             # First signed URL
             if self.path.startswith('/foo.s3.amazonaws.com/test_redirected/test.bin?Signature=foo&Expires='):
                 if 'Range' in self.headers:
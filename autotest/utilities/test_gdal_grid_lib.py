@@ -30,6 +30,7 @@
 ###############################################################################
 
 import sys
+import math
 import struct
 
 sys.path.append( '../pymod' )
@@ -133,6 +134,188 @@ def test_gdal_grid_lib_2():
 
     return 'success'
 
+###############################################################################
+# Test that the point index used by algorithms with a search ellipse gives the
+# same results as a scan of all points, inside and outside the point extent
+
+def test_gdal_grid_lib_3():
+
+    # Pseudo-random points from a linear congruential generator
+    points = []
+    seed = 1
+    for i in range(500):
+        coords = []
+        for k in range(3):
+            seed = (seed * 1103515245 + 12345) % 2147483648
+            coords.append(seed / 2147483648.0)
+        points.append( (coords[0] * 100, coords[1] * 50, coords[2] * 100) )
+
+    shape_ds = ogr.Open( '/vsimem/tmp', update = 1 )
+    shape_lyr = shape_ds.CreateLayer( 'test_gdal_grid_lib_3' )
+    for (x, y, z) in points:
+        dst_feat = ogr.Feature( feature_def = shape_lyr.GetLayerDefn() )
+        dst_feat.SetGeometry(ogr.CreateGeometryFromWkt('POINT(%.18g %.18g %.18g)' % (x, y, z)))
+        shape_lyr.CreateFeature( dst_feat )
+    shape_ds = None
+
+    def nearest(x0, y0):
+        best = None
+        for (x, y, z) in points:
+            r2 = (x - x0) * (x - x0) + (y - y0) * (y - y0)
+            if best is None or r2 <= best:
+                best = r2
+                best_z = z
+        return best_z
+
+    def in_ellipse(x, y, x0, y0):
+        # radius1=8, radius2=3, angle=30
+        dx = x - x0
+        dy = y - y0
+        c = math.cos(math.radians(30))
+        s = math.sin(math.radians(30))
+        rx = dx * c + dy * s
+        ry = dy * c - dx * s
+        return rx * rx / 64.0 + ry * ry / 9.0 <= 1.0
+
+    def average(x0, y0):
+        values = [ z for (x, y, z) in points if in_ellipse(x, y, x0, y0) ]
+        if len(values) == 0:
+            return -1
+        return sum(values) / len(values)
+
+    def count(x0, y0):
+        return len([ 1 for (x, y, z) in points if in_ellipse(x, y, x0, y0) ])
+
+    ellipse = 'radius1=8:radius2=3:angle=30:nodata=-1'
+    for (algorithm, func) in [ ('nearest', nearest),
+                               ('average:' + ellipse, average),
+                               ('count:' + ellipse, count) ]:
+        ds = gdal.Grid('', '/vsimem/tmp/test_gdal_grid_lib_3.shp', format = 'MEM', \
+                       outputBounds = [ -20, -10, 120, 60 ], \
+                       width = 28, height = 14, outputType = gdal.GDT_Float64, \
+                       algorithm = algorithm)
+        data = struct.unpack('d' * 28 * 14, ds.ReadRaster(0, 0, 28, 14))
+        ds = None
+        for j in range(14):
+            for i in range(28):
+                expected = func(-20 + (i + .5) * 5, -10 + (j + .5) * 5)
+                got = data[j * 28 + i]
+                if abs(got - expected) > 1e-8:
+                    gdaltest.post_reason('fail')
+                    print(algorithm, i, j, got, expected)
+                    return 'fail'
+
+    return 'success'
+
+###############################################################################
+# Test streaming mode against the in-memory one
+
+def test_gdal_grid_lib_4():
+
+    # Uses the points of test_gdal_grid_lib_3
+    src = '/vsimem/tmp/test_gdal_grid_lib_3.shp'
+    common = '-txe -20 120 -tye -10 60 -outsize 70 35 -ot Float64 '
+    for algorithm in [ 'invdist:power=2:radius1=10:radius2=6:angle=20:max_points=5',
+                       'nearest:radius1=4:radius2=4:nodata=-1',
+                       'average:radius1=8:radius2=3:angle=30:nodata=-1',
+                       'count:radius1=5:radius2=5',
+                       'average_distance_pts:radius1=6:radius2=6',
+                       'invdistnn:power=2:radius=6:max_points=4' ]:
+        ds = gdal.Grid('', src, options = '-of MEM ' + common + '-a ' + algorithm)
+        ref_data = struct.unpack('d' * 70 * 35, ds.ReadRaster(0, 0, 70, 35))
+        ds = None
+
+        ds = gdal.Grid('/vsimem/test_gdal_grid_lib_4.tif', src, \
+                       options = common + '-a ' + algorithm + \
+                       ' -co TILED=YES -co BLOCKXSIZE=16 -co BLOCKYSIZE=16 -stream_tile_size 16')
+        data = struct.unpack('d' * 70 * 35, ds.ReadRaster(0, 0, 70, 35))
+        ds = None
+        gdal.Unlink('/vsimem/test_gdal_grid_lib_4.tif')
+
+        for i in range(70 * 35):
+            if abs(data[i] - ref_data[i]) > 1e-8:
+                gdaltest.post_reason('fail')
+                print(algorithm, i, data[i], ref_data[i])
+                return 'fail'
+
+    # Algorithms without a search radius cannot be streamed
+    for algorithm in [ 'invdist', 'linear' ]:
+        with gdaltest.error_handler():
+            try:
+                ds = gdal.Grid('', src, options = '-of MEM ' + common + '-stream -a ' + algorithm)
+            except:
+                ds = None
+        if ds is not None:
+            gdaltest.post_reason('fail')
+            print(algorithm)
+            return 'fail'
+
+    return 'success'
+
+###############################################################################
+# Test that, in streaming mode and without -txe/-tye, the extent of the grid
+# is restricted to the one of -clipsrc, although the shapefile reports the
+# extent of all its points
+
+def test_gdal_grid_lib_5():
+
+    # Uses the points of test_gdal_grid_lib_3
+    src = '/vsimem/tmp/test_gdal_grid_lib_3.shp'
+    algorithm = 'average:radius1=8:radius2=3:nodata=-1'
+    common = '-outsize 50 35 -ot Float64 -a ' + algorithm
+
+    # The extent is computed before reading the points, so this does not
+    # depend on GEOS being available for the clipping
+    with gdaltest.error_handler():
+        ds = gdal.Grid('', src, options = '-of MEM -stream -clipsrc 10 5 60 40 ' + common)
+    gt = ds.GetGeoTransform()
+    ds = None
+    if gt != (10, 1, 0, 5, 0, 1):
+        gdaltest.post_reason('fail')
+        print(gt)
+        return 'fail'
+
+    # A clipping geometry that does not overlap the layer must not give
+    # an empty extent: the one of the layer is used
+    ds = ogr.Open(src)
+    (minx, maxx, miny, maxy) = ds.GetLayer(0).GetExtent()
+    ds = None
+    expected_gt = (minx, (maxx - minx) / 50, 0, miny, 0, (maxy - miny) / 35)
+    with gdaltest.error_handler():
+        ds = gdal.Grid('', src, options = '-of MEM -stream -clipsrc 200 200 300 300 ' + common)
+    gt = ds.GetGeoTransform()
+    ds = None
+    for i in range(6):
+        if abs(gt[i] - expected_gt[i]) > 1e-10:
+            gdaltest.post_reason('fail')
+            print(gt)
+            return 'fail'
+
+    if not ogrtest.have_geos():
+        return 'success'
+
+    # The result matches the one of the in-memory gridding, given the same
+    # extent explicitly
+    ds = gdal.Grid('', src, options = '-of MEM -clipsrc 10 5 60 40 -txe 10 60 -tye 5 40 ' + common)
+    ref_data = ds.ReadRaster(0, 0, 50, 35)
+    ds = None
+
+    ds = gdal.Grid('/vsimem/test_gdal_grid_lib_5.tif', src, \
+                   options = '-clipsrc 10 5 60 40 -stream -stream_tile_size 16 ' + common)
+    gt = ds.GetGeoTransform()
+    data = ds.ReadRaster(0, 0, 50, 35)
+    ds = None
+    gdal.Unlink('/vsimem/test_gdal_grid_lib_5.tif')
+    if gt != (10, 1, 0, 5, 0, 1):
+        gdaltest.post_reason('fail')
+        print(gt)
+        return 'fail'
+    if data != ref_data:
+        gdaltest.post_reason('fail')
+        return 'fail'
+
+    return 'success'
+
 ###############################################################################
 # Cleanup
 
@@ -145,6 +328,9 @@ def test_gdal_grid_lib_cleanup():
 gdaltest_list = [
     test_gdal_grid_lib_1,
     test_gdal_grid_lib_2,
+    test_gdal_grid_lib_3,
+    test_gdal_grid_lib_4,
+    test_gdal_grid_lib_5,
     test_gdal_grid_lib_cleanup,
     ]
 
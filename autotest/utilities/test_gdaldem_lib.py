@@ -206,12 +206,119 @@ def test_gdaldem_lib_color_relief():
 
     return 'success'
 
+###############################################################################
+# Test that multi-threaded tiled processing gives the same result as the
+# single-threaded one, on a raster larger than the processing tiles
+
+def test_gdaldem_lib_num_threads():
+
+    src_ds = gdal.Translate('', '../gdrivers/data/n43.dt0', format = 'MEM',
+                            width = 600, height = 550, outputType = gdal.GDT_Float32,
+                            resampleAlg = gdal.GRA_Bilinear)
+
+    for processing in [ 'hillshade', 'slope', 'aspect', 'TRI', 'TPI', 'roughness' ]:
+        for alg in [ 'Horn', 'ZevenbergenThorne' ]:
+            if alg == 'ZevenbergenThorne' and processing not in ['hillshade', 'slope', 'aspect']:
+                continue
+            for computeEdges in [ False, True ]:
+                for (format, creationOptions) in [ ('MEM', []),
+                                                   ('GTiff', ['TILED=YES', 'COMPRESS=DEFLATE']) ]:
+                    cs = []
+                    for num_threads in [ '1', '4' ]:
+                        gdal.SetConfigOption('GDAL_NUM_THREADS', num_threads)
+                        ds = gdal.DEMProcessing('/vsimem/test_gdaldem_lib_num_threads.tif',
+                                                src_ds, processing, format = format,
+                                                creationOptions = creationOptions,
+                                                alg = alg, computeEdges = computeEdges,
+                                                scale = 111120, zFactor = 30)
+                        gdal.SetConfigOption('GDAL_NUM_THREADS', None)
+                        cs.append(ds.GetRasterBand(1).Checksum())
+                        ds = None
+                        gdal.Unlink('/vsimem/test_gdaldem_lib_num_threads.tif')
+                    if cs[0] != cs[1]:
+                        gdaltest.post_reason('fail')
+                        print(processing, alg, computeEdges, format, cs)
+                        return 'fail'
+
+    return 'success'
+
+###############################################################################
+# Test computing several processings in a single pass
+
+def test_gdaldem_lib_multi_processing():
+
+    src_ds = gdal.Open('../gdrivers/data/n43.dt0')
+    processings = [ 'slope', 'aspect', 'TRI', 'roughness' ]
+
+    ref_cs = []
+    for processing in processings:
+        ds = gdal.DEMProcessing('', src_ds, processing, format = 'MEM',
+                                scale = 111120, zFactor = 30, computeEdges = True)
+        ref_cs.append(ds.GetRasterBand(1).Checksum())
+        ds = None
+
+    # Bands of a single dataset
+    for (format, creationOptions) in [ ('MEM', []),
+                                       ('GTiff', ['TILED=YES', 'COMPRESS=DEFLATE']) ]:
+        ds = gdal.DEMProcessing('/vsimem/test_gdaldem_lib_multi_processing.tif',
+                                src_ds, ','.join(processings), format = format,
+                                creationOptions = creationOptions,
+                                scale = 111120, zFactor = 30,
+                                computeEdges = True)
+        if ds is None or ds.RasterCount != len(processings):
+            gdaltest.post_reason('fail')
+            return 'fail'
+        for i in range(len(processings)):
+            band = ds.GetRasterBand(i+1)
+            if band.Checksum() != ref_cs[i] or \
+               band.GetDescription() != processings[i] or \
+               band.GetNoDataValue() != -9999:
+                gdaltest.post_reason('fail')
+                print(format, processings[i], band.Checksum(), ref_cs[i])
+                return 'fail'
+        ds = None
+        gdal.Unlink('/vsimem/test_gdaldem_lib_multi_processing.tif')
+
+    # One dataset per processing
+    ds = gdal.DEMProcessing('/vsimem/test_gdaldem_lib_multi_processing.tif',
+                            src_ds, 'hillshade,' + ','.join(processings),
+                            separate = True, scale = 111120, zFactor = 30,
+                            computeEdges = True)
+    if ds is None or ds.GetRasterBand(1).DataType != gdal.GDT_Byte or \
+       ds.GetRasterBand(1).Checksum() != 50239:
+        gdaltest.post_reason('fail')
+        return 'fail'
+    ds = None
+    gdal.Unlink('/vsimem/test_gdaldem_lib_multi_processing_hillshade.tif')
+    for i in range(len(processings)):
+        filename = '/vsimem/test_gdaldem_lib_multi_processing_%s.tif' % processings[i]
+        ds = gdal.Open(filename)
+        if ds is None or ds.GetRasterBand(1).Checksum() != ref_cs[i]:
+            gdaltest.post_reason('fail')
+            print(processings[i])
+            return 'fail'
+        ds = None
+        gdal.Unlink(filename)
+
+    # Invalid combinations
+    for processing in [ 'slope,slope', 'slope,color-relief', 'slope,foo' ]:
+        with gdaltest.error_handler():
+            ds = gdal.DEMProcessing('', src_ds, processing, format = 'MEM')
+        if ds is not None:
+            gdaltest.post_reason('fail')
+            print(processing)
+            return 'fail'
+
+    return 'success'
+
 gdaltest_list = [
     test_gdaldem_lib_hillshade,
     test_gdaldem_lib_hillshade_combined,
     test_gdaldem_lib_hillshade_compute_edges,
     test_gdaldem_lib_hillshade_azimuth,
-    test_gdaldem_lib_color_relief
+    test_gdaldem_lib_color_relief,
+    test_gdaldem_lib_num_threads,
+    test_gdaldem_lib_multi_processing
     ]
 
 
@@ -49,6 +49,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
 
 CPL_CVSID("$Id$");
 
@@ -80,6 +81,9 @@ static CPLMutex* hMutex = NULL;
 /************************************************************************/
 
 /** Returns if GDAL is built with Delaunay triangulation support.
+ *
+ * Starting with GDAL 2.2, a native implementation is always available, so
+ * this always returns TRUE.
  *
  * @return TRUE if GDAL is built with Delaunay triangulation support.
  *
@@ -87,32 +91,768 @@ static CPLMutex* hMutex = NULL;
  */
 int GDALHasTriangulation()
 {
-#if HAVE_INTERNAL_OR_EXTERNAL_QHULL
     return TRUE;
-#else
-    return FALSE;
-#endif
 }
 
 /************************************************************************/
-/*                   GDALTriangulationCreateDelaunay()                  */
+/*                    Native incremental triangulation                  */
 /************************************************************************/
 
-/** Computes a Delaunay triangulation of the passed points
- *
- * @param nPoints number of points
- * @param padfX x coordinates of the points.
- * @param padfY y coordinates of the points.
- * @return triangulation that must be freed with GDALTriangulationFree(), or
- *         NULL in case of error.
- *
- * @since GDAL 2.1
- */
-GDALTriangulation* GDALTriangulationCreateDelaunay(int nPoints,
-                                                   const double* padfX,
-                                                   const double* padfY)
+/* Incremental Delaunay triangulation where points are inserted in order  */
+/* of increasing distance to the circumcenter of a seed triangle, so that */
+/* each new point lies outside the current convex hull. The hull edge it  */
+/* sees is found with a hash of the hull vertices on their pseudo-angle   */
+/* around the center, which acts as a cache for point location, and      */
+/* the Delaunay property is restored with Lawson edge flips.             */
+/*                                                                        */
+/* During construction, triangle t is stored in pasFacets[t]: its        */
+/* anVertexIdx[] hold the vertices and its anNeighborIdx[] hold the      */
+/* opposite half-edge (3 * triangle + local edge index) of each of its   */
+/* edges, edge k going from vertex k to vertex (k+1)%3. They are         */
+/* converted to neighbor triangle indices at the end.                    */
+
+typedef struct
+{
+    double dfDist;
+    int    nIdx;
+} GDALDelaunayPointDist;
+
+typedef struct
+{
+    const double   *padfX;
+    const double   *padfY;
+    GDALTriFacet   *pasFacets;
+    int             nHalfEdges;
+    int            *panHullPrev;
+    int            *panHullNext;
+    int            *panHullTri;
+    int            *panHullHash;
+    int             nHashSize;
+    int            *panEdgeStack;
+    int             nEdgeStackAlloc;
+    int             bError;
+    int             nHullStart;
+    double          dfCX;
+    double          dfCY;
+} GDALDelaunayBuilder;
+
+#define DT_VERTEX(psB, e)    ((psB)->pasFacets[(e) / 3].anVertexIdx[(e) % 3])
+#define DT_HALFEDGE(psB, e)  ((psB)->pasFacets[(e) / 3].anNeighborIdx[(e) % 3])
+#define DT_EDGE_STACK_INITIAL_SIZE   1024
+
+/* Geometric predicates. The sign of the orientation and in-circle        */
+/* determinants is first computed in floating point, and accepted if it   */
+/* is larger than the bound of the rounding error (Shewchuk, "Adaptive    */
+/* Precision Floating-Point Arithmetic and Fast Robust Geometric          */
+/* Predicates", 1997). Otherwise, the determinants are evaluated exactly  */
+/* with floating-point expansions, which happens for (nearly) collinear   */
+/* or cocircular points, such as the nodes of a regular grid.             */
+
+#define DT_EPSILON           (1.1102230246251565e-16) /* 2^-53 */
+#define DT_SPLITTER          (134217729.0) /* 2^27 + 1 */
+#define DT_CCW_ERRBOUND      ((3.0 + 16.0 * DT_EPSILON) * DT_EPSILON)
+#define DT_ICC_ERRBOUND      ((10.0 + 96.0 * DT_EPSILON) * DT_EPSILON)
+
+/* x + y == a + b exactly */
+#define DT_TWO_SUM(a, b, x, y) \
+    do { \
+        double _bvirt, _avirt; \
+        x = (a) + (b); \
+        _bvirt = x - (a); \
+        _avirt = x - _bvirt; \
+        y = ((a) - _avirt) + ((b) - _bvirt); \
+    } while(0)
+
+/* x + y == a + b exactly, provided that |a| >= |b| */
+#define DT_FAST_TWO_SUM(a, b, x, y) \
+    do { \
+        x = (a) + (b); \
+        y = (b) - (x - (a)); \
+    } while(0)
+
+/* hi + lo == a, each with at most 26 significant bits */
+#define DT_SPLIT(a, hi, lo) \
+    do { \
+        const double _c = DT_SPLITTER * (a); \
+        hi = _c - (_c - (a)); \
+        lo = (a) - hi; \
+    } while(0)
+
+/* x + y == a * b exactly */
+#define DT_TWO_PRODUCT(a, b, x, y) \
+    do { \
+        double _ahi, _alo, _bhi, _blo; \
+        x = (a) * (b); \
+        DT_SPLIT(a, _ahi, _alo); \
+        DT_SPLIT(b, _bhi, _blo); \
+        y = _alo * _blo - (((x - _ahi * _bhi) - _alo * _bhi) - _ahi * _blo); \
+    } while(0)
+
+/* Expansions are arrays of non-overlapping doubles, sorted by increasing */
+/* magnitude and without zeroes, whose exact sum is the represented value */
+/* (an empty expansion is zero). Its sign is the one of its last term.    */
+
+/* h = e + b. h can be e, and must have room for nLen + 1 terms */
+static int GDALDelaunayGrowExpansion( int nLen, const double* e, double b,
+                                      double* h )
+{
+    double Q = b;
+    int i, nOut = 0;
+    for( i = 0; i < nLen; i++ )
+    {
+        double dfSum, dfErr;
+        DT_TWO_SUM(Q, e[i], dfSum, dfErr);
+        Q = dfSum;
+        if( dfErr != 0 )
+            h[nOut++] = dfErr;
+    }
+    if( Q != 0 || nOut == 0 )
+        h[nOut++] = Q;
+    if( nOut == 1 && h[0] == 0 )
+        return 0;
+    return nOut;
+}
+
+/* e += f. e must have room for nLenE + nLenF terms */
+static int GDALDelaunayAddExpansion( int nLenE, double* e,
+                                     int nLenF, const double* f )
+{
+    int i;
+    for( i = 0; i < nLenF; i++ )
+        nLenE = GDALDelaunayGrowExpansion(nLenE, e, f[i], e);
+    return nLenE;
+}
+
+/* h = e * b. h must have room for 2 * nLen terms */
+static int GDALDelaunayScaleExpansion( int nLen, const double* e, double b,
+                                       double* h )
+{
+    double Q, dfErr, dfProd1, dfProd0, dfSum;
+    int i, nOut = 0;
+    if( nLen == 0 )
+        return 0;
+    DT_TWO_PRODUCT(e[0], b, Q, dfErr);
+    if( dfErr != 0 )
+        h[nOut++] = dfErr;
+    for( i = 1; i < nLen; i++ )
+    {
+        DT_TWO_PRODUCT(e[i], b, dfProd1, dfProd0);
+        DT_TWO_SUM(Q, dfProd0, dfSum, dfErr);
+        if( dfErr != 0 )
+            h[nOut++] = dfErr;
+        DT_FAST_TWO_SUM(dfProd1, dfSum, Q, dfErr);
+        if( dfErr != 0 )
+            h[nOut++] = dfErr;
+    }
+    if( Q != 0 || nOut == 0 )
+        h[nOut++] = Q;
+    if( nOut == 1 && h[0] == 0 )
+        return 0;
+    return nOut;
+}
+
+/* h = ax * by - bx * ay, with room for 4 terms */
+static int GDALDelaunayCrossExpansion( double ax, double ay,
+                                       double bx, double by, double* h )
+{
+    double x, y;
+    int nLen;
+    DT_TWO_PRODUCT(ax, by, x, y);
+    nLen = GDALDelaunayGrowExpansion(0, h, y, h);
+    nLen = GDALDelaunayGrowExpansion(nLen, h, x, h);
+    DT_TWO_PRODUCT(-bx, ay, x, y);
+    nLen = GDALDelaunayGrowExpansion(nLen, h, y, h);
+    return GDALDelaunayGrowExpansion(nLen, h, x, h);
+}
+
+/* h = ab + bc + ca, with room for 12 terms */
+static int GDALDelaunayOrientExpansion( double ax, double ay,
+                                        double bx, double by,
+                                        double cx, double cy, double* h )
+{
+    double adfTmp[4];
+    int nLen = GDALDelaunayCrossExpansion(ax, ay, bx, by, h);
+    int nLenTmp = GDALDelaunayCrossExpansion(bx, by, cx, cy, adfTmp);
+    nLen = GDALDelaunayAddExpansion(nLen, h, nLenTmp, adfTmp);
+    nLenTmp = GDALDelaunayCrossExpansion(cx, cy, ax, ay, adfTmp);
+    return GDALDelaunayAddExpansion(nLen, h, nLenTmp, adfTmp);
+}
+
+/* h += sign * (x^2 + y^2) * e, e having at most 12 terms */
+static int GDALDelaunayAddLiftedTerm( int nLen, double* h,
+                                      int nLenE, const double* e,
+                                      double x, double y, double dfSign )
+{
+    double adfX[24], adfXX[48], adfY[24], adfYY[48];
+    int nLenX = GDALDelaunayScaleExpansion(nLenE, e, x, adfX);
+    int nLenXX = GDALDelaunayScaleExpansion(nLenX, adfX, dfSign * x, adfXX);
+    int nLenY = GDALDelaunayScaleExpansion(nLenE, e, y, adfY);
+    int nLenYY = GDALDelaunayScaleExpansion(nLenY, adfY, dfSign * y, adfYY);
+    nLen = GDALDelaunayAddExpansion(nLen, h, nLenXX, adfXX);
+    return GDALDelaunayAddExpansion(nLen, h, nLenYY, adfYY);
+}
+
+/* Returns TRUE if r is on the right side of the p->q line */
+static int GDALDelaunayOrient( double px, double py, double qx, double qy,
+                               double rx, double ry )
+{
+    const double dfLeft = (px - rx) * (qy - ry);
+    const double dfRight = (py - ry) * (qx - rx);
+    const double dfDet = dfLeft - dfRight;
+    const double dfErrBound = DT_CCW_ERRBOUND * (fabs(dfLeft) + fabs(dfRight));
+    double adfDet[12];
+    int nLen;
+
+    if( dfDet > dfErrBound )
+        return TRUE;
+    if( -dfDet > dfErrBound )
+        return FALSE;
+
+    nLen = GDALDelaunayOrientExpansion(px, py, qx, qy, rx, ry, adfDet);
+    return nLen > 0 && adfDet[nLen - 1] > 0;
+}
+
+/* Returns TRUE if p is strictly inside the circumcircle of a, b, c */
+static int GDALDelaunayInCircle( double ax, double ay, double bx, double by,
+                                 double cx, double cy, double px, double py )
+{
+    const double dx = ax - px;
+    const double dy = ay - py;
+    const double ex = bx - px;
+    const double ey = by - py;
+    const double fx = cx - px;
+    const double fy = cy - py;
+    const double ap = dx * dx + dy * dy;
+    const double bp = ex * ex + ey * ey;
+    const double cp = fx * fx + fy * fy;
+    const double exfy = ex * fy;
+    const double fxey = fx * ey;
+    const double fxdy = fx * dy;
+    const double dxfy = dx * fy;
+    const double dxey = dx * ey;
+    const double exdy = ex * dy;
+    const double dfDet = ap * (exfy - fxey) + bp * (fxdy - dxfy) +
+                         cp * (dxey - exdy);
+    const double dfErrBound = DT_ICC_ERRBOUND *
+        ((fabs(exfy) + fabs(fxey)) * ap + (fabs(fxdy) + fabs(dxfy)) * bp +
+         (fabs(dxey) + fabs(exdy)) * cp);
+    double adfABC[12], adfBCP[12], adfCPA[12], adfPAB[12], adfDet[384];
+    int nLenABC, nLenBCP, nLenCPA, nLenPAB, nLen;
+
+    if( dfDet > dfErrBound )
+        return FALSE;
+    if( -dfDet > dfErrBound )
+        return TRUE;
+
+/* -------------------------------------------------------------------- */
+/*      Exact evaluation, by expansion of the 4x4 determinant of the    */
+/*      (x, y, x^2 + y^2, 1) rows on its third column.                  */
+/* -------------------------------------------------------------------- */
+    nLenBCP = GDALDelaunayOrientExpansion(bx, by, cx, cy, px, py, adfBCP);
+    nLenCPA = GDALDelaunayOrientExpansion(cx, cy, px, py, ax, ay, adfCPA);
+    nLenPAB = GDALDelaunayOrientExpansion(px, py, ax, ay, bx, by, adfPAB);
+    nLenABC = GDALDelaunayOrientExpansion(ax, ay, bx, by, cx, cy, adfABC);
+    nLen = GDALDelaunayAddLiftedTerm(0, adfDet, nLenBCP, adfBCP, ax, ay, 1.0);
+    nLen = GDALDelaunayAddLiftedTerm(nLen, adfDet, nLenCPA, adfCPA, bx, by, -1.0);
+    nLen = GDALDelaunayAddLiftedTerm(nLen, adfDet, nLenPAB, adfPAB, cx, cy, 1.0);
+    nLen = GDALDelaunayAddLiftedTerm(nLen, adfDet, nLenABC, adfABC, px, py, -1.0);
+    return nLen > 0 && adfDet[nLen - 1] < 0;
+}
+
+/* Square of the circumradius of a, b, c, or HUGE_VAL if they are collinear */
+static double GDALDelaunayCircumradius2( double ax, double ay,
+                                         double bx, double by,
+                                         double cx, double cy,
+                                         double* pdfCenterX,
+                                         double* pdfCenterY )
+{
+    const double dx = bx - ax;
+    const double dy = by - ay;
+    const double ex = cx - ax;
+    const double ey = cy - ay;
+    const double bl = dx * dx + dy * dy;
+    const double cl = ex * ex + ey * ey;
+    const double dfDenom = dx * ey - dy * ex;
+    double x, y, r2;
+
+    if( dfDenom == 0 )
+        return HUGE_VAL;
+    x = (ey * bl - dy * cl) * 0.5 / dfDenom;
+    y = (dx * cl - ex * bl) * 0.5 / dfDenom;
+    r2 = x * x + y * y;
+    if( !(r2 < HUGE_VAL) ) /* also catches NaN */
+        return HUGE_VAL;
+    if( pdfCenterX )
+    {
+        *pdfCenterX = ax + x;
+        *pdfCenterY = ay + y;
+    }
+    return r2;
+}
+
+static int GDALDelaunayComparePointDist( const void* a, const void* b )
+{
+    const GDALDelaunayPointDist* psA = (const GDALDelaunayPointDist*)a;
+    const GDALDelaunayPointDist* psB = (const GDALDelaunayPointDist*)b;
+    if( psA->dfDist < psB->dfDist )
+        return -1;
+    if( psA->dfDist > psB->dfDist )
+        return 1;
+    return psA->nIdx - psB->nIdx;
+}
+
+static int GDALDelaunayHashKey( const GDALDelaunayBuilder* psB,
+                                double dfX, double dfY )
+{
+    /* Pseudo-angle in [0,1] that increases monotonically with the angle */
+    const double dx = dfX - psB->dfCX;
+    const double dy = dfY - psB->dfCY;
+    const double dfSum = fabs(dx) + fabs(dy);
+    double p, dfAngle;
+    int nKey;
+    p = dfSum > 0 ? dx / dfSum : 0;
+    dfAngle = (dy > 0 ? 3 - p : 1 + p) / 4;
+    nKey = (int)floor(dfAngle * psB->nHashSize);
+    return nKey % psB->nHashSize;
+}
+
+static void GDALDelaunayLink( GDALDelaunayBuilder* psB, int a, int b )
+{
+    DT_HALFEDGE(psB, a) = b;
+    if( b >= 0 )
+        DT_HALFEDGE(psB, b) = a;
+}
+
+static int GDALDelaunayAddTriangle( GDALDelaunayBuilder* psB,
+                                    int i0, int i1, int i2,
+                                    int a, int b, int c )
+{
+    const int t = psB->nHalfEdges;
+    DT_VERTEX(psB, t) = i0;
+    DT_VERTEX(psB, t + 1) = i1;
+    DT_VERTEX(psB, t + 2) = i2;
+    GDALDelaunayLink(psB, t, a);
+    GDALDelaunayLink(psB, t + 1, b);
+    GDALDelaunayLink(psB, t + 2, c);
+    psB->nHalfEdges += 3;
+    return t;
+}
+
+/* Flip edges from half-edge a until the Delaunay condition is satisfied. */
+/* Returns the half-edge that ends up opposite to the new point.          */
+/* Sets bError if the stack of edges to check cannot be grown.            */
+static int GDALDelaunayLegalize( GDALDelaunayBuilder* psB, int a )
+{
+    int* anEdgeStack = psB->panEdgeStack;
+    int nStack = 0;
+    int ar = 0;
+    const double* padfX = psB->padfX;
+    const double* padfY = psB->padfY;
+
+    /*
+     *           pl                    pl
+     *          /||\                  /  \
+     *       al/ || \bl            al/    \a
+     *        /  ||  \              /      \
+     *       /  a||b  \    flip    /___ar___\
+     *     p0\   ||   /p1   =>   p0\---bl---/p1
+     *        \  ||  /              \      /
+     *       ar\ || /br             b\    /br
+     *          \||/                  \  /
+     *           pr                    pr
+     */
+    for( ;; )
+    {
+        const int b = DT_HALFEDGE(psB, a);
+        const int a0 = a - a % 3;
+        int b0, al, bl, p0, pr, pl, p1;
+
+        ar = a0 + (a + 2) % 3;
+
+        if( b < 0 ) /* convex hull edge */
+        {
+            if( nStack == 0 )
+                break;
+            a = anEdgeStack[--nStack];
+            continue;
+        }
+
+        b0 = b - b % 3;
+        al = a0 + (a + 1) % 3;
+        bl = b0 + (b + 2) % 3;
+
+        p0 = DT_VERTEX(psB, ar);
+        pr = DT_VERTEX(psB, a);
+        pl = DT_VERTEX(psB, al);
+        p1 = DT_VERTEX(psB, bl);
+
+        if( GDALDelaunayInCircle(padfX[p0], padfY[p0], padfX[pr], padfY[pr],
+                                 padfX[pl], padfY[pl], padfX[p1], padfY[p1]) )
+        {
+            const int hbl = DT_HALFEDGE(psB, bl);
+            const int br = b0 + (b + 1) % 3;
+
+            DT_VERTEX(psB, a) = p1;
+            DT_VERTEX(psB, b) = p0;
+
+            /* Edge swapped on the other side of the hull (rare): fix */
+            /* the reference of the hull to its triangle.              */
+            if( hbl < 0 )
+            {
+                int e = psB->nHullStart;
+                do
+                {
+                    if( psB->panHullTri[e] == bl )
+                    {
+                        psB->panHullTri[e] = a;
+                        break;
+                    }
+                    e = psB->panHullPrev[e];
+                } while( e != psB->nHullStart );
+            }
+            GDALDelaunayLink(psB, a, hbl);
+            GDALDelaunayLink(psB, b, DT_HALFEDGE(psB, ar));
+            GDALDelaunayLink(psB, ar, bl);
+
+            if( nStack == psB->nEdgeStackAlloc )
+            {
+                int* panNewStack = NULL;
+                if( psB->nEdgeStackAlloc <= INT_MAX / 2 )
+                {
+                    panNewStack = (int*)VSIRealloc(anEdgeStack,
+                                2 * sizeof(int) * psB->nEdgeStackAlloc);
+                }
+                if( panNewStack == NULL )
+                {
+                    psB->bError = TRUE;
+                    break;
+                }
+                psB->panEdgeStack = anEdgeStack = panNewStack;
+                psB->nEdgeStackAlloc *= 2;
+            }
+            anEdgeStack[nStack++] = br;
+        }
+        else
+        {
+            if( nStack == 0 )
+                break;
+            a = anEdgeStack[--nStack];
+        }
+    }
+
+    return ar;
+}
+
+/************************************************************************/
+/*                   GDALTriangulationCreateDelaunayNative()            */
+/************************************************************************/
+
+static GDALTriangulation* GDALTriangulationCreateDelaunayNative(
+                                                    int nPoints,
+                                                    const double* padfX,
+                                                    const double* padfY)
 {
+    GDALDelaunayBuilder sB;
+    GDALDelaunayPointDist* pasDists;
+    GDALTriangulation* psDT;
+    double dfMinX, dfMinY, dfMaxX, dfMaxY, dfCX, dfCY;
+    double dfMinDist, dfMinRadius, dfXPrev = 0, dfYPrev = 0;
+    int i, k, i0 = -1, i1 = -1, i2 = -1;
+    int nMaxTriangles;
+
+    if( nPoints < 3 )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined,
+                 "Delaunay triangulation failed: not enough points");
+        return NULL;
+    }
+    if( nPoints > INT_MAX / 2 )
+    {
+        CPLError(CE_Failure, CPLE_NotSupported,
+                 "Delaunay triangulation failed: too many points");
+        return NULL;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Pick a seed triangle close to the center of the points.        */
+/* -------------------------------------------------------------------- */
+    dfMinX = dfMaxX = padfX[0];
+    dfMinY = dfMaxY = padfY[0];
+    for( i = 1; i < nPoints; i++ )
+    {
+        if( padfX[i] < dfMinX ) dfMinX = padfX[i];
+        if( padfX[i] > dfMaxX ) dfMaxX = padfX[i];
+        if( padfY[i] < dfMinY ) dfMinY = padfY[i];
+        if( padfY[i] > dfMaxY ) dfMaxY = padfY[i];
+    }
+    dfCX = (dfMinX + dfMaxX) / 2;
+    dfCY = (dfMinY + dfMaxY) / 2;
+
+    dfMinDist = HUGE_VAL;
+    for( i = 0; i < nPoints; i++ )
+    {
+        const double d = (padfX[i] - dfCX) * (padfX[i] - dfCX) +
+                         (padfY[i] - dfCY) * (padfY[i] - dfCY);
+        if( d < dfMinDist )
+        {
+            i0 = i;
+            dfMinDist = d;
+        }
+    }
+
+    dfMinDist = HUGE_VAL;
+    for( i = 0; i < nPoints; i++ )
+    {
+        const double d = (padfX[i] - padfX[i0]) * (padfX[i] - padfX[i0]) +
+                         (padfY[i] - padfY[i0]) * (padfY[i] - padfY[i0]);
+        if( i != i0 && d > 0 && d < dfMinDist )
+        {
+            i1 = i;
+            dfMinDist = d;
+        }
+    }
+
+    dfMinRadius = HUGE_VAL;
+    for( i = 0; i1 >= 0 && i < nPoints; i++ )
+    {
+        double r;
+        if( i == i0 || i == i1 )
+            continue;
+        r = GDALDelaunayCircumradius2(padfX[i0], padfY[i0],
+                                      padfX[i1], padfY[i1],
+                                      padfX[i], padfY[i], NULL, NULL);
+        if( r < dfMinRadius )
+        {
+            i2 = i;
+            dfMinRadius = r;
+        }
+    }
+
+    if( i2 < 0 )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined,
+                 "Delaunay triangulation failed: all points are collinear");
+        return NULL;
+    }
+
+    if( GDALDelaunayOrient(padfX[i0], padfY[i0], padfX[i1], padfY[i1],
+                           padfX[i2], padfY[i2]) )
+    {
+        const int nTmp = i1;
+        i1 = i2;
+        i2 = nTmp;
+    }
+
+    memset(&sB, 0, sizeof(sB));
+    sB.padfX = padfX;
+    sB.padfY = padfY;
+    GDALDelaunayCircumradius2(padfX[i0], padfY[i0], padfX[i1], padfY[i1],
+                              padfX[i2], padfY[i2], &sB.dfCX, &sB.dfCY);
+
+/* -------------------------------------------------------------------- */
+/*      Sort the points by distance to the seed circumcenter.          */
+/* -------------------------------------------------------------------- */
+    nMaxTriangles = 2 * nPoints - 5;
+    pasDists = (GDALDelaunayPointDist*)
+        VSI_MALLOC2_VERBOSE(nPoints, sizeof(GDALDelaunayPointDist));
+    sB.pasFacets = (GDALTriFacet*)
+        VSI_MALLOC2_VERBOSE(nMaxTriangles, sizeof(GDALTriFacet));
+    sB.panHullPrev = (int*)VSI_MALLOC2_VERBOSE(nPoints, sizeof(int));
+    sB.panHullNext = (int*)VSI_MALLOC2_VERBOSE(nPoints, sizeof(int));
+    sB.panHullTri = (int*)VSI_MALLOC2_VERBOSE(nPoints, sizeof(int));
+    sB.nHashSize = (int)ceil(sqrt((double)nPoints));
+    sB.panHullHash = (int*)VSI_MALLOC2_VERBOSE(sB.nHashSize, sizeof(int));
+    sB.nEdgeStackAlloc = DT_EDGE_STACK_INITIAL_SIZE;
+    sB.panEdgeStack = (int*)VSI_MALLOC2_VERBOSE(sB.nEdgeStackAlloc,
+                                                 sizeof(int));
+    if( pasDists == NULL || sB.pasFacets == NULL || sB.panHullPrev == NULL ||
+        sB.panHullNext == NULL || sB.panHullTri == NULL ||
+        sB.panHullHash == NULL || sB.panEdgeStack == NULL )
+    {
+        VSIFree(pasDists);
+        VSIFree(sB.pasFacets);
+        VSIFree(sB.panHullPrev);
+        VSIFree(sB.panHullNext);
+        VSIFree(sB.panHullTri);
+        VSIFree(sB.panHullHash);
+        VSIFree(sB.panEdgeStack);
+        return NULL;
+    }
+
+    for( i = 0; i < nPoints; i++ )
+    {
+        pasDists[i].dfDist = (padfX[i] - sB.dfCX) * (padfX[i] - sB.dfCX) +
+                             (padfY[i] - sB.dfCY) * (padfY[i] - sB.dfCY);
+        pasDists[i].nIdx = i;
+    }
+    qsort(pasDists, nPoints, sizeof(GDALDelaunayPointDist),
+          GDALDelaunayComparePointDist);
+
+/* -------------------------------------------------------------------- */
+/*      The seed triangle is the initial hull.                         */
+/* -------------------------------------------------------------------- */
+    sB.nHullStart = i0;
+    sB.panHullNext[i0] = sB.panHullPrev[i2] = i1;
+    sB.panHullNext[i1] = sB.panHullPrev[i0] = i2;
+    sB.panHullNext[i2] = sB.panHullPrev[i1] = i0;
+    sB.panHullTri[i0] = 0;
+    sB.panHullTri[i1] = 1;
+    sB.panHullTri[i2] = 2;
+    for( i = 0; i < sB.nHashSize; i++ )
+        sB.panHullHash[i] = -1;
+    sB.panHullHash[GDALDelaunayHashKey(&sB, padfX[i0], padfY[i0])] = i0;
+    sB.panHullHash[GDALDelaunayHashKey(&sB, padfX[i1], padfY[i1])] = i1;
+    sB.panHullHash[GDALDelaunayHashKey(&sB, padfX[i2], padfY[i2])] = i2;
+
+    GDALDelaunayAddTriangle(&sB, i0, i1, i2, -1, -1, -1);
+
+/* -------------------------------------------------------------------- */
+/*      Insert the other points.                                       */
+/* -------------------------------------------------------------------- */
+    for( k = 0; k < nPoints; k++ )
+    {
+        const int iPt = pasDists[k].nIdx;
+        const double x = padfX[iPt];
+        const double y = padfY[iPt];
+        int j, nKey, nStart = 0, e, q, n, t;
+
+        /* Skip duplicate points */
+        if( k > 0 && x == dfXPrev && y == dfYPrev )
+            continue;
+        dfXPrev = x;
+        dfYPrev = y;
+
+        if( iPt == i0 || iPt == i1 || iPt == i2 )
+            continue;
+
+        /* Find a visible edge of the hull, using the edge hash */
+        nKey = GDALDelaunayHashKey(&sB, x, y);
+        for( j = 0; j < sB.nHashSize; j++ )
+        {
+            nStart = sB.panHullHash[(nKey + j) % sB.nHashSize];
+            if( nStart >= 0 && nStart != sB.panHullNext[nStart] )
+                break;
+        }
+
+        nStart = sB.panHullPrev[nStart];
+        e = nStart;
+        for( ;; )
+        {
+            q = sB.panHullNext[e];
+            if( GDALDelaunayOrient(x, y, padfX[e], padfY[e],
+                                   padfX[q], padfY[q]) )
+                break;
+            e = q;
+            if( e == nStart )
+            {
+                e = -1;
+                break;
+            }
+        }
+        if( e < 0 ) /* likely a near-duplicate point */
+            continue;
+
+        /* Add the first triangle from the point */
+        t = GDALDelaunayAddTriangle(&sB, e, iPt, sB.panHullNext[e],
+                                    -1, -1, sB.panHullTri[e]);
+        sB.panHullTri[iPt] = GDALDelaunayLegalize(&sB, t + 2);
+        sB.panHullTri[e] = t;
+
+        /* Walk forward through the hull, adding more triangles */
+        n = sB.panHullNext[e];
+        for( ;; )
+        {
+            q = sB.panHullNext[n];
+            if( !GDALDelaunayOrient(x, y, padfX[n], padfY[n],
+                                    padfX[q], padfY[q]) )
+                break;
+            t = GDALDelaunayAddTriangle(&sB, n, iPt, q,
+                                        sB.panHullTri[iPt], -1,
+                                        sB.panHullTri[n]);
+            sB.panHullTri[iPt] = GDALDelaunayLegalize(&sB, t + 2);
+            sB.panHullNext[n] = n; /* mark as removed */
+            n = q;
+        }
+
+        /* Walk backward from the other side */
+        if( e == nStart )
+        {
+            for( ;; )
+            {
+                q = sB.panHullPrev[e];
+                if( !GDALDelaunayOrient(x, y, padfX[q], padfY[q],
+                                        padfX[e], padfY[e]) )
+                    break;
+                t = GDALDelaunayAddTriangle(&sB, q, iPt, e,
+                                            -1, sB.panHullTri[e],
+                                            sB.panHullTri[q]);
+                GDALDelaunayLegalize(&sB, t + 2);
+                sB.panHullTri[q] = t;
+                sB.panHullNext[e] = e; /* mark as removed */
+                e = q;
+            }
+        }
+
+        /* Update the hull */
+        sB.nHullStart = sB.panHullPrev[iPt] = e;
+        sB.panHullNext[e] = sB.panHullPrev[n] = iPt;
+        sB.panHullNext[iPt] = n;
+
+        sB.panHullHash[GDALDelaunayHashKey(&sB, x, y)] = iPt;
+        sB.panHullHash[GDALDelaunayHashKey(&sB, padfX[e], padfY[e])] = e;
+
+        if( sB.bError )
+            break;
+    }
+
+    VSIFree(pasDists);
+    VSIFree(sB.panHullPrev);
+    VSIFree(sB.panHullNext);
+    VSIFree(sB.panHullTri);
+    VSIFree(sB.panHullHash);
+    VSIFree(sB.panEdgeStack);
+    if( sB.bError )
+    {
+        CPLError(CE_Failure, CPLE_OutOfMemory,
+                 "Delaunay triangulation failed: cannot grow edge stack");
+        VSIFree(sB.pasFacets);
+        return NULL;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Convert half-edges to neighbor triangles. Neighbor k is the    */
+/*      one opposite to vertex k, that is across edge (k+1)%3.         */
+/* -------------------------------------------------------------------- */
+    psDT = (GDALTriangulation*)CPLCalloc(1, sizeof(GDALTriangulation));
+    psDT->nFacets = sB.nHalfEdges / 3;
+    for( i = 0; i < psDT->nFacets; i++ )
+    {
+        int* panNeighbors = sB.pasFacets[i].anNeighborIdx;
+        const int h0 = panNeighbors[0];
+        const int h1 = panNeighbors[1];
+        const int h2 = panNeighbors[2];
+        panNeighbors[0] = h1 < 0 ? -1 : h1 / 3;
+        panNeighbors[1] = h2 < 0 ? -1 : h2 / 3;
+        panNeighbors[2] = h0 < 0 ? -1 : h0 / 3;
+    }
+    psDT->pasFacets = (GDALTriFacet*)VSIRealloc(sB.pasFacets,
+                                    psDT->nFacets * sizeof(GDALTriFacet));
+    if( psDT->pasFacets == NULL )
+        psDT->pasFacets = sB.pasFacets;
+
+    return psDT;
+}
+
+/************************************************************************/
+/*                   GDALTriangulationCreateDelaunayQHull()             */
+/************************************************************************/
+
 #if HAVE_INTERNAL_OR_EXTERNAL_QHULL
+static GDALTriangulation* GDALTriangulationCreateDelaunayQHull(
+                                                    int nPoints,
+                                                    const double* padfX,
+                                                    const double* padfY)
+{
     coordT* points;
     int i, j;
     GDALTriangulation* psDT = NULL;
@@ -235,17 +975,46 @@ end:
     CPLReleaseMutex(hMutex);
 
     return psDT;
-#else /* HAVE_INTERNAL_OR_EXTERNAL_QHULL */
+}
+#endif /* HAVE_INTERNAL_OR_EXTERNAL_QHULL */
 
-    /* Suppress unused argument warnings. */
-    (void)nPoints;
-    (void)padfX;
-    (void)padfY;
+/************************************************************************/
+/*                   GDALTriangulationCreateDelaunay()                  */
+/************************************************************************/
 
-    CPLError(CE_Failure, CPLE_NotSupported,
-             "GDALTriangulationCreateDelaunay() unavailable since GDAL built without QHull support");
-    return NULL;
-#endif /* HAVE_INTERNAL_OR_EXTERNAL_QHULL */
+/** Computes a Delaunay triangulation of the passed points
+ *
+ * Starting with GDAL 2.2, a native incremental implementation is used. The
+ * GDAL_TRIANGULATION_METHOD configuration option can be set to QHULL to use
+ * the QHull library instead, if GDAL has been built with it.
+ *
+ * Duplicated points are ignored. The triangulation fails if there are less
+ * than 3 distinct points or if all points are collinear.
+ *
+ * @param nPoints number of points
+ * @param padfX x coordinates of the points.
+ * @param padfY y coordinates of the points.
+ * @return triangulation that must be freed with GDALTriangulationFree(), or
+ *         NULL in case of error.
+ *
+ * @since GDAL 2.1
+ */
+GDALTriangulation* GDALTriangulationCreateDelaunay(int nPoints,
+                                                   const double* padfX,
+                                                   const double* padfY)
+{
+    const char* pszMethod =
+        CPLGetConfigOption("GDAL_TRIANGULATION_METHOD", "NATIVE");
+    if( EQUAL(pszMethod, "QHULL") )
+    {
+#if HAVE_INTERNAL_OR_EXTERNAL_QHULL
+        return GDALTriangulationCreateDelaunayQHull(nPoints, padfX, padfY);
+#else
+        CPLDebug("GDAL", "GDAL built without QHull support. "
+                 "Using native triangulation");
+#endif
+    }
+    return GDALTriangulationCreateDelaunayNative(nPoints, padfX, padfY);
 }
 
 /************************************************************************/
@@ -33,7 +33,8 @@
 #include "gdalgrid.h"
 #include <float.h>
 #include <limits.h>
-#include <map>
+#include <algorithm>
+#include <vector>
 #include "cpl_worker_thread_pool.h"
 #include "gdalgrid_priv.h"
 #include <cstdlib>
@@ -51,21 +52,345 @@ CPL_CVSID("$Id$");
 #endif /* DBL_MAX */
 
 /************************************************************************/
-/*                        GDALGridGetPointBounds()                      */
+/*                        GDALGridPointIndexFree()                      */
 /************************************************************************/
 
-static void GDALGridGetPointBounds(const void* hFeature, CPLRectObj* pBounds)
+static void GDALGridPointIndexFree( GDALGridPointIndex* psIndex )
 {
-    GDALGridPoint* psPoint = (GDALGridPoint*) hFeature;
-    GDALGridXYArrays* psXYArrays = psPoint->psXYArrays;
-    int i = psPoint->i;
-    double dfX = psXYArrays->padfX[i];
-    double dfY = psXYArrays->padfY[i];
-    pBounds->minx = dfX;
-    pBounds->miny = dfY;
-    pBounds->maxx = dfX;
-    pBounds->maxy = dfY;
-};
+    if( psIndex )
+    {
+        VSIFree(psIndex->panCellStart);
+        VSIFree(psIndex->panPointIdx);
+        VSIFree(psIndex);
+    }
+}
+
+/************************************************************************/
+/*                       GDALGridHasSearchEllipse()                     */
+/************************************************************************/
+
+/* A null radius means no search ellipse: all points are considered. */
+static bool GDALGridHasSearchEllipse( double dfRadius1, double dfRadius2 )
+{
+    return dfRadius1 > 0.0 && dfRadius2 > 0.0;
+}
+
+/************************************************************************/
+/*                 GDALGridPointIndexCellX() / CellY()                  */
+/************************************************************************/
+
+/* Monotonic in dfX, so a point inside a query window always falls into */
+/* one of the cells of the window.                                      */
+static int GDALGridPointIndexCellX( const GDALGridPointIndex* psIndex,
+                                    double dfX )
+{
+    const double dfCell = (dfX - psIndex->dfMinX) * psIndex->dfInvCellSize;
+    if( !(dfCell >= 0.0) )
+        return 0;
+    if( dfCell >= psIndex->nCellsX - 1 )
+        return psIndex->nCellsX - 1;
+    return static_cast<int>(dfCell);
+}
+
+static int GDALGridPointIndexCellY( const GDALGridPointIndex* psIndex,
+                                    double dfY )
+{
+    const double dfCell = (dfY - psIndex->dfMinY) * psIndex->dfInvCellSize;
+    if( !(dfCell >= 0.0) )
+        return 0;
+    if( dfCell >= psIndex->nCellsY - 1 )
+        return psIndex->nCellsY - 1;
+    return static_cast<int>(dfCell);
+}
+
+/************************************************************************/
+/*                       GDALGridPointIndexCreate()                     */
+/************************************************************************/
+
+/* Build a uniform grid of buckets over the point extent, with about two   */
+/* points per cell for an even distribution.                              */
+static GDALGridPointIndex* GDALGridPointIndexCreate( GUInt32 nPoints,
+                                                     const double* padfX,
+                                                     const double* padfY )
+{
+    if( nPoints == 0 )
+        return NULL;
+
+    double dfMinX = padfX[0];
+    double dfMinY = padfY[0];
+    double dfMaxX = padfX[0];
+    double dfMaxY = padfY[0];
+    for( GUInt32 i = 1; i < nPoints; i++ )
+    {
+        if( padfX[i] < dfMinX ) dfMinX = padfX[i];
+        if( padfY[i] < dfMinY ) dfMinY = padfY[i];
+        if( padfX[i] > dfMaxX ) dfMaxX = padfX[i];
+        if( padfY[i] > dfMaxY ) dfMaxY = padfY[i];
+    }
+
+    // The second term of the max bounds the number of cells along each
+    // dimension for very elongated (or degenerate) point sets.
+    const double dfWidth = dfMaxX - dfMinX;
+    const double dfHeight = dfMaxY - dfMinY;
+    const double dfTargetCells = std::max(1.0, nPoints / 2.0);
+    double dfCellSize = std::max( sqrt(dfWidth * dfHeight / dfTargetCells),
+                                  std::max(dfWidth, dfHeight) / dfTargetCells );
+    if( !(dfCellSize > 0.0) )
+        dfCellSize = 1.0;
+
+    GDALGridPointIndex* psIndex = (GDALGridPointIndex*)
+        VSI_CALLOC_VERBOSE(1, sizeof(GDALGridPointIndex));
+    if( psIndex == NULL )
+        return NULL;
+    psIndex->dfMinX = dfMinX;
+    psIndex->dfMinY = dfMinY;
+    psIndex->dfMaxX = dfMaxX;
+    psIndex->dfMaxY = dfMaxY;
+    psIndex->dfCellSize = dfCellSize;
+    psIndex->dfInvCellSize = 1.0 / dfCellSize;
+    psIndex->nCellsX = static_cast<int>(dfWidth / dfCellSize) + 1;
+    psIndex->nCellsY = static_cast<int>(dfHeight / dfCellSize) + 1;
+
+    const size_t nCells =
+        static_cast<size_t>(psIndex->nCellsX) * psIndex->nCellsY;
+    psIndex->panCellStart = (GUInt32*)
+        VSI_CALLOC_VERBOSE(nCells + 1, sizeof(GUInt32));
+    psIndex->panPointIdx = (GUInt32*)
+        VSI_MALLOC2_VERBOSE(nPoints, sizeof(GUInt32));
+    GUInt32* panCellOfPoint = (GUInt32*)
+        VSI_MALLOC2_VERBOSE(nPoints, sizeof(GUInt32));
+    if( psIndex->panCellStart == NULL || psIndex->panPointIdx == NULL ||
+        panCellOfPoint == NULL )
+    {
+        VSIFree(panCellOfPoint);
+        GDALGridPointIndexFree(psIndex);
+        return NULL;
+    }
+
+    // Counting sort of the point indices by cell, which keeps them in
+    // increasing order within each cell.
+    for( GUInt32 i = 0; i < nPoints; i++ )
+    {
+        const GUInt32 nCell = static_cast<GUInt32>(
+            GDALGridPointIndexCellY(psIndex, padfY[i]) * psIndex->nCellsX +
+            GDALGridPointIndexCellX(psIndex, padfX[i]));
+        panCellOfPoint[i] = nCell;
+        psIndex->panCellStart[nCell + 1] ++;
+    }
+    for( size_t iCell = 0; iCell < nCells; iCell++ )
+        psIndex->panCellStart[iCell + 1] += psIndex->panCellStart[iCell];
+    for( GUInt32 i = 0; i < nPoints; i++ )
+    {
+        psIndex->panPointIdx[ psIndex->panCellStart[panCellOfPoint[i]] ++ ] = i;
+    }
+    // The fill loop has shifted each start offset to the next cell.
+    for( size_t iCell = nCells; iCell > 0; iCell-- )
+        psIndex->panCellStart[iCell] = psIndex->panCellStart[iCell - 1];
+    psIndex->panCellStart[0] = 0;
+    VSIFree(panCellOfPoint);
+
+    CPLDebug("GDAL_GRID", "Point index of %dx%d cells",
+             psIndex->nCellsX, psIndex->nCellsY);
+
+    return psIndex;
+}
+
+/************************************************************************/
+/*                      GDALGridPointIndexCollect()                     */
+/************************************************************************/
+
+/* Store in the candidate array of psExtraParams the indices of the points */
+/* of all the cells intersecting the passed window. As cells are stored   */
+/* row by row, the cells of a row of the window form a single run.        */
+static bool GDALGridPointIndexCollect( GDALGridExtraParameters* psExtraParams,
+                                       double dfMinX, double dfMinY,
+                                       double dfMaxX, double dfMaxY,
+                                       bool bSorted, GUInt32* pnCount )
+{
+    const GDALGridPointIndex* psIndex = psExtraParams->psPointIndex;
+    *pnCount = 0;
+    if( dfMaxX < psIndex->dfMinX || dfMinX > psIndex->dfMaxX ||
+        dfMaxY < psIndex->dfMinY || dfMinY > psIndex->dfMaxY )
+        return true;
+
+    const int nCX0 = GDALGridPointIndexCellX(psIndex, dfMinX);
+    const int nCX1 = GDALGridPointIndexCellX(psIndex, dfMaxX);
+    const int nCY0 = GDALGridPointIndexCellY(psIndex, dfMinY);
+    const int nCY1 = GDALGridPointIndexCellY(psIndex, dfMaxY);
+    const GUInt32* panCellStart = psIndex->panCellStart;
+
+    GUInt32 nCount = 0;
+    for( int nCY = nCY0; nCY <= nCY1; nCY++ )
+    {
+        const size_t nRowOff = static_cast<size_t>(nCY) * psIndex->nCellsX;
+        nCount += panCellStart[nRowOff + nCX1 + 1] - panCellStart[nRowOff + nCX0];
+    }
+    if( nCount > psExtraParams->nCandidatesAlloc )
+    {
+        const GUInt32 nNewAlloc = nCount + nCount / 3;
+        GUInt32* panNew = (GUInt32*) VSI_REALLOC_VERBOSE(
+            psExtraParams->panCandidates, nNewAlloc * sizeof(GUInt32));
+        if( panNew == NULL )
+            return false;
+        psExtraParams->panCandidates = panNew;
+        psExtraParams->nCandidatesAlloc = nNewAlloc;
+    }
+
+    GUInt32* panCandidates = psExtraParams->panCandidates;
+    for( int nCY = nCY0; nCY <= nCY1; nCY++ )
+    {
+        const size_t nRowOff = static_cast<size_t>(nCY) * psIndex->nCellsX;
+        const GUInt32 nStart = panCellStart[nRowOff + nCX0];
+        const GUInt32 nEnd = panCellStart[nRowOff + nCX1 + 1];
+        memcpy( panCandidates + *pnCount, psIndex->panPointIdx + nStart,
+                (nEnd - nStart) * sizeof(GUInt32) );
+        *pnCount += nEnd - nStart;
+    }
+
+    // Algorithms whose result depends on the order in which points are
+    // visited expect the order of a full scan, which only the points of a
+    // single cell are already in.
+    if( bSorted && (nCX0 != nCX1 || nCY0 != nCY1) )
+        std::sort(panCandidates, panCandidates + *pnCount);
+
+    return true;
+}
+
+/************************************************************************/
+/*                     GDALGridGetEllipseCandidates()                   */
+/************************************************************************/
+
+/* Return the points to test against the search ellipse of the given      */
+/* (non squared) radii and angle in radians: the points of the cells       */
+/* covering the bounding box of the ellipse, or all points (*ppanIdx set   */
+/* to NULL) if there is no point index or no actual ellipse.               */
+static bool GDALGridGetEllipseCandidates( void* hExtraParamsIn,
+                                          GUInt32 nPoints,
+                                          double dfRadius1, double dfRadius2,
+                                          double dfAngle,
+                                          double dfXPoint, double dfYPoint,
+                                          bool bSorted,
+                                          const GUInt32** ppanIdx,
+                                          GUInt32* pnCount )
+{
+    GDALGridExtraParameters* psExtraParams =
+        (GDALGridExtraParameters*) hExtraParamsIn;
+    if( psExtraParams == NULL || psExtraParams->psPointIndex == NULL ||
+        !GDALGridHasSearchEllipse(dfRadius1, dfRadius2) )
+    {
+        *ppanIdx = NULL;
+        *pnCount = nPoints;
+        return true;
+    }
+
+    double dfHalfWidth = std::max(dfRadius1, dfRadius2);
+    double dfHalfHeight = dfHalfWidth;
+    if( dfAngle != 0.0 )
+    {
+        const double dfCos = cos(dfAngle);
+        const double dfSin = sin(dfAngle);
+        dfHalfWidth = sqrt( dfRadius1 * dfRadius1 * dfCos * dfCos +
+                            dfRadius2 * dfRadius2 * dfSin * dfSin );
+        dfHalfHeight = sqrt( dfRadius1 * dfRadius1 * dfSin * dfSin +
+                             dfRadius2 * dfRadius2 * dfCos * dfCos );
+    }
+    // Slack for the rounding errors of the exact test done by the caller.
+    dfHalfWidth += 1e-10 * (dfHalfWidth + fabs(dfXPoint));
+    dfHalfHeight += 1e-10 * (dfHalfHeight + fabs(dfYPoint));
+
+    if( !GDALGridPointIndexCollect( psExtraParams,
+                                    dfXPoint - dfHalfWidth,
+                                    dfYPoint - dfHalfHeight,
+                                    dfXPoint + dfHalfWidth,
+                                    dfYPoint + dfHalfHeight,
+                                    bSorted, pnCount ) )
+        return false;
+    *ppanIdx = psExtraParams->panCandidates;
+    return true;
+}
+
+/************************************************************************/
+/*                      GDALGridPointIndexNearest()                     */
+/************************************************************************/
+
+/* Find the nearest point, visiting rings of cells of increasing size     */
+/* around the cell of the grid node until no unvisited cell can contain a */
+/* closer point. Among equidistant points, the one with the highest index */
+/* is returned, as a full scan with a "<=" test would do.                 */
+static GUInt32 GDALGridPointIndexNearest( const GDALGridPointIndex* psIndex,
+                                          const double* padfX,
+                                          const double* padfY,
+                                          double dfXPoint, double dfYPoint )
+{
+    const int nCX = GDALGridPointIndexCellX(psIndex, dfXPoint);
+    const int nCY = GDALGridPointIndexCellY(psIndex, dfYPoint);
+    const int nCellsX = psIndex->nCellsX;
+    const int nCellsY = psIndex->nCellsY;
+    const double dfSlack = 1e-10 * ( psIndex->dfCellSize +
+                                     fabs(dfXPoint) + fabs(dfYPoint) );
+    double dfNearestR = DBL_MAX;
+    GUInt32 nNearestIdx = 0;
+
+    for( int nRing = 0; ; nRing++ )
+    {
+        const int nCX0 = nCX - nRing;
+        const int nCX1 = nCX + nRing;
+        const int nCY0 = nCY - nRing;
+        const int nCY1 = nCY + nRing;
+        for( int nCY2 = std::max(nCY0, 0);
+             nCY2 <= std::min(nCY1, nCellsY - 1); nCY2++ )
+        {
+            // Whole row on the top and bottom sides of the ring, only
+            // its two ends otherwise.
+            const bool bFullRow = (nCY2 == nCY0 || nCY2 == nCY1);
+            const int nStep = bFullRow ? 1 : std::max(1, nCX1 - nCX0);
+            for( int nCX2 = nCX0; nCX2 <= nCX1; nCX2 += nStep )
+            {
+                if( nCX2 < 0 || nCX2 >= nCellsX )
+                    continue;
+                const size_t nCell =
+                    static_cast<size_t>(nCY2) * nCellsX + nCX2;
+                for( GUInt32 k = psIndex->panCellStart[nCell];
+                     k < psIndex->panCellStart[nCell + 1]; k++ )
+                {
+                    const GUInt32 i = psIndex->panPointIdx[k];
+                    const double dfRX = padfX[i] - dfXPoint;
+                    const double dfRY = padfY[i] - dfYPoint;
+                    const double dfR2 = dfRX * dfRX + dfRY * dfRY;
+                    if( dfR2 < dfNearestR ||
+                        (dfR2 == dfNearestR && i > nNearestIdx) )
+                    {
+                        dfNearestR = dfR2;
+                        nNearestIdx = i;
+                    }
+                }
+            }
+        }
+
+        // Distance from the grid node to the closest side of the visited
+        // square that has cells beyond it.
+        double dfFrontier = DBL_MAX;
+        if( nCX0 > 0 )
+            dfFrontier = std::min(dfFrontier, dfXPoint -
+                (psIndex->dfMinX + nCX0 * psIndex->dfCellSize));
+        if( nCX1 < nCellsX - 1 )
+            dfFrontier = std::min(dfFrontier,
+                psIndex->dfMinX + (nCX1 + 1) * psIndex->dfCellSize - dfXPoint);
+        if( nCY0 > 0 )
+            dfFrontier = std::min(dfFrontier, dfYPoint -
+                (psIndex->dfMinY + nCY0 * psIndex->dfCellSize));
+        if( nCY1 < nCellsY - 1 )
+            dfFrontier = std::min(dfFrontier,
+                psIndex->dfMinY + (nCY1 + 1) * psIndex->dfCellSize - dfYPoint);
+        if( dfFrontier == DBL_MAX )
+            break;
+        dfFrontier -= dfSlack;
+        if( dfFrontier > 0 && dfNearestR < dfFrontier * dfFrontier )
+            break;
+    }
+
+    return nNearestIdx;
+}
 
 /************************************************************************/
 /*                   GDALGridInverseDistanceToAPower()                  */
@@ -123,7 +448,7 @@ GDALGridInverseDistanceToAPower( const void *poOptions, GUInt32 nPoints,
                                  const double *padfZ,
                                  double dfXPoint, double dfYPoint,
                                  double *pdfValue,
-                                 CPL_UNUSED void* hExtraParamsIn )
+                                 void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -157,10 +482,19 @@ GDALGridInverseDistanceToAPower( const void *poOptions, GUInt32 nPoints,
     const GUInt32   nMaxPoints =
         ((GDALGridInverseDistanceToAPowerOptions *)poOptions)->nMaxPoints;
     double  dfNominator = 0.0, dfDenominator = 0.0;
-    GUInt32 i, n = 0;
+    GUInt32 n = 0;
+
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridInverseDistanceToAPowerOptions *)poOptions)->dfRadius1,
+            ((GDALGridInverseDistanceToAPowerOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, true, &panIdx, &nCandidates ) )
+        return CE_Failure;
 
-    for ( i = 0; i < nPoints; i++ )
+    for ( GUInt32 k = 0; k < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX = padfX[i] - dfXPoint;
         double  dfRY = padfY[i] - dfYPoint;
         const double dfR2 =
@@ -278,94 +612,66 @@ GDALGridInverseDistanceToAPowerNearestNeighbor( const void *poOptions, GUInt32 n
     GUInt32 n = 0;
 
     GDALGridExtraParameters* psExtraParams = (GDALGridExtraParameters*) hExtraParamsIn;
-    CPLQuadTree* phQuadTree = psExtraParams->hQuadTree;
 
     const double dfRPower2 = psExtraParams->dfRadiusPower2PreComp;
-    const double dfRPower4 = psExtraParams->dfRadiusPower4PreComp;
 
     const double dfPowerDiv2 = psExtraParams->dfPowerDiv2PreComp;
 
-    std::multimap<double, double> oMapDistanceToZValues;
-    if (phQuadTree != NULL)
-    {
-        CPLRectObj sAoi;
-        double dfSearchRadius = dfRadius;
-        sAoi.minx = dfXPoint - dfSearchRadius;
-        sAoi.miny = dfYPoint - dfSearchRadius;
-        sAoi.maxx = dfXPoint + dfSearchRadius;
-        sAoi.maxy = dfYPoint + dfSearchRadius;
-        int nFeatureCount = 0;
-        GDALGridPoint** papsPoints = (GDALGridPoint**)
-                CPLQuadTreeSearch(phQuadTree, &sAoi, &nFeatureCount);
-        if (nFeatureCount != 0)
-        {
-            for(int k = 0; k < nFeatureCount; k++)
-            {
-                int i = papsPoints[k]->i;
-                double  dfRX = padfX[i] - dfXPoint;
-                double  dfRY = padfY[i] - dfYPoint;
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+                                       dfRadius, dfRadius, 0.0,
+                                       dfXPoint, dfYPoint, true,
+                                       &panIdx, &nCandidates ) )
+        return CE_Failure;
 
-                const double dfR2 = dfRX * dfRX + dfRY * dfRY;
-                if (dfR2 < 0.0000000000001)
-                {
-                    (*pdfValue) = padfZ[i];
-                    CPLFree(papsPoints);
-                    return CE_None;
-                }
-                if(dfR2 <= dfRPower2)
-                {
-                    oMapDistanceToZValues.insert(std::make_pair(dfR2, padfZ[i]));
-                }
-            }
-        }
-        CPLFree(papsPoints);
-    }
-    else
+    // Squared distance and index of the points within the search circle.
+    std::vector<std::pair<double, GUInt32> > aoDistanceToPoints;
+    for( GUInt32 k = 0; k < nCandidates; k++ )
     {
-        for (GUInt32 i = 0; i < nPoints; i++)
-        {
-            double dfRX = padfX[i] - dfXPoint;
-            double dfRY = padfY[i] - dfYPoint;
-            const double dfR2 =    dfRX * dfRX + dfRY * dfRY;
+        const GUInt32 i = panIdx ? panIdx[k] : k;
+        double  dfRX = padfX[i] - dfXPoint;
+        double  dfRY = padfY[i] - dfYPoint;
 
-            // Is this point located inside the search circle?
-            if (dfRPower2 * dfRX * dfRX + dfRPower2 * dfRY * dfRY <= dfRPower4)
-            {
-                // If the test point is close to the grid node, use the point
-                // value directly as a node value to avoid singularity.
-                if (dfR2 < 0.0000000000001)
-                {
-                    (*pdfValue) = padfZ[i];
-                    return CE_None;
-                }
-                else
-                {
-                    oMapDistanceToZValues.insert(std::make_pair(dfR2, padfZ[i]));
-                }
-            }
+        const double dfR2 = dfRX * dfRX + dfRY * dfRY;
+        // If the test point is close to the grid node, use the point
+        // value directly as a node value to avoid singularity.
+        if (dfR2 < 0.0000000000001)
+        {
+            (*pdfValue) = padfZ[i];
+            return CE_None;
+        }
+        if(dfR2 <= dfRPower2)
+        {
+            aoDistanceToPoints.push_back(std::make_pair(dfR2, i));
         }
     }
 
     /**
-     * Examine all "neighbors" within the radius (sorted by distance via the multimap), and use the
-     * closest n points based on distance until the max is reached.
+     * Use the closest n points within the radius, sorted by distance (and
+     * index for equidistant points), until the max is reached.
      */
-    for(std::multimap<double, double>::iterator oMapDistanceToZValuesIter = oMapDistanceToZValues.begin();
-        oMapDistanceToZValuesIter != oMapDistanceToZValues.end();
-        ++oMapDistanceToZValuesIter)
+    size_t nUsed = aoDistanceToPoints.size();
+    if( nMaxPoints > 0 && nMaxPoints < nUsed )
+    {
+        nUsed = nMaxPoints;
+        std::partial_sort(aoDistanceToPoints.begin(),
+                          aoDistanceToPoints.begin() + nUsed,
+                          aoDistanceToPoints.end());
+    }
+    else
+        std::sort(aoDistanceToPoints.begin(), aoDistanceToPoints.end());
+
+    for( size_t k = 0; k < nUsed; k++ )
     {
-        double dfR2 = (*oMapDistanceToZValuesIter).first;
-        double dfZ = (*oMapDistanceToZValuesIter).second;
+        const double dfR2 = aoDistanceToPoints[k].first;
+        const double dfZ = padfZ[aoDistanceToPoints[k].second];
 
         const double dfW = pow(dfR2, dfPowerDiv2);
         double dfInvW = 1.0 / dfW;
         dfNominator += dfInvW * dfZ;
         dfDenominator += dfInvW;
         n++;
-        if (nMaxPoints > 0 && n >= nMaxPoints)
-        {
-            break;
-        }
     }
 
     if (n < ((GDALGridInverseDistanceToAPowerNearestNeighborOptions *)poOptions)->nMinPoints
@@ -541,7 +847,7 @@ GDALGridMovingAverage( const void *poOptions, GUInt32 nPoints,
                        const double *padfX, const double *padfY,
                        const double *padfZ,
                        double dfXPoint, double dfYPoint, double *pdfValue,
-                       CPL_UNUSED void* hExtraParamsIn )
+                       void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -567,10 +873,19 @@ GDALGridMovingAverage( const void *poOptions, GUInt32 nPoints,
     }
 
     double  dfAccumulator = 0.0;
-    GUInt32 i = 0, n = 0;
+    GUInt32 n = 0;
 
-    while ( i < nPoints )
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridMovingAverageOptions *)poOptions)->dfRadius1,
+            ((GDALGridMovingAverageOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, true, &panIdx, &nCandidates ) )
+        return CE_Failure;
+
+    for ( GUInt32 k = 0; k < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX = padfX[i] - dfXPoint;
         double  dfRY = padfY[i] - dfYPoint;
 
@@ -589,8 +904,6 @@ GDALGridMovingAverage( const void *poOptions, GUInt32 nPoints,
             dfAccumulator += padfZ[i];
             n++;
         }
-
-        i++;
     }
 
     if ( n < ((GDALGridMovingAverageOptions *)poOptions)->nMinPoints
@@ -647,8 +960,8 @@ GDALGridNearestNeighbor( const void *poOptions, GUInt32 nPoints,
     double  dfRadius2 =
         ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius2;
     double  dfR12;
-    GDALGridExtraParameters* psExtraParams = (GDALGridExtraParameters*) hExtraParamsIn;
-    CPLQuadTree* hQuadTree = psExtraParams->hQuadTree;
+    const GDALGridExtraParameters* psExtraParams =
+        (const GDALGridExtraParameters*) hExtraParamsIn;
 
     dfRadius1 *= dfRadius1;
     dfRadius2 *= dfRadius2;
@@ -671,58 +984,26 @@ GDALGridNearestNeighbor( const void *poOptions, GUInt32 nPoints,
     // Nearest distance will be initialized with the distance to the first
     // point in array.
     double      dfNearestR = DBL_MAX;
-    GUInt32 i = 0;
 
-    double dfSearchRadius = psExtraParams->dfInitialSearchRadius;
-    if( hQuadTree != NULL && dfRadius1 == dfRadius2 && dfSearchRadius > 0 )
+    if( psExtraParams != NULL && psExtraParams->psPointIndex != NULL &&
+        dfRadius1 == 0.0 && dfRadius2 == 0.0 && nPoints > 0 )
     {
-        CPLRectObj sAoi;
-        if( dfRadius1 > 0 )
-            dfSearchRadius = ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius1;
-        while(dfSearchRadius > 0)
-        {
-            sAoi.minx = dfXPoint - dfSearchRadius;
-            sAoi.miny = dfYPoint - dfSearchRadius;
-            sAoi.maxx = dfXPoint + dfSearchRadius;
-            sAoi.maxy = dfYPoint + dfSearchRadius;
-            int nFeatureCount = 0;
-            GDALGridPoint** papsPoints = (GDALGridPoint**)
-                    CPLQuadTreeSearch(hQuadTree, &sAoi, &nFeatureCount);
-            if( nFeatureCount != 0 )
-            {
-                if( dfRadius1 > 0 )
-                    dfNearestR = dfRadius1;
-                for(int k=0; k<nFeatureCount; k++)
-                {
-                    int idx = papsPoints[k]->i;
-                    double  dfRX = padfX[idx] - dfXPoint;
-                    double  dfRY = padfY[idx] - dfYPoint;
-
-                    const double    dfR2 = dfRX * dfRX + dfRY * dfRY;
-                    if( dfR2 <= dfNearestR )
-                    {
-                        dfNearestR = dfR2;
-                        dfNearestValue = padfZ[idx];
-                    }
-                }
-
-                CPLFree(papsPoints);
-                break;
-            }
-            else
-            {
-                CPLFree(papsPoints);
-                if( dfRadius1 > 0 )
-                    break;
-                dfSearchRadius *= 2;
-                //CPLDebug("GDAL_GRID", "Increasing search radius to %.16g", dfSearchRadius);
-            }
-        }
+        dfNearestValue = padfZ[ GDALGridPointIndexNearest(
+            psExtraParams->psPointIndex, padfX, padfY, dfXPoint, dfYPoint ) ];
     }
     else
     {
-        while ( i < nPoints )
+        const GUInt32 *panIdx = NULL;
+        GUInt32 nCandidates = 0;
+        if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+                ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius1,
+                ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius2,
+                dfAngle, dfXPoint, dfYPoint, true, &panIdx, &nCandidates ) )
+            return CE_Failure;
+
+        for ( GUInt32 k = 0; k < nCandidates; k++ )
         {
+            const GUInt32 i = panIdx ? panIdx[k] : k;
             double  dfRX = padfX[i] - dfXPoint;
             double  dfRY = padfY[i] - dfYPoint;
 
@@ -745,8 +1026,6 @@ GDALGridNearestNeighbor( const void *poOptions, GUInt32 nPoints,
                     dfNearestValue = padfZ[i];
                 }
             }
-
-            i++;
         }
     }
 
@@ -795,7 +1074,7 @@ GDALGridDataMetricMinimum( const void *poOptions, GUInt32 nPoints,
                            const double *padfX, const double *padfY,
                            const double *padfZ,
                            double dfXPoint, double dfYPoint, double *pdfValue,
-                           CPL_UNUSED void* hExtraParamsIn )
+                           void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -823,10 +1102,19 @@ GDALGridDataMetricMinimum( const void *poOptions, GUInt32 nPoints,
     }
 
     double      dfMinimumValue=0.0;
-    GUInt32     i = 0, n = 0;
+    GUInt32     n = 0;
+
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, false, &panIdx, &nCandidates ) )
+        return CE_Failure;
 
-    while ( i < nPoints )
+    for ( GUInt32 k = 0; k < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX = padfX[i] - dfXPoint;
         double  dfRY = padfY[i] - dfYPoint;
 
@@ -851,8 +1139,6 @@ GDALGridDataMetricMinimum( const void *poOptions, GUInt32 nPoints,
                 dfMinimumValue = padfZ[i];
             n++;
         }
-
-        i++;
     }
 
     if ( n < ((GDALGridDataMetricsOptions *)poOptions)->nMinPoints
@@ -907,7 +1193,7 @@ GDALGridDataMetricMaximum( const void *poOptions, GUInt32 nPoints,
                            const double *padfX, const double *padfY,
                            const double *padfZ,
                            double dfXPoint, double dfYPoint, double *pdfValue,
-                           CPL_UNUSED void* hExtraParamsIn )
+                           void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -935,10 +1221,19 @@ GDALGridDataMetricMaximum( const void *poOptions, GUInt32 nPoints,
     }
 
     double      dfMaximumValue=0.0;
-    GUInt32     i = 0, n = 0;
+    GUInt32     n = 0;
+
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, false, &panIdx, &nCandidates ) )
+        return CE_Failure;
 
-    while ( i < nPoints )
+    for ( GUInt32 k = 0; k < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX = padfX[i] - dfXPoint;
         double  dfRY = padfY[i] - dfYPoint;
 
@@ -963,8 +1258,6 @@ GDALGridDataMetricMaximum( const void *poOptions, GUInt32 nPoints,
                 dfMaximumValue = padfZ[i];
             n++;
         }
-
-        i++;
     }
 
     if ( n < ((GDALGridDataMetricsOptions *)poOptions)->nMinPoints
@@ -1020,7 +1313,7 @@ GDALGridDataMetricRange( const void *poOptions, GUInt32 nPoints,
                          const double *padfX, const double *padfY,
                          const double *padfZ,
                          double dfXPoint, double dfYPoint, double *pdfValue,
-                         CPL_UNUSED void* hExtraParamsIn )
+                         void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -1048,10 +1341,19 @@ GDALGridDataMetricRange( const void *poOptions, GUInt32 nPoints,
     }
 
     double      dfMaximumValue=0.0, dfMinimumValue=0.0;
-    GUInt32     i = 0, n = 0;
+    GUInt32     n = 0;
+
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, false, &panIdx, &nCandidates ) )
+        return CE_Failure;
 
-    while ( i < nPoints )
+    for ( GUInt32 k = 0; k < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX = padfX[i] - dfXPoint;
         double  dfRY = padfY[i] - dfYPoint;
 
@@ -1078,8 +1380,6 @@ GDALGridDataMetricRange( const void *poOptions, GUInt32 nPoints,
                 dfMinimumValue = dfMaximumValue = padfZ[i];
             n++;
         }
-
-        i++;
     }
 
     if ( n < ((GDALGridDataMetricsOptions *)poOptions)->nMinPoints
@@ -1132,7 +1432,7 @@ GDALGridDataMetricCount( const void *poOptions, GUInt32 nPoints,
                          const double *padfX, const double *padfY,
                          CPL_UNUSED const double *padfZ,
                          double dfXPoint, double dfYPoint, double *pdfValue,
-                         CPL_UNUSED void* hExtraParamsIn )
+                         void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -1159,10 +1459,19 @@ GDALGridDataMetricCount( const void *poOptions, GUInt32 nPoints,
         dfCoeff2 = sin(dfAngle);
     }
 
-    GUInt32     i = 0, n = 0;
+    GUInt32     n = 0;
+
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, false, &panIdx, &nCandidates ) )
+        return CE_Failure;
 
-    while ( i < nPoints )
+    for ( GUInt32 k = 0; k < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX = padfX[i] - dfXPoint;
         double  dfRY = padfY[i] - dfYPoint;
 
@@ -1178,8 +1487,6 @@ GDALGridDataMetricCount( const void *poOptions, GUInt32 nPoints,
         // Is this point located inside the search ellipse?
         if ( dfRadius2 * dfRX * dfRX + dfRadius1 * dfRY * dfRY <= dfR12 )
             n++;
-
-        i++;
     }
 
     if ( n < ((GDALGridDataMetricsOptions *)poOptions)->nMinPoints )
@@ -1236,7 +1543,7 @@ GDALGridDataMetricAverageDistance( const void *poOptions, GUInt32 nPoints,
                                    CPL_UNUSED const double *padfZ,
                                    double dfXPoint, double dfYPoint,
                                    double *pdfValue,
-                                   CPL_UNUSED void* hExtraParamsIn )
+                                   void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -1264,10 +1571,19 @@ GDALGridDataMetricAverageDistance( const void *poOptions, GUInt32 nPoints,
     }
 
     double      dfAccumulator = 0.0;
-    GUInt32     i = 0, n = 0;
+    GUInt32     n = 0;
+
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, true, &panIdx, &nCandidates ) )
+        return CE_Failure;
 
-    while ( i < nPoints )
+    for ( GUInt32 k = 0; k < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX = padfX[i] - dfXPoint;
         double  dfRY = padfY[i] - dfYPoint;
 
@@ -1286,8 +1602,6 @@ GDALGridDataMetricAverageDistance( const void *poOptions, GUInt32 nPoints,
             dfAccumulator += sqrt( dfRX * dfRX + dfRY * dfRY );
             n++;
         }
-
-        i++;
     }
 
     if ( n < ((GDALGridDataMetricsOptions *)poOptions)->nMinPoints
@@ -1347,7 +1661,7 @@ GDALGridDataMetricAverageDistancePts( const void *poOptions, GUInt32 nPoints,
                                       CPL_UNUSED const double *padfZ,
                                       double dfXPoint, double dfYPoint,
                                       double *pdfValue,
-                                      CPL_UNUSED void* hExtraParamsIn )
+                                      void* hExtraParamsIn )
 {
     // TODO: For optimization purposes pre-computed parameters should be moved
     // out of this routine to the calling function.
@@ -1375,11 +1689,20 @@ GDALGridDataMetricAverageDistancePts( const void *poOptions, GUInt32 nPoints,
     }
 
     double      dfAccumulator = 0.0;
-    GUInt32     i = 0, n = 0;
+    GUInt32     n = 0;
+
+    const GUInt32 *panIdx = NULL;
+    GUInt32 nCandidates = 0;
+    if( !GDALGridGetEllipseCandidates( hExtraParamsIn, nPoints,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+            ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2,
+            dfAngle, dfXPoint, dfYPoint, true, &panIdx, &nCandidates ) )
+        return CE_Failure;
 
     // Search for the first point within the search ellipse
-    while ( i < nPoints - 1 )
+    for ( GUInt32 k = 0; k + 1 < nCandidates; k++ )
     {
+        const GUInt32 i = panIdx ? panIdx[k] : k;
         double  dfRX1 = padfX[i] - dfXPoint;
         double  dfRY1 = padfY[i] - dfYPoint;
 
@@ -1395,12 +1718,11 @@ GDALGridDataMetricAverageDistancePts( const void *poOptions, GUInt32 nPoints,
         // Is this point located inside the search ellipse?
         if ( dfRadius2 * dfRX1 * dfRX1 + dfRadius1 * dfRY1 * dfRY1 <= dfR12 )
         {
-            GUInt32 j;
-
             // Search all the remaining points within the ellipse and compute
             // distances between them and the first point
-            for ( j = i + 1; j < nPoints; j++ )
+            for ( GUInt32 l = k + 1; l < nCandidates; l++ )
             {
+                const GUInt32 j = panIdx ? panIdx[l] : l;
                 double  dfRX2 = padfX[j] - dfXPoint;
                 double  dfRY2 = padfY[j] - dfYPoint;
 
@@ -1423,8 +1745,6 @@ GDALGridDataMetricAverageDistancePts( const void *poOptions, GUInt32 nPoints,
                 }
             }
         }
-
-        i++;
     }
 
     if ( n < ((GDALGridDataMetricsOptions *)poOptions)->nMinPoints
@@ -1439,6 +1759,37 @@ GDALGridDataMetricAverageDistancePts( const void *poOptions, GUInt32 nPoints,
     return CE_None;
 }
 
+/************************************************************************/
+/*                        GDALGridLinearJump()                          */
+/************************************************************************/
+
+/* Select a starting triangle for the walk, among a sample of about the     */
+/* cubic root of the number of triangles, as the one whose first vertex is  */
+/* the closest to the point. This bounds the expected length of the walk.  */
+static int GDALGridLinearJump( const GDALTriangulation* psTriangulation,
+                               const double *padfX, const double *padfY,
+                               double dfXPoint, double dfYPoint )
+{
+    const int nFacets = psTriangulation->nFacets;
+    const int nSamples = std::max(1, static_cast<int>(pow(nFacets, 1.0 / 3)));
+    const int nStep = std::max(1, nFacets / nSamples);
+    int nBestIdx = 0;
+    double dfBestDist = 0.0;
+    for( int i = 0; i < nFacets; i += nStep )
+    {
+        const int nVertex = psTriangulation->pasFacets[i].anVertexIdx[0];
+        const double dfDX = padfX[nVertex] - dfXPoint;
+        const double dfDY = padfY[nVertex] - dfYPoint;
+        const double dfDist = dfDX * dfDX + dfDY * dfDY;
+        if( i == 0 || dfDist < dfBestDist )
+        {
+            nBestIdx = i;
+            dfBestDist = dfDist;
+        }
+    }
+    return nBestIdx;
+}
+
 /************************************************************************/
 /*                        GDALGridLinear()                              */
 /************************************************************************/
@@ -1478,14 +1829,33 @@ GDALGridLinear( const void *poOptions, CPL_UNUSED GUInt32 nPoints,
     GDALGridExtraParameters* psExtraParams = (GDALGridExtraParameters*) hExtraParams;
     GDALTriangulation* psTriangulation = psExtraParams->psTriangulation;
 
+    // Nodes are processed line by line, so start walking from the triangle
+    // of the previous node, or of the first node of the previous line when
+    // starting a new one. Only the very first node needs a jump.
+    int nStartFacetIdx = psExtraParams->nInitialFacetIdx;
+    const bool bNewLine = ( nStartFacetIdx < 0 ||
+                            dfYPoint != psExtraParams->dfLastLineY );
+    if( bNewLine )
+    {
+        nStartFacetIdx = psExtraParams->nLineStartFacetIdx;
+        if( nStartFacetIdx < 0 )
+            nStartFacetIdx = GDALGridLinearJump( psTriangulation,
+                                                 padfX, padfY,
+                                                 dfXPoint, dfYPoint );
+    }
+
     int nOutputFacetIdx = -1;
     int bRet = GDALTriangulationFindFacetDirected( psTriangulation,
-                                                   psExtraParams->nInitialFacetIdx,
+                                                   nStartFacetIdx,
                                                    dfXPoint, dfYPoint,
                                                    &nOutputFacetIdx );
     CPLAssert(nOutputFacetIdx >= 0);
-    // Reuse output facet idx as next initial index since we proceed line by line
     psExtraParams->nInitialFacetIdx = nOutputFacetIdx;
+    if( bNewLine )
+    {
+        psExtraParams->nLineStartFacetIdx = nOutputFacetIdx;
+        psExtraParams->dfLastLineY = dfYPoint;
+    }
 
     if( bRet )
     {
@@ -1640,8 +2010,10 @@ static void GDALGridJobProcess(void* user_data)
     const void *poOptions = psJob->poOptions;
     GDALGridFunction  pfnGDALGridMethod = psJob->pfnGDALGridMethod;
     // Have a local copy of sExtraParameters since we want to modify
-    // nInitialFacetIdx
+    // nInitialFacetIdx and own a candidate array
     GDALGridExtraParameters sExtraParameters = *(psJob->psExtraParameters);
+    sExtraParameters.panCandidates = NULL;
+    sExtraParameters.nCandidatesAlloc = 0;
     GDALDataType eType = psJob->eType;
     int (*pfnProgress)(GDALGridJob* psJob) = psJob->pfnProgress;
 
@@ -1694,6 +2066,7 @@ static void GDALGridJobProcess(void* user_data)
     }
 
     CPLFree(padfValues);
+    CPLFree(sExtraParameters.panCandidates);
 }
 
 /************************************************************************/
@@ -1707,8 +2080,6 @@ struct GDALGridContext
     GDALGridFunction    pfnGDALGridMethod;
 
     GUInt32             nPoints;
-    GDALGridPoint      *pasGridPoints;
-    GDALGridXYArrays    sXYArrays;
 
     GDALGridExtraParameters sExtraParameters;
     double*             padfX;
@@ -1723,7 +2094,7 @@ struct GDALGridContext
     CPLWorkerThreadPool *poWorkerThreadPool;
 };
 
-static void GDALGridContextCreateQuadTree(GDALGridContext* psContext);
+static void GDALGridContextCreatePointIndex(GDALGridContext* psContext);
 
 /**
  * Creates a context to do regular gridding from the scattered data.
@@ -1744,6 +2115,10 @@ static void GDALGridContextCreateQuadTree(GDALGridContext* psContext);
  * instruction set. This can be disabled by setting the GDAL_USE_AVX
  * configuration option to NO.
  *
+ * Algorithms using a search ellipse, as well as the nearest neighbour one,
+ * build a spatial index of the points (uniform grid of buckets) so that
+ * only the points close to each grid node are examined.
+ *
  * It is possible to set the GDAL_NUM_THREADS
  * configuration option to parallelize the processing. The value to set is
  * the number of worker threads, or ALL_CPUS to use all the cores/CPUs of the
@@ -1776,7 +2151,7 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
     CPLAssert( padfX );
     CPLAssert( padfY );
     CPLAssert( padfZ );
-    int bCreateQuadTree = FALSE;
+    int bCreatePointIndex = FALSE;
 
     /* Potentially unaligned pointers */
     void* pabyX = NULL;
@@ -1882,7 +2257,12 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
                 }
             }
             else
+            {
                 pfnGDALGridMethod = GDALGridInverseDistanceToAPower;
+                bCreatePointIndex = GDALGridHasSearchEllipse(
+                    ((GDALGridInverseDistanceToAPowerOptions *)poOptions)->dfRadius1,
+                    ((GDALGridInverseDistanceToAPowerOptions *)poOptions)->dfRadius2);
+            }
             break;
 
         case GGA_InverseDistanceToAPowerNearestNeighbor:
@@ -1890,7 +2270,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridInverseDistanceToAPowerNearestNeighborOptions));
 
             pfnGDALGridMethod = GDALGridInverseDistanceToAPowerNearestNeighbor;
-            bCreateQuadTree = TRUE;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridInverseDistanceToAPowerNearestNeighborOptions *)poOptions)->dfRadius,
+                ((GDALGridInverseDistanceToAPowerNearestNeighborOptions *)poOptions)->dfRadius);
             break;
 
         case GGA_MovingAverage:
@@ -1898,6 +2280,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridMovingAverageOptions));
 
             pfnGDALGridMethod = GDALGridMovingAverage;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridMovingAverageOptions *)poOptions)->dfRadius1,
+                ((GDALGridMovingAverageOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_NearestNeighbor:
@@ -1905,9 +2290,13 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridNearestNeighborOptions));
 
             pfnGDALGridMethod = GDALGridNearestNeighbor;
-            bCreateQuadTree = (nPoints > 100 &&
-                (((GDALGridNearestNeighborOptions *)poOptions)->dfRadius1 ==
-                ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius2));
+            // Also used without search ellipse to find the nearest point.
+            bCreatePointIndex =
+                (((GDALGridNearestNeighborOptions *)poOptions)->dfRadius1 == 0.0 &&
+                 ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius2 == 0.0) ||
+                GDALGridHasSearchEllipse(
+                    ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius1,
+                    ((GDALGridNearestNeighborOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_MetricMinimum:
@@ -1915,6 +2304,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridDataMetricsOptions));
 
             pfnGDALGridMethod = GDALGridDataMetricMinimum;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_MetricMaximum:
@@ -1922,6 +2314,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridDataMetricsOptions));
 
             pfnGDALGridMethod = GDALGridDataMetricMaximum;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_MetricRange:
@@ -1929,6 +2324,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridDataMetricsOptions));
 
             pfnGDALGridMethod = GDALGridDataMetricRange;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_MetricCount:
@@ -1936,6 +2334,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridDataMetricsOptions));
 
             pfnGDALGridMethod = GDALGridDataMetricCount;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_MetricAverageDistance:
@@ -1943,6 +2344,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridDataMetricsOptions));
 
             pfnGDALGridMethod = GDALGridDataMetricAverageDistance;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_MetricAverageDistancePts:
@@ -1950,6 +2354,9 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
             memcpy(poOptionsNew, poOptions, sizeof(GDALGridDataMetricsOptions));
 
             pfnGDALGridMethod = GDALGridDataMetricAverageDistancePts;
+            bCreatePointIndex = GDALGridHasSearchEllipse(
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius1,
+                ((GDALGridDataMetricsOptions *)poOptions)->dfRadius2);
             break;
 
         case GGA_Linear:
@@ -1992,16 +2399,16 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
     psContext->poOptions = poOptionsNew;
     psContext->pfnGDALGridMethod = pfnGDALGridMethod;
     psContext->nPoints = nPoints;
-    psContext->pasGridPoints = NULL;
-    psContext->sXYArrays.padfX = padfX;
-    psContext->sXYArrays.padfY = padfY;
-    psContext->sExtraParameters.hQuadTree = NULL;
-    psContext->sExtraParameters.dfInitialSearchRadius = 0;
+    psContext->sExtraParameters.psPointIndex = NULL;
+    psContext->sExtraParameters.panCandidates = NULL;
+    psContext->sExtraParameters.nCandidatesAlloc = 0;
     psContext->sExtraParameters.pafX = pafXAligned;
     psContext->sExtraParameters.pafY = pafYAligned;
     psContext->sExtraParameters.pafZ = pafZAligned;
     psContext->sExtraParameters.psTriangulation = NULL;
-    psContext->sExtraParameters.nInitialFacetIdx = 0;
+    psContext->sExtraParameters.nInitialFacetIdx = -1;
+    psContext->sExtraParameters.nLineStartFacetIdx = -1;
+    psContext->sExtraParameters.dfLastLineY = 0.0;
     psContext->padfX = pafXAligned ? NULL : (double*)padfX;
     psContext->padfY = pafXAligned ? NULL : (double*)padfY;
     psContext->padfZ = pafXAligned ? NULL : (double*)padfZ;
@@ -2011,11 +2418,11 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
     psContext->pabyZ = pabyZ;
 
 /* -------------------------------------------------------------------- */
-/*  Create quadtree if requested and possible.                          */
+/*  Create point index if requested and possible.                       */
 /* -------------------------------------------------------------------- */
-    if( bCreateQuadTree )
+    if( bCreatePointIndex )
     {
-        GDALGridContextCreateQuadTree(psContext);
+        GDALGridContextCreatePointIndex(psContext);
     }
 
     /* -------------------------------------------------------------------- */
@@ -2077,52 +2484,15 @@ GDALGridContextCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
 }
 
 /************************************************************************/
-/*                      GDALGridContextCreateQuadTree()                 */
+/*                     GDALGridContextCreatePointIndex()                */
 /************************************************************************/
 
-void GDALGridContextCreateQuadTree(GDALGridContext* psContext)
+void GDALGridContextCreatePointIndex(GDALGridContext* psContext)
 {
-    GUInt32 nPoints = psContext->nPoints;
-    psContext->pasGridPoints = (GDALGridPoint*)
-            VSI_MALLOC2_VERBOSE(nPoints, sizeof(GDALGridPoint));
-    if( psContext->pasGridPoints != NULL )
-    {
-        const double* padfX = psContext->padfX;
-        const double* padfY = psContext->padfY;
-
-        CPLRectObj sRect;
-        GUInt32 i;
-
-        /* Determine point extents */
-        sRect.minx = padfX[0];
-        sRect.miny = padfY[0];
-        sRect.maxx = padfX[0];
-        sRect.maxy = padfY[0];
-        for(i = 1; i < nPoints; i++)
-        {
-            if( padfX[i] < sRect.minx ) sRect.minx = padfX[i];
-            if( padfY[i] < sRect.miny ) sRect.miny = padfY[i];
-            if( padfX[i] > sRect.maxx ) sRect.maxx = padfX[i];
-            if( padfY[i] > sRect.maxy ) sRect.maxy = padfY[i];
-        }
-
-        /* Initial value for search radius is the typical dimension of a */
-        /* "pixel" of the point array (assuming rather uniform distribution) */
-        psContext->sExtraParameters.dfInitialSearchRadius =
-                                sqrt((sRect.maxx - sRect.minx) *
-                                        (sRect.maxy - sRect.miny) / nPoints);
-
-        psContext->sExtraParameters.hQuadTree =
-                    CPLQuadTreeCreate(&sRect, GDALGridGetPointBounds );
-
-        for(i = 0; i < nPoints; i++)
-        {
-            psContext->pasGridPoints[i].psXYArrays = &(psContext->sXYArrays);
-            psContext->pasGridPoints[i].i = i;
-            CPLQuadTreeInsert(psContext->sExtraParameters.hQuadTree,
-                                psContext->pasGridPoints + i);
-        }
-    }
+    // Without index, algorithms fall back to scanning all points.
+    psContext->sExtraParameters.psPointIndex =
+        GDALGridPointIndexCreate( psContext->nPoints,
+                                  psContext->padfX, psContext->padfY );
 }
 
 /************************************************************************/
@@ -2141,9 +2511,7 @@ void GDALGridContextFree(GDALGridContext* psContext)
     if( psContext )
     {
         CPLFree( psContext->poOptions );
-        CPLFree( psContext->pasGridPoints );
-        if( psContext->sExtraParameters.hQuadTree != NULL )
-            CPLQuadTreeDestroy( psContext->sExtraParameters.hQuadTree );
+        GDALGridPointIndexFree( psContext->sExtraParameters.psPointIndex );
         if( psContext->bFreePadfXYZArrays )
         {
             CPLFree(psContext->padfX);
@@ -2212,7 +2580,7 @@ CPLErr GDALGridContextProcess(GDALGridContext* psContext,
     // by sampling along the edges (if all points on edges are within triangles,
     // then interior points will also be!)
     if( psContext->eAlgorithm == GGA_Linear &&
-        psContext->sExtraParameters.hQuadTree == NULL )
+        psContext->sExtraParameters.psPointIndex == NULL )
     {
         int bNeedNearest = FALSE;
         int nStartLeft = 0, nStartRight = 0;
@@ -2262,7 +2630,7 @@ CPLErr GDALGridContextProcess(GDALGridContext* psContext,
         if( bNeedNearest )
         {
             CPLDebug("GDAL_GRID", "Will need nearest neighbour");
-            GDALGridContextCreateQuadTree(psContext);
+            GDALGridContextCreatePointIndex(psContext);
         }
     }
 
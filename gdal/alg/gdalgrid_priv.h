@@ -28,29 +28,42 @@
  ****************************************************************************/
 
 #include "cpl_error.h"
-#include "cpl_quad_tree.h"
 
+/*! Uniform grid of point buckets, used to answer search ellipse and
+ *  nearest neighbour queries without scanning the whole point set.
+ *  Indices of the points falling into a cell are stored contiguously
+ *  (and in increasing order) in panPointIdx, starting at
+ *  panCellStart[nCell], with cells ordered row by row. */
 typedef struct
 {
-    const double* padfX;
-    const double* padfY;
-} GDALGridXYArrays;
+    double   dfMinX;
+    double   dfMinY;
+    double   dfMaxX;
+    double   dfMaxY;
+    double   dfCellSize;
+    double   dfInvCellSize;
+    int      nCellsX;
+    int      nCellsY;
+    GUInt32 *panCellStart;
+    GUInt32 *panPointIdx;
+} GDALGridPointIndex;
 
 typedef struct
 {
-    GDALGridXYArrays* psXYArrays;
-    int               i;
-} GDALGridPoint;
-
-typedef struct
-{
-    CPLQuadTree* hQuadTree;
-    double       dfInitialSearchRadius;
+    GDALGridPointIndex* psPointIndex;
+    /*! Scratch array of candidate point indices, owned by each job. */
+    GUInt32     *panCandidates;
+    GUInt32      nCandidatesAlloc;
     const float *pafX;
     const float *pafY;
     const float *pafZ;
     GDALTriangulation* psTriangulation;
+    /*! Triangle of the previous grid node, or -1. */
     int                nInitialFacetIdx;
+    /*! Triangle of the first node of the previous scanline, or -1. */
+    int                nLineStartFacetIdx;
+    /*! Y coordinate of the previous grid node. */
+    double             dfLastLineY;
     /*! Weighting power divided by 2 (pre-computation). */
     double  dfPowerDiv2PreComp;
     /*! The radius of search circle squared (pre-computation). */
@@ -52,8 +52,8 @@ static void Usage(const char* pszErrorMsg = NULL)
         "    [-clipsrcwhere expression]\n"
         "    [-l layername]* [-where expression] [-sql select_statement]\n"
         "    [-txe xmin xmax] [-tye ymin ymax] [-outsize xsize ysize]\n"
-        "    [-a algorithm[:parameter1=value1]*]"
-        "    [-q]\n"
+        "    [-a algorithm[:parameter1=value1]*]\n"
+        "    [-stream] [-stream_tile_size size] [-q]\n"
         "    <src_datasource> <dst_filename>\n"
         "\n"
         "Available algorithms and parameters with their defaults:\n"
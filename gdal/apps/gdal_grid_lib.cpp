@@ -36,10 +36,12 @@
 #include "ogrsf_frmts.h"
 #include "gdalgrid.h"
 #include "gdal_utils_priv.h"
+#include "cpl_worker_thread_pool.h"
 
 #include <cstdlib>
 #include <vector>
 #include <algorithm>
+#include <new>
 
 CPL_CVSID("$Id$");
 
@@ -93,6 +95,8 @@ struct GDALGridOptions
     char            *pszClipSrcWhere;
     int              bNoDataSet;
     double           dfNoDataValue;
+    int              bStream;
+    int              nStreamTileSize;
 };
 
 /************************************************************************/
@@ -334,6 +338,661 @@ static void ProcessCommonGeometry(OGRGeometry* poGeom, OGRGeometry *poClipSrc,
     }
 }
 
+/************************************************************************/
+/*                           PrintGridInfo()                            */
+/************************************************************************/
+
+static void PrintGridInfo( GDALDataType eType, int nXSize, int nYSize,
+                           double dfXMin, double dfXMax,
+                           double dfYMin, double dfYMax,
+                           GUIntBig nPointCount,
+                           GDALGridAlgorithm eAlgorithm, void *pOptions )
+{
+    const double    dfDeltaX = ( dfXMax - dfXMin ) / nXSize;
+    const double    dfDeltaY = ( dfYMax - dfYMin ) / nYSize;
+
+    printf( "Grid data type is \"%s\"\n", GDALGetDataTypeName(eType) );
+    printf( "Grid size = (%lu %lu).\n",
+            (unsigned long)nXSize, (unsigned long)nYSize );
+    CPLprintf( "Corner coordinates = (%f %f)-(%f %f).\n",
+            dfXMin - dfDeltaX / 2, dfYMax + dfDeltaY / 2,
+            dfXMax + dfDeltaX / 2, dfYMin - dfDeltaY / 2 );
+    CPLprintf( "Grid cell size = (%f %f).\n", dfDeltaX, dfDeltaY );
+    printf( "Source point count = " CPL_FRMT_GUIB ".\n", nPointCount );
+    PrintAlgorithmAndOptions( eAlgorithm, pOptions );
+    printf("\n");
+}
+
+/************************************************************************/
+/*                            ComputeExtent()                           */
+/*                                                                      */
+/*  Set the grid extent that was not specified by the user from the    */
+/*  extent of the layer. If a clipping geometry is passed, the extent  */
+/*  is restricted to its envelope, unless they do not overlap: points  */
+/*  outside of it are ignored, but layers may report their extent      */
+/*  without taking it into account.                                    */
+/************************************************************************/
+
+static void ComputeExtent( OGRLayerH hSrcLayer, OGRGeometry *poClipSrc,
+                           int& bIsXExtentSet, int& bIsYExtentSet,
+                           double& dfXMin, double& dfXMax,
+                           double& dfYMin, double& dfYMax )
+{
+    if ( bIsXExtentSet && bIsYExtentSet )
+        return;
+
+    OGREnvelope sEnvelope;
+    OGR_L_GetExtent( hSrcLayer, &sEnvelope, TRUE );
+
+    if ( poClipSrc != NULL )
+    {
+        OGREnvelope sClipEnvelope;
+        poClipSrc->getEnvelope( &sClipEnvelope );
+
+        // An empty intersection would give a null pixel size.
+        OGREnvelope sIntersection( sEnvelope );
+        sIntersection.Intersect( sClipEnvelope );
+        if ( sEnvelope.Intersects( sClipEnvelope ) &&
+             sIntersection.MaxX > sIntersection.MinX &&
+             sIntersection.MaxY > sIntersection.MinY )
+        {
+            sEnvelope = sIntersection;
+        }
+    }
+
+    if ( !bIsXExtentSet )
+    {
+        dfXMin = sEnvelope.MinX;
+        dfXMax = sEnvelope.MaxX;
+        bIsXExtentSet = TRUE;
+    }
+
+    if ( !bIsYExtentSet )
+    {
+        dfYMin = sEnvelope.MinY;
+        dfYMax = sEnvelope.MaxY;
+        bIsYExtentSet = TRUE;
+    }
+}
+
+/************************************************************************/
+/*                          GetSearchRadius()                           */
+/*                                                                      */
+/*  Return the largest distance at which an input point may contribute */
+/*  to a grid node, or 0 if the algorithm is not bound to a search     */
+/*  radius (in which case the streaming mode cannot be used).          */
+/************************************************************************/
+
+static double GetSearchRadius( GDALGridAlgorithm eAlgorithm,
+                               const void *pOptions )
+{
+    double dfRadius1 = 0.0;
+    double dfRadius2 = 0.0;
+
+    switch ( eAlgorithm )
+    {
+        case GGA_InverseDistanceToAPower:
+            dfRadius1 = ((const GDALGridInverseDistanceToAPowerOptions *)
+                                                        pOptions)->dfRadius1;
+            dfRadius2 = ((const GDALGridInverseDistanceToAPowerOptions *)
+                                                        pOptions)->dfRadius2;
+            break;
+        case GGA_InverseDistanceToAPowerNearestNeighbor:
+            dfRadius1 =
+                ((const GDALGridInverseDistanceToAPowerNearestNeighborOptions *)
+                                                        pOptions)->dfRadius;
+            dfRadius2 = dfRadius1;
+            break;
+        case GGA_MovingAverage:
+            dfRadius1 = ((const GDALGridMovingAverageOptions *)
+                                                        pOptions)->dfRadius1;
+            dfRadius2 = ((const GDALGridMovingAverageOptions *)
+                                                        pOptions)->dfRadius2;
+            break;
+        case GGA_NearestNeighbor:
+            dfRadius1 = ((const GDALGridNearestNeighborOptions *)
+                                                        pOptions)->dfRadius1;
+            dfRadius2 = ((const GDALGridNearestNeighborOptions *)
+                                                        pOptions)->dfRadius2;
+            break;
+        case GGA_MetricMinimum:
+        case GGA_MetricMaximum:
+        case GGA_MetricRange:
+        case GGA_MetricCount:
+        case GGA_MetricAverageDistance:
+        case GGA_MetricAverageDistancePts:
+            dfRadius1 = ((const GDALGridDataMetricsOptions *)
+                                                        pOptions)->dfRadius1;
+            dfRadius2 = ((const GDALGridDataMetricsOptions *)
+                                                        pOptions)->dfRadius2;
+            break;
+        case GGA_Linear:
+        default:
+            break;
+    }
+
+    if ( dfRadius1 > 0.0 && dfRadius2 > 0.0 )
+        return std::max( dfRadius1, dfRadius2 );
+    return 0.0;
+}
+
+/************************************************************************/
+/*                          GDALGridStreamTile                          */
+/*                                                                      */
+/*  An output tile of the streaming mode, with the input points whose  */
+/*  search area overlaps it. Points are kept as X,Y,Z triplets in      */
+/*  memory until a full chunk is collected and spilled to the          */
+/*  temporary file.                                                     */
+/************************************************************************/
+
+struct GDALGridStreamTile
+{
+    int                       nXOff;
+    int                       nYOff;
+    int                       nXSize;
+    int                       nYSize;
+    GUIntBig                  nPoints;
+    std::vector<double>       adfPending;
+    std::vector<vsi_l_offset> anChunkOffsets;
+};
+
+struct GDALGridStreamContext
+{
+    VSILFILE           *fpTmp;
+    CPLMutex           *hMutex;
+    GDALRasterBandH     hBand;
+    GDALDataType        eType;
+    GDALGridAlgorithm   eAlgorithm;
+    const void         *pOptions;
+    double              dfXMin;
+    double              dfYMin;
+    double              dfDeltaX;
+    double              dfDeltaY;
+    int                 nChunkPoints;
+    volatile int        bStop;
+    CPLErr              eErr;
+};
+
+struct GDALGridStreamJob
+{
+    GDALGridStreamContext *psCtxt;
+    GDALGridStreamTile    *psTile;
+};
+
+/************************************************************************/
+/*                       GDALGridStreamSetError()                       */
+/************************************************************************/
+
+static void GDALGridStreamSetError( GDALGridStreamContext *psCtxt )
+{
+    CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+    psCtxt->eErr = CE_Failure;
+    psCtxt->bStop = TRUE;
+    CPLReleaseMutex( psCtxt->hMutex );
+}
+
+/************************************************************************/
+/*                     GDALGridStreamTileProcess()                      */
+/*                                                                      */
+/*  Load the points of a tile back from the temporary file, grid the   */
+/*  tile and write it to the output band.                               */
+/************************************************************************/
+
+static void GDALGridStreamTileProcess( void *pData )
+{
+    GDALGridStreamJob *psJob = (GDALGridStreamJob *) pData;
+    GDALGridStreamContext *psCtxt = psJob->psCtxt;
+    GDALGridStreamTile *psTile = psJob->psTile;
+
+    if( psCtxt->bStop )
+        return;
+
+    const size_t nPoints = static_cast<size_t>(psTile->nPoints);
+    std::vector<double> adfX, adfY, adfZ;
+    std::vector<double> adfChunk;
+    try
+    {
+        adfX.resize( std::max( nPoints, (size_t)1 ) );
+        adfY.resize( std::max( nPoints, (size_t)1 ) );
+        adfZ.resize( std::max( nPoints, (size_t)1 ) );
+        adfChunk.resize( 3 * static_cast<size_t>(psCtxt->nChunkPoints) );
+    }
+    catch( const std::bad_alloc& )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate point arrays for %lu points",
+                  (unsigned long)nPoints );
+        GDALGridStreamSetError( psCtxt );
+        return;
+    }
+
+    size_t iPoint = 0;
+    for( size_t iChunk = 0; iChunk < psTile->anChunkOffsets.size(); iChunk++ )
+    {
+        CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+        const bool bOK =
+            VSIFSeekL( psCtxt->fpTmp, psTile->anChunkOffsets[iChunk],
+                       SEEK_SET ) == 0 &&
+            VSIFReadL( &adfChunk[0], sizeof(double) * 3,
+                       psCtxt->nChunkPoints, psCtxt->fpTmp ) ==
+                                        (size_t)psCtxt->nChunkPoints;
+        CPLReleaseMutex( psCtxt->hMutex );
+        if( !bOK )
+        {
+            CPLError( CE_Failure, CPLE_FileIO,
+                      "Cannot read points back from temporary file" );
+            GDALGridStreamSetError( psCtxt );
+            return;
+        }
+
+        for( int i = 0; i < psCtxt->nChunkPoints; i++, iPoint++ )
+        {
+            adfX[iPoint] = adfChunk[3 * i];
+            adfY[iPoint] = adfChunk[3 * i + 1];
+            adfZ[iPoint] = adfChunk[3 * i + 2];
+        }
+    }
+    for( size_t i = 0; i + 2 < psTile->adfPending.size(); i += 3, iPoint++ )
+    {
+        adfX[iPoint] = psTile->adfPending[i];
+        adfY[iPoint] = psTile->adfPending[i + 1];
+        adfZ[iPoint] = psTile->adfPending[i + 2];
+    }
+    std::vector<double>().swap( psTile->adfPending );
+    std::vector<double>().swap( adfChunk );
+
+    // Tiles without any point in reach are gridded as well, so that they
+    // receive the nodata value of the algorithm.
+    GDALGridContext *psContext =
+        GDALGridContextCreate( psCtxt->eAlgorithm, psCtxt->pOptions,
+                               static_cast<GUInt32>(nPoints),
+                               &adfX[0], &adfY[0], &adfZ[0], TRUE );
+    if( psContext == NULL )
+    {
+        GDALGridStreamSetError( psCtxt );
+        return;
+    }
+
+    void *pBuffer = VSI_MALLOC3_VERBOSE( psTile->nXSize, psTile->nYSize,
+                                         GDALGetDataTypeSizeBytes(psCtxt->eType) );
+    CPLErr eErr = pBuffer ? CE_None : CE_Failure;
+    if( eErr == CE_None )
+    {
+        eErr = GDALGridContextProcess( psContext,
+                    psCtxt->dfXMin + psCtxt->dfDeltaX * psTile->nXOff,
+                    psCtxt->dfXMin + psCtxt->dfDeltaX *
+                                        (psTile->nXOff + psTile->nXSize),
+                    psCtxt->dfYMin + psCtxt->dfDeltaY * psTile->nYOff,
+                    psCtxt->dfYMin + psCtxt->dfDeltaY *
+                                        (psTile->nYOff + psTile->nYSize),
+                    psTile->nXSize, psTile->nYSize, psCtxt->eType, pBuffer,
+                    NULL, NULL );
+    }
+    GDALGridContextFree( psContext );
+
+    if( eErr == CE_None )
+    {
+        CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+        eErr = GDALRasterIO( psCtxt->hBand, GF_Write,
+                             psTile->nXOff, psTile->nYOff,
+                             psTile->nXSize, psTile->nYSize, pBuffer,
+                             psTile->nXSize, psTile->nYSize, psCtxt->eType,
+                             0, 0 );
+        CPLReleaseMutex( psCtxt->hMutex );
+    }
+    CPLFree( pBuffer );
+
+    if( eErr != CE_None )
+        GDALGridStreamSetError( psCtxt );
+}
+
+/************************************************************************/
+/*                     GDALGridStreamThreadInit()                       */
+/************************************************************************/
+
+static void GDALGridStreamThreadInit( void * )
+{
+    // Tiles are already processed in parallel, so each of them is gridded
+    // by a single thread.
+    CPLSetThreadLocalConfigOption( "GDAL_NUM_THREADS", "1" );
+}
+
+/************************************************************************/
+/*                        GDALGridStreamFlush()                         */
+/************************************************************************/
+
+static bool GDALGridStreamFlush( GDALGridStreamContext *psCtxt,
+                                 GDALGridStreamTile *psTile )
+{
+    vsi_l_offset nOffset;
+    if( VSIFSeekL( psCtxt->fpTmp, 0, SEEK_END ) != 0 )
+        return false;
+    nOffset = VSIFTellL( psCtxt->fpTmp );
+    if( VSIFWriteL( &psTile->adfPending[0], sizeof(double) * 3,
+                    psCtxt->nChunkPoints, psCtxt->fpTmp ) !=
+                                        (size_t)psCtxt->nChunkPoints )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Cannot write points to temporary file" );
+        return false;
+    }
+    psTile->anChunkOffsets.push_back( nOffset );
+    psTile->adfPending.resize( 0 );
+    return true;
+}
+
+/************************************************************************/
+/*                        GetStreamTileRange()                          */
+/*                                                                      */
+/*  Compute the range of tiles, along one axis, whose grid nodes may be */
+/*  within dfRadius of coordinate dfCoord. Returns false if there is   */
+/*  none.                                                               */
+/************************************************************************/
+
+static bool GetStreamTileRange( double dfCoord, double dfRadius,
+                                double dfMin, double dfDelta,
+                                int nSize, int nTileSize, int nTiles,
+                                int& nFirst, int& nLast )
+{
+    double dfPix1 = (dfCoord - dfRadius - dfMin) / dfDelta;
+    double dfPix2 = (dfCoord + dfRadius - dfMin) / dfDelta;
+    if( dfPix1 > dfPix2 )
+        std::swap( dfPix1, dfPix2 );
+    // Grid nodes are at the center of pixels.
+    if( !(dfPix2 >= 0.5 - 1e-6) || !(dfPix1 <= nSize - 0.5 + 1e-6) )
+        return false;
+    nFirst = std::max( 0, static_cast<int>(
+                        floor( std::max( dfPix1, 0.0 ) / nTileSize ) ) );
+    nLast = std::min( nTiles - 1, static_cast<int>(
+                        floor( std::min( dfPix2, (double)nSize ) / nTileSize ) ) );
+    return nFirst <= nLast;
+}
+
+/************************************************************************/
+/*                       ProcessLayerStreaming()                        */
+/*                                                                      */
+/*  Out-of-core variant of the gridding: the output raster is split    */
+/*  into tiles, every input point is spilled to a temporary file for   */
+/*  each tile it can contribute to (tile extent enlarged by the search */
+/*  radius), and then tiles are gridded independently and in parallel. */
+/*  Memory use is thus bounded by the number of points falling in the  */
+/*  reach of a single tile, instead of the whole layer.                */
+/************************************************************************/
+
+static CPLErr ProcessLayerStreaming( OGRLayerH hSrcLayer, GDALDatasetH hDstDS,
+                          OGRGeometry *poClipSrc,
+                          int nXSize, int nYSize, int nBand,
+                          int& bIsXExtentSet, int& bIsYExtentSet,
+                          double& dfXMin, double& dfXMax,
+                          double& dfYMin, double& dfYMax,
+                          int iBurnField,
+                          const double dfIncreaseBurnValue,
+                          const double dfMultiplyBurnValue,
+                          GDALDataType eType,
+                          GDALGridAlgorithm eAlgorithm, void *pOptions,
+                          int nStreamTileSize,
+                          int bQuiet, GDALProgressFunc pfnProgress, void* pProgressData )
+
+{
+    const double dfRadius = GetSearchRadius( eAlgorithm, pOptions );
+    if( dfRadius <= 0.0 )
+    {
+        CPLError( CE_Failure, CPLE_NotSupported,
+                  "Streaming mode requires an algorithm with a search radius." );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      The grid geometry must be known before reading the points.      */
+/* -------------------------------------------------------------------- */
+    ComputeExtent( hSrcLayer, poClipSrc, bIsXExtentSet, bIsYExtentSet,
+                   dfXMin, dfXMax, dfYMin, dfYMax );
+
+    const double    dfDeltaX = ( dfXMax - dfXMin ) / nXSize;
+    const double    dfDeltaY = ( dfYMax - dfYMin ) / nYSize;
+
+    if( dfDeltaX == 0.0 || dfDeltaY == 0.0 )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Streaming mode requires a non-empty grid extent." );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Split the output raster into tiles aligned on its blocks.       */
+/* -------------------------------------------------------------------- */
+    GDALRasterBandH hBand = GDALGetRasterBand( hDstDS, nBand );
+    int     nBlockXSize, nBlockYSize;
+    GDALGetBlockSize( hBand, &nBlockXSize, &nBlockYSize );
+
+    int nTileXSize, nTileYSize;
+    if( nBlockXSize >= nXSize )
+    {
+        // Strip organized output: use full width tiles of roughly the
+        // same number of pixels.
+        nTileXSize = nXSize;
+        nTileYSize = static_cast<int>( std::max( (GIntBig)1,
+                        (GIntBig)nStreamTileSize * nStreamTileSize / nXSize ) );
+    }
+    else
+    {
+        nTileXSize = nStreamTileSize;
+        nTileYSize = nStreamTileSize;
+    }
+    nTileXSize = ((nTileXSize + nBlockXSize - 1) / nBlockXSize) * nBlockXSize;
+    nTileYSize = ((nTileYSize + nBlockYSize - 1) / nBlockYSize) * nBlockYSize;
+    nTileXSize = std::min( nTileXSize, nXSize );
+    nTileYSize = std::min( nTileYSize, nYSize );
+
+    const int nTilesX = (nXSize + nTileXSize - 1) / nTileXSize;
+    const int nTilesY = (nYSize + nTileYSize - 1) / nTileYSize;
+    const int nTiles = nTilesX * nTilesY;
+
+    std::vector<GDALGridStreamTile> asTiles( nTiles );
+    for( int iTileY = 0; iTileY < nTilesY; iTileY++ )
+    {
+        for( int iTileX = 0; iTileX < nTilesX; iTileX++ )
+        {
+            GDALGridStreamTile& sTile = asTiles[iTileY * nTilesX + iTileX];
+            sTile.nXOff = iTileX * nTileXSize;
+            sTile.nYOff = iTileY * nTileYSize;
+            sTile.nXSize = std::min( nTileXSize, nXSize - sTile.nXOff );
+            sTile.nYSize = std::min( nTileYSize, nYSize - sTile.nYOff );
+            sTile.nPoints = 0;
+        }
+    }
+    CPLDebug( "GDAL_GRID", "Streaming with %d x %d tiles of %d x %d pixels",
+              nTilesX, nTilesY, nTileXSize, nTileYSize );
+
+/* -------------------------------------------------------------------- */
+/*      Dispatch the points to the tiles, spilling them to a            */
+/*      temporary file. In-memory buffers are limited to 64 MB.         */
+/* -------------------------------------------------------------------- */
+    GDALGridStreamContext sCtxt;
+    sCtxt.hMutex = NULL;
+    sCtxt.hBand = hBand;
+    sCtxt.eType = eType;
+    sCtxt.eAlgorithm = eAlgorithm;
+    sCtxt.pOptions = pOptions;
+    sCtxt.dfXMin = dfXMin;
+    sCtxt.dfYMin = dfYMin;
+    sCtxt.dfDeltaX = dfDeltaX;
+    sCtxt.dfDeltaY = dfDeltaY;
+    sCtxt.nChunkPoints = static_cast<int>( std::max( 64, std::min( 65536,
+                            64 * 1024 * 1024 / (3 * (int)sizeof(double)) / nTiles ) ) );
+    sCtxt.bStop = FALSE;
+    sCtxt.eErr = CE_None;
+
+    CPLString osTmpFilename = CPLGenerateTempFilename( "gdal_grid" );
+    sCtxt.fpTmp = VSIFOpenL( osTmpFilename, "w+b" );
+    if( sCtxt.fpTmp == NULL )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Cannot create temporary file %s", osTmpFilename.c_str() );
+        return CE_Failure;
+    }
+
+    // Slightly enlarge the radius so that points exactly at the search
+    // distance of a node are not lost due to rounding.
+    const double dfHalo = dfRadius * (1.0 + 1e-8);
+    const GIntBig nFeatureCount = OGR_L_GetFeatureCount( hSrcLayer, FALSE );
+    GIntBig nFeature = 0;
+    GUIntBig nPointCount = 0;
+    CPLErr eErr = CE_None;
+
+    std::vector<double> adfX, adfY, adfZ;
+    OGRFeature *poFeat;
+    OGR_L_ResetReading( hSrcLayer );
+
+    while( eErr == CE_None &&
+           (poFeat = (OGRFeature *)OGR_L_GetNextFeature( hSrcLayer )) != NULL )
+    {
+        OGRGeometry *poGeom = poFeat->GetGeometryRef();
+        double  dfBurnValue = 0.0;
+
+        if ( iBurnField >= 0 )
+            dfBurnValue = poFeat->GetFieldAsDouble( iBurnField );
+
+        adfX.resize( 0 );
+        adfY.resize( 0 );
+        adfZ.resize( 0 );
+        ProcessCommonGeometry(poGeom, poClipSrc, iBurnField, dfBurnValue,
+            dfIncreaseBurnValue, dfMultiplyBurnValue, adfX, adfY, adfZ);
+
+        OGRFeature::DestroyFeature( poFeat );
+
+        for( size_t i = 0; i < adfX.size() && eErr == CE_None; i++ )
+        {
+            nPointCount ++;
+
+            int nFirstX, nLastX, nFirstY, nLastY;
+            if( !GetStreamTileRange( adfX[i], dfHalo, dfXMin, dfDeltaX,
+                                     nXSize, nTileXSize, nTilesX,
+                                     nFirstX, nLastX ) ||
+                !GetStreamTileRange( adfY[i], dfHalo, dfYMin, dfDeltaY,
+                                     nYSize, nTileYSize, nTilesY,
+                                     nFirstY, nLastY ) )
+                continue;
+
+            for( int iTileY = nFirstY; iTileY <= nLastY && eErr == CE_None; iTileY++ )
+            {
+                for( int iTileX = nFirstX; iTileX <= nLastX; iTileX++ )
+                {
+                    GDALGridStreamTile& sTile = asTiles[iTileY * nTilesX + iTileX];
+                    sTile.adfPending.push_back( adfX[i] );
+                    sTile.adfPending.push_back( adfY[i] );
+                    sTile.adfPending.push_back( adfZ[i] );
+                    sTile.nPoints ++;
+                    if( sTile.adfPending.size() ==
+                                    3 * static_cast<size_t>(sCtxt.nChunkPoints) &&
+                        !GDALGridStreamFlush( &sCtxt, &sTile ) )
+                    {
+                        eErr = CE_Failure;
+                        break;
+                    }
+                }
+            }
+        }
+
+        nFeature ++;
+        if( eErr == CE_None && nFeatureCount > 0 &&
+            !pfnProgress( 0.5 * std::min( 1.0, (double)nFeature / nFeatureCount ),
+                          "", pProgressData ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+    }
+
+    for( int i = 0; eErr == CE_None && i < nTiles; i++ )
+    {
+        if( asTiles[i].nPoints > 0xffffffffU )
+        {
+            CPLError( CE_Failure, CPLE_NotSupported,
+                      "Too many points in the reach of a tile. "
+                      "Try reducing the stream tile size." );
+            eErr = CE_Failure;
+        }
+    }
+
+    if( eErr == CE_None && nPointCount == 0 )
+    {
+        printf( "No point geometry found on layer %s, skipping.\n",
+                OGR_FD_GetName( OGR_L_GetLayerDefn( hSrcLayer ) ) );
+        VSIFCloseL( sCtxt.fpTmp );
+        VSIUnlink( osTmpFilename );
+        return CE_None;
+    }
+
+    if ( eErr == CE_None && !bQuiet )
+    {
+        PrintGridInfo( eType, nXSize, nYSize, dfXMin, dfXMax, dfYMin, dfYMax,
+                       nPointCount, eAlgorithm, pOptions );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Grid the tiles.                                                 */
+/* -------------------------------------------------------------------- */
+    if( eErr == CE_None )
+    {
+        int nThreads = CPLGetConfiguredNumThreads("ALL_CPUS");
+        if( nThreads > nTiles )
+            nThreads = nTiles;
+
+        sCtxt.hMutex = CPLCreateMutex();
+        CPLReleaseMutex( sCtxt.hMutex );
+
+        std::vector<GDALGridStreamJob> asJobs( nTiles );
+        std::vector<void*> apJobs( nTiles );
+        for( int i = 0; i < nTiles; i++ )
+        {
+            asJobs[i].psCtxt = &sCtxt;
+            asJobs[i].psTile = &asTiles[i];
+            apJobs[i] = &asJobs[i];
+        }
+
+        CPLWorkerThreadPool oPool;
+        if( nThreads > 1 &&
+            oPool.Setup( nThreads, GDALGridStreamThreadInit, NULL ) &&
+            oPool.SubmitJobs( GDALGridStreamTileProcess, apJobs ) )
+        {
+            for( int nRemaining = nTiles - 1; nRemaining >= 0; nRemaining-- )
+            {
+                oPool.WaitCompletion( nRemaining );
+                if( !sCtxt.bStop &&
+                    !pfnProgress( 0.5 + 0.5 * (nTiles - nRemaining) / nTiles,
+                                  "", pProgressData ) )
+                {
+                    CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+                    GDALGridStreamSetError( &sCtxt );
+                }
+            }
+        }
+        else
+        {
+            for( int i = 0; i < nTiles && !sCtxt.bStop; i++ )
+            {
+                GDALGridStreamTileProcess( apJobs[i] );
+                if( !sCtxt.bStop &&
+                    !pfnProgress( 0.5 + 0.5 * (i + 1) / nTiles,
+                                  "", pProgressData ) )
+                {
+                    CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+                    GDALGridStreamSetError( &sCtxt );
+                }
+            }
+        }
+
+        CPLDestroyMutex( sCtxt.hMutex );
+        eErr = sCtxt.eErr;
+    }
+
+    VSIFCloseL( sCtxt.fpTmp );
+    VSIUnlink( osTmpFilename );
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                            ProcessLayer()                            */
 /*                                                                      */
@@ -352,6 +1011,7 @@ static CPLErr ProcessLayer( OGRLayerH hSrcLayer, GDALDatasetH hDstDS,
                           const double dfMultiplyBurnValue,
                           GDALDataType eType,
                           GDALGridAlgorithm eAlgorithm, void *pOptions,
+                          int bStream, int nStreamTileSize,
                           int bQuiet, GDALProgressFunc pfnProgress, void* pProgressData )
 
 {
@@ -373,6 +1033,16 @@ static CPLErr ProcessLayer( OGRLayerH hSrcLayer, GDALDatasetH hDstDS,
         }
     }
 
+    if ( bStream )
+        return ProcessLayerStreaming( hSrcLayer, hDstDS, poClipSrc,
+                                      nXSize, nYSize, nBand,
+                                      bIsXExtentSet, bIsYExtentSet,
+                                      dfXMin, dfXMax, dfYMin, dfYMax,
+                                      iBurnField, dfIncreaseBurnValue,
+                                      dfMultiplyBurnValue, eType,
+                                      eAlgorithm, pOptions, nStreamTileSize,
+                                      bQuiet, pfnProgress, pProgressData );
+
 /* -------------------------------------------------------------------- */
 /*      Collect the geometries from this layer, and build list of       */
 /*      values to be interpolated.                                      */
@@ -404,27 +1074,11 @@ static CPLErr ProcessLayer( OGRLayerH hSrcLayer, GDALDatasetH hDstDS,
     }
 
 /* -------------------------------------------------------------------- */
-/*      Compute grid geometry.                                          */
+/*      Compute grid geometry. Unlike in streaming mode, the default    */
+/*      extent is the one of the layer, not restricted to -clipsrc.     */
 /* -------------------------------------------------------------------- */
-    if ( !bIsXExtentSet || !bIsYExtentSet )
-    {
-        OGREnvelope sEnvelope;
-        OGR_L_GetExtent( hSrcLayer, &sEnvelope, TRUE );
-
-        if ( !bIsXExtentSet )
-        {
-            dfXMin = sEnvelope.MinX;
-            dfXMax = sEnvelope.MaxX;
-            bIsXExtentSet = TRUE;
-        }
-
-        if ( !bIsYExtentSet )
-        {
-            dfYMin = sEnvelope.MinY;
-            dfYMax = sEnvelope.MaxY;
-            bIsYExtentSet = TRUE;
-        }
-    }
+    ComputeExtent( hSrcLayer, NULL, bIsXExtentSet, bIsYExtentSet,
+                   dfXMin, dfXMax, dfYMin, dfYMax );
 
 /* -------------------------------------------------------------------- */
 /*      Perform gridding.                                               */
@@ -435,16 +1089,8 @@ static CPLErr ProcessLayer( OGRLayerH hSrcLayer, GDALDatasetH hDstDS,
 
     if ( !bQuiet )
     {
-        printf( "Grid data type is \"%s\"\n", GDALGetDataTypeName(eType) );
-        printf( "Grid size = (%lu %lu).\n",
-                (unsigned long)nXSize, (unsigned long)nYSize );
-        CPLprintf( "Corner coordinates = (%f %f)-(%f %f).\n",
-                dfXMin - dfDeltaX / 2, dfYMax + dfDeltaY / 2,
-                dfXMax + dfDeltaX / 2, dfYMin - dfDeltaY / 2 );
-        CPLprintf( "Grid cell size = (%f %f).\n", dfDeltaX, dfDeltaY );
-        printf( "Source point count = %lu.\n", (unsigned long)adfX.size() );
-        PrintAlgorithmAndOptions( eAlgorithm, pOptions );
-        printf("\n");
+        PrintGridInfo( eType, nXSize, nYSize, dfXMin, dfXMax, dfYMin, dfYMax,
+                       adfX.size(), eAlgorithm, pOptions );
     }
 
     GDALRasterBandH hBand = GDALGetRasterBand( hDstDS, nBand );
@@ -789,6 +1435,7 @@ GDALDatasetH GDALGrid( const char *pszDest, GDALDatasetH hSrcDataset,
                           dfXMin, dfXMax, dfYMin, dfYMax, psOptions->pszBurnAttribute,
                           psOptions->dfIncreaseBurnValue, psOptions->dfMultiplyBurnValue,
                           psOptions->eOutputType, psOptions->eAlgorithm, psOptions->pOptions,
+                          psOptions->bStream, psOptions->nStreamTileSize,
                           psOptions->bQuiet, psOptions->pfnProgress, psOptions->pProgressData );
 
             poSrcDS->ReleaseResultSet(poLayer);
@@ -834,6 +1481,7 @@ GDALDatasetH GDALGrid( const char *pszDest, GDALDatasetH hSrcDataset,
                       dfXMin, dfXMax, dfYMin, dfYMax, psOptions->pszBurnAttribute,
                       psOptions->dfIncreaseBurnValue, psOptions->dfMultiplyBurnValue,
                       psOptions->eOutputType, psOptions->eAlgorithm, psOptions->pOptions,
+                      psOptions->bStream, psOptions->nStreamTileSize,
                       psOptions->bQuiet, psOptions->pfnProgress, psOptions->pProgressData );
         if( eErr != CE_None )
             break;
@@ -941,6 +1589,8 @@ GDALGridOptions *GDALGridOptionsNew(char** papszArgv, GDALGridOptionsForBinary*
     psOptions->pszClipSrcWhere = NULL;
     psOptions->bNoDataSet = FALSE;
     psOptions->dfNoDataValue = 0;
+    psOptions->bStream = FALSE;
+    psOptions->nStreamTileSize = 1024;
 
     ParseAlgorithmAndOptions( szAlgNameInvDist, &psOptions->eAlgorithm, &psOptions->pOptions );
 
@@ -1182,6 +1832,23 @@ GDALGridOptions *GDALGridOptionsNew(char** papszArgv, GDALGridOptionsForBinary*
             }
             CSLDestroy(papszParms);
         }
+        else if( EQUAL(papszArgv[i],"-stream") )
+        {
+            psOptions->bStream = TRUE;
+        }
+        else if( EQUAL(papszArgv[i],"-stream_tile_size") && i+1 < argc )
+        {
+            psOptions->nStreamTileSize = atoi(papszArgv[++i]);
+            if( psOptions->nStreamTileSize <= 0 )
+            {
+                CPLError(CE_Failure, CPLE_IllegalArg,
+                         "Invalid value for -stream_tile_size: %s",
+                         papszArgv[i]);
+                GDALGridOptionsFree(psOptions);
+                return NULL;
+            }
+            psOptions->bStream = TRUE;
+        }
         else if( papszArgv[i][0] == '-' )
         {
             CPLError(CE_Failure, CPLE_NotSupported,
@@ -1254,6 +1921,16 @@ GDALGridOptions *GDALGridOptionsNew(char** papszArgv, GDALGridOptionsForBinary*
         }
     }
 
+    if( psOptions->bStream &&
+        GetSearchRadius( psOptions->eAlgorithm, psOptions->pOptions ) <= 0.0 )
+    {
+        CPLError(CE_Failure, CPLE_NotSupported,
+                 "-stream requires an algorithm with a search radius "
+                 "(radius1 and radius2, or radius for invdistnn).");
+        GDALGridOptionsFree(psOptions);
+        return NULL;
+    }
+
     if( psOptionsForBinary )
     {
         psOptionsForBinary->pszFormat = CPLStrdup(psOptions->pszFormat);
@@ -85,6 +85,11 @@ static void Usage(const char* pszErrorMsg = NULL)
             "     gdaldem roughness input_dem output_roughness_map\n"
             "                 [-compute_edges] [-b Band (default=1)] [-of format] [-co \"NAME=VALUE\"]* [-q]\n"
             "\n"
+            " - To compute several of the above maps (except color-relief) in a single pass,\n"
+            "   as bands of a single output or, with -separate, as output_map_<processing> files\n"
+            "     gdaldem processing1,processing2[,...] input_dem output_map [-separate]\n"
+            "                 [options of each processing]\n"
+            "\n"
             " Notes : \n"
             "   Scale is the ratio of vertical units to horizontal\n"
             "    for Feet:Latlong use scale=370400, for Meters:LatLong use scale=111120 \n\n");
@@ -95,6 +95,18 @@
 #include "gdal.h"
 #include "gdal_priv.h"
 #include "gdal_utils_priv.h"
+#include "cpl_worker_thread_pool.h"
+
+#include <vector>
+
+/* We restrict to 64bit processors because they are guaranteed to have SSE2 */
+#if defined(__x86_64) || defined(_M_X64)
+#define USE_SSE2
+#endif
+
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
 
 CPL_CVSID("$Id$");
 
@@ -132,6 +144,7 @@ struct GDALDEMProcessingOptions
     int bCombined;
     char** papszCreateOptions;
     int nBand;
+    int bSeparate;
 };
 
 /************************************************************************/
@@ -173,59 +186,130 @@ static float ComputeVal(int bSrcHasNoData, float fSrcNoDataValue,
 }
 
 /************************************************************************/
-/*                  GDALGeneric3x3Processing()                          */
+/*                  GDALGeneric3x3ProcessingContext                     */
 /************************************************************************/
 
-static
-CPLErr GDALGeneric3x3Processing  ( GDALRasterBandH hSrcBand,
-                                   GDALRasterBandH hDstBand,
-                                   GDALGeneric3x3ProcessingAlg pfnAlg,
-                                   void* pData,
-                                   int bComputeAtEdges,
-                                   GDALProgressFunc pfnProgress,
-                                   void * pProgressData)
+/* Optional vectorized counterpart of a GDALGeneric3x3ProcessingAlg. */
+/* It computes nCount consecutive output values. Output value k uses */
+/* the elements k, k+1 and k+2 of each of the 3 source lines. It is only */
+/* used when all the values of the window are valid (no nodata, no edge) */
+typedef void (*GDALGeneric3x3ProcessingAlg_multisample) (const float* pafLine1,
+                                                         const float* pafLine2,
+                                                         const float* pafLine3,
+                                                         int nCount,
+                                                         void* pData,
+                                                         float* pafOutputBuf);
+
+/* One of the values computed from each 3x3 window */
+typedef struct
 {
-    CPLErr eErr;
-    float *pafThreeLineWin; /* 3 line rotating source buffer */
-    float *pafOutputBuf;     /* 1 line destination buffer */
-    int i, j;
-
-    int bSrcHasNoData, bDstHasNoData;
-    float fSrcNoDataValue = 0.0, fDstNoDataValue = 0.0;
+    GDALGeneric3x3ProcessingAlg             pfnAlg;
+    GDALGeneric3x3ProcessingAlg_multisample pfnAlgMultisample;
+    void                                   *pData;
+    float                                   fDstNoDataValue;
+} GDALGeneric3x3Product;
 
-    int nXSize = GDALGetRasterBandXSize(hSrcBand);
-    int nYSize = GDALGetRasterBandYSize(hSrcBand);
+typedef struct
+{
+    /* Products computed in the same pass over the source */
+    const GDALGeneric3x3Product*            pasProducts;
+    int                                     nProducts;
+    int                                     bComputeAtEdges;
+    int                                     bSrcHasNoData;
+    float                                   fSrcNoDataValue;
+    int                                     bIsSrcNoDataNan;
+    int                                     nRasterXSize;
+    int                                     nRasterYSize;
+} GDALGeneric3x3ProcessingContext;
+
+static void GDALGeneric3x3InitContext( GDALGeneric3x3ProcessingContext* psCtxt,
+                                       GDALRasterBandH hSrcBand,
+                                       const GDALGeneric3x3Product* pasProducts,
+                                       int nProducts,
+                                       int bComputeAtEdges )
+{
+    psCtxt->pasProducts = pasProducts;
+    psCtxt->nProducts = nProducts;
+    psCtxt->bComputeAtEdges = bComputeAtEdges;
+    psCtxt->bSrcHasNoData = FALSE;
+    psCtxt->fSrcNoDataValue = (float) GDALGetRasterNoDataValue(hSrcBand,
+                                                    &(psCtxt->bSrcHasNoData));
+    psCtxt->bIsSrcNoDataNan = psCtxt->bSrcHasNoData &&
+                              CPLIsNan(psCtxt->fSrcNoDataValue);
+    psCtxt->nRasterXSize = GDALGetRasterBandXSize(hSrcBand);
+    psCtxt->nRasterYSize = GDALGetRasterBandYSize(hSrcBand);
+}
 
-    if (pfnProgress == NULL)
-        pfnProgress = GDALDummyProgress;
+/************************************************************************/
+/*                   GDALGeneric3x3ComputeProducts()                    */
+/************************************************************************/
 
-/* -------------------------------------------------------------------- */
-/*      Initialize progress counter.                                    */
-/* -------------------------------------------------------------------- */
-    if( !pfnProgress( 0.0, NULL, pProgressData ) )
+/* Compute the value of all the products (or only the ones without a */
+/* vectorized implementation if bSkipMultisample is set) for the window */
+/* afWin, and store them at the index iOut of their output buffer. */
+/* ComputeVal() may replace the nodata values of afWin by the center value */
+/* which does not change the result for the next products. */
+
+static void GDALGeneric3x3ComputeProducts(
+                                    const GDALGeneric3x3ProcessingContext* psCtxt,
+                                    float* afWin,
+                                    int bSkipMultisample,
+                                    float* const* papafOutputBuf,
+                                    int iOut )
+{
+    for( int iProduct = 0; iProduct < psCtxt->nProducts; iProduct++ )
     {
-        CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-        return CE_Failure;
+        const GDALGeneric3x3Product* psProduct = psCtxt->pasProducts + iProduct;
+        if( bSkipMultisample && psProduct->pfnAlgMultisample != NULL )
+            continue;
+        papafOutputBuf[iProduct][iOut] = ComputeVal(psCtxt->bSrcHasNoData,
+                                                    psCtxt->fSrcNoDataValue,
+                                                    psCtxt->bIsSrcNoDataNan,
+                                                    afWin,
+                                                    psProduct->fDstNoDataValue,
+                                                    psProduct->pfnAlg,
+                                                    psProduct->pData,
+                                                    psCtxt->bComputeAtEdges);
     }
+}
 
-    pafOutputBuf = (float *) VSI_MALLOC2_VERBOSE(sizeof(float),nXSize);
-    pafThreeLineWin  = (float *) VSI_MALLOC2_VERBOSE(3*sizeof(float),(nXSize+1));
-    if( pafOutputBuf == NULL || pafThreeLineWin == NULL )
-    {
-        VSIFree(pafOutputBuf);
-        VSIFree(pafThreeLineWin);
-        return CE_Failure;
-    }
+static void GDALGeneric3x3SetNoData(
+                                    const GDALGeneric3x3ProcessingContext* psCtxt,
+                                    float* const* papafOutputBuf,
+                                    int iOut )
+{
+    for( int iProduct = 0; iProduct < psCtxt->nProducts; iProduct++ )
+        papafOutputBuf[iProduct][iOut] =
+                            psCtxt->pasProducts[iProduct].fDstNoDataValue;
+}
 
-    fSrcNoDataValue = (float) GDALGetRasterNoDataValue(hSrcBand, &bSrcHasNoData);
-    fDstNoDataValue = (float) GDALGetRasterNoDataValue(hDstBand, &bDstHasNoData);
-    if (!bDstHasNoData)
-        fDstNoDataValue = 0.0;
-    int bIsSrcNoDataNan = bSrcHasNoData && CPLIsNan(fSrcNoDataValue);
+/************************************************************************/
+/*                    GDALGeneric3x3ProcessLine()                       */
+/************************************************************************/
 
-    int nLine1Off = 0*nXSize;
-    int nLine2Off = 1*nXSize;
-    int nLine3Off = 2*nXSize;
+/* Compute the output values of the columns [nXStart, nXEnd[ of a raster */
+/* line, for each product, into papafOutputBuf[iProduct]. pafLine1, */
+/* pafLine2 and pafLine3 are the source line above, the source line itself */
+/* and the source line below, starting at raster column nSrcXOff. pafLine1 */
+/* (resp. pafLine3) must be NULL for the first (resp. last) line of the */
+/* raster, and the source lines must contain the columns nXStart-1 and */
+/* nXEnd when they are inside the raster. */
+
+static void GDALGeneric3x3ProcessLine( const GDALGeneric3x3ProcessingContext* psCtxt,
+                                       const float* pafLine1,
+                                       const float* pafLine2,
+                                       const float* pafLine3,
+                                       int nSrcXOff,
+                                       int nXStart, int nXEnd,
+                                       float* const* papafOutputBuf )
+{
+    const int nXSize = psCtxt->nRasterXSize;
+    const int nYSize = psCtxt->nRasterYSize;
+    const int bComputeAtEdges = psCtxt->bComputeAtEdges;
+    const int bSrcHasNoData = psCtxt->bSrcHasNoData;
+    const float fSrcNoDataValue = psCtxt->fSrcNoDataValue;
+    float afWin[9];
+    int j;
 
     // Move a 3x3 pafWindow over each cell
     // (where the cell in question is #4)
@@ -234,211 +318,433 @@ CPLErr GDALGeneric3x3Processing  ( GDALRasterBandH hSrcBand,
     //      3 4 5
     //      6 7 8
 
-    /* Preload the first 2 lines */
-    for ( i = 0; i < 2 && i < nYSize; i++)
+    if( pafLine1 == NULL || pafLine3 == NULL )
     {
-        if( GDALRasterIO(   hSrcBand,
-                        GF_Read,
-                        0, i,
-                        nXSize, 1,
-                        pafThreeLineWin + i * nXSize,
-                        nXSize, 1,
-                        GDT_Float32,
-                        0, 0) != CE_None )
+        /* First or last line of the raster */
+        if( !(bComputeAtEdges && nXSize >= 2 && nYSize >= 2) )
         {
-            eErr = CE_Failure;
-            goto end;
+            // Exclude the edges
+            for( j = nXStart; j < nXEnd; j++ )
+                GDALGeneric3x3SetNoData(psCtxt, papafOutputBuf, j - nXStart);
+            return;
         }
-    }
 
-    if (bComputeAtEdges && nXSize >= 2 && nYSize >= 2)
-    {
-        for (j = 0; j < nXSize; j++)
+        for( j = nXStart; j < nXEnd; j++ )
         {
-            float afWin[9];
-            int jmin = (j == 0) ? j : j - 1;
-            int jmax = (j == nXSize - 1) ? j : j + 1;
+            const int jmin = ((j == 0) ? j : j - 1) - nSrcXOff;
+            const int jcur = j - nSrcXOff;
+            const int jmax = ((j == nXSize - 1) ? j : j + 1) - nSrcXOff;
 
-            afWin[0] = INTERPOL(pafThreeLineWin[jmin], pafThreeLineWin[nXSize + jmin]);
-            afWin[1] = INTERPOL(pafThreeLineWin[j],    pafThreeLineWin[nXSize + j]);
-            afWin[2] = INTERPOL(pafThreeLineWin[jmax], pafThreeLineWin[nXSize + jmax]);
-            afWin[3] = pafThreeLineWin[jmin];
-            afWin[4] = pafThreeLineWin[j];
-            afWin[5] = pafThreeLineWin[jmax];
-            afWin[6] = pafThreeLineWin[nXSize + jmin];
-            afWin[7] = pafThreeLineWin[nXSize + j];
-            afWin[8] = pafThreeLineWin[nXSize + jmax];
+            if( pafLine1 == NULL )
+            {
+                afWin[0] = INTERPOL(pafLine2[jmin], pafLine3[jmin]);
+                afWin[1] = INTERPOL(pafLine2[jcur], pafLine3[jcur]);
+                afWin[2] = INTERPOL(pafLine2[jmax], pafLine3[jmax]);
+                afWin[3] = pafLine2[jmin];
+                afWin[4] = pafLine2[jcur];
+                afWin[5] = pafLine2[jmax];
+                afWin[6] = pafLine3[jmin];
+                afWin[7] = pafLine3[jcur];
+                afWin[8] = pafLine3[jmax];
+            }
+            else
+            {
+                afWin[0] = pafLine1[jmin];
+                afWin[1] = pafLine1[jcur];
+                afWin[2] = pafLine1[jmax];
+                afWin[3] = pafLine2[jmin];
+                afWin[4] = pafLine2[jcur];
+                afWin[5] = pafLine2[jmax];
+                afWin[6] = INTERPOL(pafLine2[jmin], pafLine1[jmin]);
+                afWin[7] = INTERPOL(pafLine2[jcur], pafLine1[jcur]);
+                afWin[8] = INTERPOL(pafLine2[jmax], pafLine1[jmax]);
+            }
 
-            pafOutputBuf[j] = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                                         bIsSrcNoDataNan,
-                                         afWin, fDstNoDataValue,
-                                         pfnAlg, pData, bComputeAtEdges);
+            GDALGeneric3x3ComputeProducts(psCtxt, afWin, FALSE,
+                                          papafOutputBuf, j - nXStart);
         }
-        eErr = GDALRasterIO(hDstBand, GF_Write,
-                    0, 0, nXSize, 1,
-                    pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
+        return;
     }
-    else
+
+    j = nXStart;
+    if( j == 0 && j < nXEnd )
     {
-        // Exclude the edges
-        for (j = 0; j < nXSize; j++)
+        const int jcur = j - nSrcXOff;
+        if( bComputeAtEdges && nXSize >= 2 )
         {
-            pafOutputBuf[j] = fDstNoDataValue;
-        }
-        eErr = GDALRasterIO(hDstBand, GF_Write,
-                    0, 0, nXSize, 1,
-                    pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
+            afWin[0] = INTERPOL(pafLine1[jcur], pafLine1[jcur+1]);
+            afWin[1] = pafLine1[jcur];
+            afWin[2] = pafLine1[jcur+1];
+            afWin[3] = INTERPOL(pafLine2[jcur], pafLine2[jcur+1]);
+            afWin[4] = pafLine2[jcur];
+            afWin[5] = pafLine2[jcur+1];
+            afWin[6] = INTERPOL(pafLine3[jcur], pafLine3[jcur+1]);
+            afWin[7] = pafLine3[jcur];
+            afWin[8] = pafLine3[jcur+1];
 
-        if (eErr == CE_None && nYSize > 1)
+            GDALGeneric3x3ComputeProducts(psCtxt, afWin, FALSE,
+                                          papafOutputBuf, 0);
+        }
+        else
         {
-            eErr = GDALRasterIO(hDstBand, GF_Write,
-                        0, nYSize - 1, nXSize, 1,
-                        pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
+            // Exclude the edges
+            GDALGeneric3x3SetNoData(psCtxt, papafOutputBuf, 0);
         }
+        j ++;
     }
-    if( eErr != CE_None )
-        goto end;
 
-
-    for ( i = 1; i < nYSize-1; i++)
+    const int nInteriorEnd = std::min(nXEnd, nXSize - 1);
+    int bSkipMultisample = FALSE;
+    if( !bSrcHasNoData && j < nInteriorEnd )
     {
-        /* Read third line of the line buffer */
-        eErr = GDALRasterIO(   hSrcBand,
-                        GF_Read,
-                        0, i+1,
-                        nXSize, 1,
-                        pafThreeLineWin + nLine3Off,
-                        nXSize, 1,
-                        GDT_Float32,
-                        0, 0);
-        if (eErr != CE_None)
-            goto end;
-
-        if (bComputeAtEdges && nXSize >= 2)
-        {
-            float afWin[9];
-
-            j = 0;
-            afWin[0] = INTERPOL(pafThreeLineWin[nLine1Off + j], pafThreeLineWin[nLine1Off + j+1]);
-            afWin[1] = pafThreeLineWin[nLine1Off + j];
-            afWin[2] = pafThreeLineWin[nLine1Off + j+1];
-            afWin[3] = INTERPOL(pafThreeLineWin[nLine2Off + j], pafThreeLineWin[nLine2Off + j+1]);
-            afWin[4] = pafThreeLineWin[nLine2Off + j];
-            afWin[5] = pafThreeLineWin[nLine2Off + j+1];
-            afWin[6] = INTERPOL(pafThreeLineWin[nLine3Off + j], pafThreeLineWin[nLine3Off + j+1]);
-            afWin[7] = pafThreeLineWin[nLine3Off + j];
-            afWin[8] = pafThreeLineWin[nLine3Off + j+1];
-
-            pafOutputBuf[j] = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                                         bIsSrcNoDataNan,
-                                         afWin, fDstNoDataValue,
-                                         pfnAlg, pData, bComputeAtEdges);
-            j = nXSize - 1;
-
-            afWin[0] = pafThreeLineWin[nLine1Off + j-1];
-            afWin[1] = pafThreeLineWin[nLine1Off + j];
-            afWin[2] = INTERPOL(pafThreeLineWin[nLine1Off + j], pafThreeLineWin[nLine1Off + j-1]);
-            afWin[3] = pafThreeLineWin[nLine2Off + j-1];
-            afWin[4] = pafThreeLineWin[nLine2Off + j];
-            afWin[5] = INTERPOL(pafThreeLineWin[nLine2Off + j], pafThreeLineWin[nLine2Off + j-1]);
-            afWin[6] = pafThreeLineWin[nLine3Off + j-1];
-            afWin[7] = pafThreeLineWin[nLine3Off + j];
-            afWin[8] = INTERPOL(pafThreeLineWin[nLine3Off + j], pafThreeLineWin[nLine3Off + j-1]);
-
-            pafOutputBuf[j] = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                                         bIsSrcNoDataNan,
-                                         afWin, fDstNoDataValue,
-                                         pfnAlg, pData, bComputeAtEdges);
+        int bAllMultisample = TRUE;
+        for( int iProduct = 0; iProduct < psCtxt->nProducts; iProduct++ )
+        {
+            const GDALGeneric3x3Product* psProduct = psCtxt->pasProducts + iProduct;
+            if( psProduct->pfnAlgMultisample == NULL )
+            {
+                bAllMultisample = FALSE;
+                continue;
+            }
+            psProduct->pfnAlgMultisample(pafLine1 + j - 1 - nSrcXOff,
+                                         pafLine2 + j - 1 - nSrcXOff,
+                                         pafLine3 + j - 1 - nSrcXOff,
+                                         nInteriorEnd - j,
+                                         psProduct->pData,
+                                         papafOutputBuf[iProduct] + j - nXStart);
+            bSkipMultisample = TRUE;
+        }
+        if( bAllMultisample )
+            j = nInteriorEnd;
+    }
+
+    for( ; j < nInteriorEnd; j++ )
+    {
+        const int jcur = j - nSrcXOff;
+        afWin[0] = pafLine1[jcur-1];
+        afWin[1] = pafLine1[jcur];
+        afWin[2] = pafLine1[jcur+1];
+        afWin[3] = pafLine2[jcur-1];
+        afWin[4] = pafLine2[jcur];
+        afWin[5] = pafLine2[jcur+1];
+        afWin[6] = pafLine3[jcur-1];
+        afWin[7] = pafLine3[jcur];
+        afWin[8] = pafLine3[jcur+1];
+
+        GDALGeneric3x3ComputeProducts(psCtxt, afWin, bSkipMultisample,
+                                      papafOutputBuf, j - nXStart);
+    }
+
+    if( j < nXEnd )
+    {
+        /* Last column of the raster */
+        CPLAssert( j == nXSize - 1 );
+        const int jcur = j - nSrcXOff;
+        if( bComputeAtEdges && nXSize >= 2 )
+        {
+            afWin[0] = pafLine1[jcur-1];
+            afWin[1] = pafLine1[jcur];
+            afWin[2] = INTERPOL(pafLine1[jcur], pafLine1[jcur-1]);
+            afWin[3] = pafLine2[jcur-1];
+            afWin[4] = pafLine2[jcur];
+            afWin[5] = INTERPOL(pafLine2[jcur], pafLine2[jcur-1]);
+            afWin[6] = pafLine3[jcur-1];
+            afWin[7] = pafLine3[jcur];
+            afWin[8] = INTERPOL(pafLine3[jcur], pafLine3[jcur-1]);
+
+            GDALGeneric3x3ComputeProducts(psCtxt, afWin, FALSE,
+                                          papafOutputBuf, j - nXStart);
         }
         else
         {
             // Exclude the edges
-            pafOutputBuf[0] = fDstNoDataValue;
-            if (nXSize > 1)
-                pafOutputBuf[nXSize - 1] = fDstNoDataValue;
+            GDALGeneric3x3SetNoData(psCtxt, papafOutputBuf, j - nXStart);
         }
+    }
+}
 
-        for (j = 1; j < nXSize - 1; j++)
-        {
-            float afWin[9];
-            afWin[0] = pafThreeLineWin[nLine1Off + j-1];
-            afWin[1] = pafThreeLineWin[nLine1Off + j];
-            afWin[2] = pafThreeLineWin[nLine1Off + j+1];
-            afWin[3] = pafThreeLineWin[nLine2Off + j-1];
-            afWin[4] = pafThreeLineWin[nLine2Off + j];
-            afWin[5] = pafThreeLineWin[nLine2Off + j+1];
-            afWin[6] = pafThreeLineWin[nLine3Off + j-1];
-            afWin[7] = pafThreeLineWin[nLine3Off + j];
-            afWin[8] = pafThreeLineWin[nLine3Off + j+1];
+/************************************************************************/
+/*                   GDALGeneric3x3ProcessTileJob()                     */
+/************************************************************************/
 
-            pafOutputBuf[j] = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                                         bIsSrcNoDataNan,
-                                         afWin, fDstNoDataValue,
-                                         pfnAlg, pData, bComputeAtEdges);
-        }
+typedef struct
+{
+    const GDALGeneric3x3ProcessingContext* psCtxt;
+
+    /* Source window, with a 1 pixel halo when inside the raster */
+    const float* pafSrcBuf;
+    int          nSrcXOff;
+    int          nSrcYOff;
+    int          nSrcXSize;
+
+    /* Destination window, one buffer per product */
+    float* const* papafDstBuf;
+    int          nDstXOff;
+    int          nDstYOff;
+    int          nDstXSize;
+
+    /* Part of the destination window processed by this job */
+    int          nTileXOff;
+    int          nTileYOff;
+    int          nTileXSize;
+    int          nTileYSize;
+} GDALGeneric3x3TileJob;
+
+static void GDALGeneric3x3ProcessTileJob( void* pData )
+{
+    const GDALGeneric3x3TileJob* psJob = (const GDALGeneric3x3TileJob*) pData;
+    const int nYSize = psJob->psCtxt->nRasterYSize;
+    const int nProducts = psJob->psCtxt->nProducts;
+    std::vector<float*> apafOutputBuf(nProducts);
+
+    for( int i = psJob->nTileYOff; i < psJob->nTileYOff + psJob->nTileYSize; i++ )
+    {
+        const float* pafLine2 = psJob->pafSrcBuf +
+                        (size_t)(i - psJob->nSrcYOff) * psJob->nSrcXSize;
+        const float* pafLine1 = (i > 0) ? pafLine2 - psJob->nSrcXSize : NULL;
+        const float* pafLine3 = (i < nYSize - 1) ? pafLine2 + psJob->nSrcXSize : NULL;
+        for( int iProduct = 0; iProduct < nProducts; iProduct++ )
+            apafOutputBuf[iProduct] = psJob->papafDstBuf[iProduct] +
+                        (size_t)(i - psJob->nDstYOff) * psJob->nDstXSize +
+                        (psJob->nTileXOff - psJob->nDstXOff);
+
+        GDALGeneric3x3ProcessLine( psJob->psCtxt,
+                                   pafLine1, pafLine2, pafLine3,
+                                   psJob->nSrcXOff,
+                                   psJob->nTileXOff,
+                                   psJob->nTileXOff + psJob->nTileXSize,
+                                   &apafOutputBuf[0] );
+    }
+}
 
-        /* -----------------------------------------
-         * Write Line to Raster
-         */
-        eErr = GDALRasterIO(hDstBand, GF_Write, 0, i, nXSize, 1,
-                     pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
-        if (eErr != CE_None)
-            goto end;
+/************************************************************************/
+/*                    GDALGeneric3x3ProcessWindow()                     */
+/************************************************************************/
 
-        if( !pfnProgress( 1.0 * (i+1) / nYSize, NULL, pProgressData ) )
+/* Size of the tiles into which a window is split for parallel processing */
+#define GENERIC3X3_TILE_SIZE   256
+
+/* Compute the output values of a window of the raster into */
+/* papafDstBuf[iProduct] (nXSize * nYSize arrays). The source window, extended with a 1 pixel */
+/* halo, is read in the calling thread, and then split into tiles that */
+/* are processed by the worker threads of poThreadPool, if not NULL. */
+
+static CPLErr GDALGeneric3x3ProcessWindow( const GDALGeneric3x3ProcessingContext* psCtxt,
+                                           CPLWorkerThreadPool* poThreadPool,
+                                           GDALRasterBandH hSrcBand,
+                                           int nXOff, int nYOff,
+                                           int nXSize, int nYSize,
+                                           float* const* papafDstBuf )
+{
+    const int nSrcXOff = std::max(0, nXOff - 1);
+    const int nSrcYOff = std::max(0, nYOff - 1);
+    const int nSrcXSize = std::min(psCtxt->nRasterXSize, nXOff + nXSize + 1) - nSrcXOff;
+    const int nSrcYSize = std::min(psCtxt->nRasterYSize, nYOff + nYSize + 1) - nSrcYOff;
+
+    float* pafSrcBuf = (float*) VSI_MALLOC3_VERBOSE(sizeof(float),
+                                                    nSrcXSize, nSrcYSize);
+    if( pafSrcBuf == NULL )
+        return CE_Failure;
+
+    CPLErr eErr = GDALRasterIO( hSrcBand, GF_Read,
+                                nSrcXOff, nSrcYOff, nSrcXSize, nSrcYSize,
+                                pafSrcBuf, nSrcXSize, nSrcYSize,
+                                GDT_Float32, 0, 0 );
+    if( eErr != CE_None )
+    {
+        CPLFree(pafSrcBuf);
+        return eErr;
+    }
+
+    GDALGeneric3x3TileJob sJob;
+    sJob.psCtxt = psCtxt;
+    sJob.pafSrcBuf = pafSrcBuf;
+    sJob.nSrcXOff = nSrcXOff;
+    sJob.nSrcYOff = nSrcYOff;
+    sJob.nSrcXSize = nSrcXSize;
+    sJob.papafDstBuf = papafDstBuf;
+    sJob.nDstXOff = nXOff;
+    sJob.nDstYOff = nYOff;
+    sJob.nDstXSize = nXSize;
+    sJob.nTileXOff = nXOff;
+    sJob.nTileYOff = nYOff;
+    sJob.nTileXSize = nXSize;
+    sJob.nTileYSize = nYSize;
+
+    if( poThreadPool == NULL ||
+        (nXSize <= GENERIC3X3_TILE_SIZE && nYSize <= GENERIC3X3_TILE_SIZE) )
+    {
+        GDALGeneric3x3ProcessTileJob(&sJob);
+    }
+    else
+    {
+        std::vector<GDALGeneric3x3TileJob> asJobs;
+        for( int nTileYOff = nYOff; nTileYOff < nYOff + nYSize;
+             nTileYOff += GENERIC3X3_TILE_SIZE )
         {
-            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-            eErr = CE_Failure;
-            goto end;
+            for( int nTileXOff = nXOff; nTileXOff < nXOff + nXSize;
+                 nTileXOff += GENERIC3X3_TILE_SIZE )
+            {
+                sJob.nTileXOff = nTileXOff;
+                sJob.nTileYOff = nTileYOff;
+                sJob.nTileXSize = std::min(GENERIC3X3_TILE_SIZE,
+                                           nXOff + nXSize - nTileXOff);
+                sJob.nTileYSize = std::min(GENERIC3X3_TILE_SIZE,
+                                           nYOff + nYSize - nTileYOff);
+                asJobs.push_back(sJob);
+            }
         }
 
-        int nTemp = nLine1Off;
-        nLine1Off = nLine2Off;
-        nLine2Off = nLine3Off;
-        nLine3Off = nTemp;
+        std::vector<void*> apJobs;
+        for( size_t i = 0; i < asJobs.size(); i++ )
+            apJobs.push_back(&asJobs[i]);
+        poThreadPool->SubmitJobs(GDALGeneric3x3ProcessTileJob, apJobs);
+        poThreadPool->WaitCompletion();
     }
 
-    if (bComputeAtEdges && nXSize >= 2 && nYSize >= 2)
+    CPLFree(pafSrcBuf);
+    return CE_None;
+}
+
+/************************************************************************/
+/*                   GDALGeneric3x3CreateThreadPool()                   */
+/************************************************************************/
+
+/* Return a worker thread pool sized according to the GDAL_NUM_THREADS */
+/* configuration option, or NULL if only one thread must be used. */
+
+static CPLWorkerThreadPool* GDALGeneric3x3CreateThreadPool()
+{
+    const int nThreads = CPLGetConfiguredNumThreads("ALL_CPUS");
+    if( nThreads <= 1 )
+        return NULL;
+
+    CPLWorkerThreadPool* poThreadPool = new CPLWorkerThreadPool();
+    if( !poThreadPool->Setup(nThreads, NULL, NULL) )
     {
-        for (j = 0; j < nXSize; j++)
-        {
-            float afWin[9];
-            int jmin = (j == 0) ? j : j - 1;
-            int jmax = (j == nXSize - 1) ? j : j + 1;
+        delete poThreadPool;
+        return NULL;
+    }
+    CPLDebug("GDALDEM", "Using %d threads", nThreads);
+    return poThreadPool;
+}
+
+/************************************************************************/
+/*                  GDALGeneric3x3Processing()                          */
+/************************************************************************/
 
-            afWin[0] = pafThreeLineWin[nLine1Off + jmin];
-            afWin[1] = pafThreeLineWin[nLine1Off + j];
-            afWin[2] = pafThreeLineWin[nLine1Off + jmax];
-            afWin[3] = pafThreeLineWin[nLine2Off + jmin];
-            afWin[4] = pafThreeLineWin[nLine2Off + j];
-            afWin[5] = pafThreeLineWin[nLine2Off + jmax];
-            afWin[6] = INTERPOL(pafThreeLineWin[nLine2Off + jmin], pafThreeLineWin[nLine1Off + jmin]);
-            afWin[7] = INTERPOL(pafThreeLineWin[nLine2Off + j],    pafThreeLineWin[nLine1Off + j]);
-            afWin[8] = INTERPOL(pafThreeLineWin[nLine2Off + jmax], pafThreeLineWin[nLine1Off + jmax]);
+/* Maximum number of source values read at once by GDALGeneric3x3Processing() */
+#define GENERIC3X3_MAX_CHUNK_PIXELS   (8 * 1024 * 1024)
 
-            pafOutputBuf[j] = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                                         bIsSrcNoDataNan,
-                                         afWin, fDstNoDataValue,
-                                         pfnAlg, pData, bComputeAtEdges);
-        }
-        eErr = GDALRasterIO(hDstBand, GF_Write,
-                     0, i, nXSize, 1,
-                     pafOutputBuf, nXSize, 1, GDT_Float32, 0, 0);
-        if( eErr != CE_None )
-            goto end;
+/* Compute the nProducts products of hSrcBand into the bands pahDstBands, */
+/* reading the source only once. The nodata value of each product is the */
+/* one of its destination band, or 0 if it has none. */
+
+static
+CPLErr GDALGeneric3x3Processing  ( GDALRasterBandH hSrcBand,
+                                   int nProducts,
+                                   GDALGeneric3x3Product* pasProducts,
+                                   GDALRasterBandH* pahDstBands,
+                                   int bComputeAtEdges,
+                                   GDALProgressFunc pfnProgress,
+                                   void * pProgressData)
+{
+    CPLErr eErr = CE_None;
+    int iProduct;
+
+    int nXSize = GDALGetRasterBandXSize(hSrcBand);
+    int nYSize = GDALGetRasterBandYSize(hSrcBand);
+
+    if (pfnProgress == NULL)
+        pfnProgress = GDALDummyProgress;
+
+/* -------------------------------------------------------------------- */
+/*      Initialize progress counter.                                    */
+/* -------------------------------------------------------------------- */
+    if( !pfnProgress( 0.0, NULL, pProgressData ) )
+    {
+        CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+        return CE_Failure;
     }
 
-    pfnProgress( 1.0, NULL, pProgressData );
-    eErr = CE_None;
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+    {
+        int bDstHasNoData;
+        float fDstNoDataValue = (float) GDALGetRasterNoDataValue(
+                                    pahDstBands[iProduct], &bDstHasNoData);
+        if (!bDstHasNoData)
+            fDstNoDataValue = 0.0;
+        pasProducts[iProduct].fDstNoDataValue = fDstNoDataValue;
+    }
 
-end:
-    CPLFree(pafOutputBuf);
-    CPLFree(pafThreeLineWin);
+    GDALGeneric3x3ProcessingContext sCtxt;
+    GDALGeneric3x3InitContext(&sCtxt, hSrcBand, pasProducts, nProducts,
+                              bComputeAtEdges);
+
+/* -------------------------------------------------------------------- */
+/*      Process the raster by chunks of whole lines. Each chunk is      */
+/*      split into tiles that are computed in parallel. The height of   */
+/*      the chunks is a multiple of the height of the destination       */
+/*      blocks so that tiled outputs are written block by block.        */
+/* -------------------------------------------------------------------- */
+    int nDstBlockXSize, nDstBlockYSize;
+    GDALGetBlockSize(pahDstBands[0], &nDstBlockXSize, &nDstBlockYSize);
+    int nChunkYSize = GENERIC3X3_MAX_CHUNK_PIXELS / nXSize;
+    if( nDstBlockYSize > 1 )
+        nChunkYSize = std::max(nDstBlockYSize,
+                               nChunkYSize / nDstBlockYSize * nDstBlockYSize);
+    nChunkYSize = std::max(1, std::min(nYSize, nChunkYSize));
+
+    std::vector<float*> apafOutputBuf(nProducts);
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+    {
+        apafOutputBuf[iProduct] = (float *) VSI_MALLOC3_VERBOSE(sizeof(float),
+                                                        nXSize, nChunkYSize);
+        if( apafOutputBuf[iProduct] == NULL )
+            eErr = CE_Failure;
+    }
+
+    CPLWorkerThreadPool* poThreadPool =
+                (eErr == CE_None) ? GDALGeneric3x3CreateThreadPool() : NULL;
+
+    for( int nYOff = 0; eErr == CE_None && nYOff < nYSize; nYOff += nChunkYSize )
+    {
+        const int nReqYSize = std::min(nChunkYSize, nYSize - nYOff);
+
+        eErr = GDALGeneric3x3ProcessWindow( &sCtxt, poThreadPool, hSrcBand,
+                                            0, nYOff, nXSize, nReqYSize,
+                                            &apafOutputBuf[0] );
+        if( eErr != CE_None )
+            break;
+
+        /* -----------------------------------------
+         * Write Lines to Raster
+         */
+        for( iProduct = 0; eErr == CE_None && iProduct < nProducts; iProduct++ )
+        {
+            eErr = GDALRasterIO(pahDstBands[iProduct], GF_Write,
+                                0, nYOff, nXSize, nReqYSize,
+                                apafOutputBuf[iProduct], nXSize, nReqYSize,
+                                GDT_Float32, 0, 0);
+        }
+        if (eErr != CE_None)
+            break;
+
+        if( !pfnProgress( 1.0 * (nYOff + nReqYSize) / nYSize, NULL, pProgressData ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+            break;
+        }
+    }
+
+    delete poThreadPool;
+    for( iProduct = 0; iProduct < nProducts; iProduct++ )
+        CPLFree(apafOutputBuf[iProduct]);
 
     return eErr;
 }
 
-
 /************************************************************************/
 /*                         GDALHillshade()                              */
 /************************************************************************/
@@ -452,6 +758,8 @@ typedef struct
     double azRadians;
     double square_z_scale_factor;
     double square_M_PI_2;
+    double cos_az_mul_cos_alt_mul_z;
+    double sin_az_mul_cos_alt_mul_z;
 } GDALHillshadeAlgData;
 
 /* Unoptimized formulas are :
@@ -470,13 +778,17 @@ typedef struct
     cang = sin(alt * degreesToRadians) * sin(slope) +
            cos(alt * degreesToRadians) * cos(slope) *
            cos(az * degreesToRadians - M_PI/2 - aspect);
+
+   As sin(aspect) = y / sqrt(x*x + y*y) and cos(aspect) = x / sqrt(x*x + y*y),
+   sqrt(x*x + y*y) * sin(aspect - az) = y * cos(az) - x * sin(az), which avoids
+   any trigonometric function call per pixel.
 */
 
 static
 float GDALHillshadeAlg (float* afWin, CPL_UNUSED float fDstNoDataValue, void* pData)
 {
     GDALHillshadeAlgData* psData = (GDALHillshadeAlgData*)pData;
-    double x, y, aspect, xx_plus_yy, cang;
+    double x, y, xx_plus_yy, cang;
 
     // First Slope ...
     x = ((afWin[0] + afWin[3] + afWin[3] + afWin[6]) -
@@ -487,13 +799,10 @@ float GDALHillshadeAlg (float* afWin, CPL_UNUSED float fDstNoDataValue, void* pD
 
     xx_plus_yy = x * x + y * y;
 
-    // ... then aspect...
-    aspect = atan2(y,x);
-
     // ... then the shade value
     cang = (psData->sin_altRadians -
-           psData->cos_altRadians_mul_z_scale_factor * sqrt(xx_plus_yy) *
-           sin(aspect - psData->azRadians)) /
+           (y * psData->cos_az_mul_cos_alt_mul_z -
+            x * psData->sin_az_mul_cos_alt_mul_z)) /
            sqrt(1 + psData->square_z_scale_factor * xx_plus_yy);
 
     if (cang <= 0.0)
@@ -544,7 +853,7 @@ static
 float GDALHillshadeZevenbergenThorneAlg (float* afWin, CPL_UNUSED float fDstNoDataValue, void* pData)
 {
     GDALHillshadeAlgData* psData = (GDALHillshadeAlgData*)pData;
-    double x, y, aspect, xx_plus_yy, cang;
+    double x, y, xx_plus_yy, cang;
 
     // First Slope ...
     x = (afWin[3] - afWin[5]) / psData->ewres;
@@ -553,13 +862,10 @@ float GDALHillshadeZevenbergenThorneAlg (float* afWin, CPL_UNUSED float fDstNoDa
 
     xx_plus_yy = x * x + y * y;
 
-    // ... then aspect...
-    aspect = atan2(y,x);
-
     // ... then the shade value
     cang = (psData->sin_altRadians -
-           psData->cos_altRadians_mul_z_scale_factor * sqrt(xx_plus_yy) *
-           sin(aspect - psData->azRadians)) /
+           (y * psData->cos_az_mul_cos_alt_mul_z -
+            x * psData->sin_az_mul_cos_alt_mul_z)) /
            sqrt(1 + psData->square_z_scale_factor * xx_plus_yy);
 
     if (cang <= 0.0)
@@ -625,9 +931,144 @@ void*  GDALCreateHillshadeData(double* adfGeoTransform,
         cos(alt * degreesToRadians) * z_scale_factor;
     pData->square_z_scale_factor = z_scale_factor * z_scale_factor;
     pData->square_M_PI_2 = (M_PI*M_PI)/4;
+    pData->cos_az_mul_cos_alt_mul_z =
+        pData->cos_altRadians_mul_z_scale_factor * cos(pData->azRadians);
+    pData->sin_az_mul_cos_alt_mul_z =
+        pData->cos_altRadians_mul_z_scale_factor * sin(pData->azRadians);
     return pData;
 }
 
+#ifdef USE_SSE2
+
+/************************************************************************/
+/*                       GDALGradient4Samples()                         */
+/************************************************************************/
+
+enum GDALGradientAlg
+{
+    GRADIENT_HORN,
+    GRADIENT_ZEVENBERGEN_THORNE
+};
+
+/* Compute the x and y gradients of 4 consecutive pixels, with the same */
+/* single precision arithmetic as the scalar algorithms. */
+template<GDALGradientAlg eAlg> static inline
+void GDALGradient4Samples( const float* pafLine1,
+                           const float* pafLine2,
+                           const float* pafLine3,
+                           __m128& x, __m128& y )
+{
+    const __m128 w1 = _mm_loadu_ps(pafLine1 + 1);
+    const __m128 w3 = _mm_loadu_ps(pafLine2);
+    const __m128 w5 = _mm_loadu_ps(pafLine2 + 2);
+    const __m128 w7 = _mm_loadu_ps(pafLine3 + 1);
+    if( eAlg == GRADIENT_ZEVENBERGEN_THORNE )
+    {
+        x = _mm_sub_ps(w3, w5);
+        y = _mm_sub_ps(w7, w1);
+    }
+    else
+    {
+        const __m128 w0 = _mm_loadu_ps(pafLine1);
+        const __m128 w2 = _mm_loadu_ps(pafLine1 + 2);
+        const __m128 w6 = _mm_loadu_ps(pafLine3);
+        const __m128 w8 = _mm_loadu_ps(pafLine3 + 2);
+        x = _mm_sub_ps(
+                _mm_add_ps(_mm_add_ps(_mm_add_ps(w0, w3), w3), w6),
+                _mm_add_ps(_mm_add_ps(_mm_add_ps(w2, w5), w5), w8));
+        y = _mm_sub_ps(
+                _mm_add_ps(_mm_add_ps(_mm_add_ps(w6, w7), w7), w8),
+                _mm_add_ps(_mm_add_ps(_mm_add_ps(w0, w1), w1), w2));
+    }
+}
+
+/************************************************************************/
+/*                   GDALLoad3x3Window()                                */
+/************************************************************************/
+
+static inline void GDALLoad3x3Window( const float* pafLine1,
+                                      const float* pafLine2,
+                                      const float* pafLine3,
+                                      float* afWin )
+{
+    afWin[0] = pafLine1[0];
+    afWin[1] = pafLine1[1];
+    afWin[2] = pafLine1[2];
+    afWin[3] = pafLine2[0];
+    afWin[4] = pafLine2[1];
+    afWin[5] = pafLine2[2];
+    afWin[6] = pafLine3[0];
+    afWin[7] = pafLine3[1];
+    afWin[8] = pafLine3[2];
+}
+
+/************************************************************************/
+/*                  GDALHillshadeAlg_multisample()                      */
+/************************************************************************/
+
+template<GDALGradientAlg eAlg> static
+void GDALHillshadeAlg_multisample (const float* pafLine1,
+                                   const float* pafLine2,
+                                   const float* pafLine3,
+                                   int nCount,
+                                   void* pData,
+                                   float* pafOutputBuf)
+{
+    GDALHillshadeAlgData* psData = (GDALHillshadeAlgData*)pData;
+    const __m128d ewres = _mm_set1_pd(psData->ewres);
+    const __m128d nsres = _mm_set1_pd(psData->nsres);
+    const __m128d sin_alt = _mm_set1_pd(psData->sin_altRadians);
+    const __m128d cos_az_mul_cos_alt_mul_z =
+                        _mm_set1_pd(psData->cos_az_mul_cos_alt_mul_z);
+    const __m128d sin_az_mul_cos_alt_mul_z =
+                        _mm_set1_pd(psData->sin_az_mul_cos_alt_mul_z);
+    const __m128d square_z = _mm_set1_pd(psData->square_z_scale_factor);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d v254 = _mm_set1_pd(254.0);
+
+    int k = 0;
+    for( ; k + 4 <= nCount; k += 4 )
+    {
+        __m128 xf, yf;
+        GDALGradient4Samples<eAlg>(pafLine1 + k, pafLine2 + k, pafLine3 + k,
+                                   xf, yf);
+
+        __m128 afRes[2];
+        for( int iHalf = 0; iHalf < 2; iHalf++ )
+        {
+            // Process the low, then the high pair of values in double
+            const __m128d x = _mm_div_pd(_mm_cvtps_pd(xf), ewres);
+            const __m128d y = _mm_div_pd(_mm_cvtps_pd(yf), nsres);
+            const __m128d xx_plus_yy = _mm_add_pd(_mm_mul_pd(x, x),
+                                                  _mm_mul_pd(y, y));
+            __m128d cang = _mm_div_pd(
+                _mm_sub_pd(sin_alt,
+                    _mm_sub_pd(_mm_mul_pd(y, cos_az_mul_cos_alt_mul_z),
+                               _mm_mul_pd(x, sin_az_mul_cos_alt_mul_z))),
+                _mm_sqrt_pd(_mm_add_pd(one, _mm_mul_pd(square_z, xx_plus_yy))));
+            // cang <= 0 ? 1 : 1 + 254 * cang
+            cang = _mm_add_pd(one, _mm_mul_pd(v254, _mm_max_pd(zero, cang)));
+            afRes[iHalf] = _mm_cvtpd_ps(cang);
+
+            xf = _mm_movehl_ps(xf, xf);
+            yf = _mm_movehl_ps(yf, yf);
+        }
+        _mm_storeu_ps(pafOutputBuf + k, _mm_movelh_ps(afRes[0], afRes[1]));
+    }
+
+    for( ; k < nCount; k++ )
+    {
+        float afWin[9];
+        GDALLoad3x3Window(pafLine1 + k, pafLine2 + k, pafLine3 + k, afWin);
+        pafOutputBuf[k] = ( eAlg == GRADIENT_HORN ) ?
+            GDALHillshadeAlg(afWin, 0.0f, pData) :
+            GDALHillshadeZevenbergenThorneAlg(afWin, 0.0f, pData);
+    }
+}
+
+#endif /* USE_SSE2 */
+
 /************************************************************************/
 /*                         GDALSlope()                                  */
 /************************************************************************/
@@ -695,6 +1136,76 @@ void*  GDALCreateSlopeData(double* adfGeoTransform,
     return pData;
 }
 
+#ifdef USE_SSE2
+
+/************************************************************************/
+/*                    GDALSlopeAlg_multisample()                        */
+/************************************************************************/
+
+template<GDALGradientAlg eAlg> static
+void GDALSlopeAlg_multisample (const float* pafLine1,
+                               const float* pafLine2,
+                               const float* pafLine3,
+                               int nCount,
+                               void* pData,
+                               float* pafOutputBuf)
+{
+    const double radiansToDegrees = 180.0 / M_PI;
+    GDALSlopeAlgData* psData = (GDALSlopeAlgData*)pData;
+    const __m128d ewres = _mm_set1_pd(psData->ewres);
+    const __m128d nsres = _mm_set1_pd(psData->nsres);
+    const __m128d scale = _mm_set1_pd(
+        ((eAlg == GRADIENT_HORN) ? 8 : 2) * psData->scale);
+    const __m128d v100 = _mm_set1_pd(100.0);
+
+    int k = 0;
+    for( ; k + 4 <= nCount; k += 4 )
+    {
+        __m128 xf, yf;
+        GDALGradient4Samples<eAlg>(pafLine1 + k, pafLine2 + k, pafLine3 + k,
+                                   xf, yf);
+
+        __m128 afRes[2];
+        for( int iHalf = 0; iHalf < 2; iHalf++ )
+        {
+            // Process the low, then the high pair of values in double
+            const __m128d dx = _mm_div_pd(_mm_cvtps_pd(xf), ewres);
+            const __m128d dy = _mm_div_pd(_mm_cvtps_pd(yf), nsres);
+            const __m128d key = _mm_add_pd(_mm_mul_pd(dx, dx),
+                                           _mm_mul_pd(dy, dy));
+            __m128d val = _mm_div_pd(_mm_sqrt_pd(key), scale);
+            if( psData->slopeFormat == 1 )
+            {
+                double adfVal[2];
+                _mm_storeu_pd(adfVal, val);
+                adfVal[0] = atan(adfVal[0]) * radiansToDegrees;
+                adfVal[1] = atan(adfVal[1]) * radiansToDegrees;
+                val = _mm_loadu_pd(adfVal);
+            }
+            else
+            {
+                val = _mm_mul_pd(v100, val);
+            }
+            afRes[iHalf] = _mm_cvtpd_ps(val);
+
+            xf = _mm_movehl_ps(xf, xf);
+            yf = _mm_movehl_ps(yf, yf);
+        }
+        _mm_storeu_ps(pafOutputBuf + k, _mm_movelh_ps(afRes[0], afRes[1]));
+    }
+
+    for( ; k < nCount; k++ )
+    {
+        float afWin[9];
+        GDALLoad3x3Window(pafLine1 + k, pafLine2 + k, pafLine3 + k, afWin);
+        pafOutputBuf[k] = ( eAlg == GRADIENT_HORN ) ?
+            GDALSlopeHornAlg(afWin, 0.0f, pData) :
+            GDALSlopeZevenbergenThorneAlg(afWin, 0.0f, pData);
+    }
+}
+
+#endif /* USE_SSE2 */
+
 /************************************************************************/
 /*                         GDALAspect()                                 */
 /************************************************************************/
@@ -1955,33 +2466,43 @@ class GDALGeneric3x3Dataset : public GDALDataset
 {
     friend class GDALGeneric3x3RasterBand;
 
-    GDALGeneric3x3ProcessingAlg pfnAlg;
-    void*              pAlgData;
+    std::vector<GDALGeneric3x3Product> asProducts;
+    GDALGeneric3x3ProcessingContext sCtxt;
     GDALDatasetH       hSrcDS;
     GDALRasterBandH    hSrcBand;
     float*             apafSourceBuf[3];
-    int                bDstHasNoData;
-    double             dfDstNoDataValue;
+    float*             pafOutputBuf;
     int                nCurLine;
-    int                bComputeAtEdges;
+    CPLWorkerThreadPool* poThreadPool;
+
+    CPLErr      ComputeWindow( int nXOff, int nYOff, int nXSize, int nYSize,
+                               void * pData, GDALDataType eBufType,
+                               int nBandCount, const int *panBandMap,
+                               GSpacing nPixelSpace, GSpacing nLineSpace,
+                               GSpacing nBandSpace );
 
   public:
                         GDALGeneric3x3Dataset(GDALDatasetH hSrcDS,
                                               GDALRasterBandH hSrcBand,
-                                              GDALDataType eDstDataType,
-                                              int bDstHasNoData,
-                                              double dfDstNoDataValue,
-                                              GDALGeneric3x3ProcessingAlg pfnAlg,
-                                              void* pAlgData,
+                                              int nProducts,
+                                              const GDALGeneric3x3Product* pasProducts,
+                                              const GDALDataType* paeDstDataType,
+                                              const int* pabDstHasNoData,
                                               int bComputeAtEdges);
                        ~GDALGeneric3x3Dataset();
 
     bool                InitOK() const { return apafSourceBuf[0] != NULL &&
                                                 apafSourceBuf[1] != NULL &&
-                                                apafSourceBuf[2] != NULL; }
+                                                apafSourceBuf[2] != NULL &&
+                                                pafOutputBuf != NULL; }
 
     CPLErr      GetGeoTransform( double * padfGeoTransform );
     const char *GetProjectionRef();
+
+    virtual CPLErr IRasterIO( GDALRWFlag, int, int, int, int,
+                              void *, int, int, GDALDataType,
+                              int, int *, GSpacing, GSpacing, GSpacing,
+                              GDALRasterIOExtraArg* psExtraArg );
 };
 
 /************************************************************************/
@@ -1993,57 +2514,75 @@ class GDALGeneric3x3Dataset : public GDALDataset
 class GDALGeneric3x3RasterBand : public GDALRasterBand
 {
     friend class GDALGeneric3x3Dataset;
-    int bSrcHasNoData;
-    float fSrcNoDataValue;
-    int bIsSrcNoDataNan;
+
+    int                     bDstHasNoData;
+    double                  dfDstNoDataValue;
 
     void                    InitWidthNoData(void* pImage);
+    void                    CopyOutputLine(const float* pafLine, void* pImage,
+                                           int nCount);
 
   public:
                  GDALGeneric3x3RasterBand( GDALGeneric3x3Dataset *poDS,
-                                           GDALDataType eDstDataType );
+                                           int nBand,
+                                           GDALDataType eDstDataType,
+                                           int bDstHasNoData );
 
     virtual CPLErr          IReadBlock( int, int, void * );
+    virtual CPLErr          IRasterIO( GDALRWFlag, int, int, int, int,
+                                       void *, int, int, GDALDataType,
+                                       GSpacing, GSpacing,
+                                       GDALRasterIOExtraArg* psExtraArg );
     virtual double          GetNoDataValue( int* pbHasNoData );
 };
 
+/* Band i of the dataset holds the product i */
+
 GDALGeneric3x3Dataset::GDALGeneric3x3Dataset(
                                      GDALDatasetH hSrcDSIn,
                                      GDALRasterBandH hSrcBandIn,
-                                     GDALDataType eDstDataType,
-                                     int bDstHasNoDataIn,
-                                     double dfDstNoDataValueIn,
-                                     GDALGeneric3x3ProcessingAlg pfnAlgIn,
-                                     void* pAlgDataIn,
-                                     int bComputeAtEdgesIn)
+                                     int nProducts,
+                                     const GDALGeneric3x3Product* pasProductsIn,
+                                     const GDALDataType* paeDstDataType,
+                                     const int* pabDstHasNoData,
+                                     int bComputeAtEdgesIn) :
+    asProducts(pasProductsIn, pasProductsIn + nProducts)
 {
     hSrcDS = hSrcDSIn;
     hSrcBand = hSrcBandIn;
-    pfnAlg = pfnAlgIn;
-    pAlgData = pAlgDataIn;
-    bDstHasNoData = bDstHasNoDataIn;
-    dfDstNoDataValue = dfDstNoDataValueIn;
-    bComputeAtEdges = bComputeAtEdgesIn;
 
-    CPLAssert(eDstDataType == GDT_Byte || eDstDataType == GDT_Float32);
+    GDALGeneric3x3InitContext(&sCtxt, hSrcBand, &asProducts[0], nProducts,
+                              bComputeAtEdgesIn);
 
     nRasterXSize = GDALGetRasterXSize(hSrcDS);
     nRasterYSize = GDALGetRasterYSize(hSrcDS);
 
-    SetBand(1, new GDALGeneric3x3RasterBand(this, eDstDataType));
+    for( int i = 0; i < nProducts; i++ )
+    {
+        CPLAssert(paeDstDataType[i] == GDT_Byte ||
+                  paeDstDataType[i] == GDT_Float32);
+        SetBand(i + 1, new GDALGeneric3x3RasterBand(this, i + 1,
+                                                    paeDstDataType[i],
+                                                    pabDstHasNoData[i]));
+    }
 
     apafSourceBuf[0] = (float *) VSI_MALLOC2_VERBOSE(sizeof(float),nRasterXSize);
     apafSourceBuf[1] = (float *) VSI_MALLOC2_VERBOSE(sizeof(float),nRasterXSize);
     apafSourceBuf[2] = (float *) VSI_MALLOC2_VERBOSE(sizeof(float),nRasterXSize);
+    pafOutputBuf = (float *) VSI_MALLOC2_VERBOSE(sizeof(float),nRasterXSize);
 
     nCurLine = -1;
+
+    poThreadPool = GDALGeneric3x3CreateThreadPool();
 }
 
 GDALGeneric3x3Dataset::~GDALGeneric3x3Dataset()
 {
+    delete poThreadPool;
     CPLFree(apafSourceBuf[0]);
     CPLFree(apafSourceBuf[1]);
     CPLFree(apafSourceBuf[2]);
+    CPLFree(pafOutputBuf);
 }
 
 CPLErr GDALGeneric3x3Dataset::GetGeoTransform( double * padfGeoTransform )
@@ -2056,34 +2595,149 @@ const char *GDALGeneric3x3Dataset::GetProjectionRef()
     return GDALGetProjectionRef(hSrcDS);
 }
 
+/************************************************************************/
+/*                           ComputeWindow()                            */
+/************************************************************************/
+
+/* Compute the products of the bands of panBandMap over a window at full */
+/* resolution, by tiles in parallel, reading the source only once. */
+
+CPLErr GDALGeneric3x3Dataset::ComputeWindow( int nXOff, int nYOff,
+                                             int nXSize, int nYSize,
+                                             void * pData,
+                                             GDALDataType eBufType,
+                                             int nBandCount,
+                                             const int *panBandMap,
+                                             GSpacing nPixelSpace,
+                                             GSpacing nLineSpace,
+                                             GSpacing nBandSpace )
+{
+    std::vector<GDALGeneric3x3Product> asRequestedProducts;
+    std::vector<float*> apafWindowBuf(nBandCount);
+    CPLErr eErr = CE_None;
+    int iBand;
+
+    for( iBand = 0; iBand < nBandCount; iBand++ )
+    {
+        asRequestedProducts.push_back(asProducts[panBandMap[iBand] - 1]);
+        apafWindowBuf[iBand] = (float*) VSI_MALLOC3_VERBOSE(sizeof(float),
+                                                            nXSize, nYSize);
+        if( apafWindowBuf[iBand] == NULL )
+            eErr = CE_Failure;
+    }
+    float* pafLineBuf = (float*) VSI_MALLOC2_VERBOSE(sizeof(float), nXSize);
+    if( pafLineBuf == NULL )
+        eErr = CE_Failure;
+
+    GDALGeneric3x3ProcessingContext sRequestCtxt = sCtxt;
+    sRequestCtxt.pasProducts = &asRequestedProducts[0];
+    sRequestCtxt.nProducts = nBandCount;
+
+    if( eErr == CE_None )
+    {
+        eErr = GDALGeneric3x3ProcessWindow( &sRequestCtxt, poThreadPool,
+                                            hSrcBand,
+                                            nXOff, nYOff, nXSize, nYSize,
+                                            &apafWindowBuf[0] );
+    }
+    for( iBand = 0; eErr == CE_None && iBand < nBandCount; iBand++ )
+    {
+        GDALGeneric3x3RasterBand* poBand =
+            (GDALGeneric3x3RasterBand*) GetRasterBand(panBandMap[iBand]);
+        const GDALDataType eDataType = poBand->GetRasterDataType();
+        for( int i = 0; i < nYSize; i++ )
+        {
+            poBand->CopyOutputLine( apafWindowBuf[iBand] + (size_t)i * nXSize,
+                                    pafLineBuf, nXSize );
+            GDALCopyWords( pafLineBuf, eDataType,
+                           GDALGetDataTypeSize(eDataType) / 8,
+                           (GByte*)pData + iBand * nBandSpace + i * nLineSpace,
+                           eBufType, static_cast<int>(nPixelSpace), nXSize );
+        }
+    }
+
+    for( iBand = 0; iBand < nBandCount; iBand++ )
+        CPLFree(apafWindowBuf[iBand]);
+    CPLFree(pafLineBuf);
+    return eErr;
+}
+
+/************************************************************************/
+/*                             IRasterIO()                              */
+/************************************************************************/
+
+/* Full resolution requests of several bands, such as the ones issued by */
+/* GDALDatasetCopyWholeRaster() on a multi-product dataset, compute all */
+/* the requested products in a single pass over the source. */
+
+CPLErr GDALGeneric3x3Dataset::IRasterIO( GDALRWFlag eRWFlag,
+                                         int nXOff, int nYOff,
+                                         int nXSize, int nYSize,
+                                         void * pData,
+                                         int nBufXSize, int nBufYSize,
+                                         GDALDataType eBufType,
+                                         int nBandCount, int *panBandMap,
+                                         GSpacing nPixelSpace,
+                                         GSpacing nLineSpace,
+                                         GSpacing nBandSpace,
+                                         GDALRasterIOExtraArg* psExtraArg )
+{
+    if( eRWFlag != GF_Read || nBandCount == 1 ||
+        nXSize != nBufXSize || nYSize != nBufYSize )
+    {
+        return GDALDataset::IRasterIO( eRWFlag, nXOff, nYOff, nXSize, nYSize,
+                                       pData, nBufXSize, nBufYSize,
+                                       eBufType, nBandCount, panBandMap,
+                                       nPixelSpace, nLineSpace, nBandSpace,
+                                       psExtraArg );
+    }
+
+    return ComputeWindow( nXOff, nYOff, nXSize, nYSize, pData, eBufType,
+                          nBandCount, panBandMap,
+                          nPixelSpace, nLineSpace, nBandSpace );
+}
+
 GDALGeneric3x3RasterBand::GDALGeneric3x3RasterBand(GDALGeneric3x3Dataset *poDSIn,
-                                                   GDALDataType eDstDataType)
+                                                   int nBandIn,
+                                                   GDALDataType eDstDataType,
+                                                   int bDstHasNoDataIn)
 {
     poDS = poDSIn;
-    this->nBand = 1;
+    this->nBand = nBandIn;
     eDataType = eDstDataType;
     nBlockXSize = poDS->GetRasterXSize();
     nBlockYSize = 1;
-
-    bSrcHasNoData = FALSE;
-    fSrcNoDataValue = (float)GDALGetRasterNoDataValue(poDSIn->hSrcBand,
-                                                      &bSrcHasNoData);
-    bIsSrcNoDataNan = bSrcHasNoData && CPLIsNan(fSrcNoDataValue);
+    bDstHasNoData = bDstHasNoDataIn;
+    dfDstNoDataValue = poDSIn->asProducts[nBandIn - 1].fDstNoDataValue;
 }
 
 void   GDALGeneric3x3RasterBand::InitWidthNoData(void* pImage)
 {
     int j;
-    GDALGeneric3x3Dataset * poGDS = (GDALGeneric3x3Dataset *) poDS;
     if (eDataType == GDT_Byte)
     {
         for(j=0;j<nBlockXSize;j++)
-            ((GByte*)pImage)[j] = (GByte) poGDS->dfDstNoDataValue;
+            ((GByte*)pImage)[j] = (GByte) dfDstNoDataValue;
     }
     else
     {
         for(j=0;j<nBlockXSize;j++)
-            ((float*)pImage)[j] = (float) poGDS->dfDstNoDataValue;
+            ((float*)pImage)[j] = (float) dfDstNoDataValue;
+    }
+}
+
+void GDALGeneric3x3RasterBand::CopyOutputLine(const float* pafLine,
+                                              void* pImage, int nCount)
+{
+    int j;
+    if (eDataType == GDT_Byte)
+    {
+        for(j=0;j<nCount;j++)
+            ((GByte*)pImage)[j] = (GByte) (pafLine[j] + 0.5);
+    }
+    else if( pafLine != pImage )
+    {
+        memcpy(pImage, pafLine, nCount * sizeof(float));
     }
 }
 
@@ -2091,332 +2745,410 @@ CPLErr GDALGeneric3x3RasterBand::IReadBlock( CPL_UNUSED int nBlockXOff,
                                              int nBlockYOff,
                                              void *pImage )
 {
-    int i, j;
-    float fVal;
+    int i;
     GDALGeneric3x3Dataset * poGDS = (GDALGeneric3x3Dataset *) poDS;
 
-    if (poGDS->bComputeAtEdges && nRasterXSize >= 2 && nRasterYSize >= 2)
+    if ( (nBlockYOff == 0 || nBlockYOff == nRasterYSize - 1) &&
+         !(poGDS->sCtxt.bComputeAtEdges && nRasterXSize >= 2 && nRasterYSize >= 2) )
+    {
+        InitWidthNoData(pImage);
+        return CE_None;
+    }
+
+    if ( poGDS->nCurLine != nBlockYOff )
     {
-        if (nBlockYOff == 0)
+        if (poGDS->nCurLine >= 0 && poGDS->nCurLine + 1 == nBlockYOff)
         {
-            for(i=0;i<2;i++)
+            float* pafTmp =  poGDS->apafSourceBuf[0];
+            poGDS->apafSourceBuf[0] = poGDS->apafSourceBuf[1];
+            poGDS->apafSourceBuf[1] = poGDS->apafSourceBuf[2];
+            poGDS->apafSourceBuf[2] = pafTmp;
+
+            if( nBlockYOff + 1 < nRasterYSize )
             {
                 CPLErr eErr = GDALRasterIO( poGDS->hSrcBand,
-                                    GF_Read,
-                                    0, i, nBlockXSize, 1,
-                                    poGDS->apafSourceBuf[i+1],
-                                    nBlockXSize, 1,
-                                    GDT_Float32,
-                                    0, 0);
+                                        GF_Read,
+                                        0, nBlockYOff + 1, nBlockXSize, 1,
+                                        poGDS->apafSourceBuf[2],
+                                        nBlockXSize, 1,
+                                        GDT_Float32,
+                                        0, 0);
+
                 if (eErr != CE_None)
                 {
+                    poGDS->nCurLine = -1;
                     InitWidthNoData(pImage);
                     return eErr;
                 }
             }
-            poGDS->nCurLine = 0;
-
-            for (j = 0; j < nRasterXSize; j++)
-            {
-                float afWin[9];
-                int jmin = (j == 0) ? j : j - 1;
-                int jmax = (j == nRasterXSize - 1) ? j : j + 1;
-
-                afWin[0] = INTERPOL(poGDS->apafSourceBuf[1][jmin], poGDS->apafSourceBuf[2][jmin]);
-                afWin[1] = INTERPOL(poGDS->apafSourceBuf[1][j],    poGDS->apafSourceBuf[2][j]);
-                afWin[2] = INTERPOL(poGDS->apafSourceBuf[1][jmax], poGDS->apafSourceBuf[2][jmax]);
-                afWin[3] = poGDS->apafSourceBuf[1][jmin];
-                afWin[4] = poGDS->apafSourceBuf[1][j];
-                afWin[5] = poGDS->apafSourceBuf[1][jmax];
-                afWin[6] = poGDS->apafSourceBuf[2][jmin];
-                afWin[7] = poGDS->apafSourceBuf[2][j];
-                afWin[8] = poGDS->apafSourceBuf[2][jmax];
-
-                fVal = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                                  bIsSrcNoDataNan,
-                                    afWin, (float) poGDS->dfDstNoDataValue,
-                                    poGDS->pfnAlg,
-                                    poGDS->pAlgData,
-                                    poGDS->bComputeAtEdges);
-
-                if (eDataType == GDT_Byte)
-                    ((GByte*)pImage)[j] = (GByte) (fVal + 0.5);
-                else
-                    ((float*)pImage)[j] = fVal;
-            }
-
-            return CE_None;
         }
-        else if (nBlockYOff == nRasterYSize - 1)
+        else
         {
-            if (poGDS->nCurLine != nRasterYSize - 2)
+            for(i=0;i<3;i++)
             {
-                for(i=0;i<2;i++)
+                if( nBlockYOff + i - 1 < 0 || nBlockYOff + i - 1 >= nRasterYSize )
+                    continue;
+                CPLErr eErr = GDALRasterIO( poGDS->hSrcBand,
+                                    GF_Read,
+                                    0, nBlockYOff + i - 1, nBlockXSize, 1,
+                                    poGDS->apafSourceBuf[i],
+                                    nBlockXSize, 1,
+                                    GDT_Float32,
+                                    0, 0);
+                if (eErr != CE_None)
                 {
-                    CPLErr eErr = GDALRasterIO( poGDS->hSrcBand,
-                                        GF_Read,
-                                        0, nRasterYSize - 2 + i, nBlockXSize, 1,
-                                        poGDS->apafSourceBuf[i+1],
-                                        nBlockXSize, 1,
-                                        GDT_Float32,
-                                        0, 0);
-                    if (eErr != CE_None)
-                    {
-                        InitWidthNoData(pImage);
-                        return eErr;
-                    }
+                    poGDS->nCurLine = -1;
+                    InitWidthNoData(pImage);
+                    return eErr;
                 }
             }
+        }
 
-            for (j = 0; j < nRasterXSize; j++)
-            {
-                float afWin[9];
-                int jmin = (j == 0) ? j : j - 1;
-                int jmax = (j == nRasterXSize - 1) ? j : j + 1;
-
-                afWin[0] = poGDS->apafSourceBuf[1][jmin];
-                afWin[1] = poGDS->apafSourceBuf[1][j];
-                afWin[2] = poGDS->apafSourceBuf[1][jmax];
-                afWin[3] = poGDS->apafSourceBuf[2][jmin];
-                afWin[4] = poGDS->apafSourceBuf[2][j];
-                afWin[5] = poGDS->apafSourceBuf[2][jmax];
-                afWin[6] = INTERPOL(poGDS->apafSourceBuf[2][jmin], poGDS->apafSourceBuf[1][jmin]);
-                afWin[7] = INTERPOL(poGDS->apafSourceBuf[2][j],    poGDS->apafSourceBuf[1][j]);
-                afWin[8] = INTERPOL(poGDS->apafSourceBuf[2][jmax], poGDS->apafSourceBuf[1][jmax]);
-
-                fVal = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                                  bIsSrcNoDataNan,
-                                    afWin, (float) poGDS->dfDstNoDataValue,
-                                    poGDS->pfnAlg,
-                                    poGDS->pAlgData,
-                                    poGDS->bComputeAtEdges);
-
-                if (eDataType == GDT_Byte)
-                    ((GByte*)pImage)[j] = (GByte) (fVal + 0.5);
-                else
-                    ((float*)pImage)[j] = fVal;
-            }
+        poGDS->nCurLine = nBlockYOff;
+    }
 
-            return CE_None;
-        }
+    /* Only compute the product of this band */
+    GDALGeneric3x3ProcessingContext sBandCtxt = poGDS->sCtxt;
+    sBandCtxt.pasProducts = &(poGDS->asProducts[nBand - 1]);
+    sBandCtxt.nProducts = 1;
+
+    float* pafOutputBuf = (eDataType == GDT_Float32) ? (float*) pImage :
+                                                       poGDS->pafOutputBuf;
+    GDALGeneric3x3ProcessLine( &sBandCtxt,
+                               (nBlockYOff > 0) ? poGDS->apafSourceBuf[0] : NULL,
+                               poGDS->apafSourceBuf[1],
+                               (nBlockYOff < nRasterYSize - 1) ? poGDS->apafSourceBuf[2] : NULL,
+                               0, 0, nBlockXSize,
+                               &pafOutputBuf );
+    CopyOutputLine(pafOutputBuf, pImage, nBlockXSize);
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                             IRasterIO()                              */
+/************************************************************************/
+
+/* Full resolution requests of several lines, such as the ones issued by */
+/* GDALDatasetCopyWholeRaster(), are computed by tiles in parallel, */
+/* without going through the block cache. */
+
+CPLErr GDALGeneric3x3RasterBand::IRasterIO( GDALRWFlag eRWFlag,
+                                            int nXOff, int nYOff,
+                                            int nXSize, int nYSize,
+                                            void * pData,
+                                            int nBufXSize, int nBufYSize,
+                                            GDALDataType eBufType,
+                                            GSpacing nPixelSpace,
+                                            GSpacing nLineSpace,
+                                            GDALRasterIOExtraArg* psExtraArg )
+{
+    GDALGeneric3x3Dataset * poGDS = (GDALGeneric3x3Dataset *) poDS;
+
+    if( eRWFlag != GF_Read || poGDS->poThreadPool == NULL || nYSize == 1 ||
+        nXSize != nBufXSize || nYSize != nBufYSize )
+    {
+        return GDALRasterBand::IRasterIO( eRWFlag, nXOff, nYOff, nXSize, nYSize,
+                                          pData, nBufXSize, nBufYSize,
+                                          eBufType, nPixelSpace, nLineSpace,
+                                          psExtraArg );
+    }
+
+    return poGDS->ComputeWindow( nXOff, nYOff, nXSize, nYSize, pData, eBufType,
+                                 1, &nBand, nPixelSpace, nLineSpace, 0 );
+}
+
+double GDALGeneric3x3RasterBand::GetNoDataValue( int* pbHasNoData )
+{
+    if (pbHasNoData)
+        *pbHasNoData = bDstHasNoData;
+    return dfDstNoDataValue;
+}
+
+/************************************************************************/
+/*                            ArgIsNumeric()                            */
+/************************************************************************/
+
+static int ArgIsNumeric( const char *pszArg )
+
+{
+    return CPLGetValueType(pszArg) != CPL_VALUE_STRING;
+}
+
+/************************************************************************/
+/*                            GetAlgorithm()                            */
+/************************************************************************/
+
+typedef enum
+{
+    INVALID,
+    HILL_SHADE,
+    SLOPE,
+    ASPECT,
+    COLOR_RELIEF,
+    TRI,
+    TPI,
+    ROUGHNESS
+} Algorithm;
+
+static Algorithm GetAlgorithm(const char* pszProcessing)
+{
+    if ( EQUAL(pszProcessing, "shade") || EQUAL(pszProcessing, "hillshade") )
+    {
+        return HILL_SHADE;
     }
-    else if ( nBlockYOff == 0 || nBlockYOff == nRasterYSize - 1)
+    else if ( EQUAL(pszProcessing, "slope") )
     {
-        InitWidthNoData(pImage);
-        return CE_None;
+        return SLOPE;
+    }
+    else if ( EQUAL(pszProcessing, "aspect") )
+    {
+        return ASPECT;
     }
+    else if ( EQUAL(pszProcessing, "color-relief") )
+    {
+        return COLOR_RELIEF;
+    }
+    else if ( EQUAL(pszProcessing, "TRI") )
+    {
+        return TRI;
+    }
+    else if ( EQUAL(pszProcessing, "TPI") )
+    {
+        return TPI;
+    }
+    else if ( EQUAL(pszProcessing, "roughness") )
+    {
+        return ROUGHNESS;
+    }
+    else
+    {
+        return INVALID;
+    }
+}
 
-    if ( poGDS->nCurLine != nBlockYOff )
+/************************************************************************/
+/*                          GetAlgorithmName()                          */
+/************************************************************************/
+
+static const char* GetAlgorithmName(Algorithm eAlg)
+{
+    switch( eAlg )
     {
-        if (poGDS->nCurLine + 1 == nBlockYOff)
+        case HILL_SHADE:   return "hillshade";
+        case SLOPE:        return "slope";
+        case ASPECT:       return "aspect";
+        case COLOR_RELIEF: return "color-relief";
+        case TRI:          return "TRI";
+        case TPI:          return "TPI";
+        case ROUGHNESS:    return "roughness";
+        default:           return "invalid";
+    }
+}
+
+/************************************************************************/
+/*                           GetAlgorithms()                            */
+/************************************************************************/
+
+/* Parse a processing, which may be a comma separated list of algorithms */
+/* computed in a single pass, such as "slope,aspect,hillshade". */
+
+static bool GetAlgorithms(const char* pszProcessing,
+                          std::vector<Algorithm>& aeAlgorithms)
+{
+    aeAlgorithms.clear();
+
+    char** papszTokens = CSLTokenizeString2(pszProcessing, ",",
+                                            CSLT_STRIPLEADSPACES |
+                                            CSLT_STRIPENDSPACES);
+    bool bOK = CSLCount(papszTokens) > 0;
+    for( int i = 0; bOK && papszTokens[i] != NULL; i++ )
+    {
+        Algorithm eAlg = GetAlgorithm(papszTokens[i]);
+        if( eAlg == INVALID )
         {
-            float* pafTmp =  poGDS->apafSourceBuf[0];
-            poGDS->apafSourceBuf[0] = poGDS->apafSourceBuf[1];
-            poGDS->apafSourceBuf[1] = poGDS->apafSourceBuf[2];
-            poGDS->apafSourceBuf[2] = pafTmp;
+            CPLError(CE_Failure, CPLE_IllegalArg,
+                     "Invalid processing '%s'", papszTokens[i]);
+            bOK = false;
+        }
+        else if( std::find(aeAlgorithms.begin(), aeAlgorithms.end(), eAlg) !=
+                                                        aeAlgorithms.end() )
+        {
+            CPLError(CE_Failure, CPLE_IllegalArg,
+                     "Processing '%s' specified several times", papszTokens[i]);
+            bOK = false;
+        }
+        else
+            aeAlgorithms.push_back(eAlg);
+    }
+    CSLDestroy(papszTokens);
 
-            CPLErr eErr = GDALRasterIO( poGDS->hSrcBand,
-                                    GF_Read,
-                                    0, nBlockYOff + 1, nBlockXSize, 1,
-                                    poGDS->apafSourceBuf[2],
-                                    nBlockXSize, 1,
-                                    GDT_Float32,
-                                    0, 0);
+    if( bOK && aeAlgorithms.size() > 1 &&
+        std::find(aeAlgorithms.begin(), aeAlgorithms.end(), COLOR_RELIEF) !=
+                                                        aeAlgorithms.end() )
+    {
+        CPLError(CE_Failure, CPLE_IllegalArg,
+                 "color-relief cannot be combined with other processings");
+        bOK = false;
+    }
 
-            if (eErr != CE_None)
+    if( !bOK )
+        aeAlgorithms.clear();
+    return bOK;
+}
+
+/************************************************************************/
+/*                          InitDEMProduct()                            */
+/************************************************************************/
+
+/* Set up the 3x3 algorithm computing eAlg, and its natural output data */
+/* type and nodata value. Returns the algorithm data, to be freed with */
+/* CPLFree(), or NULL. */
+
+static void* InitDEMProduct(Algorithm eAlg,
+                            const GDALDEMProcessingOptions* psOptions,
+                            double* adfGeoTransform,
+                            GDALGeneric3x3Product* psProduct,
+                            GDALDataType* peDstDataType,
+                            int* pbDstHasNoData,
+                            double* pdfDstNoDataValue)
+{
+    double dfDstNoDataValue = 0;
+    int bDstHasNoData = FALSE;
+    void* pData = NULL;
+    GDALGeneric3x3ProcessingAlg pfnAlg = NULL;
+    GDALGeneric3x3ProcessingAlg_multisample pfnAlgMultisample = NULL;
+
+    if (eAlg == HILL_SHADE)
+    {
+        dfDstNoDataValue = 0;
+        bDstHasNoData = TRUE;
+        pData = GDALCreateHillshadeData   (adfGeoTransform,
+                                           psOptions->z,
+                                           psOptions->scale,
+                                           psOptions->alt,
+                                           psOptions->az,
+                                           psOptions->bZevenbergenThorne);
+        if (psOptions->bZevenbergenThorne)
+        {
+            if(!psOptions->bCombined)
             {
-                InitWidthNoData(pImage);
-                return eErr;
+                pfnAlg = GDALHillshadeZevenbergenThorneAlg;
+#ifdef USE_SSE2
+                pfnAlgMultisample = GDALHillshadeAlg_multisample<GRADIENT_ZEVENBERGEN_THORNE>;
+#endif
             }
+            else
+                pfnAlg = GDALHillshadeZevenbergenThorneCombinedAlg;
         }
         else
         {
-            for(i=0;i<3;i++)
+            if(!psOptions->bCombined)
             {
-                CPLErr eErr = GDALRasterIO( poGDS->hSrcBand,
-                                    GF_Read,
-                                    0, nBlockYOff + i - 1, nBlockXSize, 1,
-                                    poGDS->apafSourceBuf[i],
-                                    nBlockXSize, 1,
-                                    GDT_Float32,
-                                    0, 0);
-                if (eErr != CE_None)
-                {
-                    InitWidthNoData(pImage);
-                    return eErr;
-                }
+                pfnAlg = GDALHillshadeAlg;
+#ifdef USE_SSE2
+                pfnAlgMultisample = GDALHillshadeAlg_multisample<GRADIENT_HORN>;
+#endif
             }
+            else
+                pfnAlg = GDALHillshadeCombinedAlg;
         }
-
-        poGDS->nCurLine = nBlockYOff;
     }
-
-    if (poGDS->bComputeAtEdges && nRasterXSize >= 2)
+    else if (eAlg == SLOPE)
     {
-        float afWin[9];
+        dfDstNoDataValue = -9999;
+        bDstHasNoData = TRUE;
 
-        j = 0;
-        afWin[0] = INTERPOL(poGDS->apafSourceBuf[0][j], poGDS->apafSourceBuf[0][j+1]);
-        afWin[1] = poGDS->apafSourceBuf[0][j];
-        afWin[2] = poGDS->apafSourceBuf[0][j+1];
-        afWin[3] = INTERPOL(poGDS->apafSourceBuf[1][j], poGDS->apafSourceBuf[1][j+1]);
-        afWin[4] = poGDS->apafSourceBuf[1][j];
-        afWin[5] = poGDS->apafSourceBuf[1][j+1];
-        afWin[6] = INTERPOL(poGDS->apafSourceBuf[2][j], poGDS->apafSourceBuf[2][j+1]);
-        afWin[7] = poGDS->apafSourceBuf[2][j];
-        afWin[8] = poGDS->apafSourceBuf[2][j+1];
-
-        fVal = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                          bIsSrcNoDataNan,
-                                    afWin, (float) poGDS->dfDstNoDataValue,
-                                    poGDS->pfnAlg,
-                                    poGDS->pAlgData,
-                                    poGDS->bComputeAtEdges);
-
-        if (eDataType == GDT_Byte)
-            ((GByte*)pImage)[j] = (GByte) (fVal + 0.5);
-        else
-            ((float*)pImage)[j] = fVal;
-
-        j = nRasterXSize - 1;
-
-        afWin[0] = poGDS->apafSourceBuf[0][j-1];
-        afWin[1] = poGDS->apafSourceBuf[0][j];
-        afWin[2] = INTERPOL(poGDS->apafSourceBuf[0][j], poGDS->apafSourceBuf[0][j-1]);
-        afWin[3] = poGDS->apafSourceBuf[1][j-1];
-        afWin[4] = poGDS->apafSourceBuf[1][j];
-        afWin[5] = INTERPOL(poGDS->apafSourceBuf[1][j], poGDS->apafSourceBuf[1][j-1]);
-        afWin[6] = poGDS->apafSourceBuf[2][j-1];
-        afWin[7] = poGDS->apafSourceBuf[2][j];
-        afWin[8] = INTERPOL(poGDS->apafSourceBuf[2][j], poGDS->apafSourceBuf[2][j-1]);
-
-        fVal = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                          bIsSrcNoDataNan,
-                                    afWin, (float) poGDS->dfDstNoDataValue,
-                                    poGDS->pfnAlg,
-                                    poGDS->pAlgData,
-                                    poGDS->bComputeAtEdges);
-
-        if (eDataType == GDT_Byte)
-            ((GByte*)pImage)[j] = (GByte) (fVal + 0.5);
-        else
-            ((float*)pImage)[j] = fVal;
-    }
-    else
-    {
-        if (eDataType == GDT_Byte)
+        pData = GDALCreateSlopeData(adfGeoTransform, psOptions->scale, psOptions->slopeFormat);
+        if (psOptions->bZevenbergenThorne)
         {
-            ((GByte*)pImage)[0] = (GByte) poGDS->dfDstNoDataValue;
-            if (nBlockXSize > 1)
-                ((GByte*)pImage)[nBlockXSize - 1] = (GByte) poGDS->dfDstNoDataValue;
+            pfnAlg = GDALSlopeZevenbergenThorneAlg;
+#ifdef USE_SSE2
+            pfnAlgMultisample = GDALSlopeAlg_multisample<GRADIENT_ZEVENBERGEN_THORNE>;
+#endif
         }
         else
         {
-            ((float*)pImage)[0] = (float) poGDS->dfDstNoDataValue;
-            if (nBlockXSize > 1)
-                ((float*)pImage)[nBlockXSize - 1] = (float) poGDS->dfDstNoDataValue;
+            pfnAlg = GDALSlopeHornAlg;
+#ifdef USE_SSE2
+            pfnAlgMultisample = GDALSlopeAlg_multisample<GRADIENT_HORN>;
+#endif
         }
     }
 
-
-    for(j=1;j<nBlockXSize - 1;j++)
+    else if (eAlg == ASPECT)
     {
-        float afWin[9];
-        afWin[0] = poGDS->apafSourceBuf[0][j-1];
-        afWin[1] = poGDS->apafSourceBuf[0][j];
-        afWin[2] = poGDS->apafSourceBuf[0][j+1];
-        afWin[3] = poGDS->apafSourceBuf[1][j-1];
-        afWin[4] = poGDS->apafSourceBuf[1][j];
-        afWin[5] = poGDS->apafSourceBuf[1][j+1];
-        afWin[6] = poGDS->apafSourceBuf[2][j-1];
-        afWin[7] = poGDS->apafSourceBuf[2][j];
-        afWin[8] = poGDS->apafSourceBuf[2][j+1];
-
-        fVal = ComputeVal(bSrcHasNoData, fSrcNoDataValue,
-                          bIsSrcNoDataNan,
-                                afWin, (float) poGDS->dfDstNoDataValue,
-                                poGDS->pfnAlg,
-                                poGDS->pAlgData,
-                                poGDS->bComputeAtEdges);
-
-        if (eDataType == GDT_Byte)
-            ((GByte*)pImage)[j] = (GByte) (fVal + 0.5);
-        else
-            ((float*)pImage)[j] = fVal;
+        if (!psOptions->bZeroForFlat)
+        {
+            dfDstNoDataValue = -9999;
+            bDstHasNoData = TRUE;
+        }
 
+        pData = GDALCreateAspectData(psOptions->bAngleAsAzimuth);
+        if (psOptions->bZevenbergenThorne)
+            pfnAlg = GDALAspectZevenbergenThorneAlg;
+        else
+            pfnAlg = GDALAspectAlg;
+    }
+    else if (eAlg == TRI)
+    {
+        dfDstNoDataValue = -9999;
+        bDstHasNoData = TRUE;
+        pfnAlg = GDALTRIAlg;
+    }
+    else if (eAlg == TPI)
+    {
+        dfDstNoDataValue = -9999;
+        bDstHasNoData = TRUE;
+        pfnAlg = GDALTPIAlg;
+    }
+    else if (eAlg == ROUGHNESS)
+    {
+        dfDstNoDataValue = -9999;
+        bDstHasNoData = TRUE;
+        pfnAlg = GDALRoughnessAlg;
     }
 
-    return CE_None;
-}
+    psProduct->pfnAlg = pfnAlg;
+    psProduct->pfnAlgMultisample = pfnAlgMultisample;
+    psProduct->pData = pData;
+    psProduct->fDstNoDataValue = (float) dfDstNoDataValue;
+    *peDstDataType = (eAlg == HILL_SHADE ||
+                      eAlg == COLOR_RELIEF) ? GDT_Byte : GDT_Float32;
+    *pbDstHasNoData = bDstHasNoData;
+    *pdfDstNoDataValue = dfDstNoDataValue;
 
-double GDALGeneric3x3RasterBand::GetNoDataValue( int* pbHasNoData )
-{
-    GDALGeneric3x3Dataset * poGDS = (GDALGeneric3x3Dataset *) poDS;
-    if (pbHasNoData)
-        *pbHasNoData = poGDS->bDstHasNoData;
-    return poGDS->dfDstNoDataValue;
+    return pData;
 }
 
 /************************************************************************/
-/*                            ArgIsNumeric()                            */
+/*                          FreeDEMProducts()                           */
 /************************************************************************/
 
-static int ArgIsNumeric( const char *pszArg )
-
+static void FreeDEMProducts(std::vector<GDALGeneric3x3Product>& asProducts)
 {
-    return CPLGetValueType(pszArg) != CPL_VALUE_STRING;
+    for( size_t i = 0; i < asProducts.size(); i++ )
+    {
+        CPLFree(asProducts[i].pData);
+        asProducts[i].pData = NULL;
+    }
 }
 
 /************************************************************************/
-/*                            GetAlgorithm()                            */
+/*                       GetSeparateDstFilename()                       */
 /************************************************************************/
 
-typedef enum
-{
-    INVALID,
-    HILL_SHADE,
-    SLOPE,
-    ASPECT,
-    COLOR_RELIEF,
-    TRI,
-    TPI,
-    ROUGHNESS
-} Algorithm;
+/* Return the name of the dataset receiving eAlg with -separate, i.e. */
+/* <path>/<basename>_<processing>.<extension> for <path>/<basename>.<extension> */
 
-static Algorithm GetAlgorithm(const char* pszProcessing)
+static CPLString GetSeparateDstFilename(const char* pszDest, Algorithm eAlg)
 {
-    if ( EQUAL(pszProcessing, "shade") || EQUAL(pszProcessing, "hillshade") )
-    {
-        return HILL_SHADE;
-    }
-    else if ( EQUAL(pszProcessing, "slope") )
-    {
-        return SLOPE;
-    }
-    else if ( EQUAL(pszProcessing, "aspect") )
-    {
-        return ASPECT;
-    }
-    else if ( EQUAL(pszProcessing, "color-relief") )
-    {
-        return COLOR_RELIEF;
-    }
-    else if ( EQUAL(pszProcessing, "TRI") )
-    {
-        return TRI;
-    }
-    else if ( EQUAL(pszProcessing, "TPI") )
-    {
-        return TPI;
-    }
-    else if ( EQUAL(pszProcessing, "roughness") )
-    {
-        return ROUGHNESS;
-    }
-    else
-    {
-        return INVALID;
-    }
+    const CPLString osPath = CPLGetPath(pszDest);
+    const CPLString osExtension = CPLGetExtension(pszDest);
+    const CPLString osBasename = CPLSPrintf("%s_%s", CPLGetBasename(pszDest),
+                                            GetAlgorithmName(eAlg));
+    return CPLFormFilename(osPath, osBasename,
+                           osExtension.empty() ? NULL : osExtension.c_str());
 }
 
 /************************************************************************/
@@ -2435,7 +3167,14 @@ static Algorithm GetAlgorithm(const char* pszProcessing)
  * @param pszDest the destination dataset path.
  * @param hSrcDataset the source dataset handle.
  * @param pszProcessing the processing to apply (one of "hillshade", "slope",
- * "aspect", "color-relief", "TRI", "TPI", "Roughness")
+ * "aspect", "color-relief", "TRI", "TPI", "Roughness"). Starting with GDAL 2.2,
+ * several of them, except "color-relief", may be given as a comma separated
+ * list (e.g. "slope,aspect,hillshade") to compute them in a single pass over
+ * the source: they are written as Float32 bands of the destination dataset
+ * (with -9999 as nodata value), or with the -separate option in one dataset
+ * per processing, named &lt;basename&gt;_&lt;processing&gt;.&lt;extension&gt;
+ * after pszDest. In that latter case, the returned dataset is the one of the
+ * first processing.
  * @param pszColorFilename color file (mandatory for "color-relief" processing,
  * should be NULL otherwise)
  * @param psOptionsIn the options struct returned by
@@ -2480,14 +3219,15 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
         return NULL;
     }
 
-    Algorithm eUtilityMode = GetAlgorithm(pszProcessing);
-    if( eUtilityMode == INVALID )
+    std::vector<Algorithm> aeAlgorithms;
+    if( !GetAlgorithms(pszProcessing, aeAlgorithms) )
     {
-        CPLError(CE_Failure, CPLE_IllegalArg, "Invalid processing");
         if(pbUsageError)
             *pbUsageError = TRUE;
         return NULL;
     }
+    const Algorithm eUtilityMode = aeAlgorithms[0];
+    const int nProducts = static_cast<int>(aeAlgorithms.size());
 
     if( eUtilityMode == COLOR_RELIEF && pszColorFilename == NULL )
     {
@@ -2517,11 +3257,20 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
         psOptions = psOptionsToFree;
     }
 
+    if( psOptions->bSeparate && eUtilityMode == COLOR_RELIEF )
+    {
+        CPLError( CE_Failure, CPLE_NotSupported,
+                  "-separate cannot be used with color-relief.");
+
+        if(pbUsageError)
+            *pbUsageError = TRUE;
+        GDALDEMProcessingOptionsFree(psOptionsToFree);
+        return NULL;
+    }
+
     double  adfGeoTransform[6];
 
-    GDALDatasetH hDstDataset = NULL;
     GDALRasterBandH hSrcBand = NULL;
-    GDALRasterBandH hDstBand = NULL;
     GDALDriverH hDriver = NULL;
 
     int nXSize = GDALGetRasterXSize(hSrcDataset);
@@ -2567,85 +3316,39 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
         return NULL;
     }
 
-    double dfDstNoDataValue = 0;
-    int bDstHasNoData = FALSE;
-    void* pData = NULL;
-    GDALGeneric3x3ProcessingAlg pfnAlg = NULL;
+/* -------------------------------------------------------------------- */
+/*      Set up the products computed from the 3x3 window.               */
+/* -------------------------------------------------------------------- */
+    std::vector<GDALGeneric3x3Product> asProducts(nProducts);
+    std::vector<GDALDataType> aeDstDataType(nProducts, GDT_Byte);
+    std::vector<int> abDstHasNoData(nProducts, FALSE);
+    std::vector<double> adfDstNoDataValue(nProducts, 0.0);
+    int iProduct;
 
-    if (eUtilityMode == HILL_SHADE)
+    if( eUtilityMode != COLOR_RELIEF )
     {
-        dfDstNoDataValue = 0;
-        bDstHasNoData = TRUE;
-        pData = GDALCreateHillshadeData   (adfGeoTransform,
-                                           psOptions->z,
-                                           psOptions->scale,
-                                           psOptions->alt,
-                                           psOptions->az,
-                                           psOptions->bZevenbergenThorne);
-        if (psOptions->bZevenbergenThorne)
-        {
-            if(!psOptions->bCombined)
-                pfnAlg = GDALHillshadeZevenbergenThorneAlg;
-            else
-                pfnAlg = GDALHillshadeZevenbergenThorneCombinedAlg;
-        }
-        else
+        for( iProduct = 0; iProduct < nProducts; iProduct++ )
         {
-            if(!psOptions->bCombined)
-                pfnAlg = GDALHillshadeAlg;
-            else
-                pfnAlg = GDALHillshadeCombinedAlg;
+            InitDEMProduct(aeAlgorithms[iProduct], psOptions, adfGeoTransform,
+                           &asProducts[iProduct], &aeDstDataType[iProduct],
+                           &abDstHasNoData[iProduct],
+                           &adfDstNoDataValue[iProduct]);
         }
-    }
-    else if (eUtilityMode == SLOPE)
-    {
-        dfDstNoDataValue = -9999;
-        bDstHasNoData = TRUE;
 
-        pData = GDALCreateSlopeData(adfGeoTransform, psOptions->scale, psOptions->slopeFormat);
-        if (psOptions->bZevenbergenThorne)
-            pfnAlg = GDALSlopeZevenbergenThorneAlg;
-        else
-            pfnAlg = GDALSlopeHornAlg;
-    }
-
-    else if (eUtilityMode == ASPECT)
-    {
-        if (!psOptions->bZeroForFlat)
+        /* Several products written in the same dataset are Float32 bands */
+        /* sharing the same nodata value */
+        if( nProducts > 1 && !psOptions->bSeparate )
         {
-            dfDstNoDataValue = -9999;
-            bDstHasNoData = TRUE;
+            for( iProduct = 0; iProduct < nProducts; iProduct++ )
+            {
+                aeDstDataType[iProduct] = GDT_Float32;
+                abDstHasNoData[iProduct] = TRUE;
+                adfDstNoDataValue[iProduct] = -9999;
+                asProducts[iProduct].fDstNoDataValue = -9999.0f;
+            }
         }
-
-        pData = GDALCreateAspectData(psOptions->bAngleAsAzimuth);
-        if (psOptions->bZevenbergenThorne)
-            pfnAlg = GDALAspectZevenbergenThorneAlg;
-        else
-            pfnAlg = GDALAspectAlg;
-    }
-    else if (eUtilityMode == TRI)
-    {
-        dfDstNoDataValue = -9999;
-        bDstHasNoData = TRUE;
-        pfnAlg = GDALTRIAlg;
-    }
-    else if (eUtilityMode == TPI)
-    {
-        dfDstNoDataValue = -9999;
-        bDstHasNoData = TRUE;
-        pfnAlg = GDALTPIAlg;
-    }
-    else if (eUtilityMode == ROUGHNESS)
-    {
-        dfDstNoDataValue = -9999;
-        bDstHasNoData = TRUE;
-        pfnAlg = GDALRoughnessAlg;
     }
 
-    GDALDataType eDstDataType = (eUtilityMode == HILL_SHADE ||
-                                 eUtilityMode == COLOR_RELIEF) ? GDT_Byte :
-                                                               GDT_Float32;
-
     if( EQUAL(psOptions->pszFormat, "VRT") )
     {
         if (eUtilityMode == COLOR_RELIEF)
@@ -2657,8 +3360,6 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
                                        psOptions->eColorSelectionMode,
                                        psOptions->bAddAlpha);
 
-            CPLFree(pData);
-
             GDALDEMProcessingOptionsFree(psOptionsToFree);
             return GDALOpen(pszDest, GA_Update);
         }
@@ -2667,11 +3368,27 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
             CPLError(CE_Failure, CPLE_NotSupported,
                      "VRT driver can only be used with color-relief utility.");
             GDALDEMProcessingOptionsFree(psOptionsToFree);
-            CPLFree(pData);
+            FreeDEMProducts(asProducts);
             return NULL;
         }
     }
 
+/* -------------------------------------------------------------------- */
+/*      With -separate, each product goes to its own dataset, named     */
+/*      after the destination and the product.                          */
+/* -------------------------------------------------------------------- */
+    const int nOutputs = psOptions->bSeparate ? nProducts : 1;
+    const int nProductsPerOutput = psOptions->bSeparate ? 1 : nProducts;
+    std::vector<CPLString> aosDstFilenames;
+    for( int iOutput = 0; iOutput < nOutputs; iOutput++ )
+    {
+        if( psOptions->bSeparate )
+            aosDstFilenames.push_back(GetSeparateDstFilename(
+                                        pszDest, aeAlgorithms[iOutput]));
+        else
+            aosDstFilenames.push_back(pszDest);
+    }
+
     // We might actually want to always go through the intermediate dataset
     bool bForceUseIntermediateDataset = false;
 
@@ -2680,13 +3397,24 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
 
     if( EQUAL(psOptions->pszFormat, "GTiff") )
     {
-        if( !EQUAL(CSLFetchNameValueDef(psOptions->papszCreateOptions, "COMPRESS", "NONE"), "NONE") &&
+        // When writing several outputs, the Create() code path writes
+        // whole lines of blocks, which is fine for compressed tiled files
+        if( !psOptions->bSeparate &&
+            !EQUAL(CSLFetchNameValueDef(psOptions->papszCreateOptions, "COMPRESS", "NONE"), "NONE") &&
             CPLTestBool(CSLFetchNameValueDef(psOptions->papszCreateOptions, "TILED", "NO")) )
         {
             bForceUseIntermediateDataset = true;
         }
         else if( strcmp(pszDest, "/vsistdout/") == 0 )
         {
+            if( psOptions->bSeparate )
+            {
+                CPLError(CE_Failure, CPLE_NotSupported,
+                         "-separate cannot be used with /vsistdout/.");
+                GDALDEMProcessingOptionsFree(psOptionsToFree);
+                FreeDEMProducts(asProducts);
+                return NULL;
+            }
             bForceUseIntermediateDataset = true;
             pfnProgress = GDALDummyProgress;
             pProgressData = NULL;
@@ -2708,53 +3436,86 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
         ((bForceUseIntermediateDataset || GDALGetMetadataItem( hDriver, GDAL_DCAP_CREATE, NULL ) == NULL) &&
          GDALGetMetadataItem( hDriver, GDAL_DCAP_CREATECOPY, NULL ) != NULL) )
     {
-        GDALDatasetH hIntermediateDataset;
+        if( nOutputs > 1 )
+            CPLDebug("GDALDEM", "Driver %s has no Create() capability: "
+                     "the source will be read once per product",
+                     psOptions->pszFormat);
 
-        if (eUtilityMode == COLOR_RELIEF)
+        GDALDatasetH hOutDS = NULL;
+        for( int iOutput = 0; iOutput < nOutputs; iOutput++ )
         {
-            GDALColorReliefDataset* poDS =
-                new GDALColorReliefDataset (hSrcDataset,
-                                            hSrcBand,
-                                            pszColorFilename,
-                                            psOptions->eColorSelectionMode,
-                                            psOptions->bAddAlpha);
-            if( !(poDS->InitOK()) )
+            GDALDatasetH hIntermediateDataset;
+            const int iFirstProduct = iOutput * nProductsPerOutput;
+
+            if (eUtilityMode == COLOR_RELIEF)
             {
-                delete poDS;
-                CPLFree(pData);
-                GDALDEMProcessingOptionsFree(psOptionsToFree);
-                return NULL;
+                GDALColorReliefDataset* poDS =
+                    new GDALColorReliefDataset (hSrcDataset,
+                                                hSrcBand,
+                                                pszColorFilename,
+                                                psOptions->eColorSelectionMode,
+                                                psOptions->bAddAlpha);
+                if( !(poDS->InitOK()) )
+                {
+                    delete poDS;
+                    GDALDEMProcessingOptionsFree(psOptionsToFree);
+                    return NULL;
+                }
+                hIntermediateDataset = (GDALDatasetH)poDS;
             }
-            hIntermediateDataset = (GDALDatasetH)poDS;
-        }
-        else
-        {
-            GDALGeneric3x3Dataset* poDS =
-                new GDALGeneric3x3Dataset(hSrcDataset, hSrcBand,
-                                          eDstDataType,
-                                          bDstHasNoData,
-                                          dfDstNoDataValue,
-                                          pfnAlg,
-                                          pData,
-                                          psOptions->bComputeAtEdges);
-            if( !(poDS->InitOK()) )
+            else
             {
-                delete poDS;
-                CPLFree(pData);
-                GDALDEMProcessingOptionsFree(psOptionsToFree);
-                return NULL;
+                GDALGeneric3x3Dataset* poDS =
+                    new GDALGeneric3x3Dataset(hSrcDataset, hSrcBand,
+                                              nProductsPerOutput,
+                                              &asProducts[iFirstProduct],
+                                              &aeDstDataType[iFirstProduct],
+                                              &abDstHasNoData[iFirstProduct],
+                                              psOptions->bComputeAtEdges);
+                if( !(poDS->InitOK()) )
+                {
+                    delete poDS;
+                    if( hOutDS != NULL )
+                        GDALClose(hOutDS);
+                    FreeDEMProducts(asProducts);
+                    GDALDEMProcessingOptionsFree(psOptionsToFree);
+                    return NULL;
+                }
+                if( nProductsPerOutput > 1 )
+                {
+                    for( int iBand = 0; iBand < nProductsPerOutput; iBand++ )
+                        poDS->GetRasterBand(iBand + 1)->SetDescription(
+                            GetAlgorithmName(aeAlgorithms[iFirstProduct + iBand]));
+                }
+                hIntermediateDataset = (GDALDatasetH)poDS;
             }
-            hIntermediateDataset = (GDALDatasetH)poDS;
-        }
 
-        GDALDatasetH hOutDS = GDALCreateCopy(
-                                 hDriver, pszDest, hIntermediateDataset,
-                                 TRUE, psOptions->papszCreateOptions,
-                                 pfnProgress, pProgressData );
+            void* pScaledProgress = GDALCreateScaledProgress(
+                        1.0 * iOutput / nOutputs, 1.0 * (iOutput + 1) / nOutputs,
+                        pfnProgress, pProgressData );
+            GDALDatasetH hCurOutDS = GDALCreateCopy(
+                                     hDriver, aosDstFilenames[iOutput],
+                                     hIntermediateDataset,
+                                     TRUE, psOptions->papszCreateOptions,
+                                     GDALScaledProgress, pScaledProgress );
+            GDALDestroyScaledProgress( pScaledProgress );
+
+            GDALClose(hIntermediateDataset);
 
-        GDALClose(hIntermediateDataset);
+            if( hCurOutDS == NULL )
+            {
+                if( hOutDS != NULL )
+                    GDALClose(hOutDS);
+                hOutDS = NULL;
+                break;
+            }
+            if( iOutput == 0 )
+                hOutDS = hCurOutDS;
+            else
+                GDALClose(hCurOutDS);
+        }
 
-        CPLFree(pData);
+        FreeDEMProducts(asProducts);
 
         GDALDEMProcessingOptionsFree(psOptionsToFree);
         return hOutDS;
@@ -2764,32 +3525,56 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
     if (eUtilityMode == COLOR_RELIEF)
         nDstBands = (psOptions->bAddAlpha) ? 4 : 3;
     else
-        nDstBands = 1;
+        nDstBands = nProductsPerOutput;
+
+    std::vector<GDALDatasetH> ahDstDataset;
+    std::vector<GDALRasterBandH> ahDstBands;
+    for( int iOutput = 0; iOutput < nOutputs; iOutput++ )
+    {
+        const int iFirstProduct = iOutput * nProductsPerOutput;
+        GDALDatasetH hDstDataset = GDALCreate(   hDriver,
+                                    aosDstFilenames[iOutput],
+                                    nXSize,
+                                    nYSize,
+                                    nDstBands,
+                                    aeDstDataType[iFirstProduct],
+                                    psOptions->papszCreateOptions);
+
+        if( hDstDataset == NULL )
+        {
+            CPLError(CE_Failure, CPLE_AppDefined,
+                     "Unable to create dataset %s",
+                     aosDstFilenames[iOutput].c_str() );
+            for( size_t i = 0; i < ahDstDataset.size(); i++ )
+                GDALClose(ahDstDataset[i]);
+            GDALDEMProcessingOptionsFree(psOptionsToFree);
+            FreeDEMProducts(asProducts);
+            return NULL;
+        }
+        ahDstDataset.push_back(hDstDataset);
 
-    hDstDataset = GDALCreate(   hDriver,
-                                pszDest,
-                                nXSize,
-                                nYSize,
-                                nDstBands,
-                                eDstDataType,
-                                psOptions->papszCreateOptions);
+        GDALSetGeoTransform(hDstDataset, adfGeoTransform);
+        GDALSetProjection(hDstDataset, GDALGetProjectionRef(hSrcDataset));
 
-    if( hDstDataset == NULL )
-    {
-        CPLError(CE_Failure, CPLE_AppDefined,
-                 "Unable to create dataset %s", pszDest );
-        GDALDEMProcessingOptionsFree(psOptionsToFree);
-        CPLFree(pData);
-        return NULL;
+        if (eUtilityMode != COLOR_RELIEF)
+        {
+            for( int iBand = 0; iBand < nDstBands; iBand++ )
+            {
+                GDALRasterBandH hDstBand = GDALGetRasterBand(hDstDataset, iBand + 1);
+                if (abDstHasNoData[iFirstProduct + iBand])
+                    GDALSetRasterNoDataValue(hDstBand,
+                                    adfDstNoDataValue[iFirstProduct + iBand]);
+                if( nProductsPerOutput > 1 )
+                    GDALSetDescription(hDstBand,
+                        GetAlgorithmName(aeAlgorithms[iFirstProduct + iBand]));
+                ahDstBands.push_back(hDstBand);
+            }
+        }
     }
 
-    hDstBand = GDALGetRasterBand( hDstDataset, 1 );
-
-    GDALSetGeoTransform(hDstDataset, adfGeoTransform);
-    GDALSetProjection(hDstDataset, GDALGetProjectionRef(hSrcDataset));
-
     if (eUtilityMode == COLOR_RELIEF)
     {
+        GDALDatasetH hDstDataset = ahDstDataset[0];
         GDALColorRelief (hSrcBand,
                          GDALGetRasterBand(hDstDataset, 1),
                          GDALGetRasterBand(hDstDataset, 2),
@@ -2801,20 +3586,20 @@ GDALDatasetH GDALDEMProcessing(const char *pszDest,
     }
     else
     {
-        if (bDstHasNoData)
-            GDALSetRasterNoDataValue(hDstBand, dfDstNoDataValue);
-
-        GDALGeneric3x3Processing(hSrcBand, hDstBand,
-                                 pfnAlg, pData,
+        GDALGeneric3x3Processing(hSrcBand, nProducts,
+                                 &asProducts[0], &ahDstBands[0],
                                  psOptions->bComputeAtEdges,
                                  pfnProgress, pProgressData);
 
     }
 
-    CPLFree(pData);
+    for( int iOutput = 1; iOutput < nOutputs; iOutput++ )
+        GDALClose(ahDstDataset[iOutput]);
+
+    FreeDEMProducts(asProducts);
 
     GDALDEMProcessingOptionsFree(psOptionsToFree);
-    return hDstDataset;
+    return ahDstDataset[0];
 }
 
 /************************************************************************/
@@ -2840,6 +3625,7 @@ GDALDEMProcessingOptions *GDALDEMProcessingOptionsNew(char** papszArgv,
 {
     GDALDEMProcessingOptions *psOptions = (GDALDEMProcessingOptions *) CPLCalloc( 1, sizeof(GDALDEMProcessingOptions) );
     Algorithm eUtilityMode = INVALID;
+    std::vector<Algorithm> aeAlgorithms;
 
     psOptions->pszFormat = CPLStrdup("GTiff");
     psOptions->pfnProgress = GDALDummyProgress;
@@ -2859,6 +3645,7 @@ GDALDEMProcessingOptions *GDALDEMProcessingOptionsNew(char** papszArgv,
     psOptions->bCombined = FALSE;
     psOptions->nBand = 1;
     psOptions->papszCreateOptions = NULL;
+    psOptions->bSeparate = FALSE;
 
 /* -------------------------------------------------------------------- */
 /*      Handle command line arguments.                                  */
@@ -2868,13 +3655,12 @@ GDALDEMProcessingOptions *GDALDEMProcessingOptionsNew(char** papszArgv,
     {
         if( i == 0 && psOptionsForBinary )
         {
-            eUtilityMode = GetAlgorithm(papszArgv[0]);
-            if(eUtilityMode == INVALID )
+            if( !GetAlgorithms(papszArgv[0], aeAlgorithms) )
             {
-                CPLError(CE_Failure, CPLE_IllegalArg, "Invalid utility mode");
                 GDALDEMProcessingOptionsFree(psOptions);
                 return NULL;
             }
+            eUtilityMode = aeAlgorithms[0];
             psOptionsForBinary->pszProcessing = CPLStrdup(papszArgv[0]);
             continue;
         }
@@ -2971,7 +3757,9 @@ GDALDEMProcessingOptions *GDALDEMProcessingOptionsNew(char** papszArgv,
             }
             psOptions->az = CPLAtof(papszArgv[i]);
         }
-        else if( eUtilityMode == HILL_SHADE &&
+        else if( (psOptionsForBinary == NULL ||
+                  std::find(aeAlgorithms.begin(), aeAlgorithms.end(),
+                            HILL_SHADE) != aeAlgorithms.end()) &&
             (EQUAL(papszArgv[i], "--alt") ||
              EQUAL(papszArgv[i], "-alt") ||
              EQUAL(papszArgv[i], "--alt") ||
@@ -3004,6 +3792,11 @@ GDALDEMProcessingOptions *GDALDEMProcessingOptionsNew(char** papszArgv,
         {
             psOptions->bComputeAtEdges = TRUE;
         }
+        else if(
+                 EQUAL(papszArgv[i], "-separate"))
+        {
+            psOptions->bSeparate = TRUE;
+        }
         else if( i + 1 < argc &&
             (EQUAL(papszArgv[i], "--b") ||
              EQUAL(papszArgv[i], "-b"))
@@ -1277,6 +1277,40 @@ GDALDatasetH GDALWarp( const char *pszDest, GDALDatasetH hDstDS, int nSrcCount,
             }
         }
 
+/* -------------------------------------------------------------------- */
+/*      When we have created a GeoTIFF output, chunks without any       */
+/*      source data do not need to be initialized and written: the      */
+/*      blocks that are never written read back as nodata (or 0), and   */
+/*      are either filled identically at closing time, or left missing  */
+/*      with SPARSE_OK=YES.                                             */
+/* -------------------------------------------------------------------- */
+        if( psOptions->bCreateOutput && !bInitDestSetByUser &&
+            psWO->nDstAlphaBand == 0 &&
+            CSLFetchNameValue( psWO->papszWarpOptions, "SKIP_NOSOURCE" ) == NULL &&
+            !CSLFetchBoolean( psWO->papszWarpOptions, "STREAMABLE_OUTPUT", FALSE ) &&
+            GDALGetDatasetDriver(hDstDS) != NULL &&
+            EQUAL(GDALGetDriverShortName(GDALGetDatasetDriver(hDstDS)), "GTiff") )
+        {
+            bool bSameNoData = true;
+            for( int i = 1; psWO->padfDstNoDataReal != NULL &&
+                            i < psWO->nBandCount; i++ )
+            {
+                if( psWO->padfDstNoDataReal[i] != psWO->padfDstNoDataReal[0] &&
+                    !(CPLIsNan(psWO->padfDstNoDataReal[i]) &&
+                      CPLIsNan(psWO->padfDstNoDataReal[0])) )
+                    bSameNoData = false;
+            }
+            for( int i = 0; psWO->padfDstNoDataImag != NULL &&
+                            i < psWO->nBandCount; i++ )
+            {
+                if( psWO->padfDstNoDataImag[i] != 0.0 )
+                    bSameNoData = false;
+            }
+            if( bSameNoData )
+                psWO->papszWarpOptions = CSLSetNameValue(psWO->papszWarpOptions,
+                                                   "SKIP_NOSOURCE", "YES" );
+        }
+
 /* -------------------------------------------------------------------- */
 /*      If we have a cutline, transform it into the source              */
 /*      pixel/line coordinate system and insert into warp options.      */
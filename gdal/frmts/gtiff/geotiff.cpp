@@ -38,7 +38,11 @@
 
 #include "cpl_port.h"  // Must be first.
 
+#include <algorithm>
+#include <list>
+#include <map>
 #include <set>
+#include <vector>
 
 #include "cpl_csv.h"
 #include "cplkeywordparser.h"
@@ -52,6 +56,7 @@
 #include "gdal_mdreader.h"
 #include "gdal_pam.h"
 #include "geovalues.h"
+#include "gt_cog.h"
 #include "gt_jpeg_copy.h"
 #include "gt_overview.h"
 #include "gt_wkt_srs.h"
@@ -65,6 +70,17 @@
 #include "tifvsi.h"
 #include "xtiffio.h"
 
+#if defined(INTERNAL_LIBTIFF) || TIFFLIB_VERSION >= 20181110
+/* TIFFReadFromUserBuffer() appeared in libtiff 4.0.10 */
+#define HAVE_TIFF_READ_FROM_USER_BUFFER
+#endif
+
+#if defined(INTERNAL_LIBTIFF) || TIFFLIB_VERSION >= 20191103
+/* TIFFGetStrileOffset() and the 'O' (on-demand loading of strip/tile */
+/* offsets and byte counts) opening flag appeared in libtiff 4.1.0 */
+#define HAVE_TIFF_GET_STRILE_OFFSET
+#endif
+
 CPL_CVSID("$Id$");
 
 #if SIZEOF_VOIDP == 4
@@ -118,6 +134,57 @@ static bool IsPowerOfTwo(unsigned int i)
     return nBitSet == 1;
 }
 
+/************************************************************************/
+/*                  GTiffGetStrileOffsetAndByteCount()                  */
+/*                                                                      */
+/*      Fetch the offset and/or byte count of a strip/tile. When the    */
+/*      file has been opened with on-demand loading of those values,   */
+/*      this only reads the part of the arrays around the block.       */
+/************************************************************************/
+
+static bool GTiffGetStrileOffsetAndByteCount( TIFF* hTIFF, int nBlockId,
+                                              vsi_l_offset* pnOffset,
+                                              vsi_l_offset* pnByteCount )
+{
+#ifdef HAVE_TIFF_GET_STRILE_OFFSET
+    int bErr = FALSE;
+    if( pnOffset )
+    {
+        *pnOffset = TIFFGetStrileOffsetWithErr( hTIFF, nBlockId, &bErr );
+        if( bErr )
+            return false;
+    }
+    if( pnByteCount )
+    {
+        *pnByteCount = TIFFGetStrileByteCountWithErr( hTIFF, nBlockId, &bErr );
+        if( bErr )
+            return false;
+    }
+    return true;
+#else
+    toff_t *panOffsets = NULL;
+    toff_t *panByteCounts = NULL;
+    const bool bIsTiled = CPL_TO_BOOL( TIFFIsTiled(hTIFF) );
+    if( pnOffset )
+    {
+        if( !TIFFGetField( hTIFF, bIsTiled ? TIFFTAG_TILEOFFSETS :
+                                             TIFFTAG_STRIPOFFSETS,
+                           &panOffsets ) || panOffsets == NULL )
+            return false;
+        *pnOffset = panOffsets[nBlockId];
+    }
+    if( pnByteCount )
+    {
+        if( !TIFFGetField( hTIFF, bIsTiled ? TIFFTAG_TILEBYTECOUNTS :
+                                             TIFFTAG_STRIPBYTECOUNTS,
+                           &panByteCounts ) || panByteCounts == NULL )
+            return false;
+        *pnByteCount = panByteCounts[nBlockId];
+    }
+    return true;
+#endif
+}
+
 /************************************************************************/
 /*                          GTIFFSetInExternalOvr()                     */
 /************************************************************************/
@@ -192,11 +259,33 @@ typedef struct
     int           nBufferSize;
     int           nStripOrTile;
 
+    /* JPEG encoder settings of hTIFF, and its shared tables */
+    int           nJpegQuality;
+    int           nJpegColorMode;
+    int           nJpegTablesMode;
+    uint16        anYCbCrSubsampling[2];
+    GByte        *pabyJPEGTables;
+    int           nJPEGTablesSize;
+
     GByte        *pabyCompressedBuffer; /* owned by pszTmpFilename */
     int           nCompressedBufferSize;
     int           bReady;
 } GTiffCompressionJob;
 
+typedef struct
+{
+    GTiffDataset *poDS;
+    int           nBlockId;
+    vsi_l_offset  nOffset;
+
+    GByte        *pabyCompressedBuffer;
+    int           nCompressedBufferSize;
+
+    GByte        *pabyBuffer;
+    int           nBufferSize;  /* number of bytes to decode */
+    int           bSuccess;
+} GTiffDecompressionJob;
+
 class GTiffDataset CPL_FINAL : public GDALPamDataset
 {
     friend class GTiffRasterBand;
@@ -324,6 +413,21 @@ class GTiffDataset CPL_FINAL : public GDALPamDataset
     int          bFillEmptyTiles;
     void         FillEmptyTiles(void);
 
+    /* FALSE with SPARSE_OK=YES: new blocks with only nodata are skipped */
+    int          bWriteEmptyTiles;
+    bool         HasOnlyNoData( const void* pBuffer, int nWidth, int nHeight,
+                                int nLineStride, int nComponents );
+    bool         CanSkipBlockWrite( int nBlockId, const GByte* pabyData );
+
+    int          SparseRasterIO( bool bDatasetLevel,
+                                 int nXOff, int nYOff, int nXSize, int nYSize,
+                                 void * pData, int nBufXSize, int nBufYSize,
+                                 GDALDataType eBufType,
+                                 int nBandCount, int *panBandMap,
+                                 GSpacing nPixelSpace, GSpacing nLineSpace,
+                                 GSpacing nBandSpace,
+                                 GDALRasterIOExtraArg* psExtraArg );
+
     void         FlushDirectory();
     CPLErr       CleanOverviews();
 
@@ -351,6 +455,9 @@ class GTiffDataset CPL_FINAL : public GDALPamDataset
 
     int           nZLevel;
     int           nLZMAPreset;
+    int           nZSTDLevel;
+    double        dfMaxZError;
+    uint32        anLercParameters[2];
     int           nJpegQuality;
     int           nJpegTablesMode;
 
@@ -362,6 +469,10 @@ class GTiffDataset CPL_FINAL : public GDALPamDataset
     CPLErr        CreateOverviewsFromSrcOverviews(GDALDataset* poSrcDS);
     CPLErr        CreateInternalMaskOverviews(int nOvrBlockXSize,
                                               int nOvrBlockYSize);
+    bool          CanCopyRawBlocksFrom(GTiffDataset* poSrcDS);
+    CPLErr        CopyRawBlocksFrom(GTiffDataset* poSrcDS,
+                                    GDALProgressFunc pfnProgress,
+                                    void* pProgressData);
 
     int           bIsFinalized;
     int           Finalize();
@@ -398,6 +509,27 @@ class GTiffDataset CPL_FINAL : public GDALPamDataset
     int            SubmitCompressionJob(int nStripOrTile, GByte* pabyData,
                                         int cc, int nHeight);
 
+    /* Multi-threaded decompression of read requests */
+    int            nDecompressThreads;
+    CPLWorkerThreadPool *poDecompressThreadPool;
+    CPLMutex      *hDecompressMutex;
+    std::vector<TIFF*> ahDecompressTIFF; /* idle per-thread TIFF handles */
+    int            nDecompressJpegColorMode; /* JPEGCOLORMODE of hTIFF */
+    std::map<int, GByte*> oMapDecodedBlocks;
+    void           InitDecompressionThreads(char** papszOptions);
+    CPLWorkerThreadPool* GetDecompressThreadPool();
+    TIFF*          AcquireDecompressionTIFF();
+    void           ReleaseDecompressionTIFF(TIFF* hDecompressTIFF);
+    static void    ThreadDecompressionFunc(void* pData);
+    int            GetDecompressionChunkYSize(int nXOff, int nXSize,
+                                              int nBandCount);
+    void           CacheMultiThreadedDecompression(int nXOff, int nYOff,
+                                                   int nXSize, int nYSize,
+                                                   int nBandCount,
+                                                   int *panBandMap);
+    int            GetDecodedBlock(int nBlockId, void* pImage, int nSize);
+    void           ReleaseDecodedBlocks();
+
     int            GuessJPEGQuality(int& bOutHasQuantizationTable,
                                     int& bOutHasHuffmanTable);
 
@@ -706,30 +838,19 @@ CPLErr GTiffJPEGOverviewBand::IReadBlock( int nBlockXOff, int nBlockYOff, void *
     int nScaleFactor = 1 << poGDS->nOverviewLevel;
     if( poGDS->poJPEGDS == NULL || nBlockId != poGDS->nBlockId )
     {
-        toff_t *panByteCounts = NULL;
-        toff_t *panOffsets = NULL;
         vsi_l_offset nOffset = 0;
         vsi_l_offset nByteCount = 0;
 
         /* Find offset and size of the JPEG tile/strip */
         TIFF* hTIFF = poGDS->poParentDS->hTIFF;
-        if( (( TIFFIsTiled( hTIFF )
-            && TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts )
-            && TIFFGetField( hTIFF, TIFFTAG_TILEOFFSETS, &panOffsets ) )
-            || ( !TIFFIsTiled( hTIFF )
-            && TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts )
-            && TIFFGetField( hTIFF, TIFFTAG_STRIPOFFSETS, &panOffsets ) )) &&
-            panByteCounts != NULL && panOffsets != NULL )
-        {
-            if( panByteCounts[nBlockId] < 2 )
-                return CE_Failure;
-            nOffset = panOffsets[nBlockId] + 2; /* skip leading 0xFF 0xF8 */
-            nByteCount = panByteCounts[nBlockId] - 2;
-        }
-        else
+        if( !GTiffGetStrileOffsetAndByteCount( hTIFF, nBlockId,
+                                               &nOffset, &nByteCount ) ||
+            nByteCount < 2 )
         {
             return CE_Failure;
         }
+        nOffset += 2; /* skip leading 0xFF 0xF8 */
+        nByteCount -= 2;
 
         /* Special case for last strip that might be smaller than other strips */
         /* In which case we must invalidate the dataset */
@@ -953,8 +1074,16 @@ protected:
     double             dfNoDataValue;
 
     void NullBlock( void *pData );
+    void NullBuffer( void *pData, int nBufXSize, int nBufYSize,
+                     GDALDataType eBufType,
+                     GSpacing nPixelSpace, GSpacing nLineSpace );
     CPLErr FillCacheForOtherBands( int nBlockXOff, int nBlockYOff );
 
+    virtual int IGetDataCoverageStatus( int nXOff, int nYOff,
+                                        int nXSize, int nYSize,
+                                        int nMaskFlagStop,
+                                        double* pdfDataPct );
+
 public:
                    GTiffRasterBand( GTiffDataset *, int );
                   ~GTiffRasterBand();
@@ -1212,6 +1341,15 @@ public:
                             bool bIsByteSwapped, bool bIsComplex,
                             int nBlockId)
     {
+        /* If the file is memory mapped, return a pointer in the mapping */
+        if( !bIsByteSwapped )
+        {
+            const GByte* pabyMapped = static_cast<const GByte*>(
+                VSIFGetRangePointerL(fp, nOffset,
+                                     static_cast<size_t>(nPixels) * nDTSize));
+            if( pabyMapped != NULL )
+                return pabyMapped;
+        }
         if( !FetchBytes(pTempBuffer, nOffset, nPixels, nDTSize, bIsByteSwapped,
                         bIsComplex, nBlockId) )
         {
@@ -1271,6 +1409,32 @@ public:
     static const EMULATED_BOOL bMinimizeIO = true;
 };
 
+/************************************************************************/
+/*                        GTiffGetRangePointers()                       */
+/************************************************************************/
+
+/* Make ppData[] point directly to the file content when the file handle */
+/* is memory mapped, so that DirectIO() can avoid reading the ranges in */
+/* its temporary buffer. ppData[] is left untouched on failure. */
+
+static bool GTiffGetRangePointers( VSILFILE* fp, int nRanges, void** ppData,
+                                   const vsi_l_offset* panOffsets,
+                                   const size_t* panSizes )
+{
+    std::vector<void*> apMapped(nRanges);
+    for( int i = 0; i < nRanges; i++ )
+    {
+        const void* pMapped =
+            VSIFGetRangePointerL(fp, panOffsets[i], panSizes[i]);
+        if( pMapped == NULL )
+            return false;
+        apMapped[i] = const_cast<void*>(pMapped);
+    }
+    for( int i = 0; i < nRanges; i++ )
+        ppData[i] = apMapped[i];
+    return true;
+}
+
 /************************************************************************/
 /*                           DirectIO()                                 */
 /************************************************************************/
@@ -1414,13 +1578,18 @@ int GTiffRasterBand::DirectIO( GDALRWFlag eRWFlag,
         panSizes[iLine] = nReqXSize * nSrcPixelSize;
     }
 
-    /* Extract data from the file */
+    /* Extract data from the file, or use it directly if it is memory mapped */
+    /* and we would have needed to copy it in our temporary buffer anyway */
     if (eErr == CE_None)
     {
         VSILFILE* fp = VSI_TIFFGetVSILFile(TIFFClientdata( poGDS->hTIFF ));
-        int nRet = VSIFReadMultiRangeL(nReqYSize, ppData, panOffsets, panSizes, fp);
-        if (nRet != 0)
-            eErr = CE_Failure;
+        if( pTmpBuffer == NULL || TIFFIsByteSwapped(poGDS->hTIFF) ||
+            !GTiffGetRangePointers(fp, nReqYSize, ppData, panOffsets, panSizes) )
+        {
+            int nRet = VSIFReadMultiRangeL(nReqYSize, ppData, panOffsets, panSizes, fp);
+            if (nRet != 0)
+                eErr = CE_Failure;
+        }
     }
 
     /* Byte-swap if necessary */
@@ -1848,6 +2017,18 @@ CPLErr GTiffDataset::IRasterIO( GDALRWFlag eRWFlag,
             return eErr;
     }
 
+    /* Do not go through the block cache for missing blocks */
+    if( eRWFlag == GF_Read )
+    {
+        int nErr = SparseRasterIO(
+                true, nXOff, nYOff, nXSize, nYSize,
+                pData, nBufXSize, nBufYSize, eBufType,
+                nBandCount, panBandMap, nPixelSpace, nLineSpace, nBandSpace,
+                psExtraArg);
+        if (nErr >= 0)
+            return (CPLErr)nErr;
+    }
+
     if( eVirtualMemIOUsage != VIRTUAL_MEM_IO_NO )
     {
         int nErr = VirtualMemIO(
@@ -1867,12 +2048,63 @@ CPLErr GTiffDataset::IRasterIO( GDALRWFlag eRWFlag,
             return (CPLErr)nErr;
     }
 
+/* -------------------------------------------------------------------- */
+/*      Decode the blocks of the request with several threads. Large    */
+/*      requests are processed by chunks of block rows.                 */
+/* -------------------------------------------------------------------- */
+    const int nChunkYSize = (eRWFlag == GF_Read) ?
+        GetDecompressionChunkYSize(nXOff, nXSize, nBandCount) : 0;
+    if( nChunkYSize > 0 && nYSize > nChunkYSize &&
+        nBufXSize == nXSize && nBufYSize == nYSize )
+    {
+        GDALRasterIOExtraArg sExtraArg = *psExtraArg;
+        sExtraArg.bFloatingPointWindowValidity = FALSE;
+        eErr = CE_None;
+        for( int nChunkYOff = nYOff; eErr == CE_None &&
+                                     nChunkYOff < nYOff + nYSize; )
+        {
+            const int nChunkYEnd = static_cast<int>(std::min(
+                static_cast<GIntBig>(nYOff) + nYSize,
+                static_cast<GIntBig>(nChunkYOff / nBlockYSize) * nBlockYSize
+                + nChunkYSize));
+            if( psExtraArg->pfnProgress != NULL )
+            {
+                sExtraArg.pfnProgress = GDALScaledProgress;
+                sExtraArg.pProgressData = GDALCreateScaledProgress(
+                    (nChunkYOff - nYOff) / (double)nYSize,
+                    (nChunkYEnd - nYOff) / (double)nYSize,
+                    psExtraArg->pfnProgress, psExtraArg->pProgressData );
+            }
+            eErr = IRasterIO( eRWFlag, nXOff, nChunkYOff,
+                              nXSize, nChunkYEnd - nChunkYOff,
+                              (GByte*)pData + (nChunkYOff - nYOff) * nLineSpace,
+                              nXSize, nChunkYEnd - nChunkYOff, eBufType,
+                              nBandCount, panBandMap,
+                              nPixelSpace, nLineSpace, nBandSpace, &sExtraArg );
+            if( psExtraArg->pfnProgress != NULL )
+                GDALDestroyScaledProgress(sExtraArg.pProgressData);
+            nChunkYOff = nChunkYEnd;
+        }
+        return eErr;
+    }
+    /* Nested requests (e.g. from the band level) reuse the blocks */
+    /* decoded by the outer request */
+    const bool bCacheDecodedBlocks = nChunkYSize > 0 &&
+                                     oMapDecodedBlocks.empty();
+    if( bCacheDecodedBlocks )
+        CacheMultiThreadedDecompression(nXOff, nYOff, nXSize, nYSize,
+                                        nBandCount, panBandMap);
+
     nJPEGOverviewVisibilityFlag ++;
     eErr =  GDALPamDataset::IRasterIO(
                 eRWFlag, nXOff, nYOff, nXSize, nYSize,
                 pData, nBufXSize, nBufYSize, eBufType,
                 nBandCount, panBandMap, nPixelSpace, nLineSpace, nBandSpace, psExtraArg);
     nJPEGOverviewVisibilityFlag --;
+
+    if( bCacheDecodedBlocks )
+        ReleaseDecodedBlocks();
+
     return eErr;
 }
 
@@ -3376,13 +3608,17 @@ int GTiffDataset::DirectIO( GDALRWFlag eRWFlag,
         panSizes[iLine] = nReqXSize * nSrcPixelSize;
     }
 
-    /* Extract data from the file */
+    /* Extract data from the file, or use it directly if it is memory mapped */
     if (eErr == CE_None)
     {
         VSILFILE* fp = VSI_TIFFGetVSILFile(TIFFClientdata( hTIFF ));
-        int nRet = VSIFReadMultiRangeL(nReqYSize, ppData, panOffsets, panSizes, fp);
-        if (nRet != 0)
-            eErr = CE_Failure;
+        if( pTmpBuffer == NULL || TIFFIsByteSwapped(hTIFF) ||
+            !GTiffGetRangePointers(fp, nReqYSize, ppData, panOffsets, panSizes) )
+        {
+            int nRet = VSIFReadMultiRangeL(nReqYSize, ppData, panOffsets, panSizes, fp);
+            if (nRet != 0)
+                eErr = CE_Failure;
+        }
     }
 
     /* Byte-swap if necessary */
@@ -3514,6 +3750,16 @@ CPLErr GTiffRasterBand::IRasterIO( GDALRWFlag eRWFlag,
             return eErr;
     }
 
+    /* Do not go through the block cache for missing blocks */
+    if( eRWFlag == GF_Read )
+    {
+        int nErr = poGDS->SparseRasterIO(
+                false, nXOff, nYOff, nXSize, nYSize,
+                pData, nBufXSize, nBufYSize, eBufType,
+                1, &nBand, nPixelSpace, nLineSpace, 0, psExtraArg);
+        if (nErr >= 0)
+            return (CPLErr)nErr;
+    }
 
     if( poGDS->eVirtualMemIOUsage != VIRTUAL_MEM_IO_NO )
     {
@@ -3559,6 +3805,54 @@ CPLErr GTiffRasterBand::IRasterIO( GDALRWFlag eRWFlag,
         }
     }
 
+/* -------------------------------------------------------------------- */
+/*      Decode the blocks of the request with several threads. Large    */
+/*      requests are processed by chunks of block rows.                 */
+/* -------------------------------------------------------------------- */
+    const int nChunkYSize = (eRWFlag == GF_Read) ?
+        poGDS->GetDecompressionChunkYSize(nXOff, nXSize, 1) : 0;
+    if( nChunkYSize > 0 && nYSize > nChunkYSize &&
+        nBufXSize == nXSize && nBufYSize == nYSize )
+    {
+        poGDS->bLoadingOtherBands = FALSE;
+
+        GDALRasterIOExtraArg sExtraArg = *psExtraArg;
+        sExtraArg.bFloatingPointWindowValidity = FALSE;
+        eErr = CE_None;
+        for( int nChunkYOff = nYOff; eErr == CE_None &&
+                                     nChunkYOff < nYOff + nYSize; )
+        {
+            const int nChunkYEnd = static_cast<int>(std::min(
+                static_cast<GIntBig>(nYOff) + nYSize,
+                static_cast<GIntBig>(nChunkYOff / nBlockYSize) * nBlockYSize
+                + nChunkYSize));
+            if( psExtraArg->pfnProgress != NULL )
+            {
+                sExtraArg.pfnProgress = GDALScaledProgress;
+                sExtraArg.pProgressData = GDALCreateScaledProgress(
+                    (nChunkYOff - nYOff) / (double)nYSize,
+                    (nChunkYEnd - nYOff) / (double)nYSize,
+                    psExtraArg->pfnProgress, psExtraArg->pProgressData );
+            }
+            eErr = IRasterIO( eRWFlag, nXOff, nChunkYOff,
+                              nXSize, nChunkYEnd - nChunkYOff,
+                              (GByte*)pData + (nChunkYOff - nYOff) * nLineSpace,
+                              nXSize, nChunkYEnd - nChunkYOff, eBufType,
+                              nPixelSpace, nLineSpace, &sExtraArg );
+            if( psExtraArg->pfnProgress != NULL )
+                GDALDestroyScaledProgress(sExtraArg.pProgressData);
+            nChunkYOff = nChunkYEnd;
+        }
+        return eErr;
+    }
+    /* Nested requests (e.g. from the dataset level) reuse the blocks */
+    /* decoded by the outer request */
+    const bool bCacheDecodedBlocks = nChunkYSize > 0 &&
+                                     poGDS->oMapDecodedBlocks.empty();
+    if( bCacheDecodedBlocks )
+        poGDS->CacheMultiThreadedDecompression(nXOff, nYOff, nXSize, nYSize,
+                                               1, &nBand);
+
     poGDS->nJPEGOverviewVisibilityFlag ++;
     eErr = GDALPamRasterBand::IRasterIO(eRWFlag, nXOff, nYOff, nXSize, nYSize,
                                         pData, nBufXSize, nBufYSize, eBufType,
@@ -3566,6 +3860,8 @@ CPLErr GTiffRasterBand::IRasterIO( GDALRWFlag eRWFlag,
     poGDS->nJPEGOverviewVisibilityFlag --;
 
     poGDS->bLoadingOtherBands = FALSE;
+    if( bCacheDecodedBlocks )
+        poGDS->ReleaseDecodedBlocks();
 
     return eErr;
 }
@@ -3651,7 +3947,11 @@ CPLErr GTiffRasterBand::IReadBlock( int nBlockXOff, int nBlockYOff,
         if( nBlockReqSize < nBlockBufSize )
             memset( pImage, 0, nBlockBufSize );
 
-        if( TIFFIsTiled( poGDS->hTIFF ) )
+        if( poGDS->GetDecodedBlock( nBlockId, pImage, nBlockReqSize ) )
+        {
+            /* already decoded by CacheMultiThreadedDecompression() */
+        }
+        else if( TIFFIsTiled( poGDS->hTIFF ) )
         {
             if( TIFFReadEncodedTile( poGDS->hTIFF, nBlockId, pImage,
                                      nBlockReqSize ) == -1
@@ -4135,15 +4435,11 @@ const char *GTiffRasterBand::GetMetadataItem( const char * pszName,
                 return NULL;
             }
 
-            toff_t *panOffsets = NULL;
-            TIFF* hTIFF = poGDS->hTIFF;
-            if( (( TIFFIsTiled( hTIFF )
-                && TIFFGetField( hTIFF, TIFFTAG_TILEOFFSETS, &panOffsets ) )
-                || ( !TIFFIsTiled( hTIFF )
-                && TIFFGetField( hTIFF, TIFFTAG_STRIPOFFSETS, &panOffsets ) )) &&
-                panOffsets != NULL )
+            vsi_l_offset nOffset = 0;
+            if( GTiffGetStrileOffsetAndByteCount( poGDS->hTIFF, nBlockId,
+                                                  &nOffset, NULL ) )
             {
-                return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)panOffsets[nBlockId]);
+                return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)nOffset);
             }
             else
             {
@@ -4172,15 +4468,11 @@ const char *GTiffRasterBand::GetMetadataItem( const char * pszName,
                 return NULL;
             }
 
-            toff_t *panByteCounts = NULL;
-            TIFF* hTIFF = poGDS->hTIFF;
-            if( (( TIFFIsTiled( hTIFF )
-                && TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts ) )
-                || ( !TIFFIsTiled( hTIFF )
-                && TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts ) )) &&
-                panByteCounts != NULL )
+            vsi_l_offset nByteCount = 0;
+            if( GTiffGetStrileOffsetAndByteCount( poGDS->hTIFF, nBlockId,
+                                                  NULL, &nByteCount ) )
             {
-                return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)panByteCounts[nBlockId]);
+                return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)nByteCount);
             }
             else
             {
@@ -4695,6 +4987,115 @@ void GTiffRasterBand::NullBlock( void *pData )
     }
 }
 
+/************************************************************************/
+/*                             NullBuffer()                             */
+/*                                                                      */
+/*      Same as NullBlock(), but for a window of a user buffer.        */
+/************************************************************************/
+
+void GTiffRasterBand::NullBuffer( void *pData, int nBufXSize, int nBufYSize,
+                                  GDALDataType eBufType,
+                                  GSpacing nPixelSpace, GSpacing nLineSpace )
+
+{
+    int bNoDataSetIn;
+    double dfNoData = GetNoDataValue( &bNoDataSetIn );
+    if( !bNoDataSetIn )
+    {
+#ifdef ESRI_BUILD
+        dfNoData = ( poGDS->nBitsPerSample >= 2 ) ? 0.0 : 1.0;
+#else
+        dfNoData = 0.0;
+#endif
+    }
+
+    /* Go through the band data type, so that values are clamped as */
+    /* they would be by NullBlock() */
+    GByte abyNoData[16];
+    GDALCopyWords( &dfNoData, GDT_Float64, 0, abyNoData, eDataType, 0, 1 );
+    for( int iY = 0; iY < nBufYSize; iY++ )
+    {
+        GDALCopyWords( abyNoData, eDataType, 0,
+                       static_cast<GByte*>(pData) + iY * nLineSpace,
+                       eBufType, static_cast<int>(nPixelSpace), nBufXSize );
+    }
+}
+
+/************************************************************************/
+/*                       IGetDataCoverageStatus()                       */
+/************************************************************************/
+
+int GTiffRasterBand::IGetDataCoverageStatus( int nXOff, int nYOff,
+                                             int nXSize, int nYSize,
+                                             int nMaskFlagStop,
+                                             double* pdfDataPct )
+{
+    if( poGDS->bStreamingIn || poGDS->bTreatAsSplit ||
+        poGDS->bTreatAsSplitBitmap || nXSize == 0 || nYSize == 0 )
+    {
+        return GDALPamRasterBand::IGetDataCoverageStatus(
+            nXOff, nYOff, nXSize, nYSize, nMaskFlagStop, pdfDataPct );
+    }
+
+    /* Make sure that the blocks written so far are committed to disk */
+    if( eAccess == GA_Update )
+        poGDS->FlushCache();
+    if( !poGDS->SetDirectory() )
+    {
+        return GDALPamRasterBand::IGetDataCoverageStatus(
+            nXOff, nYOff, nXSize, nYSize, nMaskFlagStop, pdfDataPct );
+    }
+
+    int nStatus = 0;
+    GIntBig nPixelsData = 0;
+    const int nBlocksPerRowOfBand = DIV_ROUND_UP(nRasterXSize, nBlockXSize);
+    const int nBlockX1 = nXOff / nBlockXSize;
+    const int nBlockY1 = nYOff / nBlockYSize;
+    const int nBlockX2 = (nXOff + nXSize - 1) / nBlockXSize;
+    const int nBlockY2 = (nYOff + nYSize - 1) / nBlockYSize;
+    for( int iY = nBlockY1; iY <= nBlockY2; iY++ )
+    {
+        for( int iX = nBlockX1; iX <= nBlockX2; iX++ )
+        {
+            int nBlockId = iX + iY * nBlocksPerRowOfBand;
+            if( poGDS->nPlanarConfig == PLANARCONFIG_SEPARATE )
+                nBlockId += (nBand - 1) * poGDS->nBlocksPerBand;
+
+            bool bAvailable = CPL_TO_BOOL(poGDS->IsBlockAvailable(nBlockId));
+            if( !bAvailable && poGDS->poCompressThreadPool != NULL )
+            {
+                poGDS->WaitCompletionForBlock(nBlockId);
+                bAvailable = CPL_TO_BOOL(poGDS->IsBlockAvailable(nBlockId));
+            }
+            if( bAvailable )
+            {
+                nStatus |= GDAL_DATA_COVERAGE_STATUS_DATA;
+                const int nXInter =
+                    std::min(nXOff + nXSize, (iX + 1) * nBlockXSize) -
+                    std::max(nXOff, iX * nBlockXSize);
+                const int nYInter =
+                    std::min(nYOff + nYSize, (iY + 1) * nBlockYSize) -
+                    std::max(nYOff, iY * nBlockYSize);
+                nPixelsData += static_cast<GIntBig>(nXInter) * nYInter;
+            }
+            else
+            {
+                nStatus |= GDAL_DATA_COVERAGE_STATUS_EMPTY;
+            }
+            if( nMaskFlagStop != 0 && (nMaskFlagStop & nStatus) != 0 )
+            {
+                if( pdfDataPct )
+                    *pdfDataPct = -1.0;
+                return nStatus;
+            }
+        }
+    }
+    if( pdfDataPct )
+        *pdfDataPct = 100.0 * nPixelsData /
+                      (static_cast<double>(nXSize) * nYSize);
+    return nStatus;
+}
+
 /************************************************************************/
 /*                          GetOverviewCount()                          */
 /************************************************************************/
@@ -6068,6 +6469,7 @@ GTiffDataset::GTiffDataset() :
     poBaseDS = NULL;
 
     bFillEmptyTiles = FALSE;
+    bWriteEmptyTiles = TRUE;
     bLoadingOtherBands = FALSE;
     nLastLineRead = -1;
     nLastBandRead = -1;
@@ -6079,6 +6481,10 @@ GTiffDataset::GTiffDataset() :
 
     nZLevel = -1;
     nLZMAPreset = -1;
+    nZSTDLevel = -1;
+    dfMaxZError = 0.0;
+    anLercParameters[0] = LERC_VERSION_2;
+    anLercParameters[1] = LERC_ADD_COMPRESSION_NONE;
     nJpegQuality = -1;
     nJpegTablesMode = -1;
 
@@ -6115,6 +6521,10 @@ GTiffDataset::GTiffDataset() :
     papszMetadataFiles = NULL;
     poCompressThreadPool = NULL;
     hCompressThreadPoolMutex = NULL;
+    nDecompressThreads = 0;
+    poDecompressThreadPool = NULL;
+    hDecompressMutex = NULL;
+    nDecompressJpegColorMode = -1;
 
     m_pTempBufferForCommonDirectIO = NULL;
     m_nTempBufferForCommonDirectIOSize = 0;
@@ -6208,6 +6618,7 @@ int GTiffDataset::Finalize()
                 }
             }
             CPLFree(asCompressionJobs[i].pabyBuffer);
+            CPLFree(asCompressionJobs[i].pabyJPEGTables);
             if( asCompressionJobs[i].pszTmpFilename )
             {
                 VSIUnlink(asCompressionJobs[i].pszTmpFilename);
@@ -6217,6 +6628,24 @@ int GTiffDataset::Finalize()
         CPLDestroyMutex(hCompressThreadPoolMutex);
     }
 
+    // Release resources of multi-threaded decompression
+    ReleaseDecodedBlocks();
+    delete poDecompressThreadPool;
+    poDecompressThreadPool = NULL;
+    for( size_t i = 0; i < ahDecompressTIFF.size(); i++ )
+    {
+        VSILFILE* fpDecompress =
+            VSI_TIFFGetVSILFile(TIFFClientdata(ahDecompressTIFF[i]));
+        XTIFFClose(ahDecompressTIFF[i]);
+        CPL_IGNORE_RET_VAL(VSIFCloseL(fpDecompress));
+    }
+    ahDecompressTIFF.clear();
+    if( hDecompressMutex )
+    {
+        CPLDestroyMutex(hDecompressMutex);
+        hDecompressMutex = NULL;
+    }
+
 /* -------------------------------------------------------------------- */
 /*      If there is still changed metadata, then presumably we want     */
 /*      to push it into PAM.                                            */
@@ -6461,14 +6890,33 @@ void GTiffDataset::FillEmptyTiles()
         return;
     }
 
+    /* Fill with the nodata value, so that the blocks read the same as */
+    /* before they were written */
+    const GDALDataType eDT = GetRasterBand(1)->GetRasterDataType();
+    const int nDataTypeSize = GDALGetDataTypeSize(eDT) / 8;
+    int bPreserveDataBuffer = FALSE;
+    if( bNoDataSet && dfNoDataValue != 0.0 &&
+        nBitsPerSample == nDataTypeSize * 8 )
+    {
+        GDALCopyWords( &dfNoDataValue, GDT_Float64, 0,
+                       pabyData, eDT, nDataTypeSize,
+                       nBlockBytes / nDataTypeSize );
+        bPreserveDataBuffer = TRUE;
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Check all blocks, writing out data for uninitialized blocks.    */
 /* -------------------------------------------------------------------- */
     for( int iBlock = 0; iBlock < nBlockCount; iBlock++ )
     {
+        // A block whose compression is still in progress in a worker
+        // thread has not been written yet, but is not empty.
+        if( panByteCounts[iBlock] == 0 )
+            WaitCompletionForBlock(iBlock);
         if( panByteCounts[iBlock] == 0 )
         {
-            if( WriteEncodedTileOrStrip( iBlock, pabyData, FALSE ) != CE_None )
+            if( WriteEncodedTileOrStrip( iBlock, pabyData,
+                                         bPreserveDataBuffer ) != CE_None )
                 break;
         }
     }
@@ -6476,6 +6924,102 @@ void GTiffDataset::FillEmptyTiles()
     CPLFree( pabyData );
 }
 
+/************************************************************************/
+/*                           HasOnlyNoData()                            */
+/************************************************************************/
+
+bool GTiffDataset::HasOnlyNoData( const void* pBuffer, int nWidth, int nHeight,
+                                  int nLineStride, int nComponents )
+{
+    const GDALDataType eDT = GetRasterBand(1)->GetRasterDataType();
+    const int nDataTypeSize = GDALGetDataTypeSize(eDT) / 8;
+    if( nBitsPerSample != nDataTypeSize * 8 )
+        return false;
+
+    const double dfNoData = bNoDataSet ? dfNoDataValue : 0.0;
+    const GByte* pabyBuffer = static_cast<const GByte*>(pBuffer);
+    const size_t nSamplesPerLine =
+        static_cast<size_t>(nWidth) * nComponents;
+
+    if( CPLIsNan(dfNoData) )
+    {
+        if( eDT != GDT_Float32 && eDT != GDT_Float64 )
+            return false;
+        for( int iY = 0; iY < nHeight; iY++ )
+        {
+            const GByte* pabyLine = pabyBuffer +
+                static_cast<size_t>(iY) * nLineStride * nDataTypeSize;
+            for( size_t i = 0; i < nSamplesPerLine; i++ )
+            {
+                double dfVal;
+                if( eDT == GDT_Float32 )
+                {
+                    float fVal;
+                    memcpy(&fVal, pabyLine + i * 4, 4);
+                    dfVal = fVal;
+                }
+                else
+                {
+                    memcpy(&dfVal, pabyLine + i * 8, 8);
+                }
+                if( !CPLIsNan(dfVal) )
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /* Compare against the binary representation of the nodata value */
+    GByte abyNoData[16];
+    GDALCopyWords( &dfNoData, GDT_Float64, 0, abyNoData, eDT, 0, 1 );
+    for( int iY = 0; iY < nHeight; iY++ )
+    {
+        const GByte* pabyLine = pabyBuffer +
+            static_cast<size_t>(iY) * nLineStride * nDataTypeSize;
+        for( size_t i = 0; i < nSamplesPerLine; i++ )
+        {
+            if( memcmp(pabyLine + i * nDataTypeSize, abyNoData,
+                       nDataTypeSize) != 0 )
+                return false;
+        }
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                         CanSkipBlockWrite()                          */
+/*                                                                      */
+/*      In SPARSE_OK mode, a block that only contains nodata and that   */
+/*      has never been written does not need to be written at all.      */
+/************************************************************************/
+
+bool GTiffDataset::CanSkipBlockWrite( int nBlockId, const GByte* pabyData )
+{
+    if( bWriteEmptyTiles || bStreamingOut )
+        return false;
+
+    const int nBlkXSize = static_cast<int>(nBlockXSize);
+    const int nBlkYSize = static_cast<int>(nBlockYSize);
+    const int nBlockInBand = nBlockId % nBlocksPerBand;
+    const int nBlocksPerRow = DIV_ROUND_UP(nRasterXSize, nBlkXSize);
+    const int nBlockXOff = nBlockInBand % nBlocksPerRow;
+    const int nBlockYOff = nBlockInBand / nBlocksPerRow;
+    const int nValidX =
+        std::min(nBlkXSize, nRasterXSize - nBlockXOff * nBlkXSize);
+    const int nValidY =
+        std::min(nBlkYSize, nRasterYSize - nBlockYOff * nBlkYSize);
+    const int nComponents =
+        (nPlanarConfig == PLANARCONFIG_CONTIG) ? nSamplesPerPixel : 1;
+
+    if( !HasOnlyNoData( pabyData, nValidX, nValidY,
+                        nBlkXSize * nComponents, nComponents ) )
+        return false;
+
+    /* An existing block must be overwritten */
+    WaitCompletionForBlock(nBlockId);
+    return !IsBlockAvailable(nBlockId);
+}
+
 /************************************************************************/
 /*                        WriteEncodedTile()                            */
 /************************************************************************/
@@ -6483,6 +7027,9 @@ void GTiffDataset::FillEmptyTiles()
 bool GTiffDataset::WriteEncodedTile(uint32 tile, GByte *pabyData,
                                     int bPreserveDataBuffer)
 {
+    if( CanSkipBlockWrite(tile, pabyData) )
+        return true;
+
     int cc = static_cast<int>(TIFFTileSize( hTIFF ));
     bool bNeedTileFill = false;
     int iRow=0, iColumn=0;
@@ -6624,6 +7171,9 @@ bool GTiffDataset::WriteEncodedTile(uint32 tile, GByte *pabyData,
 bool GTiffDataset::WriteEncodedStrip(uint32 strip, GByte* pabyData,
                                      int bPreserveDataBuffer)
 {
+    if( CanSkipBlockWrite(strip, pabyData) )
+        return true;
+
     int cc = static_cast<int>(TIFFStripSize( hTIFF ));
 
 /* -------------------------------------------------------------------- */
@@ -6719,10 +7269,9 @@ void GTiffDataset::InitCompressionThreads(char** papszOptions)
             nThreads = atoi(pszValue);
         if( nThreads > 1 )
         {
-            if( nCompression == COMPRESSION_NONE ||
-                nCompression == COMPRESSION_JPEG )
+            if( nCompression == COMPRESSION_NONE )
             {
-                CPLDebug("GTiff", "NUM_THREADS ignored with uncompressed or JPEG");
+                CPLDebug("GTiff", "NUM_THREADS ignored with uncompressed");
             }
             else
             {
@@ -6804,59 +7353,113 @@ void GTiffDataset::ThreadCompressionFunc(void* pData)
     GTiffCompressionJob* psJob = (GTiffCompressionJob*)pData;
     GTiffDataset* poDS = psJob->poDS;
 
-    VSILFILE* fpTmp = VSIFOpenL(psJob->pszTmpFilename, "wb+");
-    TIFF* hTIFFTmp = VSI_TIFFOpen(psJob->pszTmpFilename,
-        (psJob->bTIFFIsBigEndian) ? "wb+" : "wl+", fpTmp);
-    CPLAssert( hTIFFTmp != NULL );
     int nBlockXSize, nBlockYSize;
     poDS->GetRasterBand(1)->GetBlockSize(&nBlockXSize, &nBlockYSize);
-    TIFFSetField(hTIFFTmp, TIFFTAG_IMAGEWIDTH, nBlockXSize);
-    TIFFSetField(hTIFFTmp, TIFFTAG_IMAGELENGTH, psJob->nHeight);
-    TIFFSetField(hTIFFTmp, TIFFTAG_BITSPERSAMPLE, poDS->nBitsPerSample);
-    TIFFSetField(hTIFFTmp, TIFFTAG_COMPRESSION, poDS->nCompression);
-    if( psJob->nPredictor != PREDICTOR_NONE )
-        TIFFSetField(hTIFFTmp, TIFFTAG_PREDICTOR, psJob->nPredictor);
-    if( poDS->nZLevel >= 0 )
-        TIFFSetField(hTIFFTmp, TIFFTAG_ZIPQUALITY, poDS->nZLevel);
-    if( poDS->nLZMAPreset > 0 && poDS->nCompression == COMPRESSION_LZMA)
-        TIFFSetField(hTIFFTmp, TIFFTAG_LZMAPRESET, poDS->nLZMAPreset);
-    TIFFSetField(hTIFFTmp, TIFFTAG_PHOTOMETRIC, poDS->nPhotometric);
-    TIFFSetField(hTIFFTmp, TIFFTAG_SAMPLEFORMAT, poDS->nSampleFormat);
-    TIFFSetField(hTIFFTmp, TIFFTAG_SAMPLESPERPIXEL, poDS->nSamplesPerPixel);
-    TIFFSetField(hTIFFTmp, TIFFTAG_ROWSPERSTRIP, poDS->nBlockYSize);
-    TIFFSetField(hTIFFTmp, TIFFTAG_PLANARCONFIG, poDS->nPlanarConfig);
-
-    bool bOK
-        = (TIFFWriteEncodedStrip(hTIFFTmp, 0, psJob->pabyBuffer,
-                                 psJob->nBufferSize) == psJob->nBufferSize);
 
+    bool bOK;
     int nOffset = 0;
-    if( bOK )
-    {
-        toff_t* panOffsets = NULL;
-        toff_t* panByteCounts = NULL;
-        TIFFGetField(hTIFFTmp, TIFFTAG_STRIPOFFSETS, &panOffsets);
-        TIFFGetField(hTIFFTmp, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts);
-
-        nOffset = (int) panOffsets[0];
-        psJob->nCompressedBufferSize = (int) panByteCounts[0];
-    }
-    else
-    {
-        CPLError(CE_Failure, CPLE_AppDefined, "Error when compressing strip/tile %d",
-                 psJob->nStripOrTile);
-    }
-
-    XTIFFClose(hTIFFTmp);
-    if( VSIFCloseL(fpTmp) != 0 )
-    {
+    int nJpegTablesMode = psJob->nJpegTablesMode;
+    bool bRetryWithoutJPEGTables = false;
+    do
+    {
+        VSILFILE* fpTmp = VSIFOpenL(psJob->pszTmpFilename, "wb+");
+        TIFF* hTIFFTmp = VSI_TIFFOpen(psJob->pszTmpFilename,
+            (psJob->bTIFFIsBigEndian) ? "wb+" : "wl+", fpTmp);
+        CPLAssert( hTIFFTmp != NULL );
+        TIFFSetField(hTIFFTmp, TIFFTAG_IMAGEWIDTH, nBlockXSize);
+        TIFFSetField(hTIFFTmp, TIFFTAG_IMAGELENGTH, psJob->nHeight);
+        TIFFSetField(hTIFFTmp, TIFFTAG_BITSPERSAMPLE, poDS->nBitsPerSample);
+        TIFFSetField(hTIFFTmp, TIFFTAG_COMPRESSION, poDS->nCompression);
+        if( psJob->nPredictor != PREDICTOR_NONE )
+            TIFFSetField(hTIFFTmp, TIFFTAG_PREDICTOR, psJob->nPredictor);
+        if( poDS->nZLevel >= 0 )
+            TIFFSetField(hTIFFTmp, TIFFTAG_ZIPQUALITY, poDS->nZLevel);
+        if( poDS->nLZMAPreset > 0 && poDS->nCompression == COMPRESSION_LZMA)
+            TIFFSetField(hTIFFTmp, TIFFTAG_LZMAPRESET, poDS->nLZMAPreset);
+        if( poDS->nZSTDLevel > 0 && (poDS->nCompression == COMPRESSION_ZSTD ||
+                                     poDS->nCompression == COMPRESSION_LERC) )
+            TIFFSetField(hTIFFTmp, TIFFTAG_ZSTD_LEVEL, poDS->nZSTDLevel);
+        if( poDS->nCompression == COMPRESSION_LERC )
+        {
+            TIFFSetField(hTIFFTmp, TIFFTAG_LERC_PARAMETERS, 2,
+                         poDS->anLercParameters);
+            TIFFSetField(hTIFFTmp, TIFFTAG_LERC_MAXZERROR, poDS->dfMaxZError);
+        }
+        TIFFSetField(hTIFFTmp, TIFFTAG_PHOTOMETRIC, poDS->nPhotometric);
+        TIFFSetField(hTIFFTmp, TIFFTAG_SAMPLEFORMAT, poDS->nSampleFormat);
+        TIFFSetField(hTIFFTmp, TIFFTAG_SAMPLESPERPIXEL, poDS->nSamplesPerPixel);
+        TIFFSetField(hTIFFTmp, TIFFTAG_ROWSPERSTRIP, poDS->nBlockYSize);
+        TIFFSetField(hTIFFTmp, TIFFTAG_PLANARCONFIG, poDS->nPlanarConfig);
+        if( poDS->nCompression == COMPRESSION_JPEG )
+        {
+            /* Each job has its own codec state. libtiff derives the */
+            /* tables from the quality and tables mode, so that they */
+            /* are the same as the ones of hTIFF. */
+            TIFFSetField(hTIFFTmp, TIFFTAG_JPEGQUALITY, psJob->nJpegQuality);
+            if( poDS->nPhotometric == PHOTOMETRIC_YCBCR )
+                TIFFSetField(hTIFFTmp, TIFFTAG_YCBCRSUBSAMPLING,
+                             psJob->anYCbCrSubsampling[0],
+                             psJob->anYCbCrSubsampling[1]);
+            TIFFSetField(hTIFFTmp, TIFFTAG_JPEGCOLORMODE,
+                         psJob->nJpegColorMode);
+            TIFFSetField(hTIFFTmp, TIFFTAG_JPEGTABLESMODE, nJpegTablesMode);
+        }
+
+        bOK = (TIFFWriteEncodedStrip(hTIFFTmp, 0, psJob->pabyBuffer,
+                                     psJob->nBufferSize) == psJob->nBufferSize);
+
+        bRetryWithoutJPEGTables = false;
         if( bOK )
         {
-            bOK = false;
-            CPLError(CE_Failure, CPLE_AppDefined, "Error when compressing strip/tile %d",
-                    psJob->nStripOrTile);
+            toff_t* panOffsets = NULL;
+            toff_t* panByteCounts = NULL;
+            TIFFGetField(hTIFFTmp, TIFFTAG_STRIPOFFSETS, &panOffsets);
+            TIFFGetField(hTIFFTmp, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts);
+
+            nOffset = (int) panOffsets[0];
+            psJob->nCompressedBufferSize = (int) panByteCounts[0];
+
+            /* If the tables differ from the ones of hTIFF (e.g. the */
+            /* quality of an updated file could not be guessed), the */
+            /* abbreviated stream would not decode. Fallback to a */
+            /* self-contained stream. */
+            uint32 nJPEGTablesSize = 0;
+            void* pJPEGTables = NULL;
+            if( poDS->nCompression == COMPRESSION_JPEG &&
+                nJpegTablesMode != 0 &&
+                (!TIFFGetField(hTIFFTmp, TIFFTAG_JPEGTABLES,
+                               &nJPEGTablesSize, &pJPEGTables) ||
+                 static_cast<int>(nJPEGTablesSize) != psJob->nJPEGTablesSize ||
+                 memcmp(pJPEGTables, psJob->pabyJPEGTables,
+                        nJPEGTablesSize) != 0) )
+            {
+                CPLDebug("GTiff",
+                         "JPEG tables of strip/tile %d differ from the ones "
+                         "of the file. Writing them in the strip/tile",
+                         psJob->nStripOrTile);
+                nJpegTablesMode = 0;
+                bRetryWithoutJPEGTables = true;
+            }
         }
-    }
+        else
+        {
+            CPLError(CE_Failure, CPLE_AppDefined,
+                     "Error when compressing strip/tile %d",
+                     psJob->nStripOrTile);
+        }
+
+        XTIFFClose(hTIFFTmp);
+        if( VSIFCloseL(fpTmp) != 0 )
+        {
+            if( bOK )
+            {
+                bOK = false;
+                CPLError(CE_Failure, CPLE_AppDefined,
+                         "Error when compressing strip/tile %d",
+                         psJob->nStripOrTile);
+            }
+        }
+    } while( bOK && bRetryWithoutJPEGTables );
 
     if( bOK )
     {
@@ -6957,7 +7560,20 @@ int GTiffDataset::SubmitCompressionJob(int nStripOrTile, GByte* pabyData,
            (nCompression == COMPRESSION_ADOBE_DEFLATE ||
             nCompression == COMPRESSION_LZW ||
             nCompression == COMPRESSION_PACKBITS ||
-            nCompression == COMPRESSION_LZMA) ) )
+            nCompression == COMPRESSION_LZMA ||
+            nCompression == COMPRESSION_ZSTD ||
+            nCompression == COMPRESSION_LERC ||
+            nCompression == COMPRESSION_JPEG) ) )
+        return FALSE;
+
+    /* Blocks are encoded by workers as abbreviated JPEG streams that */
+    /* rely on the JPEGTABLES of hTIFF. If they are not known yet, let */
+    /* libtiff encode this block in the calling thread, which sets them. */
+    uint32 nJPEGTablesSize = 0;
+    void* pJPEGTables = NULL;
+    if( nCompression == COMPRESSION_JPEG &&
+        !TIFFGetField(hTIFF, TIFFTAG_JPEGTABLES, &nJPEGTablesSize,
+                      &pJPEGTables) )
         return FALSE;
 
     int nNextCompressionJobAvail = -1;
@@ -6999,15 +7615,453 @@ int GTiffDataset::SubmitCompressionJob(int nStripOrTile, GByte* pabyData,
     psJob->nStripOrTile = nStripOrTile;
     psJob->nPredictor = PREDICTOR_NONE;
     if ( nCompression == COMPRESSION_LZW ||
-         nCompression == COMPRESSION_ADOBE_DEFLATE )
+         nCompression == COMPRESSION_ADOBE_DEFLATE ||
+         nCompression == COMPRESSION_ZSTD )
     {
         TIFFGetField( hTIFF, TIFFTAG_PREDICTOR, &psJob->nPredictor );
     }
+    if( nCompression == COMPRESSION_JPEG )
+    {
+        TIFFGetField( hTIFF, TIFFTAG_JPEGQUALITY, &psJob->nJpegQuality );
+        TIFFGetField( hTIFF, TIFFTAG_JPEGCOLORMODE, &psJob->nJpegColorMode );
+        TIFFGetField( hTIFF, TIFFTAG_JPEGTABLESMODE, &psJob->nJpegTablesMode );
+        if( nPhotometric == PHOTOMETRIC_YCBCR )
+            TIFFGetFieldDefaulted( hTIFF, TIFFTAG_YCBCRSUBSAMPLING,
+                                   &psJob->anYCbCrSubsampling[0],
+                                   &psJob->anYCbCrSubsampling[1] );
+        psJob->pabyJPEGTables = (GByte*)CPLRealloc(psJob->pabyJPEGTables,
+                                                   nJPEGTablesSize);
+        memcpy(psJob->pabyJPEGTables, pJPEGTables, nJPEGTablesSize);
+        psJob->nJPEGTablesSize = static_cast<int>(nJPEGTablesSize);
+    }
 
     poCompressThreadPool->SubmitJob(ThreadCompressionFunc, psJob);
     return TRUE;
 }
 
+/************************************************************************/
+/*                      InitDecompressionThreads()                      */
+/************************************************************************/
+
+void GTiffDataset::InitDecompressionThreads(char** papszOptions)
+{
+    /* The NUM_THREADS open option takes precedence over GDAL_NUM_THREADS */
+    const char* pszValue = CSLFetchNameValue( papszOptions, "NUM_THREADS" );
+    int nThreads;
+    if( pszValue == NULL )
+        nThreads = CPLGetConfiguredNumThreads("1");
+    else if (EQUAL(pszValue, "ALL_CPUS"))
+        nThreads = CPLGetNumCPUs();
+    else
+        nThreads = atoi(pszValue);
+
+    if( nThreads > 1 )
+    {
+        if( nCompression == COMPRESSION_NONE ||
+            nCompression == COMPRESSION_OJPEG )
+        {
+            CPLDebug("GTiff", "NUM_THREADS ignored with uncompressed or OJPEG");
+        }
+        else
+        {
+            /* The thread pool is only instantiated on the first */
+            /* request that can make use of it */
+            nDecompressThreads = nThreads;
+        }
+    }
+    else if (pszValue != NULL &&
+             (nThreads < 0 || (!EQUAL(pszValue, "0") && !EQUAL(pszValue, "1") &&
+                               !EQUAL(pszValue, "ALL_CPUS"))) )
+    {
+        CPLError(CE_Warning, CPLE_AppDefined,
+                 "Invalid value for NUM_THREADS: %s", pszValue);
+    }
+}
+
+/************************************************************************/
+/*                      GetDecompressThreadPool()                       */
+/*                                                                      */
+/*      Overviews and masks share the pool of the main dataset.         */
+/************************************************************************/
+
+CPLWorkerThreadPool* GTiffDataset::GetDecompressThreadPool()
+{
+    if( poBaseDS != NULL )
+        return poBaseDS->GetDecompressThreadPool();
+
+    if( poDecompressThreadPool == NULL && nDecompressThreads > 1 )
+    {
+        CPLDebug("GTiff", "Using %d threads for decompression",
+                 nDecompressThreads);
+        poDecompressThreadPool = new CPLWorkerThreadPool();
+        if( !poDecompressThreadPool->Setup(nDecompressThreads, NULL, NULL) )
+        {
+            delete poDecompressThreadPool;
+            poDecompressThreadPool = NULL;
+            nDecompressThreads = 0;
+        }
+    }
+    return poDecompressThreadPool;
+}
+
+/************************************************************************/
+/*                      AcquireDecompressionTIFF()                      */
+/*                                                                      */
+/*      Return a TIFF handle, private to the calling worker thread,     */
+/*      opened on the same directory as hTIFF. Handles are recycled     */
+/*      through ReleaseDecompressionTIFF().                             */
+/************************************************************************/
+
+TIFF* GTiffDataset::AcquireDecompressionTIFF()
+{
+    TIFF* hDecompressTIFF = NULL;
+
+    CPLAcquireMutex(hDecompressMutex, 1000.0);
+    if( !ahDecompressTIFF.empty() )
+    {
+        hDecompressTIFF = ahDecompressTIFF.back();
+        ahDecompressTIFF.pop_back();
+    }
+    CPLReleaseMutex(hDecompressMutex);
+
+    if( hDecompressTIFF != NULL )
+        return hDecompressTIFF;
+
+    GTiffDataset* poRootDS = this;
+    while( poRootDS->poBaseDS != NULL )
+        poRootDS = poRootDS->poBaseDS;
+    const char* pszFilename = poRootDS->osFilename.c_str();
+
+    VSILFILE* fpDecompress = VSIFOpenL(pszFilename, "rb");
+    if( fpDecompress == NULL )
+        return NULL;
+    hDecompressTIFF = VSI_TIFFOpen(pszFilename, "rcO", fpDecompress);
+    if( hDecompressTIFF == NULL )
+    {
+        CPL_IGNORE_RET_VAL(VSIFCloseL(fpDecompress));
+        return NULL;
+    }
+    if( !TIFFSetSubDirectory(hDecompressTIFF, nDirOffset) )
+    {
+        XTIFFClose(hDecompressTIFF);
+        CPL_IGNORE_RET_VAL(VSIFCloseL(fpDecompress));
+        return NULL;
+    }
+    /* JPEGTABLES are read from the directory, but the codec state */
+    /* (including the color conversion) is private to the handle */
+    if( nDecompressJpegColorMode >= 0 )
+        TIFFSetField(hDecompressTIFF, TIFFTAG_JPEGCOLORMODE,
+                     nDecompressJpegColorMode);
+    return hDecompressTIFF;
+}
+
+/************************************************************************/
+/*                      ReleaseDecompressionTIFF()                      */
+/************************************************************************/
+
+void GTiffDataset::ReleaseDecompressionTIFF(TIFF* hDecompressTIFF)
+{
+    CPLAcquireMutex(hDecompressMutex, 1000.0);
+    ahDecompressTIFF.push_back(hDecompressTIFF);
+    CPLReleaseMutex(hDecompressMutex);
+}
+
+/************************************************************************/
+/*                     ThreadDecompressionFunc()                        */
+/************************************************************************/
+
+void GTiffDataset::ThreadDecompressionFunc(void* pData)
+{
+    GTiffDecompressionJob* psJob = (GTiffDecompressionJob*)pData;
+    GTiffDataset* poDS = psJob->poDS;
+
+    TIFF* hDecompressTIFF = poDS->AcquireDecompressionTIFF();
+    if( hDecompressTIFF == NULL )
+    {
+        psJob->bSuccess = FALSE;
+        return;
+    }
+
+    /* Errors are not reported from here: a failed job is just dropped */
+    /* and the block goes through the regular single-threaded path, */
+    /* which emits the error in the calling thread. */
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+#ifdef HAVE_TIFF_READ_FROM_USER_BUFFER
+    psJob->bSuccess = TIFFReadFromUserBuffer(hDecompressTIFF, psJob->nBlockId,
+                                             psJob->pabyCompressedBuffer,
+                                             psJob->nCompressedBufferSize,
+                                             psJob->pabyBuffer,
+                                             psJob->nBufferSize);
+#else
+    if( TIFFIsTiled(hDecompressTIFF) )
+        psJob->bSuccess = TIFFReadEncodedTile(hDecompressTIFF, psJob->nBlockId,
+                                              psJob->pabyBuffer,
+                                              psJob->nBufferSize) != -1;
+    else
+        psJob->bSuccess = TIFFReadEncodedStrip(hDecompressTIFF, psJob->nBlockId,
+                                               psJob->pabyBuffer,
+                                               psJob->nBufferSize) != -1;
+#endif
+    CPLPopErrorHandler();
+
+    poDS->ReleaseDecompressionTIFF(hDecompressTIFF);
+}
+
+/************************************************************************/
+/*                     GetDecompressionChunkYSize()                     */
+/*                                                                      */
+/*      Return 0 if multi-threaded decompression cannot be used for     */
+/*      a read request, or otherwise the maximum height of the          */
+/*      window whose blocks can be decoded at once.                     */
+/************************************************************************/
+
+int GTiffDataset::GetDecompressionChunkYSize(int nXOff, int nXSize,
+                                             int nBandCount)
+{
+    if( eAccess != GA_ReadOnly || bStreamingIn ||
+        bTreatAsRGBA || bTreatAsSplit || bTreatAsSplitBitmap ||
+        nCompression == COMPRESSION_NONE ||
+        nCompression == COMPRESSION_OJPEG ||
+        GetDecompressThreadPool() == NULL )
+        return 0;
+
+    if( !SetDirectory() )
+        return 0;
+
+    const GIntBig nBlockBufSize = TIFFIsTiled(hTIFF) ?
+        static_cast<GIntBig>(TIFFTileSize(hTIFF)) :
+        static_cast<GIntBig>(TIFFStripSize(hTIFF));
+    if( nBlockBufSize <= 0 || nBlockBufSize > INT_MAX )
+        return 0;
+
+    const int nXBlocks = (nXOff + nXSize - 1) / nBlockXSize
+                         - nXOff / nBlockXSize + 1;
+    const GIntBig nBlockRowSize = nBlockBufSize * nXBlocks *
+        (nPlanarConfig == PLANARCONFIG_SEPARATE ? nBandCount : 1);
+
+    /* Decoded blocks are transiently held in addition to the block cache */
+    GIntBig nBlockRows = (GDALGetCacheMax64() / 4) / nBlockRowSize;
+    if( nBlockRows < 1 )
+        nBlockRows = 1;
+    if( nBlockRows > INT_MAX / static_cast<int>(nBlockYSize) )
+        return INT_MAX;
+    return static_cast<int>(nBlockRows * nBlockYSize);
+}
+
+/************************************************************************/
+/*                   CacheMultiThreadedDecompression()                  */
+/*                                                                      */
+/*      Decode the blocks intersecting a read request with the worker   */
+/*      pool. The compressed bytes are fetched sequentially in file     */
+/*      order in the calling thread, and each block is handed to a      */
+/*      worker as soon as read. Decoded blocks are then picked up by    */
+/*      LoadBlockBuf() and IReadBlock() instead of calling libtiff.     */
+/************************************************************************/
+
+static bool GTiffDecompressionJobOffsetLess(const GTiffDecompressionJob& a,
+                                            const GTiffDecompressionJob& b)
+{
+    return a.nOffset < b.nOffset;
+}
+
+void GTiffDataset::CacheMultiThreadedDecompression(int nXOff, int nYOff,
+                                                   int nXSize, int nYSize,
+                                                   int nBandCount,
+                                                   int *panBandMap)
+{
+    CPLWorkerThreadPool* poPool = GetDecompressThreadPool();
+    if( poPool == NULL || !SetDirectory() )
+        return;
+
+    const int nBlockBufSize = TIFFIsTiled(hTIFF) ?
+        static_cast<int>(TIFFTileSize(hTIFF)) :
+        static_cast<int>(TIFFStripSize(hTIFF));
+    if( nBlockBufSize <= 0 )
+        return;
+
+    /* The per-thread handles must do the same YCbCr to RGB conversion */
+    /* as hTIFF, so that decoded blocks have the expected size. */
+    if( nCompression == COMPRESSION_JPEG )
+        TIFFGetField( hTIFF, TIFFTAG_JPEGCOLORMODE, &nDecompressJpegColorMode );
+
+    const int nBlocksPerRow = DIV_ROUND_UP(nRasterXSize, nBlockXSize);
+    const int nBlockX1 = nXOff / nBlockXSize;
+    const int nBlockY1 = nYOff / nBlockYSize;
+    const int nBlockX2 = (nXOff + nXSize - 1) / nBlockXSize;
+    const int nBlockY2 = (nYOff + nYSize - 1) / nBlockYSize;
+    const bool bSeparate = nPlanarConfig == PLANARCONFIG_SEPARATE;
+    const GIntBig nMaxJobs = std::max(static_cast<GIntBig>(2),
+                            (GDALGetCacheMax64() / 4) / nBlockBufSize);
+
+/* -------------------------------------------------------------------- */
+/*      Collect the blocks that are neither in the block cache nor      */
+/*      already loaded.                                                 */
+/* -------------------------------------------------------------------- */
+    std::vector<GTiffDecompressionJob> asJobs;
+    for( int iBand = 0; iBand < (bSeparate ? nBandCount : 1); iBand++ )
+    {
+        for( int nBlockYOff = nBlockY1; nBlockYOff <= nBlockY2; nBlockYOff++ )
+        {
+            for( int nBlockXOff = nBlockX1; nBlockXOff <= nBlockX2; nBlockXOff++ )
+            {
+                if( static_cast<GIntBig>(asJobs.size()) >= nMaxJobs )
+                    break;
+
+                int nBlockId = nBlockXOff + nBlockYOff * nBlocksPerRow;
+                if( bSeparate )
+                    nBlockId += (panBandMap[iBand] - 1) * nBlocksPerBand;
+                if( nBlockId == nLoadedBlock ||
+                    oMapDecodedBlocks.find(nBlockId) != oMapDecodedBlocks.end() )
+                    continue;
+
+                bool bAllCached = true;
+                for( int i = 0; i < nBandCount && bAllCached; i++ )
+                {
+                    if( bSeparate && i != iBand )
+                        continue;
+                    GDALRasterBlock* poBlock =
+                        ((GTiffRasterBand *)GetRasterBand(panBandMap[i]))
+                            ->TryGetLockedBlockRef(nBlockXOff, nBlockYOff);
+                    if( poBlock == NULL )
+                        bAllCached = false;
+                    else
+                        poBlock->DropLock();
+                }
+                if( bAllCached || !IsBlockAvailable(nBlockId) )
+                    continue;
+
+                GTiffDecompressionJob sJob;
+                memset(&sJob, 0, sizeof(sJob));
+                sJob.poDS = this;
+                sJob.nBlockId = nBlockId;
+
+                vsi_l_offset nOffset = 0;
+                vsi_l_offset nByteCount = 0;
+                if( !GTiffGetStrileOffsetAndByteCount( hTIFF, nBlockId,
+                                                       &nOffset, &nByteCount ) )
+                    return;
+                sJob.nOffset = nOffset;
+                if( nByteCount == 0 || nByteCount > INT_MAX )
+                    continue;
+                sJob.nCompressedBufferSize = static_cast<int>(nByteCount);
+
+/* -------------------------------------------------------------------- */
+/*      The bottom most partial tiles and strips are sometimes only     */
+/*      partially encoded (#1179), so only decode the valid part.       */
+/* -------------------------------------------------------------------- */
+                sJob.nBufferSize = nBlockBufSize;
+                if( (nBlockYOff+1) * static_cast<int>(nBlockYSize) > nRasterYSize )
+                {
+                    sJob.nBufferSize = (nBlockBufSize / nBlockYSize)
+                        * (nBlockYSize - (((nBlockYOff+1) * nBlockYSize) % nRasterYSize));
+                }
+                asJobs.push_back(sJob);
+            }
+        }
+    }
+
+    /* Nothing to gain with a single block */
+    if( asJobs.size() < 2 )
+        return;
+
+    std::sort(asJobs.begin(), asJobs.end(), GTiffDecompressionJobOffsetLess);
+
+/* -------------------------------------------------------------------- */
+/*      Read the compressed blocks sequentially and submit them.        */
+/* -------------------------------------------------------------------- */
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    for( size_t i = 0; i < asJobs.size(); i++ )
+    {
+        GTiffDecompressionJob* psJob = &asJobs[i];
+        psJob->pabyBuffer = (GByte*) VSI_MALLOC_VERBOSE(psJob->nBufferSize);
+        if( psJob->pabyBuffer == NULL )
+            continue;
+
+#ifdef HAVE_TIFF_READ_FROM_USER_BUFFER
+        psJob->pabyCompressedBuffer =
+            (GByte*) VSI_MALLOC_VERBOSE(psJob->nCompressedBufferSize);
+        if( psJob->pabyCompressedBuffer == NULL )
+        {
+            VSIFree(psJob->pabyBuffer);
+            psJob->pabyBuffer = NULL;
+            continue;
+        }
+        tmsize_t nRead;
+        if( TIFFIsTiled(hTIFF) )
+            nRead = TIFFReadRawTile(hTIFF, psJob->nBlockId,
+                                    psJob->pabyCompressedBuffer,
+                                    psJob->nCompressedBufferSize);
+        else
+            nRead = TIFFReadRawStrip(hTIFF, psJob->nBlockId,
+                                     psJob->pabyCompressedBuffer,
+                                     psJob->nCompressedBufferSize);
+        if( nRead != psJob->nCompressedBufferSize )
+        {
+            VSIFree(psJob->pabyCompressedBuffer);
+            psJob->pabyCompressedBuffer = NULL;
+            VSIFree(psJob->pabyBuffer);
+            psJob->pabyBuffer = NULL;
+            continue;
+        }
+#endif
+
+        if( hDecompressMutex == NULL )
+        {
+            hDecompressMutex = CPLCreateMutex();
+            CPLReleaseMutex(hDecompressMutex);
+        }
+        poPool->SubmitJob(ThreadDecompressionFunc, psJob);
+    }
+    CPLPopErrorHandler();
+
+    poPool->WaitCompletion();
+
+    for( size_t i = 0; i < asJobs.size(); i++ )
+    {
+        GTiffDecompressionJob* psJob = &asJobs[i];
+        VSIFree(psJob->pabyCompressedBuffer);
+        if( psJob->pabyBuffer == NULL )
+            continue;
+        if( psJob->bSuccess )
+            oMapDecodedBlocks[psJob->nBlockId] = psJob->pabyBuffer;
+        else
+            VSIFree(psJob->pabyBuffer);
+    }
+}
+
+/************************************************************************/
+/*                          GetDecodedBlock()                           */
+/*                                                                      */
+/*      Copy, if available, a block decoded by the worker threads.      */
+/************************************************************************/
+
+int GTiffDataset::GetDecodedBlock(int nBlockId, void* pImage, int nSize)
+{
+    if( oMapDecodedBlocks.empty() )
+        return FALSE;
+
+    std::map<int, GByte*>::iterator oIter = oMapDecodedBlocks.find(nBlockId);
+    if( oIter == oMapDecodedBlocks.end() )
+        return FALSE;
+
+    memcpy(pImage, oIter->second, nSize);
+    VSIFree(oIter->second);
+    oMapDecodedBlocks.erase(oIter);
+    return TRUE;
+}
+
+/************************************************************************/
+/*                        ReleaseDecodedBlocks()                        */
+/************************************************************************/
+
+void GTiffDataset::ReleaseDecodedBlocks()
+{
+    std::map<int, GByte*>::iterator oIter = oMapDecodedBlocks.begin();
+    for( ; oIter != oMapDecodedBlocks.end(); ++oIter )
+        VSIFree(oIter->second);
+    oMapDecodedBlocks.clear();
+}
+
 /************************************************************************/
 /*                          DiscardLsb()                               */
 /************************************************************************/
@@ -7248,7 +8302,11 @@ CPLErr GTiffDataset::LoadBlockBuf( int nBlockId, int bReadFromDisk )
 /* -------------------------------------------------------------------- */
 /*      Load the block, if it isn't our current block.                  */
 /* -------------------------------------------------------------------- */
-    if( TIFFIsTiled( hTIFF ) )
+    if( GetDecodedBlock(nBlockId, pabyBlockBuf, nBlockReqSize) )
+    {
+        /* already decoded by CacheMultiThreadedDecompression() */
+    }
+    else if( TIFFIsTiled( hTIFF ) )
     {
         if( TIFFReadEncodedTile(hTIFF, nBlockId, pabyBlockBuf,
                                 nBlockReqSize) == -1
@@ -7466,6 +8524,11 @@ void GTiffDataset::Crystalize()
             TIFFSetField(hTIFF, TIFFTAG_JPEGQUALITY, jquality);
         if(zquality > 0)
             TIFFSetField(hTIFF, TIFFTAG_ZIPQUALITY, zquality);
+        if(nZSTDLevel > 0 && (nCompression == COMPRESSION_ZSTD ||
+                              nCompression == COMPRESSION_LERC))
+            TIFFSetField(hTIFF, TIFFTAG_ZSTD_LEVEL, nZSTDLevel);
+        if(nCompression == COMPRESSION_LERC)
+            TIFFSetField(hTIFF, TIFFTAG_LERC_MAXZERROR, dfMaxZError);
         if (nColorMode >= 0)
             TIFFSetField(hTIFF, TIFFTAG_JPEGCOLORMODE, nColorMode);
         if (nJpegTablesModeIn >= 0 )
@@ -7475,78 +8538,6 @@ void GTiffDataset::Crystalize()
     }
 }
 
-#ifdef INTERNAL_LIBTIFF
-
-#define IO_CACHE_PAGE_SIZE      4096
-
-static
-void GTiffCacheOffsetOrCount(VSILFILE* fp,
-                             vsi_l_offset nBaseOffset,
-                             int nBlockId,
-                             uint32 nstrips,
-                             uint64* panVals,
-                             size_t sizeofval)
-{
-    int i, iStartBefore;
-    vsi_l_offset nOffset, nOffsetStartPage, nOffsetEndPage;
-    GByte buffer[2 * IO_CACHE_PAGE_SIZE];
-
-    nOffset = nBaseOffset + sizeofval * nBlockId;
-    nOffsetStartPage = (nOffset / IO_CACHE_PAGE_SIZE) * IO_CACHE_PAGE_SIZE;
-    nOffsetEndPage = nOffsetStartPage + IO_CACHE_PAGE_SIZE;
-
-    if( nOffset + sizeofval > nOffsetEndPage )
-        nOffsetEndPage += IO_CACHE_PAGE_SIZE;
-    vsi_l_offset nLastStripOffset = nBaseOffset + nstrips * sizeofval;
-    if( nLastStripOffset < nOffsetEndPage )
-        nOffsetEndPage  = nLastStripOffset;
-    if( nOffsetStartPage >= nOffsetEndPage )
-    {
-        CPLError(CE_Failure, CPLE_AppDefined,
-                 "Cannot read offset/size for strile %d", nBlockId);
-        panVals[nBlockId] = 0;
-        return;
-    }
-    if( VSIFSeekL(fp, nOffsetStartPage, SEEK_SET) != 0 )
-    {
-        panVals[nBlockId] = 0;
-        return;
-    }
-    size_t nToRead = (size_t)(nOffsetEndPage - nOffsetStartPage);
-    size_t nRead = VSIFReadL(buffer, 1, nToRead, fp);
-    if( nRead < nToRead )
-    {
-        CPLError(CE_Failure, CPLE_AppDefined,
-                 "Cannot read offset/size for strile around ~%d", nBlockId);
-        memset(buffer + nRead, 0, nToRead - nRead);
-    }
-    iStartBefore = - (int)((nOffset - nOffsetStartPage) / sizeofval);
-    if( nBlockId + iStartBefore < 0 )
-        iStartBefore = -nBlockId;
-    for(i=iStartBefore; (uint32)(nBlockId + i) < nstrips &&
-        (GIntBig)nOffset + (i+1) * (int)sizeofval <= (GIntBig)nOffsetEndPage; i++)
-    {
-        if( sizeofval == 4 )
-        {
-            uint32 val;
-            memcpy(&val,
-                   buffer + (nOffset - nOffsetStartPage) + i * sizeof(val),
-                   sizeof(val));
-            panVals[nBlockId + i] = val;
-        }
-        else
-        {
-            uint64 val;
-            memcpy(&val,
-                   buffer + (nOffset - nOffsetStartPage) + i * sizeof(val),
-                   sizeof(val));
-            panVals[nBlockId + i] = val;
-        }
-    }
-}
-
-#endif /* INTERNAL_LIBTIFF */
-
 /************************************************************************/
 /*                          IsBlockAvailable()                          */
 /*                                                                      */
@@ -7558,127 +8549,171 @@ void GTiffCacheOffsetOrCount(VSILFILE* fp,
 int GTiffDataset::IsBlockAvailable( int nBlockId )
 
 {
-#ifdef INTERNAL_LIBTIFF
-#ifdef DEFER_STRILE_LOAD
-    /* Optimization to avoid fetching the whole Strip/TileCounts and Strip/TileOffsets arrays */
-    if( eAccess == GA_ReadOnly &&
-        !(hTIFF->tif_flags & TIFF_SWAB) &&
-        hTIFF->tif_dir.td_nstrips > 2 &&
-        (hTIFF->tif_dir.td_stripoffset_entry.tdir_type == TIFF_LONG ||
-         hTIFF->tif_dir.td_stripoffset_entry.tdir_type == TIFF_LONG8) &&
-        (hTIFF->tif_dir.td_stripbytecount_entry.tdir_type == TIFF_LONG ||
-         hTIFF->tif_dir.td_stripbytecount_entry.tdir_type == TIFF_LONG8) &&
-        !bStreamingIn )
-    {
-        if( hTIFF->tif_dir.td_stripoffset == NULL )
-        {
-            hTIFF->tif_dir.td_stripoffset =
-                (uint64*) _TIFFmalloc( sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-            hTIFF->tif_dir.td_stripbytecount =
-                (uint64*) _TIFFmalloc( sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-            if( hTIFF->tif_dir.td_stripoffset && hTIFF->tif_dir.td_stripbytecount )
-            {
-                memset(hTIFF->tif_dir.td_stripoffset, 0xFF,
-                       sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-                memset(hTIFF->tif_dir.td_stripbytecount, 0xFF,
-                       sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-            }
-            else
+    vsi_l_offset nByteCount = 0;
+
+    if( !GTiffGetStrileOffsetAndByteCount( hTIFF, nBlockId,
+                                           NULL, &nByteCount ) )
+        return FALSE;
+    return nByteCount != 0;
+}
+
+/************************************************************************/
+/*                          SparseRasterIO()                            */
+/*                                                                      */
+/*      Serve the parts of a read request that fall in missing blocks   */
+/*      by filling the user buffer with the nodata value (or 0),        */
+/*      without going through the block cache. The other parts go       */
+/*      through the regular IRasterIO() of the dataset or band.         */
+/*      Return -1 if the request has no missing block.                  */
+/************************************************************************/
+
+int GTiffDataset::SparseRasterIO( bool bDatasetLevel,
+                                  int nXOff, int nYOff, int nXSize, int nYSize,
+                                  void * pData, int nBufXSize, int nBufYSize,
+                                  GDALDataType eBufType,
+                                  int nBandCount, int *panBandMap,
+                                  GSpacing nPixelSpace, GSpacing nLineSpace,
+                                  GSpacing nBandSpace,
+                                  GDALRasterIOExtraArg* psExtraArg )
+{
+    /* In update mode, the block cache may hold blocks that are not */
+    /* written yet */
+    if( eAccess != GA_ReadOnly || bStreamingIn || bTreatAsRGBA ||
+        bTreatAsSplit || bTreatAsSplitBitmap || !SetDirectory() )
+        return -1;
+
+    const int nBlkXSize = static_cast<int>(nBlockXSize);
+    const int nBlkYSize = static_cast<int>(nBlockYSize);
+    const int nBlocksPerRow = DIV_ROUND_UP(nRasterXSize, nBlkXSize);
+    const int nBlockX1 = nXOff / nBlkXSize;
+    const int nBlockY1 = nYOff / nBlkYSize;
+    const int nBlockX2 = (nXOff + nXSize - 1) / nBlkXSize;
+    const int nBlockY2 = (nYOff + nYSize - 1) / nBlkYSize;
+    const int nXBlocks = nBlockX2 - nBlockX1 + 1;
+    const int nYBlocks = nBlockY2 - nBlockY1 + 1;
+
+/* -------------------------------------------------------------------- */
+/*      A block is considered as missing if it is missing for all the   */
+/*      requested bands.                                                */
+/* -------------------------------------------------------------------- */
+    std::vector<bool> abMissing( static_cast<size_t>(nXBlocks) * nYBlocks );
+    size_t nMissing = 0;
+    for( int iY = nBlockY1; iY <= nBlockY2; iY++ )
+    {
+        for( int iX = nBlockX1; iX <= nBlockX2; iX++ )
+        {
+            bool bMissing = true;
+            for( int i = 0; bMissing && i < nBandCount; i++ )
             {
-                _TIFFfree(hTIFF->tif_dir.td_stripoffset);
-                hTIFF->tif_dir.td_stripoffset = NULL;
-                _TIFFfree(hTIFF->tif_dir.td_stripbytecount);
-                hTIFF->tif_dir.td_stripbytecount = NULL;
+                int nBlockId = iX + iY * nBlocksPerRow;
+                if( nPlanarConfig == PLANARCONFIG_SEPARATE )
+                    nBlockId += (panBandMap[i] - 1) * nBlocksPerBand;
+                bMissing = !IsBlockAvailable(nBlockId);
             }
+            abMissing[(iY - nBlockY1) * nXBlocks + iX - nBlockX1] = bMissing;
+            if( bMissing )
+                nMissing ++;
         }
-        if( hTIFF->tif_dir.td_stripbytecount == NULL )
-            return FALSE;
-        if( ~(hTIFF->tif_dir.td_stripoffset[nBlockId]) == 0 ||
-            ~(hTIFF->tif_dir.td_stripbytecount[nBlockId]) == 0 )
+    }
+    if( nMissing == 0 )
+        return -1;
+
+    if( nMissing == abMissing.size() )
+    {
+        for( int i = 0; i < nBandCount; i++ )
         {
-            VSILFILE* fp = VSI_TIFFGetVSILFile(TIFFClientdata( hTIFF ));
-            vsi_l_offset nCurOffset = VSIFTellL(fp);
-            if( ~(hTIFF->tif_dir.td_stripoffset[nBlockId]) == 0 )
-            {
-                vsi_l_offset l_nDirOffset;
-                if( hTIFF->tif_flags&TIFF_BIGTIFF )
-                    l_nDirOffset = hTIFF->tif_dir.td_stripoffset_entry.tdir_offset.toff_long8;
-                else
-                    l_nDirOffset = hTIFF->tif_dir.td_stripoffset_entry.tdir_offset.toff_long;
+            GTiffRasterBand* poBand =
+                static_cast<GTiffRasterBand*>(GetRasterBand(panBandMap[i]));
+            poBand->NullBuffer( static_cast<GByte*>(pData) + i * nBandSpace,
+                                nBufXSize, nBufYSize, eBufType,
+                                nPixelSpace, nLineSpace );
+        }
+        return CE_None;
+    }
 
-                if( hTIFF->tif_dir.td_stripoffset_entry.tdir_type == TIFF_LONG )
-                {
-                    GTiffCacheOffsetOrCount(fp,
-                                            l_nDirOffset,
-                                            nBlockId,
-                                            hTIFF->tif_dir.td_nstrips,
-                                            hTIFF->tif_dir.td_stripoffset,
-                                            sizeof(uint32));
-                }
-                else
+    if( nBufXSize != nXSize || nBufYSize != nYSize )
+        return -1;
+
+/* -------------------------------------------------------------------- */
+/*      Process each block row by runs of missing or available blocks. */
+/* -------------------------------------------------------------------- */
+    GDALRasterIOExtraArg sExtraArg;
+    INIT_RASTERIO_EXTRA_ARG(sExtraArg);
+    sExtraArg.eResampleAlg = psExtraArg->eResampleAlg;
+
+    for( int iY = nBlockY1; iY <= nBlockY2; iY++ )
+    {
+        const int nRowYOff = std::max(nYOff, iY * nBlkYSize);
+        const int nRowYEnd = std::min(nYOff + nYSize, (iY + 1) * nBlkYSize);
+        int iX = nBlockX1;
+        while( iX <= nBlockX2 )
+        {
+            const bool bMissing =
+                abMissing[(iY - nBlockY1) * nXBlocks + iX - nBlockX1];
+            int iXEnd = iX;
+            while( iXEnd + 1 <= nBlockX2 &&
+                   abMissing[(iY - nBlockY1) * nXBlocks + iXEnd + 1 -
+                             nBlockX1] == bMissing )
+                iXEnd ++;
+
+            const int nRunXOff = std::max(nXOff, iX * nBlkXSize);
+            const int nRunXEnd = std::min(nXOff + nXSize,
+                                          (iXEnd + 1) * nBlkXSize);
+            GByte* pabyDst = static_cast<GByte*>(pData) +
+                             (nRowYOff - nYOff) * nLineSpace +
+                             (nRunXOff - nXOff) * nPixelSpace;
+            if( bMissing )
+            {
+                for( int i = 0; i < nBandCount; i++ )
                 {
-                    GTiffCacheOffsetOrCount(fp,
-                                            l_nDirOffset,
-                                            nBlockId,
-                                            hTIFF->tif_dir.td_nstrips,
-                                            hTIFF->tif_dir.td_stripoffset,
-                                            sizeof(uint64));
+                    GTiffRasterBand* poBand = static_cast<GTiffRasterBand*>(
+                        GetRasterBand(panBandMap[i]));
+                    poBand->NullBuffer( pabyDst + i * nBandSpace,
+                                        nRunXEnd - nRunXOff,
+                                        nRowYEnd - nRowYOff, eBufType,
+                                        nPixelSpace, nLineSpace );
                 }
             }
-
-            if( ~(hTIFF->tif_dir.td_stripbytecount[nBlockId]) == 0 )
+            else
             {
-                vsi_l_offset l_nDirOffset;
-                if( hTIFF->tif_flags&TIFF_BIGTIFF )
-                    l_nDirOffset = hTIFF->tif_dir.td_stripbytecount_entry.tdir_offset.toff_long8;
-                else
-                    l_nDirOffset = hTIFF->tif_dir.td_stripbytecount_entry.tdir_offset.toff_long;
-
-                if( hTIFF->tif_dir.td_stripbytecount_entry.tdir_type == TIFF_LONG )
+                CPLErr eErr;
+                if( bDatasetLevel )
                 {
-                    GTiffCacheOffsetOrCount(fp,
-                                            l_nDirOffset,
-                                            nBlockId,
-                                            hTIFF->tif_dir.td_nstrips,
-                                            hTIFF->tif_dir.td_stripbytecount,
-                                            sizeof(uint32));
+                    eErr = IRasterIO( GF_Read, nRunXOff, nRowYOff,
+                                      nRunXEnd - nRunXOff, nRowYEnd - nRowYOff,
+                                      pabyDst,
+                                      nRunXEnd - nRunXOff, nRowYEnd - nRowYOff,
+                                      eBufType, nBandCount, panBandMap,
+                                      nPixelSpace, nLineSpace, nBandSpace,
+                                      &sExtraArg );
                 }
                 else
                 {
-                    GTiffCacheOffsetOrCount(fp,
-                                            l_nDirOffset,
-                                            nBlockId,
-                                            hTIFF->tif_dir.td_nstrips,
-                                            hTIFF->tif_dir.td_stripbytecount,
-                                            sizeof(uint64));
+                    GTiffRasterBand* poBand = static_cast<GTiffRasterBand*>(
+                        GetRasterBand(panBandMap[0]));
+                    eErr = poBand->IRasterIO( GF_Read, nRunXOff, nRowYOff,
+                                      nRunXEnd - nRunXOff, nRowYEnd - nRowYOff,
+                                      pabyDst,
+                                      nRunXEnd - nRunXOff, nRowYEnd - nRowYOff,
+                                      eBufType, nPixelSpace, nLineSpace,
+                                      &sExtraArg );
                 }
+                if( eErr != CE_None )
+                    return eErr;
             }
-            if( VSIFSeekL(fp, nCurOffset, SEEK_SET) != 0 )
-            {
-                /* For some reason Coverity tells: */
-                /* Value of non-local "this->hTIFF->tif_dir.td_stripoffset" that was verified to be "NULL" is not restored as it was along other paths. */
-                /* coverity[end_of_path] */
-                return FALSE;
-            }
+            iX = iXEnd + 1;
         }
-        return hTIFF->tif_dir.td_stripbytecount[nBlockId] != 0;
-    }
-#endif /* DEFER_STRILE_LOAD */
-#endif /* INTERNAL_LIBTIFF */
-    toff_t *panByteCounts = NULL;
 
-    if( ( TIFFIsTiled( hTIFF )
-          && TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts ) )
-        || ( !TIFFIsTiled( hTIFF )
-          && TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts ) ) )
-    {
-        if( panByteCounts == NULL )
-            return FALSE;
-        else
-            return panByteCounts[nBlockId] != 0;
+        if( psExtraArg->pfnProgress != NULL &&
+            !psExtraArg->pfnProgress( (iY - nBlockY1 + 1) /
+                                      static_cast<double>(nYBlocks),
+                                      "", psExtraArg->pProgressData ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            return CE_Failure;
+        }
     }
-    else
-        return FALSE;
+    return CE_None;
 }
 
 /************************************************************************/
@@ -7894,6 +8929,10 @@ CPLErr GTiffDataset::RegisterNewOverviewDataset(toff_t nOverviewOffset)
     poODS->nJpegQuality = nJpegQuality;
     poODS->nZLevel = nZLevel;
     poODS->nLZMAPreset = nLZMAPreset;
+    poODS->nZSTDLevel = nZSTDLevel;
+    poODS->dfMaxZError = dfMaxZError;
+    memcpy( poODS->anLercParameters, anLercParameters,
+            sizeof(anLercParameters) );
 
     if( nCompression == COMPRESSION_JPEG )
     {
@@ -8017,7 +9056,8 @@ CPLErr GTiffDataset::CreateOverviewsFromSrcOverviews(GDALDataset* poSrcDS)
 /* -------------------------------------------------------------------- */
     uint16 nPredictor = PREDICTOR_NONE;
     if ( nCompression == COMPRESSION_LZW ||
-         nCompression == COMPRESSION_ADOBE_DEFLATE )
+         nCompression == COMPRESSION_ADOBE_DEFLATE ||
+         nCompression == COMPRESSION_ZSTD )
         TIFFGetField( hTIFF, TIFFTAG_PREDICTOR, &nPredictor );
     int nOvrBlockXSize, nOvrBlockYSize;
     GTIFFGetOverviewBlockSize(&nOvrBlockXSize, &nOvrBlockYSize);
@@ -8041,7 +9081,7 @@ CPLErr GTiffDataset::CreateOverviewsFromSrcOverviews(GDALDataset* poSrcDS)
                                     nPredictor,
                                     panRed, panGreen, panBlue,
                                     nExtraSamples, panExtraSampleValues,
-                                    osMetadata );
+                                    osMetadata, anLercParameters );
 
         if( nOverviewOffset == 0 )
             eErr = CE_Failure;
@@ -8062,6 +9102,180 @@ CPLErr GTiffDataset::CreateOverviewsFromSrcOverviews(GDALDataset* poSrcDS)
 }
 
 
+/************************************************************************/
+/*                        CanCopyRawBlocksFrom()                        */
+/*                                                                      */
+/*      Whether the compressed strips/tiles of a source GeoTIFF can be  */
+/*      copied as they are in this (just created) dataset, that is if   */
+/*      both have the same layout and codec parameters, and all the     */
+/*      blocks of the source are present.                               */
+/************************************************************************/
+
+bool GTiffDataset::CanCopyRawBlocksFrom(GTiffDataset* poSrcDS)
+{
+    if( !CPLTestBool(CPLGetConfigOption("GTIFF_RAW_BLOCK_COPY", "YES")) )
+        return false;
+
+    if( poSrcDS->eAccess == GA_Update ||
+        poSrcDS->nRasterXSize != nRasterXSize ||
+        poSrcDS->nRasterYSize != nRasterYSize ||
+        poSrcDS->nBands != nBands ||
+        poSrcDS->nBlockXSize != nBlockXSize ||
+        poSrcDS->nBlockYSize != nBlockYSize ||
+        poSrcDS->nBitsPerSample != nBitsPerSample ||
+        poSrcDS->nSampleFormat != nSampleFormat ||
+        poSrcDS->nSamplesPerPixel != nSamplesPerPixel ||
+        poSrcDS->nPlanarConfig != nPlanarConfig ||
+        poSrcDS->nPhotometric != nPhotometric ||
+        poSrcDS->nCompression != nCompression ||
+        poSrcDS->bTreatAsSplit || poSrcDS->bTreatAsSplitBitmap ||
+        bTreatAsSplit || bTreatAsSplitBitmap ||
+        bStreamingOut || bHasDiscardedLsb )
+        return false;
+
+    /* Codecs whose strips/tiles do not depend on other tags, such as */
+    /* JPEGTables, or on the way GDAL writes them. */
+    if( nCompression != COMPRESSION_NONE &&
+        nCompression != COMPRESSION_LZW &&
+        nCompression != COMPRESSION_ADOBE_DEFLATE &&
+        nCompression != COMPRESSION_PACKBITS &&
+        nCompression != COMPRESSION_LZMA &&
+        nCompression != COMPRESSION_ZSTD &&
+        nCompression != COMPRESSION_LERC )
+        return false;
+    if( nCompression == COMPRESSION_LERC &&
+        poSrcDS->anLercParameters[1] != anLercParameters[1] )
+        return false;
+
+    if( !poSrcDS->SetDirectory() )
+        return false;
+    /* The predictor tag is only known by the codecs that use it */
+    const bool bHasPredictor = ( nCompression == COMPRESSION_LZW ||
+                                 nCompression == COMPRESSION_ADOBE_DEFLATE ||
+                                 nCompression == COMPRESSION_ZSTD );
+    TIFF* hSrcTIFF = poSrcDS->hTIFF;
+    const bool bSrcIsTiled = CPL_TO_BOOL( TIFFIsTiled(hSrcTIFF) );
+    const bool bSrcIsBigEndian = CPL_TO_BOOL( TIFFIsBigEndian(hSrcTIFF) );
+    uint16 nSrcPredictor = PREDICTOR_NONE;
+    uint16 nSrcFillOrder = FILLORDER_MSB2LSB;
+    if( bHasPredictor )
+        TIFFGetField( hSrcTIFF, TIFFTAG_PREDICTOR, &nSrcPredictor );
+    TIFFGetFieldDefaulted( hSrcTIFF, TIFFTAG_FILLORDER, &nSrcFillOrder );
+
+    if( !SetDirectory() )
+        return false;
+    uint16 nPredictor = PREDICTOR_NONE;
+    uint16 nFillOrder = FILLORDER_MSB2LSB;
+    if( bHasPredictor )
+        TIFFGetField( hTIFF, TIFFTAG_PREDICTOR, &nPredictor );
+    TIFFGetFieldDefaulted( hTIFF, TIFFTAG_FILLORDER, &nFillOrder );
+    if( bSrcIsTiled != CPL_TO_BOOL( TIFFIsTiled(hTIFF) ) ||
+        bSrcIsBigEndian != CPL_TO_BOOL( TIFFIsBigEndian(hTIFF) ) ||
+        nSrcPredictor != nPredictor ||
+        nSrcFillOrder != nFillOrder )
+        return false;
+
+/* -------------------------------------------------------------------- */
+/*      Missing blocks of the source are read as nodata, which the      */
+/*      empty blocks of the target might not be.                        */
+/* -------------------------------------------------------------------- */
+    const int nBlockCount = (nPlanarConfig == PLANARCONFIG_SEPARATE) ?
+                                nBlocksPerBand * nBands : nBlocksPerBand;
+    for( int iBlock = 0; iBlock < nBlockCount; iBlock++ )
+    {
+        vsi_l_offset nByteCount = 0;
+        if( !GTiffGetStrileOffsetAndByteCount( hSrcTIFF, iBlock, NULL,
+                                               &nByteCount ) ||
+            nByteCount == 0 || nByteCount > INT_MAX )
+            return false;
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/*                         CopyRawBlocksFrom()                          */
+/*                                                                      */
+/*      Copy the compressed strips/tiles of a source GeoTIFF without    */
+/*      decompressing and recompressing them. CanCopyRawBlocksFrom()    */
+/*      must have been checked before.                                  */
+/************************************************************************/
+
+CPLErr GTiffDataset::CopyRawBlocksFrom(GTiffDataset* poSrcDS,
+                                       GDALProgressFunc pfnProgress,
+                                       void* pProgressData)
+{
+    CPLDebug("GTiff", "Copying raw strips/tiles of %s",
+             poSrcDS->GetDescription());
+
+    const int nBlockCount = (nPlanarConfig == PLANARCONFIG_SEPARATE) ?
+                                nBlocksPerBand * nBands : nBlocksPerBand;
+    GByte* pabyBuffer = NULL;
+    int nBufferSize = 0;
+    CPLErr eErr = CE_None;
+
+    for( int iBlock = 0; eErr == CE_None && iBlock < nBlockCount; iBlock++ )
+    {
+        vsi_l_offset nByteCount = 0;
+        if( !poSrcDS->SetDirectory() ||
+            !GTiffGetStrileOffsetAndByteCount( poSrcDS->hTIFF, iBlock, NULL,
+                                               &nByteCount ) ||
+            nByteCount == 0 || nByteCount > INT_MAX )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Cannot get the size of block %d", iBlock );
+            eErr = CE_Failure;
+            break;
+        }
+        const int nSize = static_cast<int>(nByteCount);
+        if( nSize > nBufferSize )
+        {
+            GByte* pabyNewBuffer = (GByte*)
+                VSI_REALLOC_VERBOSE( pabyBuffer, nSize );
+            if( pabyNewBuffer == NULL )
+            {
+                eErr = CE_Failure;
+                break;
+            }
+            pabyBuffer = pabyNewBuffer;
+            nBufferSize = nSize;
+        }
+
+        tmsize_t nRead;
+        if( TIFFIsTiled( poSrcDS->hTIFF ) )
+            nRead = TIFFReadRawTile( poSrcDS->hTIFF, iBlock, pabyBuffer, nSize );
+        else
+            nRead = TIFFReadRawStrip( poSrcDS->hTIFF, iBlock, pabyBuffer, nSize );
+        if( nRead != nSize )
+        {
+            CPLError( CE_Failure, CPLE_FileIO,
+                      "Cannot read block %d of %s", iBlock,
+                      poSrcDS->GetDescription() );
+            eErr = CE_Failure;
+            break;
+        }
+
+        if( !SetDirectory() )
+        {
+            eErr = CE_Failure;
+            break;
+        }
+        WriteRawStripOrTile( iBlock, pabyBuffer, nSize );
+
+        if( !pfnProgress( (iBlock + 1) / (double)nBlockCount, NULL,
+                          pProgressData ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt,
+                      "User terminated CreateCopy()" );
+            eErr = CE_Failure;
+        }
+    }
+
+    CPLFree( pabyBuffer );
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                       CreateInternalMaskOverviews()                  */
 /************************************************************************/
@@ -8370,7 +9584,8 @@ CPLErr GTiffDataset::IBuildOverviews(
 /* -------------------------------------------------------------------- */
     uint16 nPredictor = PREDICTOR_NONE;
     if ( nCompression == COMPRESSION_LZW ||
-         nCompression == COMPRESSION_ADOBE_DEFLATE )
+         nCompression == COMPRESSION_ADOBE_DEFLATE ||
+         nCompression == COMPRESSION_ZSTD )
         TIFFGetField( hTIFF, TIFFTAG_PREDICTOR, &nPredictor );
 
 /* -------------------------------------------------------------------- */
@@ -8421,7 +9636,7 @@ CPLErr GTiffDataset::IBuildOverviews(
                                     nPredictor,
                                     panRed, panGreen, panBlue,
                                     nExtraSamples, panExtraSampleValues,
-                                    osMetadata );
+                                    osMetadata, anLercParameters );
 
 
             if( nOverviewOffset == 0 )
@@ -9574,10 +10789,16 @@ int GTiffDataset::SetDirectory( toff_t nNewOffset )
         }
         if(nJpegTablesMode >= 0 && nCompression == COMPRESSION_JPEG)
             TIFFSetField(hTIFF, TIFFTAG_JPEGTABLESMODE, nJpegTablesMode);
-        if(nZLevel > 0 && nCompression == COMPRESSION_ADOBE_DEFLATE)
+        if(nZLevel > 0 && (nCompression == COMPRESSION_ADOBE_DEFLATE ||
+                           nCompression == COMPRESSION_LERC))
             TIFFSetField(hTIFF, TIFFTAG_ZIPQUALITY, nZLevel);
         if(nLZMAPreset > 0 && nCompression == COMPRESSION_LZMA)
             TIFFSetField(hTIFF, TIFFTAG_LZMAPRESET, nLZMAPreset);
+        if(nZSTDLevel > 0 && (nCompression == COMPRESSION_ZSTD ||
+                              nCompression == COMPRESSION_LERC))
+            TIFFSetField(hTIFF, TIFFTAG_ZSTD_LEVEL, nZSTDLevel);
+        if(nCompression == COMPRESSION_LERC)
+            TIFFSetField(hTIFF, TIFFTAG_LERC_MAXZERROR, dfMaxZError);
     }
 
     return nSetDirResult;
@@ -9949,8 +11170,12 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
     std::vector<GTIFFErrorStruct> aoErrors;
     CPLPushErrorHandlerEx(GTIFFErrorHandler, &aoErrors);
     CPLSetCurrentErrorHandlerCatchDebug( FALSE );
-    hTIFF = VSI_TIFFOpen( pszFilename, ( poOpenInfo->eAccess == GA_ReadOnly ) ? "rc" : "r+c",
-                          poOpenInfo->fpL );
+    /* In read-only mode, load the strip/tile offsets and byte counts on */
+    /* demand, except when streaming where we cannot seek backward */
+    const char* pszOpenMode = "r+c";
+    if( poOpenInfo->eAccess == GA_ReadOnly )
+        pszOpenMode = bStreaming ? "rc" : "rcO";
+    hTIFF = VSI_TIFFOpen( pszFilename, pszOpenMode, poOpenInfo->fpL );
     CPLPopErrorHandler();
 #if SIZEOF_VOIDP == 4
     if( hTIFF == NULL )
@@ -10080,6 +11305,10 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
     {
         poDS->InitCreationOrOpenOptions(poOpenInfo->papszOpenOptions);
     }
+    else
+    {
+        poDS->InitDecompressionThreads(poOpenInfo->papszOpenOptions);
+    }
 
     if( nCompression == COMPRESSION_JPEG && poOpenInfo->eAccess == GA_Update )
     {
@@ -10197,19 +11426,169 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
 /*                      GTiffDatasetSetAreaOrPointMD()                  */
 /************************************************************************/
 
-static void GTiffDatasetSetAreaOrPointMD(GTIF* hGTIF,
+static const char* GTiffDatasetSetAreaOrPointMD(GTIF* hGTIF,
                                          GDALMultiDomainMetadata& oGTiffMDMD)
 {
     // Is this a pixel-is-point dataset?
     short nRasterType;
+    const char* pszAreaOrPoint = NULL;
 
     if( GDALGTIFKeyGetSHORT(hGTIF, GTRasterTypeGeoKey, &nRasterType,
                     0, 1 ) == 1 )
     {
         if( nRasterType == (short) RasterPixelIsPoint )
-            oGTiffMDMD.SetMetadataItem( GDALMD_AREA_OR_POINT, GDALMD_AOP_POINT );
+            pszAreaOrPoint = GDALMD_AOP_POINT;
         else
-            oGTiffMDMD.SetMetadataItem( GDALMD_AREA_OR_POINT, GDALMD_AOP_AREA );
+            pszAreaOrPoint = GDALMD_AOP_AREA;
+        oGTiffMDMD.SetMetadataItem( GDALMD_AREA_OR_POINT, pszAreaOrPoint );
+    }
+    return pszAreaOrPoint;
+}
+
+/************************************************************************/
+/*                          GTiff SRS cache                             */
+/*                                                                      */
+/*      Building the WKT from the GeoTIFF keys involves lookups in the  */
+/*      EPSG .csv files, which dominates the opening time of small      */
+/*      files opened over and over, for example by a WMS server. The    */
+/*      result is cached process-wide, keyed by the raw content of the  */
+/*      GeoTIFF key tags, so that it remains valid whatever the file    */
+/*      and whenever it is modified.                                    */
+/************************************************************************/
+
+typedef struct
+{
+    CPLString osKey;
+    CPLString osWKT;
+    CPLString osAreaOrPoint;
+} GTiffSRSCacheEntry;
+
+typedef std::list<GTiffSRSCacheEntry> GTiffSRSCacheList;
+
+static CPLMutex* hGTiffSRSCacheMutex = NULL;
+static GTiffSRSCacheList* poGTiffSRSCacheList = NULL; /* most recent first */
+static std::map<CPLString, GTiffSRSCacheList::iterator>* poGTiffSRSCacheMap = NULL;
+
+/************************************************************************/
+/*                        GTiffGetSRSCacheKey()                         */
+/************************************************************************/
+
+static bool GTiffGetSRSCacheKey( TIFF* hTIFF, CPLString& osKey )
+{
+    if( atoi(CPLGetConfigOption("GTIFF_SRS_CACHE_SIZE", "1000")) <= 0 )
+        return false;
+
+    uint16 nKeyCount = 0;
+    uint16* panKeys = NULL;
+    if( !TIFFGetField( hTIFF, TIFFTAG_GEOKEYDIRECTORY, &nKeyCount,
+                       &panKeys ) || nKeyCount == 0 )
+        return false;
+
+    /* Config options that alter the translation to WKT */
+    osKey = CPLSPrintf( "%s|%s|%s|%s|%s|",
+        CPLGetConfigOption("GTIFF_LINEAR_UNITS", ""),
+        CPLGetConfigOption("GTIFF_IMPORT_FROM_EPSG", ""),
+        CPLGetConfigOption("GTIFF_ESRI_CITATION", ""),
+        CPLGetConfigOption("GTIFF_REPORT_COMPD_CS", ""),
+        CPLGetConfigOption("GDAL_DATA", "") );
+
+    osKey.append( reinterpret_cast<const char*>(panKeys),
+                  nKeyCount * sizeof(uint16) );
+
+    uint16 nDoubleCount = 0;
+    double* padfDoubles = NULL;
+    if( TIFFGetField( hTIFF, TIFFTAG_GEODOUBLEPARAMS, &nDoubleCount,
+                      &padfDoubles ) && nDoubleCount > 0 )
+    {
+        osKey += "|D";
+        osKey.append( reinterpret_cast<const char*>(padfDoubles),
+                      nDoubleCount * sizeof(double) );
+    }
+
+    char* pszAscii = NULL;
+    if( TIFFGetField( hTIFF, TIFFTAG_GEOASCIIPARAMS, &pszAscii ) &&
+        pszAscii != NULL )
+    {
+        osKey += "|A";
+        osKey += pszAscii;
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/*                          GTiffGetCachedSRS()                         */
+/************************************************************************/
+
+static bool GTiffGetCachedSRS( const CPLString& osKey, CPLString& osWKT,
+                               CPLString& osAreaOrPoint )
+{
+    CPLMutexHolder oHolder( &hGTiffSRSCacheMutex );
+    if( poGTiffSRSCacheMap == NULL )
+        return false;
+
+    std::map<CPLString, GTiffSRSCacheList::iterator>::iterator oIter =
+        poGTiffSRSCacheMap->find(osKey);
+    if( oIter == poGTiffSRSCacheMap->end() )
+        return false;
+
+    /* Move to the front of the list */
+    poGTiffSRSCacheList->splice( poGTiffSRSCacheList->begin(),
+                                 *poGTiffSRSCacheList, oIter->second );
+    osWKT = oIter->second->osWKT;
+    osAreaOrPoint = oIter->second->osAreaOrPoint;
+    return true;
+}
+
+/************************************************************************/
+/*                          GTiffCacheSRS()                             */
+/************************************************************************/
+
+static void GTiffCacheSRS( const CPLString& osKey, const char* pszWKT,
+                           const char* pszAreaOrPoint )
+{
+    const size_t nMaxEntries = static_cast<size_t>(
+        atoi(CPLGetConfigOption("GTIFF_SRS_CACHE_SIZE", "1000")));
+
+    CPLMutexHolder oHolder( &hGTiffSRSCacheMutex );
+    if( poGTiffSRSCacheMap == NULL )
+    {
+        poGTiffSRSCacheList = new GTiffSRSCacheList();
+        poGTiffSRSCacheMap =
+            new std::map<CPLString, GTiffSRSCacheList::iterator>();
+    }
+    if( poGTiffSRSCacheMap->find(osKey) != poGTiffSRSCacheMap->end() )
+        return;
+
+    GTiffSRSCacheEntry sEntry;
+    sEntry.osKey = osKey;
+    sEntry.osWKT = pszWKT ? pszWKT : "";
+    sEntry.osAreaOrPoint = pszAreaOrPoint ? pszAreaOrPoint : "";
+    poGTiffSRSCacheList->push_front(sEntry);
+    (*poGTiffSRSCacheMap)[osKey] = poGTiffSRSCacheList->begin();
+
+    /* Evict the least recently used entries */
+    while( poGTiffSRSCacheList->size() > nMaxEntries )
+    {
+        poGTiffSRSCacheMap->erase( poGTiffSRSCacheList->back().osKey );
+        poGTiffSRSCacheList->pop_back();
+    }
+}
+
+/************************************************************************/
+/*                        GTiffClearSRSCache()                          */
+/************************************************************************/
+
+static void GTiffClearSRSCache()
+{
+    delete poGTiffSRSCacheMap;
+    poGTiffSRSCacheMap = NULL;
+    delete poGTiffSRSCacheList;
+    poGTiffSRSCacheList = NULL;
+    if( hGTiffSRSCacheMutex != NULL )
+    {
+        CPLDestroyMutex(hGTiffSRSCacheMutex);
+        hGTiffSRSCacheMutex = NULL;
     }
 }
 
@@ -10269,15 +11648,35 @@ void GTiffDataset::LookForProjection()
     CPLFree( pszProjection );
     pszProjection = NULL;
 
-    hGTIF = GTIFNew(hTIFF);
+    CPLString osCacheKey;
+    CPLString osCachedWKT;
+    CPLString osCachedAreaOrPoint;
+    const bool bUseCache = GTiffGetSRSCacheKey( hTIFF, osCacheKey );
+    const bool bFromCache = bUseCache &&
+        GTiffGetCachedSRS( osCacheKey, osCachedWKT, osCachedAreaOrPoint );
 
-    if ( !hGTIF )
+    hGTIF = bFromCache ? NULL : GTIFNew(hTIFF);
+
+    if( bFromCache )
+    {
+        pszProjection = CPLStrdup( osCachedWKT );
+        if( !osCachedAreaOrPoint.empty() )
+            oGTiffMDMD.SetMetadataItem( GDALMD_AREA_OR_POINT,
+                                        osCachedAreaOrPoint );
+    }
+    else if ( !hGTIF )
     {
         CPLError( CE_Warning, CPLE_AppDefined,
                   "GeoTIFF tags apparently corrupt, they are being ignored." );
     }
     else
     {
+        /* Collect the errors/warnings to know whether the result can */
+        /* be cached, and emit them later */
+        std::vector<GTIFFErrorStruct> aoErrors;
+        CPLPushErrorHandlerEx(GTIFFErrorHandler, &aoErrors);
+        CPLSetCurrentErrorHandlerCatchDebug( FALSE );
+
         GTIFDefn      *psGTIFDefn;
 
 #if LIBGEOTIFF_VERSION >= 1410
@@ -10318,9 +11717,23 @@ void GTiffDataset::LookForProjection()
         CPLFree(psGTIFDefn);
 #endif
 
-        GTiffDatasetSetAreaOrPointMD( hGTIF, oGTiffMDMD );
+        const char* pszAreaOrPoint =
+            GTiffDatasetSetAreaOrPointMD( hGTIF, oGTiffMDMD );
 
         GTIFFree( hGTIF );
+
+        CPLPopErrorHandler();
+        for( size_t iError = 0; iError < aoErrors.size(); iError++ )
+        {
+            CPLError( aoErrors[iError].type, aoErrors[iError].no, "%s",
+                      aoErrors[iError].msg.c_str() );
+        }
+
+        /* Do not cache the result if warnings or errors were emitted */
+        if( bUseCache && aoErrors.empty() )
+        {
+            GTiffCacheSRS( osCacheKey, pszProjection, pszAreaOrPoint );
+        }
     }
 
     if( pszProjection == NULL )
@@ -10523,7 +11936,7 @@ GDALDataset *GTiffDataset::OpenDir( GDALOpenInfo * poOpenInfo )
     VSILFILE* fpL = VSIFOpenL(pszFilename, "r");
     if( fpL == NULL )
         return NULL;
-    hTIFF = VSI_TIFFOpen( pszFilename, "r", fpL );
+    hTIFF = VSI_TIFFOpen( pszFilename, "rO", fpL );
     if( hTIFF == NULL )
     {
         CPL_IGNORE_RET_VAL(VSIFCloseL(fpL));
@@ -10590,6 +12003,7 @@ GDALDataset *GTiffDataset::OpenDir( GDALOpenInfo * poOpenInfo )
     else
     {
         poDS->bCloseTIFFHandle = TRUE;
+        poDS->InitDecompressionThreads(poOpenInfo->papszOpenOptions);
         return poDS;
     }
 }
@@ -11464,6 +12878,30 @@ CPLErr GTiffDataset::OpenOffset( TIFF *hTIFFIn,
         oGTiffMDMD.SetMetadataItem( "COMPRESSION", "JP2000", "IMAGE_STRUCTURE" );
     else if( nCompression == COMPRESSION_LZMA )
         oGTiffMDMD.SetMetadataItem( "COMPRESSION", "LZMA", "IMAGE_STRUCTURE" );
+    else if( nCompression == COMPRESSION_ZSTD )
+        oGTiffMDMD.SetMetadataItem( "COMPRESSION", "ZSTD", "IMAGE_STRUCTURE" );
+    else if( nCompression == COMPRESSION_LERC )
+    {
+        uint32 nLercParamCount = 0;
+        uint32* panLercParms = NULL;
+        if( TIFFGetField( hTIFF, TIFFTAG_LERC_PARAMETERS, &nLercParamCount,
+                          &panLercParms ) &&
+            nLercParamCount == 2 )
+        {
+            memcpy( anLercParameters, panLercParms,
+                    sizeof(anLercParameters) );
+        }
+
+        if( anLercParameters[1] == LERC_ADD_COMPRESSION_DEFLATE )
+            oGTiffMDMD.SetMetadataItem( "COMPRESSION", "LERC_DEFLATE",
+                                        "IMAGE_STRUCTURE" );
+        else if( anLercParameters[1] == LERC_ADD_COMPRESSION_ZSTD )
+            oGTiffMDMD.SetMetadataItem( "COMPRESSION", "LERC_ZSTD",
+                                        "IMAGE_STRUCTURE" );
+        else
+            oGTiffMDMD.SetMetadataItem( "COMPRESSION", "LERC",
+                                        "IMAGE_STRUCTURE" );
+    }
 
     else
     {
@@ -12080,6 +13518,33 @@ static int GTiffGetLZMAPreset(char** papszOptions)
     return nLZMAPreset;
 }
 
+static int GTiffGetZSTDLevel(char** papszOptions)
+{
+    int nZSTDLevel = -1;
+    const char* pszValue = CSLFetchNameValue( papszOptions, "ZSTD_LEVEL" );
+    if( pszValue  != NULL )
+    {
+        nZSTDLevel =  atoi( pszValue );
+        if (!(nZSTDLevel >= 1 && nZSTDLevel <= 22))
+        {
+            CPLError( CE_Warning, CPLE_IllegalArg,
+                    "ZSTD_LEVEL=%s value not recognised, ignoring.",
+                    pszValue );
+            nZSTDLevel = -1;
+        }
+    }
+    return nZSTDLevel;
+}
+
+/************************************************************************/
+/*                        GTiffGetLERCMaxZError()                       */
+/************************************************************************/
+
+static double GTiffGetLERCMaxZError(char** papszOptions)
+{
+    return CPLAtof( CSLFetchNameValueDef( papszOptions, "MAX_Z_ERROR", "0" ) );
+}
+
 
 static int GTiffGetZLevel(char** papszOptions)
 {
@@ -12281,12 +13746,31 @@ TIFF *GTiffDataset::CreateLL( const char * pszFilename,
             return NULL;
     }
 
+/* -------------------------------------------------------------------- */
+/*      LERC encodes a single sample per pixel in each strip/tile.      */
+/* -------------------------------------------------------------------- */
+    if( nCompression == COMPRESSION_LERC && nBands > 1 )
+    {
+        if( CSLFetchNameValue(papszParmList, "INTERLEAVE") == NULL )
+            nPlanar = PLANARCONFIG_SEPARATE;
+        else if( nPlanar == PLANARCONFIG_CONTIG )
+        {
+            CPLError( CE_Failure, CPLE_NotSupported,
+                      "COMPRESS=%s with several bands requires "
+                      "INTERLEAVE=BAND",
+                      CSLFetchNameValue( papszParmList, "COMPRESS" ) );
+            return NULL;
+        }
+    }
+
     pszValue = CSLFetchNameValue( papszParmList, "PREDICTOR" );
     if( pszValue  != NULL )
         nPredictor =  atoi( pszValue );
 
     int nZLevel = GTiffGetZLevel(papszParmList);
     int nLZMAPreset = GTiffGetLZMAPreset(papszParmList);
+    int nZSTDLevel = GTiffGetZSTDLevel(papszParmList);
+    double dfMaxZError = GTiffGetLERCMaxZError(papszParmList);
     int nJpegQuality = GTiffGetJpegQuality(papszParmList);
     int nJpegTablesMode = GTiffGetJpegTablesMode(papszParmList);
 
@@ -12768,7 +14252,8 @@ TIFF *GTiffDataset::CreateLL( const char * pszFilename,
 /*      Set compression related tags.                                   */
 /* -------------------------------------------------------------------- */
     if ( nCompression == COMPRESSION_LZW ||
-         nCompression == COMPRESSION_ADOBE_DEFLATE )
+         nCompression == COMPRESSION_ADOBE_DEFLATE ||
+         nCompression == COMPRESSION_ZSTD )
         TIFFSetField( hTIFF, TIFFTAG_PREDICTOR, nPredictor );
     if (nCompression == COMPRESSION_ADOBE_DEFLATE
         && nZLevel != -1)
@@ -12778,6 +14263,33 @@ TIFF *GTiffDataset::CreateLL( const char * pszFilename,
         TIFFSetField( hTIFF, TIFFTAG_JPEGQUALITY, nJpegQuality );
     else if( nCompression == COMPRESSION_LZMA && nLZMAPreset != -1)
         TIFFSetField( hTIFF, TIFFTAG_LZMAPRESET, nLZMAPreset );
+    else if( nCompression == COMPRESSION_ZSTD && nZSTDLevel != -1)
+        TIFFSetField( hTIFF, TIFFTAG_ZSTD_LEVEL, nZSTDLevel );
+    else if( nCompression == COMPRESSION_LERC )
+    {
+        const char* pszCompress =
+            CSLFetchNameValueDef( papszParmList, "COMPRESS", "" );
+        if( EQUAL(pszCompress, "LERC_DEFLATE") )
+        {
+            TIFFSetField( hTIFF, TIFFTAG_LERC_ADD_COMPRESSION,
+                          LERC_ADD_COMPRESSION_DEFLATE );
+            if( nZLevel != -1 )
+                TIFFSetField( hTIFF, TIFFTAG_ZIPQUALITY, nZLevel );
+        }
+        else if( EQUAL(pszCompress, "LERC_ZSTD") )
+        {
+            TIFFSetField( hTIFF, TIFFTAG_LERC_ADD_COMPRESSION,
+                          LERC_ADD_COMPRESSION_ZSTD );
+            if( nZSTDLevel != -1 )
+                TIFFSetField( hTIFF, TIFFTAG_ZSTD_LEVEL, nZSTDLevel );
+        }
+        else
+        {
+            TIFFSetField( hTIFF, TIFFTAG_LERC_ADD_COMPRESSION,
+                          LERC_ADD_COMPRESSION_NONE );
+        }
+        TIFFSetField( hTIFF, TIFFTAG_LERC_MAXZERROR, dfMaxZError );
+    }
 
     if( nCompression == COMPRESSION_JPEG )
         TIFFSetField( hTIFF, TIFFTAG_JPEGTABLESMODE, nJpegTablesMode );
@@ -13208,6 +14720,8 @@ GDALDataset *GTiffDataset::Create( const char * pszFilename,
 /* -------------------------------------------------------------------- */
     if( !CSLFetchBoolean( papszParmList, "SPARSE_OK", FALSE ) )
         poDS->bFillEmptyTiles = TRUE;
+    else
+        poDS->bWriteEmptyTiles = FALSE;
 
 /* -------------------------------------------------------------------- */
 /*      Preserve creation options for consulting later (for instance    */
@@ -13217,6 +14731,20 @@ GDALDataset *GTiffDataset::Create( const char * pszFilename,
 
     poDS->nZLevel = GTiffGetZLevel(papszParmList);
     poDS->nLZMAPreset = GTiffGetLZMAPreset(papszParmList);
+    poDS->nZSTDLevel = GTiffGetZSTDLevel(papszParmList);
+    poDS->dfMaxZError = GTiffGetLERCMaxZError(papszParmList);
+    if( poDS->nCompression == COMPRESSION_LERC )
+    {
+        uint32 nLercParamCount = 0;
+        uint32* panLercParms = NULL;
+        if( TIFFGetField( hTIFF, TIFFTAG_LERC_PARAMETERS, &nLercParamCount,
+                          &panLercParms ) &&
+            nLercParamCount == 2 )
+        {
+            memcpy( poDS->anLercParameters, panLercParms,
+                    sizeof(poDS->anLercParameters) );
+        }
+    }
     poDS->nJpegQuality = GTiffGetJpegQuality(papszParmList);
     poDS->nJpegTablesMode = GTiffGetJpegTablesMode(papszParmList);
     poDS->InitCreationOrOpenOptions(papszParmList);
@@ -13285,6 +14813,96 @@ GDALDataset *GTiffDataset::Create( const char * pszFilename,
     return( poDS );
 }
 
+/************************************************************************/
+/*                    GTiffCreateCopyCloudOptimized()                   */
+/*                                                                      */
+/*      Implements CLOUD_OPTIMIZED=YES: a regular tiled copy with the   */
+/*      source overviews is first done in a temporary file, and then    */
+/*      rewritten with the cloud optimized layout.                      */
+/************************************************************************/
+
+static GDALDataset *
+GTiffCreateCopyCloudOptimized( const char * pszFilename, GDALDataset *poSrcDS,
+                               int bStrict, char ** papszOptions,
+                               GDALProgressFunc pfnProgress,
+                               void * pProgressData )
+{
+    if( !CSLFetchBoolean(papszOptions, "TILED", TRUE) ||
+        CSLFetchBoolean(papszOptions, "STREAMABLE_OUTPUT", FALSE) )
+    {
+        CPLError( CE_Failure, CPLE_NotSupported,
+                  "CLOUD_OPTIMIZED=YES is not compatible with TILED=NO or "
+                  "STREAMABLE_OUTPUT=YES" );
+        return NULL;
+    }
+
+    CPLString osTmpFilename;
+    if( STARTS_WITH(pszFilename, "/vsistdout") )
+        osTmpFilename = CPLGenerateTempFilename("gtiff_cog");
+    else
+        osTmpFilename = pszFilename;
+    osTmpFilename += ".cog_tmp.tif";
+
+    char** papszTmpOptions = CSLSetNameValue(CSLDuplicate(papszOptions),
+                                             "CLOUD_OPTIMIZED", NULL);
+    papszTmpOptions = CSLSetNameValue(papszTmpOptions, "TILED", "YES");
+    papszTmpOptions = CSLSetNameValue(papszTmpOptions,
+                                      "COPY_SRC_OVERVIEWS", "YES");
+
+    /* The mask must be stored in the file itself */
+    CPLString osOldInternalMask(
+        CPLGetThreadLocalConfigOption("GDAL_TIFF_INTERNAL_MASK", ""));
+    CPLSetThreadLocalConfigOption("GDAL_TIFF_INTERNAL_MASK", "YES");
+
+    void* pScaledData = GDALCreateScaledProgress( 0.0, 0.8,
+                                                  pfnProgress, pProgressData );
+    GDALDataset* poTmpDS = GTiffDataset::CreateCopy(
+        osTmpFilename, poSrcDS, bStrict, papszTmpOptions,
+        GDALScaledProgress, pScaledData );
+    GDALDestroyScaledProgress(pScaledData);
+    CSLDestroy(papszTmpOptions);
+
+    CPLSetThreadLocalConfigOption("GDAL_TIFF_INTERNAL_MASK",
+        osOldInternalMask.size() ? osOldInternalMask.c_str() : NULL);
+
+    if( poTmpDS == NULL )
+    {
+        VSIUnlink(osTmpFilename);
+        return NULL;
+    }
+    delete poTmpDS;
+
+    pScaledData = GDALCreateScaledProgress( 0.8, 1.0,
+                                            pfnProgress, pProgressData );
+    CPLErr eErr = GTIFFRewriteCloudOptimized( osTmpFilename, pszFilename,
+                                              GDALScaledProgress,
+                                              pScaledData );
+    GDALDestroyScaledProgress(pScaledData);
+
+    /* Metadata that could not be stored in the TIFF file */
+    VSIStatBufL sStat;
+    CPLString osTmpAux(osTmpFilename + ".aux.xml");
+    if( VSIStatL(osTmpAux, &sStat) == 0 )
+    {
+        if( eErr == CE_None )
+            VSIRename(osTmpAux, (CPLString(pszFilename) + ".aux.xml").c_str());
+        else
+            VSIUnlink(osTmpAux);
+    }
+    VSIUnlink(osTmpFilename);
+
+    if( eErr != CE_None )
+    {
+        VSIUnlink(pszFilename);
+        return NULL;
+    }
+    if( STARTS_WITH(pszFilename, "/vsistdout") )
+        return NULL;
+
+    /* Updating the file would break its layout, so return it read-only */
+    return (GDALDataset*) GDALOpen(pszFilename, GA_ReadOnly);
+}
+
 /************************************************************************/
 /*                             CreateCopy()                             */
 /************************************************************************/
@@ -13311,6 +14929,11 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
         return NULL;
     }
 
+    if( CSLFetchBoolean(papszOptions, "CLOUD_OPTIMIZED", FALSE) )
+        return GTiffCreateCopyCloudOptimized( pszFilename, poSrcDS, bStrict,
+                                              papszOptions,
+                                              pfnProgress, pProgressData );
+
     poPBand = poSrcDS->GetRasterBand(1);
     GDALDataType eType = poPBand->GetRasterDataType();
 
@@ -13511,6 +15134,23 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     }
 #endif
 
+/* -------------------------------------------------------------------- */
+/*      When copying from another GeoTIFF, the strips/tiles might be    */
+/*      copied without decompressing and recompressing them. Not if a   */
+/*      compression level is explicitly asked, since we cannot know     */
+/*      the one that was used for the source.                           */
+/* -------------------------------------------------------------------- */
+    GTiffDataset* poSrcGTiffDS = NULL;
+    if( poSrcDS->GetDriver() != NULL &&
+        poSrcDS->GetDriver() == GDALGetDriverByName("GTiff") &&
+        CSLFetchNameValue( papszOptions, "ZLEVEL" ) == NULL &&
+        CSLFetchNameValue( papszOptions, "ZSTD_LEVEL" ) == NULL &&
+        CSLFetchNameValue( papszOptions, "LZMA_PRESET" ) == NULL &&
+        CSLFetchNameValue( papszOptions, "MAX_Z_ERROR" ) == NULL )
+    {
+        poSrcGTiffDS = (GTiffDataset*) poSrcDS;
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Create the file.                                                */
 /* -------------------------------------------------------------------- */
@@ -14051,6 +15691,10 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     poDS->CloneInfo( poSrcDS, nCloneInfoFlags );
     poDS->papszCreationOptions = CSLDuplicate( papszOptions );
     poDS->bDontReloadFirstBlock = bDontReloadFirstBlock;
+    const bool bSparseOK =
+        CPL_TO_BOOL(CSLFetchBoolean( papszOptions, "SPARSE_OK", FALSE ));
+    if( bSparseOK )
+        poDS->bWriteEmptyTiles = FALSE;
 
 /* -------------------------------------------------------------------- */
 /*      CloneInfo() doesn't merge metadata, it just replaces it totally */
@@ -14128,6 +15772,8 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
 
     poDS->nZLevel = GTiffGetZLevel(papszOptions);
     poDS->nLZMAPreset = GTiffGetLZMAPreset(papszOptions);
+    poDS->nZSTDLevel = GTiffGetZSTDLevel(papszOptions);
+    poDS->dfMaxZError = GTiffGetLERCMaxZError(papszOptions);
     poDS->nJpegQuality = GTiffGetJpegQuality(papszOptions);
     poDS->nJpegTablesMode = GTiffGetJpegTablesMode(papszOptions);
     poDS->GetDiscardLsbOption(papszOptions);
@@ -14155,6 +15801,25 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
             TIFFSetField( hTIFF, TIFFTAG_LZMAPRESET, poDS->nLZMAPreset );
         }
     }
+    else if( nCompression == COMPRESSION_ZSTD)
+    {
+        if (poDS->nZSTDLevel != -1)
+        {
+            TIFFSetField( hTIFF, TIFFTAG_ZSTD_LEVEL, poDS->nZSTDLevel );
+        }
+    }
+    else if( nCompression == COMPRESSION_LERC)
+    {
+        if (poDS->nZLevel != -1)
+        {
+            TIFFSetField( hTIFF, TIFFTAG_ZIPQUALITY, poDS->nZLevel );
+        }
+        if (poDS->nZSTDLevel != -1)
+        {
+            TIFFSetField( hTIFF, TIFFTAG_ZSTD_LEVEL, poDS->nZSTDLevel );
+        }
+        TIFFSetField( hTIFF, TIFFTAG_LERC_MAXZERROR, poDS->dfMaxZError );
+    }
 
     /* Precreate (internal) mask, so that the IBuildOverviews() below */
     /* has a chance to create also the overviews of the mask */
@@ -14201,9 +15866,12 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
                                       poOvrBand->GetYSize();
         }
 
-        char* papszCopyWholeRasterOptions[2] = { NULL, NULL };
+        char* papszCopyWholeRasterOptions[3] = { NULL, NULL, NULL };
+        int iCopyOption = 0;
         if (nCompression != COMPRESSION_NONE)
-            papszCopyWholeRasterOptions[0] = (char*) "COMPRESSED=YES";
+            papszCopyWholeRasterOptions[iCopyOption++] = (char*) "COMPRESSED=YES";
+        if( bSparseOK )
+            papszCopyWholeRasterOptions[iCopyOption++] = (char*) "SKIP_HOLES=YES";
         /* Now copy the imagery */
         for(i=0;eErr == CE_None && i<nSrcOverviews;i++)
         {
@@ -14216,6 +15884,8 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
 
             GDALRasterBand* poOvrBand =
                     poSrcDS->GetRasterBand(1)->GetOverview(iOvrLevel);
+            poDS->papoOverviewDS[iOvrLevel]->bWriteEmptyTiles =
+                poDS->bWriteEmptyTiles;
             double dfNextCurPixels = dfCurPixels +
                     ((double)poOvrBand->GetXSize()) * poOvrBand->GetYSize();
 
@@ -14223,10 +15893,28 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
                                       dfNextCurPixels / dfTotalPixels,
                                       pfnProgress, pProgressData);
 
-            eErr = GDALDatasetCopyWholeRaster( (GDALDatasetH) poSrcOvrDS,
-                                                (GDALDatasetH) poDS->papoOverviewDS[iOvrLevel],
-                                                papszCopyWholeRasterOptions,
-                                                GDALScaledProgress, pScaledData );
+            /* Internal overviews of a GeoTIFF source might be copied */
+            /* without recompression */
+            GTiffDataset* poSrcOvrGTiffDS = NULL;
+            if( poSrcGTiffDS != NULL &&
+                poSrcGTiffDS->nOverviewCount == nSrcOverviews )
+            {
+                poSrcOvrGTiffDS = poSrcGTiffDS->papoOverviewDS[iOvrLevel];
+            }
+
+            if( poSrcOvrGTiffDS != NULL &&
+                poDS->papoOverviewDS[iOvrLevel]->CanCopyRawBlocksFrom(poSrcOvrGTiffDS) )
+            {
+                eErr = poDS->papoOverviewDS[iOvrLevel]->CopyRawBlocksFrom(
+                                poSrcOvrGTiffDS, GDALScaledProgress, pScaledData );
+            }
+            else
+            {
+                eErr = GDALDatasetCopyWholeRaster( (GDALDatasetH) poSrcOvrDS,
+                                                    (GDALDatasetH) poDS->papoOverviewDS[iOvrLevel],
+                                                    papszCopyWholeRasterOptions,
+                                                    GDALScaledProgress, pScaledData );
+            }
 
             dfCurPixels = dfNextCurPixels;
             GDALDestroyScaledProgress(pScaledData);
@@ -14281,6 +15969,14 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     }
 #endif
 
+    if (bTryCopy && poSrcGTiffDS != NULL &&
+        poDS->CanCopyRawBlocksFrom(poSrcGTiffDS))
+    {
+        eErr = poDS->CopyRawBlocksFrom(poSrcGTiffDS,
+                                       GDALScaledProgress, pScaledData);
+        bTryCopy = FALSE;
+    }
+
     if (bTryCopy && (poDS->bTreatAsSplit || poDS->bTreatAsSplitBitmap))
     {
         /* For split bands, we use TIFFWriteScanline() interface */
@@ -14375,13 +16071,17 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     }
     else if (bTryCopy && eErr == CE_None)
     {
-        char* papszCopyWholeRasterOptions[2] = { NULL, NULL };
+        char* papszCopyWholeRasterOptions[3] = { NULL, NULL, NULL };
+        int iCopyOption = 0;
         if (nCompression != COMPRESSION_NONE)
-            papszCopyWholeRasterOptions[0] = (char*) "COMPRESSED=YES";
+            papszCopyWholeRasterOptions[iCopyOption++] = (char*) "COMPRESSED=YES";
         /* For streaming with separate, we really want that bands are written */
         /* after each other, even if the source is pixel interleaved */
         else if( bStreaming && poDS->nPlanarConfig == PLANARCONFIG_SEPARATE )
-            papszCopyWholeRasterOptions[0] = (char*) "INTERLEAVE=BAND";
+            papszCopyWholeRasterOptions[iCopyOption++] = (char*) "INTERLEAVE=BAND";
+        /* Do not even read the source blocks that are known to be missing */
+        if( bSparseOK )
+            papszCopyWholeRasterOptions[iCopyOption++] = (char*) "SKIP_HOLES=YES";
         eErr = GDALDatasetCopyWholeRaster( (GDALDatasetH) poSrcDS,
                                             (GDALDatasetH) poDS,
                                             papszCopyWholeRasterOptions,
@@ -15305,6 +17005,8 @@ void GDALDeregister_GTiff( GDALDriver * )
         hGTiffOneTimeInitMutex = NULL;
     }
 
+    GTiffClearSRSCache();
+
     LibgeotiffOneTimeCleanupMutex();
 }
 
@@ -15335,6 +17037,12 @@ int GTIFFGetCompressionMethod(const char* pszValue, const char* pszVariableName)
         nCompression = COMPRESSION_CCITTRLE;
     else if( EQUAL( pszValue, "LZMA" ) )
         nCompression = COMPRESSION_LZMA;
+    else if( EQUAL( pszValue, "ZSTD" ) )
+        nCompression = COMPRESSION_ZSTD;
+    else if( EQUAL( pszValue, "LERC" ) ||
+             EQUAL( pszValue, "LERC_DEFLATE" ) ||
+             EQUAL( pszValue, "LERC_ZSTD" ) )
+        nCompression = COMPRESSION_LERC;
     else
         CPLError( CE_Warning, CPLE_IllegalArg,
                     "%s=%s value not recognised, ignoring.",
@@ -15363,12 +17071,14 @@ void GDALRegister_GTiff()
     if( GDALGetDriverByName( "GTiff" ) != NULL )
         return;
 
-    char szCreateOptions[5000];
+    char szCreateOptions[6000];
     char szOptionalCompressItems[500];
     bool bHasJPEG = false;
     bool bHasLZW = false;
     bool bHasDEFLATE = false;
     bool bHasLZMA = false;
+    bool bHasZSTD = false;
+    bool bHasLERC = false;
 
     GDALDriver *poDriver = new GDALDriver();
 
@@ -15428,6 +17138,24 @@ void GDALRegister_GTiff()
             strcat( szOptionalCompressItems,
                     "       <Value>LZMA</Value>" );
         }
+        else if( c->scheme == COMPRESSION_ZSTD )
+        {
+            bHasZSTD = true;
+            strcat( szOptionalCompressItems,
+                    "       <Value>ZSTD</Value>" );
+        }
+        else if( c->scheme == COMPRESSION_LERC )
+        {
+            bHasLERC = true;
+            strcat( szOptionalCompressItems,
+                    "       <Value>LERC</Value>" );
+            if( bHasDEFLATE )
+                strcat( szOptionalCompressItems,
+                        "       <Value>LERC_DEFLATE</Value>" );
+            if( bHasZSTD )
+                strcat( szOptionalCompressItems,
+                        "       <Value>LERC_ZSTD</Value>" );
+        }
     }
     _TIFFfree( codecs );
 #endif
@@ -15461,6 +17189,12 @@ void GDALRegister_GTiff()
     if (bHasLZMA)
         strcat( szCreateOptions, ""
 "   <Option name='LZMA_PRESET' type='int' description='LZMA compression level 0(fast)-9(slow)' default='6'/>");
+    if (bHasZSTD)
+        strcat( szCreateOptions, ""
+"   <Option name='ZSTD_LEVEL' type='int' description='ZSTD compression level 1(fast)-22(slow)' default='9'/>");
+    if (bHasLERC)
+        strcat( szCreateOptions, ""
+"   <Option name='MAX_Z_ERROR' type='float' description='Maximum error for LERC compression' default='0'/>");
     strcat( szCreateOptions, ""
 "   <Option name='NUM_THREADS' type='string' description='Number of worker threads for compression. Can be set to ALL_CPUS' default='1'/>"
 "   <Option name='NBITS' type='int' description='BITS for sub-byte files (1-7), sub-uint16 (9-15), sub-uint32 (17-31)'/>"
@@ -15517,6 +17251,7 @@ void GDALRegister_GTiff()
 "       <Value>BIG</Value>"
 "   </Option>"
 "   <Option name='COPY_SRC_OVERVIEWS' type='boolean' default='NO' description='Force copy of overviews of source dataset (CreateCopy())'/>"
+"   <Option name='CLOUD_OPTIMIZED' type='boolean' default='NO' description='Write a tiled file with overviews where IFDs come first and imagery is ordered for efficient remote access (CreateCopy())'/>"
 "   <Option name='SOURCE_ICC_PROFILE' type='string' description='ICC profile'/>"
 "   <Option name='SOURCE_PRIMARIES_RED' type='string' description='x,y,1.0 (xyY) red chromaticity'/>"
 "   <Option name='SOURCE_PRIMARIES_GREEN' type='string' description='x,y,1.0 (xyY) green chromaticity'/>"
@@ -15550,7 +17285,7 @@ void GDALRegister_GTiff()
     poDriver->SetMetadataItem( GDAL_DMD_CREATIONOPTIONLIST, szCreateOptions );
     poDriver->SetMetadataItem( GDAL_DMD_OPENOPTIONLIST,
 "<OpenOptionList>"
-"   <Option name='NUM_THREADS' type='string' description='Number of worker threads for compression. Can be set to ALL_CPUS' default='1'/>"
+"   <Option name='NUM_THREADS' type='string' description='Number of worker threads for compression (update mode) or decompression (read-only mode). Can be set to ALL_CPUS' default='1'/>"
 "   <Option name='GEOTIFF_KEYS_FLAVOR' type='string-select' default='STANDARD' description='Which flavor of GeoTIFF keys must be used (for writing)'>"
 "       <Value>STANDARD</Value>"
 "       <Value>ESRI_PE</Value>"
@@ -0,0 +1,857 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GeoTIFF Driver
+ * Purpose:  Rewrite a TIFF file with a cloud optimized layout, that is
+ *           with all the IFDs and their tag data at the beginning of the
+ *           file, followed by the imagery of the overviews (smallest first)
+ *           and finally the full resolution imagery.
+ *
+ ******************************************************************************
+ * Copyright (c) 2016, The GDAL project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "cpl_port.h"
+#include "gt_cog.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+#include "tiffio.h"
+
+CPL_CVSID("$Id$");
+
+/* Maximum number of IFDs we accept to process */
+#define COG_MAX_IFD_COUNT   1000
+
+/************************************************************************/
+/*                            Structures.                               */
+/************************************************************************/
+
+typedef struct
+{
+    int                 nTag;
+    int                 nType;
+    GUIntBig            nCount;
+    std::vector<GByte>  abyData;      /* in the byte order of the file */
+    GUIntBig            nNewDataOffset;
+} GTiffCOGEntry;
+
+typedef struct
+{
+    std::vector<GTiffCOGEntry> asEntries;
+    int                 iOffsetsEntry;
+    int                 iByteCountsEntry;
+    std::vector<GUIntBig> anOffsets;
+    std::vector<GUIntBig> anByteCounts;
+    std::vector<GUIntBig> anNewOffsets;
+    double              dfPixels;
+    bool                bMask;
+    int                 iChainIdx;
+    GUIntBig            nNewIFDOffset;
+} GTiffCOGIFD;
+
+/************************************************************************/
+/*                          GTiffCOGRewriter                            */
+/************************************************************************/
+
+class GTiffCOGRewriter
+{
+    VSILFILE   *fpSrc;
+    VSILFILE   *fpDst;
+    bool        bSwap;
+    bool        bBigTIFF;
+    GByte       abyHeader[8];
+    GUIntBig    nDstPos;
+    std::vector<GTiffCOGIFD> asIFDs;
+
+    GUInt16     GetU16(const GByte* pabyData) const;
+    GUInt32     GetU32(const GByte* pabyData) const;
+    GUIntBig    GetU64(const GByte* pabyData) const;
+    void        PutU16(GByte* pabyData, GUInt16 nVal) const;
+    void        PutU32(GByte* pabyData, GUInt32 nVal) const;
+    void        PutU64(GByte* pabyData, GUIntBig nVal) const;
+    void        PutOffset(GByte* pabyData, GUIntBig nVal) const;
+
+    int         GetInlineSize() const { return bBigTIFF ? 8 : 4; }
+    int         GetIFDSize(const GTiffCOGIFD& sIFD) const;
+
+    bool        ReadIFDs();
+    bool        ReadStrileArray(const GTiffCOGEntry& sEntry,
+                                std::vector<GUIntBig>& anValues);
+    bool        ComputeLayout(const CPLString& osGhostArea);
+    bool        Write(const void* pData, size_t nSize);
+    bool        PadTo(GUIntBig nPos);
+    bool        WriteIFDs(const CPLString& osGhostArea);
+    bool        WriteImagery(GDALProgressFunc pfnProgress,
+                             void * pProgressData);
+
+  public:
+                GTiffCOGRewriter(VSILFILE* fpSrcIn, VSILFILE* fpDstIn);
+
+    CPLErr      Run(GDALProgressFunc pfnProgress, void * pProgressData);
+};
+
+/************************************************************************/
+/*                         GTiffCOGRewriter()                           */
+/************************************************************************/
+
+GTiffCOGRewriter::GTiffCOGRewriter(VSILFILE* fpSrcIn, VSILFILE* fpDstIn) :
+    fpSrc(fpSrcIn),
+    fpDst(fpDstIn),
+    bSwap(false),
+    bBigTIFF(false),
+    nDstPos(0)
+{
+    memset(abyHeader, 0, sizeof(abyHeader));
+}
+
+/************************************************************************/
+/*                     Byte order aware accessors.                      */
+/************************************************************************/
+
+GUInt16 GTiffCOGRewriter::GetU16(const GByte* pabyData) const
+{
+    GUInt16 nVal;
+    memcpy(&nVal, pabyData, sizeof(nVal));
+    if( bSwap )
+        CPL_SWAP16PTR(&nVal);
+    return nVal;
+}
+
+GUInt32 GTiffCOGRewriter::GetU32(const GByte* pabyData) const
+{
+    GUInt32 nVal;
+    memcpy(&nVal, pabyData, sizeof(nVal));
+    if( bSwap )
+        CPL_SWAP32PTR(&nVal);
+    return nVal;
+}
+
+GUIntBig GTiffCOGRewriter::GetU64(const GByte* pabyData) const
+{
+    GUIntBig nVal;
+    memcpy(&nVal, pabyData, sizeof(nVal));
+    if( bSwap )
+        CPL_SWAP64PTR(&nVal);
+    return nVal;
+}
+
+void GTiffCOGRewriter::PutU16(GByte* pabyData, GUInt16 nVal) const
+{
+    if( bSwap )
+        CPL_SWAP16PTR(&nVal);
+    memcpy(pabyData, &nVal, sizeof(nVal));
+}
+
+void GTiffCOGRewriter::PutU32(GByte* pabyData, GUInt32 nVal) const
+{
+    if( bSwap )
+        CPL_SWAP32PTR(&nVal);
+    memcpy(pabyData, &nVal, sizeof(nVal));
+}
+
+void GTiffCOGRewriter::PutU64(GByte* pabyData, GUIntBig nVal) const
+{
+    if( bSwap )
+        CPL_SWAP64PTR(&nVal);
+    memcpy(pabyData, &nVal, sizeof(nVal));
+}
+
+void GTiffCOGRewriter::PutOffset(GByte* pabyData, GUIntBig nVal) const
+{
+    if( bBigTIFF )
+        PutU64(pabyData, nVal);
+    else
+        PutU32(pabyData, static_cast<GUInt32>(nVal));
+}
+
+/************************************************************************/
+/*                          GTiffCOGTypeSize()                          */
+/************************************************************************/
+
+static int GTiffCOGTypeSize(int nType)
+{
+    switch( nType )
+    {
+        case TIFF_BYTE:
+        case TIFF_ASCII:
+        case TIFF_SBYTE:
+        case TIFF_UNDEFINED:
+            return 1;
+        case TIFF_SHORT:
+        case TIFF_SSHORT:
+            return 2;
+        case TIFF_LONG:
+        case TIFF_SLONG:
+        case TIFF_FLOAT:
+        case TIFF_IFD:
+            return 4;
+        case TIFF_RATIONAL:
+        case TIFF_SRATIONAL:
+        case TIFF_DOUBLE:
+        case TIFF_LONG8:
+        case TIFF_SLONG8:
+        case TIFF_IFD8:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+/************************************************************************/
+/*                             GetIFDSize()                             */
+/************************************************************************/
+
+int GTiffCOGRewriter::GetIFDSize(const GTiffCOGIFD& sIFD) const
+{
+    const int nEntries = static_cast<int>(sIFD.asEntries.size());
+    if( bBigTIFF )
+        return 8 + nEntries * 20 + 8;
+    return 2 + nEntries * 12 + 4;
+}
+
+/************************************************************************/
+/*                              ReadIFDs()                              */
+/************************************************************************/
+
+bool GTiffCOGRewriter::ReadIFDs()
+{
+    if( VSIFReadL(abyHeader, 1, 8, fpSrc) != 8 )
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Cannot read TIFF header");
+        return false;
+    }
+    if( abyHeader[0] == 'I' && abyHeader[1] == 'I' )
+        bSwap = !CPL_IS_LSB;
+    else if( abyHeader[0] == 'M' && abyHeader[1] == 'M' )
+        bSwap = CPL_IS_LSB;
+    else
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Not a TIFF file");
+        return false;
+    }
+
+    GUIntBig nIFDOffset;
+    const int nVersion = GetU16(abyHeader + 2);
+    if( nVersion == 42 )
+    {
+        bBigTIFF = false;
+        nIFDOffset = GetU32(abyHeader + 4);
+    }
+    else if( nVersion == 43 )
+    {
+        bBigTIFF = true;
+        GByte abyOffset[8];
+        if( VSIFReadL(abyOffset, 1, 8, fpSrc) != 8 )
+        {
+            CPLError(CE_Failure, CPLE_FileIO, "Cannot read TIFF header");
+            return false;
+        }
+        nIFDOffset = GetU64(abyOffset);
+    }
+    else
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Not a TIFF file");
+        return false;
+    }
+
+    const int nEntrySize = bBigTIFF ? 20 : 12;
+    const int nInlineSize = GetInlineSize();
+    std::set<GUIntBig> oSetVisitedIFDs;
+
+    while( nIFDOffset != 0 )
+    {
+        if( oSetVisitedIFDs.find(nIFDOffset) != oSetVisitedIFDs.end() ||
+            oSetVisitedIFDs.size() == COG_MAX_IFD_COUNT )
+        {
+            CPLError(CE_Failure, CPLE_AppDefined,
+                     "Invalid or too long IFD chain");
+            return false;
+        }
+        oSetVisitedIFDs.insert(nIFDOffset);
+
+/* -------------------------------------------------------------------- */
+/*      Read the directory.                                             */
+/* -------------------------------------------------------------------- */
+        GByte abyCount[8];
+        GUIntBig nEntries;
+        if( VSIFSeekL(fpSrc, nIFDOffset, SEEK_SET) != 0 ||
+            VSIFReadL(abyCount, 1, bBigTIFF ? 8 : 2, fpSrc) !=
+                                                (size_t)(bBigTIFF ? 8 : 2) )
+        {
+            CPLError(CE_Failure, CPLE_FileIO, "Cannot read IFD");
+            return false;
+        }
+        nEntries = bBigTIFF ? GetU64(abyCount) : GetU16(abyCount);
+        if( nEntries == 0 || nEntries > 65535 )
+        {
+            CPLError(CE_Failure, CPLE_AppDefined,
+                     "Invalid number of IFD entries");
+            return false;
+        }
+
+        const size_t nDirSize = static_cast<size_t>(nEntries) * nEntrySize +
+                                nInlineSize;
+        std::vector<GByte> abyDir(nDirSize);
+        if( VSIFReadL(&abyDir[0], 1, nDirSize, fpSrc) != nDirSize )
+        {
+            CPLError(CE_Failure, CPLE_FileIO, "Cannot read IFD");
+            return false;
+        }
+
+        GTiffCOGIFD sIFD;
+        sIFD.iOffsetsEntry = -1;
+        sIFD.iByteCountsEntry = -1;
+        sIFD.dfPixels = 0;
+        sIFD.bMask = false;
+        sIFD.iChainIdx = static_cast<int>(asIFDs.size());
+        sIFD.nNewIFDOffset = 0;
+        GUIntBig nWidth = 0;
+        GUIntBig nHeight = 0;
+
+        for( int i = 0; i < static_cast<int>(nEntries); i++ )
+        {
+            const GByte* pabyEntry = &abyDir[0] + i * nEntrySize;
+            GTiffCOGEntry sEntry;
+            sEntry.nTag = GetU16(pabyEntry);
+            sEntry.nType = GetU16(pabyEntry + 2);
+            sEntry.nCount = bBigTIFF ? GetU64(pabyEntry + 4) :
+                                       GetU32(pabyEntry + 4);
+            sEntry.nNewDataOffset = 0;
+            const GByte* pabyValue = pabyEntry + (bBigTIFF ? 12 : 8);
+
+            const int nTypeSize = GTiffCOGTypeSize(sEntry.nType);
+            if( nTypeSize == 0 )
+            {
+                CPLError(CE_Failure, CPLE_NotSupported,
+                         "Unsupported type %d for tag %d",
+                         sEntry.nType, sEntry.nTag);
+                return false;
+            }
+
+            /* Those tags point to other structures in the file that */
+            /* we would not relocate */
+            if( sEntry.nTag == TIFFTAG_SUBIFD ||
+                sEntry.nTag == TIFFTAG_FREEOFFSETS ||
+                sEntry.nTag == TIFFTAG_JPEGIFOFFSET ||
+                sEntry.nTag == TIFFTAG_EXIFIFD ||
+                sEntry.nTag == TIFFTAG_GPSIFD ||
+                sEntry.nType == TIFF_IFD || sEntry.nType == TIFF_IFD8 )
+            {
+                CPLError(CE_Failure, CPLE_NotSupported,
+                         "Tag %d not supported for cloud optimized layout",
+                         sEntry.nTag);
+                return false;
+            }
+
+            if( sEntry.nCount > static_cast<GUIntBig>(INT_MAX / nTypeSize) )
+            {
+                CPLError(CE_Failure, CPLE_AppDefined,
+                         "Too large count for tag %d", sEntry.nTag);
+                return false;
+            }
+            const size_t nDataSize = static_cast<size_t>(sEntry.nCount) *
+                                     nTypeSize;
+            sEntry.abyData.resize(nDataSize);
+            if( nDataSize <= static_cast<size_t>(nInlineSize) )
+            {
+                if( nDataSize )
+                    memcpy(&sEntry.abyData[0], pabyValue, nDataSize);
+            }
+            else
+            {
+                const GUIntBig nDataOffset = bBigTIFF ? GetU64(pabyValue) :
+                                                        GetU32(pabyValue);
+                if( VSIFSeekL(fpSrc, nDataOffset, SEEK_SET) != 0 ||
+                    VSIFReadL(&sEntry.abyData[0], 1, nDataSize, fpSrc) !=
+                                                                nDataSize )
+                {
+                    CPLError(CE_Failure, CPLE_FileIO,
+                             "Cannot read data of tag %d", sEntry.nTag);
+                    return false;
+                }
+            }
+
+            if( sEntry.nTag == TIFFTAG_STRIPOFFSETS ||
+                sEntry.nTag == TIFFTAG_TILEOFFSETS )
+                sIFD.iOffsetsEntry = i;
+            else if( sEntry.nTag == TIFFTAG_STRIPBYTECOUNTS ||
+                     sEntry.nTag == TIFFTAG_TILEBYTECOUNTS )
+                sIFD.iByteCountsEntry = i;
+
+            sIFD.asEntries.push_back(sEntry);
+
+            if( sEntry.nTag == TIFFTAG_IMAGEWIDTH ||
+                sEntry.nTag == TIFFTAG_IMAGELENGTH ||
+                sEntry.nTag == TIFFTAG_SUBFILETYPE )
+            {
+                std::vector<GUIntBig> anValues;
+                if( !ReadStrileArray(sEntry, anValues) || anValues.empty() )
+                    return false;
+                if( sEntry.nTag == TIFFTAG_IMAGEWIDTH )
+                    nWidth = anValues[0];
+                else if( sEntry.nTag == TIFFTAG_IMAGELENGTH )
+                    nHeight = anValues[0];
+                else
+                    sIFD.bMask = (anValues[0] & FILETYPE_MASK) != 0;
+            }
+        }
+
+        if( sIFD.iOffsetsEntry < 0 || sIFD.iByteCountsEntry < 0 ||
+            !ReadStrileArray(sIFD.asEntries[sIFD.iOffsetsEntry],
+                             sIFD.anOffsets) ||
+            !ReadStrileArray(sIFD.asEntries[sIFD.iByteCountsEntry],
+                             sIFD.anByteCounts) ||
+            sIFD.anOffsets.size() != sIFD.anByteCounts.size() )
+        {
+            CPLError(CE_Failure, CPLE_AppDefined,
+                     "Missing or inconsistent strip/tile offsets and "
+                     "byte counts");
+            return false;
+        }
+        sIFD.dfPixels = static_cast<double>(nWidth) * nHeight;
+
+        asIFDs.push_back(sIFD);
+
+        const GByte* pabyNext = &abyDir[0] + nEntries * nEntrySize;
+        nIFDOffset = bBigTIFF ? GetU64(pabyNext) : GetU32(pabyNext);
+    }
+
+    if( asIFDs.empty() )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "No IFD found");
+        return false;
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                          ReadStrileArray()                           */
+/*                                                                      */
+/*      Decode the values of an integer tag.                            */
+/************************************************************************/
+
+bool GTiffCOGRewriter::ReadStrileArray(const GTiffCOGEntry& sEntry,
+                                       std::vector<GUIntBig>& anValues)
+{
+    const int nTypeSize = GTiffCOGTypeSize(sEntry.nType);
+    if( sEntry.nType != TIFF_BYTE && sEntry.nType != TIFF_SHORT &&
+        sEntry.nType != TIFF_LONG && sEntry.nType != TIFF_LONG8 )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined,
+                 "Unexpected type %d for tag %d", sEntry.nType, sEntry.nTag);
+        return false;
+    }
+
+    anValues.resize(static_cast<size_t>(sEntry.nCount));
+    for( size_t i = 0; i < anValues.size(); i++ )
+    {
+        const GByte* pabyVal = &sEntry.abyData[0] + i * nTypeSize;
+        if( nTypeSize == 1 )
+            anValues[i] = pabyVal[0];
+        else if( nTypeSize == 2 )
+            anValues[i] = GetU16(pabyVal);
+        else if( nTypeSize == 4 )
+            anValues[i] = GetU32(pabyVal);
+        else
+            anValues[i] = GetU64(pabyVal);
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                    GTiffCOGDataOrderLess()                           */
+/*                                                                      */
+/*      Imagery of smallest images first, masks after their image.      */
+/************************************************************************/
+
+static bool GTiffCOGDataOrderLess(const GTiffCOGIFD* psA,
+                                  const GTiffCOGIFD* psB)
+{
+    if( psA->dfPixels != psB->dfPixels )
+        return psA->dfPixels < psB->dfPixels;
+    if( psA->bMask != psB->bMask )
+        return !psA->bMask;
+    return psA->iChainIdx < psB->iChainIdx;
+}
+
+/************************************************************************/
+/*                           ComputeLayout()                            */
+/************************************************************************/
+
+bool GTiffCOGRewriter::ComputeLayout(const CPLString& osGhostArea)
+{
+    const int nInlineSize = GetInlineSize();
+    const int nStrileType = bBigTIFF ? TIFF_LONG8 : TIFF_LONG;
+
+/* -------------------------------------------------------------------- */
+/*      IFDs and their tag data, in the order of the IFD chain.         */
+/*      Strip/tile offsets and byte counts are stored as LONG or LONG8  */
+/*      so that their size does not depend on their values.             */
+/* -------------------------------------------------------------------- */
+    GUIntBig nPos = (bBigTIFF ? 16 : 8) + osGhostArea.size();
+    for( size_t i = 0; i < asIFDs.size(); i++ )
+    {
+        GTiffCOGIFD& sIFD = asIFDs[i];
+        nPos += (nPos % 2);
+        sIFD.nNewIFDOffset = nPos;
+        nPos += GetIFDSize(sIFD);
+
+        for( size_t j = 0; j < sIFD.asEntries.size(); j++ )
+        {
+            GTiffCOGEntry& sEntry = sIFD.asEntries[j];
+            if( static_cast<int>(j) == sIFD.iOffsetsEntry ||
+                static_cast<int>(j) == sIFD.iByteCountsEntry )
+            {
+                sEntry.nType = nStrileType;
+                sEntry.abyData.resize(static_cast<size_t>(sEntry.nCount) *
+                                      GTiffCOGTypeSize(nStrileType));
+            }
+            if( sEntry.abyData.size() > static_cast<size_t>(nInlineSize) )
+            {
+                nPos += (nPos % 2);
+                sEntry.nNewDataOffset = nPos;
+                nPos += sEntry.abyData.size();
+            }
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Imagery: each strip/tile is preceded by its size on 4 bytes     */
+/*      and followed by a copy of its last 4 bytes.                     */
+/* -------------------------------------------------------------------- */
+    std::vector<GTiffCOGIFD*> apsDataOrder;
+    for( size_t i = 0; i < asIFDs.size(); i++ )
+        apsDataOrder.push_back(&asIFDs[i]);
+    std::stable_sort(apsDataOrder.begin(), apsDataOrder.end(),
+                     GTiffCOGDataOrderLess);
+
+    for( size_t i = 0; i < apsDataOrder.size(); i++ )
+    {
+        GTiffCOGIFD& sIFD = *(apsDataOrder[i]);
+        sIFD.anNewOffsets.resize(sIFD.anOffsets.size());
+        for( size_t j = 0; j < sIFD.anOffsets.size(); j++ )
+        {
+            if( sIFD.anByteCounts[j] == 0 )
+            {
+                /* Sparse block */
+                sIFD.anNewOffsets[j] = 0;
+                continue;
+            }
+            if( sIFD.anByteCounts[j] > INT_MAX )
+            {
+                CPLError(CE_Failure, CPLE_NotSupported,
+                         "Too large strip/tile");
+                return false;
+            }
+            nPos += 4;
+            sIFD.anNewOffsets[j] = nPos;
+            nPos += sIFD.anByteCounts[j] + 4;
+        }
+    }
+
+    if( !bBigTIFF && nPos > 0xFFFFFFFFU )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined,
+                 "Cloud optimized layout would be larger than 4 GB. "
+                 "Use BIGTIFF=YES");
+        return false;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Now that the position of the imagery is known, encode the      */
+/*      strip/tile arrays.                                              */
+/* -------------------------------------------------------------------- */
+    for( size_t i = 0; i < asIFDs.size(); i++ )
+    {
+        GTiffCOGIFD& sIFD = asIFDs[i];
+        GByte* pabyOffsets = &sIFD.asEntries[sIFD.iOffsetsEntry].abyData[0];
+        GByte* pabyByteCounts =
+            &sIFD.asEntries[sIFD.iByteCountsEntry].abyData[0];
+        for( size_t j = 0; j < sIFD.anNewOffsets.size(); j++ )
+        {
+            PutOffset(pabyOffsets + j * nInlineSize, sIFD.anNewOffsets[j]);
+            PutOffset(pabyByteCounts + j * nInlineSize, sIFD.anByteCounts[j]);
+        }
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/*                          Write() / PadTo()                           */
+/************************************************************************/
+
+bool GTiffCOGRewriter::Write(const void* pData, size_t nSize)
+{
+    if( nSize == 0 )
+        return true;
+    if( VSIFWriteL(pData, 1, nSize, fpDst) != nSize )
+    {
+        CPLError(CE_Failure, CPLE_FileIO, "Write error");
+        return false;
+    }
+    nDstPos += nSize;
+    return true;
+}
+
+bool GTiffCOGRewriter::PadTo(GUIntBig nPos)
+{
+    CPLAssert(nPos >= nDstPos && nPos - nDstPos < 8);
+    const GByte abyZero[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    return Write(abyZero, static_cast<size_t>(nPos - nDstPos));
+}
+
+/************************************************************************/
+/*                             WriteIFDs()                              */
+/************************************************************************/
+
+bool GTiffCOGRewriter::WriteIFDs(const CPLString& osGhostArea)
+{
+    const int nInlineSize = GetInlineSize();
+
+/* -------------------------------------------------------------------- */
+/*      Header and structural metadata.                                 */
+/* -------------------------------------------------------------------- */
+    GByte abyHeader16[16];
+    memcpy(abyHeader16, abyHeader, 8);
+    if( bBigTIFF )
+        PutU64(abyHeader16 + 8, asIFDs[0].nNewIFDOffset);
+    else
+        PutU32(abyHeader16 + 4, static_cast<GUInt32>(asIFDs[0].nNewIFDOffset));
+    if( !Write(abyHeader16, bBigTIFF ? 16 : 8) ||
+        !Write(osGhostArea.c_str(), osGhostArea.size()) )
+        return false;
+
+/* -------------------------------------------------------------------- */
+/*      Directories.                                                    */
+/* -------------------------------------------------------------------- */
+    for( size_t i = 0; i < asIFDs.size(); i++ )
+    {
+        const GTiffCOGIFD& sIFD = asIFDs[i];
+        std::vector<GByte> abyDir(GetIFDSize(sIFD), 0);
+        GByte* pabyPtr = &abyDir[0];
+        if( bBigTIFF )
+        {
+            PutU64(pabyPtr, sIFD.asEntries.size());
+            pabyPtr += 8;
+        }
+        else
+        {
+            PutU16(pabyPtr, static_cast<GUInt16>(sIFD.asEntries.size()));
+            pabyPtr += 2;
+        }
+
+        for( size_t j = 0; j < sIFD.asEntries.size(); j++ )
+        {
+            const GTiffCOGEntry& sEntry = sIFD.asEntries[j];
+            PutU16(pabyPtr, static_cast<GUInt16>(sEntry.nTag));
+            PutU16(pabyPtr + 2, static_cast<GUInt16>(sEntry.nType));
+            if( bBigTIFF )
+            {
+                PutU64(pabyPtr + 4, sEntry.nCount);
+                pabyPtr += 12;
+            }
+            else
+            {
+                PutU32(pabyPtr + 4, static_cast<GUInt32>(sEntry.nCount));
+                pabyPtr += 8;
+            }
+            if( sEntry.abyData.size() > static_cast<size_t>(nInlineSize) )
+                PutOffset(pabyPtr, sEntry.nNewDataOffset);
+            else if( !sEntry.abyData.empty() )
+                memcpy(pabyPtr, &sEntry.abyData[0], sEntry.abyData.size());
+            pabyPtr += nInlineSize;
+        }
+
+        PutOffset(pabyPtr, (i + 1 < asIFDs.size()) ?
+                                    asIFDs[i+1].nNewIFDOffset : 0);
+
+        if( !PadTo(sIFD.nNewIFDOffset) ||
+            !Write(&abyDir[0], abyDir.size()) )
+            return false;
+
+        for( size_t j = 0; j < sIFD.asEntries.size(); j++ )
+        {
+            const GTiffCOGEntry& sEntry = sIFD.asEntries[j];
+            if( sEntry.abyData.size() > static_cast<size_t>(nInlineSize) &&
+                (!PadTo(sEntry.nNewDataOffset) ||
+                 !Write(&sEntry.abyData[0], sEntry.abyData.size())) )
+                return false;
+        }
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                            WriteImagery()                            */
+/************************************************************************/
+
+bool GTiffCOGRewriter::WriteImagery(GDALProgressFunc pfnProgress,
+                                    void * pProgressData)
+{
+    std::vector<GTiffCOGIFD*> apsDataOrder;
+    double dfTotalBytes = 0;
+    for( size_t i = 0; i < asIFDs.size(); i++ )
+    {
+        apsDataOrder.push_back(&asIFDs[i]);
+        for( size_t j = 0; j < asIFDs[i].anByteCounts.size(); j++ )
+            dfTotalBytes += static_cast<double>(asIFDs[i].anByteCounts[j]);
+    }
+    std::stable_sort(apsDataOrder.begin(), apsDataOrder.end(),
+                     GTiffCOGDataOrderLess);
+
+    std::vector<GByte> abyBuffer;
+    double dfBytesDone = 0;
+    for( size_t i = 0; i < apsDataOrder.size(); i++ )
+    {
+        const GTiffCOGIFD& sIFD = *(apsDataOrder[i]);
+        for( size_t j = 0; j < sIFD.anOffsets.size(); j++ )
+        {
+            const size_t nSize = static_cast<size_t>(sIFD.anByteCounts[j]);
+            if( nSize == 0 )
+                continue;
+
+            CPLAssert(nDstPos + 4 == sIFD.anNewOffsets[j]);
+            if( abyBuffer.size() < nSize )
+                abyBuffer.resize(nSize);
+            if( VSIFSeekL(fpSrc, sIFD.anOffsets[j], SEEK_SET) != 0 ||
+                VSIFReadL(&abyBuffer[0], 1, nSize, fpSrc) != nSize )
+            {
+                CPLError(CE_Failure, CPLE_FileIO,
+                         "Cannot read strip/tile at offset " CPL_FRMT_GUIB,
+                         sIFD.anOffsets[j]);
+                return false;
+            }
+
+            /* Leader: size of the block as a little-endian uint32 */
+            GUInt32 nLeader = static_cast<GUInt32>(nSize);
+            CPL_LSBPTR32(&nLeader);
+
+            /* Trailer: last 4 bytes of the block repeated */
+            GByte abyTrailer[4] = { 0, 0, 0, 0 };
+            const size_t nTrailerSize = std::min(nSize, static_cast<size_t>(4));
+            memcpy(abyTrailer + 4 - nTrailerSize,
+                   &abyBuffer[0] + nSize - nTrailerSize, nTrailerSize);
+
+            if( !Write(&nLeader, 4) ||
+                !Write(&abyBuffer[0], nSize) ||
+                !Write(abyTrailer, 4) )
+                return false;
+
+            dfBytesDone += static_cast<double>(nSize);
+            if( pfnProgress && dfTotalBytes > 0 &&
+                !pfnProgress(dfBytesDone / dfTotalBytes, NULL, pProgressData) )
+            {
+                CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                                Run()                                 */
+/************************************************************************/
+
+CPLErr GTiffCOGRewriter::Run(GDALProgressFunc pfnProgress,
+                             void * pProgressData)
+{
+    if( !ReadIFDs() )
+        return CE_Failure;
+
+/* -------------------------------------------------------------------- */
+/*      Structural metadata put just after the header, so that readers  */
+/*      can find out the layout from the first bytes of the file.       */
+/* -------------------------------------------------------------------- */
+    CPLString osContent(
+        "LAYOUT=IFDS_BEFORE_DATA\n"
+        "BLOCK_ORDER=ROW_MAJOR\n"
+        "BLOCK_LEADER=SIZE_AS_UINT4\n"
+        "BLOCK_TRAILER=LAST_4_BYTES_REPEATED\n"
+        "KNOWN_INCOMPATIBLE_EDITION=NO\n");
+    CPLString osGhostArea;
+    osGhostArea.Printf("GDAL_STRUCTURAL_METADATA_SIZE=%06d bytes\n",
+                       static_cast<int>(osContent.size()));
+    if( (osGhostArea.size() + osContent.size()) % 2 )
+        osContent += " ";
+    osGhostArea.Printf("GDAL_STRUCTURAL_METADATA_SIZE=%06d bytes\n%s",
+                       static_cast<int>(osContent.size()),
+                       osContent.c_str());
+
+    if( !ComputeLayout(osGhostArea) ||
+        !WriteIFDs(osGhostArea) ||
+        !WriteImagery(pfnProgress, pProgressData) )
+        return CE_Failure;
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                     GTIFFRewriteCloudOptimized()                     */
+/*                                                                      */
+/*      Write in pszDstFilename a copy of the TIFF file pszSrcFilename  */
+/*      where:                                                          */
+/*      - the IFDs, with their tag data, are at the beginning of the    */
+/*        file, in the order of the IFD chain;                          */
+/*      - the imagery of the smallest overview comes first and the one  */
+/*        of the full resolution image last, masks following their     */
+/*        image;                                                        */
+/*      - within an image, strips/tiles are in row-major order, each    */
+/*        one with a leader giving its size and a trailer repeating its */
+/*        last 4 bytes.                                                 */
+/*      The destination is written sequentially.                       */
+/************************************************************************/
+
+CPLErr GTIFFRewriteCloudOptimized( const char* pszSrcFilename,
+                                   const char* pszDstFilename,
+                                   GDALProgressFunc pfnProgress,
+                                   void * pProgressData )
+{
+    VSILFILE* fpSrc = VSIFOpenL(pszSrcFilename, "rb");
+    if( fpSrc == NULL )
+    {
+        CPLError(CE_Failure, CPLE_OpenFailed, "Cannot open %s",
+                 pszSrcFilename);
+        return CE_Failure;
+    }
+    VSILFILE* fpDst = VSIFOpenL(pszDstFilename, "wb");
+    if( fpDst == NULL )
+    {
+        CPLError(CE_Failure, CPLE_OpenFailed, "Cannot create %s",
+                 pszDstFilename);
+        CPL_IGNORE_RET_VAL(VSIFCloseL(fpSrc));
+        return CE_Failure;
+    }
+
+    GTiffCOGRewriter oRewriter(fpSrc, fpDst);
+    CPLErr eErr = oRewriter.Run(pfnProgress, pProgressData);
+
+    CPL_IGNORE_RET_VAL(VSIFCloseL(fpSrc));
+    if( VSIFCloseL(fpDst) != 0 )
+        eErr = CE_Failure;
+    return eErr;
+}
@@ -58,7 +58,8 @@ toff_t GTIFFWriteDirectory(TIFF *hTIFF, int nSubfileType, int nXSize, int nYSize
                            unsigned short *panBlue,
                            int nExtraSamples,
                            unsigned short *panExtraSampleValues,
-                           const char *pszMetadata )
+                           const char *pszMetadata,
+                           const uint32 *panLercParams )
 
 {
     toff_t nBaseDirOffset;
@@ -108,9 +109,14 @@ toff_t GTIFFWriteDirectory(TIFF *hTIFF, int nSubfileType, int nXSize, int nYSize
     }
 
     if ( nCompressFlag == COMPRESSION_LZW ||
-         nCompressFlag == COMPRESSION_ADOBE_DEFLATE )
+         nCompressFlag == COMPRESSION_ADOBE_DEFLATE ||
+         nCompressFlag == COMPRESSION_ZSTD )
         TIFFSetField( hTIFF, TIFFTAG_PREDICTOR, nPredictor );
 
+    /* The additional compression is recorded in each LERC IFD */
+    if( nCompressFlag == COMPRESSION_LERC && panLercParams != NULL )
+        TIFFSetField( hTIFF, TIFFTAG_LERC_PARAMETERS, 2, panLercParams );
+
 /* -------------------------------------------------------------------- */
 /*      Write color table if one is present.                            */
 /* -------------------------------------------------------------------- */
@@ -339,6 +345,15 @@ GTIFFBuildOverviews( const char * pszFilename,
             return CE_Failure;
     }
 
+    uint32 anLercParams[2] = { LERC_VERSION_2, LERC_ADD_COMPRESSION_NONE };
+    if( nCompression == COMPRESSION_LERC )
+    {
+        if( EQUAL(pszCompress, "LERC_DEFLATE") )
+            anLercParams[1] = LERC_ADD_COMPRESSION_DEFLATE;
+        else if( EQUAL(pszCompress, "LERC_ZSTD") )
+            anLercParams[1] = LERC_ADD_COMPRESSION_ZSTD;
+    }
+
     if( nCompression == COMPRESSION_JPEG && nBitsPerPixel > 8 )
     {
         if( nBitsPerPixel > 16 )
@@ -465,7 +480,8 @@ GTIFFBuildOverviews( const char * pszFilename,
 /* -------------------------------------------------------------------- */
     int nPredictor = PREDICTOR_NONE;
     if ( nCompression == COMPRESSION_LZW ||
-         nCompression == COMPRESSION_ADOBE_DEFLATE )
+         nCompression == COMPRESSION_ADOBE_DEFLATE ||
+         nCompression == COMPRESSION_ZSTD )
     {
         const char* pszPredictor = CPLGetConfigOption( "PREDICTOR_OVERVIEW", NULL );
         if( pszPredictor  != NULL )
@@ -669,7 +685,7 @@ GTIFFBuildOverviews( const char * pszFilename,
                             nPhotometric, nSampleFormat, nPredictor,
                             panRed, panGreen, panBlue,
                             0, NULL, /* FIXME? how can we fetch extrasamples */
-                            osMetadata );
+                            osMetadata, anLercParams );
     }
 
     if (panRed)
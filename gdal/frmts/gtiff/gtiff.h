@@ -76,4 +76,27 @@ char** GTiffDatasetReadRPCTag( TIFF *hTIFF );
 #define TIFFTAG_LZMAPRESET      65562   /* LZMA2 preset (compression level) */
 #endif
 
+#if !defined(COMPRESSION_ZSTD)
+#define     COMPRESSION_ZSTD        50000   /* ZSTD */
+#endif
+
+#if !defined(TIFFTAG_ZSTD_LEVEL)
+#define TIFFTAG_ZSTD_LEVEL      65564   /* ZSTD compression level */
+#endif
+
+#if !defined(COMPRESSION_LERC)
+#define     COMPRESSION_LERC        34887   /* ESRI Lerc codec */
+#endif
+
+#if !defined(TIFFTAG_LERC_PARAMETERS)
+#define TIFFTAG_LERC_PARAMETERS         50674   /* LERC version and additional compression */
+#define TIFFTAG_LERC_VERSION            65565   /* LERC version */
+#define     LERC_VERSION_2              2
+#define TIFFTAG_LERC_ADD_COMPRESSION    65566   /* LERC additional compression */
+#define     LERC_ADD_COMPRESSION_NONE    0
+#define     LERC_ADD_COMPRESSION_DEFLATE 1
+#define     LERC_ADD_COMPRESSION_ZSTD    2
+#define TIFFTAG_LERC_MAXZERROR          65567   /* LERC maximum error */
+#endif
+
 #endif // GTIFF_H_INCLUDED
@@ -344,6 +344,7 @@
 #define TIFFFileName gdal_TIFFFileName
 #define TIFFFileno gdal_TIFFFileno
 #define _TIFFFillStriles gdal__TIFFFillStriles
+#define _TIFFPrepareStriles gdal__TIFFPrepareStriles
 #define TIFFFillStrip gdal_TIFFFillStrip
 #define TIFFFillStripPartial gdal_TIFFFillStripPartial
 #define TIFFFillTile gdal_TIFFFillTile
@@ -503,6 +504,11 @@
 #define TIFFReadEncodedStrip gdal_TIFFReadEncodedStrip
 #define TIFFReadEncodedTile gdal_TIFFReadEncodedTile
 #define TIFFReadEXIFDirectory gdal_TIFFReadEXIFDirectory
+#define TIFFReadFromUserBuffer gdal_TIFFReadFromUserBuffer
+#define TIFFGetStrileOffset gdal_TIFFGetStrileOffset
+#define TIFFGetStrileByteCount gdal_TIFFGetStrileByteCount
+#define TIFFGetStrileOffsetWithErr gdal_TIFFGetStrileOffsetWithErr
+#define TIFFGetStrileByteCountWithErr gdal_TIFFGetStrileByteCountWithErr
 #define _tiffReadProc gdal__tiffReadProc
 #define TIFFReadRawStrip gdal_TIFFReadRawStrip
 #define TIFFReadRawStrip1 gdal_TIFFReadRawStrip1
@@ -746,3 +752,9 @@
 #ifdef LZMA_SUPPORT
 #define TIFFInitLZMA gdal_TIFFInitLZMA
 #endif
+#ifdef ZSTD_SUPPORT
+#define TIFFInitZSTD gdal_TIFFInitZSTD
+#endif
+#ifdef LERC_SUPPORT
+#define TIFFInitLERC gdal_TIFFInitLERC
+#endif
@@ -258,7 +258,8 @@ extern const TIFFFieldArray* _TIFFGetExifFields(void);
 extern void _TIFFSetupFields(TIFF* tif, const TIFFFieldArray* infoarray);
 extern void _TIFFPrintFieldInfo(TIFF*, FILE*);
 
-extern int _TIFFFillStriles(TIFF*);        
+extern int _TIFFFillStriles(TIFF*);
+extern int _TIFFPrepareStriles(TIFF*);
 
 typedef enum {
 	tfiatImage,
@@ -5573,11 +5573,22 @@ int _TIFFFillStriles( TIFF *tif )
         register TIFFDirectory *td = &tif->tif_dir;
         int return_value = 1;
 
-        if( td->td_stripoffset != NULL )
-                return 1;
-
+        /* Entries are cleared once the arrays have been fully loaded */
         if( td->td_stripoffset_entry.tdir_count == 0 )
-                return 0;
+                return td->td_stripoffset != NULL;
+
+        /* Discard the values that may have been loaded on demand */
+        if( td->td_stripoffset != NULL )
+        {
+                _TIFFfree( td->td_stripoffset );
+                td->td_stripoffset = NULL;
+        }
+        if( td->td_stripbytecount != NULL &&
+            td->td_stripbytecount_entry.tdir_count != 0 )
+        {
+                _TIFFfree( td->td_stripbytecount );
+                td->td_stripbytecount = NULL;
+        }
 
         if (!TIFFFetchStripThing(tif,&(td->td_stripoffset_entry),
                                  td->td_nstrips,&td->td_stripoffset))
@@ -5614,6 +5625,253 @@ int _TIFFFillStriles( TIFF *tif )
 #endif 
 }
 
+#if defined(DEFER_STRILE_LOAD)
+
+/* Size of the blocks in which StripOffsets/StripByteCounts are read on demand */
+#define STRILE_LAZY_LOAD_BLOCK_SIZE 4096
+
+/*
+ * Return the size of the values of a StripOffsets/StripByteCounts entry
+ * whose values can be loaded on demand, or 0 if the array must be loaded
+ * as a whole.
+ */
+static int
+_TIFFLazyStrileValueSize(TIFF* tif, TIFFDirEntry* dirent)
+{
+	int sizeofval;
+
+	if (!(tif->tif_flags&TIFF_LAZYSTRILELOAD) || dirent->tdir_count == 0)
+		return 0;
+	switch (dirent->tdir_type)
+	{
+		case TIFF_SHORT:
+			sizeofval = 2;
+			break;
+		case TIFF_LONG:
+			sizeofval = 4;
+			break;
+		case TIFF_LONG8:
+			sizeofval = 8;
+			break;
+		default:
+			return 0;
+	}
+	/* Values stored in the directory entry itself */
+	if (dirent->tdir_count * sizeofval <=
+	    ((tif->tif_flags&TIFF_BIGTIFF) ? 8U : 4U))
+		return 0;
+	return sizeofval;
+}
+
+/*
+ * Load from the file the block of values of the StripOffsets or
+ * StripByteCounts array that contains the value of strile.
+ */
+static int
+_TIFFPartialReadStripArray(TIFF* tif, TIFFDirEntry* dirent, int sizeofval,
+                           uint32 strile, uint64* panVals)
+{
+	static const char module[] = "_TIFFPartialReadStripArray";
+	uint8 buffer[2 * STRILE_LAZY_LOAD_BLOCK_SIZE];
+	uint64 nBaseOffset, nOffset, nOffsetStartPage, nOffsetEndPage, nEndOffset;
+	uint64 nValues = dirent->tdir_count;
+	tmsize_t nToRead;
+	uint32 i, nFirst;
+
+	if (nValues > tif->tif_dir.td_nstrips)
+		nValues = tif->tif_dir.td_nstrips;
+	if (strile >= nValues)
+	{
+		/* Missing values, as in TIFFFetchStripThing() */
+		panVals[strile] = 0;
+		return 1;
+	}
+
+	if (tif->tif_flags&TIFF_BIGTIFF)
+	{
+		nBaseOffset = dirent->tdir_offset.toff_long8;
+		if (tif->tif_flags&TIFF_SWAB)
+			TIFFSwabLong8(&nBaseOffset);
+	}
+	else
+	{
+		uint32 nOffset32 = dirent->tdir_offset.toff_long;
+		if (tif->tif_flags&TIFF_SWAB)
+			TIFFSwabLong(&nOffset32);
+		nBaseOffset = nOffset32;
+	}
+
+	nOffset = nBaseOffset + (uint64)strile * sizeofval;
+	nOffsetStartPage = (nOffset / STRILE_LAZY_LOAD_BLOCK_SIZE) *
+	    STRILE_LAZY_LOAD_BLOCK_SIZE;
+	nOffsetEndPage = nOffsetStartPage + STRILE_LAZY_LOAD_BLOCK_SIZE;
+	if (nOffset + sizeofval > nOffsetEndPage)
+		nOffsetEndPage += STRILE_LAZY_LOAD_BLOCK_SIZE;
+	nEndOffset = nBaseOffset + nValues * sizeofval;
+	if (nEndOffset < nOffsetEndPage)
+		nOffsetEndPage = nEndOffset;
+	if (nOffsetStartPage < nBaseOffset)
+		nOffsetStartPage = nBaseOffset;
+
+	nToRead = (tmsize_t)(nOffsetEndPage - nOffsetStartPage);
+	if (!SeekOK(tif, nOffsetStartPage) ||
+	    !ReadOK(tif, buffer, nToRead))
+	{
+		TIFFErrorExt(tif->tif_clientdata, module,
+		    "Cannot read offset/size for strile %lu",
+		    (unsigned long) strile);
+		panVals[strile] = 0;
+		return 0;
+	}
+
+	nFirst = (uint32)((nOffsetStartPage - nBaseOffset + sizeofval - 1) / sizeofval);
+	for (i = nFirst;
+	     i < nValues && nBaseOffset + (uint64)(i + 1) * sizeofval <= nOffsetEndPage;
+	     i++)
+	{
+		const uint8* pabyVal = buffer +
+		    (tmsize_t)(nBaseOffset + (uint64)i * sizeofval - nOffsetStartPage);
+		if (sizeofval == 2)
+		{
+			uint16 val;
+			_TIFFmemcpy(&val, pabyVal, sizeof(val));
+			if (tif->tif_flags&TIFF_SWAB)
+				TIFFSwabShort(&val);
+			panVals[i] = val;
+		}
+		else if (sizeofval == 4)
+		{
+			uint32 val;
+			_TIFFmemcpy(&val, pabyVal, sizeof(val));
+			if (tif->tif_flags&TIFF_SWAB)
+				TIFFSwabLong(&val);
+			panVals[i] = val;
+		}
+		else
+		{
+			uint64 val;
+			_TIFFmemcpy(&val, pabyVal, sizeof(val));
+			if (tif->tif_flags&TIFF_SWAB)
+				TIFFSwabLong8(&val);
+			panVals[i] = val;
+		}
+	}
+	return 1;
+}
+
+#endif /* defined(DEFER_STRILE_LOAD) */
+
+/*
+ * Return the value of the StripOffsets or StripByteCounts array for strile.
+ * In lazy loading mode, only the block of values containing it is loaded
+ * from the file if needed.  Not yet loaded values are marked with
+ * ~(uint64)0.
+ */
+static uint64
+_TIFFGetStrileOffsetOrByteCountValue(TIFF *tif, uint32 strile,
+                                     TIFFDirEntry* dirent, uint64** parray,
+                                     int *pbErr)
+{
+	static const char module[] = "_TIFFGetStrileOffsetOrByteCountValue";
+	TIFFDirectory *td = &tif->tif_dir;
+#if defined(DEFER_STRILE_LOAD)
+	int sizeofval;
+#endif
+
+	if (pbErr)
+		*pbErr = 0;
+	if (strile >= td->td_nstrips)
+	{
+		TIFFErrorExt(tif->tif_clientdata, module,
+		    "%lu: Strip/tile out of range, max %lu",
+		    (unsigned long) strile, (unsigned long) td->td_nstrips);
+		if (pbErr)
+			*pbErr = 1;
+		return 0;
+	}
+
+#if defined(DEFER_STRILE_LOAD)
+	sizeofval = _TIFFLazyStrileValueSize(tif, dirent);
+	if (sizeofval != 0)
+	{
+		if (*parray == NULL)
+		{
+			*parray = (uint64*)_TIFFCheckMalloc(tif, td->td_nstrips,
+			    sizeof(uint64), "for strip array");
+			if (*parray == NULL)
+			{
+				if (pbErr)
+					*pbErr = 1;
+				return 0;
+			}
+			_TIFFmemset(*parray, 0xFF, td->td_nstrips * sizeof(uint64));
+		}
+		if (~((*parray)[strile]) == 0 &&
+		    !_TIFFPartialReadStripArray(tif, dirent, sizeofval, strile, *parray))
+		{
+			if (pbErr)
+				*pbErr = 1;
+			return 0;
+		}
+		return (*parray)[strile];
+	}
+#else
+	(void) dirent;
+#endif
+
+	if (!_TIFFFillStriles(tif) || *parray == NULL)
+	{
+		if (pbErr)
+			*pbErr = 1;
+		return 0;
+	}
+	return (*parray)[strile];
+}
+
+uint64
+TIFFGetStrileOffsetWithErr(TIFF *tif, uint32 strile, int *pbErr)
+{
+	TIFFDirectory *td = &tif->tif_dir;
+	return _TIFFGetStrileOffsetOrByteCountValue(tif, strile,
+	    &(td->td_stripoffset_entry), &(td->td_stripoffset), pbErr);
+}
+
+uint64
+TIFFGetStrileOffset(TIFF *tif, uint32 strile)
+{
+	return TIFFGetStrileOffsetWithErr(tif, strile, NULL);
+}
+
+uint64
+TIFFGetStrileByteCountWithErr(TIFF *tif, uint32 strile, int *pbErr)
+{
+	TIFFDirectory *td = &tif->tif_dir;
+	return _TIFFGetStrileOffsetOrByteCountValue(tif, strile,
+	    &(td->td_stripbytecount_entry), &(td->td_stripbytecount), pbErr);
+}
+
+uint64
+TIFFGetStrileByteCount(TIFF *tif, uint32 strile)
+{
+	return TIFFGetStrileByteCountWithErr(tif, strile, NULL);
+}
+
+/*
+ * Make sure that the values of the StripOffsets/StripByteCounts arrays can
+ * be retrieved with TIFFGetStrileOffset()/TIFFGetStrileByteCount(). In lazy
+ * loading mode, they are not loaded by this function.
+ */
+int _TIFFPrepareStriles( TIFF *tif )
+{
+#if defined(DEFER_STRILE_LOAD)
+	TIFFDirectory *td = &tif->tif_dir;
+	if (_TIFFLazyStrileValueSize(tif, &(td->td_stripoffset_entry)) != 0 &&
+	    _TIFFLazyStrileValueSize(tif, &(td->td_stripbytecount_entry)) != 0)
+		return 1;
+#endif
+	return _TIFFFillStriles(tif) && tif->tif_dir.td_stripbytecount != NULL;
+}
+
 
 /* vim: set ts=8 sts=8 sw=8 noet: */
 /*
@@ -0,0 +1,1033 @@
+/* $Id$ */
+
+/*
+ * Copyright (c) 2016, The GDAL project
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+#include "tiffiop.h"
+#ifdef LERC_SUPPORT
+/*
+ * TIFF Library.
+ *
+ * LERC Compression Support
+ *
+ * LERC (Limited Error Raster Compression) is a lossless or error-bounded
+ * codec for integer and floating point rasters. It uses the Lerc2 library
+ * bundled with the MRF driver (frmts/mrf/libLERC), which is why this codec
+ * is written in C++.
+ *
+ * A strip or tile is decoded or encoded as a whole, as a single standard
+ * Lerc2 blob, which may optionally be compressed again with Deflate or ZSTD,
+ * as recorded by the TIFFTAG_LERC_PARAMETERS tag. NaN values of floating
+ * point data are stored through the Lerc2 validity mask.
+ *
+ * The bundled Lerc2 version only encodes one value per pixel, and has no
+ * notion of several interleaved dimensions. Images with more than one sample
+ * per pixel must thus use PLANARCONFIG_SEPARATE: PLANARCONFIG_CONTIG is
+ * rejected in that case, rather than written in a layout other LERC readers
+ * would not understand.
+ */
+
+#include "Lerc2.h"
+
+#ifdef ZIP_SUPPORT
+#include "zlib.h"
+#endif
+#ifdef ZSTD_SUPPORT
+#include "zstd.h"
+#endif
+
+#include <vector>
+
+USING_NAMESPACE_LERC
+
+/*
+ * State block for each open TIFF file using LERC compression/decompression.
+ */
+typedef struct {
+	double          maxzerror;		/* max z error */
+	int             lerc_version;
+	int             additional_compression;
+	int             zipquality;		/* deflate compression level */
+	int             zstd_compressionlevel;	/* zstd compression level */
+
+	int             state;			/* state flags */
+#define LSTATE_INIT_DECODE 0x01
+#define LSTATE_INIT_ENCODE 0x02
+
+	uint32          segment_width;
+	uint32          segment_height;
+
+	uint8*          uncompressed_buffer;
+	tmsize_t        uncompressed_alloc;	/* size of uncompressed_buffer */
+	tmsize_t        uncompressed_size;	/* bytes of the strip/tile */
+	tmsize_t        uncompressed_offset;	/* bytes consumed or produced */
+
+	TIFFVGetMethod  vgetparent;            /* super-class method */
+	TIFFVSetMethod  vsetparent;            /* super-class method */
+} LERCState;
+
+#define LState(tif)             ((LERCState*) (tif)->tif_data)
+#define DecoderState(tif)       LState(tif)
+#define EncoderState(tif)       LState(tif)
+
+static int LERCEncode(TIFF* tif, uint8* bp, tmsize_t cc, uint16 s);
+static int LERCDecode(TIFF* tif, uint8* op, tmsize_t occ, uint16 s);
+
+/*
+ * Return the number of bytes per sample, or 0 if the sample format is not
+ * handled by Lerc2.
+ */
+static int
+LERCGetSampleSize(TIFF* tif)
+{
+	TIFFDirectory *td = &tif->tif_dir;
+
+	switch (td->td_sampleformat) {
+	case SAMPLEFORMAT_UINT:
+	case SAMPLEFORMAT_INT:
+		if (td->td_bitspersample == 8 || td->td_bitspersample == 16 ||
+		    td->td_bitspersample == 32)
+			return td->td_bitspersample / 8;
+		break;
+	case SAMPLEFORMAT_IEEEFP:
+		if (td->td_bitspersample == 32 || td->td_bitspersample == 64)
+			return td->td_bitspersample / 8;
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+/*
+ * Check that the strips/tiles hold a single sample per pixel.
+ */
+static int
+LERCCheckPlanarConfig(TIFF* tif, const char* module)
+{
+	TIFFDirectory *td = &tif->tif_dir;
+
+	if (td->td_planarconfig == PLANARCONFIG_CONTIG &&
+	    td->td_samplesperpixel > 1) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC compression of several samples per pixel "
+			     "requires PlanarConfiguration=Separate");
+		return 0;
+	}
+	return 1;
+}
+
+static int
+LERCFixupTags(TIFF* tif)
+{
+	(void) tif;
+	return 1;
+}
+
+static int
+LERCSetupDecode(TIFF* tif)
+{
+	static const char module[] = "LERCSetupDecode";
+	LERCState* sp = DecoderState(tif);
+
+	assert(sp != NULL);
+
+	if (LERCGetSampleSize(tif) == 0) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Unsupported combination of SampleFormat and "
+			     "BitsPerSample");
+		return 0;
+	}
+	if (!LERCCheckPlanarConfig(tif, module))
+		return 0;
+
+	sp->state = LSTATE_INIT_DECODE;
+	return 1;
+}
+
+/*
+ * Allocate the buffer holding a whole uncompressed strip or tile, and
+ * compute its dimensions.
+ */
+static int
+LERCSetupSegment(TIFF* tif, const char* module)
+{
+	LERCState* sp = LState(tif);
+	TIFFDirectory *td = &tif->tif_dir;
+	tmsize_t size;
+
+	if (isTiled(tif)) {
+		sp->segment_width = td->td_tilewidth;
+		sp->segment_height = td->td_tilelength;
+		size = TIFFTileSize(tif);
+	} else {
+		sp->segment_width = td->td_imagewidth;
+		sp->segment_height = td->td_rowsperstrip;
+		if (sp->segment_height > td->td_imagelength - tif->tif_row)
+			sp->segment_height = td->td_imagelength - tif->tif_row;
+		size = TIFFVStripSize(tif, sp->segment_height);
+	}
+	if (size == 0)
+		return 0;
+
+	if (sp->uncompressed_alloc < size) {
+		_TIFFfree(sp->uncompressed_buffer);
+		sp->uncompressed_buffer = (uint8*) _TIFFmalloc(size);
+		if (sp->uncompressed_buffer == NULL) {
+			sp->uncompressed_alloc = 0;
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Cannot allocate buffer");
+			return 0;
+		}
+		sp->uncompressed_alloc = size;
+	}
+	sp->uncompressed_size = size;
+	sp->uncompressed_offset = 0;
+	return 1;
+}
+
+/*
+ * Convert between the byte order of the file and the native one, which is
+ * the one used by Lerc2. libtiff swabs after decoding and before encoding.
+ */
+static void
+LERCSwab(TIFF* tif, uint8* buf, tmsize_t cc)
+{
+	if (!(tif->tif_flags & TIFF_SWAB))
+		return;
+	switch (tif->tif_dir.td_bitspersample) {
+	case 16:
+		TIFFSwabArrayOfShort((uint16*) buf, cc / 2);
+		break;
+	case 32:
+		TIFFSwabArrayOfLong((uint32*) buf, cc / 4);
+		break;
+	case 64:
+		TIFFSwabArrayOfDouble((double*) buf, cc / 8);
+		break;
+	default:
+		break;
+	}
+}
+
+template<class T> static bool
+LERCIsNaN(T)
+{
+	return false;
+}
+
+template<> bool
+LERCIsNaN<float>(float v)
+{
+	return v != v;
+}
+
+template<> bool
+LERCIsNaN<double>(double v)
+{
+	return v != v;
+}
+
+template<class T> static T
+LERCNaN()
+{
+	return 0;
+}
+
+template<> float
+LERCNaN<float>()
+{
+	const uint32 bits = 0x7FC00000U;
+	float v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+template<> double
+LERCNaN<double>()
+{
+	const uint64 bits = ((uint64) 0x7FF80000U) << 32;
+	double v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+/*
+ * Decode the Lerc2 blob of a strip/tile.
+ */
+template<class T> static int
+LERCDecodeSamples(TIFF* tif, Lerc2::DataType dt, const Byte* src,
+		  size_t src_size)
+{
+	static const char module[] = "LERCDecode";
+	LERCState* sp = DecoderState(tif);
+	const int w = (int) sp->segment_width;
+	const int h = (int) sp->segment_height;
+	const size_t npixels = (size_t) w * h;
+	T* out = (T*) sp->uncompressed_buffer;
+	const Byte* ptr = src;
+	Lerc2 lerc2;
+	Lerc2::HeaderInfo hdInfo;
+	BitMask2 bitMask(w, h);
+	size_t i;
+
+	if (src_size < lerc2.ComputeNumBytesHeader() ||
+	    !lerc2.GetHeaderInfo(ptr, hdInfo) ||
+	    hdInfo.nCols != w || hdInfo.nRows != h ||
+	    hdInfo.dt != dt ||
+	    hdInfo.blobSize <= 0 ||
+	    (size_t) hdInfo.blobSize > src_size) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Invalid LERC blob");
+		return 0;
+	}
+	if (!lerc2.Decode(&ptr, out, bitMask.Bits())) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC decoding failed");
+		return 0;
+	}
+	if (hdInfo.numValidPixel != w * h) {
+		for (i = 0; i < npixels; i++)
+			if (!bitMask.IsValid((int) i))
+				out[i] = LERCNaN<T>();
+	}
+	return 1;
+}
+
+/*
+ * Undo the additional compression, if any, of the raw strip/tile data.
+ */
+static int
+LERCUncompressAdditional(TIFF* tif, std::vector<Byte>& out)
+{
+	static const char module[] = "LERCPreDecode";
+	LERCState* sp = DecoderState(tif);
+	size_t out_size = (size_t) sp->uncompressed_size + 4096;
+
+	if (sp->additional_compression == LERC_ADD_COMPRESSION_DEFLATE) {
+#ifdef ZIP_SUPPORT
+		z_stream strm;
+		int zret;
+
+		memset(&strm, 0, sizeof(strm));
+		if (inflateInit(&strm) != Z_OK) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "inflateInit() failed");
+			return 0;
+		}
+		strm.next_in = tif->tif_rawcp;
+		strm.avail_in = (uInt) tif->tif_rawcc;
+		out.resize(out_size);
+		do {
+			strm.next_out = &out[0] + strm.total_out;
+			strm.avail_out = (uInt) (out.size() - strm.total_out);
+			zret = inflate(&strm, Z_NO_FLUSH);
+			if (zret == Z_OK && strm.avail_out == 0)
+				out.resize(out.size() * 2);
+			else if (zret != Z_OK)
+				break;
+		} while (1);
+		out.resize(strm.total_out);
+		inflateEnd(&strm);
+		if (zret != Z_STREAM_END) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Decoding error in Deflate stream");
+			return 0;
+		}
+		return 1;
+#else
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC_ADD_COMPRESSION_DEFLATE requested, but "
+			     "Deflate support is not available");
+		return 0;
+#endif
+	}
+	if (sp->additional_compression == LERC_ADD_COMPRESSION_ZSTD) {
+#ifdef ZSTD_SUPPORT
+		ZSTD_DStream* dstream = ZSTD_createDStream();
+		ZSTD_inBuffer in_buffer;
+		ZSTD_outBuffer out_buffer;
+		size_t zstd_ret;
+
+		if (dstream == NULL) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Cannot allocate decompression stream");
+			return 0;
+		}
+		ZSTD_initDStream(dstream);
+		in_buffer.src = tif->tif_rawcp;
+		in_buffer.size = (size_t) tif->tif_rawcc;
+		in_buffer.pos = 0;
+		out.resize(out_size);
+		out_buffer.pos = 0;
+		do {
+			out_buffer.dst = &out[0];
+			out_buffer.size = out.size();
+			zstd_ret = ZSTD_decompressStream(dstream, &out_buffer,
+							 &in_buffer);
+			if (ZSTD_isError(zstd_ret))
+				break;
+			if (zstd_ret != 0 && out_buffer.pos == out_buffer.size)
+				out.resize(out.size() * 2);
+		} while (zstd_ret != 0 && (in_buffer.pos < in_buffer.size ||
+					   out_buffer.pos == out_buffer.size));
+		ZSTD_freeDStream(dstream);
+		if (ZSTD_isError(zstd_ret) || zstd_ret != 0) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Decoding error in ZSTD stream");
+			return 0;
+		}
+		out.resize(out_buffer.pos);
+		return 1;
+#else
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC_ADD_COMPRESSION_ZSTD requested, but "
+			     "ZSTD support is not available");
+		return 0;
+#endif
+	}
+	if (sp->additional_compression != LERC_ADD_COMPRESSION_NONE) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Unhandled additional compression %d",
+			     sp->additional_compression);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Decode a whole strip/tile.
+ */
+static int
+LERCPreDecode(TIFF* tif, uint16 s)
+{
+	static const char module[] = "LERCPreDecode";
+	LERCState* sp = DecoderState(tif);
+	std::vector<Byte> uncompressed;
+	const Byte* src = (const Byte*) tif->tif_rawcp;
+	size_t src_size = (size_t) tif->tif_rawcc;
+	int ok = 0;
+
+	(void) s;
+	assert(sp != NULL);
+
+	if (sp->state != LSTATE_INIT_DECODE)
+		tif->tif_setupdecode(tif);
+
+	if (sp->lerc_version != LERC_VERSION_2) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Unsupported LERC version %d", sp->lerc_version);
+		return 0;
+	}
+
+	if (!LERCSetupSegment(tif, module))
+		return 0;
+
+	if (sp->additional_compression != LERC_ADD_COMPRESSION_NONE) {
+		if (!LERCUncompressAdditional(tif, uncompressed))
+			return 0;
+		if (uncompressed.empty()) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Empty LERC stream");
+			return 0;
+		}
+		src = &uncompressed[0];
+		src_size = uncompressed.size();
+	}
+
+	switch (tif->tif_dir.td_sampleformat) {
+	case SAMPLEFORMAT_UINT:
+		switch (tif->tif_dir.td_bitspersample) {
+		case 8:
+			ok = LERCDecodeSamples<Byte>(tif, Lerc2::DT_Byte,
+						     src, src_size);
+			break;
+		case 16:
+			ok = LERCDecodeSamples<unsigned short>(tif,
+			    Lerc2::DT_UShort, src, src_size);
+			break;
+		case 32:
+			ok = LERCDecodeSamples<unsigned int>(tif,
+			    Lerc2::DT_UInt, src, src_size);
+			break;
+		}
+		break;
+	case SAMPLEFORMAT_INT:
+		switch (tif->tif_dir.td_bitspersample) {
+		case 8:
+			ok = LERCDecodeSamples<char>(tif, Lerc2::DT_Char,
+						     src, src_size);
+			break;
+		case 16:
+			ok = LERCDecodeSamples<short>(tif, Lerc2::DT_Short,
+						      src, src_size);
+			break;
+		case 32:
+			ok = LERCDecodeSamples<int>(tif, Lerc2::DT_Int,
+						    src, src_size);
+			break;
+		}
+		break;
+	case SAMPLEFORMAT_IEEEFP:
+		if (tif->tif_dir.td_bitspersample == 32)
+			ok = LERCDecodeSamples<float>(tif, Lerc2::DT_Float,
+						      src, src_size);
+		else
+			ok = LERCDecodeSamples<double>(tif, Lerc2::DT_Double,
+						       src, src_size);
+		break;
+	}
+	if (!ok)
+		return 0;
+
+	LERCSwab(tif, sp->uncompressed_buffer, sp->uncompressed_size);
+	return 1;
+}
+
+static int
+LERCDecode(TIFF* tif, uint8* op, tmsize_t occ, uint16 s)
+{
+	static const char module[] = "LERCDecode";
+	LERCState* sp = DecoderState(tif);
+
+	(void) s;
+	assert(sp != NULL);
+	assert(sp->state == LSTATE_INIT_DECODE);
+
+	if (occ > sp->uncompressed_size - sp->uncompressed_offset) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+		    "Not enough data at scanline %lu (short %lu bytes)",
+		    (unsigned long) tif->tif_row,
+		    (unsigned long) (occ - (sp->uncompressed_size -
+					    sp->uncompressed_offset)));
+		return 0;
+	}
+
+	_TIFFmemcpy(op, sp->uncompressed_buffer + sp->uncompressed_offset,
+		    occ);
+	sp->uncompressed_offset += occ;
+
+	return 1;
+}
+
+static int
+LERCSetupEncode(TIFF* tif)
+{
+	static const char module[] = "LERCSetupEncode";
+	LERCState* sp = EncoderState(tif);
+
+	assert(sp != NULL);
+
+	if (LERCGetSampleSize(tif) == 0) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Unsupported combination of SampleFormat and "
+			     "BitsPerSample");
+		return 0;
+	}
+	if (!LERCCheckPlanarConfig(tif, module))
+		return 0;
+
+	sp->state = LSTATE_INIT_ENCODE;
+	return 1;
+}
+
+/*
+ * Reset encoding state at the start of a strip.
+ */
+static int
+LERCPreEncode(TIFF* tif, uint16 s)
+{
+	static const char module[] = "LERCPreEncode";
+	LERCState *sp = EncoderState(tif);
+
+	(void) s;
+	assert(sp != NULL);
+	if (sp->state != LSTATE_INIT_ENCODE)
+		tif->tif_setupencode(tif);
+
+	return LERCSetupSegment(tif, module);
+}
+
+/*
+ * Accumulate a chunk of pixels.
+ */
+static int
+LERCEncode(TIFF* tif, uint8* bp, tmsize_t cc, uint16 s)
+{
+	static const char module[] = "LERCEncode";
+	LERCState *sp = EncoderState(tif);
+
+	(void) s;
+	assert(sp != NULL);
+	assert(sp->state == LSTATE_INIT_ENCODE);
+
+	if (cc > sp->uncompressed_size - sp->uncompressed_offset) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Too many bytes to be written");
+		return 0;
+	}
+
+	_TIFFmemcpy(sp->uncompressed_buffer + sp->uncompressed_offset,
+		    bp, cc);
+	sp->uncompressed_offset += cc;
+
+	return 1;
+}
+
+/*
+ * Encode the accumulated strip/tile as a Lerc2 blob.
+ */
+template<class T> static int
+LERCEncodeSamples(TIFF* tif, uint32 h, std::vector<Byte>& out)
+{
+	static const char module[] = "LERCPostEncode";
+	LERCState* sp = EncoderState(tif);
+	const int w = (int) sp->segment_width;
+	const size_t npixels = (size_t) w * h;
+	const T* src = (const T*) sp->uncompressed_buffer;
+	Lerc2 lerc2;
+	BitMask2 bitMask(w, (int) h);
+	int nvalid = 0;
+	unsigned int blob_size;
+	size_t i;
+	Byte* ptr;
+
+	/*
+	 * Start from an all invalid mask, so that the padding bits
+	 * of the last byte are not counted as valid pixels.
+	 */
+	bitMask.SetAllInvalid();
+	for (i = 0; i < npixels; i++) {
+		if (!LERCIsNaN(src[i])) {
+			bitMask.SetValid((int) i);
+			nvalid++;
+		}
+	}
+	if ((size_t) nvalid == npixels)
+		lerc2.Set(w, (int) h);
+	else
+		lerc2.Set(bitMask);
+
+	blob_size = lerc2.ComputeNumBytesNeededToWrite(
+	    src, sp->maxzerror, (size_t) nvalid != npixels);
+	if (blob_size == 0) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC encoding failed");
+		return 0;
+	}
+
+	out.resize(blob_size + Lerc2::NumExtraBytesToAllocate());
+	ptr = &out[0];
+	if (!lerc2.Encode(src, &ptr) ||
+	    (size_t)(ptr - &out[0]) != blob_size) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC encoding failed");
+		return 0;
+	}
+	out.resize(blob_size);
+	return 1;
+}
+
+/*
+ * Apply the additional compression, if any, to the Lerc2 blob.
+ */
+static int
+LERCCompressAdditional(TIFF* tif, const std::vector<Byte>& in,
+		       std::vector<Byte>& out)
+{
+	static const char module[] = "LERCPostEncode";
+	LERCState* sp = EncoderState(tif);
+
+	if (sp->additional_compression == LERC_ADD_COMPRESSION_DEFLATE) {
+#ifdef ZIP_SUPPORT
+		uLongf out_size = compressBound((uLong) in.size());
+		int level = sp->zipquality >= 0 ? sp->zipquality :
+		    Z_DEFAULT_COMPRESSION;
+
+		out.resize(out_size);
+		if (compress2(&out[0], &out_size, &in[0], (uLong) in.size(),
+			      level) != Z_OK) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Encoder error in Deflate stream");
+			return 0;
+		}
+		out.resize(out_size);
+		return 1;
+#else
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC_ADD_COMPRESSION_DEFLATE requested, but "
+			     "Deflate support is not available");
+		return 0;
+#endif
+	}
+	if (sp->additional_compression == LERC_ADD_COMPRESSION_ZSTD) {
+#ifdef ZSTD_SUPPORT
+		size_t zstd_ret;
+
+		out.resize(ZSTD_compressBound(in.size()));
+		zstd_ret = ZSTD_compress(&out[0], out.size(), &in[0],
+					 in.size(),
+					 sp->zstd_compressionlevel);
+		if (ZSTD_isError(zstd_ret)) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Error in ZSTD_compress(): %s",
+				     ZSTD_getErrorName(zstd_ret));
+			return 0;
+		}
+		out.resize(zstd_ret);
+		return 1;
+#else
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "LERC_ADD_COMPRESSION_ZSTD requested, but "
+			     "ZSTD support is not available");
+		return 0;
+#endif
+	}
+	out = in;
+	return 1;
+}
+
+/*
+ * Finish off an encoded strip by compressing and flushing it.
+ */
+static int
+LERCPostEncode(TIFF* tif)
+{
+	static const char module[] = "LERCPostEncode";
+	LERCState *sp = EncoderState(tif);
+	TIFFDirectory *td = &tif->tif_dir;
+	std::vector<Byte> blob;
+	std::vector<Byte> compressed;
+	tmsize_t row_size;
+	uint32 h;
+	size_t pos;
+	int ok = 0;
+
+	row_size = (tmsize_t) sp->segment_width * LERCGetSampleSize(tif);
+	if (row_size == 0 || (sp->uncompressed_offset % row_size) != 0) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Unexpected number of bytes in the strip/tile");
+		return 0;
+	}
+	h = (uint32) (sp->uncompressed_offset / row_size);
+
+	LERCSwab(tif, sp->uncompressed_buffer, sp->uncompressed_offset);
+
+	switch (td->td_sampleformat) {
+	case SAMPLEFORMAT_UINT:
+		switch (td->td_bitspersample) {
+		case 8:
+			ok = LERCEncodeSamples<Byte>(tif, h, blob);
+			break;
+		case 16:
+			ok = LERCEncodeSamples<unsigned short>(tif, h, blob);
+			break;
+		case 32:
+			ok = LERCEncodeSamples<unsigned int>(tif, h, blob);
+			break;
+		}
+		break;
+	case SAMPLEFORMAT_INT:
+		switch (td->td_bitspersample) {
+		case 8:
+			ok = LERCEncodeSamples<char>(tif, h, blob);
+			break;
+		case 16:
+			ok = LERCEncodeSamples<short>(tif, h, blob);
+			break;
+		case 32:
+			ok = LERCEncodeSamples<int>(tif, h, blob);
+			break;
+		}
+		break;
+	case SAMPLEFORMAT_IEEEFP:
+		if (td->td_bitspersample == 32)
+			ok = LERCEncodeSamples<float>(tif, h, blob);
+		else
+			ok = LERCEncodeSamples<double>(tif, h, blob);
+		break;
+	}
+	if (!ok || !LERCCompressAdditional(tif, blob, compressed))
+		return 0;
+
+	/* Copy the result to the raw data buffer, flushing it as needed */
+	pos = 0;
+	while (pos < compressed.size()) {
+		tmsize_t n = tif->tif_rawdatasize - tif->tif_rawcc;
+		if ((size_t) n > compressed.size() - pos)
+			n = (tmsize_t) (compressed.size() - pos);
+		_TIFFmemcpy(tif->tif_rawcp, &compressed[pos], n);
+		tif->tif_rawcp += n;
+		tif->tif_rawcc += n;
+		pos += n;
+		if (tif->tif_rawcc >= tif->tif_rawdatasize &&
+		    !TIFFFlushData1(tif))
+			return 0;
+	}
+	return 1;
+}
+
+static void
+LERCCleanup(TIFF* tif)
+{
+	LERCState* sp = LState(tif);
+
+	assert(sp != 0);
+
+	tif->tif_tagmethods.vgetfield = sp->vgetparent;
+	tif->tif_tagmethods.vsetfield = sp->vsetparent;
+
+	_TIFFfree(sp->uncompressed_buffer);
+	_TIFFfree(sp);
+	tif->tif_data = NULL;
+
+	_TIFFSetDefaultCompressionState(tif);
+}
+
+/*
+ * Forward a tag value to the parent set field method.
+ */
+static int
+LERCVSetParent(TIFF* tif, uint32 tag, ...)
+{
+	LERCState* sp = LState(tif);
+	va_list ap;
+	int status;
+
+	va_start(ap, tag);
+	status = (*sp->vsetparent)(tif, tag, ap);
+	va_end(ap);
+	return status;
+}
+
+/*
+ * Record the LERC version and additional compression in the file.
+ */
+static int
+LERCUpdateParameters(TIFF* tif)
+{
+	LERCState* sp = LState(tif);
+	uint32 params[2];
+
+	params[0] = (uint32) sp->lerc_version;
+	params[1] = (uint32) sp->additional_compression;
+	return TIFFSetField(tif, TIFFTAG_LERC_PARAMETERS, 2, params);
+}
+
+static int
+LERCVSetField(TIFF* tif, uint32 tag, va_list ap)
+{
+	static const char module[] = "LERCVSetField";
+	LERCState* sp = LState(tif);
+
+	switch (tag) {
+	case TIFFTAG_LERC_PARAMETERS:
+	{
+		uint32 count = (uint32) va_arg(ap, uint32);
+		uint32* params = va_arg(ap, uint32*);
+		if (count < 2) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Invalid count for LercParameters: %u",
+				     count);
+			return 0;
+		}
+		sp->lerc_version = (int) params[0];
+		sp->additional_compression = (int) params[1];
+		return LERCVSetParent(tif, TIFFTAG_LERC_PARAMETERS, count,
+				      params);
+	}
+	case TIFFTAG_LERC_VERSION:
+	{
+		int version = (int) va_arg(ap, int);
+		if (version != LERC_VERSION_2) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Invalid value for LercVersion: %d",
+				     version);
+			return 0;
+		}
+		sp->lerc_version = version;
+		return LERCUpdateParameters(tif);
+	}
+	case TIFFTAG_LERC_ADD_COMPRESSION:
+		sp->additional_compression = (int) va_arg(ap, int);
+#ifndef ZIP_SUPPORT
+		if (sp->additional_compression ==
+		    LERC_ADD_COMPRESSION_DEFLATE) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "LERC_ADD_COMPRESSION_DEFLATE requested, "
+				     "but Deflate support is not available");
+			return 0;
+		}
+#endif
+#ifndef ZSTD_SUPPORT
+		if (sp->additional_compression == LERC_ADD_COMPRESSION_ZSTD) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "LERC_ADD_COMPRESSION_ZSTD requested, "
+				     "but ZSTD support is not available");
+			return 0;
+		}
+#endif
+		if (sp->additional_compression < LERC_ADD_COMPRESSION_NONE ||
+		    sp->additional_compression > LERC_ADD_COMPRESSION_ZSTD) {
+			TIFFErrorExt(tif->tif_clientdata, module,
+				     "Invalid value for LercAddCompression: %d",
+				     sp->additional_compression);
+			return 0;
+		}
+		return LERCUpdateParameters(tif);
+	case TIFFTAG_LERC_MAXZERROR:
+		sp->maxzerror = va_arg(ap, double);
+		return 1;
+	case TIFFTAG_ZIPQUALITY:
+		sp->zipquality = (int) va_arg(ap, int);
+		return 1;
+	case TIFFTAG_ZSTD_LEVEL:
+		sp->zstd_compressionlevel = (int) va_arg(ap, int);
+		return 1;
+	default:
+		return (*sp->vsetparent)(tif, tag, ap);
+	}
+	/*NOTREACHED*/
+}
+
+static int
+LERCVGetField(TIFF* tif, uint32 tag, va_list ap)
+{
+	LERCState* sp = LState(tif);
+
+	switch (tag) {
+	case TIFFTAG_LERC_VERSION:
+		*va_arg(ap, int*) = sp->lerc_version;
+		break;
+	case TIFFTAG_LERC_ADD_COMPRESSION:
+		*va_arg(ap, int*) = sp->additional_compression;
+		break;
+	case TIFFTAG_LERC_MAXZERROR:
+		*va_arg(ap, double*) = sp->maxzerror;
+		break;
+	case TIFFTAG_ZIPQUALITY:
+		*va_arg(ap, int*) = sp->zipquality;
+		break;
+	case TIFFTAG_ZSTD_LEVEL:
+		*va_arg(ap, int*) = sp->zstd_compressionlevel;
+		break;
+	default:
+		return (*sp->vgetparent)(tif, tag, ap);
+	}
+	return 1;
+}
+
+static const TIFFField LERCFields[] = {
+	{ TIFFTAG_LERC_PARAMETERS, TIFF_VARIABLE2, TIFF_VARIABLE2,
+	  TIFF_LONG, 0, TIFF_SETGET_C32_UINT32, TIFF_SETGET_UNDEFINED,
+	  FIELD_CUSTOM, FALSE, TRUE, (char*) "LercParameters", NULL },
+	{ TIFFTAG_LERC_MAXZERROR, 0, 0, TIFF_ANY, 0, TIFF_SETGET_DOUBLE,
+	  TIFF_SETGET_UNDEFINED, FIELD_PSEUDO, TRUE, FALSE,
+	  (char*) "LercMaximumError", NULL },
+	{ TIFFTAG_LERC_VERSION, 0, 0, TIFF_ANY, 0, TIFF_SETGET_UINT32,
+	  TIFF_SETGET_UNDEFINED, FIELD_PSEUDO, FALSE, FALSE,
+	  (char*) "LercVersion", NULL },
+	{ TIFFTAG_LERC_ADD_COMPRESSION, 0, 0, TIFF_ANY, 0,
+	  TIFF_SETGET_UINT32, TIFF_SETGET_UNDEFINED, FIELD_PSEUDO, FALSE,
+	  FALSE, (char*) "LercAdditionalCompression", NULL },
+	{ TIFFTAG_ZIPQUALITY, 0, 0, TIFF_ANY, 0, TIFF_SETGET_INT,
+	  TIFF_SETGET_UNDEFINED, FIELD_PSEUDO, TRUE, FALSE,
+	  (char*) "", NULL },
+	{ TIFFTAG_ZSTD_LEVEL, 0, 0, TIFF_ANY, 0, TIFF_SETGET_INT,
+	  TIFF_SETGET_UNDEFINED, FIELD_PSEUDO, TRUE, FALSE,
+	  (char*) "ZSTD compression_level", NULL },
+};
+
+int
+TIFFInitLERC(TIFF* tif, int scheme)
+{
+	static const char module[] = "TIFFInitLERC";
+	LERCState* sp;
+
+	assert( scheme == COMPRESSION_LERC );
+	(void) scheme;
+
+	/*
+	 * Merge codec-specific tag information.
+	 */
+	if (!_TIFFMergeFields(tif, LERCFields, TIFFArrayCount(LERCFields))) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "Merging LERC codec-specific tags failed");
+		return 0;
+	}
+
+	/*
+	 * Allocate state block so tag methods have storage to record values.
+	 */
+	tif->tif_data = (uint8*) _TIFFmalloc(sizeof(LERCState));
+	if (tif->tif_data == NULL) {
+		TIFFErrorExt(tif->tif_clientdata, module,
+			     "No space for LERC state block");
+		return 0;
+	}
+	sp = LState(tif);
+
+	/*
+	 * Override parent get/set field methods.
+	 */
+	sp->vgetparent = tif->tif_tagmethods.vgetfield;
+	tif->tif_tagmethods.vgetfield = LERCVGetField;	/* hook for codec tags */
+	sp->vsetparent = tif->tif_tagmethods.vsetfield;
+	tif->tif_tagmethods.vsetfield = LERCVSetField;	/* hook for codec tags */
+
+	/* Default values for codec-specific fields */
+	sp->maxzerror = 0.0;		/* lossless */
+	sp->lerc_version = LERC_VERSION_2;
+	sp->additional_compression = LERC_ADD_COMPRESSION_NONE;
+	sp->zipquality = -1;		/* zlib default */
+	sp->zstd_compressionlevel = 9;
+	sp->state = 0;
+	sp->segment_width = 0;
+	sp->segment_height = 0;
+	sp->uncompressed_buffer = NULL;
+	sp->uncompressed_alloc = 0;
+	sp->uncompressed_size = 0;
+	sp->uncompressed_offset = 0;
+
+	/*
+	 * Install codec methods.
+	 */
+	tif->tif_fixuptags = LERCFixupTags;
+	tif->tif_setupdecode = LERCSetupDecode;
+	tif->tif_predecode = LERCPreDecode;
+	tif->tif_decoderow = LERCDecode;
+	tif->tif_decodestrip = LERCDecode;
+	tif->tif_decodetile = LERCDecode;
+	tif->tif_setupencode = LERCSetupEncode;
+	tif->tif_preencode = LERCPreEncode;
+	tif->tif_postencode = LERCPostEncode;
+	tif->tif_encoderow = LERCEncode;
+	tif->tif_encodestrip = LERCEncode;
+	tif->tif_encodetile = LERCEncode;
+	tif->tif_cleanup = LERCCleanup;
+
+	return 1;
+}
+#endif /* LERC_SUPPORT */
+
+/* vim: set ts=8 sts=8 sw=8 noet: */
@@ -183,6 +183,9 @@ TIFFClientOpen(
 	 * 'h' read TIFF header only, do not load the first IFD
 	 * '4' ClassicTIFF for creating a file (default)
 	 * '8' BigTIFF for creating a file
+	 * 'O' load the values of the StripOffsets/StripByteCounts (or
+	 *     TileOffsets/TileByteCounts) arrays on demand, by blocks,
+	 *     when reading
 	 *
 	 * The use of the 'l' and 'b' flags is strongly discouraged.
 	 * These flags are provided solely because numerous vendors,
@@ -214,6 +217,12 @@ TIFFClientOpen(
 	 * application-transparent and as such can cause problems.  The 'c'
 	 * option permits applications that only want to look at the tags,
 	 * for example, to get the unadulterated TIFF tag information.
+	 *
+	 * The 'O' flag is provided for files with a very large number of
+	 * strips or tiles, typically accessed through a network, where
+	 * fetching the whole offset and byte count arrays before reading
+	 * the first strip/tile would be too costly.  It has only effect
+	 * when the library is built with DEFER_STRILE_LOAD.
 	 */
 	for (cp = mode; *cp; cp++)
 		switch (*cp) {
@@ -260,6 +269,10 @@ TIFFClientOpen(
 			case 'h':
 				tif->tif_flags |= TIFF_HEADERONLY;
 				break;
+			case 'O':
+				if (m == O_RDONLY)
+					tif->tif_flags |= TIFF_LAZYSTRILELOAD;
+				break;
 			case '8':
 				if (m&O_CREAT)
 					tif->tif_flags |= TIFF_BIGTIFF;
@@ -32,6 +32,11 @@
 #include "tiffiop.h"
 #include "tif_predict.h"
 
+#if defined(__x86_64) || defined(_M_X64)
+#define PREDICTOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #define	PredictorState(tif)	((TIFFPredictorState*) (tif)->tif_data)
 
 static void horAcc8(TIFF* tif, uint8* cp0, tmsize_t cc);
@@ -264,6 +269,285 @@ PredictorSetupEncode(TIFF* tif)
 /* - when storing into the byte stream, we explicitly mask with 0xff so */
 /*   as to make icc -check=conversions happy (not necessary by the standard) */
 
+#ifdef PREDICTOR_USE_SSE2
+/*
+ * SSE2 versions of the horizontal accumulation and differencing loops.
+ *
+ * A pixel of PIXBYTES bytes (stride samples) occupies a group of lanes of
+ * a 128 bit register, and a block is a whole number of pixels: 16 bytes,
+ * or 12 bytes when the pixel size does not divide 16.  Accumulation is a
+ * log-step prefix sum over the pixels of a block, the last pixel of the
+ * previous block being added to the first lanes beforehand.  Differencing
+ * subtracts the block shifted by one pixel, with the last raw pixel of the
+ * previous block shifted in.
+ *
+ * The kernels start at the second pixel of the row and run as long as 16
+ * bytes can be loaded; the remaining pixels are done with scalar code.
+ * SSE2 is part of the x86_64 baseline, so no run-time detection is needed.
+ */
+#define PRED_BLOCK(pixbytes)	((16 % (pixbytes)) == 0 ? 16 : 12)
+#define PRED_SHIFT(n)		((n) < 16 ? (n) : 0)
+
+typedef void (*PredSSE2Func)(uint8* cp0, tmsize_t nblocks);
+
+static void
+predStoreBlockSSE2(uint8* p, __m128i v, int block)
+{
+	if (block == 16)
+		_mm_storeu_si128((__m128i*) p, v);
+	else {
+		int last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+		_mm_storel_epi64((__m128i*) p, v);
+		memcpy(p + 8, &last, 4);
+	}
+}
+
+#define DEFINE_HORACC_SSE2(name, ADD, PIXBYTES)				\
+static void								\
+name(uint8* cp0, tmsize_t nblocks)					\
+{									\
+	const int block = PRED_BLOCK(PIXBYTES);				\
+	uint8* cp = cp0 + PIXBYTES;					\
+	__m128i carry = _mm_loadu_si128((const __m128i*) cp0);		\
+	carry = _mm_srli_si128(_mm_slli_si128(carry, 16 - PIXBYTES),	\
+			       16 - PIXBYTES);				\
+	for (; nblocks > 0; nblocks--, cp += block) {			\
+		__m128i v = _mm_loadu_si128((const __m128i*) cp);	\
+		v = ADD(v, carry);					\
+		if (PIXBYTES < PRED_BLOCK(PIXBYTES))			\
+			v = ADD(v, _mm_slli_si128(v, PRED_SHIFT(PIXBYTES))); \
+		if (2 * PIXBYTES < PRED_BLOCK(PIXBYTES))		\
+			v = ADD(v, _mm_slli_si128(v, PRED_SHIFT(2 * PIXBYTES))); \
+		if (4 * PIXBYTES < PRED_BLOCK(PIXBYTES))		\
+			v = ADD(v, _mm_slli_si128(v, PRED_SHIFT(4 * PIXBYTES))); \
+		if (8 * PIXBYTES < PRED_BLOCK(PIXBYTES))		\
+			v = ADD(v, _mm_slli_si128(v, PRED_SHIFT(8 * PIXBYTES))); \
+		predStoreBlockSSE2(cp, v, block);			\
+		carry = _mm_srli_si128(					\
+		    _mm_slli_si128(v, 16 - PRED_BLOCK(PIXBYTES)),	\
+		    16 - PIXBYTES);					\
+	}								\
+}
+
+#define DEFINE_HORDIFF_SSE2(name, SUB, PIXBYTES)			\
+static void								\
+name(uint8* cp0, tmsize_t nblocks)					\
+{									\
+	const int block = PRED_BLOCK(PIXBYTES);				\
+	uint8* cp = cp0 + PIXBYTES;					\
+	__m128i carry = _mm_loadu_si128((const __m128i*) cp0);		\
+	carry = _mm_srli_si128(_mm_slli_si128(carry, 16 - PIXBYTES),	\
+			       16 - PIXBYTES);				\
+	for (; nblocks > 0; nblocks--, cp += block) {			\
+		__m128i v = _mm_loadu_si128((const __m128i*) cp);	\
+		__m128i prev = carry;					\
+		if (PIXBYTES < 16)					\
+			prev = _mm_or_si128(prev,			\
+			    _mm_slli_si128(v, PRED_SHIFT(PIXBYTES)));	\
+		carry = _mm_srli_si128(					\
+		    _mm_slli_si128(v, 16 - PRED_BLOCK(PIXBYTES)),	\
+		    16 - PIXBYTES);					\
+		predStoreBlockSSE2(cp, SUB(v, prev), block);		\
+	}								\
+}
+
+DEFINE_HORACC_SSE2(horAcc8SSE2_1, _mm_add_epi8, 1)
+DEFINE_HORACC_SSE2(horAcc8SSE2_2, _mm_add_epi8, 2)
+DEFINE_HORACC_SSE2(horAcc8SSE2_3, _mm_add_epi8, 3)
+DEFINE_HORACC_SSE2(horAcc8SSE2_4, _mm_add_epi8, 4)
+DEFINE_HORACC_SSE2(horAcc16SSE2_1, _mm_add_epi16, 2)
+DEFINE_HORACC_SSE2(horAcc16SSE2_2, _mm_add_epi16, 4)
+DEFINE_HORACC_SSE2(horAcc16SSE2_3, _mm_add_epi16, 6)
+DEFINE_HORACC_SSE2(horAcc16SSE2_4, _mm_add_epi16, 8)
+DEFINE_HORACC_SSE2(horAcc32SSE2_1, _mm_add_epi32, 4)
+DEFINE_HORACC_SSE2(horAcc32SSE2_2, _mm_add_epi32, 8)
+DEFINE_HORACC_SSE2(horAcc32SSE2_3, _mm_add_epi32, 12)
+DEFINE_HORACC_SSE2(horAcc32SSE2_4, _mm_add_epi32, 16)
+
+DEFINE_HORDIFF_SSE2(horDiff8SSE2_1, _mm_sub_epi8, 1)
+DEFINE_HORDIFF_SSE2(horDiff8SSE2_2, _mm_sub_epi8, 2)
+DEFINE_HORDIFF_SSE2(horDiff8SSE2_3, _mm_sub_epi8, 3)
+DEFINE_HORDIFF_SSE2(horDiff8SSE2_4, _mm_sub_epi8, 4)
+DEFINE_HORDIFF_SSE2(horDiff16SSE2_1, _mm_sub_epi16, 2)
+DEFINE_HORDIFF_SSE2(horDiff16SSE2_2, _mm_sub_epi16, 4)
+DEFINE_HORDIFF_SSE2(horDiff16SSE2_3, _mm_sub_epi16, 6)
+DEFINE_HORDIFF_SSE2(horDiff16SSE2_4, _mm_sub_epi16, 8)
+DEFINE_HORDIFF_SSE2(horDiff32SSE2_1, _mm_sub_epi32, 4)
+DEFINE_HORDIFF_SSE2(horDiff32SSE2_2, _mm_sub_epi32, 8)
+DEFINE_HORDIFF_SSE2(horDiff32SSE2_3, _mm_sub_epi32, 12)
+DEFINE_HORDIFF_SSE2(horDiff32SSE2_4, _mm_sub_epi32, 16)
+
+/* Indexed by [log2(sample size)][stride-1] */
+static const PredSSE2Func horAccSSE2Funcs[3][4] = {
+	{ horAcc8SSE2_1, horAcc8SSE2_2, horAcc8SSE2_3, horAcc8SSE2_4 },
+	{ horAcc16SSE2_1, horAcc16SSE2_2, horAcc16SSE2_3, horAcc16SSE2_4 },
+	{ horAcc32SSE2_1, horAcc32SSE2_2, horAcc32SSE2_3, horAcc32SSE2_4 }
+};
+
+static const PredSSE2Func horDiffSSE2Funcs[3][4] = {
+	{ horDiff8SSE2_1, horDiff8SSE2_2, horDiff8SSE2_3, horDiff8SSE2_4 },
+	{ horDiff16SSE2_1, horDiff16SSE2_2, horDiff16SSE2_3, horDiff16SSE2_4 },
+	{ horDiff32SSE2_1, horDiff32SSE2_2, horDiff32SSE2_3, horDiff32SSE2_4 }
+};
+
+/*
+ * Return the number of SSE2 blocks for a row of cc bytes made of samples
+ * of 1 << sizelog2 bytes, or 0 if the row must be done with scalar code.
+ */
+static tmsize_t
+predBlockCountSSE2(tmsize_t cc, int sizelog2, tmsize_t stride)
+{
+	tmsize_t pixbytes = stride << sizelog2;
+
+	if (stride < 1 || stride > 4 || cc < pixbytes + 16)
+		return 0;
+	return (cc - pixbytes - 16) / PRED_BLOCK(pixbytes) + 1;
+}
+
+/*
+ * Horizontal accumulation of a row.  Returns 0 if nothing was done.
+ */
+static int
+horAccSSE2(uint8* cp0, tmsize_t cc, int sizelog2, tmsize_t stride)
+{
+	tmsize_t nblocks = predBlockCountSSE2(cc, sizelog2, stride);
+	tmsize_t pixbytes = stride << sizelog2;
+	tmsize_t i;
+
+	if (nblocks == 0)
+		return 0;
+	horAccSSE2Funcs[sizelog2][stride - 1](cp0, nblocks);
+
+	i = (pixbytes + nblocks * PRED_BLOCK(pixbytes)) >> sizelog2;
+	if (sizelog2 == 0) {
+		uint8* cp = cp0;
+		for (; i < cc; i++)
+			cp[i] = (uint8) ((cp[i] + cp[i - stride]) & 0xff);
+	} else if (sizelog2 == 1) {
+		uint16* wp = (uint16*) cp0;
+		tmsize_t wc = cc / 2;
+		for (; i < wc; i++)
+			wp[i] = (uint16) (((unsigned int) wp[i] +
+			    (unsigned int) wp[i - stride]) & 0xffff);
+	} else {
+		uint32* wp = (uint32*) cp0;
+		tmsize_t wc = cc / 4;
+		for (; i < wc; i++)
+			wp[i] += wp[i - stride];
+	}
+	return 1;
+}
+
+/*
+ * Horizontal differencing of a row.  The scalar tail is done first, while
+ * the pixel preceding it still holds its original value.  Returns 0 if
+ * nothing was done.
+ */
+static int
+horDiffSSE2(uint8* cp0, tmsize_t cc, int sizelog2, tmsize_t stride)
+{
+	tmsize_t nblocks = predBlockCountSSE2(cc, sizelog2, stride);
+	tmsize_t pixbytes = stride << sizelog2;
+	tmsize_t first, i;
+
+	if (nblocks == 0)
+		return 0;
+
+	first = (pixbytes + nblocks * PRED_BLOCK(pixbytes)) >> sizelog2;
+	if (sizelog2 == 0) {
+		uint8* cp = cp0;
+		for (i = cc - 1; i >= first; i--)
+			cp[i] = (uint8) ((cp[i] - cp[i - stride]) & 0xff);
+	} else if (sizelog2 == 1) {
+		uint16* wp = (uint16*) cp0;
+		for (i = cc / 2 - 1; i >= first; i--)
+			wp[i] = (uint16) (((unsigned int) wp[i] -
+			    (unsigned int) wp[i - stride]) & 0xffff);
+	} else {
+		uint32* wp = (uint32*) cp0;
+		for (i = cc / 4 - 1; i >= first; i--)
+			wp[i] -= wp[i - stride];
+	}
+
+	horDiffSSE2Funcs[sizelog2][stride - 1](cp0, nblocks);
+	return 1;
+}
+
+/*
+ * Byte plane (de)interleaving for the floating point predictor, 16 samples
+ * of bps bytes at a time, bps being 2, 4 or 8.  Splitting a group of
+ * registers into its even and odd bytes log2(bps) times leaves the byte
+ * planes in bit-reversed order of the byte index; interleaving is the
+ * reverse operation.
+ */
+static const int fpBitRev2[2] = { 0, 1 };
+static const int fpBitRev4[4] = { 0, 2, 1, 3 };
+static const int fpBitRev8[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+static const int*
+fpBitRevSSE2(uint32 bps)
+{
+	return bps == 2 ? fpBitRev2 : bps == 4 ? fpBitRev4 : fpBitRev8;
+}
+
+/* planes[b] holds byte b of 16 samples, stored interleaved at out */
+static void
+fpInterleaveSSE2(uint8* out, const __m128i* planes, uint32 bps)
+{
+	const int* bitrev = fpBitRevSSE2(bps);
+	__m128i a[8], b[8];
+	uint32 ngroups, gsize, g, j;
+
+	for (g = 0; g < bps; g++)
+		a[g] = planes[bitrev[g]];
+	for (ngroups = bps, gsize = 1; ngroups > 1; ngroups /= 2, gsize *= 2) {
+		for (g = 0; g < ngroups / 2; g++) {
+			const __m128i* e = a + 2 * g * gsize;
+			const __m128i* o = e + gsize;
+			__m128i* dst = b + 2 * g * gsize;
+			for (j = 0; j < gsize; j++) {
+				dst[2 * j] = _mm_unpacklo_epi8(e[j], o[j]);
+				dst[2 * j + 1] = _mm_unpackhi_epi8(e[j], o[j]);
+			}
+		}
+		memcpy(a, b, bps * sizeof(__m128i));
+	}
+	for (j = 0; j < bps; j++)
+		_mm_storeu_si128((__m128i*) (out + 16 * j), a[j]);
+}
+
+/* 16 interleaved samples at in are split into planes[b], byte b of each */
+static void
+fpDeinterleaveSSE2(__m128i* planes, const uint8* in, uint32 bps)
+{
+	const int* bitrev = fpBitRevSSE2(bps);
+	const __m128i mask = _mm_set1_epi16(0xff);
+	__m128i a[8], b[8];
+	uint32 ngroups, gsize, g, j;
+
+	for (j = 0; j < bps; j++)
+		a[j] = _mm_loadu_si128((const __m128i*) (in + 16 * j));
+	for (ngroups = 1, gsize = bps; gsize > 1; ngroups *= 2, gsize /= 2) {
+		for (g = 0; g < ngroups; g++) {
+			const __m128i* src = a + g * gsize;
+			__m128i* e = b + g * gsize;
+			__m128i* o = e + gsize / 2;
+			for (j = 0; j < gsize / 2; j++) {
+				e[j] = _mm_packus_epi16(
+				    _mm_and_si128(src[2 * j], mask),
+				    _mm_and_si128(src[2 * j + 1], mask));
+				o[j] = _mm_packus_epi16(
+				    _mm_srli_epi16(src[2 * j], 8),
+				    _mm_srli_epi16(src[2 * j + 1], 8));
+			}
+		}
+		memcpy(a, b, bps * sizeof(__m128i));
+	}
+	for (g = 0; g < bps; g++)
+		planes[bitrev[g]] = a[g];
+}
+#endif /* PREDICTOR_USE_SSE2 */
+
 static void
 horAcc8(TIFF* tif, uint8* cp0, tmsize_t cc)
 {
@@ -271,6 +555,10 @@ horAcc8(TIFF* tif, uint8* cp0, tmsize_t cc)
 
 	unsigned char* cp = (unsigned char*) cp0;
 	assert((cc%stride)==0);
+#ifdef PREDICTOR_USE_SSE2
+	if (horAccSSE2(cp0, cc, 0, stride))
+		return;
+#endif
 	if (cc > stride) {
 		/*
 		 * Pipeline the most common cases.
@@ -332,6 +620,10 @@ horAcc16(TIFF* tif, uint8* cp0, tmsize_t cc)
 	tmsize_t wc = cc / 2;
 
 	assert((cc%(2*stride))==0);
+#ifdef PREDICTOR_USE_SSE2
+	if (horAccSSE2(cp0, cc, 1, stride))
+		return;
+#endif
 
 	if (wc > stride) {
 		wc -= stride;
@@ -360,6 +652,10 @@ horAcc32(TIFF* tif, uint8* cp0, tmsize_t cc)
 	tmsize_t wc = cc / 4;
 
 	assert((cc%(4*stride))==0);
+#ifdef PREDICTOR_USE_SSE2
+	if (horAccSSE2(cp0, cc, 2, stride))
+		return;
+#endif
 
 	if (wc > stride) {
 		wc -= stride;
@@ -388,6 +684,9 @@ fpAcc(TIFF* tif, uint8* cp0, tmsize_t cc)
 	if (!tmp)
 		return;
 
+#ifdef PREDICTOR_USE_SSE2
+	if (!horAccSSE2(cp0, cc, 0, stride))
+#endif
 	while (count > stride) {
 		REPEAT4(stride, cp[stride] =
                         (unsigned char) ((cp[stride] + cp[0]) & 0xff); cp++)
@@ -396,7 +695,27 @@ fpAcc(TIFF* tif, uint8* cp0, tmsize_t cc)
 
 	_TIFFmemcpy(tmp, cp0, cc);
 	cp = (uint8 *) cp0;
-	for (count = 0; count < wc; count++) {
+	count = 0;
+#ifdef PREDICTOR_USE_SSE2
+	if (bps == 2 || bps == 4 || bps == 8) {
+		__m128i planes[8];
+		for (; count + 16 <= wc; count += 16) {
+			uint32 byte;
+			for (byte = 0; byte < bps; byte++) {
+				#if WORDS_BIGENDIAN
+				const uint8* src = tmp + byte * wc + count;
+				#else
+				const uint8* src =
+				    tmp + (bps - byte - 1) * wc + count;
+				#endif
+				planes[byte] =
+				    _mm_loadu_si128((const __m128i*) src);
+			}
+			fpInterleaveSSE2(cp + bps * count, planes, bps);
+		}
+	}
+#endif
+	for (; count < wc; count++) {
 		uint32 byte;
 		for (byte = 0; byte < bps; byte++) {
 			#if WORDS_BIGENDIAN
@@ -467,6 +786,10 @@ horDiff8(TIFF* tif, uint8* cp0, tmsize_t cc)
 	unsigned char* cp = (unsigned char*) cp0;
 
 	assert((cc%stride)==0);
+#ifdef PREDICTOR_USE_SSE2
+	if (horDiffSSE2(cp0, cc, 0, stride))
+		return;
+#endif
 
 	if (cc > stride) {
 		cc -= stride;
@@ -515,6 +838,10 @@ horDiff16(TIFF* tif, uint8* cp0, tmsize_t cc)
 	tmsize_t wc = cc/2;
 
 	assert((cc%(2*stride))==0);
+#ifdef PREDICTOR_USE_SSE2
+	if (horDiffSSE2(cp0, cc, 1, stride))
+		return;
+#endif
 
 	if (wc > stride) {
 		wc -= stride;
@@ -546,6 +873,10 @@ horDiff32(TIFF* tif, uint8* cp0, tmsize_t cc)
 	tmsize_t wc = cc/4;
 
 	assert((cc%(4*stride))==0);
+#ifdef PREDICTOR_USE_SSE2
+	if (horDiffSSE2(cp0, cc, 2, stride))
+		return;
+#endif
 
 	if (wc > stride) {
 		wc -= stride;
@@ -587,7 +918,25 @@ fpDiff(TIFF* tif, uint8* cp0, tmsize_t cc)
 		return;
 
 	_TIFFmemcpy(tmp, cp0, cc);
-	for (count = 0; count < wc; count++) {
+	count = 0;
+#ifdef PREDICTOR_USE_SSE2
+	if (bps == 2 || bps == 4 || bps == 8) {
+		__m128i planes[8];
+		for (; count + 16 <= wc; count += 16) {
+			uint32 byte;
+			fpDeinterleaveSSE2(planes, tmp + bps * count, bps);
+			for (byte = 0; byte < bps; byte++) {
+				#if WORDS_BIGENDIAN
+				uint8* dst = cp + byte * wc + count;
+				#else
+				uint8* dst = cp + (bps - byte - 1) * wc + count;
+				#endif
+				_mm_storeu_si128((__m128i*) dst, planes[byte]);
+			}
+		}
+	}
+#endif
+	for (; count < wc; count++) {
 		uint32 byte;
 		for (byte = 0; byte < bps; byte++) {
 			#if WORDS_BIGENDIAN
@@ -600,6 +949,10 @@ fpDiff(TIFF* tif, uint8* cp0, tmsize_t cc)
 	}
 	_TIFFfree(tmp);
 
+#ifdef PREDICTOR_USE_SSE2
+	if (horDiffSSE2(cp0, cc, 0, stride))
+		return;
+#endif
 	cp = (uint8 *) cp0;
 	cp += cc - stride - 1;
 	for (count = cc; count > stride; count -= stride)
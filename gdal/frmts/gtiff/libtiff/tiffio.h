@@ -467,6 +467,11 @@ extern tmsize_t TIFFReadEncodedStrip(TIFF* tif, uint32 strip, void* buf, tmsize_
 extern tmsize_t TIFFReadRawStrip(TIFF* tif, uint32 strip, void* buf, tmsize_t size);  
 extern tmsize_t TIFFReadEncodedTile(TIFF* tif, uint32 tile, void* buf, tmsize_t size);  
 extern tmsize_t TIFFReadRawTile(TIFF* tif, uint32 tile, void* buf, tmsize_t size);  
+extern int TIFFReadFromUserBuffer(TIFF* tif, uint32 strile, void* inbuf, tmsize_t insize, void* outbuf, tmsize_t outsize);
+extern uint64 TIFFGetStrileOffset(TIFF* tif, uint32 strile);
+extern uint64 TIFFGetStrileByteCount(TIFF* tif, uint32 strile);
+extern uint64 TIFFGetStrileOffsetWithErr(TIFF* tif, uint32 strile, int *pbErr);
+extern uint64 TIFFGetStrileByteCountWithErr(TIFF* tif, uint32 strile, int *pbErr);
 extern tmsize_t TIFFWriteEncodedStrip(TIFF* tif, uint32 strip, void* data, tmsize_t cc);
 extern tmsize_t TIFFWriteRawStrip(TIFF* tif, uint32 strip, void* data, tmsize_t cc);  
 extern tmsize_t TIFFWriteEncodedTile(TIFF* tif, uint32 tile, void* data, tmsize_t cc);  
@@ -298,10 +298,22 @@ CPLErr RawRasterBand::AccessLine( int iLine )
             - std::abs(nPixelOffset) * (nBlockXSize-1);
     }
 
+    const size_t nBytesToRead = std::abs(nPixelOffset) * (nBlockXSize - 1)
+        + GDALGetDataTypeSizeBytes(GetRasterDataType());
+
+/* -------------------------------------------------------------------- */
+/*      If the file is memory mapped, just copy the line.               */
+/* -------------------------------------------------------------------- */
+    const GByte *pabyMapped = GetRangePointer( nReadStart, nBytesToRead );
+    if( pabyMapped != NULL )
+    {
+        memcpy( pLineBuffer, pabyMapped, nBytesToRead );
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Seek to the right line.                                         */
 /* -------------------------------------------------------------------- */
-    if( Seek(nReadStart, SEEK_SET) == -1 )
+    else if( Seek(nReadStart, SEEK_SET) == -1 )
     {
         if (poDS != NULL && poDS->GetAccess() == GA_ReadOnly)
         {
@@ -323,24 +335,24 @@ CPLErr RawRasterBand::AccessLine( int iLine )
 /*      are needed, and not to lose a partially successful scanline     */
 /*      read.                                                           */
 /* -------------------------------------------------------------------- */
-    const size_t nBytesToRead = std::abs(nPixelOffset) * (nBlockXSize - 1)
-        + GDALGetDataTypeSizeBytes(GetRasterDataType());
-
-    const size_t nBytesActuallyRead = Read( pLineBuffer, 1, nBytesToRead );
-    if( nBytesActuallyRead < nBytesToRead )
+    else
     {
-        if (poDS != NULL && poDS->GetAccess() == GA_ReadOnly)
+        const size_t nBytesActuallyRead = Read( pLineBuffer, 1, nBytesToRead );
+        if( nBytesActuallyRead < nBytesToRead )
         {
-            CPLError( CE_Failure, CPLE_FileIO,
-                      "Failed to read scanline %d.",
-                      iLine);
-            return CE_Failure;
-        }
-        else
-        {
-            memset(
-                reinterpret_cast<GByte *>( pLineBuffer ) + nBytesActuallyRead,
-                0, nBytesToRead - nBytesActuallyRead );
+            if (poDS != NULL && poDS->GetAccess() == GA_ReadOnly)
+            {
+                CPLError( CE_Failure, CPLE_FileIO,
+                          "Failed to read scanline %d.",
+                          iLine);
+                return CE_Failure;
+            }
+            else
+            {
+                memset(
+                    reinterpret_cast<GByte *>( pLineBuffer ) + nBytesActuallyRead,
+                    0, nBytesToRead - nBytesActuallyRead );
+            }
         }
     }
 
@@ -521,10 +533,19 @@ CPLErr RawRasterBand::IWriteBlock( CPL_UNUSED int nBlockXOff,
 CPLErr RawRasterBand::AccessBlock( vsi_l_offset nBlockOff, size_t nBlockSize,
                                    void * pData )
 {
+/* -------------------------------------------------------------------- */
+/*      If the file is memory mapped, just copy the block.              */
+/* -------------------------------------------------------------------- */
+    const GByte *pabyMapped = GetRangePointer( nBlockOff, nBlockSize );
+    if( pabyMapped != NULL )
+    {
+        memcpy( pData, pabyMapped, nBlockSize );
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Seek to the right block.                                        */
 /* -------------------------------------------------------------------- */
-    if( Seek( nBlockOff, SEEK_SET ) == -1 )
+    else if( Seek( nBlockOff, SEEK_SET ) == -1 )
     {
         memset( pData, 0, nBlockSize );
         return CE_None;
@@ -533,13 +554,16 @@ CPLErr RawRasterBand::AccessBlock( vsi_l_offset nBlockOff, size_t nBlockSize,
 /* -------------------------------------------------------------------- */
 /*      Read the block.                                                 */
 /* -------------------------------------------------------------------- */
-    const size_t nBytesActuallyRead = Read( pData, 1, nBlockSize );
-    if( nBytesActuallyRead < nBlockSize )
+    else
     {
+        const size_t nBytesActuallyRead = Read( pData, 1, nBlockSize );
+        if( nBytesActuallyRead < nBlockSize )
+        {
 
-        memset( reinterpret_cast<GByte *>( pData ) + nBytesActuallyRead,
-                0, nBlockSize - nBytesActuallyRead );
-        return CE_None;
+            memset( reinterpret_cast<GByte *>( pData ) + nBytesActuallyRead,
+                    0, nBlockSize - nBytesActuallyRead );
+            return CE_None;
+        }
     }
 
 /* -------------------------------------------------------------------- */
@@ -732,6 +756,9 @@ CPLErr RawRasterBand::IRasterIO( GDALRWFlag eRWFlag,
                 VSI_MALLOC_VERBOSE( nBytesToRW ) );
             if( pabyData == NULL )
                 return CE_Failure;
+            // When the file is memory mapped and no byte swapping is needed,
+            // data is directly copied from the mapping to the user buffer.
+            const bool bCanUseMapping = bNativeOrder || eDataType == GDT_Byte;
 
             for ( int iLine = 0; iLine < nBufYSize; iLine++ )
             {
@@ -740,7 +767,12 @@ CPLErr RawRasterBand::IRasterIO( GDALRWFlag eRWFlag,
                           + static_cast<vsi_l_offset>( iLine * dfSrcYInc ) )
                          * nLineOffset )
                     + nXOff * nPixelOffset;
-                if ( AccessBlock( nOffset,
+                const GByte *pabySrcData = bCanUseMapping ?
+                    GetRangePointer( nOffset, nBytesToRW ) : NULL;
+                if( pabySrcData == NULL )
+                    pabySrcData = pabyData;
+                if ( pabySrcData == pabyData &&
+                     AccessBlock( nOffset,
                                   nBytesToRW, pabyData ) != CE_None )
                 {
                     CPLError( CE_Failure, CPLE_FileIO,
@@ -757,7 +789,7 @@ CPLErr RawRasterBand::IRasterIO( GDALRWFlag eRWFlag,
 /* -------------------------------------------------------------------- */
                 if ( nXSize == nBufXSize && nYSize == nBufYSize )
                 {
-                    GDALCopyWords( pabyData, eDataType, nPixelOffset,
+                    GDALCopyWords( pabySrcData, eDataType, nPixelOffset,
                                    reinterpret_cast<GByte *>( pData ) +
                                    static_cast<vsi_l_offset>( iLine ) *
                                    nLineSpace,
@@ -769,7 +801,7 @@ CPLErr RawRasterBand::IRasterIO( GDALRWFlag eRWFlag,
                     for ( int iPixel = 0; iPixel < nBufXSize; iPixel++ )
                     {
                         GDALCopyWords(
-                            pabyData +
+                            pabySrcData +
                             static_cast<vsi_l_offset>( iPixel * dfSrcXInc ) *
                             nPixelOffset,
                             eDataType, nPixelOffset,
@@ -1047,6 +1079,21 @@ size_t RawRasterBand::Read( void *pBuffer, size_t nSize, size_t nCount )
     return VSIFRead( pBuffer, nSize, nCount, fpRaw );
 }
 
+/************************************************************************/
+/*                          GetRangePointer()                           */
+/************************************************************************/
+
+const GByte *RawRasterBand::GetRangePointer( vsi_l_offset nOffset,
+                                             size_t nSize )
+
+{
+    if( !bIsVSIL )
+        return NULL;
+
+    return static_cast<const GByte *>(
+        VSIFGetRangePointerL( fpRawL, nOffset, nSize ) );
+}
+
 /************************************************************************/
 /*                               Write()                                */
 /************************************************************************/
@@ -698,6 +698,27 @@ CPLErr CPL_DLL CPL_STDCALL GDALRasterAdviseRead( GDALRasterBandH hRB,
     int nDSXOff, int nDSYOff, int nDSXSize, int nDSYSize,
     int nBXSize, int nBYSize, GDALDataType eBDataType, char **papszOptions );
 
+/** Flag returned by GDALGetDataCoverageStatus() when the driver does not
+ * implement GetDataCoverageStatus(). This flag should be returned together
+ * with GDAL_DATA_COVERAGE_STATUS_DATA */
+#define GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED 0x01
+
+/** Flag returned by GDALGetDataCoverageStatus() when there is (potentially)
+ * data in the queried window. */
+#define GDAL_DATA_COVERAGE_STATUS_DATA          0x02
+
+/** Flag returned by GDALGetDataCoverageStatus() when there is nodata in the
+ * queried window. This is typically identified by the concept of missing
+ * block in formats that supports it.
+ */
+#define GDAL_DATA_COVERAGE_STATUS_EMPTY         0x04
+
+int CPL_DLL CPL_STDCALL GDALGetDataCoverageStatus( GDALRasterBandH hBand,
+                                                   int nXOff, int nYOff,
+                                                   int nXSize, int nYSize,
+                                                   int nMaskFlagStop,
+                                                   double* pdfDataPct );
+
 CPLErr CPL_DLL CPL_STDCALL
 GDALRasterIO( GDALRasterBandH hRBand, GDALRWFlag eRWFlag,
               int nDSXOff, int nDSYOff, int nDSXSize, int nDSYSize,
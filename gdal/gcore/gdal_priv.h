@@ -814,6 +814,11 @@ class CPL_DLL GDALRasterBand : public GDALMajorObject
     GDALRasterBlock *TryGetLockedBlockRef( int nXBlockOff, int nYBlockYOff );
     void           AddBlockToFreeList( GDALRasterBlock * );
 
+    virtual int    IGetDataCoverageStatus( int nXOff, int nYOff,
+                                           int nXSize, int nYSize,
+                                           int nMaskFlagStop,
+                                           double* pdfDataPct );
+
   public:
                 GDALRasterBand();
                 GDALRasterBand(int bForceCachedIO);
@@ -893,6 +898,11 @@ class CPL_DLL GDALRasterBand : public GDALMajorObject
                                int nBufXSize, int nBufYSize,
                                GDALDataType eDT, char **papszOptions );
 
+    int            GetDataCoverageStatus( int nXOff, int nYOff,
+                                          int nXSize, int nYSize,
+                                          int nMaskFlagStop = 0,
+                                          double* pdfDataPct = NULL );
+
     virtual CPLErr  GetHistogram( double dfMin, double dfMax,
                           int nBuckets, GUIntBig * panHistogram,
                           int bIncludeOutOfRange, int bApproxOK,
@@ -114,6 +114,10 @@ class CPL_DLL GDALProxyRasterBand : public GDALRasterBand
         virtual CPLErr IRasterIO( GDALRWFlag, int, int, int, int,
                                 void *, int, int, GDALDataType,
                                 GSpacing, GSpacing, GDALRasterIOExtraArg* psExtraArg );
+        virtual int IGetDataCoverageStatus( int nXOff, int nYOff,
+                                            int nXSize, int nYSize,
+                                            int nMaskFlagStop,
+                                            double* pdfDataPct );
 
     public:
 
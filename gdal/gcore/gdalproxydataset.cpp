@@ -192,6 +192,14 @@ RB_PROXY_METHOD_WITH_RET(CPLErr, CE_Failure, IRasterIO,
                                 pData, nBufXSize, nBufYSize, eBufType,
                                 nPixelSpace, nLineSpace, psExtraArg ) )
 
+RB_PROXY_METHOD_WITH_RET(int, GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED |
+                              GDAL_DATA_COVERAGE_STATUS_DATA,
+                        IGetDataCoverageStatus,
+                        ( int nXOff, int nYOff, int nXSize, int nYSize,
+                          int nMaskFlagStop, double* pdfDataPct ),
+                        (nXOff, nYOff, nXSize, nYSize,
+                         nMaskFlagStop, pdfDataPct))
+
 RB_PROXY_METHOD_WITH_RET(char**, NULL, GetMetadataDomainList, (), ())
 RB_PROXY_METHOD_WITH_RET(char**, NULL, GetMetadata, (const char * pszDomain), (pszDomain))
 RB_PROXY_METHOD_WITH_RET(CPLErr, CE_Failure, SetMetadata,
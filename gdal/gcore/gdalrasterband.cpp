@@ -3421,6 +3421,167 @@ GDALRasterAdviseRead( GDALRasterBandH hBand,
         nBufXSize, nBufYSize, eDT, papszOptions );
 }
 
+/************************************************************************/
+/*                        GetDataCoverageStatus()                       */
+/************************************************************************/
+
+/**
+ * \brief Get the coverage status of a sub-window of the raster.
+ *
+ * Returns whether a sub-window of the raster contains only data, only empty
+ * blocks or a mix of both. This function can be used to determine quickly
+ * if it is worth issuing RasterIO / ReadBlock requests in datasets that may
+ * be sparse.
+ *
+ * Empty blocks are blocks that are generally not physically present in the
+ * file, and when read through GDAL, contain only pixels whose value is the
+ * nodata value when it is set, or whose value is 0 when the nodata value is
+ * not set.
+ *
+ * The query is done in an efficient way without reading the actual pixel
+ * values. If not possible, or not implemented at all by the driver,
+ * GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED | GDAL_DATA_COVERAGE_STATUS_DATA will
+ * be returned.
+ *
+ * The values that can be returned by the function are the following,
+ * potentially combined with the binary or operator :
+ * <ul>
+ * <li>GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED : the driver does not implement
+ * GetDataCoverageStatus(). This flag should be returned together with
+ * GDAL_DATA_COVERAGE_STATUS_DATA.</li>
+ * <li>GDAL_DATA_COVERAGE_STATUS_DATA: There is (potentially) data in the queried
+ * window.</li>
+ * <li>GDAL_DATA_COVERAGE_STATUS_EMPTY: There is nodata in the queried window.
+ * This is typically identified by the concept of missing block in formats that
+ * supports it.
+ * </li>
+ * </ul>
+ *
+ * Note that GDAL_DATA_COVERAGE_STATUS_DATA might have false positives and
+ * should be interpreted more as hint of potential presence of data. For example
+ * if a GeoTIFF file is created with blocks filled with zeroes (or set to the
+ * nodata value), instead of using the missing block mechanism,
+ * GDAL_DATA_COVERAGE_STATUS_DATA will be returned. On the contrary,
+ * GDAL_DATA_COVERAGE_STATUS_EMPTY should have no false positives.
+ *
+ * The nMaskFlagStop should be generally set to 0. It can be set to a
+ * binary-or'ed mask of the above mentioned values to enable a quick exiting of
+ * the function as soon as the computed mask matches the nMaskFlagStop. For
+ * example, you can issue a request on the whole raster with nMaskFlagStop =
+ * GDAL_DATA_COVERAGE_STATUS_EMPTY. As soon as one missing block is encountered,
+ * the function will exit, so that you can potentially refine the requested area
+ * to find which particular region(s) have missing blocks.
+ *
+ * This method is the same as the C function GDALGetDataCoverageStatus().
+ *
+ * @param nXOff The pixel offset to the top left corner of the region
+ * of the band to be queried. This would be zero to start from the left side.
+ *
+ * @param nYOff The line offset to the top left corner of the region
+ * of the band to be queried. This would be zero to start from the top.
+ *
+ * @param nXSize The width of the region of the band to be queried in pixels.
+ *
+ * @param nYSize The height of the region of the band to be queried in lines.
+ *
+ * @param nMaskFlagStop 0, or a binary-or'ed mask of possible values
+ * GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED,
+ * GDAL_DATA_COVERAGE_STATUS_DATA and GDAL_DATA_COVERAGE_STATUS_EMPTY.
+ * As soon as the computation of the coverage matches the mask, the
+ * computation will be stopped. *pdfDataPct will not be valid in that case.
+ *
+ * @param pdfDataPct Optional output parameter whose pointed value will be set
+ * to the (approximate) percentage in [0,100] of pixels in the queried
+ * sub-window that have valid values. The implementation might not always be
+ * able to compute it, in which case it will be set to a negative value.
+ *
+ * @return a binary-or'ed combination of possible values
+ * GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED,
+ * GDAL_DATA_COVERAGE_STATUS_DATA and GDAL_DATA_COVERAGE_STATUS_EMPTY
+ *
+ * @note Added in GDAL 2.2
+ */
+
+int GDALRasterBand::GetDataCoverageStatus( int nXOff,
+                                           int nYOff,
+                                           int nXSize,
+                                           int nYSize,
+                                           int nMaskFlagStop,
+                                           double* pdfDataPct)
+{
+    if( nXOff < 0 || nYOff < 0 || nXSize < 0 || nYSize < 0 ||
+        nXSize > INT_MAX - nXOff ||
+        nYSize > INT_MAX - nYOff ||
+        nXOff + nXSize > nRasterXSize ||
+        nYOff + nYSize > nRasterYSize )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "Bad window");
+        if( pdfDataPct )
+            *pdfDataPct = 0.0;
+        return GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED |
+               GDAL_DATA_COVERAGE_STATUS_EMPTY;
+    }
+    return IGetDataCoverageStatus(nXOff, nYOff, nXSize, nYSize,
+                                  nMaskFlagStop, pdfDataPct);
+}
+
+/************************************************************************/
+/*                       IGetDataCoverageStatus()                       */
+/************************************************************************/
+
+/**
+ * \brief Get the coverage status of a sub-window of the raster.
+ *
+ * Drivers that can determine it efficiently, typically from the layout of
+ * the blocks in the file, should override this method. The window has
+ * already been validated by GetDataCoverageStatus().
+ *
+ * The default implementation returns
+ * GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED | GDAL_DATA_COVERAGE_STATUS_DATA.
+ *
+ * @see GetDataCoverageStatus()
+ * @note Added in GDAL 2.2
+ */
+
+int GDALRasterBand::IGetDataCoverageStatus( CPL_UNUSED int nXOff,
+                                            CPL_UNUSED int nYOff,
+                                            CPL_UNUSED int nXSize,
+                                            CPL_UNUSED int nYSize,
+                                            CPL_UNUSED int nMaskFlagStop,
+                                            double* pdfDataPct)
+{
+    if( pdfDataPct != NULL )
+        *pdfDataPct = 100.0;
+    return GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED |
+           GDAL_DATA_COVERAGE_STATUS_DATA;
+}
+
+/************************************************************************/
+/*                      GDALGetDataCoverageStatus()                     */
+/************************************************************************/
+
+/**
+ * \brief Get the coverage status of a sub-window of the raster.
+ *
+ * @see GDALRasterBand::GetDataCoverageStatus()
+ * @note Added in GDAL 2.2
+ */
+
+int CPL_STDCALL GDALGetDataCoverageStatus( GDALRasterBandH hBand,
+                                           int nXOff, int nYOff,
+                                           int nXSize, int nYSize,
+                                           int nMaskFlagStop,
+                                           double* pdfDataPct )
+{
+    VALIDATE_POINTER1( hBand, "GDALGetDataCoverageStatus",
+                       GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED );
+
+    GDALRasterBand *poBand = static_cast<GDALRasterBand*>(hBand);
+
+    return poBand->GetDataCoverageStatus( nXOff, nYOff, nXSize, nYSize,
+                                          nMaskFlagStop, pdfDataPct );
+}
+
 /************************************************************************/
 /*                           GetStatistics()                            */
 /************************************************************************/
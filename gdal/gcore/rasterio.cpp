@@ -3354,6 +3354,31 @@ static void GDALCopyWholeRasterGetSwathSize(GDALRasterBand *poSrcPrototypeBand,
     *pnSwathLines = nSwathLines;
 }
 
+/************************************************************************/
+/*                     GDALCopyWholeRasterIsHole()                      */
+/*                                                                      */
+/*      Return whether a window of the source is only made of missing   */
+/*      blocks for all the bands of the request.                        */
+/************************************************************************/
+
+static bool GDALCopyWholeRasterIsHole( GDALDataset* poSrcDS,
+                                       int nBandCount, int* panBandMap,
+                                       int nXOff, int nYOff,
+                                       int nXSize, int nYSize )
+{
+    for( int iBand = 0; iBand < nBandCount; iBand++ )
+    {
+        GDALRasterBand* poBand = poSrcDS->GetRasterBand(
+            panBandMap ? panBandMap[iBand] : iBand + 1 );
+        const int nStatus = poBand->GetDataCoverageStatus(
+            nXOff, nYOff, nXSize, nYSize,
+            GDAL_DATA_COVERAGE_STATUS_DATA, NULL );
+        if( nStatus != GDAL_DATA_COVERAGE_STATUS_EMPTY )
+            return false;
+    }
+    return true;
+}
+
 /************************************************************************/
 /*                     GDALDatasetCopyWholeRaster()                     */
 /************************************************************************/
@@ -3373,7 +3398,12 @@ static void GDALCopyWholeRasterGetSwathSize(GDALRasterBand *poSrcPrototypeBand,
  *
  * Currently the only papszOptions value supported are : "INTERLEAVE=PIXEL"
  * to force pixel interleaved operation and "COMPRESSED=YES" to force alignment
- * on target dataset block sizes to achieve best compression.  More options may be supported in
+ * on target dataset block sizes to achieve best compression.
+ * Starting with GDAL 2.2, "SKIP_HOLES=YES" can be specified to skip the
+ * reading and writing of the chunks that the source reports as only made of
+ * missing blocks with GDALGetDataCoverageStatus(). This is only appropriate
+ * if the unwritten blocks of the destination read as the nodata value (or 0),
+ * for example with a sparse GeoTIFF file.  More options may be supported in
  * the future.
  *
  * @param hSrcDS the source dataset
@@ -3469,6 +3499,9 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
     if (pszDstCompressed != NULL && CPLTestBool(pszDstCompressed))
         bDstIsCompressed = TRUE;
 
+    const bool bSkipHoles =
+        CPLTestBool(CSLFetchNameValueDef( papszOptions, "SKIP_HOLES", "NO" ));
+
 /* -------------------------------------------------------------------- */
 /*      What will our swath size be?                                    */
 /* -------------------------------------------------------------------- */
@@ -3533,6 +3566,22 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
                     if( iX + nThisCols > nXSize )
                         nThisCols = nXSize - iX;
 
+                    if( bSkipHoles &&
+                        GDALCopyWholeRasterIsHole( poSrcDS, 1, &nBand,
+                                                   iX, iY,
+                                                   nThisCols, nThisLines ) )
+                    {
+                        nBlocksDone ++;
+                        if( !pfnProgress( nBlocksDone / (double)nTotalBlocks,
+                                          NULL, pProgressData ) )
+                        {
+                            eErr = CE_Failure;
+                            CPLError( CE_Failure, CPLE_UserInterrupt,
+                                    "User terminated CreateCopy()" );
+                        }
+                        continue;
+                    }
+
                     sExtraArg.pfnProgress = GDALScaledProgress;
                     sExtraArg.pProgressData =
                         GDALCreateScaledProgress( nBlocksDone / (double)nTotalBlocks,
@@ -3598,6 +3647,22 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
                 if( iX + nThisCols > nXSize )
                     nThisCols = nXSize - iX;
 
+                if( bSkipHoles &&
+                    GDALCopyWholeRasterIsHole( poSrcDS, nBandCount, NULL,
+                                               iX, iY,
+                                               nThisCols, nThisLines ) )
+                {
+                    nBlocksDone ++;
+                    if( !pfnProgress( nBlocksDone / (double)nTotalBlocks,
+                                      NULL, pProgressData ) )
+                    {
+                        eErr = CE_Failure;
+                        CPLError( CE_Failure, CPLE_UserInterrupt,
+                                "User terminated CreateCopy()" );
+                    }
+                    continue;
+                }
+
                 sExtraArg.pfnProgress = GDALScaledProgress;
                 sExtraArg.pProgressData =
                     GDALCreateScaledProgress( nBlocksDone / (double)nTotalBlocks,
@@ -37,6 +37,7 @@
 #include "cpl_minizip_zip.h"
 #include "cpl_port.h"
 #include "cpl_string.h"
+#include "cpl_vsi_virtual.h"
 
 #include <cstddef>
 
@@ -139,6 +140,8 @@ typedef struct
     uLong dosDate;
     uLong crc32;
     int  encrypt;
+    VSIVirtualHandle* vsi_deflate_handle; /* multi-threaded compressor, or NULL */
+    uLong vsi_raw_length_before;  /* file position when it was created */
 #ifndef NOCRYPT
     unsigned long keys[3];     /* keys defining the pseudo-random sequence */
     const unsigned long* pcrc_32_tab;
@@ -819,6 +822,22 @@ extern int ZEXPORT cpl_zipOpenNewFileInZip3 (
         if (err==Z_OK)
             zi->ci.stream_initialised = 1;
     }
+
+    /* Delegate compression to the multi-threaded deflate writer when */
+    /* GDAL_NUM_THREADS asks for it */
+    zi->ci.vsi_deflate_handle = NULL;
+    if ((err==Z_OK) && (zi->ci.method == Z_DEFLATED) && (!zi->ci.raw) &&
+        (password == NULL))
+    {
+        if (CPLGetConfiguredNumThreads("1") > 1)
+        {
+            zi->ci.vsi_raw_length_before =
+                (uLong) ZTELL(zi->z_filefunc,zi->filestream);
+            zi->ci.vsi_deflate_handle =
+                VSICreateGZipWritable((VSIVirtualHandle*)zi->filestream,
+                                      CPL_DEFLATE_TYPE_RAW_DEFLATE, FALSE);
+        }
+    }
 #    ifndef NOCRYPT
     zi->ci.crypt_header_size = 0;
     if ((err==Z_OK) && (password != NULL))
@@ -920,6 +939,14 @@ extern int ZEXPORT cpl_zipWriteInFileInZip (
     zi->ci.crc32 = crc32(zi->ci.crc32,(const Bytef *) buf,len);
 
     int err=ZIP_OK;
+    if (zi->ci.vsi_deflate_handle != NULL)
+    {
+        if (zi->ci.vsi_deflate_handle->Write(buf, 1, len) < len)
+            err = ZIP_ERRNO;
+        zi->ci.stream.avail_in = 0;
+        zi->ci.stream.total_in += len;
+    }
+
     while ((err==ZIP_OK) && (zi->ci.stream.avail_in>0))
     {
         if (zi->ci.stream.avail_out == 0)
@@ -981,7 +1008,16 @@ extern int ZEXPORT cpl_zipCloseFileInZipRaw (
     zi->ci.stream.avail_in = 0;
 
     int err=ZIP_OK;
-    if ((zi->ci.method == Z_DEFLATED) && (!zi->ci.raw))
+    if (zi->ci.vsi_deflate_handle != NULL)
+    {
+        if (zi->ci.vsi_deflate_handle->Close() != 0)
+            err = ZIP_ERRNO;
+        delete zi->ci.vsi_deflate_handle;
+        zi->ci.vsi_deflate_handle = NULL;
+        zi->ci.stream.total_out = (uLong) ZTELL(zi->z_filefunc,zi->filestream) -
+                                  zi->ci.vsi_raw_length_before;
+    }
+    else if ((zi->ci.method == Z_DEFLATED) && (!zi->ci.raw))
     {
         while (err==ZIP_OK)
         {
@@ -359,6 +359,38 @@ static void CPLCleanupTLSList( void **papTLSList )
     CPLFree( papTLSList );
 }
 
+/************************************************************************/
+/*                      CPLGetConfiguredNumThreads()                    */
+/************************************************************************/
+
+/**
+ * Return the number of worker threads requested by the GDAL_NUM_THREADS
+ * configuration option.
+ *
+ * The option can be set to an integer or to ALL_CPUS. The returned value
+ * is in the [1,128] range.
+ *
+ * @param pszDefault value to use when the option is not set, such as "1"
+ * or "ALL_CPUS".
+ *
+ * @since GDAL 2.2
+ */
+
+int CPLGetConfiguredNumThreads( const char* pszDefault )
+{
+    const char* pszThreads = CPLGetConfigOption("GDAL_NUM_THREADS", pszDefault);
+    int nThreads;
+    if (EQUAL(pszThreads, "ALL_CPUS"))
+        nThreads = CPLGetNumCPUs();
+    else
+        nThreads = atoi(pszThreads);
+    if (nThreads > 128)
+        nThreads = 128;
+    if (nThreads < 1)
+        nThreads = 1;
+    return nThreads;
+}
+
 #if defined(CPL_MULTIPROC_STUB)
 /************************************************************************/
 /* ==================================================================== */
@@ -100,6 +100,7 @@ void  CPL_DLL CPLSleep( double dfWaitInSeconds );
 const char CPL_DLL *CPLGetThreadingModel( void );
 
 int CPL_DLL CPLGetNumCPUs( void );
+int CPL_DLL CPLGetConfiguredNumThreads( const char* pszDefault );
 
 
 typedef struct _CPLLock CPLLock;
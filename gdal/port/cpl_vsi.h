@@ -143,6 +143,16 @@ vsi_l_offset CPL_DLL VSIFTellL( VSILFILE * ) CPL_WARN_UNUSED_RESULT;
 void CPL_DLL    VSIRewindL( VSILFILE * );
 size_t CPL_DLL  VSIFReadL( void *, size_t, size_t, VSILFILE * ) EXPERIMENTAL_CPL_WARN_UNUSED_RESULT;
 int CPL_DLL     VSIFReadMultiRangeL( int nRanges, void ** ppData, const vsi_l_offset* panOffsets, const size_t* panSizes, VSILFILE * ) EXPERIMENTAL_CPL_WARN_UNUSED_RESULT;
+size_t CPL_DLL  VSIFPReadL( void *pBuffer, size_t nSize, vsi_l_offset nOffset, VSILFILE * ) EXPERIMENTAL_CPL_WARN_UNUSED_RESULT;
+
+/** Opaque type for an asynchronous read request */
+typedef void *VSIAsyncReadRequestH;
+
+VSIAsyncReadRequestH CPL_DLL VSIFReadMultiRangeAsyncL( int nRanges, void ** ppData, const vsi_l_offset* panOffsets, const size_t* panSizes, VSILFILE * ) CPL_WARN_UNUSED_RESULT;
+int CPL_DLL     VSIAsyncReadRequestIsComplete( VSIAsyncReadRequestH );
+int CPL_DLL     VSIAsyncReadRequestWait( VSIAsyncReadRequestH );
+void CPL_DLL    VSIAsyncReadRequestDestroy( VSIAsyncReadRequestH );
+
 size_t CPL_DLL  VSIFWriteL( const void *, size_t, size_t, VSILFILE * ) EXPERIMENTAL_CPL_WARN_UNUSED_RESULT;
 int CPL_DLL     VSIFEofL( VSILFILE * ) EXPERIMENTAL_CPL_WARN_UNUSED_RESULT;
 int CPL_DLL     VSIFTruncateL( VSILFILE *, vsi_l_offset ) EXPERIMENTAL_CPL_WARN_UNUSED_RESULT;
@@ -174,6 +184,8 @@ int CPL_DLL     VSIStatExL( const char * pszFilename, VSIStatBufL * psStatBuf, i
 int CPL_DLL     VSIIsCaseSensitiveFS( const char * pszFilename );
 
 void CPL_DLL   *VSIFGetNativeFileDescriptorL( VSILFILE* );
+const void CPL_DLL *VSIFGetRangePointerL( VSILFILE*, vsi_l_offset nOffset,
+                                          size_t nSize );
 
 /* ==================================================================== */
 /*      Memory allocation                                               */
@@ -43,23 +43,47 @@
 #include <vector>
 #include <string>
 
+/************************************************************************/
+/*                         VSIAsyncReadRequest                          */
+/************************************************************************/
+
+class CPL_DLL VSIAsyncReadRequest {
+  public:
+    /* Returns TRUE once all the ranges have been read */
+    virtual int       IsComplete() = 0;
+    /* Waits for all the ranges to be read. Returns 0 on success, -1 otherwise */
+    virtual int       Wait() = 0;
+    /* Waits for completion before destroying */
+    virtual           ~VSIAsyncReadRequest() {}
+};
+
 /************************************************************************/
 /*                           VSIVirtualHandle                           */
 /************************************************************************/
 
 class CPL_DLL VSIVirtualHandle {
+  protected:
+    /* Serializes the default implementation of PRead() */
+    CPLMutex         *m_hPReadMutex;
+
   public:
+                      VSIVirtualHandle() : m_hPReadMutex(NULL) {}
+
     virtual int       Seek( vsi_l_offset nOffset, int nWhence ) = 0;
     virtual vsi_l_offset Tell() = 0;
     virtual size_t    Read( void *pBuffer, size_t nSize, size_t nMemb ) = 0;
     virtual int       ReadMultiRange( int nRanges, void ** ppData, const vsi_l_offset* panOffsets, const size_t* panSizes );
+    virtual size_t    PRead( void *pBuffer, size_t nSize, vsi_l_offset nOffset );
+    virtual VSIAsyncReadRequest *ReadMultiRangeAsync( int nRanges, void ** ppData, const vsi_l_offset* panOffsets, const size_t* panSizes );
     virtual size_t    Write( const void *pBuffer, size_t nSize,size_t nMemb)=0;
     virtual int       Eof() = 0;
     virtual int       Flush() {return 0;}
     virtual int       Close() = 0;
     virtual int       Truncate( CPL_UNUSED vsi_l_offset nNewSize ) { return -1; }
     virtual void     *GetNativeFileDescriptor() { return NULL; }
-    virtual           ~VSIVirtualHandle() { }
+    virtual const void *GetRangePointer( CPL_UNUSED vsi_l_offset nOffset,
+                                         CPL_UNUSED size_t nSize ) { return NULL; }
+    virtual           ~VSIVirtualHandle();
 };
 
 /************************************************************************/
@@ -149,8 +173,12 @@ public:
     vsi_l_offset nFileSize;
     int nEntries;
     VSIArchiveEntry* entries;
+    std::map<CPLString, int> oMapFileNameToEntry;  /* index in entries */
+    size_t       nMemSize;     /* approximate memory footprint */
+    GUIntBig     nLastAccess;  /* for LRU eviction from the cache */
 
-    VSIArchiveContent() : mTime(0), nFileSize(0), nEntries(0), entries(NULL) {}
+    VSIArchiveContent() : mTime(0), nFileSize(0), nEntries(0), entries(NULL),
+                          nMemSize(0), nLastAccess(0) {}
     ~VSIArchiveContent();
 };
 
@@ -175,7 +203,11 @@ protected:
     /* We use a cache that contains the list of files contained in a VSIArchive file as */
     /* unarchive.c is quite inefficient in listing them. This speeds up access to VSIArchive files */
     /* containing ~1000 files like a CADRG product */
+    /* Starting with GDAL 2.2, the cache is bounded by CPL_VSIL_ARCHIVE_CACHE_SIZE */
     std::map<CPLString,VSIArchiveContent*>   oFileList;
+    GUIntBig nAccessCounter;
+
+    void EvictFromCache( const VSIArchiveContent* poContentToKeep );
 
     virtual const char* GetPrefix() = 0;
     virtual std::vector<CPLString> GetExtensions() = 0;
@@ -203,6 +235,10 @@ VSIVirtualHandle* VSICreateBufferedReaderHandle(VSIVirtualHandle* poBaseHandle,
                                                 const GByte* pabyBeginningContent,
                                                 vsi_l_offset nCheatFileSize);
 VSIVirtualHandle* VSICreateCachedFile( VSIVirtualHandle* poBaseHandle, size_t nChunkSize = 32768, size_t nCacheSize = 0 );
-VSIVirtualHandle CPL_DLL *VSICreateGZipWritable( VSIVirtualHandle* poBaseHandle, int bRegularZLibIn, int bAutoCloseBaseHandle );
+VSIVirtualHandle* VSICreateSubFileHandle( VSIVirtualHandle* poBaseHandle, vsi_l_offset nSubregionOffset, vsi_l_offset nSubregionSize );
+#define CPL_DEFLATE_TYPE_GZIP         0
+#define CPL_DEFLATE_TYPE_ZLIB         1
+#define CPL_DEFLATE_TYPE_RAW_DEFLATE  2
+VSIVirtualHandle CPL_DLL *VSICreateGZipWritable( VSIVirtualHandle* poBaseHandle, int nDeflateType, int bAutoCloseBaseHandle );
 
 #endif /* ndef CPL_VSI_VIRTUAL_H_INCLUDED */
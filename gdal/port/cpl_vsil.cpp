@@ -32,9 +32,11 @@
 #include "cpl_multiproc.h"
 #include "cpl_string.h"
 #include "cpl_vsi_virtual.h"
+#include "cpl_worker_thread_pool.h"
 
 #include <cassert>
 #include <string>
+#include <vector>
 
 CPL_CVSID("$Id$");
 
@@ -814,6 +816,141 @@ int VSIFReadMultiRangeL( int nRanges, void ** ppData,
     return poFileHandle->ReadMultiRange( nRanges, ppData, panOffsets, panSizes );
 }
 
+/************************************************************************/
+/*                             VSIFPReadL()                             */
+/************************************************************************/
+
+/**
+ * \brief Read bytes from file at a given offset.
+ *
+ * Reads nSize bytes from the indicated file at offset nOffset into the
+ * indicated buffer, without using nor modifying the current file position.
+ *
+ * Contrary to VSIFSeekL() + VSIFReadL(), several threads can call
+ * VSIFPReadL() simultaneously on the same handle. Local files, /vsimem/,
+ * /vsisubfile/ and /vsicurl/ (and derived) handles read the ranges
+ * concurrently. Other handles serialize the requests. Calling VSIFSeekL(),
+ * VSIFReadL() or VSIFWriteL() on the handle from another thread at the
+ * same time is not supported.
+ *
+ * Analog of the POSIX pread() call.
+ *
+ * @param pBuffer the buffer into which the data should be read (at least
+ * nSize bytes long).
+ * @param nSize number of bytes to read.
+ * @param nOffset offset in the file at which the data should be read.
+ * @param fp file handle opened with VSIFOpenL().
+ *
+ * @return number of bytes successfully read, which is less than nSize
+ * in case of error or if the end of file is reached.
+ * @since GDAL 2.2
+ */
+
+size_t VSIFPReadL( void *pBuffer, size_t nSize, vsi_l_offset nOffset,
+                   VSILFILE * fp )
+{
+    VSIVirtualHandle *poFileHandle = reinterpret_cast<VSIVirtualHandle *>( fp );
+
+    return poFileHandle->PRead( pBuffer, nSize, nOffset );
+}
+
+/************************************************************************/
+/*                      VSIFReadMultiRangeAsyncL()                      */
+/************************************************************************/
+
+/**
+ * \brief Start reading several ranges of bytes from file.
+ *
+ * Submits the reading of nRanges objects of panSizes[i] bytes from the
+ * indicated file at the offset panOffsets[i] into the buffer ppData[i], and
+ * returns immediately. The caller can then poll for completion with
+ * VSIAsyncReadRequestIsComplete() or wait for it with
+ * VSIAsyncReadRequestWait(), and must release the request with
+ * VSIAsyncReadRequestDestroy().
+ *
+ * The ranges are read with VSIFPReadL() by a process-wide pool of worker
+ * threads, split in as many jobs as the GDAL_NUM_THREADS configuration
+ * option (1 by default) allows. The ranges do not need to be sorted. The ppData[] buffers
+ * must remain valid, and the file handle must not be used nor closed,
+ * until the request is complete. The panOffsets, panSizes and ppData arrays
+ * themselves can be freed as soon as this function returns.
+ *
+ * @param nRanges number of ranges to read.
+ * @param ppData array of nRanges buffer into which the data should be read
+ *               (ppData[i] must be at list panSizes[i] bytes).
+ * @param panOffsets array of nRanges offsets at which the data should be read.
+ * @param panSizes array of nRanges sizes of objects to read (in bytes).
+ * @param fp file handle opened with VSIFOpenL().
+ *
+ * @return a request handle.
+ * @since GDAL 2.2
+ */
+
+VSIAsyncReadRequestH VSIFReadMultiRangeAsyncL( int nRanges, void ** ppData,
+                                               const vsi_l_offset* panOffsets,
+                                               const size_t* panSizes,
+                                               VSILFILE * fp )
+{
+    VSIVirtualHandle *poFileHandle = reinterpret_cast<VSIVirtualHandle *>( fp );
+
+    return poFileHandle->ReadMultiRangeAsync( nRanges, ppData, panOffsets,
+                                              panSizes );
+}
+
+/************************************************************************/
+/*                   VSIAsyncReadRequestIsComplete()                    */
+/************************************************************************/
+
+/**
+ * \brief Returns whether an asynchronous read request is complete.
+ *
+ * @param hRequest request returned by VSIFReadMultiRangeAsyncL().
+ *
+ * @return TRUE if all the ranges have been read (or failed).
+ * @since GDAL 2.2
+ */
+
+int VSIAsyncReadRequestIsComplete( VSIAsyncReadRequestH hRequest )
+{
+    return static_cast<VSIAsyncReadRequest *>( hRequest )->IsComplete();
+}
+
+/************************************************************************/
+/*                      VSIAsyncReadRequestWait()                       */
+/************************************************************************/
+
+/**
+ * \brief Waits for an asynchronous read request to complete.
+ *
+ * @param hRequest request returned by VSIFReadMultiRangeAsyncL().
+ *
+ * @return 0 if all the ranges have been entirely read, -1 otherwise.
+ * @since GDAL 2.2
+ */
+
+int VSIAsyncReadRequestWait( VSIAsyncReadRequestH hRequest )
+{
+    return static_cast<VSIAsyncReadRequest *>( hRequest )->Wait();
+}
+
+/************************************************************************/
+/*                     VSIAsyncReadRequestDestroy()                     */
+/************************************************************************/
+
+/**
+ * \brief Destroys an asynchronous read request.
+ *
+ * If the request is not complete yet, this waits for its completion.
+ *
+ * @param hRequest request returned by VSIFReadMultiRangeAsyncL(), or NULL.
+ * @since GDAL 2.2
+ */
+
+void VSIAsyncReadRequestDestroy( VSIAsyncReadRequestH hRequest )
+{
+    delete static_cast<VSIAsyncReadRequest *>( hRequest );
+}
+
 /************************************************************************/
 /*                             VSIFWriteL()                             */
 /************************************************************************/
@@ -1177,6 +1314,46 @@ void *VSIFGetNativeFileDescriptorL( VSILFILE* fp )
     return poFileHandle->GetNativeFileDescriptor();
 }
 
+/************************************************************************/
+/*                        VSIFGetRangePointerL()                        */
+/************************************************************************/
+
+/**
+ * \brief Returns a read-only pointer on a range of the file content.
+ *
+ * This allows callers to access the bytes of a file without copying them
+ * in their own buffer. This is only possible for some virtual handles :
+ * local files opened in read-only mode (that are then memory mapped),
+ * /vsimem/ files opened in read-only mode, and /vsisubfile/ (including
+ * uncompressed members of /vsizip/ archives) on top of them. When it is not
+ * possible, or if the range is not entirely within the file, NULL is
+ * returned and the caller must fall back to VSIFReadL().
+ *
+ * The returned pointer is valid until the handle is closed. The content
+ * it points to is undefined if the file is modified or truncated by
+ * another handle or process in the meantime.
+ *
+ * Memory mapping of local files can be disabled by setting the
+ * CPL_VSIL_MMAP configuration option to NO.
+ *
+ * The file position of the handle is not modified.
+ *
+ * @param fp file handle opened with VSIFOpenL().
+ * @param nOffset offset of the start of the range, in bytes.
+ * @param nSize size of the range, in bytes.
+ *
+ * @return a pointer to the content at nOffset, or NULL.
+ * @since GDAL 2.2
+ */
+
+const void *VSIFGetRangePointerL( VSILFILE* fp, vsi_l_offset nOffset,
+                                  size_t nSize )
+{
+    VSIVirtualHandle *poFileHandle = reinterpret_cast<VSIVirtualHandle *>( fp );
+
+    return poFileHandle->GetRangePointer( nOffset, nSize );
+}
+
 /************************************************************************/
 /*                      VSIGetDiskFreeSpace()                           */
 /************************************************************************/
@@ -1246,6 +1423,8 @@ VSIFileManager::~VSIFileManager()
 
 static VSIFileManager *poManager = NULL;
 static CPLMutex* hVSIFileManagerMutex = NULL;
+static CPLWorkerThreadPool *poAsyncReadPool = NULL;
+static CPLMutex* hAsyncReadPoolMutex = NULL;
 
 VSIFileManager *VSIFileManager::Get()
 
@@ -1373,6 +1552,271 @@ void VSICleanupFileManager()
         CPLDestroyMutex(hVSIFileManagerMutex);
         hVSIFileManagerMutex = NULL;
     }
+
+    if( poAsyncReadPool != NULL )
+    {
+        delete poAsyncReadPool;
+        poAsyncReadPool = NULL;
+    }
+
+    if( hAsyncReadPoolMutex != NULL )
+    {
+        CPLDestroyMutex(hAsyncReadPoolMutex);
+        hAsyncReadPoolMutex = NULL;
+    }
+}
+
+/************************************************************************/
+/*                         ~VSIVirtualHandle()                          */
+/************************************************************************/
+
+VSIVirtualHandle::~VSIVirtualHandle()
+{
+    if( m_hPReadMutex != NULL )
+        CPLDestroyMutex( m_hPReadMutex );
+}
+
+/************************************************************************/
+/*                               PRead()                                */
+/************************************************************************/
+
+/* Default implementation, emulating pread() with Seek() and Read() under */
+/* a per-handle lock, and restoring the current file position. */
+
+size_t VSIVirtualHandle::PRead( void *pBuffer, size_t nSize,
+                                vsi_l_offset nOffset )
+{
+    CPLMutexHolder oHolder( &m_hPReadMutex );
+
+    const vsi_l_offset nCurOffset = Tell();
+    size_t nRead = 0;
+    if( Seek( nOffset, SEEK_SET ) == 0 )
+        nRead = Read( pBuffer, 1, nSize );
+    Seek( nCurOffset, SEEK_SET );
+
+    return nRead;
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                     VSIAsyncReadRequestDefault                       */
+/* ==================================================================== */
+/************************************************************************/
+
+/* The ranges are distributed in a few jobs of similar total size, each */
+/* of them reading its ranges with PRead() in a worker thread. */
+
+class VSIAsyncReadRequestDefault;
+
+typedef struct
+{
+    VSIAsyncReadRequestDefault *poRequest;
+    size_t                      iFirstRange;
+    size_t                      nRanges;
+} VSIAsyncReadJob;
+
+class VSIAsyncReadRequestDefault CPL_FINAL : public VSIAsyncReadRequest
+{
+    VSIVirtualHandle            *m_poHandle;
+    std::vector<void*>           m_apData;
+    std::vector<vsi_l_offset>    m_anOffsets;
+    std::vector<size_t>          m_anSizes;
+    std::vector<VSIAsyncReadJob> m_asJobs;
+
+    CPLMutex                    *m_hMutex;
+    CPLCond                     *m_hCond;
+    size_t                       m_nPendingJobs;
+    bool                         m_bError;
+
+    static void                  ReadJobFunc( void* pData );
+
+  public:
+                                 VSIAsyncReadRequestDefault(
+                                        VSIVirtualHandle* poHandle,
+                                        int nRanges, void ** ppData,
+                                        const vsi_l_offset* panOffsets,
+                                        const size_t* panSizes );
+    virtual                     ~VSIAsyncReadRequestDefault();
+
+    void                         Submit( CPLWorkerThreadPool* poPool,
+                                         int nThreads );
+
+    virtual int                  IsComplete();
+    virtual int                  Wait();
+};
+
+/************************************************************************/
+/*                     VSIAsyncReadRequestDefault()                     */
+/************************************************************************/
+
+VSIAsyncReadRequestDefault::VSIAsyncReadRequestDefault(
+                                        VSIVirtualHandle* poHandle,
+                                        int nRanges, void ** ppData,
+                                        const vsi_l_offset* panOffsets,
+                                        const size_t* panSizes ) :
+    m_poHandle(poHandle),
+    m_apData(ppData, ppData + nRanges),
+    m_anOffsets(panOffsets, panOffsets + nRanges),
+    m_anSizes(panSizes, panSizes + nRanges),
+    m_hMutex(CPLCreateMutex()),
+    m_hCond(CPLCreateCond()),
+    m_nPendingJobs(0),
+    m_bError(false)
+{
+    CPLReleaseMutex(m_hMutex);
+}
+
+/************************************************************************/
+/*                    ~VSIAsyncReadRequestDefault()                     */
+/************************************************************************/
+
+VSIAsyncReadRequestDefault::~VSIAsyncReadRequestDefault()
+{
+    Wait();
+    CPLDestroyCond(m_hCond);
+    CPLDestroyMutex(m_hMutex);
+}
+
+/************************************************************************/
+/*                             ReadJobFunc()                            */
+/************************************************************************/
+
+void VSIAsyncReadRequestDefault::ReadJobFunc( void* pData )
+{
+    VSIAsyncReadJob* psJob = static_cast<VSIAsyncReadJob*>(pData);
+    VSIAsyncReadRequestDefault* poRequest = psJob->poRequest;
+
+    bool bOK = true;
+    for( size_t i = psJob->iFirstRange;
+         bOK && i < psJob->iFirstRange + psJob->nRanges; i++ )
+    {
+        bOK = poRequest->m_poHandle->PRead( poRequest->m_apData[i],
+                                            poRequest->m_anSizes[i],
+                                            poRequest->m_anOffsets[i] ) ==
+                    poRequest->m_anSizes[i];
+    }
+
+    CPLAcquireMutex(poRequest->m_hMutex, 1000.0);
+    if( !bOK )
+        poRequest->m_bError = true;
+    poRequest->m_nPendingJobs --;
+    if( poRequest->m_nPendingJobs == 0 )
+        CPLCondSignal(poRequest->m_hCond);
+    CPLReleaseMutex(poRequest->m_hMutex);
+}
+
+/************************************************************************/
+/*                               Submit()                               */
+/************************************************************************/
+
+void VSIAsyncReadRequestDefault::Submit( CPLWorkerThreadPool* poPool,
+                                         int nThreads )
+{
+/* -------------------------------------------------------------------- */
+/*      Split the ranges in at most nThreads jobs of similar size.      */
+/* -------------------------------------------------------------------- */
+    const size_t nRanges = m_anSizes.size();
+    GUIntBig nTotalSize = 0;
+    for( size_t i = 0; i < nRanges; i++ )
+        nTotalSize += m_anSizes[i];
+    const size_t nJobs = MIN(nRanges, static_cast<size_t>(MAX(1, nThreads)));
+    const GUIntBig nTargetSize = nJobs ? (nTotalSize + nJobs - 1) / nJobs : 0;
+
+    GUIntBig nAccSize = 0;
+    for( size_t i = 0; i < nRanges; i++ )
+    {
+        if( m_asJobs.empty() ||
+            (nAccSize >= nTargetSize && m_asJobs.size() < nJobs) )
+        {
+            VSIAsyncReadJob sJob;
+            sJob.poRequest = this;
+            sJob.iFirstRange = i;
+            sJob.nRanges = 0;
+            m_asJobs.push_back(sJob);
+            nAccSize = 0;
+        }
+        m_asJobs.back().nRanges ++;
+        nAccSize += m_anSizes[i];
+    }
+
+    m_nPendingJobs = m_asJobs.size();
+    for( size_t i = 0; i < m_asJobs.size(); i++ )
+    {
+        if( poPool == NULL || !poPool->SubmitJob(ReadJobFunc, &m_asJobs[i]) )
+            ReadJobFunc(&m_asJobs[i]);
+    }
+}
+
+/************************************************************************/
+/*                             IsComplete()                             */
+/************************************************************************/
+
+int VSIAsyncReadRequestDefault::IsComplete()
+{
+    CPLMutexHolderD(&m_hMutex);
+    return m_nPendingJobs == 0;
+}
+
+/************************************************************************/
+/*                                Wait()                                */
+/************************************************************************/
+
+int VSIAsyncReadRequestDefault::Wait()
+{
+    CPLAcquireMutex(m_hMutex, 1000.0);
+    while( m_nPendingJobs != 0 )
+        CPLCondWait(m_hCond, m_hMutex);
+    const bool bError = m_bError;
+    CPLReleaseMutex(m_hMutex);
+    return bError ? -1 : 0;
+}
+
+/************************************************************************/
+/*                        VSIGetAsyncReadPool()                         */
+/************************************************************************/
+
+/* Returns the worker thread pool shared by all asynchronous reads. It is */
+/* sized once, when first needed, and only destroyed by */
+/* VSICleanupFileManager(), so that callers can keep using the returned */
+/* pointer after the mutex is released. Requests asking for more threads */
+/* than the pool has just queue their extra jobs. */
+
+static CPLWorkerThreadPool* VSIGetAsyncReadPool()
+{
+    static bool bPoolSetupFailed = false;
+
+    CPLMutexHolderD( &hAsyncReadPoolMutex );
+
+    if( poAsyncReadPool == NULL && !bPoolSetupFailed )
+    {
+        const int nThreads = MIN(128, MAX(CPLGetConfiguredNumThreads("1"),
+                                          CPLGetNumCPUs()));
+        poAsyncReadPool = new CPLWorkerThreadPool();
+        if( !poAsyncReadPool->Setup(nThreads, NULL, NULL) )
+        {
+            delete poAsyncReadPool;
+            poAsyncReadPool = NULL;
+            bPoolSetupFailed = true;
+        }
+    }
+    return poAsyncReadPool;
+}
+
+/************************************************************************/
+/*                        ReadMultiRangeAsync()                         */
+/************************************************************************/
+
+VSIAsyncReadRequest *VSIVirtualHandle::ReadMultiRangeAsync(
+                                            int nRanges, void ** ppData,
+                                            const vsi_l_offset* panOffsets,
+                                            const size_t* panSizes )
+{
+    VSIAsyncReadRequestDefault* poRequest =
+        new VSIAsyncReadRequestDefault( this, MAX(0, nRanges), ppData,
+                                        panOffsets, panSizes );
+    poRequest->Submit( nRanges > 0 ? VSIGetAsyncReadPool() : NULL,
+                       CPLGetConfiguredNumThreads("1") );
+    return poRequest;
 }
 
 /************************************************************************/
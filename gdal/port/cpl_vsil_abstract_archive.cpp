@@ -35,6 +35,8 @@
 
 #define ENABLE_DEBUG 0
 
+#define DEFAULT_ARCHIVE_CACHE_SIZE (64 * 1024 * 1024)
+
 CPL_CVSID("$Id$");
 
 /************************************************************************/
@@ -67,6 +69,16 @@ VSIArchiveContent::~VSIArchiveContent()
     CPLFree(entries);
 }
 
+/************************************************************************/
+/*                      VSIArchiveEntryMemSize()                        */
+/************************************************************************/
+
+/* Approximate memory used by an entry, its file offset and its index */
+static size_t VSIArchiveEntryMemSize( const VSIArchiveEntry* psEntry )
+{
+    return sizeof(VSIArchiveEntry) + 2 * (strlen(psEntry->fileName) + 1) + 128;
+}
+
 /************************************************************************/
 /*                   VSIArchiveFilesystemHandler()                      */
 /************************************************************************/
@@ -74,6 +86,7 @@ VSIArchiveContent::~VSIArchiveContent()
 VSIArchiveFilesystemHandler::VSIArchiveFilesystemHandler()
 {
     hMutex = NULL;
+    nAccessCounter = 0;
 }
 
 /************************************************************************/
@@ -97,6 +110,10 @@ VSIArchiveFilesystemHandler::~VSIArchiveFilesystemHandler()
 
 /************************************************************************/
 /*                       GetContentOfArchive()                          */
+/*                                                                      */
+/*      The returned content may be evicted from the cache, and thus    */
+/*      freed, by any other call on the handler: callers must hold      */
+/*      hMutex while they use it.                                       */
 /************************************************************************/
 
 const VSIArchiveContent* VSIArchiveFilesystemHandler::GetContentOfArchive
@@ -120,6 +137,7 @@ const VSIArchiveContent* VSIArchiveFilesystemHandler::GetContentOfArchive
         }
         else
         {
+            content->nLastAccess = ++nAccessCounter;
             return content;
         }
     }
@@ -203,6 +221,8 @@ const VSIArchiveContent* VSIArchiveFilesystemHandler::GetContentOfArchive
                             CPLDebug("VSIArchive", "[%d] %s : " CPL_FRMT_GUIB " bytes", content->nEntries+1,
                                 content->entries[content->nEntries].fileName,
                                 content->entries[content->nEntries].uncompressed_size);
+                        content->oMapFileNameToEntry[pszStrippedFileName2] = content->nEntries;
+                        content->nMemSize += VSIArchiveEntryMemSize(&content->entries[content->nEntries]);
                         content->nEntries++;
                     }
                     else
@@ -223,6 +243,8 @@ const VSIArchiveContent* VSIArchiveFilesystemHandler::GetContentOfArchive
                 CPLDebug("VSIArchive", "[%d] %s : " CPL_FRMT_GUIB " bytes", content->nEntries+1,
                     content->entries[content->nEntries].fileName,
                     content->entries[content->nEntries].uncompressed_size);
+            content->oMapFileNameToEntry[pszStrippedFileName] = content->nEntries;
+            content->nMemSize += VSIArchiveEntryMemSize(&content->entries[content->nEntries]);
             content->nEntries++;
         }
         else
@@ -234,11 +256,56 @@ const VSIArchiveContent* VSIArchiveFilesystemHandler::GetContentOfArchive
     if (bMustClose)
         delete(poReader);
 
+    content->nMemSize += sizeof(VSIArchiveContent) + strlen(archiveFilename);
+    content->nLastAccess = ++nAccessCounter;
+    EvictFromCache(content);
+
     return content;
 }
 
+/************************************************************************/
+/*                          EvictFromCache()                            */
+/************************************************************************/
+
+/* Remove the least recently used archives from the cache until it fits */
+/* in CPL_VSIL_ARCHIVE_CACHE_SIZE bytes. Must be called with hMutex held. */
+
+void VSIArchiveFilesystemHandler::EvictFromCache( const VSIArchiveContent* poContentToKeep )
+{
+    const GIntBig nMaxSize = CPLAtoGIntBig(
+        CPLGetConfigOption("CPL_VSIL_ARCHIVE_CACHE_SIZE",
+                           CPLSPrintf("%d", DEFAULT_ARCHIVE_CACHE_SIZE)));
+
+    while( true )
+    {
+        GIntBig nTotalSize = 0;
+        std::map<CPLString,VSIArchiveContent*>::iterator oIterOldest = oFileList.end();
+        std::map<CPLString,VSIArchiveContent*>::iterator oIter;
+        for( oIter = oFileList.begin(); oIter != oFileList.end(); ++oIter )
+        {
+            nTotalSize += static_cast<GIntBig>(oIter->second->nMemSize);
+            if( oIter->second != poContentToKeep &&
+                (oIterOldest == oFileList.end() ||
+                 oIter->second->nLastAccess < oIterOldest->second->nLastAccess) )
+            {
+                oIterOldest = oIter;
+            }
+        }
+        if( nTotalSize <= nMaxSize || oIterOldest == oFileList.end() )
+            break;
+
+        CPLDebug("VSIArchive", "Evicting content of %s from the cache",
+                 oIterOldest->first.c_str());
+        delete oIterOldest->second;
+        oFileList.erase(oIterOldest);
+    }
+}
+
 /************************************************************************/
 /*                        FindFileInArchive()                           */
+/*                                                                      */
+/*      As for GetContentOfArchive(), callers must hold hMutex while    */
+/*      they use the returned entry.                                    */
 /************************************************************************/
 
 int VSIArchiveFilesystemHandler::FindFileInArchive(const char* archiveFilename,
@@ -248,17 +315,18 @@ int VSIArchiveFilesystemHandler::FindFileInArchive(const char* archiveFilename,
     if (fileInArchiveName == NULL)
         return FALSE;
 
+    CPLMutexHolder oHolder( &hMutex );
+
     const VSIArchiveContent* content = GetContentOfArchive(archiveFilename);
     if (content)
     {
-        for( int i = 0; i < content->nEntries; i++ )
+        std::map<CPLString, int>::const_iterator oIter =
+            content->oMapFileNameToEntry.find(fileInArchiveName);
+        if (oIter != content->oMapFileNameToEntry.end())
         {
-            if (strcmp(fileInArchiveName, content->entries[i].fileName) == 0)
-            {
-                if (archiveEntry)
-                    *archiveEntry = &content->entries[i];
-                return TRUE;
-            }
+            if (archiveEntry)
+                *archiveEntry = &content->entries[oIter->second];
+            return TRUE;
         }
     }
     return FALSE;
@@ -435,6 +503,7 @@ VSIArchiveReader* VSIArchiveFilesystemHandler::OpenArchiveFile(const char* archi
             CPLString msg;
             msg.Printf("Support only 1 file in archive file %s when no explicit in-archive filename is specified",
                        archiveFilename);
+            CPLMutexHolder oHolder( &hMutex );
             const VSIArchiveContent* content = GetContentOfArchive(archiveFilename, poReader);
             if (content)
             {
@@ -453,6 +522,8 @@ VSIArchiveReader* VSIArchiveFilesystemHandler::OpenArchiveFile(const char* archi
     }
     else
     {
+        /* The lock keeps the entry, and its file offset, alive */
+        CPLMutexHolder oHolder( &hMutex );
         const VSIArchiveEntry* archiveEntry = NULL;
         if (FindFileInArchive(archiveFilename, fileInArchiveName, &archiveEntry) == FALSE ||
             archiveEntry->bIsDir)
@@ -491,6 +562,7 @@ int VSIArchiveFilesystemHandler::Stat( const char *pszFilename,
         if (ENABLE_DEBUG) CPLDebug("VSIArchive", "Looking for %s %s\n",
                                     archiveFilename, osFileInArchive.c_str());
 
+        CPLMutexHolder oHolder( &hMutex );
         const VSIArchiveEntry* archiveEntry = NULL;
         if (FindFileInArchive(archiveFilename, osFileInArchive, &archiveEntry))
         {
@@ -601,6 +673,7 @@ char** VSIArchiveFilesystemHandler::ReadDirEx( const char *pszDirname,
 
     CPLStringList oDir;
 
+    CPLMutexHolder oHolder( &hMutex );
     const VSIArchiveContent* content = GetContentOfArchive(archiveFilename);
     if (!content)
     {
@@ -28,6 +28,7 @@
  ****************************************************************************/
 
 #include "cpl_vsi_virtual.h"
+#include "cpl_atomic_ops.h"
 #include "cpl_string.h"
 #include "cpl_multiproc.h"
 #include "cpl_hash_set.h"
@@ -35,6 +36,7 @@
 #include "cpl_vsil_curl_priv.h"
 #include "cpl_aws.h"
 #include "cpl_minixml.h"
+#include "cpl_sha256.h"
 
 CPL_CVSID("$Id$");
 
@@ -79,12 +81,33 @@ int VSICurlUninstallReadCbk(CPL_UNUSED VSILFILE* fp)
 void CPLHTTPSetOptions(CURL *http_handle, char** papszOptions);
 void VSICurlSetOptions(CURL* hCurlHandle, const char* pszURL);
 
+#include <algorithm>
 #include <map>
+#include <vector>
+
+#ifdef WIN32
+#include <sys/utime.h>
+#else
+#include <unistd.h>
+#include <utime.h>
+#endif
 
 #define ENABLE_DEBUG 1
 
-static const int N_MAX_REGIONS = 1000;
-static const int DOWNLOAD_CHUNK_SIZE = 16384;
+static const int DEFAULT_DOWNLOAD_CHUNK_SIZE = 16384;
+static const int MAX_DOWNLOAD_CHUNK_SIZE = 10 * 1024 * 1024;
+/* Default value of CPL_VSIL_CURL_CACHE_SIZE: 1000 chunks of 16 KB */
+static const GIntBig DEFAULT_CACHE_SIZE = 1000 * 16384;
+/* Default value of CPL_VSIL_CURL_CACHE_DIR_SIZE: 512 MB */
+static const GIntBig DEFAULT_CACHE_DIR_SIZE = 512 * 1024 * 1024;
+/* Magic of the files of the on-disk cache, followed by the length of the */
+/* key, the key and the data of the chunk */
+static const char CACHE_DISK_MAGIC[] = "GDALVCC1";
+/* Default value of CPL_VSIL_CURL_MAX_CONNECTIONS */
+static const int DEFAULT_MAX_CONNECTIONS = 8;
+/* Ranges downloaded in parallel are at least that many chunks large, */
+/* below which the latency of the extra requests is not worth it */
+static const int PARALLEL_MIN_CHUNKS_PER_REQUEST = 16;
 
 namespace {
 
@@ -106,6 +129,9 @@ class CachedFileProp
     bool            bS3Redirect;
     time_t          nExpireTimestampLocal;
     CPLString       osRedirectURL;
+    /* Validators of the content, used as part of the on-disk cache keys */
+    CPLString       osETag;
+    GIntBig         nLastModified;
 
                     CachedFileProp() : eExists(EXIST_UNKNOWN),
                                        bHasComputedFileSize(false),
@@ -113,7 +139,8 @@ class CachedFileProp
                                        bIsDirectory(false),
                                        mTime(0),
                                        bS3Redirect(false),
-                                       nExpireTimestampLocal(0)
+                                       nExpireTimestampLocal(0),
+                                       nLastModified(0)
                                        {}
 };
 
@@ -123,12 +150,16 @@ typedef struct
     char**          papszFileList; /* only file name without path */
 } CachedDirList;
 
-typedef struct
+typedef struct CachedRegion_
 {
     unsigned long   pszURLHash;
     vsi_l_offset    nFileOffsetStart;
     size_t          nSize;
     char           *pData;
+
+    /* Links of the LRU list, from the most to the least recently used */
+    struct CachedRegion_ *psPrev;
+    struct CachedRegion_ *psNext;
 } CachedRegion;
 
 typedef struct
@@ -146,6 +177,8 @@ typedef struct
     bool            bError;
     bool            bDownloadHeaderOnly;
     GIntBig         nTimestampDate; // Corresponds to Date: header field
+    GIntBig         nLastModified;  // Corresponds to Last-Modified: header field
+    char            szETag[128];
 
     VSILFILE           *fp;
     VSICurlReadCbkFunc  pfnReadCbk;
@@ -155,11 +188,6 @@ typedef struct
 
 } /* end of anoymous namespace */
 
-static const char* VSICurlGetCacheFileName()
-{
-    return "gdal_vsicurl_cache.bin";
-}
-
 /************************************************************************/
 /*          VSICurlFindStringSensitiveExceptEscapeSequences()           */
 /************************************************************************/
@@ -226,6 +254,30 @@ static int VSICurlIsFileInList( char ** papszList, const char * pszTarget )
     return nRet;
 }
 
+/************************************************************************/
+/*                         VSICurlRegionHash()                          */
+/************************************************************************/
+
+static unsigned long VSICurlRegionHash(const void* elt)
+{
+    const CachedRegion* psRegion = static_cast<const CachedRegion*>(elt);
+    const GUIntBig nOffset = psRegion->nFileOffsetStart;
+    return psRegion->pszURLHash ^
+           static_cast<unsigned long>((nOffset >> 32) ^ nOffset) * 2654435761U;
+}
+
+/************************************************************************/
+/*                         VSICurlRegionEqual()                         */
+/************************************************************************/
+
+static int VSICurlRegionEqual(const void* elt1, const void* elt2)
+{
+    const CachedRegion* psRegion1 = static_cast<const CachedRegion*>(elt1);
+    const CachedRegion* psRegion2 = static_cast<const CachedRegion*>(elt2);
+    return psRegion1->pszURLHash == psRegion2->pszURLHash &&
+           psRegion1->nFileOffsetStart == psRegion2->nFileOffsetStart;
+}
+
 /************************************************************************/
 /*                     VSICurlFilesystemHandler                         */
 /************************************************************************/
@@ -234,19 +286,31 @@ typedef struct
 {
     CPLString       osURL;
     CURL           *hCurlHandle;
+    /* Owns the pool of keep-alive connections used by parallel downloads */
+    CURLM          *hCurlMultiHandle;
 } CachedConnection;
 
 class VSICurlHandle;
 
 class VSICurlFilesystemHandler : public VSIFilesystemHandler
 {
-    CachedRegion  **papsRegions;
-    int             nRegions;
+    /* Downloaded chunks, indexed by URL hash and offset */
+    CPLHashSet     *hRegionSet;
+    CachedRegion   *psRegionMRU;
+    CachedRegion   *psRegionLRU;
+    GIntBig         nRegionsMemSize;
+    int             nDownloadChunkSize;
+
+    void            UnlinkRegion(CachedRegion* psRegion);
+    void            LinkRegionAsMRU(CachedRegion* psRegion);
+    CachedRegion   *FindRegionInRAM(const char* pszURL,
+                                    vsi_l_offset nFileOffsetStart);
 
     std::map<CPLString, CachedFileProp*>   cacheFileSize;
     std::map<CPLString, CachedDirList*>        cacheDirList;
 
-    int             bUseCacheDisk;
+    /* Bytes written to the on-disk cache since its size was last checked */
+    GIntBig         nCacheDiskWrittenSinceCheck;
 
     /* Per-thread Curl connection cache */
     std::map<GIntBig, CachedConnection*> mapConnections;
@@ -302,14 +366,43 @@ public:
                                   size_t          nSize,
                                   const char     *pData);
 
+    bool                CopyFromRegion(const char*     pszURL,
+                                       vsi_l_offset    nOffset,
+                                       void           *pDest,
+                                       size_t          nMaxSize,
+                                       size_t         *pnCopied,
+                                       size_t         *pnRegionSize);
+
     CachedFileProp*     GetCachedFileProp(const char*     pszURL);
     void                InvalidateCachedFileProp(const char*     pszURL);
 
-    void                AddRegionToCacheDisk(CachedRegion* psRegion);
+    CachedRegion*       InsertRegion(const char*     pszURL,
+                                     vsi_l_offset    nFileOffsetStart,
+                                     size_t          nSize,
+                                     const char     *pData);
+
+    static bool         IsCacheDiskEnabled();
+    static CPLString    GetCacheDiskDirectory();
+    static GIntBig      GetCacheDiskMaxSize();
+    bool                GetCacheDiskFilename(const char*     pszURL,
+                                             vsi_l_offset    nFileOffsetStart,
+                                             CPLString&      osFilename,
+                                             CPLString&      osKey);
+    void                AddRegionToCacheDisk(const char*     pszURL,
+                                             vsi_l_offset    nFileOffsetStart,
+                                             size_t          nSize,
+                                             const char     *pData);
     const CachedRegion* GetRegionFromCacheDisk(const char*     pszURL,
                                                vsi_l_offset nFileOffsetStart);
+    void                PruneCacheDisk();
 
     CURL               *GetCurlHandleFor(CPLString osURL);
+    CURLM              *GetCurlMultiHandleFor(CPLString osURL);
+    void                ReleaseCurlHandlesForCurrentThread();
+
+    int                 GetDownloadChunkSize() const { return nDownloadChunkSize; }
+    static GIntBig      GetCacheMaxSize();
+    static int          GetMaxConnections();
 };
 
 /************************************************************************/
@@ -337,7 +430,13 @@ class VSICurlHandle : public VSIVirtualHandle
     int             nBlocksToDownload;
     bool            bEOF;
 
-    bool            DownloadRegion(vsi_l_offset startOffset, int nBlocks);
+    bool            DownloadRegion(vsi_l_offset startOffset, int nBlocks,
+                                   bool bReadAhead = false);
+    bool            CanDownloadInParallel() const;
+    int             ReadMultiRangeParallel( int nRanges, void ** ppData,
+                                            const vsi_l_offset* panOffsets,
+                                            const size_t* panSizes,
+                                            bool bAllowRestart );
 
     VSICurlReadCbkFunc  pfnReadCbk;
     void               *pReadCbkUserData;
@@ -348,7 +447,24 @@ class VSICurlHandle : public VSIVirtualHandle
     time_t              m_nExpireTimestampLocal;
     CPLString           m_osRedirectURL;
 
+    /* Background download of the chunks following sequential reads */
+    bool                bSequentialReads;
+    int                 nReadAheadWindow;
+    CPLJoinableThread  *hReadAheadThread;
+    CPLMutex           *hReadAheadMutex;
+    CPLCond            *hReadAheadCond;
+    bool                bReadAheadPending;
+    bool                bReadAheadStop;
+    vsi_l_offset        nReadAheadOffset;
+    int                 nReadAheadBlocks;
+
+    static void         ReadAheadThreadFunc(void* pData);
+    void                WaitForReadAhead();
+    void                ScheduleReadAhead();
+
   protected:
+    void                StopReadAhead();
+
     virtual struct curl_slist* GetCurlHeaders(const CPLString& ) { return NULL; }
     bool CanRestartOnError(const char* pszErrorMsg) { return CanRestartOnError(pszErrorMsg, false); }
     virtual bool CanRestartOnError(const char*, bool) { return false; }
@@ -366,6 +482,7 @@ class VSICurlHandle : public VSIVirtualHandle
     virtual size_t       Read( void *pBuffer, size_t nSize, size_t nMemb );
     virtual int          ReadMultiRange( int nRanges, void ** ppData,
                                          const vsi_l_offset* panOffsets, const size_t* panSizes );
+    virtual size_t       PRead( void *pBuffer, size_t nSize, vsi_l_offset nOffset );
     virtual size_t       Write( const void *pBuffer, size_t nSize, size_t nMemb );
     virtual int          Eof();
     virtual int          Flush();
@@ -399,7 +516,16 @@ VSICurlHandle::VSICurlHandle(VSICurlFilesystemHandler* poFSIn, const char* pszUR
     bStopOnInterrruptUntilUninstall(false),
     bInterrupted(false),
     m_bS3Redirect(false),
-    m_nExpireTimestampLocal(0)
+    m_nExpireTimestampLocal(0),
+    bSequentialReads(false),
+    nReadAheadWindow(1),
+    hReadAheadThread(NULL),
+    hReadAheadMutex(NULL),
+    hReadAheadCond(NULL),
+    bReadAheadPending(false),
+    bReadAheadStop(false),
+    nReadAheadOffset(0),
+    nReadAheadBlocks(0)
 {
     pszURL = CPLStrdup(pszURLIn);
     CachedFileProp* cachedFileProp = poFS->GetCachedFileProp(pszURL);
@@ -416,6 +542,7 @@ VSICurlHandle::VSICurlHandle(VSICurlFilesystemHandler* poFSIn, const char* pszUR
 
 VSICurlHandle::~VSICurlHandle()
 {
+    StopReadAhead();
     CPLFree(pszURL);
 }
 
@@ -440,6 +567,9 @@ int   VSICurlHandle::InstallReadCbk(VSICurlReadCbkFunc pfnReadCbkIn,
     if (pfnReadCbk != NULL)
         return FALSE;
 
+    /* The callback must not be called from the read-ahead thread */
+    WaitForReadAhead();
+
     pfnReadCbk = pfnReadCbkIn;
     pReadCbkUserData = pfnUserDataIn;
     bStopOnInterrruptUntilUninstall = CPL_TO_BOOL(bStopOnInterrruptUntilUninstallIn);
@@ -585,6 +715,8 @@ static void VSICURLInitWriteFuncStruct(WriteFuncStruct   *psStruct,
     psStruct->bError = false;
     psStruct->bDownloadHeaderOnly = false;
     psStruct->nTimestampDate = 0;
+    psStruct->nLastModified = 0;
+    psStruct->szETag[0] = '\0';
 
     psStruct->fp = fp;
     psStruct->pfnReadCbk = pfnReadCbk;
@@ -636,6 +768,19 @@ static size_t VSICurlHandleWriteFunc(void *buffer, size_t count, size_t nmemb, v
                 //CPLDebug("VSICURL", "Timestamp = " CPL_FRMT_GIB, nTimestampDate);
                 psStruct->nTimestampDate = nTimestampDate;
             }
+            else if (STARTS_WITH_CI(pszLine, "Last-Modified: "))
+            {
+                CPLString osDate = pszLine + strlen("Last-Modified: ");
+                osDate.Trim();
+                psStruct->nLastModified =
+                    VSICurlGetTimeStampFromRFC822DateTime(osDate);
+            }
+            else if (STARTS_WITH_CI(pszLine, "ETag: "))
+            {
+                CPLString osETag = pszLine + strlen("ETag: ");
+                osETag.Trim();
+                CPLStrlcpy(psStruct->szETag, osETag, sizeof(psStruct->szETag));
+            }
             /*if (nSize > 2 && pszLine[nSize - 2] == '\r' &&
                 pszLine[nSize - 1] == '\n')
             {
@@ -692,6 +837,67 @@ static size_t VSICurlHandleWriteFunc(void *buffer, size_t count, size_t nmemb, v
     }
 }
 
+/************************************************************************/
+/*                         VSICurlRangeRequest                          */
+/************************************************************************/
+
+/* One of the requests of a parallel download. The body is written */
+/* directly into the destination buffer. */
+typedef struct
+{
+    vsi_l_offset        nStartOffset;
+    size_t              nSize;
+    GByte              *pabyDest;
+    size_t              nWritten;
+
+    CURL               *hCurlHandle;
+    struct curl_slist  *psHeaders;
+    WriteFuncStruct     sWriteFuncHeaderData;
+    /* Body of the response if it is not a successful one */
+    WriteFuncStruct     sWriteFuncErrorData;
+    long                nResponseCode;
+    bool                bDone;
+    char                szCurlErrBuf[CURL_ERROR_SIZE+1];
+} VSICurlRangeRequest;
+
+/************************************************************************/
+/*                    VSICurlRangeRequestWriteFunc()                    */
+/************************************************************************/
+
+static size_t VSICurlRangeRequestWriteFunc(void *buffer, size_t count,
+                                           size_t nmemb, void *req)
+{
+    VSICurlRangeRequest* psRequest = (VSICurlRangeRequest*) req;
+    long response_code = 0;
+    curl_easy_getinfo(psRequest->hCurlHandle, CURLINFO_HTTP_CODE, &response_code);
+    if( response_code != 200 && response_code != 206 )
+        return VSICurlHandleWriteFunc(buffer, count, nmemb,
+                                      &psRequest->sWriteFuncErrorData);
+    /* The server ignored the Range header */
+    if( response_code == 200 && psRequest->nStartOffset != 0 )
+        return 0;
+
+    WriteFuncStruct* psStruct = &psRequest->sWriteFuncErrorData;
+    const size_t nSize = count * nmemb;
+    if (psStruct->pfnReadCbk)
+    {
+        if ( ! psStruct->pfnReadCbk(psStruct->fp, buffer, nSize,
+                                    psStruct->pReadCbkUserData) )
+        {
+            psStruct->bInterrupted = true;
+            return 0;
+        }
+    }
+
+    const size_t nToCopy = MIN(nSize, psRequest->nSize - psRequest->nWritten);
+    memcpy(psRequest->pabyDest + psRequest->nWritten, buffer, nToCopy);
+    psRequest->nWritten += nToCopy;
+    /* Stop the transfer if the server sends more than requested */
+    if( nToCopy < nSize )
+        return 0;
+    return nmemb;
+}
+
 /************************************************************************/
 /*                       VSICurlIsS3SignedURL()                         */
 /************************************************************************/
@@ -1000,6 +1206,8 @@ retry:
     cachedFileProp->fileSize = fileSize;
     cachedFileProp->eExists = eExists;
     cachedFileProp->bIsDirectory = bIsDirectory;
+    cachedFileProp->osETag = sWriteFuncHeaderData.szETag;
+    cachedFileProp->nLastModified = sWriteFuncHeaderData.nLastModified;
 
     return fileSize;
 }
@@ -1029,7 +1237,8 @@ vsi_l_offset VSICurlHandle::Tell()
 /*                          DownloadRegion()                            */
 /************************************************************************/
 
-bool VSICurlHandle::DownloadRegion(const vsi_l_offset startOffset, const int nBlocks)
+bool VSICurlHandle::DownloadRegion(const vsi_l_offset startOffset, const int nBlocks,
+                                   const bool bReadAhead)
 {
     WriteFuncStruct sWriteFuncData;
     WriteFuncStruct sWriteFuncHeaderData;
@@ -1040,31 +1249,36 @@ bool VSICurlHandle::DownloadRegion(const vsi_l_offset startOffset, const int nBl
     CachedFileProp* cachedFileProp = poFS->GetCachedFileProp(pszURL);
     if (cachedFileProp->eExists == EXIST_NO)
         return false;
-    if( cachedFileProp->bS3Redirect )
-    {
-        m_bS3Redirect = cachedFileProp->bS3Redirect;
-        m_nExpireTimestampLocal = cachedFileProp->nExpireTimestampLocal;
-        m_osRedirectURL = cachedFileProp->osRedirectURL;
-    }
 
     CURL* hCurlHandle = poFS->GetCurlHandleFor(pszURL);
 
     CPLString osURL(pszURL);
     bool bUsedRedirect = false;
-    if( m_bS3Redirect )
     {
-        if( time(NULL) + 1 < m_nExpireTimestampLocal )
+        /* The handle state might be accessed by concurrent PRead() calls */
+        CPLMutexHolder oHolder( &m_hPReadMutex );
+        if( cachedFileProp->bS3Redirect )
         {
-            CPLDebug("VSICURL", "Using redirect URL as it looks to be still valid (%d seconds left)",
-                     static_cast<int>(m_nExpireTimestampLocal - time(NULL)) );
-            osURL = m_osRedirectURL;
-            bUsedRedirect = true;
+            m_bS3Redirect = cachedFileProp->bS3Redirect;
+            m_nExpireTimestampLocal = cachedFileProp->nExpireTimestampLocal;
+            m_osRedirectURL = cachedFileProp->osRedirectURL;
         }
-        else
+
+        if( m_bS3Redirect )
         {
-            CPLDebug("VSICURL", "Redirect URL has expired. Using original URL");
-            m_bS3Redirect = false;
-            cachedFileProp->bS3Redirect = false;
+            if( time(NULL) + 1 < m_nExpireTimestampLocal )
+            {
+                CPLDebug("VSICURL", "Using redirect URL as it looks to be still valid (%d seconds left)",
+                         static_cast<int>(m_nExpireTimestampLocal - time(NULL)) );
+                osURL = m_osRedirectURL;
+                bUsedRedirect = true;
+            }
+            else
+            {
+                CPLDebug("VSICURL", "Redirect URL has expired. Using original URL");
+                m_bS3Redirect = false;
+                cachedFileProp->bS3Redirect = false;
+            }
         }
     }
 retry:
@@ -1079,7 +1293,9 @@ retry:
     curl_easy_setopt(hCurlHandle, CURLOPT_HEADERFUNCTION, VSICurlHandleWriteFunc);
     sWriteFuncHeaderData.bIsHTTP = STARTS_WITH(pszURL, "http");
     sWriteFuncHeaderData.nStartOffset = startOffset;
-    sWriteFuncHeaderData.nEndOffset = startOffset + nBlocks * DOWNLOAD_CHUNK_SIZE - 1;
+    const int nDownloadChunkSize = poFS->GetDownloadChunkSize();
+    sWriteFuncHeaderData.nEndOffset =
+        startOffset + static_cast<vsi_l_offset>(nBlocks) * nDownloadChunkSize - 1;
     /* Some servers don't like we try to read after end-of-file (#5786) */
     if( cachedFileProp->bHasComputedFileSize &&
         sWriteFuncHeaderData.nEndOffset >= cachedFileProp->fileSize )
@@ -1137,8 +1353,11 @@ retry:
     if( response_code == 403 && bUsedRedirect )
     {
         CPLDebug("VSICURL", "Got an error with redirect URL. Retrying with original one");
-        m_bS3Redirect = false;
-        cachedFileProp->bS3Redirect = false;
+        {
+            CPLMutexHolder oHolder( &m_hPReadMutex );
+            m_bS3Redirect = false;
+            cachedFileProp->bS3Redirect = false;
+        }
         bUsedRedirect = false;
         osURL = pszURL;
         CPLFree(sWriteFuncData.pBuffer);
@@ -1148,28 +1367,32 @@ retry:
 
     char *pszEffectiveURL = NULL;
     curl_easy_getinfo(hCurlHandle, CURLINFO_EFFECTIVE_URL, &pszEffectiveURL);
-    if( !m_bS3Redirect && pszEffectiveURL != NULL && strstr(pszEffectiveURL, pszURL) == NULL )
     {
-        CPLDebug("VSICURL", "Effective URL: %s", pszEffectiveURL);
-        if( response_code >= 200 && response_code < 300 &&
-            sWriteFuncHeaderData.nTimestampDate > 0 &&
-            VSICurlIsS3SignedURL(pszEffectiveURL) && !VSICurlIsS3SignedURL(pszURL) &&
-            CSLTestBoolean(CPLGetConfigOption("CPL_VSIL_CURL_USE_S3_REDIRECT", "TRUE")) )
+        /* The handle state might be accessed by concurrent PRead() calls */
+        CPLMutexHolder oHolder( &m_hPReadMutex );
+        if( !m_bS3Redirect && pszEffectiveURL != NULL && strstr(pszEffectiveURL, pszURL) == NULL )
         {
-            GIntBig nExpireTimestamp = VSICurlGetExpiresFromS3SigneURL(pszEffectiveURL);
-            if( nExpireTimestamp > sWriteFuncHeaderData.nTimestampDate + 10 )
+            CPLDebug("VSICURL", "Effective URL: %s", pszEffectiveURL);
+            if( response_code >= 200 && response_code < 300 &&
+                sWriteFuncHeaderData.nTimestampDate > 0 &&
+                VSICurlIsS3SignedURL(pszEffectiveURL) && !VSICurlIsS3SignedURL(pszURL) &&
+                CSLTestBoolean(CPLGetConfigOption("CPL_VSIL_CURL_USE_S3_REDIRECT", "TRUE")) )
             {
-                int nValidity = static_cast<int>(nExpireTimestamp - sWriteFuncHeaderData.nTimestampDate);
-                CPLDebug("VSICURL", "Will use redirect URL for the next %d seconds",
-                         nValidity);
-                // As our local clock might not be in sync with server clock,
-                // figure out the expiration timestamp in local time
-                m_bS3Redirect = true;
-                m_nExpireTimestampLocal = time(NULL) + nValidity;
-                m_osRedirectURL = pszEffectiveURL;
-                cachedFileProp->bS3Redirect = m_bS3Redirect;
-                cachedFileProp->nExpireTimestampLocal = m_nExpireTimestampLocal;
-                cachedFileProp->osRedirectURL = m_osRedirectURL;
+                GIntBig nExpireTimestamp = VSICurlGetExpiresFromS3SigneURL(pszEffectiveURL);
+                if( nExpireTimestamp > sWriteFuncHeaderData.nTimestampDate + 10 )
+                {
+                    int nValidity = static_cast<int>(nExpireTimestamp - sWriteFuncHeaderData.nTimestampDate);
+                    CPLDebug("VSICURL", "Will use redirect URL for the next %d seconds",
+                             nValidity);
+                    // As our local clock might not be in sync with server clock,
+                    // figure out the expiration timestamp in local time
+                    m_bS3Redirect = true;
+                    m_nExpireTimestampLocal = time(NULL) + nValidity;
+                    m_osRedirectURL = pszEffectiveURL;
+                    cachedFileProp->bS3Redirect = m_bS3Redirect;
+                    cachedFileProp->nExpireTimestampLocal = m_nExpireTimestampLocal;
+                    cachedFileProp->osRedirectURL = m_osRedirectURL;
+                }
             }
         }
     }
@@ -1177,7 +1400,9 @@ retry:
     if ((response_code != 200 && response_code != 206 &&
          response_code != 225 && response_code != 226 && response_code != 426) || sWriteFuncHeaderData.bError)
     {
-        if( sWriteFuncData.pBuffer != NULL &&
+        /* Restarting may change the URL, which is only safe from the */
+        /* thread of the caller. */
+        if( !bReadAhead && sWriteFuncData.pBuffer != NULL &&
             CanRestartOnError((const char*)sWriteFuncData.pBuffer) )
         {
             CPLFree(sWriteFuncData.pBuffer);
@@ -1194,91 +1419,99 @@ retry:
             else
                 CPLError(CE_Failure, CPLE_AppDefined, "%d: %s", (int)response_code, szCurlErrBuf);
         }
-        if (!bHasComputedFileSize && startOffset == 0)
         {
-            cachedFileProp->bHasComputedFileSize = bHasComputedFileSize = true;
-            cachedFileProp->fileSize = fileSize = 0;
-            cachedFileProp->eExists = eExists = EXIST_NO;
+            CPLMutexHolder oHolder( &m_hPReadMutex );
+            if (!bHasComputedFileSize && startOffset == 0)
+            {
+                cachedFileProp->bHasComputedFileSize = bHasComputedFileSize = true;
+                cachedFileProp->fileSize = fileSize = 0;
+                cachedFileProp->eExists = eExists = EXIST_NO;
+            }
         }
         CPLFree(sWriteFuncData.pBuffer);
         CPLFree(sWriteFuncHeaderData.pBuffer);
         return false;
     }
 
-    if (!bHasComputedFileSize && sWriteFuncHeaderData.pBuffer)
     {
-        /* Try to retrieve the filesize from the HTTP headers */
-        /* if in the form : "Content-Range: bytes x-y/filesize" */
-        char* pszContentRange = strstr(sWriteFuncHeaderData.pBuffer, "Content-Range: bytes ");
-        if (pszContentRange)
+        CPLMutexHolder oHolder( &m_hPReadMutex );
+        if (!bHasComputedFileSize && sWriteFuncHeaderData.pBuffer)
         {
-            char* pszEOL = strchr(pszContentRange, '\n');
-            if (pszEOL)
+            /* Try to retrieve the filesize from the HTTP headers */
+            /* if in the form : "Content-Range: bytes x-y/filesize" */
+            char* pszContentRange = strstr(sWriteFuncHeaderData.pBuffer, "Content-Range: bytes ");
+            if (pszContentRange)
             {
-                *pszEOL = 0;
-                pszEOL = strchr(pszContentRange, '\r');
+                char* pszEOL = strchr(pszContentRange, '\n');
                 if (pszEOL)
-                    *pszEOL = 0;
-                char* pszSlash = strchr(pszContentRange, '/');
-                if (pszSlash)
                 {
-                    pszSlash ++;
-                    fileSize = CPLScanUIntBig(pszSlash, static_cast<int>(strlen(pszSlash)));
+                    *pszEOL = 0;
+                    pszEOL = strchr(pszContentRange, '\r');
+                    if (pszEOL)
+                        *pszEOL = 0;
+                    char* pszSlash = strchr(pszContentRange, '/');
+                    if (pszSlash)
+                    {
+                        pszSlash ++;
+                        fileSize = CPLScanUIntBig(pszSlash, static_cast<int>(strlen(pszSlash)));
+                    }
                 }
             }
-        }
-        else if (STARTS_WITH(pszURL, "ftp"))
-        {
-            /* Parse 213 answer for FTP protocol */
-            char* pszSize = strstr(sWriteFuncHeaderData.pBuffer, "213 ");
-            if (pszSize)
+            else if (STARTS_WITH(pszURL, "ftp"))
             {
-                pszSize += 4;
-                char* pszEOL = strchr(pszSize, '\n');
-                if (pszEOL)
+                /* Parse 213 answer for FTP protocol */
+                char* pszSize = strstr(sWriteFuncHeaderData.pBuffer, "213 ");
+                if (pszSize)
                 {
-                    *pszEOL = 0;
-                    pszEOL = strchr(pszSize, '\r');
+                    pszSize += 4;
+                    char* pszEOL = strchr(pszSize, '\n');
                     if (pszEOL)
+                    {
                         *pszEOL = 0;
+                        pszEOL = strchr(pszSize, '\r');
+                        if (pszEOL)
+                            *pszEOL = 0;
 
-                    fileSize = CPLScanUIntBig(pszSize, static_cast<int>(strlen(pszSize)));
+                        fileSize = CPLScanUIntBig(pszSize, static_cast<int>(strlen(pszSize)));
+                    }
                 }
             }
-        }
 
-        if (fileSize != 0)
-        {
-            eExists = EXIST_YES;
+            if (fileSize != 0)
+            {
+                eExists = EXIST_YES;
 
-            if (ENABLE_DEBUG)
-                CPLDebug("VSICURL", "GetFileSize(%s)=" CPL_FRMT_GUIB "  response_code=%d",
-                        pszURL, fileSize, (int)response_code);
+                if (ENABLE_DEBUG)
+                    CPLDebug("VSICURL", "GetFileSize(%s)=" CPL_FRMT_GUIB "  response_code=%d",
+                            pszURL, fileSize, (int)response_code);
 
-            bHasComputedFileSize = cachedFileProp->bHasComputedFileSize = true;
-            cachedFileProp->fileSize = fileSize;
-            cachedFileProp->eExists = eExists;
+                bHasComputedFileSize = cachedFileProp->bHasComputedFileSize = true;
+                cachedFileProp->fileSize = fileSize;
+                cachedFileProp->eExists = eExists;
+            }
         }
     }
 
-    lastDownloadedOffset = startOffset + nBlocks * DOWNLOAD_CHUNK_SIZE;
+    lastDownloadedOffset =
+        startOffset + static_cast<vsi_l_offset>(nBlocks) * nDownloadChunkSize;
 
     char* pBuffer = sWriteFuncData.pBuffer;
     size_t nSize = sWriteFuncData.nSize;
 
-    if (nSize > static_cast<size_t>(nBlocks) * DOWNLOAD_CHUNK_SIZE)
+    if (nSize > static_cast<size_t>(nBlocks) * nDownloadChunkSize)
     {
         if (ENABLE_DEBUG)
-            CPLDebug("VSICURL", "Got more data than expected : %u instead of %d",
-                     static_cast<unsigned int>(nSize), nBlocks * DOWNLOAD_CHUNK_SIZE);
+            CPLDebug("VSICURL", "Got more data than expected : %u instead of %u",
+                     static_cast<unsigned int>(nSize),
+                     static_cast<unsigned int>(nBlocks * nDownloadChunkSize));
     }
 
     vsi_l_offset l_startOffset = startOffset;
     while(nSize > 0)
     {
         //if (ENABLE_DEBUG)
-        //    CPLDebug("VSICURL", "Add region %d - %d", startOffset, MIN(DOWNLOAD_CHUNK_SIZE, nSize));
-        size_t nChunkSize = MIN((size_t)DOWNLOAD_CHUNK_SIZE, nSize);
+        //    CPLDebug("VSICURL", "Add region %d - %d", startOffset, MIN(nDownloadChunkSize, nSize));
+        size_t nChunkSize = MIN((size_t)nDownloadChunkSize, nSize);
         poFS->AddRegion(pszURL, l_startOffset, nChunkSize, pBuffer);
         l_startOffset += nChunkSize;
         pBuffer += nChunkSize;
@@ -1304,14 +1537,59 @@ size_t VSICurlHandle::Read( void * const pBufferIn, size_t const  nSize, size_t
 
     //CPLDebug("VSICURL", "offset=%d, size=%d", (int)curOffset, (int)nBufferRequestSize);
 
+    const int nDownloadChunkSize = poFS->GetDownloadChunkSize();
+
+    /* Large reads of data not in cache are split in ranges downloaded */
+    /* in parallel directly in the user buffer, without going through */
+    /* the cache that could not hold them anyway. */
+    /* The read-ahead may update the region cache and the file size, so */
+    /* wait for it before looking at them. */
+    const bool bLargeRead =
+        nBufferRequestSize >= static_cast<size_t>(2 * PARALLEL_MIN_CHUNKS_PER_REQUEST) *
+                                                  nDownloadChunkSize &&
+        CanDownloadInParallel();
+    if( bLargeRead )
+        WaitForReadAhead();
+    if( bLargeRead &&
+        poFS->GetRegion(pszURL, curOffset) == NULL &&
+        curOffset < GetFileSize() )
+    {
+        const size_t nToRead = static_cast<size_t>(
+            MIN(static_cast<vsi_l_offset>(nBufferRequestSize), fileSize - curOffset));
+        const vsi_l_offset nOffset = curOffset;
+        if( ReadMultiRangeParallel(1, &pBuffer, &nOffset, &nToRead, true) != 0 )
+        {
+            if (!bInterrupted)
+                bEOF = true;
+            return 0;
+        }
+        size_t ret = nToRead / nSize;
+        if (ret != nMemb)
+            bEOF = true;
+        curOffset += nToRead;
+        return ret;
+    }
+
     vsi_l_offset iterOffset = curOffset;
     while (nBufferRequestSize)
     {
-        const CachedRegion* psRegion = poFS->GetRegion(pszURL, iterOffset);
-        if (psRegion == NULL)
+        size_t nToCopy = 0;
+        size_t nRegionSize = 0;
+        bool bFound = poFS->CopyFromRegion(pszURL, iterOffset, pBuffer,
+                                           nBufferRequestSize,
+                                           &nToCopy, &nRegionSize);
+        if (!bFound && hReadAheadThread != NULL)
+        {
+            /* The data may be in the process of being downloaded */
+            WaitForReadAhead();
+            bFound = poFS->CopyFromRegion(pszURL, iterOffset, pBuffer,
+                                          nBufferRequestSize,
+                                          &nToCopy, &nRegionSize);
+        }
+        if (!bFound)
         {
             vsi_l_offset nOffsetToDownload =
-                (iterOffset / DOWNLOAD_CHUNK_SIZE) * DOWNLOAD_CHUNK_SIZE;
+                (iterOffset / nDownloadChunkSize) * nDownloadChunkSize;
 
             if (nOffsetToDownload == lastDownloadedOffset)
             {
@@ -1321,34 +1599,47 @@ size_t VSICurlHandle::Read( void * const pBufferIn, size_t const  nSize, size_t
                 /* client/server roundtrips. */
                 if (nBlocksToDownload < 100)
                     nBlocksToDownload *= 2;
+                if (!bSequentialReads)
+                {
+                    bSequentialReads = true;
+                    nReadAheadWindow = nBlocksToDownload;
+                }
             }
             else
             {
                 /* Random reads. Cancel the above heuristics */
                 nBlocksToDownload = 1;
+                bSequentialReads = false;
             }
 
             /* Ensure that we will request at least the number of blocks */
             /* to satisfy the remaining buffer size to read */
             vsi_l_offset nEndOffsetToDownload =
-                ((iterOffset + nBufferRequestSize) / DOWNLOAD_CHUNK_SIZE) * DOWNLOAD_CHUNK_SIZE;
+                ((iterOffset + nBufferRequestSize) / nDownloadChunkSize) * nDownloadChunkSize;
             int nMinBlocksToDownload = 1 + (int)
-                ((nEndOffsetToDownload - nOffsetToDownload) / DOWNLOAD_CHUNK_SIZE);
+                ((nEndOffsetToDownload - nOffsetToDownload) / nDownloadChunkSize);
             if (nBlocksToDownload < nMinBlocksToDownload)
                 nBlocksToDownload = nMinBlocksToDownload;
 
             /* Avoid reading already cached data */
             for( int i=1; i < nBlocksToDownload; i++ )
             {
-                if (poFS->GetRegion(pszURL, nOffsetToDownload + i * DOWNLOAD_CHUNK_SIZE) != NULL)
+                if (poFS->GetRegion(pszURL, nOffsetToDownload +
+                        static_cast<vsi_l_offset>(i) * nDownloadChunkSize) != NULL)
                 {
                     nBlocksToDownload = i;
                     break;
                 }
             }
 
-            if( nBlocksToDownload > N_MAX_REGIONS )
-                nBlocksToDownload = N_MAX_REGIONS;
+            /* Do not download more than what the cache can hold, otherwise */
+            /* the first chunks would be evicted before we can use them. */
+            /* The cache accounts for the size of each region structure too. */
+            const GIntBig nMaxBlocks = std::max(static_cast<GIntBig>(1),
+                VSICurlFilesystemHandler::GetCacheMaxSize() /
+                    (nDownloadChunkSize + static_cast<GIntBig>(sizeof(CachedRegion))));
+            if( nBlocksToDownload > nMaxBlocks )
+                nBlocksToDownload = static_cast<int>(nMaxBlocks);
 
             if (DownloadRegion(nOffsetToDownload, nBlocksToDownload) == false)
             {
@@ -1356,20 +1647,19 @@ size_t VSICurlHandle::Read( void * const pBufferIn, size_t const  nSize, size_t
                     bEOF = true;
                 return 0;
             }
-            psRegion = poFS->GetRegion(pszURL, iterOffset);
+            bFound = poFS->CopyFromRegion(pszURL, iterOffset, pBuffer,
+                                          nBufferRequestSize,
+                                          &nToCopy, &nRegionSize);
         }
-        if (psRegion == NULL || psRegion->pData == NULL)
+        if (!bFound || nToCopy == 0)
         {
             bEOF = true;
             return 0;
         }
-        int nToCopy = (int) MIN(nBufferRequestSize, psRegion->nSize - (iterOffset - psRegion->nFileOffsetStart));
-        memcpy(pBuffer, psRegion->pData + iterOffset - psRegion->nFileOffsetStart,
-                nToCopy);
         pBuffer = (char*) pBuffer + nToCopy;
         iterOffset += nToCopy;
         nBufferRequestSize -= nToCopy;
-        if (psRegion->nSize != (size_t)DOWNLOAD_CHUNK_SIZE && nBufferRequestSize != 0)
+        if (nRegionSize != (size_t)nDownloadChunkSize && nBufferRequestSize != 0)
         {
             break;
         }
@@ -1381,9 +1671,166 @@ size_t VSICurlHandle::Read( void * const pBufferIn, size_t const  nSize, size_t
 
     curOffset = iterOffset;
 
+    ScheduleReadAhead();
+
     return ret;
 }
 
+/************************************************************************/
+/*                        ReadAheadThreadFunc()                         */
+/************************************************************************/
+
+void VSICurlHandle::ReadAheadThreadFunc(void* pData)
+{
+    VSICurlHandle* poHandle = static_cast<VSICurlHandle*>(pData);
+
+    /* Errors are reported by the synchronous download that follows */
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+
+    CPLAcquireMutex(poHandle->hReadAheadMutex, 1000.0);
+    while( true )
+    {
+        while( !poHandle->bReadAheadPending && !poHandle->bReadAheadStop )
+            CPLCondWait(poHandle->hReadAheadCond, poHandle->hReadAheadMutex);
+        if( poHandle->bReadAheadStop )
+            break;
+
+        const vsi_l_offset nOffset = poHandle->nReadAheadOffset;
+        const int nBlocks = poHandle->nReadAheadBlocks;
+        CPLReleaseMutex(poHandle->hReadAheadMutex);
+
+        poHandle->DownloadRegion(nOffset, nBlocks, true);
+
+        CPLAcquireMutex(poHandle->hReadAheadMutex, 1000.0);
+        poHandle->bReadAheadPending = false;
+        CPLCondBroadcast(poHandle->hReadAheadCond);
+    }
+    CPLReleaseMutex(poHandle->hReadAheadMutex);
+
+    poHandle->poFS->ReleaseCurlHandlesForCurrentThread();
+
+    CPLPopErrorHandler();
+}
+
+/************************************************************************/
+/*                          WaitForReadAhead()                          */
+/*                                                                      */
+/*      Wait for the completion of the pending read-ahead, so that the  */
+/*      state of the handle can be safely accessed.                     */
+/************************************************************************/
+
+void VSICurlHandle::WaitForReadAhead()
+{
+    if( hReadAheadThread == NULL )
+        return;
+
+    CPLAcquireMutex(hReadAheadMutex, 1000.0);
+    while( bReadAheadPending )
+        CPLCondWait(hReadAheadCond, hReadAheadMutex);
+    CPLReleaseMutex(hReadAheadMutex);
+}
+
+/************************************************************************/
+/*                         ScheduleReadAhead()                          */
+/*                                                                      */
+/*      During sequential reads, start downloading in the background    */
+/*      the chunks that follow the last downloaded ones once half of    */
+/*      the window ahead of the current position has been consumed.     */
+/*      The window doubles each time, up to a quarter of the cache.     */
+/************************************************************************/
+
+void VSICurlHandle::ScheduleReadAhead()
+{
+    if( !bSequentialReads || pfnReadCbk != NULL || !bHasComputedFileSize )
+        return;
+
+    if( hReadAheadThread != NULL )
+    {
+        CPLAcquireMutex(hReadAheadMutex, 1000.0);
+        const bool bBusy = bReadAheadPending;
+        CPLReleaseMutex(hReadAheadMutex);
+        if( bBusy )
+            return;
+    }
+    else if( !CSLTestBoolean(CPLGetConfigOption("CPL_VSIL_CURL_READ_AHEAD", "YES")) )
+    {
+        return;
+    }
+
+    /* lastDownloadedOffset is not modified by the idle thread */
+    const int nDownloadChunkSize = poFS->GetDownloadChunkSize();
+    if( lastDownloadedOffset >= fileSize ||
+        curOffset + static_cast<vsi_l_offset>(nReadAheadWindow) *
+                        nDownloadChunkSize / 2 < lastDownloadedOffset )
+        return;
+
+    const vsi_l_offset nRemainingBlocks =
+        (fileSize - lastDownloadedOffset + nDownloadChunkSize - 1) /
+                                                        nDownloadChunkSize;
+    const int nBlocks = static_cast<int>(
+        MIN(static_cast<vsi_l_offset>(nReadAheadWindow), nRemainingBlocks));
+
+    if( hReadAheadThread == NULL )
+    {
+        hReadAheadMutex = CPLCreateMutex();
+        CPLReleaseMutex(hReadAheadMutex);
+        hReadAheadCond = CPLCreateCond();
+        hReadAheadThread = CPLCreateJoinableThread(ReadAheadThreadFunc, this);
+        if( hReadAheadThread == NULL )
+        {
+            CPLDestroyCond(hReadAheadCond);
+            hReadAheadCond = NULL;
+            CPLDestroyMutex(hReadAheadMutex);
+            hReadAheadMutex = NULL;
+            bSequentialReads = false;
+            return;
+        }
+    }
+
+    if (ENABLE_DEBUG)
+        CPLDebug("VSICURL", "Read-ahead of %d chunks at offset " CPL_FRMT_GUIB,
+                 nBlocks, lastDownloadedOffset);
+
+    CPLAcquireMutex(hReadAheadMutex, 1000.0);
+    nReadAheadOffset = lastDownloadedOffset;
+    nReadAheadBlocks = nBlocks;
+    bReadAheadPending = true;
+    CPLCondBroadcast(hReadAheadCond);
+    CPLReleaseMutex(hReadAheadMutex);
+
+    const GIntBig nMaxWindow = std::max(static_cast<GIntBig>(1),
+        VSICurlFilesystemHandler::GetCacheMaxSize() / 4 / nDownloadChunkSize);
+    if( 2 * static_cast<GIntBig>(nReadAheadWindow) <= nMaxWindow )
+        nReadAheadWindow *= 2;
+    else
+        nReadAheadWindow = static_cast<int>(nMaxWindow);
+}
+
+/************************************************************************/
+/*                           StopReadAhead()                            */
+/************************************************************************/
+
+void VSICurlHandle::StopReadAhead()
+{
+    if( hReadAheadThread == NULL )
+        return;
+
+    CPLAcquireMutex(hReadAheadMutex, 1000.0);
+    bReadAheadStop = true;
+    CPLCondBroadcast(hReadAheadCond);
+    CPLReleaseMutex(hReadAheadMutex);
+    CPLJoinThread(hReadAheadThread);
+    hReadAheadThread = NULL;
+
+    CPLDestroyCond(hReadAheadCond);
+    hReadAheadCond = NULL;
+    CPLDestroyMutex(hReadAheadMutex);
+    hReadAheadMutex = NULL;
+    bReadAheadPending = false;
+    bReadAheadStop = false;
+    bSequentialReads = false;
+}
+
 
 /************************************************************************/
 /*                           ReadMultiRange()                           */
@@ -1403,6 +1850,11 @@ int VSICurlHandle::ReadMultiRange( int const nRanges, void ** const ppData,
     if (cachedFileProp->eExists == EXIST_NO)
         return -1;
 
+    WaitForReadAhead();
+
+    if( CanDownloadInParallel() )
+        return ReadMultiRangeParallel(nRanges, ppData, panOffsets, panSizes, true);
+
     CPLString osRanges, osFirstRange, osLastRange;
     int nMergedRanges = 0;
     vsi_l_offset nTotalReqSize = 0;
@@ -1742,73 +2194,517 @@ end:
 }
 
 /************************************************************************/
-/*                               Write()                                */
-/************************************************************************/
-
-size_t VSICurlHandle::Write( CPL_UNUSED const void *pBuffer,
-                             CPL_UNUSED size_t nSize,
-                             CPL_UNUSED size_t nMemb )
-{
-    return 0;
-}
-
-/************************************************************************/
-/*                                 Eof()                                */
+/*                       CanDownloadInParallel()                        */
 /************************************************************************/
 
-
-int       VSICurlHandle::Eof()
+bool VSICurlHandle::CanDownloadInParallel() const
 {
-    return bEOF;
+    /* FTP servers commonly restrict the number of connections per client */
+    return STARTS_WITH(pszURL, "http") &&
+           EQUAL(CPLGetConfigOption("GDAL_HTTP_MULTIRANGE", "PARALLEL"),
+                 "PARALLEL");
 }
 
 /************************************************************************/
-/*                                 Flush()                              */
+/*                    ReleaseRangeRequestHandle()                       */
 /************************************************************************/
 
-int       VSICurlHandle::Flush()
+static void ReleaseRangeRequestHandle( CURLM* hCurlMultiHandle,
+                                       VSICurlRangeRequest* psRequest )
 {
-    return 0;
+    if( psRequest->hCurlHandle == NULL )
+        return;
+    curl_multi_remove_handle(hCurlMultiHandle, psRequest->hCurlHandle);
+    curl_easy_cleanup(psRequest->hCurlHandle);
+    psRequest->hCurlHandle = NULL;
+    if( psRequest->psHeaders != NULL )
+        curl_slist_free_all(psRequest->psHeaders);
+    psRequest->psHeaders = NULL;
 }
 
 /************************************************************************/
-/*                                  Close()                             */
+/*                       ReadMultiRangeParallel()                       */
+/*                                                                      */
+/*      Download the ranges with simultaneous single range requests,    */
+/*      at most CPL_VSIL_CURL_MAX_CONNECTIONS at a time, over the       */
+/*      keep-alive connections of the calling thread. Contiguous        */
+/*      ranges are merged, and large ranges are split so that all the   */
+/*      connections are used.                                           */
 /************************************************************************/
 
-int       VSICurlHandle::Close()
+int VSICurlHandle::ReadMultiRangeParallel( int const nRanges, void ** const ppData,
+                                           const vsi_l_offset* const panOffsets,
+                                           const size_t* const panSizes,
+                                           bool bAllowRestart )
 {
-    return 0;
-}
-
+    if (bInterrupted && bStopOnInterrruptUntilUninstall)
+        return -1;
 
+    CachedFileProp* cachedFileProp = poFS->GetCachedFileProp(pszURL);
+    if (cachedFileProp->eExists == EXIST_NO)
+        return -1;
 
+    CPLString osURL(pszURL);
+    bool bUsedRedirect = false;
+    {
+        /* This method can be called concurrently by PRead() */
+        CPLMutexHolder oHolder( &m_hPReadMutex );
+        if( cachedFileProp->bS3Redirect )
+        {
+            m_bS3Redirect = cachedFileProp->bS3Redirect;
+            m_nExpireTimestampLocal = cachedFileProp->nExpireTimestampLocal;
+            m_osRedirectURL = cachedFileProp->osRedirectURL;
+        }
 
-/************************************************************************/
-/*                   VSICurlFilesystemHandler()                         */
-/************************************************************************/
+        if( m_bS3Redirect && time(NULL) + 1 < m_nExpireTimestampLocal )
+        {
+            osURL = m_osRedirectURL;
+            bUsedRedirect = true;
+        }
+    }
 
-VSICurlFilesystemHandler::VSICurlFilesystemHandler()
-{
-    hMutex = NULL;
-    papsRegions = NULL;
-    nRegions = 0;
-    bUseCacheDisk = CSLTestBoolean(CPLGetConfigOption("CPL_VSIL_CURL_USE_CACHE", "NO"));
-}
+/* -------------------------------------------------------------------- */
+/*      Build the list of requests. Merged ranges are downloaded in a   */
+/*      temporary buffer, the others directly in the user buffers.      */
+/* -------------------------------------------------------------------- */
+    const size_t nMinRequestSize =
+        static_cast<size_t>(PARALLEL_MIN_CHUNKS_PER_REQUEST) *
+        poFS->GetDownloadChunkSize();
+    const int nMaxConnections = VSICurlFilesystemHandler::GetMaxConnections();
+
+    std::vector<VSICurlRangeRequest> asRequests;
+    std::vector<int> anMergedFirstRange;
+    std::vector<int> anMergedRangeCount;
+    std::vector<GByte*> apabyMergedBuffer;
+    bool bError = false;
+    for( int i = 0; i < nRanges && !bError; )
+    {
+        const int iFirstRange = i;
+        size_t nMergedSize = panSizes[i];
+        while (i + 1 < nRanges && panOffsets[i] + panSizes[i] == panOffsets[i+1])
+        {
+            i ++;
+            nMergedSize += panSizes[i];
+        }
+        i ++;
+        if( nMergedSize == 0 )
+            continue;
 
-/************************************************************************/
-/*                  ~VSICurlFilesystemHandler()                         */
-/************************************************************************/
+        GByte* pabyDest = static_cast<GByte*>(ppData[iFirstRange]);
+        if( i - iFirstRange > 1 )
+        {
+            pabyDest = static_cast<GByte*>(VSI_MALLOC_VERBOSE(nMergedSize));
+            if( pabyDest == NULL )
+            {
+                bError = true;
+                break;
+            }
+            anMergedFirstRange.push_back(iFirstRange);
+            anMergedRangeCount.push_back(i - iFirstRange);
+            apabyMergedBuffer.push_back(pabyDest);
+        }
 
-VSICurlFilesystemHandler::~VSICurlFilesystemHandler()
-{
-    for( int i=0; i < nRegions; i++ )
-    {
-        CPLFree(papsRegions[i]->pData);
-        CPLFree(papsRegions[i]);
+        size_t nRequests = MIN(static_cast<size_t>(nMaxConnections),
+                               nMergedSize / nMinRequestSize);
+        if( nRequests == 0 )
+            nRequests = 1;
+        const size_t nRequestSize = (nMergedSize + nRequests - 1) / nRequests;
+        for( size_t nOffset = 0; nOffset < nMergedSize; nOffset += nRequestSize )
+        {
+            VSICurlRangeRequest sRequest;
+            memset(&sRequest, 0, sizeof(sRequest));
+            sRequest.nStartOffset = panOffsets[iFirstRange] + nOffset;
+            sRequest.nSize = MIN(nRequestSize, nMergedSize - nOffset);
+            sRequest.pabyDest = pabyDest + nOffset;
+            asRequests.push_back(sRequest);
+        }
     }
-    CPLFree(papsRegions);
 
-    std::map<CPLString, CachedFileProp*>::const_iterator iterCacheFileSize;
+    if (ENABLE_DEBUG && !bError)
+        CPLDebug("VSICURL", "Downloading %d ranges with %d requests (%s)...",
+                 nRanges, static_cast<int>(asRequests.size()), osURL.c_str());
+
+/* -------------------------------------------------------------------- */
+/*      Run the requests, starting a new one each time one completes.   */
+/* -------------------------------------------------------------------- */
+    CURLM* hCurlMultiHandle = poFS->GetCurlMultiHandleFor(osURL);
+    size_t iNextRequest = 0;
+    int nRunning = 0;
+    while( true )
+    {
+        while( !bError && iNextRequest < asRequests.size() &&
+               nRunning < nMaxConnections )
+        {
+            VSICurlRangeRequest* psRequest = &asRequests[iNextRequest];
+            iNextRequest ++;
+
+            CURL* hCurlHandle = curl_easy_init();
+            psRequest->hCurlHandle = hCurlHandle;
+            VSICurlSetOptions(hCurlHandle, osURL);
+            curl_easy_setopt(hCurlHandle, CURLOPT_PRIVATE, psRequest);
+
+            VSICURLInitWriteFuncStruct(&psRequest->sWriteFuncErrorData,
+                                       (VSILFILE*)this, pfnReadCbk, pReadCbkUserData);
+            curl_easy_setopt(hCurlHandle, CURLOPT_WRITEDATA, psRequest);
+            curl_easy_setopt(hCurlHandle, CURLOPT_WRITEFUNCTION,
+                             VSICurlRangeRequestWriteFunc);
+
+            VSICURLInitWriteFuncStruct(&psRequest->sWriteFuncHeaderData, NULL, NULL, NULL);
+            curl_easy_setopt(hCurlHandle, CURLOPT_HEADERDATA,
+                             &psRequest->sWriteFuncHeaderData);
+            curl_easy_setopt(hCurlHandle, CURLOPT_HEADERFUNCTION, VSICurlHandleWriteFunc);
+            psRequest->sWriteFuncHeaderData.bIsHTTP = true;
+            psRequest->sWriteFuncHeaderData.nStartOffset = psRequest->nStartOffset;
+            psRequest->sWriteFuncHeaderData.nEndOffset =
+                psRequest->nStartOffset + psRequest->nSize - 1;
+
+            char rangeStr[512];
+            snprintf(rangeStr, sizeof(rangeStr),
+                     CPL_FRMT_GUIB "-" CPL_FRMT_GUIB, psRequest->nStartOffset,
+                     psRequest->sWriteFuncHeaderData.nEndOffset);
+            curl_easy_setopt(hCurlHandle, CURLOPT_RANGE, rangeStr);
+
+            psRequest->szCurlErrBuf[0] = '\0';
+            curl_easy_setopt(hCurlHandle, CURLOPT_ERRORBUFFER, psRequest->szCurlErrBuf );
+
+            psRequest->psHeaders = GetCurlHeaders("GET");
+            if( psRequest->psHeaders != NULL )
+                curl_easy_setopt(hCurlHandle, CURLOPT_HTTPHEADER, psRequest->psHeaders);
+
+            curl_multi_add_handle(hCurlMultiHandle, hCurlHandle);
+            nRunning ++;
+        }
+        if( nRunning == 0 )
+            break;
+
+        int nStillRunning = 0;
+        while (curl_multi_perform(hCurlMultiHandle, &nStillRunning) == CURLM_CALL_MULTI_PERFORM);
+
+        CURLMsg* psMsg;
+        int nMsgsInQueue = 0;
+        while( (psMsg = curl_multi_info_read(hCurlMultiHandle, &nMsgsInQueue)) != NULL )
+        {
+            if( psMsg->msg != CURLMSG_DONE )
+                continue;
+            VSICurlRangeRequest* psRequest = NULL;
+            curl_easy_getinfo(psMsg->easy_handle, CURLINFO_PRIVATE, &psRequest);
+            psRequest->bDone = true;
+            curl_easy_getinfo(psMsg->easy_handle, CURLINFO_HTTP_CODE,
+                              &psRequest->nResponseCode);
+            ReleaseRangeRequestHandle(hCurlMultiHandle, psRequest);
+            nRunning --;
+
+            if( (psRequest->nResponseCode != 200 && psRequest->nResponseCode != 206) ||
+                psRequest->sWriteFuncHeaderData.bError ||
+                psRequest->sWriteFuncErrorData.bInterrupted ||
+                psRequest->nWritten != psRequest->nSize )
+            {
+                /* Do not start the remaining requests */
+                bError = true;
+            }
+        }
+
+        if( nStillRunning > 0 )
+        {
+            fd_set fdread, fdwrite, fdexcep;
+            int maxfd = -1;
+            FD_ZERO(&fdread);
+            FD_ZERO(&fdwrite);
+            FD_ZERO(&fdexcep);
+            curl_multi_fdset(hCurlMultiHandle, &fdread, &fdwrite, &fdexcep, &maxfd);
+            if( maxfd >= 0 )
+            {
+                struct timeval timeout;
+                timeout.tv_sec = 0;
+                timeout.tv_usec = 100000;
+                if( select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout) < 0 )
+                {
+                    CPLError(CE_Failure, CPLE_AppDefined, "select() failed");
+                    bError = true;
+                    for( size_t i = 0; i < iNextRequest; i++ )
+                        ReleaseRangeRequestHandle(hCurlMultiHandle, &asRequests[i]);
+                    nRunning = 0;
+                }
+            }
+            else
+            {
+                CPLSleep(0.01);
+            }
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Analyze the failed request, if any.                             */
+/* -------------------------------------------------------------------- */
+    int nRet = bError ? -1 : 0;
+    bool bRestart = false;
+    bool bAllowNextRestart = bAllowRestart;
+    {
+        /* The handle state might be modified by concurrent PRead() calls */
+        CPLMutexHolder oHolder( &m_hPReadMutex );
+        for( size_t i = 0; i < iNextRequest; i++ )
+        {
+            VSICurlRangeRequest* psRequest = &asRequests[i];
+            if( nRet == 0 || !psRequest->bDone ||
+                ((psRequest->nResponseCode == 200 || psRequest->nResponseCode == 206) &&
+                 !psRequest->sWriteFuncHeaderData.bError &&
+                 !psRequest->sWriteFuncErrorData.bInterrupted &&
+                 psRequest->nWritten == psRequest->nSize) )
+            {
+                continue;
+            }
+            if( bRestart || bInterrupted )
+                continue;
+
+            if( psRequest->sWriteFuncErrorData.bInterrupted )
+            {
+                bInterrupted = true;
+            }
+            else if( psRequest->nResponseCode == 403 && bUsedRedirect )
+            {
+                CPLDebug("VSICURL", "Got an error with redirect URL. Retrying with original one");
+                m_bS3Redirect = false;
+                cachedFileProp->bS3Redirect = false;
+                bRestart = true;
+            }
+            else if( bAllowRestart &&
+                     psRequest->sWriteFuncErrorData.pBuffer != NULL &&
+                     CanRestartOnError((const char*)psRequest->sWriteFuncErrorData.pBuffer) )
+            {
+                bRestart = true;
+                bAllowNextRestart = false;
+            }
+            else if (psRequest->nResponseCode >= 400 && psRequest->szCurlErrBuf[0] != '\0')
+            {
+                CPLError(CE_Failure, CPLE_AppDefined, "%d: %s",
+                         (int)psRequest->nResponseCode, psRequest->szCurlErrBuf);
+            }
+            else if( psRequest->nResponseCode == 200 && psRequest->nStartOffset != 0 )
+            {
+                CPLError(CE_Failure, CPLE_AppDefined,
+                         "Range downloading not supported by this server !");
+            }
+            else if( !psRequest->sWriteFuncHeaderData.bError )
+            {
+                CPLError(CE_Failure, CPLE_AppDefined,
+                         "%d: Got " CPL_FRMT_GUIB " bytes instead of " CPL_FRMT_GUIB
+                         " at offset " CPL_FRMT_GUIB,
+                         (int)psRequest->nResponseCode,
+                         (GUIntBig)psRequest->nWritten, (GUIntBig)psRequest->nSize,
+                         (GUIntBig)psRequest->nStartOffset);
+            }
+        }
+    }
+
+    for( size_t i = 0; i < asRequests.size(); i++ )
+    {
+        CPLFree(asRequests[i].sWriteFuncHeaderData.pBuffer);
+        CPLFree(asRequests[i].sWriteFuncErrorData.pBuffer);
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Copy the merged ranges to the user buffers.                     */
+/* -------------------------------------------------------------------- */
+    for( size_t i = 0; i < apabyMergedBuffer.size(); i++ )
+    {
+        if( nRet == 0 )
+        {
+            size_t nAccSize = 0;
+            for( int j = 0; j < anMergedRangeCount[i]; j++ )
+            {
+                const int iRange = anMergedFirstRange[i] + j;
+                memcpy(ppData[iRange], apabyMergedBuffer[i] + nAccSize,
+                       panSizes[iRange]);
+                nAccSize += panSizes[iRange];
+            }
+        }
+        VSIFree(apabyMergedBuffer[i]);
+    }
+
+    if( bRestart )
+        return ReadMultiRangeParallel(nRanges, ppData, panOffsets, panSizes,
+                                      bAllowNextRestart);
+
+    return nRet;
+}
+
+/************************************************************************/
+/*                               PRead()                                */
+/************************************************************************/
+
+size_t VSICurlHandle::PRead( void *pBuffer, size_t nSize, vsi_l_offset nOffset )
+{
+    if( nSize == 0 )
+        return 0;
+
+    if( !CanDownloadInParallel() )
+        return VSIVirtualHandle::PRead(pBuffer, nSize, nOffset);
+
+    /* A read-ahead started by a previous Read() updates the handle state */
+    WaitForReadAhead();
+
+/* -------------------------------------------------------------------- */
+/*      Serve what we can from the region cache, which is shared by     */
+/*      all handles and protected by the mutex of the filesystem.       */
+/* -------------------------------------------------------------------- */
+    GByte* pabyBuffer = static_cast<GByte*>(pBuffer);
+    const int nDownloadChunkSize = poFS->GetDownloadChunkSize();
+    size_t nDone = 0;
+    while( nDone < nSize )
+    {
+        size_t nToCopy = 0;
+        size_t nRegionSize = 0;
+        if( !poFS->CopyFromRegion(pszURL, nOffset + nDone, pabyBuffer + nDone,
+                                  nSize - nDone, &nToCopy, &nRegionSize) ||
+            nToCopy == 0 )
+        {
+            break;
+        }
+        nDone += nToCopy;
+        /* A partial region is the last one of the file */
+        if( nRegionSize != static_cast<size_t>(nDownloadChunkSize) )
+            return nDone;
+    }
+    if( nDone == nSize )
+        return nDone;
+
+/* -------------------------------------------------------------------- */
+/*      Download the rest directly in the user buffer, over the         */
+/*      connections of the calling thread.                              */
+/* -------------------------------------------------------------------- */
+    vsi_l_offset nFileSize;
+    {
+        CPLMutexHolder oHolder( &m_hPReadMutex );
+        nFileSize = GetFileSize();
+    }
+    const vsi_l_offset nStartOffset = nOffset + nDone;
+    if( nStartOffset >= nFileSize )
+        return nDone;
+    const size_t nToRead = static_cast<size_t>(
+        MIN(static_cast<vsi_l_offset>(nSize - nDone), nFileSize - nStartOffset));
+    void* pDest = pabyBuffer + nDone;
+    if( ReadMultiRangeParallel(1, &pDest, &nStartOffset, &nToRead, true) != 0 )
+        return nDone;
+
+/* -------------------------------------------------------------------- */
+/*      Add the chunks entirely covered by the download to the region   */
+/*      cache, unless the request is large enough to evict much of it.  */
+/* -------------------------------------------------------------------- */
+    if( static_cast<GIntBig>(nToRead) <=
+                        VSICurlFilesystemHandler::GetCacheMaxSize() / 4 )
+    {
+        const vsi_l_offset nEnd = nStartOffset + nToRead;
+        vsi_l_offset nChunkStart =
+            ((nStartOffset + nDownloadChunkSize - 1) / nDownloadChunkSize) *
+                                                        nDownloadChunkSize;
+        while( nChunkStart < nEnd )
+        {
+            const size_t nChunkSize = static_cast<size_t>(
+                MIN(static_cast<vsi_l_offset>(nDownloadChunkSize),
+                    nFileSize - nChunkStart));
+            if( nChunkStart + nChunkSize > nEnd )
+                break;
+            poFS->AddRegion(pszURL, nChunkStart, nChunkSize,
+                            reinterpret_cast<const char*>(pabyBuffer) + nDone +
+                                static_cast<size_t>(nChunkStart - nStartOffset));
+            nChunkStart += nChunkSize;
+        }
+    }
+
+    return nDone + nToRead;
+}
+
+/************************************************************************/
+/*                               Write()                                */
+/************************************************************************/
+
+size_t VSICurlHandle::Write( CPL_UNUSED const void *pBuffer,
+                             CPL_UNUSED size_t nSize,
+                             CPL_UNUSED size_t nMemb )
+{
+    return 0;
+}
+
+/************************************************************************/
+/*                                 Eof()                                */
+/************************************************************************/
+
+
+int       VSICurlHandle::Eof()
+{
+    return bEOF;
+}
+
+/************************************************************************/
+/*                                 Flush()                              */
+/************************************************************************/
+
+int       VSICurlHandle::Flush()
+{
+    return 0;
+}
+
+/************************************************************************/
+/*                                  Close()                             */
+/************************************************************************/
+
+int       VSICurlHandle::Close()
+{
+    StopReadAhead();
+    return 0;
+}
+
+
+
+
+/************************************************************************/
+/*                   VSICurlFilesystemHandler()                         */
+/************************************************************************/
+
+VSICurlFilesystemHandler::VSICurlFilesystemHandler()
+{
+    hMutex = NULL;
+    hRegionSet = CPLHashSetNew(VSICurlRegionHash, VSICurlRegionEqual, NULL);
+    psRegionMRU = NULL;
+    psRegionLRU = NULL;
+    nRegionsMemSize = 0;
+    /* Check the size of the on-disk cache at the first write */
+    nCacheDiskWrittenSinceCheck = DEFAULT_CACHE_DIR_SIZE;
+
+    /* Must be constant during the life of the handler, since the cached */
+    /* regions are aligned on it */
+    const GIntBig nChunkSize = CPLAtoGIntBig(
+        CPLGetConfigOption("CPL_VSIL_CURL_CHUNK_SIZE",
+                           CPLSPrintf("%d", DEFAULT_DOWNLOAD_CHUNK_SIZE)));
+    if( nChunkSize < 1024 || nChunkSize > MAX_DOWNLOAD_CHUNK_SIZE )
+    {
+        CPLError(CE_Warning, CPLE_AppDefined,
+                 "Invalid value for CPL_VSIL_CURL_CHUNK_SIZE. "
+                 "Using %d instead", DEFAULT_DOWNLOAD_CHUNK_SIZE);
+        nDownloadChunkSize = DEFAULT_DOWNLOAD_CHUNK_SIZE;
+    }
+    else
+    {
+        nDownloadChunkSize = static_cast<int>(nChunkSize);
+    }
+}
+
+/************************************************************************/
+/*                  ~VSICurlFilesystemHandler()                         */
+/************************************************************************/
+
+VSICurlFilesystemHandler::~VSICurlFilesystemHandler()
+{
+    CPLHashSetDestroy(hRegionSet);
+    while( psRegionMRU != NULL )
+    {
+        CachedRegion* psNext = psRegionMRU->psNext;
+        CPLFree(psRegionMRU->pData);
+        CPLFree(psRegionMRU);
+        psRegionMRU = psNext;
+    }
+
+    std::map<CPLString, CachedFileProp*>::const_iterator iterCacheFileSize;
 
     for( iterCacheFileSize = cacheFileSize.begin(); iterCacheFileSize != cacheFileSize.end(); iterCacheFileSize++ )
     {
@@ -1827,6 +2723,8 @@ VSICurlFilesystemHandler::~VSICurlFilesystemHandler()
     for( iterConnections = mapConnections.begin(); iterConnections != mapConnections.end(); iterConnections++ )
     {
         curl_easy_cleanup(iterConnections->second->hCurlHandle);
+        if( iterConnections->second->hCurlMultiHandle != NULL )
+            curl_multi_cleanup(iterConnections->second->hCurlMultiHandle);
         delete iterConnections->second;
     }
 
@@ -1852,6 +2750,7 @@ CURL* VSICurlFilesystemHandler::GetCurlHandleFor(CPLString osURL)
         CachedConnection* psCachedConnection = new CachedConnection;
         psCachedConnection->osURL = osURL;
         psCachedConnection->hCurlHandle = hCurlHandle;
+        psCachedConnection->hCurlMultiHandle = NULL;
         mapConnections[CPLGetPID()] = psCachedConnection;
         return hCurlHandle;
     }
@@ -1882,6 +2781,138 @@ CURL* VSICurlFilesystemHandler::GetCurlHandleFor(CPLString osURL)
     }
 }
 
+/************************************************************************/
+/*                      GetCurlMultiHandleFor()                         */
+/*                                                                      */
+/*      Return the per-thread curl multi handle used for parallel       */
+/*      downloads. Its connection cache is kept between calls so        */
+/*      that connections to the same server are reused.                 */
+/************************************************************************/
+
+CURLM* VSICurlFilesystemHandler::GetCurlMultiHandleFor(CPLString osURL)
+{
+    /* Make sure the per-thread entry exists */
+    GetCurlHandleFor(osURL);
+
+    CPLMutexHolder oHolder( &hMutex );
+
+    CachedConnection* psCachedConnection = mapConnections[CPLGetPID()];
+    if( psCachedConnection->hCurlMultiHandle == NULL )
+        psCachedConnection->hCurlMultiHandle = curl_multi_init();
+    return psCachedConnection->hCurlMultiHandle;
+}
+
+/************************************************************************/
+/*                 ReleaseCurlHandlesForCurrentThread()                 */
+/*                                                                      */
+/*      Close the connections of the calling thread. To be called by    */
+/*      short-lived threads before they exit, since their entry would   */
+/*      otherwise be kept until the handler is destroyed.               */
+/************************************************************************/
+
+void VSICurlFilesystemHandler::ReleaseCurlHandlesForCurrentThread()
+{
+    CPLMutexHolder oHolder( &hMutex );
+
+    std::map<GIntBig, CachedConnection*>::iterator iterConnections =
+        mapConnections.find(CPLGetPID());
+    if( iterConnections == mapConnections.end() )
+        return;
+
+    curl_easy_cleanup(iterConnections->second->hCurlHandle);
+    if( iterConnections->second->hCurlMultiHandle != NULL )
+        curl_multi_cleanup(iterConnections->second->hCurlMultiHandle);
+    delete iterConnections->second;
+    mapConnections.erase(iterConnections);
+}
+
+
+/************************************************************************/
+/*                        IsCacheDiskEnabled()                          */
+/************************************************************************/
+
+bool VSICurlFilesystemHandler::IsCacheDiskEnabled()
+{
+    return CPL_TO_BOOL(CSLTestBoolean(
+        CPLGetConfigOption("CPL_VSIL_CURL_USE_CACHE", "NO"))) &&
+           !GetCacheDiskDirectory().empty();
+}
+
+/************************************************************************/
+/*                       GetCacheDiskDirectory()                        */
+/*                                                                      */
+/*      Defaults to a per-user directory in the directory of the        */
+/*      temporary files. Unlike CPLGenerateTempFilename(), do not fall  */
+/*      back to the current directory, that other processes would not  */
+/*      share: use /tmp on Unix, and disable the cache on Windows.      */
+/************************************************************************/
+
+CPLString VSICurlFilesystemHandler::GetCacheDiskDirectory()
+{
+    const char* pszDir = CPLGetConfigOption("CPL_VSIL_CURL_CACHE_DIR", NULL);
+    if( pszDir != NULL )
+        return pszDir;
+
+    pszDir = CPLGetConfigOption("CPL_TMPDIR", NULL);
+    if( pszDir == NULL )
+        pszDir = CPLGetConfigOption("TMPDIR", NULL);
+    if( pszDir == NULL )
+        pszDir = CPLGetConfigOption("TEMP", NULL);
+#ifdef WIN32
+    if( pszDir == NULL )
+        return CPLString();
+    return CPLFormFilename(pszDir, "gdal_vsicurl_cache", NULL);
+#else
+    if( pszDir == NULL )
+        pszDir = "/tmp";
+    return CPLFormFilename(pszDir,
+                           CPLSPrintf("gdal_vsicurl_cache_%d",
+                                      static_cast<int>(getuid())), NULL);
+#endif
+}
+
+/************************************************************************/
+/*                       GetCacheDiskFilename()                         */
+/*                                                                      */
+/*      The cache files are named after the SHA256 of a key made of     */
+/*      the URL, the validators of the remote file (ETag,               */
+/*      Last-Modified and size), the chunk size and the offset of the   */
+/*      chunk. A modified remote file thus gets new cache files, and    */
+/*      the stale ones end up being evicted. Returns false when the     */
+/*      remote file has no validator.                                   */
+/************************************************************************/
+
+bool VSICurlFilesystemHandler::GetCacheDiskFilename(const char* pszURL,
+                                                    vsi_l_offset nFileOffsetStart,
+                                                    CPLString& osFilename,
+                                                    CPLString& osKey)
+{
+    CPLMutexHolder oHolder( &hMutex );
+
+    CachedFileProp* cachedFileProp = GetCachedFileProp(pszURL);
+    if( !cachedFileProp->bHasComputedFileSize ||
+        cachedFileProp->eExists != EXIST_YES ||
+        (cachedFileProp->osETag.empty() && cachedFileProp->nLastModified == 0) )
+    {
+        return false;
+    }
+
+    osKey.Printf("%s\n%s\n" CPL_FRMT_GIB "\n" CPL_FRMT_GUIB "\n%d\n" CPL_FRMT_GUIB,
+                 pszURL, cachedFileProp->osETag.c_str(),
+                 cachedFileProp->nLastModified,
+                 (GUIntBig)cachedFileProp->fileSize,
+                 nDownloadChunkSize, (GUIntBig)nFileOffsetStart);
+
+    GByte abyHash[CPL_SHA256_HASH_SIZE];
+    CPL_SHA256(osKey.c_str(), osKey.size(), abyHash);
+    char* pszHash = CPLBinaryToHex(CPL_SHA256_HASH_SIZE, abyHash);
+    /* Spread the files in 256 sub-directories */
+    const CPLString osSubDir(CPLFormFilename(GetCacheDiskDirectory(),
+                                             CPLSPrintf("%.2s", pszHash), NULL));
+    osFilename = CPLFormFilename(osSubDir, pszHash, NULL);
+    CPLFree(pszHash);
+    return true;
+}
 
 /************************************************************************/
 /*                   GetRegionFromCacheDisk()                           */
@@ -1891,136 +2922,350 @@ const CachedRegion*
 VSICurlFilesystemHandler::GetRegionFromCacheDisk(const char* pszURL,
                                                  vsi_l_offset nFileOffsetStart)
 {
-    nFileOffsetStart = (nFileOffsetStart / DOWNLOAD_CHUNK_SIZE) * DOWNLOAD_CHUNK_SIZE;
-    VSILFILE* fp = VSIFOpenL(VSICurlGetCacheFileName(), "rb");
-    if (fp)
+    nFileOffsetStart = (nFileOffsetStart / nDownloadChunkSize) * nDownloadChunkSize;
+
+    /* Called without hMutex held, so that other threads are not blocked */
+    /* by the disk I/O */
+    CPLString osFilename, osKey;
+    if( !GetCacheDiskFilename(pszURL, nFileOffsetStart, osFilename, osKey) )
+        return NULL;
+
+    VSIStatBufL sStat;
+    if( VSIStatL(osFilename, &sStat) != 0 )
+        return NULL;
+    /* Files are renamed once complete, so they cannot be partial, but */
+    /* they may have been evicted meanwhile by another process */
+    VSILFILE* fp = VSIFOpenL(osFilename, "rb");
+    if( fp == NULL )
+        return NULL;
+
+    const size_t nMagicSize = strlen(CACHE_DISK_MAGIC);
+    const vsi_l_offset nHeaderSize = nMagicSize + sizeof(GUInt32) + osKey.size();
+    char szMagic[sizeof(CACHE_DISK_MAGIC)] = { '\0' };
+    GUInt32 nKeySize = 0;
+    if( static_cast<vsi_l_offset>(sStat.st_size) < nHeaderSize ||
+        static_cast<vsi_l_offset>(sStat.st_size) - nHeaderSize >
+                        static_cast<vsi_l_offset>(nDownloadChunkSize) ||
+        VSIFReadL(szMagic, 1, nMagicSize, fp) != nMagicSize ||
+        memcmp(szMagic, CACHE_DISK_MAGIC, nMagicSize) != 0 ||
+        VSIFReadL(&nKeySize, 1, sizeof(nKeySize), fp) != sizeof(nKeySize) ||
+        CPL_LSBWORD32(nKeySize) != osKey.size() )
     {
-        unsigned long   pszURLHash = CPLHashSetHashStr(pszURL);
-        vsi_l_offset    nFileOffsetStartCached;
-        while(true)
+        CPL_IGNORE_RET_VAL(VSIFCloseL(fp));
+        return NULL;
+    }
+
+    const size_t nSize = static_cast<size_t>(sStat.st_size - nHeaderSize);
+    char* pBuffer = static_cast<char*>(CPLMalloc(osKey.size() + nSize + 1));
+    const bool bOK =
+        VSIFReadL(pBuffer, 1, osKey.size() + nSize, fp) == osKey.size() + nSize &&
+        memcmp(pBuffer, osKey.c_str(), osKey.size()) == 0;
+    CPL_IGNORE_RET_VAL(VSIFCloseL(fp));
+    if( !bOK )
+    {
+        CPLFree(pBuffer);
+        return NULL;
+    }
+
+    if (ENABLE_DEBUG)
+        CPLDebug("VSICURL", "Got data at offset " CPL_FRMT_GUIB " from disk",
+                 nFileOffsetStart);
+    InsertRegion(pszURL, nFileOffsetStart, nSize,
+                 nSize ? pBuffer + osKey.size() : NULL);
+    CPLFree(pBuffer);
+
+    /* The modification time of the files is the last access time used */
+    /* for the eviction. Do not update it at each access. */
+    if( sStat.st_mtime + 60 < time(NULL) )
+        utime(osFilename, NULL);
+
+    CPLMutexHolder oHolder( &hMutex );
+    return FindRegionInRAM(pszURL, nFileOffsetStart);
+}
+
+/************************************************************************/
+/*                  AddRegionToCacheDisk()                                */
+/************************************************************************/
+
+void VSICurlFilesystemHandler::AddRegionToCacheDisk(const char* pszURL,
+                                                    vsi_l_offset nFileOffsetStart,
+                                                    size_t nSize,
+                                                    const char* pData)
+{
+    /* Called without hMutex held, so that other threads are not blocked */
+    /* by the disk I/O. The data is the one of the caller, since the */
+    /* cached region could be evicted meanwhile. */
+    CPLString osFilename, osKey;
+    if( !GetCacheDiskFilename(pszURL, nFileOffsetStart, osFilename, osKey) )
+        return;
+
+    VSIStatBufL sStat;
+    if( VSIStatL(osFilename, &sStat) == 0 )
+        return;
+
+    const CPLString osSubDir(CPLGetPath(osFilename));
+    if( VSIStatL(osSubDir, &sStat) != 0 )
+    {
+        VSIMkdir(GetCacheDiskDirectory(), 0700);
+        VSIMkdir(osSubDir, 0755);
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Write in a temporary file, renamed once complete, so that       */
+/*      other processes never see a partial file.                       */
+/* -------------------------------------------------------------------- */
+    static volatile int nTmpCounter = 0;
+    const CPLString osTmpFilename(
+        osFilename + CPLSPrintf(".%d_%d.tmp", CPLGetCurrentProcessID(),
+                                CPLAtomicInc(&nTmpCounter)));
+    VSILFILE* fp = VSIFOpenL(osTmpFilename, "wb");
+    if( fp == NULL )
+        return;
+
+    if (ENABLE_DEBUG)
+        CPLDebug("VSICURL", "Write data at offset " CPL_FRMT_GUIB " to disk",
+                 nFileOffsetStart);
+    const size_t nMagicSize = strlen(CACHE_DISK_MAGIC);
+    GUInt32 nKeySize = static_cast<GUInt32>(osKey.size());
+    CPL_LSBPTR32(&nKeySize);
+    bool bOK =
+        VSIFWriteL(CACHE_DISK_MAGIC, 1, nMagicSize, fp) == nMagicSize &&
+        VSIFWriteL(&nKeySize, 1, sizeof(nKeySize), fp) == sizeof(nKeySize) &&
+        VSIFWriteL(osKey.c_str(), 1, osKey.size(), fp) == osKey.size() &&
+        (nSize == 0 || VSIFWriteL(pData, 1, nSize, fp) == nSize);
+    if( VSIFCloseL(fp) != 0 )
+        bOK = false;
+    if( !bOK || VSIRename(osTmpFilename, osFilename) != 0 )
+    {
+        VSIUnlink(osTmpFilename);
+        return;
+    }
+
+    bool bMustPrune = false;
+    {
+        CPLMutexHolder oHolder( &hMutex );
+        nCacheDiskWrittenSinceCheck += nMagicSize + sizeof(nKeySize) +
+                                       osKey.size() + nSize;
+        if( nCacheDiskWrittenSinceCheck > GetCacheDiskMaxSize() / 10 )
         {
-            unsigned long pszURLHashCached = 0;
-            if (VSIFReadL(&pszURLHashCached, sizeof(unsigned long), 1, fp) == 0)
-                break;
-            if( VSIFReadL(&nFileOffsetStartCached, sizeof(vsi_l_offset), 1, fp) == 0)
-                break;
-            size_t nSizeCached = 0;
-            if( VSIFReadL(&nSizeCached, sizeof(size_t), 1, fp) == 0)
-                break;
-            if (pszURLHash == pszURLHashCached &&
-                nFileOffsetStart == nFileOffsetStartCached)
-            {
-                if (ENABLE_DEBUG)
-                    CPLDebug("VSICURL", "Got data at offset " CPL_FRMT_GUIB " from disk" , nFileOffsetStart);
-                if (nSizeCached)
-                {
-                    char* pBuffer = (char*) CPLMalloc(nSizeCached);
-                    if( VSIFReadL(pBuffer, 1, nSizeCached, fp) != nSizeCached )
-                    {
-                        CPLFree(pBuffer);
-                        break;
-                    }
-                    AddRegion(pszURL, nFileOffsetStart, nSizeCached, pBuffer);
-                    CPLFree(pBuffer);
-                }
-                else
-                {
-                    AddRegion(pszURL, nFileOffsetStart, 0, NULL);
-                }
-                CPL_IGNORE_RET_VAL(VSIFCloseL(fp));
-                return GetRegion(pszURL, nFileOffsetStart);
-            }
-            else
-            {
-                if( VSIFSeekL(fp, nSizeCached, SEEK_CUR) != 0 )
-                    break;
-            }
+            nCacheDiskWrittenSinceCheck = 0;
+            bMustPrune = true;
         }
-        CPL_IGNORE_RET_VAL(VSIFCloseL(fp));
     }
-    return NULL;
+    if( bMustPrune )
+        PruneCacheDisk();
 }
 
+/************************************************************************/
+/*                        GetCacheDiskMaxSize()                         */
+/************************************************************************/
+
+GIntBig VSICurlFilesystemHandler::GetCacheDiskMaxSize()
+{
+    const GIntBig nCacheSize = CPLAtoGIntBig(
+        CPLGetConfigOption("CPL_VSIL_CURL_CACHE_DIR_SIZE",
+                           CPLSPrintf(CPL_FRMT_GIB, DEFAULT_CACHE_DIR_SIZE)));
+    return ( nCacheSize > 0 ) ? nCacheSize : DEFAULT_CACHE_DIR_SIZE;
+}
 
 /************************************************************************/
-/*                  AddRegionToCacheDisk()                                */
+/*                           PruneCacheDisk()                           */
+/*                                                                      */
+/*      Remove the least recently used files of the on-disk cache       */
+/*      until it is back to 90% of its maximum size. Only one process   */
+/*      does it at a time.                                              */
 /************************************************************************/
 
-void VSICurlFilesystemHandler::AddRegionToCacheDisk(CachedRegion* psRegion)
+namespace {
+typedef struct
+{
+    time_t      nMTime;
+    GIntBig     nSize;
+    CPLString   osFilename;
+} CacheDiskFile;
+}
+
+static bool CompareCacheDiskFileMTime(const CacheDiskFile& oA,
+                                      const CacheDiskFile& oB)
+{
+    return oA.nMTime < oB.nMTime;
+}
+
+void VSICurlFilesystemHandler::PruneCacheDisk()
 {
-    VSILFILE* fp = VSIFOpenL(VSICurlGetCacheFileName(), "r+b");
-    if (fp)
+    const CPLString osDir(GetCacheDiskDirectory());
+    const CPLString osLock(CPLFormFilename(osDir, "prune", NULL));
+
+    /* Remove the lock left by a process that died while pruning */
+    VSIStatBufL sStat;
+    if( VSIStatL((osLock + ".lock").c_str(), &sStat) == 0 &&
+        sStat.st_mtime + 600 < time(NULL) )
     {
-        while(true)
+        VSIUnlink((osLock + ".lock").c_str());
+    }
+    void* hLock = CPLLockFile(osLock, 0.0);
+    if( hLock == NULL )
+        return;
+
+    std::vector<CacheDiskFile> aoFiles;
+    GIntBig nTotalSize = 0;
+    const time_t nNow = time(NULL);
+    char** papszSubDirs = VSIReadDir(osDir);
+    for( int i = 0; papszSubDirs != NULL && papszSubDirs[i] != NULL; i++ )
+    {
+        if( strlen(papszSubDirs[i]) != 2 )
+            continue;
+        const CPLString osSubDir(CPLFormFilename(osDir, papszSubDirs[i], NULL));
+        char** papszFiles = VSIReadDir(osSubDir);
+        for( int j = 0; papszFiles != NULL && papszFiles[j] != NULL; j++ )
         {
-            unsigned long pszURLHashCached = 0;
-            if (VSIFReadL(&pszURLHashCached, 1, sizeof(unsigned long), fp) == 0)
-                break;
-            vsi_l_offset nFileOffsetStartCached = 0;
-            if( VSIFReadL(&nFileOffsetStartCached, sizeof(vsi_l_offset), 1, fp) == 0 )
-                break;
-            size_t nSizeCached = 0;
-            if( VSIFReadL(&nSizeCached, sizeof(size_t), 1, fp) == 0 )
-                break;
-            if (psRegion->pszURLHash == pszURLHashCached &&
-                psRegion->nFileOffsetStart == nFileOffsetStartCached)
-            {
-                CPLAssert(psRegion->nSize == nSizeCached);
-                CPL_IGNORE_RET_VAL(VSIFCloseL(fp));
-                return;
-            }
-            else
+            const CPLString osFilename(
+                CPLFormFilename(osSubDir, papszFiles[j], NULL));
+            if( papszFiles[j][0] == '.' || VSIStatL(osFilename, &sStat) != 0 )
+                continue;
+            if( EQUAL(CPLGetExtension(papszFiles[j]), "tmp") )
             {
-                if( VSIFSeekL(fp, nSizeCached, SEEK_CUR) != 0 )
-                    break;
+                /* Left by a process that died while writing */
+                if( sStat.st_mtime + 3600 < nNow )
+                    VSIUnlink(osFilename);
+                continue;
             }
+            CacheDiskFile oFile;
+            oFile.nMTime = sStat.st_mtime;
+            oFile.nSize = static_cast<GIntBig>(sStat.st_size);
+            oFile.osFilename = osFilename;
+            aoFiles.push_back(oFile);
+            nTotalSize += oFile.nSize;
         }
+        CSLDestroy(papszFiles);
     }
-    else
-    {
-        fp = VSIFOpenL(VSICurlGetCacheFileName(), "wb");
-    }
-    if (fp)
+    CSLDestroy(papszSubDirs);
+
+    const GIntBig nMaxSize = GetCacheDiskMaxSize();
+    if( nTotalSize > nMaxSize )
     {
+        std::sort(aoFiles.begin(), aoFiles.end(), CompareCacheDiskFileMTime);
+        const GIntBig nTargetSize = nMaxSize / 10 * 9;
+        size_t i = 0;
+        for( ; i < aoFiles.size() && nTotalSize > nTargetSize; i++ )
+        {
+            VSIUnlink(aoFiles[i].osFilename);
+            nTotalSize -= aoFiles[i].nSize;
+        }
         if (ENABLE_DEBUG)
-             CPLDebug("VSICURL", "Write data at offset " CPL_FRMT_GUIB " to disk" , psRegion->nFileOffsetStart);
-        CPL_IGNORE_RET_VAL(VSIFWriteL(&psRegion->pszURLHash, 1, sizeof(unsigned long), fp));
-        CPL_IGNORE_RET_VAL(VSIFWriteL(&psRegion->nFileOffsetStart, 1, sizeof(vsi_l_offset), fp));
-        CPL_IGNORE_RET_VAL(VSIFWriteL(&psRegion->nSize, 1, sizeof(size_t), fp));
-        if (psRegion->nSize)
-            CPL_IGNORE_RET_VAL(VSIFWriteL(psRegion->pData, 1, psRegion->nSize, fp));
-
-        CPL_IGNORE_RET_VAL(VSIFCloseL(fp));
+            CPLDebug("VSICURL", "Removed %d of %d files from the disk cache",
+                     static_cast<int>(i), static_cast<int>(aoFiles.size()));
     }
-    return;
+
+    CPLUnlockFile(hLock);
 }
 
 
 /************************************************************************/
-/*                          GetRegion()                                 */
+/*                          GetCacheMaxSize()                           */
+/*                                                                      */
+/*      Maximum size in bytes of the downloaded regions kept in RAM.    */
+/*      Read at each call, so that it can be changed at runtime.        */
 /************************************************************************/
 
-const CachedRegion* VSICurlFilesystemHandler::GetRegion(const char* pszURL,
-                                                        vsi_l_offset nFileOffsetStart)
+GIntBig VSICurlFilesystemHandler::GetCacheMaxSize()
 {
-    CPLMutexHolder oHolder( &hMutex );
+    const GIntBig nCacheSize = CPLAtoGIntBig(
+        CPLGetConfigOption("CPL_VSIL_CURL_CACHE_SIZE",
+                           CPLSPrintf(CPL_FRMT_GIB, DEFAULT_CACHE_SIZE)));
+    return ( nCacheSize > 0 ) ? nCacheSize : DEFAULT_CACHE_SIZE;
+}
+
+/************************************************************************/
+/*                         GetMaxConnections()                          */
+/*                                                                      */
+/*      Maximum number of simultaneous connections used to download     */
+/*      the ranges of a single read.                                    */
+/************************************************************************/
+
+int VSICurlFilesystemHandler::GetMaxConnections()
+{
+    const int nMaxConnections = atoi(
+        CPLGetConfigOption("CPL_VSIL_CURL_MAX_CONNECTIONS",
+                           CPLSPrintf("%d", DEFAULT_MAX_CONNECTIONS)));
+    return ( nMaxConnections > 0 ) ? nMaxConnections : DEFAULT_MAX_CONNECTIONS;
+}
+
+/************************************************************************/
+/*                           UnlinkRegion()                             */
+/************************************************************************/
+
+void VSICurlFilesystemHandler::UnlinkRegion(CachedRegion* psRegion)
+{
+    if( psRegion->psPrev )
+        psRegion->psPrev->psNext = psRegion->psNext;
+    else
+        psRegionMRU = psRegion->psNext;
+    if( psRegion->psNext )
+        psRegion->psNext->psPrev = psRegion->psPrev;
+    else
+        psRegionLRU = psRegion->psPrev;
+    psRegion->psPrev = NULL;
+    psRegion->psNext = NULL;
+}
+
+/************************************************************************/
+/*                          LinkRegionAsMRU()                           */
+/************************************************************************/
+
+void VSICurlFilesystemHandler::LinkRegionAsMRU(CachedRegion* psRegion)
+{
+    psRegion->psPrev = NULL;
+    psRegion->psNext = psRegionMRU;
+    if( psRegionMRU )
+        psRegionMRU->psPrev = psRegion;
+    psRegionMRU = psRegion;
+    if( psRegionLRU == NULL )
+        psRegionLRU = psRegion;
+}
+
+/************************************************************************/
+/*                          FindRegionInRAM()                           */
+/*                                                                      */
+/*      Look the region that contains nFileOffsetStart up in the RAM    */
+/*      cache, and mark it as the most recently used one. Must be       */
+/*      called with hMutex held.                                        */
+/************************************************************************/
 
-    unsigned long   pszURLHash = CPLHashSetHashStr(pszURL);
+CachedRegion* VSICurlFilesystemHandler::FindRegionInRAM(const char* pszURL,
+                                                        vsi_l_offset nFileOffsetStart)
+{
+    CachedRegion sKey;
+    sKey.pszURLHash = CPLHashSetHashStr(pszURL);
+    sKey.nFileOffsetStart =
+        (nFileOffsetStart / nDownloadChunkSize) * nDownloadChunkSize;
+
+    CachedRegion* psRegion =
+        static_cast<CachedRegion*>(CPLHashSetLookup(hRegionSet, &sKey));
+    if( psRegion != NULL && psRegion != psRegionMRU )
+    {
+        UnlinkRegion(psRegion);
+        LinkRegionAsMRU(psRegion);
+    }
+    return psRegion;
+}
 
-    nFileOffsetStart = (nFileOffsetStart / DOWNLOAD_CHUNK_SIZE) * DOWNLOAD_CHUNK_SIZE;
+/************************************************************************/
+/*                          GetRegion()                                 */
+/************************************************************************/
 
-    for( int i=0; i < nRegions; i++ )
+const CachedRegion* VSICurlFilesystemHandler::GetRegion(const char* pszURL,
+                                                        vsi_l_offset nFileOffsetStart)
+{
     {
-        CachedRegion* psRegion = papsRegions[i];
-        if (psRegion->pszURLHash == pszURLHash &&
-            nFileOffsetStart == psRegion->nFileOffsetStart)
-        {
-            memmove(papsRegions + 1, papsRegions, i * sizeof(CachedRegion*));
-            papsRegions[0] = psRegion;
+        CPLMutexHolder oHolder( &hMutex );
+
+        CachedRegion* psRegion = FindRegionInRAM(pszURL, nFileOffsetStart);
+        if( psRegion != NULL )
             return psRegion;
-        }
     }
-    if (bUseCacheDisk)
+    /* The disk cache is read without hMutex held */
+    if (IsCacheDiskEnabled())
         return GetRegionFromCacheDisk(pszURL, nFileOffsetStart);
     return NULL;
 }
@@ -2033,37 +3278,110 @@ void  VSICurlFilesystemHandler::AddRegion(const char* pszURL,
                                           vsi_l_offset    nFileOffsetStart,
                                           size_t          nSize,
                                           const char     *pData)
+{
+    CachedRegion* psRegion = InsertRegion(pszURL, nFileOffsetStart, nSize, pData);
+    if (psRegion != NULL && IsCacheDiskEnabled())
+        AddRegionToCacheDisk(pszURL, nFileOffsetStart, nSize, pData);
+}
+
+/************************************************************************/
+/*                           InsertRegion()                             */
+/*                                                                      */
+/*      Add a region to the RAM cache. Returns NULL if it was already   */
+/*      there.                                                          */
+/************************************************************************/
+
+CachedRegion* VSICurlFilesystemHandler::InsertRegion(const char* pszURL,
+                                                     vsi_l_offset nFileOffsetStart,
+                                                     size_t nSize,
+                                                     const char *pData)
 {
     CPLMutexHolder oHolder( &hMutex );
 
-    unsigned long   pszURLHash = CPLHashSetHashStr(pszURL);
+    CachedRegion sKey;
+    sKey.pszURLHash = CPLHashSetHashStr(pszURL);
+    sKey.nFileOffsetStart = nFileOffsetStart;
 
-    CachedRegion* psRegion;
-    if (nRegions == N_MAX_REGIONS)
+    /* Another thread may have downloaded the same region in the meantime */
+    CachedRegion* psRegion =
+        static_cast<CachedRegion*>(CPLHashSetLookup(hRegionSet, &sKey));
+    if( psRegion != NULL )
     {
-        psRegion = papsRegions[N_MAX_REGIONS-1];
-        memmove(papsRegions + 1, papsRegions, (N_MAX_REGIONS-1) * sizeof(CachedRegion*));
-        papsRegions[0] = psRegion;
-        CPLFree(psRegion->pData);
+        if( psRegion != psRegionMRU )
+        {
+            UnlinkRegion(psRegion);
+            LinkRegionAsMRU(psRegion);
+        }
+        return NULL;
     }
-    else
+
+/* -------------------------------------------------------------------- */
+/*      Evict the least recently used regions to stay within budget.    */
+/* -------------------------------------------------------------------- */
+    const GIntBig nRegionMemSize =
+        static_cast<GIntBig>(nSize) + sizeof(CachedRegion);
+    const GIntBig nCacheMaxSize = GetCacheMaxSize();
+    while( psRegionLRU != NULL &&
+           nRegionsMemSize + nRegionMemSize > nCacheMaxSize )
     {
-        papsRegions = (CachedRegion**) CPLRealloc(papsRegions, (nRegions + 1) * sizeof(CachedRegion*));
-        if (nRegions)
-            memmove(papsRegions + 1, papsRegions, nRegions * sizeof(CachedRegion*));
-        nRegions ++;
-        papsRegions[0] = psRegion = (CachedRegion*) CPLMalloc(sizeof(CachedRegion));
+        CachedRegion* psEvicted = psRegionLRU;
+        UnlinkRegion(psEvicted);
+        CPLHashSetRemove(hRegionSet, psEvicted);
+        nRegionsMemSize -=
+            static_cast<GIntBig>(psEvicted->nSize) + sizeof(CachedRegion);
+        CPLFree(psEvicted->pData);
+        CPLFree(psEvicted);
     }
 
-    psRegion->pszURLHash = pszURLHash;
+    psRegion = static_cast<CachedRegion*>(CPLMalloc(sizeof(CachedRegion)));
+    psRegion->pszURLHash = sKey.pszURLHash;
     psRegion->nFileOffsetStart = nFileOffsetStart;
     psRegion->nSize = nSize;
     psRegion->pData = (nSize) ? (char*) CPLMalloc(nSize) : NULL;
     if (nSize)
         memcpy(psRegion->pData, pData, nSize);
+    CPLHashSetInsert(hRegionSet, psRegion);
+    LinkRegionAsMRU(psRegion);
+    nRegionsMemSize += nRegionMemSize;
+
+    return psRegion;
+}
+
+/************************************************************************/
+/*                          CopyFromRegion()                            */
+/*                                                                      */
+/*      Copy the data of the cached region that contains nOffset. The   */
+/*      copy is done with the cache locked, so that the region cannot   */
+/*      be evicted meanwhile by a download in another thread.           */
+/************************************************************************/
+
+bool VSICurlFilesystemHandler::CopyFromRegion(const char* pszURL,
+                                              vsi_l_offset nOffset,
+                                              void* pDest,
+                                              size_t nMaxSize,
+                                              size_t* pnCopied,
+                                              size_t* pnRegionSize)
+{
+    /* Load the region from the disk cache if needed, without the lock */
+    if( GetRegion(pszURL, nOffset) == NULL )
+        return false;
+
+    CPLMutexHolder oHolder( &hMutex );
 
-    if (bUseCacheDisk)
-        AddRegionToCacheDisk(psRegion);
+    /* The region may have been evicted in the meantime */
+    const CachedRegion* psRegion = FindRegionInRAM(pszURL, nOffset);
+    if( psRegion == NULL )
+        return false;
+
+    *pnRegionSize = psRegion->nSize;
+    *pnCopied = 0;
+    const vsi_l_offset nDelta = nOffset - psRegion->nFileOffsetStart;
+    if( psRegion->pData != NULL && nDelta < psRegion->nSize )
+    {
+        *pnCopied = MIN(nMaxSize, psRegion->nSize - static_cast<size_t>(nDelta));
+        memcpy(pDest, psRegion->pData + nDelta, *pnCopied);
+    }
+    return true;
 }
 
 /************************************************************************/
@@ -3207,6 +4525,44 @@ char** VSICurlFilesystemHandler::ReadDirEx( const char *pszDirname,
  * it will progressively increase the chunk size up to 2 MB to improve download
  * performance.
  *
+ * Starting with GDAL 2.2, the granularity can be set with the
+ * CPL_VSIL_CURL_CHUNK_SIZE configuration option (in bytes, between 1 KB and
+ * 10 MB), which must be set before the first use of /vsicurl/. The downloaded
+ * chunks are kept in a RAM cache, shared by all the files, whose maximum size
+ * can be set with the CPL_VSIL_CURL_CACHE_SIZE configuration option (in bytes,
+ * 16 MB by default). The least recently used chunks are discarded first.
+ *
+ * Starting with GDAL 2.2, with HTTP, the ranges of VSIFReadMultiRangeL() and
+ * large VSIFReadL() requests (at least 32 chunks) are downloaded with several
+ * single range requests issued in parallel over keep-alive connections.
+ * Large ranges are split so that all the connections are used. The maximum
+ * number of simultaneous connections can be set with the
+ * CPL_VSIL_CURL_MAX_CONNECTIONS configuration option (8 by default). Setting
+ * the GDAL_HTTP_MULTIRANGE configuration option to SINGLE_GET restores the
+ * previous behaviour, where VSIFReadMultiRangeL() sends a single multipart
+ * range request.
+ *
+ * Starting with GDAL 2.2, when sequential reading is detected, the chunks that
+ * follow the current position are downloaded in advance by a background thread
+ * of the file handle, so that the consumer does not wait for each round-trip.
+ * The read-ahead window doubles while the reading remains sequential, up to a
+ * quarter of the cache size. It can be disabled by setting the
+ * CPL_VSIL_CURL_READ_AHEAD configuration option to NO.
+ *
+ * Starting with GDAL 2.2, setting the CPL_VSIL_CURL_USE_CACHE configuration
+ * option to YES enables a persistent on-disk cache of the downloaded chunks,
+ * shared by all the processes that use the same directory. The directory is
+ * set with the CPL_VSIL_CURL_CACHE_DIR configuration option. It defaults to
+ * gdal_vsicurl_cache_<uid> in the directory set by the CPL_TMPDIR, TMPDIR or
+ * TEMP configuration options, or in /tmp on Unix. On Windows, the cache is
+ * disabled when none of these options is set.
+ * A chunk is stored in a file named after a hash of the URL, the ETag and/or
+ * Last-Modified headers and the size of the remote file, so that a modified
+ * remote file does not reuse the chunks of the previous version. Remote
+ * files without ETag or Last-Modified headers are not cached on disk. When
+ * the total size of the files exceeds CPL_VSIL_CURL_CACHE_DIR_SIZE (in bytes,
+ * 512 MB by default), the least recently used ones are removed.
+ *
  * The GDAL_HTTP_PROXY, GDAL_HTTP_PROXYUSERPWD and GDAL_PROXY_AUTH configuration options can be
  * used to define a proxy server. The syntax to use is the one of Curl CURLOPT_PROXY,
  * CURLOPT_PROXYUSERPWD and CURLOPT_PROXYAUTH options.
@@ -4215,6 +5571,8 @@ VSIS3Handle::VSIS3Handle(VSIS3FSHandler* poFSIn, VSIS3HandleHelper* poS3HandleHe
 
 VSIS3Handle::~VSIS3Handle()
 {
+    /* The read-ahead thread may use the helper */
+    StopReadAhead();
     delete m_poS3HandleHelper;
 }
 
@@ -70,6 +70,15 @@
    a .gz.properties file, so that we don't need to seek at the end of the file
    each time a Stat() is done.
 
+   For large .gz files, a persistent seek index is also maintained, in the spirit
+   of zlib's examples/zran.c. While decompressing, "access points" are recorded at
+   deflate block boundaries every CPL_VSIL_GZIP_INDEX_SPAN uncompressed bytes. An
+   access point stores the position in the compressed stream and the last 32 KB of
+   uncompressed data, which is enough to restart inflate there with inflatePrime()
+   and inflateSetDictionary(). The index is saved in a .gz.idx file and reloaded
+   when the file is reopened, so that a random seek only costs the decompression
+   of at most one span of data.
+
    For .zip and .gz, both reading and writing are supported, but just one mode at a time
    (read-only or write-only)
 */
@@ -78,7 +87,11 @@
 #include "cpl_vsi_virtual.h"
 #include "cpl_string.h"
 #include "cpl_multiproc.h"
+#include "cpl_sha256.h"
+#include "cpl_worker_thread_pool.h"
+#include <list>
 #include <map>
+#include <vector>
 
 #include <zlib.h>
 #include "cpl_minizip_unzip.h"
@@ -105,6 +118,12 @@ static int const gz_magic[2] = {0x1f, 0x8b}; /* gzip magic header */
 
 #define ENABLE_DEBUG 0
 
+#define GZIP_WINDOW_SIZE        32768 /* maximum deflate back-reference distance */
+#define DEFAULT_INDEX_SPAN      (1024 * 1024)
+#define DEFAULT_INDEX_MIN_SIZE  (10 * 1024 * 1024)
+#define DEFAULT_DEFLATE_CHUNK_SIZE (1024 * 1024)
+static const char GZIP_INDEX_MAGIC[] = "GDALGZI1";
+
 /************************************************************************/
 /* ==================================================================== */
 /*                       VSIGZipHandle                                  */
@@ -121,6 +140,16 @@ typedef struct
     vsi_l_offset  out;
 } GZipSnapshot;
 
+/* Access point of the persistent seek index */
+typedef struct
+{
+    vsi_l_offset        nCompressedPos;   /* offset in base file of the first full byte to inflate */
+    vsi_l_offset        nUncompressedPos;
+    int                 nBits;            /* number of unused bits in the byte before nCompressedPos */
+    uLong               crc;              /* crc32 of the current gzip member up to this point */
+    std::vector<GByte>  abyWindow;        /* last 32 KB of uncompressed data, deflate compressed */
+} GZipAccessPoint;
+
 class VSIGZipHandle CPL_FINAL : public VSIVirtualHandle
 {
     VSIVirtualHandle* m_poBaseHandle;
@@ -148,6 +177,24 @@ class VSIGZipHandle CPL_FINAL : public VSIVirtualHandle
     GZipSnapshot* snapshots;
     vsi_l_offset snapshot_byte_interval; /* number of compressed bytes at which we create a "snapshot" */
 
+    /* Persistent seek index */
+    bool          m_bIndexInitDone;
+    bool          m_bUseIndex;
+    bool          m_bIndexDirty;
+    vsi_l_offset  m_nIndexSpan;  /* number of uncompressed bytes between access points */
+    std::vector<GZipAccessPoint> m_aoAccessPoints;
+    Byte         *m_pabyWindow;  /* circular buffer with the last uncompressed bytes */
+    int           m_nWindowPos;
+    int           m_nWindowFill;
+
+    void InitIndex();
+    bool LoadIndex();
+    void SaveIndex();
+    int  GetAccessPoint( vsi_l_offset nUncompressedPos );
+    bool RestoreAccessPoint( int iPoint );
+    void AddAccessPoint();
+    void UpdateWindow( const Byte* pabyData, size_t nSize );
+
     void check_header();
     int get_byte();
     int gzseek( vsi_l_offset nOffset, int nWhence );
@@ -263,6 +310,19 @@ VSIGZipHandle* VSIGZipHandle::Duplicate()
         poHandle->snapshots[i].out = snapshots[i].out;
     }
 
+    /* And the seek index, so that it needs not being reloaded */
+    poHandle->m_bIndexInitDone = m_bIndexInitDone;
+    if( m_bUseIndex )
+    {
+        poHandle->m_pabyWindow = (Byte*)VSIMalloc(GZIP_WINDOW_SIZE);
+        if( poHandle->m_pabyWindow != NULL )
+        {
+            poHandle->m_bUseIndex = true;
+            poHandle->m_nIndexSpan = m_nIndexSpan;
+            poHandle->m_aoAccessPoints = m_aoAccessPoints;
+        }
+    }
+
     return poHandle;
 }
 
@@ -290,7 +350,14 @@ VSIGZipHandle::VSIGZipHandle(VSIVirtualHandle* poBaseHandle,
                              vsi_l_offset uncompressed_size,
                              uLong expected_crc,
                              int transparent) :
-    snapshot_byte_interval(0)
+    snapshot_byte_interval(0),
+    m_bIndexInitDone(false),
+    m_bUseIndex(false),
+    m_bIndexDirty(false),
+    m_nIndexSpan(0),
+    m_pabyWindow(NULL),
+    m_nWindowPos(0),
+    m_nWindowFill(0)
 {
     m_poBaseHandle = poBaseHandle;
     m_expected_crc = expected_crc;
@@ -385,6 +452,10 @@ VSIGZipHandle::~VSIGZipHandle()
         ((VSIGZipFilesystemHandler*)poFSHandler)->SaveInfo(this);
     }
 
+    if (m_bIndexDirty)
+        SaveIndex();
+    VSIFree(m_pabyWindow);
+
     if (stream.state != NULL) {
         inflateEnd(&(stream));
     }
@@ -529,9 +600,367 @@ int VSIGZipHandle::gzrewind ()
     if (!m_transparent) (void)inflateReset(&stream);
     in = 0;
     out = 0;
+    m_nWindowPos = 0;
+    m_nWindowFill = 0;
     return VSIFSeekL((VSILFILE*)m_poBaseHandle, startOff, SEEK_SET);
 }
 
+/************************************************************************/
+/*                       VSIGZipGetIndexFilename()                      */
+/************************************************************************/
+
+/* The seek index is written next to the .gz file, or in the directory */
+/* pointed by CPL_VSIL_GZIP_INDEX_DIR (useful for read-only locations). */
+static CPLString VSIGZipGetIndexFilename( const char* pszBaseFileName )
+{
+    const char* pszIndexDir = CPLGetConfigOption("CPL_VSIL_GZIP_INDEX_DIR", NULL);
+    if( pszIndexDir == NULL || pszIndexDir[0] == '\0' )
+        return CPLString(pszBaseFileName) + ".idx";
+
+    GByte abyHash[CPL_SHA256_HASH_SIZE];
+    CPL_SHA256(pszBaseFileName, strlen(pszBaseFileName), abyHash);
+    CPLString osHash;
+    for( int i = 0; i < 8; i++ )
+        osHash += CPLSPrintf("%02x", abyHash[i]);
+    return CPLFormFilename(pszIndexDir,
+                           CPLSPrintf("%s_%s.idx", CPLGetFilename(pszBaseFileName),
+                                      osHash.c_str()), NULL);
+}
+
+/************************************************************************/
+/*                             InitIndex()                              */
+/************************************************************************/
+
+void VSIGZipHandle::InitIndex()
+{
+    m_bIndexInitDone = true;
+
+    if( m_pszBaseFileName == NULL || m_offset != 0 || m_transparent ||
+        !CPLTestBool(CPLGetConfigOption("CPL_VSIL_GZIP_SEEK_INDEX", "YES")) )
+        return;
+
+    const GIntBig nMinSize = CPLAtoGIntBig(
+        CPLGetConfigOption("CPL_VSIL_GZIP_INDEX_MIN_SIZE",
+                           CPLSPrintf("%d", DEFAULT_INDEX_MIN_SIZE)));
+    if( m_compressed_size < static_cast<vsi_l_offset>(MAX(0, nMinSize)) )
+        return;
+
+    const GIntBig nSpan = CPLAtoGIntBig(
+        CPLGetConfigOption("CPL_VSIL_GZIP_INDEX_SPAN",
+                           CPLSPrintf("%d", DEFAULT_INDEX_SPAN)));
+    m_nIndexSpan = static_cast<vsi_l_offset>(MAX(2 * GZIP_WINDOW_SIZE, nSpan));
+
+    m_pabyWindow = (Byte*)VSIMalloc(GZIP_WINDOW_SIZE);
+    if( m_pabyWindow == NULL )
+        return;
+    m_bUseIndex = true;
+
+    LoadIndex();
+}
+
+/************************************************************************/
+/*                             LoadIndex()                              */
+/************************************************************************/
+
+/* Index file layout (little-endian):                                   */
+/*  magic (8 bytes), compressed size (8), uncompressed size or 0 (8),   */
+/*  modification time of the .gz file (8), span (8), number of points  */
+/*  (4), then for each point: compressed position (8), uncompressed    */
+/*  position (8), crc (4), bits (4), size of window (4), window.       */
+
+bool VSIGZipHandle::LoadIndex()
+{
+    const CPLString osIndexFilename(VSIGZipGetIndexFilename(m_pszBaseFileName));
+    VSILFILE* fp = VSIFOpenL(osIndexFilename, "rb");
+    if( fp == NULL )
+        return false;
+
+    VSIStatBufL sStat;
+    const GIntBig nMTime = (VSIStatL(m_pszBaseFileName, &sStat) == 0) ?
+                                static_cast<GIntBig>(sStat.st_mtime) : 0;
+
+    const size_t nMagicSize = strlen(GZIP_INDEX_MAGIC);
+    char szMagic[sizeof(GZIP_INDEX_MAGIC)];
+    GUIntBig anHeader[4];
+    GUInt32 nPoints = 0;
+    bool bOK =
+        VSIFReadL(szMagic, 1, nMagicSize, fp) == nMagicSize &&
+        memcmp(szMagic, GZIP_INDEX_MAGIC, nMagicSize) == 0 &&
+        VSIFReadL(anHeader, sizeof(GUIntBig), 4, fp) == 4 &&
+        VSIFReadL(&nPoints, sizeof(nPoints), 1, fp) == 1;
+    if( bOK )
+    {
+        for( int i = 0; i < 4; i++ )
+            CPL_LSBPTR64(&anHeader[i]);
+        CPL_LSBPTR32(&nPoints);
+        bOK = anHeader[0] == m_compressed_size &&
+              (nMTime == 0 || anHeader[2] == static_cast<GUIntBig>(nMTime));
+    }
+
+    std::vector<GZipAccessPoint> aoAccessPoints;
+    for( GUInt32 i = 0; bOK && i < nPoints; i++ )
+    {
+        GUIntBig anPos[2];
+        GUInt32 anVals[3];
+        if( VSIFReadL(anPos, sizeof(GUIntBig), 2, fp) != 2 ||
+            VSIFReadL(anVals, sizeof(GUInt32), 3, fp) != 3 )
+        {
+            bOK = false;
+            break;
+        }
+        CPL_LSBPTR64(&anPos[0]);
+        CPL_LSBPTR64(&anPos[1]);
+        for( int j = 0; j < 3; j++ )
+            CPL_LSBPTR32(&anVals[j]);
+        if( anPos[0] <= startOff || anPos[0] > offsetEndCompressedData ||
+            anVals[1] > 7 || anVals[2] == 0 || anVals[2] > 2 * GZIP_WINDOW_SIZE ||
+            (!aoAccessPoints.empty() &&
+             anPos[1] <= aoAccessPoints.back().nUncompressedPos) )
+        {
+            bOK = false;
+            break;
+        }
+
+        GZipAccessPoint oPoint;
+        oPoint.nCompressedPos = anPos[0];
+        oPoint.nUncompressedPos = anPos[1];
+        oPoint.crc = anVals[0];
+        oPoint.nBits = static_cast<int>(anVals[1]);
+        oPoint.abyWindow.resize(anVals[2]);
+        if( VSIFReadL(&oPoint.abyWindow[0], 1, anVals[2], fp) != anVals[2] )
+        {
+            bOK = false;
+            break;
+        }
+        aoAccessPoints.push_back(oPoint);
+    }
+    CPL_IGNORE_RET_VAL(VSIFCloseL(fp));
+
+    if( !bOK )
+    {
+        CPLDebug("GZIP", "Ignoring invalid or outdated seek index %s",
+                 osIndexFilename.c_str());
+        return false;
+    }
+
+    CPLDebug("GZIP", "Loaded %d access points from %s",
+             static_cast<int>(aoAccessPoints.size()), osIndexFilename.c_str());
+    m_aoAccessPoints.swap(aoAccessPoints);
+    if( m_uncompressed_size == 0 )
+        m_uncompressed_size = anHeader[1];
+    return true;
+}
+
+/************************************************************************/
+/*                             SaveIndex()                              */
+/************************************************************************/
+
+void VSIGZipHandle::SaveIndex()
+{
+    m_bIndexDirty = false;
+
+    const CPLString osIndexFilename(VSIGZipGetIndexFilename(m_pszBaseFileName));
+    const char* pszIndexDir = CPLGetConfigOption("CPL_VSIL_GZIP_INDEX_DIR", NULL);
+    if( pszIndexDir != NULL && pszIndexDir[0] != '\0' )
+        VSIMkdir(pszIndexDir, 0755);
+
+    VSIStatBufL sStat;
+    const GIntBig nMTime = (VSIStatL(m_pszBaseFileName, &sStat) == 0) ?
+                                static_cast<GIntBig>(sStat.st_mtime) : 0;
+
+/* -------------------------------------------------------------------- */
+/*      Write in a temporary file, renamed once complete, so that       */
+/*      concurrent readers never see a partial index.                   */
+/* -------------------------------------------------------------------- */
+    const CPLString osTmpFilename(
+        osIndexFilename + CPLSPrintf(".%d.tmp", CPLGetCurrentProcessID()));
+    VSILFILE* fp = VSIFOpenL(osTmpFilename, "wb");
+    if( fp == NULL )
+    {
+        CPLDebug("GZIP", "Cannot create %s", osTmpFilename.c_str());
+        return;
+    }
+
+    const size_t nMagicSize = strlen(GZIP_INDEX_MAGIC);
+    GUIntBig anHeader[4];
+    anHeader[0] = m_compressed_size;
+    anHeader[1] = m_uncompressed_size;
+    anHeader[2] = static_cast<GUIntBig>(nMTime);
+    anHeader[3] = m_nIndexSpan;
+    for( int i = 0; i < 4; i++ )
+        CPL_LSBPTR64(&anHeader[i]);
+    GUInt32 nPoints = static_cast<GUInt32>(m_aoAccessPoints.size());
+    CPL_LSBPTR32(&nPoints);
+    bool bOK =
+        VSIFWriteL(GZIP_INDEX_MAGIC, 1, nMagicSize, fp) == nMagicSize &&
+        VSIFWriteL(anHeader, sizeof(GUIntBig), 4, fp) == 4 &&
+        VSIFWriteL(&nPoints, sizeof(nPoints), 1, fp) == 1;
+
+    for( size_t i = 0; bOK && i < m_aoAccessPoints.size(); i++ )
+    {
+        const GZipAccessPoint& oPoint = m_aoAccessPoints[i];
+        GUIntBig anPos[2];
+        anPos[0] = oPoint.nCompressedPos;
+        anPos[1] = oPoint.nUncompressedPos;
+        GUInt32 anVals[3];
+        anVals[0] = static_cast<GUInt32>(oPoint.crc);
+        anVals[1] = static_cast<GUInt32>(oPoint.nBits);
+        anVals[2] = static_cast<GUInt32>(oPoint.abyWindow.size());
+        const size_t nWindowSize = oPoint.abyWindow.size();
+        CPL_LSBPTR64(&anPos[0]);
+        CPL_LSBPTR64(&anPos[1]);
+        for( int j = 0; j < 3; j++ )
+            CPL_LSBPTR32(&anVals[j]);
+        bOK = VSIFWriteL(anPos, sizeof(GUIntBig), 2, fp) == 2 &&
+              VSIFWriteL(anVals, sizeof(GUInt32), 3, fp) == 3 &&
+              VSIFWriteL(&oPoint.abyWindow[0], 1, nWindowSize, fp) == nWindowSize;
+    }
+    if( VSIFCloseL(fp) != 0 )
+        bOK = false;
+    if( !bOK || VSIRename(osTmpFilename, osIndexFilename) != 0 )
+    {
+        CPLDebug("GZIP", "Cannot write %s", osIndexFilename.c_str());
+        VSIUnlink(osTmpFilename);
+        return;
+    }
+    CPLDebug("GZIP", "Saved %d access points in %s",
+             static_cast<int>(m_aoAccessPoints.size()), osIndexFilename.c_str());
+}
+
+/************************************************************************/
+/*                          GetAccessPoint()                            */
+/************************************************************************/
+
+/* Return the index of the last access point at or before nUncompressedPos, */
+/* or -1 if there is none. */
+int VSIGZipHandle::GetAccessPoint( vsi_l_offset nUncompressedPos )
+{
+    int nLow = 0;
+    int nHigh = static_cast<int>(m_aoAccessPoints.size());
+    while( nLow < nHigh )
+    {
+        const int nMid = nLow + (nHigh - nLow) / 2;
+        if( m_aoAccessPoints[nMid].nUncompressedPos <= nUncompressedPos )
+            nLow = nMid + 1;
+        else
+            nHigh = nMid;
+    }
+    return nLow - 1;
+}
+
+/************************************************************************/
+/*                        RestoreAccessPoint()                          */
+/************************************************************************/
+
+bool VSIGZipHandle::RestoreAccessPoint( int iPoint )
+{
+    const GZipAccessPoint& oPoint = m_aoAccessPoints[iPoint];
+
+    size_t nWindowSize = 0;
+    if( CPLZLibInflate(&oPoint.abyWindow[0], oPoint.abyWindow.size(),
+                       m_pabyWindow, GZIP_WINDOW_SIZE, &nWindowSize) == NULL ||
+        nWindowSize != GZIP_WINDOW_SIZE )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined,
+                 "Corrupted access point in seek index");
+        return false;
+    }
+
+    if( VSIFSeekL((VSILFILE*)m_poBaseHandle,
+                  oPoint.nCompressedPos - (oPoint.nBits ? 1 : 0), SEEK_SET) != 0 )
+        return false;
+    z_err = Z_OK;
+    z_eof = 0;
+    stream.avail_in = 0;
+    stream.next_in = inbuf;
+    (void)inflateReset(&stream);
+    if( oPoint.nBits )
+    {
+        const int c = get_byte();
+        if( c == EOF )
+            return false;
+        (void)inflatePrime(&stream, oPoint.nBits, c >> (8 - oPoint.nBits));
+    }
+    if( inflateSetDictionary(&stream, m_pabyWindow, GZIP_WINDOW_SIZE) != Z_OK )
+        return false;
+
+    m_nWindowPos = 0;
+    m_nWindowFill = GZIP_WINDOW_SIZE;
+    crc = oPoint.crc;
+    in = oPoint.nCompressedPos - startOff;
+    out = oPoint.nUncompressedPos;
+    if (ENABLE_DEBUG)
+        CPLDebug("GZIP", "Restored access point %d : in=" CPL_FRMT_GUIB
+                 " out=" CPL_FRMT_GUIB, iPoint, in, out);
+    return true;
+}
+
+/************************************************************************/
+/*                           UpdateWindow()                             */
+/************************************************************************/
+
+void VSIGZipHandle::UpdateWindow( const Byte* pabyData, size_t nSize )
+{
+    if( nSize >= GZIP_WINDOW_SIZE )
+    {
+        memcpy(m_pabyWindow, pabyData + nSize - GZIP_WINDOW_SIZE, GZIP_WINDOW_SIZE);
+        m_nWindowPos = 0;
+        m_nWindowFill = GZIP_WINDOW_SIZE;
+        return;
+    }
+    const size_t nFirst = MIN(nSize, static_cast<size_t>(GZIP_WINDOW_SIZE - m_nWindowPos));
+    memcpy(m_pabyWindow + m_nWindowPos, pabyData, nFirst);
+    memcpy(m_pabyWindow, pabyData + nFirst, nSize - nFirst);
+    m_nWindowPos = static_cast<int>((m_nWindowPos + nSize) % GZIP_WINDOW_SIZE);
+    m_nWindowFill = static_cast<int>(MIN(static_cast<size_t>(GZIP_WINDOW_SIZE),
+                                         m_nWindowFill + nSize));
+}
+
+/************************************************************************/
+/*                          AddAccessPoint()                            */
+/************************************************************************/
+
+/* Called at a deflate block boundary, when crc is up to date. */
+void VSIGZipHandle::AddAccessPoint()
+{
+    if( m_nWindowFill < GZIP_WINDOW_SIZE )
+        return;
+
+    /* Keep access points at least one span apart */
+    const int iPrev = GetAccessPoint(out);
+    if( iPrev >= 0 ? out - m_aoAccessPoints[iPrev].nUncompressedPos < m_nIndexSpan
+                   : out < m_nIndexSpan )
+        return;
+    if( iPrev + 1 < static_cast<int>(m_aoAccessPoints.size()) &&
+        m_aoAccessPoints[iPrev + 1].nUncompressedPos - out < m_nIndexSpan )
+        return;
+
+    std::vector<GByte> abyWindow(GZIP_WINDOW_SIZE);
+    memcpy(&abyWindow[0], m_pabyWindow + m_nWindowPos, GZIP_WINDOW_SIZE - m_nWindowPos);
+    memcpy(&abyWindow[GZIP_WINDOW_SIZE - m_nWindowPos], m_pabyWindow, m_nWindowPos);
+
+    GZipAccessPoint oPoint;
+    oPoint.nCompressedPos = VSIFTellL((VSILFILE*)m_poBaseHandle) - stream.avail_in;
+    oPoint.nUncompressedPos = out;
+    oPoint.nBits = stream.data_type & 7;
+    oPoint.crc = crc;
+    /* Incompressible data can slightly expand */
+    oPoint.abyWindow.resize(GZIP_WINDOW_SIZE + 1024);
+    size_t nCompressedSize = 0;
+    if( CPLZLibDeflate(&abyWindow[0], GZIP_WINDOW_SIZE, -1,
+                       &oPoint.abyWindow[0], oPoint.abyWindow.size(),
+                       &nCompressedSize) == NULL )
+        return;
+    oPoint.abyWindow.resize(nCompressedSize);
+
+    if (ENABLE_DEBUG)
+        CPLDebug("GZIP", "Adding access point: in=" CPL_FRMT_GUIB
+                 " out=" CPL_FRMT_GUIB " bits=%d",
+                 oPoint.nCompressedPos, oPoint.nUncompressedPos, oPoint.nBits);
+    m_aoAccessPoints.insert(m_aoAccessPoints.begin() + (iPrev + 1), oPoint);
+    m_bIndexDirty = true;
+}
+
 /************************************************************************/
 /*                              Seek()                                  */
 /************************************************************************/
@@ -647,6 +1076,22 @@ int VSIGZipHandle::gzseek( vsi_l_offset offset, int whence )
         offset += out;
     }
 
+    /* Jump to the closest access point of the seek index, when it is */
+    /* closer to the target than the current position */
+    if (!m_bIndexInitDone)
+        InitIndex();
+    if (m_bUseIndex)
+    {
+        const int iPoint = GetAccessPoint(offset);
+        if (iPoint >= 0 &&
+            (offset < out || m_aoAccessPoints[iPoint].nUncompressedPos > out) &&
+            !RestoreAccessPoint(iPoint) && gzrewind() < 0)
+        {
+            CPL_VSIL_GZ_RETURN(-1);
+            return -1L;
+        }
+    }
+
     /* For a negative seek, rewind and use positive seek */
     if (offset >= out) {
         offset -= out;
@@ -681,6 +1126,8 @@ int VSIGZipHandle::gzseek( vsi_l_offset offset, int whence )
             m_transparent = snapshots[i].transparent;
             in = snapshots[i].in;
             out = snapshots[i].out;
+            m_nWindowPos = 0;
+            m_nWindowFill = 0;
             break;
         }
     }
@@ -790,6 +1237,9 @@ size_t VSIGZipHandle::Read( void * const buf, size_t const nSize, size_t const n
         return 0;  /* EOF */
     }
 
+    if (!m_bIndexInitDone)
+        InitIndex();
+
     const unsigned len = static_cast<unsigned int>(nSize) * static_cast<unsigned int>(nMemb);
     Bytef *pStart = (Bytef*)buf; /* startOffing point for crc computation */
     Byte  *next_out; /* == stream.next_out but not forced far (for MSDOS) */
@@ -880,10 +1330,24 @@ size_t VSIGZipHandle::Read( void * const buf, size_t const nSize, size_t const n
         }
         in += stream.avail_in;
         out += stream.avail_out;
-        z_err = inflate(& (stream), Z_NO_FLUSH);
+        Bytef* const pBeforeInflate = stream.next_out;
+        /* When indexing, stop at each deflate block boundary */
+        z_err = inflate(& (stream), m_bUseIndex ? Z_BLOCK : Z_NO_FLUSH);
         in -= stream.avail_in;
         out -= stream.avail_out;
 
+        if (m_bUseIndex)
+        {
+            UpdateWindow(pBeforeInflate, stream.next_out - pBeforeInflate);
+            if (z_err == Z_OK && (stream.data_type & 128) != 0 &&
+                (stream.data_type & 64) == 0)
+            {
+                crc = crc32 (crc, pStart, (uInt) (stream.next_out - pStart));
+                pStart = stream.next_out;
+                AddAccessPoint();
+            }
+        }
+
         if  (z_err == Z_STREAM_END && m_compressed_size != 2 ) {
             /* Check CRC and original size */
             crc = crc32 (crc, pStart, (uInt) (stream.next_out - pStart));
@@ -1016,12 +1480,12 @@ class VSIGZipWriteHandle CPL_FINAL : public VSIVirtualHandle
     bool               bCompressActive;
     vsi_l_offset       nCurOffset;
     uLong              nCRC;
-    int                bRegularZLib;
+    int                nDeflateType;
     int                bAutoCloseBaseHandle;
 
   public:
 
-    VSIGZipWriteHandle(VSIVirtualHandle* poBaseHandle, int bRegularZLib, int bAutoCloseBaseHandleIn);
+    VSIGZipWriteHandle(VSIVirtualHandle* poBaseHandle, int nDeflateType, int bAutoCloseBaseHandleIn);
 
     ~VSIGZipWriteHandle();
 
@@ -1039,14 +1503,14 @@ class VSIGZipWriteHandle CPL_FINAL : public VSIVirtualHandle
 /************************************************************************/
 
 VSIGZipWriteHandle::VSIGZipWriteHandle( VSIVirtualHandle *poBaseHandle,
-                                        int bRegularZLibIn,
+                                        int nDeflateTypeIn,
                                         int bAutoCloseBaseHandleIn )
 
 {
     nCurOffset = 0;
 
     m_poBaseHandle = poBaseHandle;
-    bRegularZLib = bRegularZLibIn;
+    nDeflateType = nDeflateTypeIn;
     bAutoCloseBaseHandle = bAutoCloseBaseHandleIn;
 
     nCRC = crc32(0L, NULL, 0);
@@ -1063,12 +1527,13 @@ VSIGZipWriteHandle::VSIGZipWriteHandle( VSIVirtualHandle *poBaseHandle,
     pabyOutBuf = (Byte *) CPLMalloc( Z_BUFSIZE );
 
     if( deflateInit2( &sStream, Z_DEFAULT_COMPRESSION,
-                      Z_DEFLATED, (bRegularZLib) ? MAX_WBITS : -MAX_WBITS, 8,
+                      Z_DEFLATED,
+                      (nDeflateType == CPL_DEFLATE_TYPE_ZLIB) ? MAX_WBITS : -MAX_WBITS, 8,
                       Z_DEFAULT_STRATEGY ) != Z_OK )
         bCompressActive = false;
     else
     {
-        if (!bRegularZLib)
+        if (nDeflateType == CPL_DEFLATE_TYPE_GZIP)
         {
             char header[11];
 
@@ -1085,17 +1550,6 @@ VSIGZipWriteHandle::VSIGZipWriteHandle( VSIVirtualHandle *poBaseHandle,
     }
 }
 
-/************************************************************************/
-/*                       VSICreateGZipWritable()                        */
-/************************************************************************/
-
-VSIVirtualHandle* VSICreateGZipWritable( VSIVirtualHandle* poBaseHandle,
-                                         int bRegularZLibIn,
-                                         int bAutoCloseBaseHandle )
-{
-    return new VSIGZipWriteHandle( poBaseHandle, bRegularZLibIn, bAutoCloseBaseHandle );
-}
-
 /************************************************************************/
 /*                        ~VSIGZipWriteHandle()                         */
 /************************************************************************/
@@ -1132,7 +1586,7 @@ int VSIGZipWriteHandle::Close()
 
         deflateEnd( &sStream );
 
-        if( !bRegularZLib )
+        if( nDeflateType == CPL_DEFLATE_TYPE_GZIP )
         {
             GUInt32 anTrailer[2];
 
@@ -1270,6 +1724,453 @@ vsi_l_offset VSIGZipWriteHandle::Tell()
 }
 
 
+/************************************************************************/
+/* ==================================================================== */
+/*                       VSIGZipWriteHandleMT                           */
+/* ==================================================================== */
+/************************************************************************/
+
+/* Multi-threaded writer, in the spirit of pigz. The input is cut into     */
+/* chunks compressed independently by a pool of worker threads. Each chunk */
+/* is a raw deflate stream primed with the last 32 KB of the previous      */
+/* chunk as dictionary, and ended with a sync flush (or a final block for  */
+/* the last one), so that their concatenation is a valid deflate stream.   */
+
+class VSIGZipWriteHandleMT;
+
+typedef struct
+{
+    VSIGZipWriteHandleMT *poParent;
+    std::vector<GByte>    abyDict;
+    std::vector<GByte>    abyIn;
+    std::vector<GByte>    abyOut;
+    size_t                nInSize;
+    uLong                 nCheck;   /* crc32 (gzip) or adler32 (zlib) of the chunk */
+    bool                  bFinish;
+    bool                  bOK;
+    bool                  bDone;    /* protected by the mutex of poParent */
+} VSIDeflateJob;
+
+class VSIGZipWriteHandleMT CPL_FINAL : public VSIVirtualHandle
+{
+    VSIVirtualHandle    *m_poBaseHandle;
+    int                  m_nDeflateType;
+    int                  m_bAutoCloseBaseHandle;
+    int                  m_nThreads;
+    size_t               m_nChunkSize;
+    CPLWorkerThreadPool *m_poPool;
+    CPLMutex            *m_hMutex;
+    CPLCond             *m_hCond;
+    VSIDeflateJob       *m_psCurJob;
+    std::list<VSIDeflateJob*> m_apsPendingJobs;  /* in stream order */
+    vsi_l_offset         m_nCurOffset;
+    uLong                m_nCheck;
+    bool                 m_bOK;
+    bool                 m_bClosed;
+
+    static void          DeflateJobFunc( void* pData );
+    VSIDeflateJob       *CreateJob();
+    bool                 SubmitCurrentJob( bool bFinish );
+    bool                 WriteCompletedJobs( size_t nMaxPendingJobs );
+
+  public:
+
+    VSIGZipWriteHandleMT( VSIVirtualHandle* poBaseHandle, int nDeflateType,
+                          int bAutoCloseBaseHandle, int nThreads,
+                          size_t nChunkSize );
+    ~VSIGZipWriteHandleMT();
+
+    virtual int       Seek( vsi_l_offset nOffset, int nWhence );
+    virtual vsi_l_offset Tell();
+    virtual size_t    Read( void *pBuffer, size_t nSize, size_t nMemb );
+    virtual size_t    Write( const void *pBuffer, size_t nSize, size_t nMemb );
+    virtual int       Eof();
+    virtual int       Flush();
+    virtual int       Close();
+};
+
+/************************************************************************/
+/*                        VSIGZipWriteHandleMT()                        */
+/************************************************************************/
+
+VSIGZipWriteHandleMT::VSIGZipWriteHandleMT( VSIVirtualHandle* poBaseHandle,
+                                            int nDeflateType,
+                                            int bAutoCloseBaseHandle,
+                                            int nThreads,
+                                            size_t nChunkSize ) :
+    m_poBaseHandle(poBaseHandle),
+    m_nDeflateType(nDeflateType),
+    m_bAutoCloseBaseHandle(bAutoCloseBaseHandle),
+    m_nThreads(nThreads),
+    m_nChunkSize(nChunkSize),
+    m_poPool(NULL),
+    m_hMutex(NULL),
+    m_hCond(NULL),
+    m_psCurJob(NULL),
+    m_nCurOffset(0),
+    m_nCheck(0),
+    m_bOK(true),
+    m_bClosed(false)
+{
+    m_hMutex = CPLCreateMutex();
+    CPLReleaseMutex(m_hMutex);
+    m_hCond = CPLCreateCond();
+
+    m_psCurJob = CreateJob();
+
+    if( m_nDeflateType == CPL_DEFLATE_TYPE_GZIP )
+    {
+        m_nCheck = crc32(0L, NULL, 0);
+
+        /* Same very simple .gz header as VSIGZipWriteHandle */
+        const GByte abyHeader[10] = { (GByte)gz_magic[0], (GByte)gz_magic[1],
+                                      Z_DEFLATED, 0 /*flags*/, 0,0,0,0 /*time*/,
+                                      0 /*xflags*/, 0x03 };
+        m_bOK = m_poBaseHandle->Write( abyHeader, 1, 10 ) == 10;
+    }
+    else if( m_nDeflateType == CPL_DEFLATE_TYPE_ZLIB )
+    {
+        m_nCheck = adler32(0L, NULL, 0);
+
+        /* Deflate, 32 KB window, default compression level, no dictionary */
+        const GByte abyHeader[2] = { 0x78, 0x9C };
+        m_bOK = m_poBaseHandle->Write( abyHeader, 1, 2 ) == 2;
+    }
+}
+
+/************************************************************************/
+/*                       ~VSIGZipWriteHandleMT()                        */
+/************************************************************************/
+
+VSIGZipWriteHandleMT::~VSIGZipWriteHandleMT()
+{
+    if( !m_bClosed )
+        Close();
+
+    delete m_poPool;
+    delete m_psCurJob;
+    CPLDestroyCond(m_hCond);
+    CPLDestroyMutex(m_hMutex);
+}
+
+/************************************************************************/
+/*                             CreateJob()                              */
+/************************************************************************/
+
+VSIDeflateJob* VSIGZipWriteHandleMT::CreateJob()
+{
+    VSIDeflateJob* psJob = new VSIDeflateJob;
+    psJob->poParent = this;
+    psJob->abyIn.reserve(m_nChunkSize);
+    psJob->nInSize = 0;
+    psJob->nCheck = 0;
+    psJob->bFinish = false;
+    psJob->bOK = false;
+    psJob->bDone = false;
+    return psJob;
+}
+
+/************************************************************************/
+/*                          DeflateJobFunc()                            */
+/************************************************************************/
+
+void VSIGZipWriteHandleMT::DeflateJobFunc( void* pData )
+{
+    VSIDeflateJob* psJob = static_cast<VSIDeflateJob*>(pData);
+    VSIGZipWriteHandleMT* poParent = psJob->poParent;
+
+    psJob->nInSize = psJob->abyIn.size();
+    Bytef* pabyIn = psJob->abyIn.empty() ? NULL : &psJob->abyIn[0];
+    if( poParent->m_nDeflateType == CPL_DEFLATE_TYPE_GZIP )
+        psJob->nCheck = crc32(crc32(0L, NULL, 0), pabyIn,
+                              static_cast<uInt>(psJob->nInSize));
+    else if( poParent->m_nDeflateType == CPL_DEFLATE_TYPE_ZLIB )
+        psJob->nCheck = adler32(adler32(0L, NULL, 0), pabyIn,
+                                static_cast<uInt>(psJob->nInSize));
+
+    z_stream sStream;
+    memset(&sStream, 0, sizeof(sStream));
+    psJob->bOK = deflateInit2( &sStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                               -MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) == Z_OK;
+    if( psJob->bOK )
+    {
+        if( !psJob->abyDict.empty() )
+            deflateSetDictionary( &sStream, &psJob->abyDict[0],
+                                  static_cast<uInt>(psJob->abyDict.size()) );
+
+        /* Room for incompressible data and the sync flush marker */
+        psJob->abyOut.resize(
+            deflateBound(&sStream, static_cast<uLong>(psJob->nInSize)) + 64);
+        sStream.next_in = pabyIn;
+        sStream.avail_in = static_cast<uInt>(psJob->nInSize);
+        sStream.next_out = &psJob->abyOut[0];
+        sStream.avail_out = static_cast<uInt>(psJob->abyOut.size());
+        const int nFlush = psJob->bFinish ? Z_FINISH : Z_SYNC_FLUSH;
+        while( true )
+        {
+            const int nRet = deflate( &sStream, nFlush );
+            if( psJob->bFinish ? nRet == Z_STREAM_END :
+                    (nRet == Z_OK && sStream.avail_in == 0 && sStream.avail_out != 0) )
+                break;
+            if( nRet != Z_OK && nRet != Z_BUF_ERROR )
+            {
+                psJob->bOK = false;
+                break;
+            }
+            const size_t nDone = psJob->abyOut.size() - sStream.avail_out;
+            psJob->abyOut.resize(psJob->abyOut.size() * 2);
+            sStream.next_out = &psJob->abyOut[nDone];
+            sStream.avail_out = static_cast<uInt>(psJob->abyOut.size() - nDone);
+        }
+        psJob->abyOut.resize(psJob->abyOut.size() - sStream.avail_out);
+        deflateEnd( &sStream );
+    }
+
+    /* Release the input as soon as possible to limit memory usage */
+    std::vector<GByte>().swap(psJob->abyIn);
+    std::vector<GByte>().swap(psJob->abyDict);
+
+    CPLAcquireMutex(poParent->m_hMutex, 1000.0);
+    psJob->bDone = true;
+    CPLCondSignal(poParent->m_hCond);
+    CPLReleaseMutex(poParent->m_hMutex);
+}
+
+/************************************************************************/
+/*                         SubmitCurrentJob()                           */
+/************************************************************************/
+
+bool VSIGZipWriteHandleMT::SubmitCurrentJob( bool bFinish )
+{
+    VSIDeflateJob* psJob = m_psCurJob;
+    m_psCurJob = NULL;
+    psJob->bFinish = bFinish;
+
+    if( !bFinish )
+    {
+        /* The next chunk is primed with the end of this one */
+        m_psCurJob = CreateJob();
+        const size_t nDictSize = MIN(psJob->abyIn.size(),
+                                     static_cast<size_t>(GZIP_WINDOW_SIZE));
+        m_psCurJob->abyDict.assign(psJob->abyIn.end() - nDictSize,
+                                   psJob->abyIn.end());
+
+        /* Workers are only started once a first chunk is full, so that */
+        /* small streams do not pay for thread creation. */
+        if( m_poPool == NULL )
+        {
+            m_poPool = new CPLWorkerThreadPool();
+            if( !m_poPool->Setup(m_nThreads, NULL, NULL) )
+            {
+                delete m_poPool;
+                m_poPool = NULL;
+            }
+        }
+    }
+
+    m_apsPendingJobs.push_back(psJob);
+    if( m_poPool == NULL || !m_poPool->SubmitJob(DeflateJobFunc, psJob) )
+        DeflateJobFunc(psJob);
+
+    return WriteCompletedJobs(bFinish ? 0 : 2 * static_cast<size_t>(m_nThreads));
+}
+
+/************************************************************************/
+/*                        WriteCompletedJobs()                          */
+/************************************************************************/
+
+/* Write the compressed chunks in stream order, waiting for them until at */
+/* most nMaxPendingJobs remain in flight. */
+
+bool VSIGZipWriteHandleMT::WriteCompletedJobs( size_t nMaxPendingJobs )
+{
+    while( !m_apsPendingJobs.empty() )
+    {
+        VSIDeflateJob* psJob = m_apsPendingJobs.front();
+
+        CPLAcquireMutex(m_hMutex, 1000.0);
+        if( !psJob->bDone && m_apsPendingJobs.size() <= nMaxPendingJobs )
+        {
+            CPLReleaseMutex(m_hMutex);
+            break;
+        }
+        while( !psJob->bDone )
+            CPLCondWait(m_hCond, m_hMutex);
+        CPLReleaseMutex(m_hMutex);
+
+        m_apsPendingJobs.pop_front();
+        if( !psJob->bOK )
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "Compression failed");
+            m_bOK = false;
+        }
+        else if( m_bOK )
+        {
+            if( !psJob->abyOut.empty() &&
+                m_poBaseHandle->Write(&psJob->abyOut[0], 1,
+                                      psJob->abyOut.size()) != psJob->abyOut.size() )
+                m_bOK = false;
+
+            if( m_nDeflateType == CPL_DEFLATE_TYPE_GZIP )
+                m_nCheck = crc32_combine(m_nCheck, psJob->nCheck,
+                                         static_cast<z_off_t>(psJob->nInSize));
+            else if( m_nDeflateType == CPL_DEFLATE_TYPE_ZLIB )
+                m_nCheck = adler32_combine(m_nCheck, psJob->nCheck,
+                                           static_cast<z_off_t>(psJob->nInSize));
+        }
+        delete psJob;
+    }
+    return m_bOK;
+}
+
+/************************************************************************/
+/*                               Close()                                */
+/************************************************************************/
+
+int VSIGZipWriteHandleMT::Close()
+{
+    if( m_bClosed )
+        return 0;
+    m_bClosed = true;
+
+    bool bOK = SubmitCurrentJob(true);
+
+    if( bOK && m_nDeflateType == CPL_DEFLATE_TYPE_GZIP )
+    {
+        GUInt32 anTrailer[2];
+        anTrailer[0] = CPL_LSBWORD32( static_cast<GUInt32>(m_nCheck) );
+        anTrailer[1] = CPL_LSBWORD32( static_cast<GUInt32>(m_nCurOffset) );
+        bOK = m_poBaseHandle->Write( anTrailer, 1, 8 ) == 8;
+    }
+    else if( bOK && m_nDeflateType == CPL_DEFLATE_TYPE_ZLIB )
+    {
+        GUInt32 nAdler = CPL_MSBWORD32( static_cast<GUInt32>(m_nCheck) );
+        bOK = m_poBaseHandle->Write( &nAdler, 1, 4 ) == 4;
+    }
+
+    if( m_bAutoCloseBaseHandle )
+    {
+        if( m_poBaseHandle->Close() != 0 )
+            bOK = false;
+        delete m_poBaseHandle;
+        m_poBaseHandle = NULL;
+    }
+
+    return bOK ? 0 : EOF;
+}
+
+/************************************************************************/
+/*                                Read()                                */
+/************************************************************************/
+
+size_t VSIGZipWriteHandleMT::Read( CPL_UNUSED void *pBuffer,
+                                   CPL_UNUSED size_t nSize,
+                                   CPL_UNUSED size_t nMemb )
+{
+    CPLError(CE_Failure, CPLE_NotSupported, "VSIFReadL is not supported on GZip write streams\n");
+    return 0;
+}
+
+/************************************************************************/
+/*                               Write()                                */
+/************************************************************************/
+
+size_t VSIGZipWriteHandleMT::Write( const void * const pBuffer,
+                                    size_t const nSize, size_t const nMemb )
+{
+    if( m_bClosed || !m_bOK )
+        return 0;
+
+    const GByte* pabyData = static_cast<const GByte*>(pBuffer);
+    size_t nBytesToWrite = nSize * nMemb;
+    while( nBytesToWrite > 0 )
+    {
+        const size_t nAvail = m_nChunkSize - m_psCurJob->abyIn.size();
+        const size_t nToCopy = MIN(nAvail, nBytesToWrite);
+        m_psCurJob->abyIn.insert(m_psCurJob->abyIn.end(),
+                                 pabyData, pabyData + nToCopy);
+        pabyData += nToCopy;
+        nBytesToWrite -= nToCopy;
+        m_nCurOffset += nToCopy;
+
+        if( m_psCurJob->abyIn.size() == m_nChunkSize &&
+            !SubmitCurrentJob(false) )
+            return 0;
+    }
+
+    return nMemb;
+}
+
+/************************************************************************/
+/*                               Flush()                                */
+/************************************************************************/
+
+int VSIGZipWriteHandleMT::Flush()
+{
+    return 0;
+}
+
+/************************************************************************/
+/*                                Eof()                                 */
+/************************************************************************/
+
+int VSIGZipWriteHandleMT::Eof()
+{
+    return 1;
+}
+
+/************************************************************************/
+/*                                Seek()                                */
+/************************************************************************/
+
+int VSIGZipWriteHandleMT::Seek( vsi_l_offset nOffset, int nWhence )
+{
+    if( nOffset == 0 && (nWhence == SEEK_END || nWhence == SEEK_CUR) )
+        return 0;
+    else if( nWhence == SEEK_SET && nOffset == m_nCurOffset )
+        return 0;
+    else
+    {
+        CPLError(CE_Failure, CPLE_NotSupported,
+                 "Seeking on writable compressed data streams not supported." );
+
+        return -1;
+    }
+}
+
+/************************************************************************/
+/*                                Tell()                                */
+/************************************************************************/
+
+vsi_l_offset VSIGZipWriteHandleMT::Tell()
+{
+    return m_nCurOffset;
+}
+
+/************************************************************************/
+/*                       VSICreateGZipWritable()                        */
+/************************************************************************/
+
+/* When the GDAL_NUM_THREADS configuration option is set to a value greater */
+/* than 1 (or ALL_CPUS), a multi-threaded writer is used. */
+VSIVirtualHandle* VSICreateGZipWritable( VSIVirtualHandle* poBaseHandle,
+                                         int nDeflateType,
+                                         int bAutoCloseBaseHandle )
+{
+    const int nThreads = CPLGetConfiguredNumThreads("1");
+    if( nThreads > 1 )
+    {
+        const GIntBig nChunkSize = CPLAtoGIntBig(
+            CPLGetConfigOption("CPL_VSIL_DEFLATE_CHUNK_SIZE",
+                               CPLSPrintf("%d", DEFAULT_DEFLATE_CHUNK_SIZE)));
+        return new VSIGZipWriteHandleMT( poBaseHandle, nDeflateType,
+                                         bAutoCloseBaseHandle, nThreads,
+                                         static_cast<size_t>(
+                                            MAX(2 * GZIP_WINDOW_SIZE, nChunkSize)) );
+    }
+    return new VSIGZipWriteHandle( poBaseHandle, nDeflateType, bAutoCloseBaseHandle );
+}
+
 /************************************************************************/
 /* ==================================================================== */
 /*                       VSIGZipFilesystemHandler                       */
@@ -1377,7 +2278,10 @@ VSIVirtualHandle* VSIGZipFilesystemHandler::Open( const char *pszFilename,
             return NULL;
 
         else
-            return new VSIGZipWriteHandle( poVirtualHandle, strchr(pszAccess, 'z') != NULL, TRUE );
+            return VSICreateGZipWritable( poVirtualHandle,
+                                          strchr(pszAccess, 'z') != NULL ?
+                                                CPL_DEFLATE_TYPE_ZLIB : CPL_DEFLATE_TYPE_GZIP,
+                                          TRUE );
     }
 
 /* -------------------------------------------------------------------- */
@@ -1606,6 +2510,21 @@ char** VSIGZipFilesystemHandler::ReadDirEx( const char * /*pszDirname*/,
  *
  * Additional documentation is to be found at http://trac.osgeo.org/gdal/wiki/UserDocs/ReadInZip
  *
+ * Starting with GDAL 2.2, a seek index is built while reading .gz files whose
+ * size is at least CPL_VSIL_GZIP_INDEX_MIN_SIZE bytes (10 MB by default).
+ * It records every CPL_VSIL_GZIP_INDEX_SPAN uncompressed bytes (1 MB by default)
+ * the state needed to resume decompression at that point, so that random
+ * seeks only need to decompress at most one span of data. The index is saved
+ * in a .gz.idx file next to the .gz file, or in the directory pointed by the
+ * CPL_VSIL_GZIP_INDEX_DIR configuration option, and is reused when the file
+ * is opened again. Setting CPL_VSIL_GZIP_SEEK_INDEX=NO disables it.
+ *
+ * Starting with GDAL 2.2, when the GDAL_NUM_THREADS configuration option is set
+ * to a value greater than 1 (or ALL_CPUS), writing is done by that number of
+ * threads, each compressing independent chunks of CPL_VSIL_DEFLATE_CHUNK_SIZE
+ * bytes (1 MB by default), primed with the last 32 KB of the previous chunk.
+ * The result is a regular single-member gzip stream.
+ *
  * @since GDAL 1.6.0
  */
 
@@ -1626,7 +2545,22 @@ class VSIZipEntryFileOffset CPL_FINAL : public VSIArchiveEntryFileOffset
 public:
         unz_file_pos m_file_pos;
 
-        VSIZipEntryFileOffset(unz_file_pos file_pos)
+        /* Location of the entry data, filled on first open and protected */
+        /* by the mutex of the filesystem handler */
+        bool         m_bInfoValid;
+        uLong64      m_nDataPos;
+        uLong64      m_nCompressedSize;
+        uLong64      m_nUncompressedSize;
+        uLong        m_nCRC;
+        bool         m_bStored;
+
+        VSIZipEntryFileOffset(unz_file_pos file_pos) :
+            m_bInfoValid(false),
+            m_nDataPos(0),
+            m_nCompressedSize(0),
+            m_nUncompressedSize(0),
+            m_nCRC(0),
+            m_bStored(false)
         {
             m_file_pos.pos_in_zip_directory = file_pos.pos_in_zip_directory;
             m_file_pos.num_of_file = file_pos.num_of_file;
@@ -1943,11 +2877,85 @@ VSIVirtualHandle* VSIZipFilesystemHandler::Open( const char *pszFilename,
         }
     }
 
-    VSIArchiveReader* poReader = OpenArchiveFile(zipFilename, osZipInFileName);
-    if (poReader == NULL)
+/* -------------------------------------------------------------------- */
+/*      If the entry has already been opened, the location of its data  */
+/*      is cached in the directory cache, so we do not need to reopen   */
+/*      the archive and walk to the local header again.                 */
+/* -------------------------------------------------------------------- */
+    unz_file_pos sNullPos;
+    sNullPos.pos_in_zip_directory = 0;
+    sNullPos.num_of_file = 0;
+    VSIZipEntryFileOffset oInfo(sNullPos);
+    if( !osZipInFileName.empty() )
     {
-        CPLFree(zipFilename);
-        return NULL;
+        CPLMutexHolder oHolder(&hMutex);
+        const VSIArchiveEntry* archiveEntry = NULL;
+        if( FindFileInArchive(zipFilename, osZipInFileName, &archiveEntry) &&
+            !archiveEntry->bIsDir && archiveEntry->file_pos != NULL )
+        {
+            oInfo = *static_cast<VSIZipEntryFileOffset*>(archiveEntry->file_pos);
+        }
+    }
+
+    if( !oInfo.m_bInfoValid )
+    {
+        VSIArchiveReader* poReader = OpenArchiveFile(zipFilename, osZipInFileName);
+        if (poReader == NULL)
+        {
+            CPLFree(zipFilename);
+            return NULL;
+        }
+
+        unzFile unzF = ((VSIZipReader*)poReader)->GetUnzFileHandle();
+
+        if( cpl_unzOpenCurrentFile(unzF) != UNZ_OK )
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "cpl_unzOpenCurrentFile() failed");
+            delete poReader;
+            CPLFree(zipFilename);
+            return NULL;
+        }
+
+        uLong64 pos = cpl_unzGetCurrentFileZStreamPos(unzF);
+
+        unz_file_info file_info;
+        if( cpl_unzGetCurrentFileInfo (unzF, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK )
+        {
+            CPLError(CE_Failure, CPLE_AppDefined, "cpl_unzGetCurrentFileInfo() failed");
+            cpl_unzCloseCurrentFile(unzF);
+            delete poReader;
+            CPLFree(zipFilename);
+            return NULL;
+        }
+
+        cpl_unzCloseCurrentFile(unzF);
+
+        delete poReader;
+
+        oInfo.m_bInfoValid = true;
+        oInfo.m_nDataPos = pos;
+        oInfo.m_nCompressedSize = file_info.compressed_size;
+        oInfo.m_nUncompressedSize = file_info.uncompressed_size;
+        oInfo.m_nCRC = file_info.crc;
+        oInfo.m_bStored = (file_info.compression_method == 0);
+
+        if( !osZipInFileName.empty() )
+        {
+            CPLMutexHolder oHolder(&hMutex);
+            const VSIArchiveEntry* archiveEntry = NULL;
+            if( FindFileInArchive(zipFilename, osZipInFileName, &archiveEntry) &&
+                !archiveEntry->bIsDir && archiveEntry->file_pos != NULL )
+            {
+                VSIZipEntryFileOffset* poOffset =
+                    static_cast<VSIZipEntryFileOffset*>(archiveEntry->file_pos);
+                poOffset->m_bInfoValid = true;
+                poOffset->m_nDataPos = oInfo.m_nDataPos;
+                poOffset->m_nCompressedSize = oInfo.m_nCompressedSize;
+                poOffset->m_nUncompressedSize = oInfo.m_nUncompressedSize;
+                poOffset->m_nCRC = oInfo.m_nCRC;
+                poOffset->m_bStored = oInfo.m_bStored;
+            }
+        }
     }
 
     VSIFilesystemHandler *poFSHandler =
@@ -1961,41 +2969,30 @@ VSIVirtualHandle* VSIZipFilesystemHandler::Open( const char *pszFilename,
 
     if (poVirtualHandle == NULL)
     {
-        delete poReader;
         return NULL;
     }
 
-    unzFile unzF = ((VSIZipReader*)poReader)->GetUnzFileHandle();
-
-    if( cpl_unzOpenCurrentFile(unzF) != UNZ_OK )
-    {
-        CPLError(CE_Failure, CPLE_AppDefined, "cpl_unzOpenCurrentFile() failed");
-        delete poReader;
-        return NULL;
-    }
-
-    uLong64 pos = cpl_unzGetCurrentFileZStreamPos(unzF);
-
-    unz_file_info file_info;
-    if( cpl_unzGetCurrentFileInfo (unzF, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK )
+/* -------------------------------------------------------------------- */
+/*      Stored entries are exposed directly as a window of the          */
+/*      archive, with true random access and without going through      */
+/*      the inflate layer. Empty entries keep the generic path, since   */
+/*      a subfile of size 0 means "up to the end of the file".          */
+/* -------------------------------------------------------------------- */
+    if( oInfo.m_bStored && oInfo.m_nUncompressedSize > 0 &&
+        oInfo.m_nCompressedSize == oInfo.m_nUncompressedSize )
     {
-        CPLError(CE_Failure, CPLE_AppDefined, "cpl_unzGetCurrentFileInfo() failed");
-        cpl_unzCloseCurrentFile(unzF);
-        delete poReader;
-        return NULL;
+        return VSICreateSubFileHandle(poVirtualHandle,
+                                      oInfo.m_nDataPos,
+                                      oInfo.m_nUncompressedSize);
     }
 
-    cpl_unzCloseCurrentFile(unzF);
-
-    delete poReader;
-
     VSIGZipHandle* poGZIPHandle = new VSIGZipHandle(poVirtualHandle,
                              NULL,
-                             pos,
-                             file_info.compressed_size,
-                             file_info.uncompressed_size,
-                             file_info.crc,
-                             file_info.compression_method == 0);
+                             oInfo.m_nDataPos,
+                             oInfo.m_nCompressedSize,
+                             oInfo.m_nUncompressedSize,
+                             oInfo.m_nCRC,
+                             oInfo.m_bStored);
     if( !(poGZIPHandle->IsInitOK()) )
     {
         delete poGZIPHandle;
@@ -2407,6 +3404,18 @@ void  VSIZipWriteHandle::StartNewFile(VSIZipWriteHandle* poSubFile)
  * zip file. Read and write operations cannot be interleaved : the new zip must
  * be closed before being re-opened for read.
  *
+ * Starting with GDAL 2.2, when the GDAL_NUM_THREADS configuration option is set
+ * to a value greater than 1 (or ALL_CPUS), deflated entries are compressed by
+ * several threads, as for /vsigzip/.
+ *
+ * Starting with GDAL 2.2, the parsed central directories of the most recently
+ * used archives are kept in a cache shared by all handles, so that opening
+ * many members of the same archive does not re-read it. The cache is
+ * invalidated when the modification time of the archive changes, and its
+ * size is bounded by the CPL_VSIL_ARCHIVE_CACHE_SIZE configuration option
+ * (in bytes, 64 MB by default). Members stored without compression are
+ * directly read from the archive with true random access.
+ *
  * Additional documentation is to be found at http://trac.osgeo.org/gdal/wiki/UserDocs/ReadInZip
  *
  * @since GDAL 1.6.0
@@ -54,9 +54,11 @@ class VSISubFileHandle : public VSIVirtualHandle
     virtual int       Seek( vsi_l_offset nOffset, int nWhence );
     virtual vsi_l_offset Tell();
     virtual size_t    Read( void *pBuffer, size_t nSize, size_t nMemb );
+    virtual size_t    PRead( void *pBuffer, size_t nSize, vsi_l_offset nOffset );
     virtual size_t    Write( const void *pBuffer, size_t nSize, size_t nMemb );
     virtual int       Eof();
     virtual int       Close();
+    virtual const void *GetRangePointer( vsi_l_offset nOffset, size_t nSize );
 };
 
 /************************************************************************/
@@ -185,6 +187,25 @@ size_t VSISubFileHandle::Read( void * pBuffer, size_t nSize, size_t nCount )
     return nRet;
 }
 
+/************************************************************************/
+/*                               PRead()                                */
+/************************************************************************/
+
+size_t VSISubFileHandle::PRead( void * pBuffer, size_t nSize,
+                                vsi_l_offset nOffset )
+
+{
+    if( nSubregionSize != 0 )
+    {
+        if( nOffset >= nSubregionSize )
+            return 0;
+        if( nSize > nSubregionSize - nOffset )
+            nSize = static_cast<size_t>(nSubregionSize - nOffset);
+    }
+
+    return VSIFPReadL( pBuffer, nSize, nSubregionOffset + nOffset, fp );
+}
+
 /************************************************************************/
 /*                               Write()                                */
 /************************************************************************/
@@ -224,6 +245,21 @@ int VSISubFileHandle::Eof()
     return bAtEOF;
 }
 
+/************************************************************************/
+/*                          GetRangePointer()                           */
+/************************************************************************/
+
+const void *VSISubFileHandle::GetRangePointer( vsi_l_offset nOffset,
+                                               size_t nSize )
+
+{
+    if( nSubregionSize != 0 &&
+        (nOffset > nSubregionSize || nSize > nSubregionSize - nOffset) )
+        return NULL;
+
+    return VSIFGetRangePointerL( fp, nSubregionOffset + nOffset, nSize );
+}
+
 /************************************************************************/
 /* ==================================================================== */
 /*                       VSISubFileFilesystemHandler                    */
@@ -425,6 +461,34 @@ char **VSISubFileFilesystemHandler::ReadDir( CPL_UNUSED const char *pszPath )
     return NULL;
 }
 
+/************************************************************************/
+/*                       VSICreateSubFileHandle()                       */
+/************************************************************************/
+
+/* Returns a handle on the [nSubregionOffset, nSubregionOffset+nSubregionSize[ */
+/* region of an already opened handle, without any copy. The returned handle */
+/* takes ownership of poBaseHandle, which is closed at the same time. */
+
+VSIVirtualHandle* VSICreateSubFileHandle( VSIVirtualHandle* poBaseHandle,
+                                          vsi_l_offset nSubregionOffset,
+                                          vsi_l_offset nSubregionSize )
+{
+    VSISubFileHandle *poHandle = new VSISubFileHandle;
+
+    poHandle->fp = reinterpret_cast<VSILFILE*>(poBaseHandle);
+    poHandle->nSubregionOffset = nSubregionOffset;
+    poHandle->nSubregionSize = nSubregionSize;
+
+    if( poBaseHandle->Seek( nSubregionOffset, SEEK_SET ) != 0 )
+    {
+        poHandle->Close();
+        delete poHandle;
+        return NULL;
+    }
+
+    return poHandle;
+}
+
 /************************************************************************/
 /*                 VSIInstallSubFileFilesystemHandler()                 */
 /************************************************************************/
@@ -65,6 +65,10 @@
 #include <dirent.h>
 #include <errno.h>
 #include <new>
+#include <limits>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 CPL_CVSID("$Id$");
 
@@ -82,6 +86,12 @@ CPL_CVSID("$Id$");
 #ifndef VSI_STAT64
 #define VSI_STAT64 stat64
 #endif
+#ifndef VSI_FSTAT64
+#define VSI_FSTAT64 fstat64
+#endif
+#ifndef VSI_PREAD64
+#define VSI_PREAD64 pread64
+#endif
 #ifndef VSI_STAT64_T
 #define VSI_STAT64_T stat64
 #endif
@@ -103,6 +113,12 @@ CPL_CVSID("$Id$");
 #ifndef VSI_STAT64
 #define VSI_STAT64 stat
 #endif
+#ifndef VSI_FSTAT64
+#define VSI_FSTAT64 fstat
+#endif
+#ifndef VSI_PREAD64
+#define VSI_PREAD64 pread
+#endif
 #ifndef VSI_STAT64_T
 #define VSI_STAT64_T stat
 #endif
@@ -164,6 +180,9 @@ class VSIUnixStdioHandle CPL_FINAL : public VSIVirtualHandle
     bool          bLastOpWrite;
     bool          bLastOpRead;
     bool          bAtEOF;
+    bool          bMappingTried;
+    void         *pMapping;
+    size_t        nMappingSize;
 #ifdef VSI_COUNT_BYTES_READ
     vsi_l_offset  nTotalBytesRead;
     VSIUnixStdioFilesystemHandler *poFS;
@@ -175,6 +194,10 @@ class VSIUnixStdioHandle CPL_FINAL : public VSIVirtualHandle
     virtual int       Seek( vsi_l_offset nOffsetIn, int nWhence );
     virtual vsi_l_offset Tell();
     virtual size_t    Read( void *pBuffer, size_t nSize, size_t nMemb );
+    virtual size_t    PRead( void *pBuffer, size_t nSize, vsi_l_offset nOffset );
+    virtual int       ReadMultiRange( int nRanges, void ** ppData,
+                                      const vsi_l_offset* panOffsets,
+                                      const size_t* panSizes );
     virtual size_t    Write( const void *pBuffer, size_t nSize, size_t nMemb );
     virtual int       Eof();
     virtual int       Flush();
@@ -182,6 +205,7 @@ class VSIUnixStdioHandle CPL_FINAL : public VSIVirtualHandle
     virtual int       Truncate( vsi_l_offset nNewSize );
     virtual void     *GetNativeFileDescriptor() {
         return reinterpret_cast<void *>(static_cast<size_t>(fileno(fp))); }
+    virtual const void *GetRangePointer( vsi_l_offset nOffset, size_t nSize );
 };
 
 
@@ -200,7 +224,10 @@ CPL_UNUSED
     bReadOnly(bReadOnlyIn),
     bLastOpWrite(false),
     bLastOpRead(false),
-    bAtEOF(false)
+    bAtEOF(false),
+    bMappingTried(false),
+    pMapping(NULL),
+    nMappingSize(0)
 #ifdef VSI_COUNT_BYTES_READ
     ,
     nTotalBytesRead(0),
@@ -221,6 +248,14 @@ int VSIUnixStdioHandle::Close()
     poFS->AddToTotal(nTotalBytesRead);
 #endif
 
+#ifdef HAVE_MMAP
+    if( pMapping != NULL )
+    {
+        munmap( pMapping, nMappingSize );
+        pMapping = NULL;
+    }
+#endif
+
     return fclose( fp );
 }
 
@@ -404,6 +439,70 @@ size_t VSIUnixStdioHandle::Read( void * pBuffer, size_t nSize, size_t nCount )
     return nResult;
 }
 
+/************************************************************************/
+/*                               PRead()                                */
+/************************************************************************/
+
+size_t VSIUnixStdioHandle::PRead( void * pBuffer, size_t nSize,
+                                  vsi_l_offset nOffset )
+
+{
+/* -------------------------------------------------------------------- */
+/*      Writes may still be in the stdio buffer, so only read-only      */
+/*      handles can read directly from the file descriptor.             */
+/* -------------------------------------------------------------------- */
+    if( !bReadOnly )
+        return VSIVirtualHandle::PRead( pBuffer, nSize, nOffset );
+
+    const int fd = fileno( fp );
+    size_t nRead = 0;
+    while( nRead < nSize )
+    {
+        const ssize_t nRet =
+            VSI_PREAD64( fd, static_cast<GByte *>(pBuffer) + nRead,
+                         nSize - nRead, nOffset + nRead );
+        if( nRet < 0 && errno == EINTR )
+            continue;
+        if( nRet <= 0 )
+            break;
+        nRead += static_cast<size_t>(nRet);
+    }
+
+    VSIDebug4( "VSIUnixStdioHandle::PRead(%p," CPL_FRMT_GUIB ",%ld) = %ld",
+               fp, nOffset, static_cast<long>(nSize),
+               static_cast<long>(nRead) );
+
+    return nRead;
+}
+
+/************************************************************************/
+/*                           ReadMultiRange()                           */
+/************************************************************************/
+
+int VSIUnixStdioHandle::ReadMultiRange( int nRanges, void ** ppData,
+                                        const vsi_l_offset* panOffsets,
+                                        const size_t* panSizes )
+{
+/* -------------------------------------------------------------------- */
+/*      When several threads are allowed, issue the reads in parallel   */
+/*      through the asynchronous API rather than sequentially.          */
+/* -------------------------------------------------------------------- */
+    if( !bReadOnly || nRanges < 2 || CPLGetConfiguredNumThreads("1") < 2 )
+        return VSIVirtualHandle::ReadMultiRange( nRanges, ppData,
+                                                 panOffsets, panSizes );
+
+    VSIAsyncReadRequest* poRequest =
+        ReadMultiRangeAsync( nRanges, ppData, panOffsets, panSizes );
+    const int nRet = poRequest->Wait();
+    delete poRequest;
+
+    /* Leave the file position where the sequential implementation would */
+    if( Seek( panOffsets[nRanges-1] + panSizes[nRanges-1], SEEK_SET ) != 0 )
+        return -1;
+
+    return nRet;
+}
+
 /************************************************************************/
 /*                               Write()                                */
 /************************************************************************/
@@ -462,6 +561,63 @@ int VSIUnixStdioHandle::Eof()
     return bAtEOF ? TRUE : FALSE;
 }
 
+/************************************************************************/
+/*                          GetRangePointer()                           */
+/************************************************************************/
+
+const void *VSIUnixStdioHandle::GetRangePointer(
+#ifndef HAVE_MMAP
+                                                CPL_UNUSED
+#endif
+                                                vsi_l_offset nOffset,
+#ifndef HAVE_MMAP
+                                                CPL_UNUSED
+#endif
+                                                size_t nSize )
+{
+#ifdef HAVE_MMAP
+/* -------------------------------------------------------------------- */
+/*      The whole file is mapped on the first request. Only read-only   */
+/*      handles are mapped, so that the mapping cannot become stale     */
+/*      because of our own writes.                                      */
+/* -------------------------------------------------------------------- */
+    if( !bMappingTried )
+    {
+        bMappingTried = true;
+
+        struct VSI_STAT64_T sStat;
+        if( bReadOnly &&
+            CPLTestBool(CPLGetConfigOption("CPL_VSIL_MMAP", "YES")) &&
+            VSI_FSTAT64( fileno(fp), &sStat ) == 0 &&
+            S_ISREG(sStat.st_mode) && sStat.st_size > 0 &&
+            static_cast<GUIntBig>(sStat.st_size) <=
+                std::numeric_limits<size_t>::max() )
+        {
+            const size_t nFileSize = static_cast<size_t>(sStat.st_size);
+            void* pMap = mmap( NULL, nFileSize, PROT_READ, MAP_SHARED,
+                               fileno(fp), 0 );
+            if( pMap != MAP_FAILED )
+            {
+                pMapping = pMap;
+                nMappingSize = nFileSize;
+            }
+            else
+            {
+                CPLDebug( "VSI", "mmap() failed: %s", VSIStrerror(errno) );
+            }
+        }
+    }
+
+    if( pMapping == NULL || nOffset > nMappingSize ||
+        nSize > nMappingSize - nOffset )
+        return NULL;
+
+    return static_cast<const GByte*>(pMapping) + nOffset;
+#else
+    return NULL;
+#endif
+}
+
 /************************************************************************/
 /*                             Truncate()                               */
 /************************************************************************/
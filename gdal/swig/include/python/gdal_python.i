@@ -1281,7 +1281,7 @@ def DEMProcessingOptions(options = [], colorFilename = None, format = 'GTiff',
               creationOptions = None, computeEdges = False, alg = 'Horn', band = 1,
               zFactor = None, scale = None, azimuth = None, altitude = None, combined = False,
               slopeFormat = None, trigonometric = False, zeroForFlat = False,
-              callback = None, callback_data = None):
+              separate = False, callback = None, callback_data = None):
     """ Create a DEMProcessingOptions() object that can be passed to gdal.DEMProcessing()
         Keyword arguments are :
           options --- can be be an array of strings, a string or let empty and filled from other keywords.
@@ -1299,6 +1299,7 @@ def DEMProcessingOptions(options = [], colorFilename = None, format = 'GTiff',
           slopeformat --- (slope only) "degree" or "percent".
           trigonometric --- (aspect only) whether to return trigonometric angle instead of azimuth. Thus 0deg means East, 90deg North, 180deg West, 270deg South.
           zeroForFlat --- (aspect only) whether to return 0 for flat areas with slope=0, instead of -9999.
+          separate --- when several processings are requested, whether to write each of them in its own dataset, named after destName, instead of a band of destName.
           callback --- callback method
           callback_data --- user data for callback
     """
@@ -1332,7 +1333,9 @@ def DEMProcessingOptions(options = [], colorFilename = None, format = 'GTiff',
         if trigonometric:
             new_options += ['-trigonometric' ]
         if zeroForFlat:
-            new_options += ['zero_for_flat' ]
+            new_options += ['-zero_for_flat' ]
+        if separate:
+            new_options += ['-separate' ]
 
     return (GDALDEMProcessingOptions(new_options), colorFilename, callback, callback_data)
 
@@ -1341,7 +1344,7 @@ def DEMProcessing(destName, srcDS, processing, **kwargs):
         Arguments are :
           destName --- Output dataset name
           srcDS --- a Dataset object or a filename
-          processing --- one of "hillshade", "slope", "aspect", "color-relief", "TRI", "TPI", "Roughness"
+          processing --- one of "hillshade", "slope", "aspect", "color-relief", "TRI", "TPI", "Roughness", or a comma separated list of them except "color-relief"
         Keyword arguments are :
           options --- return of gdal.InfoOptions(), string or array of strings
           other keywords arguments of gdal.DEMProcessingOptions()
@@ -0,0 +1,330 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+#******************************************************************************
+#  $Id$
+#
+#  Project:  GDAL
+#  Purpose:  Validate the layout of a cloud optimized GeoTIFF file
+#
+#******************************************************************************
+#  Copyright (c) 2016, The GDAL project
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+#******************************************************************************
+
+import struct
+import sys
+from osgeo import gdal
+
+def Usage():
+    print('Usage: validate_cloud_optimized_geotiff.py [-q] test.tif')
+    print('')
+    return 1
+
+TIFFTAG_SUBFILETYPE = 254
+TIFFTAG_IMAGEWIDTH = 256
+TIFFTAG_IMAGELENGTH = 257
+TIFFTAG_STRIPOFFSETS = 273
+TIFFTAG_STRIPBYTECOUNTS = 279
+TIFFTAG_TILEOFFSETS = 324
+TIFFTAG_TILEBYTECOUNTS = 325
+
+FILETYPE_MASK = 4
+
+# TIFF type -> (struct format, size)
+type_formats = { 1: ('B', 1), 2: ('c', 1), 3: ('H', 2), 4: ('I', 4),
+                 5: ('II', 8), 6: ('b', 1), 7: ('B', 1), 8: ('h', 2),
+                 9: ('i', 4), 10: ('ii', 8), 11: ('f', 4), 12: ('d', 8),
+                 13: ('I', 4), 16: ('Q', 8), 17: ('q', 8), 18: ('Q', 8) }
+
+class ValidateCloudOptimizedGeoTIFFException(Exception):
+    pass
+
+###############################################################################
+# Read the raw content of a file
+
+class TIFFReader:
+
+    def __init__(self, filename):
+        self.f = gdal.VSIFOpenL(filename, 'rb')
+        if self.f is None:
+            raise ValidateCloudOptimizedGeoTIFFException('Cannot open %s' % filename)
+
+    def close(self):
+        gdal.VSIFCloseL(self.f)
+
+    def read(self, offset, size):
+        gdal.VSIFSeekL(self.f, offset, 0)
+        data = gdal.VSIFReadL(1, size, self.f)
+        if data is None or len(data) != size:
+            raise ValidateCloudOptimizedGeoTIFFException(
+                'Cannot read %d bytes at offset %d' % (size, offset))
+        return data
+
+    def read_header(self):
+        data = self.read(0, 8)
+        if data[0:2] == b'II':
+            self.endian = '<'
+        elif data[0:2] == b'MM':
+            self.endian = '>'
+        else:
+            raise ValidateCloudOptimizedGeoTIFFException('Not a TIFF file')
+        version = struct.unpack(self.endian + 'H', data[2:4])[0]
+        if version == 42:
+            self.bigtiff = False
+            self.header_size = 8
+            return struct.unpack(self.endian + 'I', data[4:8])[0]
+        if version == 43:
+            self.bigtiff = True
+            self.header_size = 16
+            return struct.unpack(self.endian + 'Q', self.read(8, 8))[0]
+        raise ValidateCloudOptimizedGeoTIFFException('Not a TIFF file')
+
+    # Returns a dictionary with the offset and size of the IFD, the end of
+    # its tag data, the integer tag values and the offset of the next IFD
+    def read_ifd(self, offset):
+        if self.bigtiff:
+            count_fmt, count_size, entry_size, inline_size = 'Q', 8, 20, 8
+        else:
+            count_fmt, count_size, entry_size, inline_size = 'H', 2, 12, 4
+        nentries = struct.unpack(self.endian + count_fmt,
+                                 self.read(offset, count_size))[0]
+        data = self.read(offset + count_size, nentries * entry_size + inline_size)
+
+        ifd = { 'offset': offset,
+                'end': offset + count_size + len(data),
+                'data_end': offset + count_size + len(data),
+                'tags': {} }
+        for i in range(nentries):
+            entry = data[i*entry_size:(i+1)*entry_size]
+            (tag, typ) = struct.unpack(self.endian + 'HH', entry[0:4])
+            if self.bigtiff:
+                count = struct.unpack(self.endian + 'Q', entry[4:12])[0]
+                value = entry[12:20]
+            else:
+                count = struct.unpack(self.endian + 'I', entry[4:8])[0]
+                value = entry[8:12]
+            if typ not in type_formats:
+                continue
+            (fmt, size) = type_formats[typ]
+            if count * size > inline_size:
+                if self.bigtiff:
+                    data_offset = struct.unpack(self.endian + 'Q', value)[0]
+                else:
+                    data_offset = struct.unpack(self.endian + 'I', value)[0]
+                ifd['data_end'] = max(ifd['data_end'], data_offset + count * size)
+                # Only fetch the values of integer tags we are interested in
+                if tag not in (TIFFTAG_STRIPOFFSETS, TIFFTAG_STRIPBYTECOUNTS,
+                               TIFFTAG_TILEOFFSETS, TIFFTAG_TILEBYTECOUNTS):
+                    continue
+                value = self.read(data_offset, count * size)
+            if typ in (1, 3, 4, 16):
+                ifd['tags'][tag] = list(struct.unpack(
+                    self.endian + fmt * count, value[0:count * size]))
+
+        next_data = data[nentries * entry_size:]
+        if self.bigtiff:
+            ifd['next'] = struct.unpack(self.endian + 'Q', next_data)[0]
+        else:
+            ifd['next'] = struct.unpack(self.endian + 'I', next_data)[0]
+        return ifd
+
+###############################################################################
+# Parse the structural metadata written after the TIFF header
+
+def read_structural_metadata(reader):
+    prefix = 'GDAL_STRUCTURAL_METADATA_SIZE='
+    try:
+        data = reader.read(reader.header_size, len(prefix) + 13)
+    except ValidateCloudOptimizedGeoTIFFException:
+        return (0, {})
+    data = data.decode('latin1')
+    if not data.startswith(prefix):
+        return (0, {})
+    size = int(data[len(prefix):len(prefix)+6])
+    content = reader.read(reader.header_size + len(prefix) + 13, size)
+    metadata = {}
+    for line in content.decode('latin1').split('\n'):
+        pos = line.find('=')
+        if pos > 0:
+            metadata[line[0:pos]] = line[pos+1:].strip()
+    return (len(prefix) + 13 + size, metadata)
+
+###############################################################################
+# Validate a file. Returns a tuple (errors, warnings), each one being a list
+# of strings.
+
+def validate(filename):
+
+    errors = []
+    warnings = []
+
+    reader = TIFFReader(filename)
+    try:
+        ifd_offset = reader.read_header()
+        (ghost_size, metadata) = read_structural_metadata(reader)
+
+        ifds = []
+        visited = set()
+        while ifd_offset != 0:
+            if ifd_offset in visited or len(ifds) == 1000:
+                raise ValidateCloudOptimizedGeoTIFFException('Invalid IFD chain')
+            visited.add(ifd_offset)
+            ifd = reader.read_ifd(ifd_offset)
+            ifds.append(ifd)
+            ifd_offset = ifd['next']
+        if len(ifds) == 0:
+            raise ValidateCloudOptimizedGeoTIFFException('No IFD')
+
+        for ifd in ifds:
+            tags = ifd['tags']
+            ifd['width'] = tags.get(TIFFTAG_IMAGEWIDTH, [0])[0]
+            ifd['height'] = tags.get(TIFFTAG_IMAGELENGTH, [0])[0]
+            ifd['mask'] = (tags.get(TIFFTAG_SUBFILETYPE, [0])[0] & FILETYPE_MASK) != 0
+            ifd['tiled'] = TIFFTAG_TILEOFFSETS in tags
+            if ifd['tiled']:
+                ifd['block_offsets'] = tags[TIFFTAG_TILEOFFSETS]
+                ifd['block_sizes'] = tags.get(TIFFTAG_TILEBYTECOUNTS, [])
+            else:
+                ifd['block_offsets'] = tags.get(TIFFTAG_STRIPOFFSETS, [])
+                ifd['block_sizes'] = tags.get(TIFFTAG_STRIPBYTECOUNTS, [])
+            if len(ifd['block_offsets']) != len(ifd['block_sizes']):
+                raise ValidateCloudOptimizedGeoTIFFException(
+                    'Inconsistent strip/tile offsets and byte counts')
+
+        # Main image: tiling and overviews
+        main_ifd = ifds[0]
+        if main_ifd['width'] > 512 or main_ifd['height'] > 512:
+            if not main_ifd['tiled']:
+                errors.append('The file is greater than 512xH or Wx512, but is not tiled')
+            if len([ifd for ifd in ifds if not ifd['mask']]) == 1:
+                warnings.append('The file is greater than 512xH or Wx512, it is recommended to include internal overviews')
+
+        # IFDs at the beginning of the file, in increasing offset order
+        expected_first_ifd = reader.header_size + ghost_size
+        expected_first_ifd += expected_first_ifd % 2
+        if ifds[0]['offset'] != expected_first_ifd:
+            errors.append('The offset of the main IFD should be %d. It is %d instead' %
+                          (expected_first_ifd, ifds[0]['offset']))
+        for i in range(1, len(ifds)):
+            if ifds[i]['offset'] < ifds[i-1]['offset']:
+                errors.append('The offset of IFD %d is %d, whereas it should be greater than the one of IFD %d, which is at byte %d' %
+                              (i, ifds[i]['offset'], i-1, ifds[i-1]['offset']))
+
+        end_of_ifds = max([ifd['data_end'] for ifd in ifds])
+        first_data = [ min([x for x in ifd['block_offsets'] if x != 0] or [0]) for ifd in ifds ]
+        data_start = min([x for x in first_data if x != 0] or [0])
+        if data_start != 0 and data_start < end_of_ifds:
+            errors.append('The IFDs and their tag data should be located before the imagery (imagery starts at byte %d, IFD data ends at byte %d)' %
+                          (data_start, end_of_ifds))
+
+        # Imagery of smallest images first
+        order = sorted(range(len(ifds)),
+                       key=lambda i: (ifds[i]['width'] * ifds[i]['height'],
+                                      ifds[i]['mask'], i))
+        last_idx = None
+        for idx in order:
+            if first_data[idx] == 0:
+                continue
+            if last_idx is not None and first_data[idx] < first_data[last_idx]:
+                errors.append('The imagery of IFD %d (%dx%d) should be located after the one of IFD %d (%dx%d)' %
+                              (idx, ifds[idx]['width'], ifds[idx]['height'],
+                               last_idx, ifds[last_idx]['width'], ifds[last_idx]['height']))
+            last_idx = idx
+
+        # Blocks in row-major order
+        for idx, ifd in enumerate(ifds):
+            last_offset = 0
+            for block, offset in enumerate(ifd['block_offsets']):
+                if offset == 0:
+                    continue
+                if offset < last_offset:
+                    errors.append('The strips/tiles of IFD %d are not in row-major order (block %d at byte %d)' %
+                                  (idx, block, offset))
+                    break
+                last_offset = offset
+
+        # Block leaders and trailers
+        check_leader = metadata.get('BLOCK_LEADER') == 'SIZE_AS_UINT4'
+        check_trailer = metadata.get('BLOCK_TRAILER') == 'LAST_4_BYTES_REPEATED'
+        if check_leader or check_trailer:
+            for idx, ifd in enumerate(ifds):
+                for block in range(len(ifd['block_offsets'])):
+                    offset = ifd['block_offsets'][block]
+                    size = ifd['block_sizes'][block]
+                    if offset == 0 or size == 0:
+                        continue
+                    if check_leader:
+                        leader = struct.unpack('<I', reader.read(offset - 4, 4))[0]
+                        if leader != size:
+                            errors.append('Leader of block %d of IFD %d is %d, whereas byte count is %d' %
+                                          (block, idx, leader, size))
+                            break
+                    if check_trailer and size >= 4:
+                        data = reader.read(offset + size - 4, 8)
+                        if data[0:4] != data[4:8]:
+                            errors.append('Trailer of block %d of IFD %d does not repeat its last 4 bytes' %
+                                          (block, idx))
+                            break
+    finally:
+        reader.close()
+
+    return (errors, warnings)
+
+###############################################################################
+
+def main():
+    i = 1
+    filename = None
+    quiet = False
+    while i < len(sys.argv):
+        if sys.argv[i] == '-q':
+            quiet = True
+        elif sys.argv[i][0] == '-':
+            return Usage()
+        elif filename is None:
+            filename = sys.argv[i]
+        else:
+            return Usage()
+
+        i = i + 1
+
+    if filename is None:
+        return Usage()
+
+    try:
+        (errors, warnings) = validate(filename)
+    except ValidateCloudOptimizedGeoTIFFException:
+        print('%s is not a valid cloud optimized GeoTIFF: %s' % (filename, str(sys.exc_info()[1])))
+        return 1
+
+    if not quiet:
+        for warning in warnings:
+            print('WARNING: ' + warning)
+        for error in errors:
+            print('ERROR: ' + error)
+        if len(errors) == 0:
+            print('%s is a valid cloud optimized GeoTIFF' % filename)
+        else:
+            print('%s is NOT a valid cloud optimized GeoTIFF' % filename)
+
+    return len(errors)
+
+if __name__ == '__main__':
+    sys.exit(main())